@@ -0,0 +1,162 @@
+// Copyright (c) 2015 Sirikata Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can
+// be found in the LICENSE file.
+
+#include "ArithmeticCoderBenchmark.hpp"
+#include <sirikata/core/util/Timer.hpp>
+#include <sirikata/core/util/Paths.hpp>
+#include <sirikata/core/options/Options.hpp>
+#include <sirikata/core/jpeg-arhc/ArithmeticCoder.hpp>
+#include <boost/filesystem.hpp>
+#include <fstream>
+
+namespace Sirikata {
+
+namespace {
+
+typedef std::vector<uint8, JpegAllocator<uint8> > ByteVector;
+
+// Adaptive order-0 bit model: every byte is coded MSB first, with the
+// partially decoded byte selecting one of 255 context states.
+template<class Writer> void encodeBytes(Writer& writer, const ByteVector& data) {
+    unsigned char states[256] = {0};
+    for(ByteVector::const_iterator it = data.begin(); it != data.end(); it++) {
+        uint32 ctx = 1;
+        for(int bit = 7; bit >= 0; bit--) {
+            bool value = ((*it) >> bit) & 1;
+            writer.WriteBit(&states[ctx], value);
+            ctx = (ctx << 1) | (value ? 1 : 0);
+        }
+    }
+    writer.Finish();
+}
+
+template<class Reader> bool decodeBytes(Reader& reader, const ByteVector& expected) {
+    unsigned char states[256] = {0};
+    bool matches = true;
+    for(ByteVector::const_iterator it = expected.begin(); it != expected.end(); it++) {
+        uint32 ctx = 1;
+        for(int bit = 7; bit >= 0; bit--)
+            ctx = (ctx << 1) | (reader.ReadBit(&states[ctx]) ? 1 : 0);
+        matches = matches && ((ctx & 0xFF) == *it);
+    }
+    return matches;
+}
+
+void reportThroughput(const String& label, uint64 bytes, const Duration& dur) {
+    SILOG(benchmark,info,
+          label << ": " << bytes << " bytes in " << dur << ", "
+          << (bytes / (1024.0 * 1024.0)) / dur.toSeconds() << " MB/s");
+}
+
+} // namespace
+
+ArithmeticCoderBenchmark::ArithmeticCoderBenchmark(const FinishedCallback& finished_cb, const String& param)
+        : Benchmark(finished_cb),
+          mForceStop(false)
+{
+    String default_corpus = Path::Get(Path::DIR_EXE);
+    // Windows exes are one level deeper due to Debug or RelWithDebInfo
+#if SIRIKATA_PLATFORM == SIRIKATA_PLATFORM_WINDOWS
+    default_corpus = default_corpus + "/../";
+#endif
+    default_corpus = default_corpus + "/../../test/unit/libmesh/collada/";
+
+    OptionValue* corpus;
+    OptionValue* iterations;
+    Sirikata::InitializeClassOptions ico("ArithmeticCoderBenchmark",this,
+        corpus=new OptionValue("corpus",default_corpus,Sirikata::OptionValueType<String>(),"Directory searched recursively for JPEG files"),
+        iterations=new OptionValue("iterations","10",Sirikata::OptionValueType<uint32>(),"Number of passes over the corpus"),
+        NULL);
+
+    OptionSet* optionsSet = OptionSet::getOptions("ArithmeticCoderBenchmark",this);
+    optionsSet->parse(param);
+
+    mCorpus = corpus->as<String>();
+    mIterations = iterations->as<uint32>();
+}
+
+String ArithmeticCoderBenchmark::name() {
+    return "arithmetic-coder";
+}
+
+void ArithmeticCoderBenchmark::start() {
+    namespace fs = boost::filesystem;
+    mForceStop = false;
+
+    JpegAllocator<uint8> alloc;
+    std::vector<ByteVector> files;
+    uint64 corpus_bytes = 0;
+    if (fs::exists(mCorpus)) {
+        for(fs::recursive_directory_iterator it(mCorpus); it != fs::recursive_directory_iterator(); it++) {
+            String ext = it->path().extension().string();
+            if (!fs::is_regular_file(it->path()) || (ext != ".jpg" && ext != ".jpeg" && ext != ".JPG"))
+                continue;
+            std::ifstream fp(it->path().string().c_str(), std::ios::in | std::ios::binary);
+            files.push_back(ByteVector(alloc));
+            files.back().assign(std::istreambuf_iterator<char>(fp), std::istreambuf_iterator<char>());
+            corpus_bytes += files.back().size();
+        }
+    }
+    if (files.empty()) {
+        SILOG(benchmark,error,"No JPEG files found in " << mCorpus);
+        notifyFinished();
+        return;
+    }
+    SILOG(benchmark,info,files.size() << " JPEG files, " << corpus_bytes << " bytes in corpus");
+
+    Duration unbuffered_encode = Duration::zero(), unbuffered_decode = Duration::zero();
+    Duration buffered_encode = Duration::zero(), buffered_decode = Duration::zero();
+    uint64 coded_bytes = 0;
+    bool all_match = true;
+    for(uint32 iter = 0; iter < mIterations && !mForceStop; iter++) {
+        for(std::vector<ByteVector>::const_iterator fit = files.begin(); fit != files.end() && !mForceStop; fit++) {
+            {
+                MemReadWriter coded(alloc);
+                Time start_time = Timer::now();
+                ArithmeticWriter writer(&coded);
+                encodeBytes(writer, *fit);
+                unbuffered_encode += Timer::now() - start_time;
+
+                start_time = Timer::now();
+                ArithmeticReader reader(&coded);
+                all_match = decodeBytes(reader, *fit) && all_match;
+                unbuffered_decode += Timer::now() - start_time;
+            }
+            {
+                MemReadWriter coded(alloc);
+                Time start_time = Timer::now();
+                BufferedArithmeticWriter<65536> writer(&coded);
+                encodeBytes(writer, *fit);
+                buffered_encode += Timer::now() - start_time;
+                coded_bytes += coded.buffer().size();
+
+                start_time = Timer::now();
+                BufferedArithmeticReader<65536> reader(&coded);
+                all_match = decodeBytes(reader, *fit) && all_match;
+                buffered_decode += Timer::now() - start_time;
+            }
+        }
+    }
+
+    if (mForceStop)
+        return;
+
+    uint64 total_bytes = corpus_bytes * mIterations;
+    reportThroughput("per-byte encode", total_bytes, unbuffered_encode);
+    reportThroughput("per-byte decode", total_bytes, unbuffered_decode);
+    reportThroughput("buffered encode", total_bytes, buffered_encode);
+    reportThroughput("buffered decode", total_bytes, buffered_decode);
+    SILOG(benchmark,info,"Coded size " << coded_bytes / mIterations << " bytes ("
+          << (100.0 * coded_bytes) / total_bytes << "% of corpus)");
+    if (!all_match)
+        SILOG(benchmark,error,"Round trip mismatch in arithmetic coder");
+
+    notifyFinished();
+}
+
+void ArithmeticCoderBenchmark::stop() {
+    mForceStop = true;
+}
+
+} // namespace Sirikata
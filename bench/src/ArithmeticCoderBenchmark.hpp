@@ -0,0 +1,42 @@
+// Copyright (c) 2015 Sirikata Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can
+// be found in the LICENSE file.
+
+#ifndef _SIRIKATA_ARITHMETIC_CODER_BENCHMARK_HPP_
+#define _SIRIKATA_ARITHMETIC_CODER_BENCHMARK_HPP_
+
+#include "Benchmark.hpp"
+
+namespace Sirikata {
+
+/** Measure jpeg-arhc arithmetic coder throughput over a corpus of JPEG
+ *  files, comparing the per-byte ArithmeticWriter/ArithmeticReader against
+ *  the block buffered coders.
+ *
+ *  Parameters: --corpus=<directory searched recursively for .jpg files>
+ *              --iterations=<passes over the corpus>
+ */
+class ArithmeticCoderBenchmark : public Benchmark {
+  public:
+    typedef std::tr1::function<void()> FinishedCallback;
+
+    static Benchmark* create(const FinishedCallback& finished_cb, const String& param) {
+        return new ArithmeticCoderBenchmark(finished_cb, param);
+    }
+
+    ArithmeticCoderBenchmark(const FinishedCallback& finished_cb, const String& param);
+
+    virtual String name();
+
+    virtual void start();
+    virtual void stop();
+
+  private:
+    bool mForceStop;
+    String mCorpus;
+    uint32 mIterations;
+}; // class ArithmeticCoderBenchmark
+
+} // namespace Sirikata
+
+#endif //_SIRIKATA_ARITHMETIC_CODER_BENCHMARK_HPP_
@@ -0,0 +1,234 @@
+// Copyright (c) 2015 Sirikata Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can
+// be found in the LICENSE file.
+
+#include "ColladaImportBenchmark.hpp"
+#include <sirikata/core/util/Timer.hpp>
+#include <sirikata/core/util/Paths.hpp>
+#include <sirikata/core/options/Options.hpp>
+#include <sirikata/core/transfer/TransferData.hpp>
+#include <sirikata/mesh/ModelsSystemFactory.hpp>
+#include <sirikata/mesh/MeshdataBinary.hpp>
+
+#include <boost/filesystem.hpp>
+#include <boost/lexical_cast.hpp>
+#include <fstream>
+
+namespace Sirikata {
+
+namespace {
+
+bool readFile(const String& path, String* contents) {
+    std::ifstream fin(path.c_str(), std::ios::in | std::ios::binary);
+    if (!fin) return false;
+    std::ostringstream data;
+    data << fin.rdbuf();
+    *contents = data.str();
+    return true;
+}
+
+Mesh::MeshdataPtr loadDocument(ModelsSystem* system, const Transfer::DenseDataPtr& data) {
+    return std::tr1::dynamic_pointer_cast<Mesh::Meshdata>(system->load(data));
+}
+
+} // namespace
+
+ColladaImportBenchmark::ColladaImportBenchmark(const FinishedCallback& finished_cb, const String& param)
+        : Benchmark(finished_cb),
+          mForceStop(false)
+{
+    OptionValue* dir;
+    OptionValue* threads;
+    OptionValue* iterations;
+    OptionValue* generated_geometries;
+    OptionValue* generated_grid;
+    Sirikata::InitializeClassOptions ico("ColladaImportBenchmark",this,
+        dir=new OptionValue("dir","",Sirikata::OptionValueType<String>(),"Directory of .dae files to load, defaults to the in-tree test models"),
+        threads=new OptionValue("threads","0",Sirikata::OptionValueType<uint32>(),"Import threads for the parallel run, 0 for automatic"),
+        iterations=new OptionValue("iterations","3",Sirikata::OptionValueType<uint32>(),"Number of times each document is loaded"),
+        generated_geometries=new OptionValue("generated-geometries","32",Sirikata::OptionValueType<uint32>(),"Number of geometries in the generated scene"),
+        generated_grid=new OptionValue("generated-grid","64",Sirikata::OptionValueType<uint32>(),"Each generated geometry is a grid of this many quads on a side"),
+        NULL);
+
+    OptionSet* optionsSet = OptionSet::getOptions("ColladaImportBenchmark",this);
+    optionsSet->parse(param);
+
+    mDir = dir->as<String>();
+    mThreads = threads->as<uint32>();
+    mIterations = std::max(iterations->as<uint32>(), (uint32)1);
+    mGeneratedGeometries = generated_geometries->as<uint32>();
+    mGeneratedGrid = std::max(generated_grid->as<uint32>(), (uint32)1);
+
+    mPlugins.load("colladamodels");
+}
+
+String ColladaImportBenchmark::name() {
+    return "collada-import";
+}
+
+String ColladaImportBenchmark::generateScene() {
+    // Each geometry is a grid in the XZ plane, with positions, normals and
+    // texture coordinates all indexed separately like exporters usually do.
+    uint32 verts_per_side = mGeneratedGrid + 1;
+    uint32 nverts = verts_per_side * verts_per_side;
+    uint32 ntris = mGeneratedGrid * mGeneratedGrid * 2;
+
+    std::ostringstream doc;
+    doc << "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n"
+        << "<COLLADA xmlns=\"http://www.collada.org/2005/11/COLLADASchema\" version=\"1.4.1\">\n"
+        << "<asset><unit meter=\"1\" name=\"meter\"/><up_axis>Y_UP</up_axis></asset>\n"
+        << "<library_geometries>\n";
+    for(uint32 g = 0; g < mGeneratedGeometries; g++) {
+        String id = "geom" + boost::lexical_cast<String>(g);
+        doc << "<geometry id=\"" << id << "\" name=\"" << id << "\"><mesh>\n";
+
+        // Add some per-geometry variation so they aren't all identical
+        float32 height = (float32)(g % 7) * 0.1f;
+        doc << "<source id=\"" << id << "-positions\"><float_array id=\"" << id << "-positions-array\" count=\"" << nverts*3 << "\">";
+        for(uint32 z = 0; z < verts_per_side; z++)
+            for(uint32 x = 0; x < verts_per_side; x++)
+                doc << x << " " << (((x+z) % 3) * height) << " " << z << " ";
+        doc << "</float_array><technique_common><accessor source=\"#" << id << "-positions-array\" count=\"" << nverts << "\" stride=\"3\">"
+            << "<param name=\"X\" type=\"float\"/><param name=\"Y\" type=\"float\"/><param name=\"Z\" type=\"float\"/>"
+            << "</accessor></technique_common></source>\n";
+
+        doc << "<source id=\"" << id << "-normals\"><float_array id=\"" << id << "-normals-array\" count=\"" << nverts*3 << "\">";
+        for(uint32 v = 0; v < nverts; v++)
+            doc << "0 1 0 ";
+        doc << "</float_array><technique_common><accessor source=\"#" << id << "-normals-array\" count=\"" << nverts << "\" stride=\"3\">"
+            << "<param name=\"X\" type=\"float\"/><param name=\"Y\" type=\"float\"/><param name=\"Z\" type=\"float\"/>"
+            << "</accessor></technique_common></source>\n";
+
+        doc << "<source id=\"" << id << "-uvs\"><float_array id=\"" << id << "-uvs-array\" count=\"" << nverts*2 << "\">";
+        for(uint32 z = 0; z < verts_per_side; z++)
+            for(uint32 x = 0; x < verts_per_side; x++)
+                doc << ((float32)x / mGeneratedGrid) << " " << ((float32)z / mGeneratedGrid) << " ";
+        doc << "</float_array><technique_common><accessor source=\"#" << id << "-uvs-array\" count=\"" << nverts << "\" stride=\"2\">"
+            << "<param name=\"S\" type=\"float\"/><param name=\"T\" type=\"float\"/>"
+            << "</accessor></technique_common></source>\n";
+
+        doc << "<vertices id=\"" << id << "-vertices\"><input semantic=\"POSITION\" source=\"#" << id << "-positions\"/></vertices>\n"
+            << "<triangles count=\"" << ntris << "\">"
+            << "<input semantic=\"VERTEX\" source=\"#" << id << "-vertices\" offset=\"0\"/>"
+            << "<input semantic=\"NORMAL\" source=\"#" << id << "-normals\" offset=\"1\"/>"
+            << "<input semantic=\"TEXCOORD\" source=\"#" << id << "-uvs\" offset=\"2\" set=\"0\"/><p>";
+        for(uint32 z = 0; z < mGeneratedGrid; z++) {
+            for(uint32 x = 0; x < mGeneratedGrid; x++) {
+                uint32 v00 = z * verts_per_side + x, v10 = v00 + 1;
+                uint32 v01 = v00 + verts_per_side, v11 = v01 + 1;
+                uint32 tri[6] = { v00, v01, v10, v10, v01, v11 };
+                for(uint32 i = 0; i < 6; i++)
+                    doc << tri[i] << " " << tri[i] << " " << tri[i] << " ";
+            }
+        }
+        doc << "</p></triangles>\n</mesh></geometry>\n";
+    }
+    doc << "</library_geometries>\n";
+
+    doc << "<library_visual_scenes><visual_scene id=\"scene\">\n";
+    for(uint32 g = 0; g < mGeneratedGeometries; g++) {
+        doc << "<node id=\"node" << g << "\"><translate>" << (g * mGeneratedGrid) << " 0 0</translate>"
+            << "<instance_geometry url=\"#geom" << g << "\"/></node>\n";
+    }
+    doc << "</visual_scene></library_visual_scenes>\n"
+        << "<scene><instance_visual_scene url=\"#scene\"/></scene>\n"
+        << "</COLLADA>\n";
+    return doc.str();
+}
+
+bool ColladaImportBenchmark::runDocument(const String& label, const String& document,
+                                         ModelsSystem* serial, ModelsSystem* parallel)
+{
+    Transfer::DenseDataPtr data(new Transfer::DenseData(document));
+
+    Mesh::MeshdataPtr serial_mesh, parallel_mesh;
+    Duration serial_dur = Duration::zero(), parallel_dur = Duration::zero();
+    for(uint32 it = 0; it < mIterations; it++) {
+        if (mForceStop) return false;
+
+        Time start_time = Timer::now();
+        serial_mesh = loadDocument(serial, data);
+        serial_dur += Timer::now() - start_time;
+
+        start_time = Timer::now();
+        parallel_mesh = loadDocument(parallel, data);
+        parallel_dur += Timer::now() - start_time;
+    }
+
+    if (!serial_mesh || !parallel_mesh) {
+        SILOG(benchmark,error, label << ": failed to load");
+        return true;
+    }
+
+    // The serialized forms cover everything in the Meshdata, so they're an
+    // easy way to check the two modes produce exactly the same thing.
+    bool match = (Mesh::MeshdataBinary::serialize(*serial_mesh) == Mesh::MeshdataBinary::serialize(*parallel_mesh));
+
+    SILOG(benchmark,info,
+          label << " (" << document.size() << " bytes, " << serial_mesh->geometry.size() << " geometries): "
+          << "serial " << (serial_dur.toMicroseconds() / mIterations) << "us, "
+          << "parallel " << (parallel_dur.toMicroseconds() / mIterations) << "us, "
+          << (match ? "results match" : "RESULTS DIFFER"));
+    return true;
+}
+
+void ColladaImportBenchmark::start() {
+    mForceStop = false;
+
+    ModelsSystem* serial = ModelsSystemFactory::getSingleton().getConstructor("colladamodels")("--import-threads=1");
+    ModelsSystem* parallel = ModelsSystemFactory::getSingleton().getConstructor("colladamodels")(
+        "--import-threads=" + boost::lexical_cast<String>(mThreads)
+    );
+    if (serial == NULL || parallel == NULL) {
+        SILOG(benchmark,error,"Couldn't create COLLADA models system");
+        delete serial;
+        delete parallel;
+        notifyFinished();
+        return;
+    }
+
+    boost::filesystem::path dir;
+    if (!mDir.empty()) {
+        dir = mDir;
+    }
+    else {
+        // Same approach as the unit tests, only supports in-tree execution
+        dir = boost::filesystem::path(Path::Get(Path::DIR_EXE));
+#if SIRIKATA_PLATFORM == SIRIKATA_PLATFORM_WINDOWS
+        dir = dir / "..";
+#endif
+        dir = dir / "../../cdn/fake_root/test";
+    }
+
+    bool finished = true;
+    if (boost::filesystem::exists(dir)) {
+        for(boost::filesystem::directory_iterator it(dir); it != boost::filesystem::directory_iterator(); it++) {
+            String path = it->path().string();
+            if (path.size() < 4 || path.substr(path.size() - 4) != ".dae") continue;
+            String contents;
+            if (!readFile(path, &contents)) continue;
+            if (!runDocument(path.substr(path.find_last_of("/\\") + 1), contents, serial, parallel)) {
+                finished = false;
+                break;
+            }
+        }
+    }
+    else {
+        SILOG(benchmark,warning,"Couldn't find COLLADA models in " << dir.string());
+    }
+
+    if (finished && mGeneratedGeometries > 0)
+        finished = runDocument("generated scene", generateScene(), serial, parallel);
+
+    delete serial;
+    delete parallel;
+
+    if (finished)
+        notifyFinished();
+}
+
+void ColladaImportBenchmark::stop() {
+    mForceStop = true;
+}
+
+} // namespace Sirikata
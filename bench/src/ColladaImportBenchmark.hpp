@@ -0,0 +1,58 @@
+// Copyright (c) 2015 Sirikata Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can
+// be found in the LICENSE file.
+
+#ifndef _SIRIKATA_COLLADA_IMPORT_BENCHMARK_HPP_
+#define _SIRIKATA_COLLADA_IMPORT_BENCHMARK_HPP_
+
+#include "Benchmark.hpp"
+#include <sirikata/core/util/PluginManager.hpp>
+
+namespace Sirikata {
+
+class ModelsSystem;
+
+/** Measure how long it takes to import COLLADA documents, converting geometry
+ *  on the loading thread as it is parsed and on a pool of import threads. The
+ *  models in cdn/fake_root/test are loaded, along with a generated scene with
+ *  many large geometries, and the results from both modes are checked against
+ *  each other.
+ *
+ *  Parameters: --dir=<directory of .dae files, defaults to the in-tree test models>
+ *              --threads=<import threads for the parallel run, 0 for automatic>
+ *              --iterations=<number of times each document is loaded>
+ *              --generated-geometries=<geometries in the generated scene>
+ *              --generated-grid=<each generated geometry is a grid x grid quad mesh>
+ */
+class ColladaImportBenchmark : public Benchmark {
+  public:
+    typedef std::tr1::function<void()> FinishedCallback;
+
+    static Benchmark* create(const FinishedCallback& finished_cb, const String& param) {
+        return new ColladaImportBenchmark(finished_cb, param);
+    }
+
+    ColladaImportBenchmark(const FinishedCallback& finished_cb, const String& param);
+
+    virtual String name();
+
+    virtual void start();
+    virtual void stop();
+
+  private:
+    String generateScene();
+    bool runDocument(const String& label, const String& document,
+                     ModelsSystem* serial, ModelsSystem* parallel);
+
+    bool mForceStop;
+    PluginManager mPlugins;
+    String mDir;
+    uint32 mThreads;
+    uint32 mIterations;
+    uint32 mGeneratedGeometries;
+    uint32 mGeneratedGrid;
+}; // class ColladaImportBenchmark
+
+} // namespace Sirikata
+
+#endif //_SIRIKATA_COLLADA_IMPORT_BENCHMARK_HPP_
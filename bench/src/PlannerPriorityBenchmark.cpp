@@ -0,0 +1,360 @@
+// Copyright (c) 2015 Sirikata Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can
+// be found in the LICENSE file.
+
+#include "PlannerPriorityBenchmark.hpp"
+#include <sirikata/core/util/Timer.hpp>
+#include <sirikata/core/util/Random.hpp>
+#include <sirikata/core/util/UUID.hpp>
+#include <sirikata/core/util/SolidAngle.hpp>
+#include <sirikata/core/util/IndexedHeap.hpp>
+#include <sirikata/core/util/PackedPriorities.hpp>
+#include <sirikata/core/options/Options.hpp>
+
+#include <algorithm>
+#include <iterator>
+
+namespace Sirikata {
+
+namespace {
+
+// Size of the cube objects are scattered in
+const float32 WorldSize = 2000.f;
+
+void reportFrames(const String& label, uint32 frames, uint64 swaps, const Duration& dur) {
+    SILOG(benchmark,info,
+          label << ": " << frames << " frames in " << dur << ", "
+          << (dur.toMicroseconds()/float(frames)) << "us/frame, "
+          << swaps << " loads/unloads");
+}
+
+// Same computation as SolidAngleDownloadPlannerMetric::calculatePriority
+float32 solidAnglePriority(const Vector3d& camera_pos, const Vector3f& pos, float32 radius) {
+    Vector3d obj_pos(pos);
+    if (camera_pos.x >= obj_pos.x - radius && camera_pos.x <= obj_pos.x + radius &&
+        camera_pos.y >= obj_pos.y - radius && camera_pos.y <= obj_pos.y + radius &&
+        camera_pos.z >= obj_pos.z - radius && camera_pos.z <= obj_pos.z + radius)
+        return 0.99f;
+    Vector3d diff = camera_pos - obj_pos;
+    SolidAngle sa = SolidAngle::fromCenterRadius((Vector3f)diff, radius);
+    return sa.asFloat() / SolidAngle::Max.asFloat();
+}
+
+} // namespace
+
+// The same inputs are replayed for each approach
+struct PlannerPriorityBenchmark::Scene {
+    std::vector<Vector3f> positions;
+    std::vector<float32> radii;
+    // Camera position for each frame
+    std::vector<Vector3d> cameras;
+    // Objects moved in each frame, as (object, new position) pairs. Frame i's
+    // moves are in [moveStart[i], moveStart[i+1]).
+    std::vector<uint32> moveStart;
+    std::vector<uint32> moveObject;
+    std::vector<Vector3f> movePosition;
+};
+
+PlannerPriorityBenchmark::PlannerPriorityBenchmark(const FinishedCallback& finished_cb, const String& param)
+        : Benchmark(finished_cb),
+          mForceStop(false)
+{
+    OptionValue* objects;
+    OptionValue* budget;
+    OptionValue* frames;
+    OptionValue* moved;
+    OptionValue* camera_threshold;
+    Sirikata::InitializeClassOptions ico("PlannerPriorityBenchmark",this,
+        objects=new OptionValue("objects","50000",Sirikata::OptionValueType<uint32>(),"Number of objects in the scene"),
+        budget=new OptionValue("budget","2000",Sirikata::OptionValueType<uint32>(),"Maximum number of loaded objects"),
+        frames=new OptionValue("frames","300",Sirikata::OptionValueType<uint32>(),"Number of frames to simulate"),
+        moved=new OptionValue("moved","0.01",Sirikata::OptionValueType<float32>(),"Fraction of objects that move each frame"),
+        camera_threshold=new OptionValue("camera-threshold","0",Sirikata::OptionValueType<float32>(),"Distance the camera moves before all priorities are recomputed"),
+        NULL);
+
+    OptionSet* optionsSet = OptionSet::getOptions("PlannerPriorityBenchmark",this);
+    optionsSet->parse(param);
+
+    mObjects = objects->as<uint32>();
+    mBudget = budget->as<uint32>();
+    mFrames = frames->as<uint32>();
+    mMovedFraction = moved->as<float32>();
+    mCameraThreshold = camera_threshold->as<float32>();
+}
+
+String PlannerPriorityBenchmark::name() {
+    return "planner-priority";
+}
+
+void PlannerPriorityBenchmark::generateScene(Scene* scene) {
+    float32 half = WorldSize / 2.f;
+    scene->positions.resize(mObjects);
+    scene->radii.resize(mObjects);
+    for(uint32 i = 0; i < mObjects; i++) {
+        scene->positions[i] = Vector3f(randFloat(-half, half), randFloat(-half, half), randFloat(-half, half));
+        scene->radii[i] = randFloat(0.5f, 20.f);
+    }
+
+    // The camera wanders slowly, about a unit per frame
+    Vector3d camera(0, 0, 0);
+    uint32 moved_per_frame = (uint32)(mMovedFraction * mObjects);
+    for(uint32 f = 0; f < mFrames; f++) {
+        camera += Vector3d(randFloat(-1.f, 1.f), randFloat(-1.f, 1.f), randFloat(-1.f, 1.f));
+        scene->cameras.push_back(camera);
+
+        scene->moveStart.push_back(scene->moveObject.size());
+        for(uint32 m = 0; m < moved_per_frame; m++) {
+            uint32 obj = randInt<uint32>(0, mObjects-1);
+            scene->moveObject.push_back(obj);
+            scene->movePosition.push_back(
+                scene->positions[obj] + Vector3f(randFloat(-5.f, 5.f), randFloat(-5.f, 5.f), randFloat(-5.f, 5.f))
+            );
+        }
+    }
+    scene->moveStart.push_back(scene->moveObject.size());
+}
+
+namespace {
+
+struct MapObject {
+    uint32 index;
+    Vector3f position;
+    float32 radius;
+    float32 priority;
+    bool loaded;
+};
+
+struct MaxHeapComparator {
+    bool operator()(MapObject* lhs, MapObject* rhs) {
+        return lhs->priority < rhs->priority;
+    }
+};
+struct MinHeapComparator {
+    bool operator()(MapObject* lhs, MapObject* rhs) {
+        return lhs->priority > rhs->priority;
+    }
+};
+
+} // namespace
+
+bool PlannerPriorityBenchmark::runMapHeap(const Scene& scene, std::vector<uint32>* loaded_out) {
+    typedef std::tr1::unordered_map<String, MapObject*> ObjectMap;
+    ObjectMap objects;
+    std::vector<MapObject*> by_index(mObjects);
+    for(uint32 i = 0; i < mObjects; i++) {
+        MapObject* obj = new MapObject();
+        obj->index = i;
+        obj->position = scene.positions[i];
+        obj->radius = scene.radii[i];
+        obj->priority = 0;
+        obj->loaded = false;
+        by_index[i] = obj;
+        objects[UUID::random().toString()] = obj;
+    }
+
+    uint32 loaded_count = 0;
+    uint64 swaps = 0;
+    Time start_time = Timer::now();
+    for(uint32 f = 0; f < mFrames && !mForceStop; f++) {
+        for(uint32 m = scene.moveStart[f]; m < scene.moveStart[f+1]; m++)
+            by_index[scene.moveObject[m]]->position = scene.movePosition[m];
+
+        const Vector3d& camera = scene.cameras[f];
+        float32 min_loaded = 1000000, max_waiting = 0;
+        for(ObjectMap::iterator it = objects.begin(); it != objects.end(); it++) {
+            MapObject* r = it->second;
+            r->priority = solidAnglePriority(camera, r->position, r->radius);
+            if (r->loaded)
+                min_loaded = std::min(min_loaded, r->priority);
+            else
+                max_waiting = std::max(max_waiting, r->priority);
+        }
+
+        if (min_loaded >= max_waiting && loaded_count >= mBudget)
+            continue;
+
+        std::vector<MapObject*> loaded_heap, waiting_heap;
+        for(ObjectMap::iterator it = objects.begin(); it != objects.end(); it++) {
+            if (it->second->loaded)
+                loaded_heap.push_back(it->second);
+            else
+                waiting_heap.push_back(it->second);
+        }
+        std::make_heap(loaded_heap.begin(), loaded_heap.end(), MinHeapComparator());
+        std::make_heap(waiting_heap.begin(), waiting_heap.end(), MaxHeapComparator());
+
+        while(true) {
+            if (loaded_count < mBudget && !waiting_heap.empty()) {
+                MapObject* max_w = waiting_heap.front();
+                std::pop_heap(waiting_heap.begin(), waiting_heap.end(), MaxHeapComparator());
+                waiting_heap.pop_back();
+                max_w->loaded = true;
+                loaded_count++;
+                swaps++;
+            }
+            else if (!waiting_heap.empty() && !loaded_heap.empty()) {
+                MapObject* max_w = waiting_heap.front();
+                std::pop_heap(waiting_heap.begin(), waiting_heap.end(), MaxHeapComparator());
+                waiting_heap.pop_back();
+                MapObject* min_l = loaded_heap.front();
+                std::pop_heap(loaded_heap.begin(), loaded_heap.end(), MinHeapComparator());
+                loaded_heap.pop_back();
+                if (min_l->priority < max_w->priority) {
+                    min_l->loaded = false;
+                    max_w->loaded = true;
+                    swaps += 2;
+                }
+                else {
+                    break;
+                }
+            }
+            else {
+                break;
+            }
+        }
+    }
+    Duration dur = Timer::now() - start_time;
+
+    for(uint32 i = 0; i < mObjects; i++) {
+        if (by_index[i]->loaded) loaded_out->push_back(i);
+        delete by_index[i];
+    }
+
+    if (mForceStop)
+        return false;
+    reportFrames("map + rebuilt heaps", mFrames, swaps, dur);
+    return true;
+}
+
+namespace {
+
+struct LoadedCompare {
+    LoadedCompare(const std::vector<float32>* p) : priorities(p) {}
+    bool operator()(uint32 lhs, uint32 rhs) const { return (*priorities)[lhs] > (*priorities)[rhs]; }
+    const std::vector<float32>* priorities;
+};
+struct WaitingCompare {
+    WaitingCompare(const std::vector<float32>* p) : priorities(p) {}
+    bool operator()(uint32 lhs, uint32 rhs) const { return (*priorities)[lhs] < (*priorities)[rhs]; }
+    const std::vector<float32>* priorities;
+};
+
+} // namespace
+
+bool PlannerPriorityBenchmark::runPacked(const Scene& scene, std::vector<uint32>* loaded_out) {
+    std::vector<float32> x(mObjects), y(mObjects), z(mObjects), radius(mObjects), priorities(mObjects);
+    for(uint32 i = 0; i < mObjects; i++) {
+        x[i] = scene.positions[i].x;
+        y[i] = scene.positions[i].y;
+        z[i] = scene.positions[i].z;
+        radius[i] = scene.radii[i];
+    }
+    IndexedHeap<LoadedCompare> loaded_heap((LoadedCompare(&priorities)));
+    IndexedHeap<WaitingCompare> waiting_heap((WaitingCompare(&priorities)));
+    for(uint32 i = 0; i < mObjects; i++)
+        waiting_heap.push(i);
+
+    std::vector<uint8> dirty(mObjects, 0);
+    std::vector<uint32> dirty_list;
+
+    bool first = true;
+    Vector3d last_camera;
+    uint32 full_updates = 0;
+    uint64 swaps = 0;
+    Time start_time = Timer::now();
+    for(uint32 f = 0; f < mFrames && !mForceStop; f++) {
+        for(uint32 m = scene.moveStart[f]; m < scene.moveStart[f+1]; m++) {
+            uint32 obj = scene.moveObject[m];
+            x[obj] = scene.movePosition[m].x;
+            y[obj] = scene.movePosition[m].y;
+            z[obj] = scene.movePosition[m].z;
+            if (!dirty[obj]) {
+                dirty[obj] = 1;
+                dirty_list.push_back(obj);
+            }
+        }
+
+        const Vector3d& camera = scene.cameras[f];
+        if (first || (camera - last_camera).length() > mCameraThreshold) {
+            PackedPriorities::solidAngle(Vector3f(camera), &x[0], &y[0], &z[0], &radius[0], mObjects, &priorities[0]);
+            loaded_heap.rebuild();
+            waiting_heap.rebuild();
+            for(std::vector<uint32>::iterator it = dirty_list.begin(); it != dirty_list.end(); it++)
+                dirty[*it] = 0;
+            first = false;
+            last_camera = camera;
+            full_updates++;
+        }
+        else {
+            Vector3f camera_f(last_camera);
+            for(std::vector<uint32>::iterator it = dirty_list.begin(); it != dirty_list.end(); it++) {
+                uint32 obj = *it;
+                dirty[obj] = 0;
+                PackedPriorities::solidAngle(camera_f, &x[obj], &y[obj], &z[obj], &radius[obj], 1, &priorities[obj]);
+                loaded_heap.update(obj);
+                waiting_heap.update(obj);
+            }
+        }
+        dirty_list.clear();
+
+        while(true) {
+            if (loaded_heap.size() < mBudget && !waiting_heap.empty()) {
+                loaded_heap.push(waiting_heap.pop());
+                swaps++;
+            }
+            else if (!waiting_heap.empty() && !loaded_heap.empty() &&
+                priorities[loaded_heap.top()] < priorities[waiting_heap.top()]) {
+                uint32 min_l = loaded_heap.pop();
+                uint32 max_w = waiting_heap.pop();
+                loaded_heap.push(max_w);
+                waiting_heap.push(min_l);
+                swaps += 2;
+            }
+            else {
+                break;
+            }
+        }
+    }
+    Duration dur = Timer::now() - start_time;
+
+    for(uint32 i = 0; i < mObjects; i++)
+        if (loaded_heap.contains(i)) loaded_out->push_back(i);
+
+    if (mForceStop)
+        return false;
+    reportFrames("packed + incremental heaps", mFrames, swaps, dur);
+    SILOG(benchmark,info, "packed + incremental heaps: " << full_updates << " full recomputes");
+    return true;
+}
+
+void PlannerPriorityBenchmark::start() {
+    mForceStop = false;
+
+    Scene scene;
+    generateScene(&scene);
+
+    std::vector<uint32> map_loaded, packed_loaded;
+    if (!runMapHeap(scene, &map_loaded))
+        return;
+    if (!runPacked(scene, &packed_loaded))
+        return;
+
+    // Float precision can break near-ties differently, so just report how
+    // closely the final loaded sets match.
+    std::vector<uint32> common;
+    std::set_intersection(
+        map_loaded.begin(), map_loaded.end(),
+        packed_loaded.begin(), packed_loaded.end(),
+        std::back_inserter(common)
+    );
+    SILOG(benchmark,info,
+          common.size() << " of " << map_loaded.size() << " loaded objects match");
+
+    notifyFinished();
+}
+
+void PlannerPriorityBenchmark::stop() {
+    mForceStop = true;
+}
+
+} // namespace Sirikata
@@ -0,0 +1,60 @@
+// Copyright (c) 2015 Sirikata Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can
+// be found in the LICENSE file.
+
+#ifndef _SIRIKATA_PLANNER_PRIORITY_BENCHMARK_HPP_
+#define _SIRIKATA_PLANNER_PRIORITY_BENCHMARK_HPP_
+
+#include "Benchmark.hpp"
+
+namespace Sirikata {
+
+/** Measure the per-frame cost of prioritizing objects for download the way
+ *  the Ogre PriorityDownloadPlanner does, without needing a renderer. Each
+ *  frame the camera takes a small step and some objects move, then the
+ *  solid angle priority of each object is updated and the set of objects
+ *  within the load budget is adjusted.
+ *
+ *  This is run twice: once recomputing every object through a hash map and
+ *  rebuilding heaps each frame, as the planner used to, and once with packed
+ *  arrays, batched priority computation and incrementally maintained heaps.
+ *
+ *  Parameters: --objects=<number of objects>
+ *              --budget=<max number of loaded objects>
+ *              --frames=<number of frames to simulate>
+ *              --moved=<fraction of objects that move each frame>
+ *              --camera-threshold=<camera movement before a full recompute>
+ */
+class PlannerPriorityBenchmark : public Benchmark {
+  public:
+    typedef std::tr1::function<void()> FinishedCallback;
+
+    static Benchmark* create(const FinishedCallback& finished_cb, const String& param) {
+        return new PlannerPriorityBenchmark(finished_cb, param);
+    }
+
+    PlannerPriorityBenchmark(const FinishedCallback& finished_cb, const String& param);
+
+    virtual String name();
+
+    virtual void start();
+    virtual void stop();
+
+  private:
+    struct Scene;
+
+    void generateScene(Scene* scene);
+    bool runMapHeap(const Scene& scene, std::vector<uint32>* loaded_out);
+    bool runPacked(const Scene& scene, std::vector<uint32>* loaded_out);
+
+    bool mForceStop;
+    uint32 mObjects;
+    uint32 mBudget;
+    uint32 mFrames;
+    float32 mMovedFraction;
+    float32 mCameraThreshold;
+}; // class PlannerPriorityBenchmark
+
+} // namespace Sirikata
+
+#endif //_SIRIKATA_PLANNER_PRIORITY_BENCHMARK_HPP_
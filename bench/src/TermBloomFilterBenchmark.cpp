@@ -0,0 +1,134 @@
+// Copyright (c) 2015 Sirikata Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can
+// be found in the LICENSE file.
+
+#include "TermBloomFilterBenchmark.hpp"
+#include <sirikata/core/util/Timer.hpp>
+#include <sirikata/core/options/Options.hpp>
+#include <sirikata/twitter/TermBloomFilter.hpp>
+
+namespace Sirikata {
+
+using Twitter::TermBloomFilter;
+using Twitter::TermHashes;
+
+namespace {
+
+void reportRate(const String& label, uint64 ops, const Duration& dur) {
+    SILOG(benchmark,info,
+          label << ": " << ops << " ops in " << dur << ", "
+          << (dur.toMicroseconds()*1000/float(ops)) << "ns/op");
+}
+
+} // namespace
+
+TermBloomFilterBenchmark::TermBloomFilterBenchmark(const FinishedCallback& finished_cb, const String& param)
+        : Benchmark(finished_cb),
+          mForceStop(false)
+{
+    OptionValue* buckets;
+    OptionValue* hashes;
+    OptionValue* filters;
+    OptionValue* terms;
+    OptionValue* iterations;
+    Sirikata::InitializeClassOptions ico("TermBloomFilterBenchmark",this,
+        buckets=new OptionValue("buckets","8192",Sirikata::OptionValueType<uint32>(),"Number of buckets in each filter"),
+        hashes=new OptionValue("hashes","4",Sirikata::OptionValueType<uint16>(),"Number of hash functions for each filter"),
+        filters=new OptionValue("filters","1024",Sirikata::OptionValueType<uint32>(),"Number of leaf filters"),
+        terms=new OptionValue("terms","16",Sirikata::OptionValueType<uint32>(),"Number of terms inserted into each leaf filter"),
+        iterations=new OptionValue("iterations","100",Sirikata::OptionValueType<uint32>(),"Number of passes over the filters"),
+        NULL);
+
+    OptionSet* optionsSet = OptionSet::getOptions("TermBloomFilterBenchmark",this);
+    optionsSet->parse(param);
+
+    mBuckets = buckets->as<uint32>();
+    mHashes = hashes->as<uint16>();
+    mFilters = filters->as<uint32>();
+    mTerms = terms->as<uint32>();
+    mIterations = iterations->as<uint32>();
+}
+
+String TermBloomFilterBenchmark::name() {
+    return "term-bloom-filter";
+}
+
+void TermBloomFilterBenchmark::start() {
+    mForceStop = false;
+
+    // Leaf filters, each with its own set of terms
+    std::vector<TermBloomFilter> leaves;
+    leaves.reserve(mFilters);
+    for(uint32 fi = 0; fi < mFilters; fi++) {
+        leaves.push_back(TermBloomFilter(mBuckets, mHashes));
+        for(uint32 ti = 0; ti < mTerms; ti++) {
+            std::ostringstream term;
+            term << "term" << (fi * mTerms + ti);
+            leaves.back().insert(term.str());
+        }
+    }
+
+    // Merge everything into an aggregate, as happens when rebuilding the
+    // upper levels of a tree
+    Time start_time = Timer::now();
+    TermBloomFilter aggregate(mBuckets, mHashes);
+    for(uint32 iter = 0; iter < mIterations && !mForceStop; iter++) {
+        aggregate = leaves[0];
+        for(uint32 fi = 1; fi < mFilters; fi++)
+            aggregate.mergeIn(leaves[fi]);
+    }
+    Duration merge_dur = Timer::now() - start_time;
+
+    // Verify children against the aggregate, as verifyChild does
+    start_time = Timer::now();
+    uint32 subsets = 0;
+    for(uint32 iter = 0; iter < mIterations && !mForceStop; iter++) {
+        for(uint32 fi = 0; fi < mFilters; fi++)
+            if (leaves[fi].subsetOf(aggregate)) subsets++;
+    }
+    Duration subset_dur = Timer::now() - start_time;
+
+    // Check a single query term against every filter, as a query does when
+    // it's evaluated against each node of a tree
+    String query_term("term0");
+    start_time = Timer::now();
+    uint32 uncached_hits = 0;
+    for(uint32 iter = 0; iter < mIterations && !mForceStop; iter++) {
+        for(uint32 fi = 0; fi < mFilters; fi++)
+            if (leaves[fi].lookup(query_term)) uncached_hits++;
+    }
+    Duration uncached_dur = Timer::now() - start_time;
+
+    start_time = Timer::now();
+    TermHashes query_hashes;
+    uint32 cached_hits = 0;
+    for(uint32 iter = 0; iter < mIterations && !mForceStop; iter++) {
+        for(uint32 fi = 0; fi < mFilters; fi++)
+            if (leaves[fi].lookup(query_term, &query_hashes)) cached_hits++;
+    }
+    Duration cached_dur = Timer::now() - start_time;
+
+    if (mForceStop)
+        return;
+
+    uint64 ops = (uint64)mFilters * mIterations;
+    SILOG(benchmark,info,
+          mFilters << " filters, " << mBuckets << " buckets, " << mHashes
+          << " hashes, " << aggregate.count() << " buckets set in aggregate");
+    reportRate("merge", ops, merge_dur);
+    reportRate("subset", ops, subset_dur);
+    reportRate("lookup", ops, uncached_dur);
+    reportRate("cached lookup", ops, cached_dur);
+    if (subsets != ops)
+        SILOG(benchmark,error,"Found leaf filter which isn't a subset of the aggregate");
+    if (cached_hits != uncached_hits)
+        SILOG(benchmark,error,"Cached and uncached lookups disagree");
+
+    notifyFinished();
+}
+
+void TermBloomFilterBenchmark::stop() {
+    mForceStop = true;
+}
+
+} // namespace Sirikata
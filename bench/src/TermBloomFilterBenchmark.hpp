@@ -0,0 +1,48 @@
+// Copyright (c) 2015 Sirikata Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can
+// be found in the LICENSE file.
+
+#ifndef _SIRIKATA_TERM_BLOOM_FILTER_BENCHMARK_HPP_
+#define _SIRIKATA_TERM_BLOOM_FILTER_BENCHMARK_HPP_
+
+#include "Benchmark.hpp"
+
+namespace Sirikata {
+
+/** Measure the TermBloomFilter operations term-region queries spend their time
+ *  in: merging child filters into aggregates, subset checks between children
+ *  and parents, and term lookups with and without cached term hashes.
+ *
+ *  Parameters: --buckets=<buckets per filter>
+ *              --hashes=<hash functions per filter>
+ *              --filters=<number of leaf filters>
+ *              --terms=<terms inserted per leaf filter>
+ *              --iterations=<passes over the filters>
+ */
+class TermBloomFilterBenchmark : public Benchmark {
+  public:
+    typedef std::tr1::function<void()> FinishedCallback;
+
+    static Benchmark* create(const FinishedCallback& finished_cb, const String& param) {
+        return new TermBloomFilterBenchmark(finished_cb, param);
+    }
+
+    TermBloomFilterBenchmark(const FinishedCallback& finished_cb, const String& param);
+
+    virtual String name();
+
+    virtual void start();
+    virtual void stop();
+
+  private:
+    bool mForceStop;
+    uint32 mBuckets;
+    uint16 mHashes;
+    uint32 mFilters;
+    uint32 mTerms;
+    uint32 mIterations;
+}; // class TermBloomFilterBenchmark
+
+} // namespace Sirikata
+
+#endif //_SIRIKATA_TERM_BLOOM_FILTER_BENCHMARK_HPP_
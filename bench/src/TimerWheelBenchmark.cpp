@@ -0,0 +1,129 @@
+// Copyright (c) 2015 Sirikata Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can
+// be found in the LICENSE file.
+
+#include "TimerWheelBenchmark.hpp"
+#include <sirikata/core/network/IOService.hpp>
+#include <sirikata/core/util/Timer.hpp>
+#include <sirikata/core/util/Random.hpp>
+#include <sirikata/core/options/Options.hpp>
+
+namespace Sirikata {
+
+namespace {
+
+void reportRate(const String& label, uint64 ops, const Duration& dur) {
+    SILOG(benchmark,info,
+          label << ": " << ops << " ops in " << dur << ", "
+          << (dur.toMicroseconds()*1000/float(ops)) << "ns/op");
+}
+
+} // namespace
+
+TimerWheelBenchmark::TimerWheelBenchmark(const FinishedCallback& finished_cb, const String& param)
+        : Benchmark(finished_cb),
+          mForceStop(false),
+          mIOService(NULL),
+          mFired(0),
+          mOutstanding(0)
+{
+    OptionValue* timers;
+    OptionValue* max_wait;
+    Sirikata::InitializeClassOptions ico("TimerWheelBenchmark",this,
+        timers=new OptionValue("timers","1000000",Sirikata::OptionValueType<uint32>(),"Number of outstanding timers"),
+        max_wait=new OptionValue("max-wait","5s",Sirikata::OptionValueType<Duration>(),"Longest timeout. Timeouts are uniformly distributed up to this."),
+        NULL);
+
+    OptionSet* optionsSet = OptionSet::getOptions("TimerWheelBenchmark",this);
+    optionsSet->parse(param);
+
+    mTimers = timers->as<uint32>();
+    mMaxWait = max_wait->as<Duration>();
+}
+
+String TimerWheelBenchmark::name() {
+    return "timer-wheel";
+}
+
+void TimerWheelBenchmark::handleTimeout(const Time& expected) {
+    mTotalLateness += Timer::now() - expected;
+    mFired++;
+    mOutstanding--;
+}
+
+bool TimerWheelBenchmark::runTimers(const String& label, bool use_iotimers) {
+    mIOService = new Network::IOService("TimerWheelBenchmark");
+    mFired = 0;
+    mOutstanding = 0;
+    mTotalLateness = Duration::zero();
+
+    int64 max_wait_us = mMaxWait.toMicroseconds();
+    std::vector<Network::IOTimerPtr> iotimers;
+    if (use_iotimers) iotimers.reserve(mTimers);
+
+    Time start_time = Timer::now();
+    for(uint32 i = 0; i < mTimers; i++) {
+        Duration wait = Duration::microseconds(randInt<int64>(0, max_wait_us));
+        Network::IOCallback cb = std::tr1::bind(&TimerWheelBenchmark::handleTimeout, this, Timer::now() + wait);
+        if (use_iotimers) {
+            iotimers.push_back(Network::IOTimer::create(mIOService, cb));
+            iotimers.back()->wait(wait);
+        }
+        else {
+            mIOService->post(wait, cb, "TimerWheelBenchmark");
+        }
+    }
+    Duration schedule_dur = Timer::now() - start_time;
+    mOutstanding = mTimers;
+
+    // Cancel every other IOTimer, like acks cancelling retries
+    Duration cancel_dur;
+    if (use_iotimers) {
+        start_time = Timer::now();
+        for(uint32 i = 0; i < mTimers; i += 2)
+            mOutstanding -= iotimers[i]->cancel();
+        cancel_dur = Timer::now() - start_time;
+    }
+
+    uint32 expected = mOutstanding;
+    start_time = Timer::now();
+    mIOService->run();
+    Duration run_dur = Timer::now() - start_time;
+
+    iotimers.clear();
+    delete mIOService;
+    mIOService = NULL;
+
+    if (mForceStop)
+        return false;
+
+    reportRate(label + " schedule", mTimers, schedule_dur);
+    if (use_iotimers)
+        reportRate(label + " cancel", (mTimers+1)/2, cancel_dur);
+    SILOG(benchmark,info,
+          label << ": " << mFired << " timers fired over " << run_dur << ", "
+          << (mFired > 0 ? mTotalLateness / (double)mFired : Duration::zero())
+          << " average lateness");
+    if (mFired != expected)
+        SILOG(benchmark,error,label << ": expected " << expected << " timers to fire, saw " << mFired);
+    return true;
+}
+
+void TimerWheelBenchmark::start() {
+    mForceStop = false;
+
+    if (!runTimers("post", false))
+        return;
+    if (!runTimers("iotimer", true))
+        return;
+
+    notifyFinished();
+}
+
+void TimerWheelBenchmark::stop() {
+    mForceStop = true;
+    if (mIOService != NULL)
+        mIOService->stop();
+}
+
+} // namespace Sirikata
@@ -0,0 +1,53 @@
+// Copyright (c) 2015 Sirikata Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can
+// be found in the LICENSE file.
+
+#ifndef _SIRIKATA_TIMER_WHEEL_BENCHMARK_HPP_
+#define _SIRIKATA_TIMER_WHEEL_BENCHMARK_HPP_
+
+#include "Benchmark.hpp"
+#include <sirikata/core/network/IOTimer.hpp>
+
+namespace Sirikata {
+
+/** Measure the cost of keeping a very large number of timers outstanding on a
+ *  single IOService, as happens with per-object retry timers. Timers are
+ *  posted with IOService::post(Duration, ...), then the same number of
+ *  IOTimers are started and half of them cancelled, as acks would cancel
+ *  retries.
+ *
+ *  Parameters: --timers=<number of outstanding timers>
+ *              --max-wait=<longest timeout, timeouts are uniform up to this>
+ */
+class TimerWheelBenchmark : public Benchmark {
+  public:
+    typedef std::tr1::function<void()> FinishedCallback;
+
+    static Benchmark* create(const FinishedCallback& finished_cb, const String& param) {
+        return new TimerWheelBenchmark(finished_cb, param);
+    }
+
+    TimerWheelBenchmark(const FinishedCallback& finished_cb, const String& param);
+
+    virtual String name();
+
+    virtual void start();
+    virtual void stop();
+
+  private:
+    void handleTimeout(const Time& expected);
+    bool runTimers(const String& label, bool use_iotimers);
+
+    bool mForceStop;
+    uint32 mTimers;
+    Duration mMaxWait;
+
+    Network::IOService* mIOService;
+    uint32 mFired;
+    uint32 mOutstanding;
+    Duration mTotalLateness;
+}; // class TimerWheelBenchmark
+
+} // namespace Sirikata
+
+#endif //_SIRIKATA_TIMER_WHEEL_BENCHMARK_HPP_
@@ -37,6 +37,11 @@
 #include "TimerMonotonicityBenchmark.hpp"
 #include "TCPSSTBenchmark.hpp"
 #include "UUIDSpeedBenchmark.hpp"
+#include "ArithmeticCoderBenchmark.hpp"
+#include "TermBloomFilterBenchmark.hpp"
+#include "TimerWheelBenchmark.hpp"
+#include "PlannerPriorityBenchmark.hpp"
+#include "ColladaImportBenchmark.hpp"
 
 #include <sirikata/core/util/DynamicLibrary.hpp>
 
@@ -66,11 +71,20 @@ int main(int argc, char** argv) {
     ADD_BENCHMARK(timer-speed, TimerSpeedBenchmark::create);
     ADD_BENCHMARK(timer-jitter, TimerJitterBenchmark::create);
     ADD_BENCHMARK(timer-monotonicity, TimerMonotonicityBenchmark::create);
+    ADD_BENCHMARK(timer-wheel, TimerWheelBenchmark::create);
 
     ADD_BENCHMARK(ping, SSTBenchmark::create);
 
     ADD_BENCHMARK(uuid-create, UUIDSpeedBenchmark::create);
 
+    ADD_BENCHMARK(arithmetic-coder, ArithmeticCoderBenchmark::create);
+
+    ADD_BENCHMARK(term-bloom-filter, TermBloomFilterBenchmark::create);
+
+    ADD_BENCHMARK(planner-priority, PlannerPriorityBenchmark::create);
+
+    ADD_BENCHMARK(collada-import, ColladaImportBenchmark::create);
+
     BenchmarkRunner runner(factory, Duration::seconds(30.f));
 
 
@@ -15,6 +15,12 @@
  * Suspension is not currently supported in this module.
  */
 #include "Reader.hpp"
+#include <cstring>
+
+/* Compact packing of Table D.2 (Qe value and estimation state machine),
+ * see ArithmeticCoder.cpp for the layout. */
+extern SIRIKATA_EXPORT const int32_t jpeg_aritab[113+1];
+
 namespace Sirikata {
 class DecoderWriter;
 class DecoderReader;
@@ -46,7 +52,245 @@ public:
     void finish_encode(DecoderWriter *output);
     bool arith_decode(DecoderReader *input, unsigned char *state);
 
+    /**
+     * Generic versions of the coding routines, parameterized on where the
+     * bytes go to or come from so the byte handling can be inlined.
+     * A ByteSink must provide emit_byte(int) and emit_zeros(int count).
+     * A ByteSource must provide get_byte(), which behaves like a plain read
+     * of the next byte, and next_plain_byte(int&), which may return the next
+     * byte directly if it is known not to be 0xFF (return false otherwise).
+     */
+    template <class ByteSink> void encode(ByteSink &sink, unsigned char *state, bool value);
+    template <class ByteSink> void finish(ByteSink &sink);
+    template <class ByteSource> bool decode(ByteSource &source, unsigned char *state);
+private:
+    template <class ByteSink> void emit_pending_zeros(ByteSink &sink) {
+        if (zc) {
+            sink.emit_zeros(zc);
+            zc = 0;
+        }
+    }
+    template <class ByteSink> void emit_stacked_ff(ByteSink &sink) {
+        do {
+            sink.emit_byte(0xFF);
+            sink.emit_byte(0x00);
+        } while (--sc);
+    }
 };
+
+/*
+ * The core arithmetic encoding routine (common in JPEG and JBIG).
+ * See ArithmeticCoder.cpp for the notes on termination and the
+ * probability estimation table.
+ */
+template <class ByteSink> inline void ArithmeticCoder::encode(ByteSink &sink, unsigned char *st, bool val) {
+  unsigned char nl, nm;
+  int32_t qe, temp;
+  int sv;
+
+  /* Fetch values from our compact representation of Table D.2:
+   * Qe values and probability estimation state machine
+   */
+  sv = *st;
+  qe = jpeg_aritab[sv & 0x7F];  /* => Qe_Value */
+  nl = qe & 0xFF; qe >>= 8;     /* Next_Index_LPS + Switch_MPS */
+  nm = qe & 0xFF; qe >>= 8;     /* Next_Index_MPS */
+
+  /* Encode & estimation procedures per sections D.1.4 & D.1.5 */
+  a -= qe;
+  if (val != (sv >> 7)) {
+    /* Encode the less probable symbol */
+    if (a >= qe) {
+      /* If the interval size (qe) for the less probable symbol (LPS)
+       * is larger than the interval size for the MPS, then exchange
+       * the two symbols for coding efficiency, otherwise code the LPS
+       * as usual: */
+      c += a;
+      a = qe;
+    }
+    *st = (sv & 0x80) ^ nl;     /* Estimate_after_LPS */
+  } else {
+    /* Encode the more probable symbol */
+    if (a >= 0x8000L)
+      return;  /* A >= 0x8000 -> ready, no renormalization required */
+    if (a < qe) {
+      /* If the interval size (qe) for the less probable symbol (LPS)
+       * is larger than the interval size for the MPS, then exchange
+       * the two symbols for coding efficiency: */
+      c += a;
+      a = qe;
+    }
+    *st = (sv & 0x80) ^ nm;     /* Estimate_after_MPS */
+  }
+
+  /* Renormalization & data output per section D.1.6 */
+  do {
+    a <<= 1;
+    c <<= 1;
+    if (--ct == 0) {
+      /* Another byte is ready for output */
+      temp = c >> 19;
+      if (temp > 0xFF) {
+        /* Handle overflow over all stacked 0xFF bytes */
+        if (buffer >= 0) {
+          emit_pending_zeros(sink);
+          sink.emit_byte(buffer + 1);
+          if (buffer + 1 == 0xFF)
+            sink.emit_byte(0x00);
+        }
+        zc += sc;  /* carry-over converts stacked 0xFF bytes to 0x00 */
+        sc = 0;
+        /* Note: The 3 spacer bits in the C register guarantee
+         * that the new buffer byte can't be 0xFF here
+         * (see page 160 in the P&M JPEG book). */
+        buffer = temp & 0xFF;  /* new output byte, might overflow later */
+      } else if (temp == 0xFF) {
+        ++sc;  /* stack 0xFF byte (which might overflow later) */
+      } else {
+        /* Output all stacked 0xFF bytes, they will not overflow any more */
+        if (buffer == 0)
+          ++zc;
+        else if (buffer >= 0) {
+          emit_pending_zeros(sink);
+          sink.emit_byte(buffer);
+        }
+        if (sc) {
+          emit_pending_zeros(sink);
+          emit_stacked_ff(sink);
+        }
+        buffer = temp & 0xFF;  /* new output byte (can still overflow) */
+      }
+      c &= 0x7FFFFL;
+      ct += 8;
+    }
+  } while (a < 0x8000L);
+}
+
+template <class ByteSink> inline void ArithmeticCoder::finish(ByteSink &sink) {
+  int32_t temp;
+
+  /* Section D.1.8: Termination of encoding */
+
+  /* Find the c in the coding interval with the largest
+   * number of trailing zero bits */
+  if ((temp = (a - 1 + c) & 0xFFFF0000L) < c)
+    c = temp + 0x8000L;
+  else
+    c = temp;
+  /* Send remaining bytes to output */
+  c <<= ct;
+  if (c & 0xF8000000L) {
+    /* One final overflow has to be handled */
+    if (buffer >= 0) {
+      emit_pending_zeros(sink);
+      sink.emit_byte(buffer + 1);
+      if (buffer + 1 == 0xFF)
+        sink.emit_byte(0x00);
+    }
+    zc += sc;  /* carry-over converts stacked 0xFF bytes to 0x00 */
+    sc = 0;
+  } else {
+    if (buffer == 0)
+      ++zc;
+    else if (buffer >= 0) {
+      emit_pending_zeros(sink);
+      sink.emit_byte(buffer);
+    }
+    if (sc) {
+      emit_pending_zeros(sink);
+      emit_stacked_ff(sink);
+    }
+  }
+  /* Output final bytes only if they are not 0x00 */
+  if (c & 0x7FFF800L) {
+    emit_pending_zeros(sink); /* output final pending zero bytes */
+    sink.emit_byte((c >> 19) & 0xFF);
+    if (((c >> 19) & 0xFF) == 0xFF)
+      sink.emit_byte(0x00);
+    if (c & 0x7F800L) {
+      sink.emit_byte((c >> 11) & 0xFF);
+      if (((c >> 11) & 0xFF) == 0xFF)
+        sink.emit_byte(0x00);
+    }
+  }
+}
+
+template <class ByteSource> inline bool ArithmeticCoder::decode(ByteSource &source, unsigned char *st) {
+  unsigned char nl, nm;
+  int32_t qe, temp;
+  int sv, data;
+
+  /* Renormalization & data input per section D.2.6 */
+  while (a < 0x8000L) {
+    if (--ct < 0) {
+      /* Need to fetch next data byte */
+      if (unread_marker)
+        data = 0;               /* stuff zero data */
+      else if (!source.next_plain_byte(data)) {
+        data = source.get_byte(); /* read next input byte */
+        if (data == 0xFF) {     /* zero stuff or marker code */
+          do data = source.get_byte();
+          while (data == 0xFF); /* swallow extra 0xFF bytes */
+          if (data == 0)
+            data = 0xFF;        /* discard stuffed zero byte */
+          else {
+            /* Note: Different from the Huffman decoder, hitting
+             * a marker while processing the compressed data
+             * segment is legal in arithmetic coding.
+             * The convention is to supply zero data
+             * then until decoding is complete.
+             */
+            unread_marker = data;
+            data = 0;
+          }
+        }
+      }
+      c = (c << 8) | data; /* insert data into C register */
+      if ((ct += 8) < 0)      /* update bit shift counter */
+        /* Need more initial bytes */
+        if (++ct == 0)
+          /* Got 2 initial bytes -> re-init A and exit loop */
+          a = 0x8000L; /* => a = 0x10000L after loop exit */
+    }
+    a <<= 1;
+  }
+
+  /* Fetch values from our compact representation of Table D.2:
+   * Qe values and probability estimation state machine
+   */
+  sv = *st;
+  qe = jpeg_aritab[sv & 0x7F];  /* => Qe_Value */
+  nl = qe & 0xFF; qe >>= 8;     /* Next_Index_LPS + Switch_MPS */
+  nm = qe & 0xFF; qe >>= 8;     /* Next_Index_MPS */
+
+  /* Decode & estimation procedures per sections D.2.4 & D.2.5 */
+  temp = a - qe;
+  a = temp;
+  temp <<= ct;
+  if (c >= temp) {
+    c -= temp;
+    /* Conditional LPS (less probable symbol) exchange */
+    if (a < qe) {
+      a = qe;
+      *st = (sv & 0x80) ^ nm;   /* Estimate_after_MPS */
+    } else {
+      a = qe;
+      *st = (sv & 0x80) ^ nl;   /* Estimate_after_LPS */
+      sv ^= 0x80;               /* Exchange LPS/MPS */
+    }
+  } else if (a < 0x8000L) {
+    /* Conditional MPS (more probable symbol) exchange */
+    if (a < qe) {
+      *st = (sv & 0x80) ^ nl;   /* Estimate_after_LPS */
+      sv ^= 0x80;               /* Exchange LPS/MPS */
+    } else {
+      *st = (sv & 0x80) ^ nm;   /* Estimate_after_MPS */
+    }
+  }
+
+  return sv >> 7;
+}
+
 class SIRIKATA_EXPORT ArithmeticWriter : ArithmeticCoder {
     DecoderWriter *mBase;
 public:
@@ -71,4 +315,140 @@ public:
         return arith_decode(mBase, state);
     }
 };
+
+/**
+ * Block buffered variant of ArithmeticWriter: output bytes are collected in
+ * a fixed buffer and handed to the underlying DecoderWriter bufferSize bytes
+ * at a time rather than with one virtual Write per byte.
+ * Produces exactly the same stream as ArithmeticWriter.
+ * Nothing reaches the base writer until the buffer fills or Finish() is called.
+ */
+template<uint32_t bufferSize> class BufferedArithmeticWriter : ArithmeticCoder {
+    class Sink {
+        uint8_t *mOffset;
+        DecoderWriter *mBase;
+        JpegError mError;
+        uint8_t mBuffer[bufferSize];
+    public:
+        Sink(DecoderWriter *base) {
+            mBase = base;
+            mOffset = mBuffer;
+        }
+        void emit_byte(int byte_data) {
+            if (mOffset == mBuffer + bufferSize) {
+                flush();
+            }
+            *mOffset++ = (uint8_t)byte_data;
+        }
+        void emit_zeros(int count) {
+            while (count) {
+                if (mOffset == mBuffer + bufferSize) {
+                    flush();
+                }
+                uint32_t toWrite = std::min((uint32_t)count,
+                                            (uint32_t)(mBuffer + bufferSize - mOffset));
+                memset(mOffset, 0, toWrite);
+                mOffset += toWrite;
+                count -= toWrite;
+            }
+        }
+        void flush() {
+            if (mOffset != mBuffer) {
+                std::pair<uint32, JpegError> retval = mBase->Write(mBuffer, mOffset - mBuffer);
+                if (retval.second != JpegError::nil() && mError == JpegError::nil()) {
+                    mError = retval.second;
+                }
+                mOffset = mBuffer;
+            }
+        }
+        JpegError error() const {
+            return mError;
+        }
+    } mSink;
+public:
+    BufferedArithmeticWriter(DecoderWriter *writer) : ArithmeticCoder(true), mSink(writer) {
+    }
+    void WriteBit(unsigned char *state, bool value) {
+        encode(mSink, state, value);
+    }
+    /// Terminates the arithmetic coded segment and flushes the buffer.
+    void Finish() {
+        finish(mSink);
+        mSink.flush();
+    }
+    /// The first error reported by the underlying writer, if any.
+    JpegError error() const {
+        return mSink.error();
+    }
+};
+
+/**
+ * Block buffered variant of ArithmeticReader. Input is fetched bufferSize
+ * bytes at a time, and the position of the next 0xFF in the buffer is
+ * tracked so that runs of ordinary bytes skip the marker/stuffing checks.
+ * Note this reads ahead of the coded segment: bytes that were fetched but
+ * not consumed by the decoder are available through unconsumed().
+ */
+template<uint32_t bufferSize> class BufferedArithmeticReader : ArithmeticCoder {
+    class Source {
+        const uint8_t *mOffset;
+        const uint8_t *mEnd;
+        const uint8_t *mRunEnd; // first 0xFF at or after mOffset, or mEnd
+        DecoderReader *mBase;
+        int mNumBad;
+        uint8_t mBuffer[bufferSize];
+        void find_run_end() {
+            const uint8_t *ff = (const uint8_t*)memchr(mOffset, 0xFF, mEnd - mOffset);
+            mRunEnd = ff ? ff : mEnd;
+        }
+    public:
+        Source(DecoderReader *base) {
+            mBase = base;
+            mOffset = mEnd = mRunEnd = mBuffer;
+            mNumBad = 0;
+        }
+        bool next_plain_byte(int &data) {
+            if (mOffset < mRunEnd) {
+                data = *mOffset++;
+                return true;
+            }
+            return false;
+        }
+        int get_byte() {
+            if (mOffset == mEnd) {
+                std::pair<uint32, JpegError> x = mBase->Read(mBuffer, bufferSize);
+                if (x.first == 0 || x.second != JpegError::nil()) {
+                    // Same convention as the unbuffered reader: feed a
+                    // terminating marker once the input runs dry.
+                    mOffset = mEnd = mRunEnd = mBuffer;
+                    if (mNumBad++ % 2 == 0) {
+                        return 0xff;
+                    }
+                    return 0xd9;
+                }
+                mOffset = mBuffer;
+                mEnd = mBuffer + x.first;
+                find_run_end();
+            }
+            int data = *mOffset++;
+            if (mOffset > mRunEnd) {
+                find_run_end();
+            }
+            return data;
+        }
+        std::pair<const uint8_t*, const uint8_t*> unconsumed() const {
+            return std::pair<const uint8_t*, const uint8_t*>(mOffset, mEnd);
+        }
+    } mSource;
+public:
+    BufferedArithmeticReader(DecoderReader *reader) : ArithmeticCoder(false), mSource(reader) {
+    }
+    bool ReadBit(unsigned char *state) {
+        return decode(mSource, state);
+    }
+    /// The [begin, end) range of bytes read from the base reader but not yet decoded.
+    std::pair<const uint8_t*, const uint8_t*> unconsumed() const {
+        return mSource.unconsumed();
+    }
+};
 }
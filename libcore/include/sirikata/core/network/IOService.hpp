@@ -55,11 +55,11 @@ namespace Network {
  */
 class SIRIKATA_EXPORT IOService : public Noncopyable {
     InternalIOService* mImpl;
+    // Backs all timed events (post(Duration, ...), IOStrand, IOTimer)
+    TimerWheel* mTimerWheel;
     const String mName;
 
 #ifdef SIRIKATA_TRACK_EVENT_QUEUES
-    typedef std::tr1::function<void(const boost::system::error_code& e)> IOCallbackWithError;
-
     // Track all strands that have been allocated. This needs to be
     // thread safe.
     typedef boost::mutex Mutex;
@@ -97,7 +97,7 @@ class SIRIKATA_EXPORT IOService : public Noncopyable {
     friend class IOStrand;
 
 #ifdef SIRIKATA_TRACK_EVENT_QUEUES
-    void decrementTimerCount(const boost::system::error_code&e, const Time& start, const Duration& timer_duration, const IOCallbackWithError& cb, const char* tag, const char* tagStat=NULL);
+    void decrementTimerCount(const Time& start, const Duration& timer_duration, const IOCallback& cb, const char* tag, const char* tagStat=NULL);
     void decrementCount(const Time& start, const IOCallback& cb, const char* tag, const char* tagStat=NULL);
 
     // Used to get let us add a record of a strand dispatch/post and provide a
@@ -124,6 +124,10 @@ class SIRIKATA_EXPORT IOService : public Noncopyable {
     friend class DeadlineTimer;
     friend class IOTimer;
 
+    TimerWheel& timerWheel() {
+        return *mTimerWheel;
+    }
+
 public:
 
 
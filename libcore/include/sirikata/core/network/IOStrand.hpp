@@ -37,6 +37,7 @@
 #include <sirikata/core/util/AtomicTypes.hpp>
 #include <sirikata/core/util/Noncopyable.hpp>
 #include <sirikata/core/trace/WindowedStats.hpp>
+#include <sirikata/core/trace/LatencyHistogram.hpp>
 #include <sirikata/core/task/Time.hpp>
 #include <boost/thread.hpp>
 
@@ -83,6 +84,12 @@ class SIRIKATA_EXPORT IOStrand : public Noncopyable {
     TagCountMap mTagCounts;
 #endif
 
+    // Optional profiling of posted handlers, see enableProfiling. The
+    // histograms are only set up front, the flag can be toggled at any time.
+    Trace::LatencyHistogramPtr mQueueDelayHistogram;
+    Trace::TaggedLatencyHistogramsPtr mHandlerHistograms;
+    AtomicValue<bool> mProfilingEnabled;
+
     friend class IOService;
 
     /** Construct an IOStrand associated with the given IOService. */
@@ -93,6 +100,10 @@ class SIRIKATA_EXPORT IOStrand : public Noncopyable {
     void decrementCount(const Time& start, const IOCallback& cb, const char* tag);
 #endif
 
+    // The real implementation of post(handler, tag), after profiling
+    void post_impl(const IOCallback& handler, const char* tag);
+    static void profiledHandler(Trace::LatencyHistogramPtr queue_delay, Trace::TaggedLatencyHistogramsPtr handler_times, const Time& start, const IOCallback& cb, const char* tag);
+
   protected:
 
     friend class StrandTCPSocket;
@@ -147,6 +158,20 @@ class SIRIKATA_EXPORT IOStrand : public Noncopyable {
      */
     IOCallback wrap(const IOCallback& handler);
 
+    /** Enable profiling of handlers posted to this strand with
+     *  post(handler,tag). The time each handler spends waiting in the queue
+     *  is recorded in queue_delay and the time it takes to run is recorded in
+     *  handler_times, broken down by tag. This is not synchronized with post,
+     *  so it should be called before the strand is used by multiple threads.
+     *  If enabled is false, the histograms are attached but nothing is
+     *  recorded until setProfilingEnabled(true) is called.
+     */
+    void enableProfiling(Trace::LatencyHistogramPtr queue_delay, Trace::TaggedLatencyHistogramsPtr handler_times, bool enabled = true);
+    /** Turn recording into the histograms passed to enableProfiling on or
+     *  off. Safe to call at any time, from any thread.
+     */
+    void setProfilingEnabled(bool enabled);
+
 
     /** Wrap the given handler so that it will be handled in this strand.
      *  \param handler the handler which should be wrapped
@@ -34,6 +34,7 @@
 
 #include <sirikata/core/util/Platform.hpp>
 #include <sirikata/core/network/IODefs.hpp>
+#include <sirikata/core/network/TimerWheel.hpp>
 #include <sirikata/core/util/AtomicTypes.hpp>
 #include <sirikata/core/util/SerializationCheck.hpp>
 
@@ -57,13 +58,18 @@ typedef std::tr1::weak_ptr<IOTimer> IOTimerWPtr;
  *  don't have to deal with wrapping your own callbacks: they are guaranteed to
  *  be invoked from the strand you pass in.
  *
+ *  Timeouts are managed by the IOService's TimerWheel, so they are rounded up
+ *  to the wheel's tick and timers expiring in the same tick fire together.
+ *
  *  Note: Instances of this class should not be stored directly, instead they
  *  must be stored using a shared_ptr<IOTimer> (which is available as IOTimerPtr).
  *  In order to enforce this, you cannot allocate one directly -- instead you
  *  must use the static IOTimer::create() methods.
  */
 class SIRIKATA_EXPORT IOTimer : public std::tr1::enable_shared_from_this<IOTimer> {
-    DeadlineTimer *mTimer;
+    IOService* mService;
+    TimerWheel::Node mNode;
+    Time mExpiry;
     IOStrand* mStrand;
     IOCallback mFunc;
     SerializationCheck chk;
@@ -49,9 +49,16 @@ typedef uint32 ObjectMessagePort;
 #define OBJECT_PORT_PROXIMITY     2
 #define OBJECT_PORT_LOCATION      3
 #define OBJECT_PORT_TIMESYNC      4
+#define OBJECT_PORT_BULK_SESSION  5
+#define OBJECT_PORT_BULK_LOCATION 6
 #define OBJECT_SPACE_PORT         253
 #define OBJECT_PORT_PING          254
 
+// Maximum number of entries batched into a single message on the bulk ports.
+// Object hosts and space servers both batch up to these limits.
+#define MAX_BULK_SESSION_ENTRIES  256
+#define MAX_BULK_LOCATION_ENTRIES 256
+
 #define OBJECT_PORT_SYSTEM_RESERVED_MAX 1024
 #define OBJECT_PORT_SYSTEM_MAX 0xFFFFFFFF
 
@@ -85,6 +92,32 @@ SIRIKATA_FUNCTION_EXPORT void createObjectHostMessage(ObjectHostID source_server
 
 SIRIKATA_FUNCTION_EXPORT void createObjectHostMessage(ObjectHostID source_server, const UUID& src, ObjectMessagePort src_port, const UUID& dest, ObjectMessagePort dest_port, const std::string& payload, ObjectMessage* result);
 
+/** Serialize all of msg except its payload into result, followed by the field
+ *  header for a payload of payload_size bytes. Writing result followed by the
+ *  payload bytes produces a valid serialized ObjectMessage, so the payload
+ *  never has to be copied into the message. msg's own payload should be empty.
+ */
+SIRIKATA_FUNCTION_EXPORT void serializeObjectMessageHeader(const ObjectMessage& msg, uint32 payload_size, std::string* result);
+
+// Batches pack multiple serialized ObjectMessages into one chunk, each as a
+// length-delimited field with this number. ObjectMessage doesn't use the
+// field, so a plain ObjectMessage never starts with its key and receivers can
+// tell the two apart from the first byte.
+#define OBJECT_MESSAGE_BATCH_FIELD 15
+
+/** Append a message, given as the output of serializeObjectMessageHeader and
+ *  its payload, to a batch.
+ */
+SIRIKATA_FUNCTION_EXPORT void appendObjectMessageToBatch(const std::string& header, MemoryReference payload, std::string* batch);
+/** Check whether a chunk holds a batch of ObjectMessages rather than a single
+ *  one.
+ */
+SIRIKATA_FUNCTION_EXPORT bool isObjectMessageBatch(MemoryReference data);
+/** Extract the next serialized ObjectMessage from a batch, advancing batch past
+ *  it. Returns false at the end of the batch or if it is malformed.
+ */
+SIRIKATA_FUNCTION_EXPORT bool nextObjectMessageInBatch(MemoryReference* batch, MemoryReference* msg_out);
+
 
 } // namespace Sirikata
 
@@ -0,0 +1,149 @@
+// Copyright (c) 2015 Sirikata Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can
+// be found in the LICENSE file.
+
+#ifndef _SIRIKATA_TIMER_WHEEL_HPP_
+#define _SIRIKATA_TIMER_WHEEL_HPP_
+
+#include <sirikata/core/util/Platform.hpp>
+#include <sirikata/core/network/IODefs.hpp>
+#include <sirikata/core/util/Time.hpp>
+#include <sirikata/core/util/Noncopyable.hpp>
+#include <boost/thread.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+
+namespace Sirikata {
+namespace Network {
+
+/** TimerWheel is a hierarchical timer wheel which backs all timed events on an
+ *  IOService: IOService::post(Duration, ...), IOStrand::post(Duration, ...) and
+ *  IOTimer (and therefore Poller and PollingService).
+ *
+ *  Timeouts are rounded up to a fixed tick. All timers which expire in the
+ *  same tick are coalesced and fired from a single event, and only one
+ *  underlying asio deadline timer is armed per IOService regardless of how
+ *  many timers are outstanding. Scheduling and cancellation are constant time.
+ *
+ *  The wheel has 4 levels of 256 slots, so with the default 1ms tick a timer
+ *  lands directly in the lowest level if it expires within 256ms and is
+ *  cascaded down from the upper levels as time passes. Timeouts longer than
+ *  the top level covers (~50 days) are parked in the top level and cascaded
+ *  back up until they expire.
+ *
+ *  The wheel runs on the same UTC clock as asio's deadline timers rather than
+ *  Timer::now(), so adjustments to the synchronized time offset or local time
+ *  changes don't fire timers early or stall them.
+ *
+ *  When several timers expire in the same tick, each handler is posted to the
+ *  IOService separately so unrelated handlers can run in parallel on
+ *  multi-threaded services. A lone expired handler is invoked directly.
+ *  Handlers which need to run in a strand should be wrapped by that strand,
+ *  as they would be for a normal asio timer.
+ */
+class SIRIKATA_EXPORT TimerWheel : public Noncopyable {
+public:
+    /** A slot in the wheel. Users which need to cancel or reschedule timers
+     *  (i.e. IOTimer) embed a Node and pass it to schedule()/cancel(). The
+     *  Node must be cancelled before it is destroyed.
+     */
+    class Node {
+    public:
+        Node()
+         : mPrev(NULL), mNext(NULL), mDeadline(0), mLevel(0), mOwned(false)
+        {}
+
+        /** Returns true if the node is waiting in a wheel. Only stable when
+         *  checked by the owner while no other thread is touching the node.
+         */
+        bool scheduled() const { return mNext != NULL; }
+    private:
+        friend class TimerWheel;
+
+        Node* mPrev;
+        Node* mNext;
+        uint64 mDeadline;
+        uint8 mLevel;
+        // Allocated by TimerWheel::post() and freed when it fires
+        bool mOwned;
+        IOCallback mCallback;
+    };
+
+    /** Create a timer wheel serviced by the given IOService.
+     *  \param io the IOService the wheel's events are dispatched through
+     *  \param tick the resolution of the wheel; timeouts are rounded up to a
+     *         multiple of it
+     */
+    TimerWheel(IOService& io, const Duration& tick);
+    ~TimerWheel();
+
+    const Duration& tick() const { return mTick; }
+
+    /** Invoke the handler after at least waitFor has passed. The timer cannot
+     *  be cancelled.
+     */
+    void post(const Duration& waitFor, const IOCallback& handler);
+
+    /** Schedule node to invoke handler after at least waitFor has passed,
+     *  replacing any pending timeout for that node.
+     *  \returns the number of pending timeouts that were replaced, 0 or 1
+     */
+    uint32 schedule(Node* node, const Duration& waitFor, const IOCallback& handler);
+
+    /** Remove node from the wheel if it is pending.
+     *  \returns the number of timeouts cancelled, 0 or 1
+     */
+    uint32 cancel(Node* node);
+
+    /** Get the number of outstanding timers. */
+    uint32 size() const;
+
+private:
+    enum {
+        LevelBits = 8,
+        NumSlots = 1 << LevelBits,
+        SlotMask = NumSlots - 1,
+        NumLevels = 4
+    };
+
+    // Microseconds since mEpoch
+    int64 elapsedMicros() const;
+    // Ticks since mEpoch, rounding up so timers never fire early
+    uint64 deadlineTick(const Duration& waitFor) const;
+    uint64 currentTick() const;
+
+    // All of these must be called with mMutex held
+    void insertLocked(Node* node);
+    bool unlinkLocked(Node* node);
+    void cascadeLocked(uint32 level, uint64 tick);
+    void advanceLocked(uint64 now, std::vector<IOCallback>* fired);
+    uint64 nextTickLocked() const;
+    void armLocked(uint64 tick);
+
+    void handleTimeout(const boost::system::error_code& e);
+
+    typedef boost::mutex Mutex;
+    typedef boost::lock_guard<Mutex> LockGuard;
+    mutable Mutex mMutex;
+
+    IOService& mIOService;
+    DeadlineTimer* mTimer;
+    const Duration mTick;
+    const int64 mTickMicros;
+    const boost::posix_time::ptime mEpoch;
+
+    // Sentinels of the circular lists for each slot
+    Node mSlots[NumLevels][NumSlots];
+    uint32 mLevelCount[NumLevels];
+    uint32 mCount;
+
+    // Last tick that has been processed
+    uint64 mCurrentTick;
+    // Tick the deadline timer is currently waiting for, if mArmed
+    bool mArmed;
+    uint64 mArmedTick;
+}; // class TimerWheel
+
+} // namespace Network
+} // namespace Sirikata
+
+#endif //_SIRIKATA_TIMER_WHEEL_HPP_
@@ -47,8 +47,14 @@
 
 #define OPT_SST_DEFAULT_WINDOW_SIZE  "sst.default-window-size"
 
+#define OPT_OH_BULK_SESSION          "oh.bulk-session"
+#define OPT_OH_BATCH_SEND            "oh.batch-send"
+#define OPT_OH_LOC_UPDATE_TICK       "oh.loc-update-tick"
+#define OPT_OH_LOC_DEAD_RECKONING    "oh.loc-update-dead-reckoning"
+
 #define STATS_TRACE_FILE     "stats.trace-filename"
 #define PROFILE                    "profile"
+#define OPT_PROFILE_STRANDS        "profile-strands"
 
 #define OPT_REGION_WEIGHT        "region-weight"
 #define OPT_REGION_WEIGHT_ARGS   "region-weight-args"
@@ -60,6 +66,12 @@
 #define OPT_CDN_UPLOAD_URI_PREFIX   "cdn.upload.prefix"
 #define OPT_CDN_UPLOAD_STATUS_URI_PREFIX   "cdn.upload.status.prefix"
 
+#define OPT_DISK_CACHE_COMPRESS              "disk-cache.compress"
+#define OPT_DISK_CACHE_COMPRESS_THREADS      "disk-cache.compress-threads"
+#define OPT_DISK_CACHE_COMPRESS_MAX_SIZE     "disk-cache.compress-max-size"
+#define OPT_DISK_CACHE_COMPRESS_CPU_FRACTION "disk-cache.compress-cpu-fraction"
+#define OPT_DISK_CACHE_PARSED_MESHES         "disk-cache.parsed-meshes"
+
 #define OPT_TRACE_TIMESERIES           "trace.timeseries"
 #define OPT_TRACE_TIMESERIES_OPTIONS   "trace.timeseries-options"
 
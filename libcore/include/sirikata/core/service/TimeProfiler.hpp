@@ -34,10 +34,17 @@
 #define _SIRIKATA_TIME_PROFILER_HPP_
 
 #include <sirikata/core/util/Timer.hpp>
+#include <sirikata/core/trace/LatencyHistogram.hpp>
+#include <sirikata/core/command/Command.hpp>
+#include <boost/thread/mutex.hpp>
 
 namespace Sirikata {
 
 class Context;
+class Poller;
+namespace Network {
+class IOStrand;
+}
 
 /** A simple class which helps to time profiling to determine
  *  what fraction of time each component of a loop is taking.
@@ -45,6 +52,12 @@ class Context;
  *  human-friendly names are added to the list and then the main
  *  loop simply indicates when each stage completes.  When complete,
  *  call the report method to get a simple analysis.
+ *
+ *  Each stage also keeps a histogram of its durations, and strands can be
+ *  added with addStrand to track the queueing delay and running time of the
+ *  handlers posted to them. These can be inspected at runtime with
+ *  commandReport (registered as context.profiler by Context) and are
+ *  periodically reported to the Context's TimeSeries once start() is called.
  */
 class SIRIKATA_EXPORT TimeProfiler {
 public:
@@ -59,6 +72,8 @@ public:
         Duration minimum() const;
         Duration maximum() const;
         uint64 its() const;
+        Duration percentile(float64 frac) const;
+        const Trace::LatencyHistogram& histogram() const { return mHistogram; }
 
         void report(const String& indent) const;
     private:
@@ -76,6 +91,7 @@ public:
         Duration mMaximum;
         Duration mSum;
         uint64 mIts;
+        Trace::LatencyHistogram mHistogram;
 
         bool mValid;
     };
@@ -96,18 +112,60 @@ public:
      */
     Stage* addStage(const String& group_name, const String& name);
 
+    /** Track the handlers posted to the strand, recording how long they wait
+     *  in the queue and how long they take to run, broken down by their
+     *  tags. This should be called before the strand is in use. The strand
+     *  must outlive this TimeProfiler. Recording starts out enabled or
+     *  disabled for all strands as set by setStrandProfiling.
+     */
+    void addStrand(Network::IOStrand* strand);
+    /** Turn recording on or off for all strands added with addStrand. */
+    void setStrandProfiling(bool enabled);
+    bool strandProfiling() const;
+    /** Clear all the histograms, e.g. to start measuring a new interval. */
+    void reset();
+
+    /** Start and stop periodically reporting to the Context's TimeSeries. */
+    void start();
+    void stop();
+
     void report() const;
+
+    /** Fill in a Command::Result with the current statistics for all stages
+     *  and strands. Optional parameters: "strands" (bool) turns strand
+     *  profiling on or off, and "reset" (bool) clears the histograms after
+     *  they're reported so the next report covers only the time since then.
+     */
+    void commandReport(const Command::Command& cmd, Command::Commander* cmdr, Command::CommandID cmdid);
 private:
     friend class Stage;
 
     void remove(Stage* stage);
+    // Clear all histograms, must be called with mMutex held
+    void resetNoLock();
+    void reportTimeSeries();
 
     const Context* mContext;
     String mName;
     typedef std::vector<Stage*> StageList;
     typedef std::map<String, StageList> GroupMap;
+    // Protects mGroups and mFreeStages since stages may be added and removed
+    // from other threads while reports are generated
+    mutable boost::mutex mMutex;
     GroupMap mGroups;
     StageList mFreeStages;
+
+    struct StrandHistograms {
+        Network::IOStrand* strand;
+        String name;
+        Trace::LatencyHistogramPtr queueDelay;
+        Trace::TaggedLatencyHistogramsPtr handlers;
+    };
+    typedef std::vector<StrandHistograms> StrandList;
+    StrandList mStrands;
+    bool mStrandProfiling;
+
+    Poller* mReportPoller;
 }; // class TimeProfiler
 
 } // namespace Sirikata
@@ -0,0 +1,108 @@
+// Copyright (c) 2015 Sirikata Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can
+// be found in the LICENSE file.
+
+#ifndef _SIRIKATA_CORE_TRACE_LATENCY_HISTOGRAM_HPP_
+#define _SIRIKATA_CORE_TRACE_LATENCY_HISTOGRAM_HPP_
+
+#include <sirikata/core/util/Platform.hpp>
+#include <sirikata/core/util/AtomicTypes.hpp>
+#include <sirikata/core/util/Noncopyable.hpp>
+#include <sirikata/core/task/Time.hpp>
+#include <boost/thread/mutex.hpp>
+
+namespace Sirikata {
+namespace Trace {
+
+/** Records the distribution of a set of durations, e.g. handler latencies,
+ *  using log-linear buckets in the style of HdrHistogram. Values are grouped by
+ *  their power of two, and each power of two is split into SubBuckets linear
+ *  buckets, so reported values are within 1/SubBuckets of the true value.
+ *
+ *  Recording is lock-free and only touches a couple of counters, so a single
+ *  histogram can be updated from many threads and read at any time. Readers
+ *  may see a snapshot that is very slightly inconsistent (e.g. a count which
+ *  doesn't yet include a sample that has been added to a bucket), which is
+ *  fine for monitoring.
+ */
+class SIRIKATA_EXPORT LatencyHistogram : Noncopyable {
+public:
+    LatencyHistogram();
+
+    /** Record a sample. Negative durations are recorded as 0. */
+    void record(const Duration& dur);
+    /** Clear all samples. Samples recorded concurrently may be lost. */
+    void reset();
+
+    uint64 count() const;
+    Duration mean() const;
+    Duration maximum() const;
+    /** Get the duration that the given fraction (0 to 1) of samples fall at or
+     *  below, e.g. percentile(.99) for the 99th percentile.
+     */
+    Duration percentile(float64 frac) const;
+
+    /** Index of the bucket the value, in microseconds, is recorded in. */
+    static uint32 bucketIndex(uint64 val);
+    /** Largest value which maps to the given bucket. */
+    static uint64 bucketUpperBound(uint32 idx);
+
+private:
+    static const uint32 SubBucketBits = 4;
+    static const uint32 SubBuckets = (1 << SubBucketBits);
+    // Values are tracked in microseconds up to 2^MaxExponent (about 19 hours),
+    // larger values are clamped.
+    static const uint32 MaxExponent = 36;
+    static const uint32 NumBuckets = (MaxExponent - SubBucketBits + 1) * SubBuckets;
+
+    AtomicValue<uint64> mBuckets[NumBuckets];
+    AtomicValue<uint64> mCount;
+    AtomicValue<uint64> mSum;
+    AtomicValue<uint64> mMax;
+};
+typedef std::tr1::shared_ptr<LatencyHistogram> LatencyHistogramPtr;
+
+/** A set of LatencyHistograms keyed by tag, where tags are static strings
+ *  identified by their address, e.g. the tags passed to IOStrand::post. Lookups
+ *  of existing tags are lock-free. Only a fixed number of tags are tracked;
+ *  samples for additional tags are dropped.
+ */
+class SIRIKATA_EXPORT TaggedLatencyHistograms : Noncopyable {
+public:
+    TaggedLatencyHistograms();
+    ~TaggedLatencyHistograms();
+
+    /** Record a sample for the given tag, which may be NULL. */
+    void record(const char* tag, const Duration& dur);
+    /** Clear the samples for all tags. Tags stay tracked. */
+    void reset();
+
+    /** Number of tags currently tracked. */
+    uint32 size() const;
+    /** Get the tag for entry idx, where idx < size(). NULL tags are returned
+     *  as "(untagged)".
+     */
+    const char* tag(uint32 idx) const;
+    const LatencyHistogram& histogram(uint32 idx) const;
+
+private:
+    static const uint32 MaxTags = 128;
+
+    // Finds or adds the histogram for the tag, or returns NULL if we're out
+    // of space.
+    LatencyHistogram* lookup(const char* tag);
+
+    // Entries are only appended, and only while holding mMutex. mSize is
+    // incremented after the entry is filled in so lock-free readers only ever
+    // see complete entries.
+    const char* mTags[MaxTags];
+    LatencyHistogram* mHistograms[MaxTags];
+    AtomicValue<uint32> mSize;
+    boost::mutex mMutex;
+};
+typedef std::tr1::shared_ptr<TaggedLatencyHistograms> TaggedLatencyHistogramsPtr;
+
+} // namespace Trace
+} // namespace Sirikata
+
+#endif //_SIRIKATA_CORE_TRACE_LATENCY_HISTOGRAM_HPP_
@@ -41,8 +41,12 @@
 #include <sirikata/core/transfer/CacheMap.hpp>
 #include <sirikata/core/queue/ThreadSafeQueue.hpp>
 #include <sirikata/core/util/Thread.hpp>
+#include <sirikata/core/util/AtomicTypes.hpp>
 
 namespace Sirikata {
+
+class ThreadContext;
+
 namespace Transfer {
 
 // should really be a config option.
@@ -52,8 +56,52 @@ namespace Transfer {
 /// Disk Cache keeps track of what files are on disk, and manages a helper thread to retrieve it.
 class SIRIKATA_EXPORT DiskCacheLayer : public CacheLayer {
 public:
+	/**
+	 * Settings for the compressed tier. When enabled, complete JPEG
+	 * entries are losslessly recompressed with jpeg-arhc by a background
+	 * thread and transparently decompressed when they are read back.
+	 */
+	struct CompressionOptions {
+		CompressionOptions()
+		 : enabled(false),
+		   threads(2),
+		   maxEntrySize(16*1024*1024),
+		   cpuFraction(0.25f),
+		   minSavings(0.05f)
+		{}
+
+		bool enabled;
+		/// Number of jpeg-arhc worker threads used for each direction.
+		uint32 threads;
+		/// Entries larger than this stay uncompressed (they are buffered whole).
+		cache_usize_type maxEntrySize;
+		/// Fraction of wall clock time the compression thread may stay busy.
+		float cpuFraction;
+		/// Keep the original unless at least this fraction of space is saved.
+		float minSavings;
+	};
+
+	struct CompressionStats {
+		CompressionStats()
+		 : entriesCompressed(0), entriesSkipped(0), bytesBefore(0), bytesAfter(0)
+		{}
+
+		uint64 entriesCompressed;
+		uint64 entriesSkipped;
+		/// Disk usage of compressed entries before and after recompression.
+		uint64 bytesBefore;
+		uint64 bytesAfter;
+		int64 bytesSaved() const {
+			return (int64)bytesBefore - (int64)bytesAfter;
+		}
+	};
+
 	struct CacheData : public CacheEntry {
+		CacheData() : compressed(false) {}
+
 		RangeList mRanges;
+		/// Whole file stored in jpeg-arhc form, see CompressionOptions.
+		bool compressed;
 		bool wholeFile() const {
 			return mRanges.empty();
 		}
@@ -76,8 +124,21 @@ private:
 
 	std::string mPrefix; // directory or prefix name with trailing slash.
 
+	CompressionOptions mCompression;
+	// Compression has its own queue and thread so that recompressing
+	// never delays reads and writes on the disk worker thread.
+	ThreadSafeQueue<std::tr1::shared_ptr<DiskRequest> > mCompressionQueue;
+	Thread *mCompressionThread;
+	// Set on shutdown so the compression thread stops after its current
+	// entry instead of working through the rest of the backlog.
+	AtomicValue<bool> mStopCompression;
+	ThreadContext *mCompressContext; // only used by the compression thread
+	ThreadContext *mDecompressContext; // only used by the disk worker thread
+	boost::mutex mStatsLock;
+	CompressionStats mStats;
+
 	struct DiskRequest {
-		enum Operation {OPREAD, OPWRITE, OPDELETE, OPEXIT} op;
+		enum Operation {OPREAD, OPWRITE, OPDELETE, OPCOMPRESS, OPEXIT} op;
 
 		DiskRequest(Operation op, const Fingerprint &id, const Range &myRange)
 			:op(op), fileId(id), toRead(myRange) {}
@@ -93,8 +154,14 @@ private:
 	boost::condition_variable destroyCV;
 	bool mCleaningUp; // do not delete any files.
 
+	void queueCompression(const Fingerprint &fileId);
+	void compressEntry(const Fingerprint &fileId); // runs on the compression thread
+	// Fills datum from a compressed entry, returns false on failure.
+	bool readCompressed(const std::string &filePath, Range &toRead, MutableDenseDataPtr &datum);
+
 public:
 	void workerThread(); // defined in DiskCache.cpp
+	void compressionThread(); // defined in DiskCache.cpp
 	void unserialize(); // defined in DiskCache.cpp
 
 	void readDataFromDisk(const Fingerprint &fileId,
@@ -169,17 +236,15 @@ protected:
 
 public:
 
-	DiskCacheLayer(CachePolicy *policy, const std::string &prefix, CacheLayer *tryNext);
+	DiskCacheLayer(CachePolicy *policy, const std::string &prefix, CacheLayer *tryNext,
+		const CompressionOptions &compression = CompressionOptions());
 
-	virtual ~DiskCacheLayer() {
-		std::tr1::shared_ptr<DiskRequest> req
-			(new DiskRequest(DiskRequest::OPEXIT, Fingerprint(), Range(true)));
-		boost::unique_lock<boost::mutex> sleep_cv(destroyLock);
-		mRequestQueue.push(req);
-		destroyCV.wait(sleep_cv); // we know the thread has terminated.
+	virtual ~DiskCacheLayer();
 
-		mCleaningUp = true; // don't allow destroyCacheEntry to delete files.
-		delete mWorkerThread;
+	/// Space saved so far by the compressed tier.
+	CompressionStats compressionStats() {
+		boost::unique_lock<boost::mutex> lock(mStatsLock);
+		return mStats;
 	}
 
 	virtual void purgeFromCache(const Fingerprint &fileId) {
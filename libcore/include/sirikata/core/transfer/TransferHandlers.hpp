@@ -173,15 +173,24 @@ class SIRIKATA_EXPORT SharedChunkCache {
 private:
     static const unsigned int DISK_LRU_CACHE_SIZE;
     static const unsigned int MEMORY_LRU_CACHE_SIZE;
+    static const unsigned int DERIVED_DISK_LRU_CACHE_SIZE;
 
     CachePolicy* mDiskCachePolicy;
     CachePolicy* mMemoryCachePolicy;
+    CachePolicy* mDerivedCachePolicy;
     std::vector<CacheLayer*> mCacheLayers;
     CacheLayer* mCache;
+    CacheLayer* mDerivedCache;
 public:
     SharedChunkCache();
     ~SharedChunkCache();
     CacheLayer* getCache();
+    /** Get the cache for data computed from downloaded assets, e.g. parsed
+     *  meshes. It is disk only, with its own budget and worker thread, so
+     *  derived data neither evicts raw assets from memory nor waits behind
+     *  their disk requests.
+     */
+    CacheLayer* getDerivedCache();
     static SharedChunkCache& getSingleton();
     static void destroy();
 };
@@ -0,0 +1,152 @@
+// Copyright (c) 2015 Sirikata Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can
+// be found in the LICENSE file.
+
+#ifndef _SIRIKATA_CORE_UTIL_INDEXED_HEAP_HPP_
+#define _SIRIKATA_CORE_UTIL_INDEXED_HEAP_HPP_
+
+#include <sirikata/core/util/Platform.hpp>
+
+namespace Sirikata {
+
+/** A binary heap of small integer handles which also tracks where each handle
+ *  is in the heap. This allows the key of any element to be changed, or the
+ *  element to be removed, in O(log n) without searching for it, which
+ *  std::push_heap/pop_heap can't do.
+ *
+ *  Keys aren't stored in the heap. Compare is given two handles and, as for
+ *  the std heap functions, returns true if the first should be below the
+ *  second, i.e. it should look up the keys wherever the caller keeps them.
+ *  After changing the key of an element, call update() on it, or rebuild()
+ *  after changing many of them.
+ *
+ *  Handles index an internal array, so they should be dense, e.g. slots in
+ *  some other array.
+ */
+template<typename Compare>
+class IndexedHeap {
+public:
+    typedef uint32 Handle;
+
+    explicit IndexedHeap(const Compare& cmp = Compare())
+     : mCompare(cmp)
+    {}
+
+    bool empty() const { return mHeap.empty(); }
+    uint32 size() const { return mHeap.size(); }
+
+    /// Get the element at the top of the heap. The heap must not be empty.
+    Handle top() const {
+        assert(!mHeap.empty());
+        return mHeap.front();
+    }
+
+    bool contains(Handle h) const {
+        return (h < mPositions.size() && mPositions[h] != NotInHeap);
+    }
+
+    void push(Handle h) {
+        assert(!contains(h));
+        if (h >= mPositions.size())
+            mPositions.resize(h+1, NotInHeap);
+        mHeap.push_back(h);
+        mPositions[h] = mHeap.size() - 1;
+        siftUp(mHeap.size() - 1);
+    }
+
+    /// Remove and return the element at the top of the heap
+    Handle pop() {
+        Handle h = top();
+        remove(h);
+        return h;
+    }
+
+    /// Remove an element if it is in the heap
+    void remove(Handle h) {
+        if (!contains(h)) return;
+        uint32 pos = mPositions[h];
+        mPositions[h] = NotInHeap;
+
+        Handle last = mHeap.back();
+        mHeap.pop_back();
+        if (pos == mHeap.size()) return;
+
+        mHeap[pos] = last;
+        mPositions[last] = pos;
+        restore(pos);
+    }
+
+    /// Restore heap order after the key for h changed
+    void update(Handle h) {
+        if (!contains(h)) return;
+        restore(mPositions[h]);
+    }
+
+    /// Restore heap order after the keys of many elements have changed. This
+    /// is O(n), so is cheaper than calling update() on more than a small
+    /// fraction of the elements.
+    void rebuild() {
+        if (mHeap.size() < 2) return;
+        for(uint32 i = mHeap.size() / 2; i > 0; i--)
+            siftDown(i-1);
+    }
+
+    void clear() {
+        for(typename std::vector<Handle>::iterator it = mHeap.begin(); it != mHeap.end(); it++)
+            mPositions[*it] = NotInHeap;
+        mHeap.clear();
+    }
+
+private:
+    enum { NotInHeap = 0xFFFFFFFF };
+
+    void place(uint32 pos, Handle h) {
+        mHeap[pos] = h;
+        mPositions[h] = pos;
+    }
+
+    void restore(uint32 pos) {
+        if (pos > 0 && mCompare(mHeap[(pos-1)/2], mHeap[pos]))
+            siftUp(pos);
+        else
+            siftDown(pos);
+    }
+
+    void siftUp(uint32 pos) {
+        Handle h = mHeap[pos];
+        while(pos > 0) {
+            uint32 parent = (pos-1) / 2;
+            if (!mCompare(mHeap[parent], h))
+                break;
+            place(pos, mHeap[parent]);
+            pos = parent;
+        }
+        place(pos, h);
+    }
+
+    void siftDown(uint32 pos) {
+        Handle h = mHeap[pos];
+        uint32 count = mHeap.size();
+        while(true) {
+            uint32 child = 2*pos + 1;
+            if (child >= count)
+                break;
+            if (child+1 < count && mCompare(mHeap[child], mHeap[child+1]))
+                child++;
+            if (!mCompare(h, mHeap[child]))
+                break;
+            place(pos, mHeap[child]);
+            pos = child;
+        }
+        place(pos, h);
+    }
+
+    Compare mCompare;
+    std::vector<Handle> mHeap;
+    // Index into mHeap for each handle, or NotInHeap
+    std::vector<uint32> mPositions;
+}; // class IndexedHeap
+
+} // namespace Sirikata
+
+#endif //_SIRIKATA_CORE_UTIL_INDEXED_HEAP_HPP_
@@ -0,0 +1,104 @@
+// Copyright (c) 2015 Sirikata Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can
+// be found in the LICENSE file.
+
+#ifndef _SIRIKATA_CORE_UTIL_INTERNED_STRING_HPP_
+#define _SIRIKATA_CORE_UTIL_INTERNED_STRING_HPP_
+
+#include <sirikata/core/util/Platform.hpp>
+#include <sirikata/core/util/Noncopyable.hpp>
+#include <boost/thread/mutex.hpp>
+
+namespace Sirikata {
+
+/** A handle to a reference counted, immutable string stored in an
+ *  InternedStringTable. Handles are cheap to copy and store, and handles from
+ *  the same table compare equal if and only if they refer to the same string,
+ *  so comparisons don't need to look at the string data. A default constructed
+ *  handle refers to the empty string.
+ *
+ *  Handles remain valid after the table that created them is destroyed, and
+ *  can safely be copied and released from any thread.
+ */
+class SIRIKATA_EXPORT InternedString {
+public:
+    InternedString() {}
+
+    const String& str() const {
+        return (mData ? *mData : emptyString());
+    }
+    bool empty() const {
+        return (!mData || mData->empty());
+    }
+
+    bool operator==(const InternedString& rhs) const {
+        return str_ptr() == rhs.str_ptr();
+    }
+    bool operator!=(const InternedString& rhs) const {
+        return str_ptr() != rhs.str_ptr();
+    }
+    // Ordering is by identity, not by value, and is only useful for storing
+    // handles in ordered containers.
+    bool operator<(const InternedString& rhs) const {
+        return str_ptr() < rhs.str_ptr();
+    }
+
+    struct Hasher {
+        size_t operator()(const InternedString& s) const {
+            return (size_t)s.str_ptr();
+        }
+    };
+
+private:
+    friend class InternedStringTable;
+
+    typedef std::tr1::shared_ptr<const String> StringPtr;
+
+    explicit InternedString(const StringPtr& data)
+     : mData(data)
+    {}
+
+    static const String& emptyString();
+
+    const String* str_ptr() const {
+        return (mData ? mData.get() : &emptyString());
+    }
+
+    StringPtr mData;
+};
+
+/** Interns strings, returning InternedString handles which share a single copy
+ *  of each distinct value. Useful when many objects refer to a few distinct,
+ *  long-ish strings, e.g. mesh URIs. Entries are removed lazily once no
+ *  handles refer to them. Interning is thread safe.
+ */
+class SIRIKATA_EXPORT InternedStringTable : Noncopyable {
+public:
+    InternedStringTable();
+
+    /** Get a handle for the given value. The empty string always maps to the
+     *  default, empty handle.
+     */
+    InternedString intern(const String& val);
+
+    /** Number of distinct strings currently stored, including those which
+     *  have no handles left but haven't been cleaned up yet.
+     */
+    uint32 size() const;
+
+private:
+    typedef std::tr1::weak_ptr<const String> WeakStringPtr;
+    typedef std::tr1::unordered_map<String, WeakStringPtr> StringMap;
+
+    // Remove entries which no longer have any handles.
+    void sweep();
+
+    mutable boost::mutex mMutex;
+    StringMap mStrings;
+    // Table size which triggers the next sweep
+    uint32 mSweepThreshold;
+};
+
+} // namespace Sirikata
+
+#endif //_SIRIKATA_CORE_UTIL_INTERNED_STRING_HPP_
@@ -0,0 +1,42 @@
+// Copyright (c) 2015 Sirikata Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can
+// be found in the LICENSE file.
+
+#ifndef _SIRIKATA_CORE_UTIL_PACKED_PRIORITIES_HPP_
+#define _SIRIKATA_CORE_UTIL_PACKED_PRIORITIES_HPP_
+
+#include <sirikata/core/util/Platform.hpp>
+
+namespace Sirikata {
+
+/** Priority metrics for many objects at once, relative to a single viewer.
+ *  Object positions and radii are passed as separate packed arrays (one for
+ *  each of x, y, z and radius) so they can be evaluated several objects at a
+ *  time with SIMD instructions where they're available. Results are written
+ *  to out, which must have room for count values.
+ */
+namespace PackedPriorities {
+
+/** Inverse distance from the viewer, or 1 if the object is exactly at the
+ *  viewer's position.
+ */
+SIRIKATA_FUNCTION_EXPORT void distance(
+    const Vector3f& viewer,
+    const float32* x, const float32* y, const float32* z,
+    uint32 count, float32* out
+);
+
+/** Solid angle the object's bounding sphere covers as seen by the viewer, as
+ *  a fraction of SolidAngle::Max. Objects whose bounding box contains the
+ *  viewer get 0.99.
+ */
+SIRIKATA_FUNCTION_EXPORT void solidAngle(
+    const Vector3f& viewer,
+    const float32* x, const float32* y, const float32* z, const float32* radius,
+    uint32 count, float32* out
+);
+
+} // namespace PackedPriorities
+} // namespace Sirikata
+
+#endif //_SIRIKATA_CORE_UTIL_PACKED_PRIORITIES_HPP_
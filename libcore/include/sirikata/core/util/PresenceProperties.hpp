@@ -128,6 +128,18 @@ public:
         return mUpdateSeqno[whichPart];
     }
 
+    /** Update the sequence number for a part without storing a value, for
+     *  users which keep the value elsewhere. Returns false, leaving the
+     *  sequence number unchanged, if seqno is older than the current one.
+     */
+    bool updateSeqNo(LOC_PARTS whichPart, uint64 seqno) {
+        assert(whichPart < LOC_NUM_PART);
+        if (seqno < mUpdateSeqno[whichPart])
+            return false;
+        mUpdateSeqno[whichPart] = seqno;
+        return true;
+    }
+
     bool setLocation(const TimedMotionVector3f& reqloc, uint64 seqno) {
         if (seqno < mUpdateSeqno[LOC_POS_PART])
             return false;
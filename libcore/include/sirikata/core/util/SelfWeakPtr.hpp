@@ -48,6 +48,12 @@ protected:
         sharedPtr->mWeakPtr=sharedPtr;
         return retval;
     }
+    template <class U, class Deleter> static std::tr1::shared_ptr<U> internalConstruct(U * u, Deleter d){
+        std::tr1::shared_ptr<U> retval(u, d);
+        std::tr1::shared_ptr<T> sharedPtr(retval);
+        sharedPtr->mWeakPtr=sharedPtr;
+        return retval;
+    }
 
 public:
     const std::tr1::weak_ptr<T>& getWeakPtr() const {
@@ -34,6 +34,7 @@
 #include <sirikata/core/network/IOService.hpp>
 #include <sirikata/core/util/Time.hpp>
 #include <sirikata/core/network/IOStrand.hpp>
+#include <sirikata/core/network/TimerWheel.hpp>
 #include <boost/version.hpp>
 #include <boost/asio.hpp>
 #include <boost/lexical_cast.hpp>
@@ -45,15 +46,6 @@ namespace Network {
 
 typedef boost::asio::io_service InternalIOService;
 
-typedef boost::asio::deadline_timer deadline_timer;
-#if BOOST_VERSION==103900
-typedef deadline_timer* deadline_timer_ptr;
-#else
-typedef std::tr1::shared_ptr<deadline_timer> deadline_timer_ptr;
-#endif
-typedef boost::posix_time::microseconds posix_microseconds;
-using std::tr1::placeholders::_1;
-
 #ifdef SIRIKATA_TRACK_EVENT_QUEUES
 namespace {
 typedef boost::mutex AllIOServicesMutex;
@@ -77,6 +69,7 @@ IOService::IOService(const String& name)
 #endif
 {
     mImpl = new boost::asio::io_service(1);
+    mTimerWheel = new TimerWheel(*this, Duration::milliseconds(1));
 
 #ifdef SIRIKATA_TRACK_EVENT_QUEUES
     AllIOServicesLockGuard lock(gAllIOServicesMutex);
@@ -85,6 +78,7 @@ IOService::IOService(const String& name)
 }
 
 IOService::~IOService(){
+    delete mTimerWheel;
     delete mImpl;
 
 #ifdef SIRIKATA_TRACK_EVENT_QUEUES
@@ -169,25 +163,8 @@ void IOService::post(
 #endif
 }
 
-namespace {
-void handle_deadline_timer(const boost::system::error_code&e, const deadline_timer_ptr& timer, const IOCallback& handler) {
-    if (e)
-        return;
-
-    handler();
-}
-} // namespace
-
 void IOService::post(const Duration& waitFor, const IOCallback& handler, const char* tag, const char* tagStat) {
     assert(handler);
-#if BOOST_VERSION==103900
-    static bool warnOnce=true;
-    if (warnOnce) {
-        warnOnce=false;
-        SILOG(core,error,"Using buggy version of boost (1.39.0), leaking deadline_timer to avoid crash");
-    }
-#endif
-    deadline_timer_ptr timer(new deadline_timer(*mImpl, posix_microseconds(waitFor.toMicroseconds())));
 
 #ifdef SIRIKATA_TRACK_EVENT_QUEUES
     mTimersEnqueued++;
@@ -197,14 +174,14 @@ void IOService::post(const Duration& waitFor, const IOCallback& handler, const c
             mTagCounts[tag] = 0;
         mTagCounts[tag]++;
     }
-    IOCallbackWithError orig_cb = std::tr1::bind(&handle_deadline_timer, _1, timer, handler);
-    timer->async_wait(
+    mTimerWheel->post(
+        waitFor,
         std::tr1::bind(&IOService::decrementTimerCount, this,
-            _1, Timer::now(), waitFor, orig_cb, tag,tagStat
+            Timer::now(), waitFor, handler, tag, tagStat
         )
     );
 #else
-    timer->async_wait(std::tr1::bind(&handle_deadline_timer, _1, timer, handler));
+    mTimerWheel->post(waitFor, handler);
 #endif
 
     static Duration max_post_timeout = Duration::seconds(5);
@@ -216,7 +193,7 @@ void IOService::post(const Duration& waitFor, const IOCallback& handler, const c
 
 
 #ifdef SIRIKATA_TRACK_EVENT_QUEUES
-void IOService::decrementTimerCount(const boost::system::error_code& e, const Time& start, const Duration& timer_duration, const IOCallbackWithError& cb, const char* tag, const char* tagStat) {
+void IOService::decrementTimerCount(const Time& start, const Duration& timer_duration, const IOCallback& cb, const char* tag, const char* tagStat) {
     mTimersEnqueued--;
     Time end = Timer::now();
     {
@@ -230,7 +207,7 @@ void IOService::decrementTimerCount(const boost::system::error_code& e, const Ti
     }
 
     Time begin = Timer::now();
-    cb(e);
+    cb();
     end = Timer::now();
 
     TagDuration td;
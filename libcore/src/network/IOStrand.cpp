@@ -49,6 +49,8 @@ IOStrand::IOStrand(IOService& io, const String& name)
    mWindowedTimerLatencyStats(100),
    mWindowedHandlerLatencyStats(100)
 #endif
+   ,
+   mProfilingEnabled(false)
 {
     mImpl = new InternalIOStrand(io);
 }
@@ -85,8 +87,40 @@ void IOStrand::dispatch(const IOCallback& handler, const char* tag) {
 #endif
 }
 
+void IOStrand::enableProfiling(Trace::LatencyHistogramPtr queue_delay, Trace::TaggedLatencyHistogramsPtr handler_times, bool enabled) {
+    mQueueDelayHistogram = queue_delay;
+    mHandlerHistograms = handler_times;
+    mProfilingEnabled = enabled;
+}
+
+void IOStrand::setProfilingEnabled(bool enabled) {
+    // Without histograms there's nothing to record into
+    mProfilingEnabled = (enabled && mQueueDelayHistogram);
+}
+
+void IOStrand::profiledHandler(Trace::LatencyHistogramPtr queue_delay, Trace::TaggedLatencyHistogramsPtr handler_times, const Time& start, const IOCallback& cb, const char* tag) {
+    Time begin = Timer::now();
+    queue_delay->record(begin - start);
+    cb();
+    handler_times->record(tag, Timer::now() - begin);
+}
+
 void IOStrand::post(const IOCallback& handler, const char* tag) {
     assert(handler);
+    if (mProfilingEnabled.read()) {
+        // Wrap the handler to collect timing information. Note that we don't
+        // need to pass the wrapped version through the other tracking code --
+        // if it's enabled, it'll wrap the profiled handler.
+        post_impl(
+            std::tr1::bind(&IOStrand::profiledHandler, mQueueDelayHistogram, mHandlerHistograms, Timer::now(), handler, tag),
+            tag
+        );
+        return;
+    }
+    post_impl(handler, tag);
+}
+
+void IOStrand::post_impl(const IOCallback& handler, const char* tag) {
 #ifdef SIRIKATA_TRACK_EVENT_QUEUES
     mEnqueued++;
     {
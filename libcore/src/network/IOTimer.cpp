@@ -35,27 +35,19 @@
 #include <sirikata/core/network/IOService.hpp>
 #include <sirikata/core/network/IOStrandImpl.hpp>
 #include <sirikata/core/util/Time.hpp>
-#include <sirikata/core/network/Asio.hpp>
-
-#include <boost/asio.hpp>
-#include <boost/bind.hpp>
+#include <sirikata/core/util/Timer.hpp>
 
 namespace Sirikata {
 namespace Network {
 
 class IOTimer::TimedOut {
 public:
-    static void timedOut(
-            const boost::system::error_code &error,
-            IOTimerWPtr wthis, uint64 tokenVal)
+    static void timedOut(IOTimerWPtr wthis, uint64 tokenVal)
     {
         IOTimerPtr sharedThis (wthis.lock());
         if (!sharedThis) {
             return; // we've been deleted already.
         }
-        if (error == boost::asio::error::operation_aborted) {
-            return; // don't care if the timer was cancelled.
-        }
 
         if (sharedThis->mStrand != NULL) sharedThis->chk.serializedEnter();
         IOTimer*st=&*sharedThis;
@@ -69,7 +61,9 @@ public:
 };
 
 IOTimer::IOTimer(IOService& io)
- : mTimer(new DeadlineTimer(io)),
+ : mService(&io),
+   mNode(),
+   mExpiry(Time::null()),
    mStrand(NULL),
    mFunc(),
    mCanceled(0)
@@ -77,7 +71,9 @@ IOTimer::IOTimer(IOService& io)
 }
 
 IOTimer::IOTimer(IOService& io, const IOCallback& cb)
- : mTimer(new DeadlineTimer(io)),
+ : mService(&io),
+   mNode(),
+   mExpiry(Time::null()),
    mStrand(NULL),
    mFunc(),
    mCanceled(0)
@@ -86,7 +82,9 @@ IOTimer::IOTimer(IOService& io, const IOCallback& cb)
 }
 
 IOTimer::IOTimer(IOStrand* ios)
- : mTimer(new DeadlineTimer(ios->service())),
+ : mService(&ios->service()),
+   mNode(),
+   mExpiry(Time::null()),
    mStrand(ios),
    mFunc(),
    mCanceled(0)
@@ -94,7 +92,9 @@ IOTimer::IOTimer(IOStrand* ios)
 }
 
 IOTimer::IOTimer(IOStrand* ios, const IOCallback& cb)
- : mTimer(new DeadlineTimer(ios->service())),
+ : mService(&ios->service()),
+   mNode(),
+   mExpiry(Time::null()),
    mStrand(ios),
    mFunc(),
    mCanceled(0)
@@ -138,36 +138,20 @@ IOTimerPtr IOTimer::create(IOStrand& ios, const IOCallback& cb) {
 IOTimer::~IOTimer() {
     if (mStrand != NULL) chk.serializedEnter();
     cancel();
-    delete mTimer;
     if (mStrand != NULL) chk.serializedExit();
 }
 
 uint32 IOTimer::wait(const Duration &num_seconds) {
-    uint32 ncancelled = mTimer->expires_from_now(boost::posix_time::microseconds(num_seconds.toMicroseconds()));
+    mExpiry = Timer::now() + num_seconds;
     IOTimerWPtr weakThisPtr(this->shared_from_this());
-    if (mStrand == NULL) {
-        mTimer->async_wait(
-            boost::bind(
-                &IOTimer::TimedOut::timedOut,
-                boost::asio::placeholders::error,
-                weakThisPtr,
-                mCanceled.read()
-            )
-        );
-    }
-    else {
-        mTimer->async_wait(
-            mStrand->wrap(
-                boost::bind(
-                    &IOTimer::TimedOut::timedOut,
-                    boost::asio::placeholders::error,
-                    weakThisPtr,
-                    mCanceled.read()
-                )
-            )
-        );
-    }
-    return ncancelled;
+    IOCallback cb = std::tr1::bind(
+        &IOTimer::TimedOut::timedOut,
+        weakThisPtr,
+        mCanceled.read()
+    );
+    if (mStrand != NULL)
+        cb = mStrand->wrap(cb);
+    return mService->timerWheel().schedule(&mNode, num_seconds, cb);
 }
 
 uint32 IOTimer::wait(const Duration &num_seconds, const IOCallback& cb) {
@@ -182,12 +166,12 @@ void IOTimer::setCallback(const IOCallback& cb) {
 uint32 IOTimer::cancel() {
     if (mStrand != NULL) chk.serializedEnter();
     mCanceled++;
-    uint32 ncancelled = mTimer->cancel();
+    uint32 ncancelled = mService->timerWheel().cancel(&mNode);
     if (mStrand != NULL) chk.serializedExit();
     return (mStrand != NULL ? 1 : ncancelled);
 }
 Duration IOTimer::expiresFromNow() {
-    return Duration::microseconds(mTimer->expires_from_now().total_microseconds());
+    return mExpiry - Timer::now();
 }
 } // namespace Network
 } // namespace Sirikata
@@ -33,8 +33,65 @@
 #include <sirikata/core/network/ObjectMessage.hpp>
 #include <sirikata/core/util/SpaceObjectReference.hpp>
 
+#include "Protocol_Empty.pbj.hpp"
+
 namespace Sirikata {
 
+namespace {
+
+const uint8 BatchFieldKey = (OBJECT_MESSAGE_BATCH_FIELD << 3) | 2;
+
+void appendVarint(std::string* out, uint64 val) {
+    while(val >= 0x80) {
+        out->push_back((char)((val & 0x7F) | 0x80));
+        val >>= 7;
+    }
+    out->push_back((char)val);
+}
+
+bool readVarint(const uint8** pos, const uint8* end, uint64* val) {
+    *val = 0;
+    for(uint32 shift = 0; shift < 64 && *pos < end; shift += 7) {
+        uint8 byte = **pos;
+        (*pos)++;
+        *val |= ((uint64)(byte & 0x7F)) << shift;
+        if ((byte & 0x80) == 0)
+            return true;
+    }
+    return false;
+}
+
+// Find the key of the payload field by serializing a probe message and looking
+// for the probe payload among its fields, so the header serialization can't
+// get out of sync with the protocol definition.
+uint32 findPayloadFieldKey() {
+    const std::string probe("object-message-payload-probe");
+    ObjectMessage msg;
+    createObjectHostMessage(0, UUID::null(), 0, UUID::null(), 0, probe, &msg);
+    std::string serialized;
+    msg.serialize(&serialized);
+
+    Sirikata::Protocol::Empty fields;
+    fields.ParseFromArray(&serialized[0], serialized.size());
+    uint32 key = 0;
+    for(int i = 0; i < fields.unknown_fields().field_count(); i++) {
+        const ::google::protobuf::UnknownField& field = fields.unknown_fields().field(i);
+        assert(field.number() != OBJECT_MESSAGE_BATCH_FIELD);
+        if (field.type() == ::google::protobuf::UnknownField::TYPE_LENGTH_DELIMITED &&
+            field.length_delimited() == probe)
+            key = (field.number() << 3) | 2;
+    }
+    assert(key != 0);
+    return key;
+}
+
+uint32 payloadFieldKey() {
+    static uint32 key = findPayloadFieldKey();
+    return key;
+}
+
+} // namespace
+
 void createObjectHostMessage(ObjectHostID source_server, const SpaceObjectReference& sporef_src, ObjectMessagePort src_port, const UUID& dest, ObjectMessagePort dest_port, const std::string& payload, ObjectMessage* result) {
     if (result == NULL) return;
 
@@ -86,5 +143,39 @@ Sirikata::Protocol::Object::ObjectMessage* createObjectMessage(ServerID source_s
 }
 
 
+void serializeObjectMessageHeader(const ObjectMessage& msg, uint32 payload_size, std::string* result) {
+    // The payload field appears again after the (empty) one serialized with
+    // the rest of the message, and the last occurrence wins when parsing.
+    msg.serialize(result);
+    appendVarint(result, payloadFieldKey());
+    appendVarint(result, payload_size);
+}
+
+void appendObjectMessageToBatch(const std::string& header, MemoryReference payload, std::string* batch) {
+    batch->push_back((char)BatchFieldKey);
+    appendVarint(batch, header.size() + payload.size());
+    batch->append(header);
+    batch->append((const char*)payload.begin(), payload.size());
+}
+
+bool isObjectMessageBatch(MemoryReference data) {
+    return (data.size() > 0 && *((const uint8*)data.begin()) == BatchFieldKey);
+}
+
+bool nextObjectMessageInBatch(MemoryReference* batch, MemoryReference* msg_out) {
+    const uint8* pos = (const uint8*)batch->begin();
+    const uint8* end = (const uint8*)batch->end();
+    if (pos >= end || *pos != BatchFieldKey)
+        return false;
+    pos++;
+
+    uint64 len;
+    if (!readVarint(&pos, end, &len) || len > (uint64)(end - pos))
+        return false;
+
+    *msg_out = MemoryReference(pos, (size_t)len);
+    *batch = MemoryReference(pos + len, (size_t)(end - pos - len));
+    return true;
+}
 
 } // namespace Sirikata
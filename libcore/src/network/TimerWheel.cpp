@@ -0,0 +1,265 @@
+// Copyright (c) 2015 Sirikata Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can
+// be found in the LICENSE file.
+
+#include <sirikata/core/util/Standard.hh>
+#include <sirikata/core/network/TimerWheel.hpp>
+#include <sirikata/core/network/IOService.hpp>
+#include <sirikata/core/network/Asio.hpp>
+#include <boost/asio.hpp>
+
+namespace Sirikata {
+namespace Network {
+
+using std::tr1::placeholders::_1;
+
+namespace {
+// Timeouts further out than this are parked in the top level and cascaded
+// back into it until they get close enough.
+const uint64 MaxDelta = (((uint64)1) << 32) - 1;
+} // namespace
+
+TimerWheel::TimerWheel(IOService& io, const Duration& tick)
+ : mIOService(io),
+   mTimer(new DeadlineTimer(io)),
+   mTick(tick),
+   mTickMicros(std::max(tick.toMicroseconds(), (int64)1)),
+   mEpoch(boost::posix_time::microsec_clock::universal_time()),
+   mCount(0),
+   mCurrentTick(0),
+   mArmed(false),
+   mArmedTick(0)
+{
+    for(uint32 level = 0; level < NumLevels; level++) {
+        mLevelCount[level] = 0;
+        for(uint32 slot = 0; slot < NumSlots; slot++) {
+            Node* sentinel = &mSlots[level][slot];
+            sentinel->mPrev = sentinel;
+            sentinel->mNext = sentinel;
+        }
+    }
+}
+
+TimerWheel::~TimerWheel() {
+    {
+        LockGuard lock(mMutex);
+        for(uint32 level = 0; level < NumLevels; level++) {
+            for(uint32 slot = 0; slot < NumSlots; slot++) {
+                Node* sentinel = &mSlots[level][slot];
+                while(sentinel->mNext != sentinel) {
+                    Node* node = sentinel->mNext;
+                    unlinkLocked(node);
+                    if (node->mOwned) delete node;
+                }
+            }
+        }
+        mTimer->cancel();
+        mArmed = false;
+    }
+    delete mTimer;
+}
+
+int64 TimerWheel::elapsedMicros() const {
+    return (boost::posix_time::microsec_clock::universal_time() - mEpoch).total_microseconds();
+}
+
+uint64 TimerWheel::currentTick() const {
+    int64 elapsed = elapsedMicros();
+    if (elapsed <= 0) return 0;
+    return (uint64)(elapsed / mTickMicros);
+}
+
+uint64 TimerWheel::deadlineTick(const Duration& waitFor) const {
+    int64 elapsed = elapsedMicros() + std::max(waitFor.toMicroseconds(), (int64)0);
+    if (elapsed <= 0) return 0;
+    return (uint64)((elapsed + mTickMicros - 1) / mTickMicros);
+}
+
+uint32 TimerWheel::size() const {
+    LockGuard lock(mMutex);
+    return mCount;
+}
+
+void TimerWheel::post(const Duration& waitFor, const IOCallback& handler) {
+    Node* node = new Node();
+    node->mOwned = true;
+    schedule(node, waitFor, handler);
+}
+
+uint32 TimerWheel::schedule(Node* node, const Duration& waitFor, const IOCallback& handler) {
+    uint64 deadline = deadlineTick(waitFor);
+
+    LockGuard lock(mMutex);
+    bool replaced = unlinkLocked(node);
+
+    // With nothing outstanding there's no bookkeeping to catch up on, so just
+    // jump to the current time instead of stepping through idle ticks later.
+    if (mCount == 0)
+        mCurrentTick = std::max(mCurrentTick, currentTick());
+
+    node->mDeadline = std::max(deadline, mCurrentTick + 1);
+    node->mCallback = handler;
+    insertLocked(node);
+
+    if (!mArmed || node->mDeadline < mArmedTick)
+        armLocked(node->mDeadline);
+
+    return replaced ? 1 : 0;
+}
+
+uint32 TimerWheel::cancel(Node* node) {
+    LockGuard lock(mMutex);
+    bool removed = unlinkLocked(node);
+    if (removed) {
+        node->mCallback = IOCallback();
+        // Don't hold the IOService open with an idle timer
+        if (mCount == 0 && mArmed) {
+            mTimer->cancel();
+            mArmed = false;
+        }
+    }
+    return removed ? 1 : 0;
+}
+
+void TimerWheel::insertLocked(Node* node) {
+    uint64 deadline = node->mDeadline;
+    uint64 delta = deadline - mCurrentTick;
+
+    uint32 level = 0;
+    if (delta > MaxDelta) {
+        deadline = mCurrentTick + MaxDelta;
+        level = NumLevels - 1;
+    }
+    else {
+        while(level < NumLevels - 1 && delta >= (((uint64)1) << (LevelBits * (level+1))))
+            level++;
+    }
+    uint32 slot = (uint32)((deadline >> (LevelBits * level)) & SlotMask);
+
+    Node* sentinel = &mSlots[level][slot];
+    node->mLevel = (uint8)level;
+    node->mPrev = sentinel->mPrev;
+    node->mNext = sentinel;
+    sentinel->mPrev->mNext = node;
+    sentinel->mPrev = node;
+
+    mLevelCount[level]++;
+    mCount++;
+}
+
+bool TimerWheel::unlinkLocked(Node* node) {
+    if (node->mNext == NULL)
+        return false;
+
+    node->mPrev->mNext = node->mNext;
+    node->mNext->mPrev = node->mPrev;
+    node->mPrev = NULL;
+    node->mNext = NULL;
+
+    mLevelCount[node->mLevel]--;
+    mCount--;
+    return true;
+}
+
+void TimerWheel::cascadeLocked(uint32 level, uint64 tick) {
+    uint32 slot = (uint32)((tick >> (LevelBits * level)) & SlotMask);
+    Node* sentinel = &mSlots[level][slot];
+    // Detach the whole list first since reinsertion may (for parked, very long
+    // timeouts) put nodes back in the same slot.
+    if (sentinel->mNext == sentinel)
+        return;
+    Node* node = sentinel->mNext;
+    sentinel->mPrev->mNext = NULL;
+    sentinel->mPrev = sentinel;
+    sentinel->mNext = sentinel;
+    while(node != NULL) {
+        Node* next = node->mNext;
+        mLevelCount[level]--;
+        mCount--;
+        insertLocked(node);
+        node = next;
+    }
+}
+
+void TimerWheel::advanceLocked(uint64 now, std::vector<IOCallback>* fired) {
+    while(mCurrentTick < now) {
+        if (mCount == 0) {
+            mCurrentTick = now;
+            break;
+        }
+        if (mLevelCount[0] == 0) {
+            // Nothing can expire before the next cascade, so skip straight to
+            // it
+            uint64 boundary = (mCurrentTick | SlotMask) + 1;
+            if (boundary > now) {
+                mCurrentTick = now;
+                break;
+            }
+            mCurrentTick = boundary - 1;
+        }
+
+        uint64 tick = ++mCurrentTick;
+        for(uint32 level = 1; level < NumLevels; level++) {
+            if ((tick & ((((uint64)1) << (LevelBits * level)) - 1)) != 0)
+                break;
+            cascadeLocked(level, tick);
+        }
+
+        Node* sentinel = &mSlots[0][tick & SlotMask];
+        while(sentinel->mNext != sentinel) {
+            Node* node = sentinel->mNext;
+            unlinkLocked(node);
+            fired->push_back(IOCallback());
+            fired->back().swap(node->mCallback);
+            if (node->mOwned) delete node;
+        }
+    }
+}
+
+uint64 TimerWheel::nextTickLocked() const {
+    // Earliest non-empty slot in the lowest level, or the next cascade if only
+    // the upper levels have anything in them
+    for(uint64 tick = mCurrentTick + 1; ; tick++) {
+        if ((tick & SlotMask) == 0 && mCount != mLevelCount[0])
+            return tick;
+        const Node* sentinel = &mSlots[0][tick & SlotMask];
+        if (sentinel->mNext != sentinel)
+            return tick;
+        if (tick - mCurrentTick >= NumSlots)
+            return tick;
+    }
+}
+
+void TimerWheel::armLocked(uint64 tick) {
+    mArmed = true;
+    mArmedTick = tick;
+    int64 wait_us = std::max((int64)(tick * mTickMicros) - elapsedMicros(), (int64)0);
+    mTimer->expires_from_now(boost::posix_time::microseconds(wait_us));
+    mTimer->async_wait(std::tr1::bind(&TimerWheel::handleTimeout, this, _1));
+}
+
+void TimerWheel::handleTimeout(const boost::system::error_code& e) {
+    if (e == boost::asio::error::operation_aborted)
+        return;
+
+    std::vector<IOCallback> fired;
+    {
+        LockGuard lock(mMutex);
+        mArmed = false;
+        advanceLocked(currentTick(), &fired);
+        if (mCount > 0)
+            armLocked(nextTickLocked());
+    }
+
+    // Expired timers are otherwise unrelated, so don't make them wait on each
+    // other.
+    if (fired.size() == 1) {
+        fired[0]();
+        return;
+    }
+    for(std::vector<IOCallback>::iterator it = fired.begin(); it != fired.end(); it++)
+        mIOService.post(*it, "TimerWheel::handleTimeout");
+}
+
+} // namespace Network
+} // namespace Sirikata
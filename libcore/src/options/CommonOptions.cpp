@@ -72,6 +72,10 @@ void InitOptions() {
 
         .addOption(new OptionValue("ohstreamlib","tcpsst",Sirikata::OptionValueType<String>(),"Which library to use to communicate with the object host"))
         .addOption(new OptionValue("ohstreamoptions","--send-buffer-size=16384 --parallel-sockets=1 --no-delay=false",Sirikata::OptionValueType<String>(),"TCPSST stream options such as how many bytes to collect for sending during an ongoing asynchronous send call."))
+        .addOption(new OptionValue(OPT_OH_BULK_SESSION,"false",Sirikata::OptionValueType<bool>(),"If true, object hosts batch session requests for objects connecting to the same space server into a single message."))
+        .addOption(new OptionValue(OPT_OH_BATCH_SEND,"false",Sirikata::OptionValueType<bool>(),"If true, object hosts collect object messages sent to a space server during a burst of events and write them to the connection as a single chunk."))
+        .addOption(new OptionValue(OPT_OH_LOC_UPDATE_TICK,"0s",Sirikata::OptionValueType<Duration>(),"If non-zero, object hosts coalesce location update requests from all their presences and send one bulk update per space server at this interval instead of one message per request."))
+        .addOption(new OptionValue(OPT_OH_LOC_DEAD_RECKONING,"0",Sirikata::OptionValueType<float32>(),"If non-zero, location update requests which don't change velocity and stay within this distance of the position the space server would extrapolate from the last update are suppressed. Only applies when coalescing location updates."))
 
         .addOption(new OptionValue(OPT_SST_DEFAULT_WINDOW_SIZE,"10000",Sirikata::OptionValueType<uint32>(),"Default window (and buffer) size for SST streams."))
 
@@ -105,6 +109,7 @@ void InitOptions() {
 
 
         .addOption(new OptionValue(PROFILE, "false", Sirikata::OptionValueType<bool>(), "Whether to report profiling information."))
+        .addOption(new OptionValue(OPT_PROFILE_STRANDS, "false", Sirikata::OptionValueType<bool>(), "Whether to record queueing delay and handler times for each Context's main strand at startup. Can be toggled at runtime with the context.profiler command. Adds a small cost to every post."))
 
         .addOption(new OptionValue(OPT_CDN_HOST,"open3dhub.com",Sirikata::OptionValueType<String>(), "Hostname for CDN server."))
 
@@ -114,6 +119,12 @@ void InitOptions() {
         .addOption(new OptionValue(OPT_CDN_UPLOAD_URI_PREFIX, "/api/upload", Sirikata::OptionValueType<String>(), "URI prefix for CDN HTTP uploads."))
         .addOption(new OptionValue(OPT_CDN_UPLOAD_STATUS_URI_PREFIX, "/upload/processing", Sirikata::OptionValueType<String>(), "URI prefix for CDN HTTP upload status checks."))
 
+        .addOption(new OptionValue(OPT_DISK_CACHE_COMPRESS, "false", Sirikata::OptionValueType<bool>(), "If true, JPEG entries in the shared disk cache are losslessly recompressed in the background."))
+        .addOption(new OptionValue(OPT_DISK_CACHE_COMPRESS_THREADS, "2", Sirikata::OptionValueType<uint32>(), "Worker threads used to compress and decompress disk cache entries."))
+        .addOption(new OptionValue(OPT_DISK_CACHE_COMPRESS_MAX_SIZE, "16777216", Sirikata::OptionValueType<uint32>(), "Disk cache entries larger than this many bytes are not compressed."))
+        .addOption(new OptionValue(OPT_DISK_CACHE_COMPRESS_CPU_FRACTION, "0.25", Sirikata::OptionValueType<float>(), "Fraction of time the disk cache compression thread may be busy."))
+        .addOption(new OptionValue(OPT_DISK_CACHE_PARSED_MESHES, "true", Sirikata::OptionValueType<bool>(), "If true, parsed meshes are stored in the shared disk cache in binary form so they don't need to be parsed again."))
+
         .addOption(new OptionValue(OPT_TRACE_TIMESERIES, "null", Sirikata::OptionValueType<String>(), "Service to report TimeSeries data to."))
         .addOption(new OptionValue(OPT_TRACE_TIMESERIES_OPTIONS, "", Sirikata::OptionValueType<String>(), "Options for TimeSeries reporting service."))
 
@@ -37,6 +37,7 @@
 #include <boost/lexical_cast.hpp>
 #include <sirikata/core/service/Breakpad.hpp>
 #include <sirikata/core/command/Commander.hpp>
+#include <sirikata/core/options/CommonOptions.hpp>
 
 #define CTX_LOG(lvl, msg) SILOG(context, lvl, msg)
 
@@ -62,6 +63,10 @@ Context::Context(const String& name_, Network::IOService* ios, Network::IOStrand
     CTX_LOG(info, "Creating context");
   Breakpad::init();
   profiler = new TimeProfiler(this, name);
+  // The main strand is always tracked so profiling can be turned on at
+  // runtime through the context.profiler command.
+  profiler->setStrandProfiling(GetOptionValue<bool>(OPT_PROFILE_STRANDS));
+  profiler->addStrand(mainStrand);
 }
 
 Context::~Context() {
@@ -74,6 +79,8 @@ void Context::start() {
         std::tr1::bind(&Context::handleSignal, this, std::tr1::placeholders::_1)
     );
 
+    profiler->start();
+
     if (mSimDuration == Duration::zero())
         return;
 
@@ -145,6 +152,7 @@ void Context::stop() {
     if (!mStopRequested.read()) {
         mStopRequested = true;
         mFinishedTimer.reset();
+        profiler->stop();
         startForceQuitTimer();
     }
 }
@@ -208,6 +216,7 @@ void Context::setCommander(Command::Commander* c) {
         mCommander->unregisterCommand("context.shutdown");
         mCommander->unregisterCommand("context.report-stats");
         mCommander->unregisterCommand("context.report-all-stats");
+        mCommander->unregisterCommand("context.profiler");
     }
 
     mCommander = c;
@@ -226,6 +235,10 @@ void Context::setCommander(Command::Commander* c) {
             "context.report-all-stats",
             std::tr1::bind(&Network::IOService::commandReportAllStats, _1, _2, _3)
         );
+        mCommander->registerCommand(
+            "context.profiler",
+            std::tr1::bind(&TimeProfiler::commandReport, profiler, _1, _2, _3)
+        );
     }
 }
 
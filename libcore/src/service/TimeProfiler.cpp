@@ -33,6 +33,8 @@
 #include <sirikata/core/util/Standard.hh>
 #include <sirikata/core/service/TimeProfiler.hpp>
 #include <sirikata/core/service/Context.hpp>
+#include <sirikata/core/service/Poller.hpp>
+#include <sirikata/core/command/Commander.hpp>
 
 #define PROFILER_LOG(level,msg) SILOG(profiler,level,msg)
 
@@ -75,6 +77,7 @@ void TimeProfiler::Stage::finished() {
 
     mSum += dur;
     mIts++;
+    mHistogram.record(dur);
 }
 
 String TimeProfiler::Stage::name() const {
@@ -97,16 +100,57 @@ uint64 TimeProfiler::Stage::its() const {
     return mIts;
 }
 
+Duration TimeProfiler::Stage::percentile(float64 frac) const {
+    return mHistogram.percentile(frac);
+}
+
 void TimeProfiler::Stage::report(const String& indent) const {
-    PROFILER_LOG(info,"Stage: " << indent << name() << " -- Avg: " << avg() << " Min: " << minimum() << " Max:" << maximum() << " Sum: " << mSum << "  Its: " << its());
+    PROFILER_LOG(info,"Stage: " << indent << name() << " -- Avg: " << avg() << " Min: " << minimum() << " Max:" << maximum() << " Sum: " << mSum << "  Its: " << its() << " 99%: " << percentile(.99));
+}
+
+namespace {
+
+// Graphite (and most other time series backends) use . to separate
+// components of the name, so other special characters are replaced.
+String sanitizeSeriesName(const String& orig) {
+    String result = orig;
+    for(String::size_type i = 0; i < result.size(); i++) {
+        char c = result[i];
+        if (!isalnum(c) && c != '_' && c != '-')
+            result[i] = '_';
+    }
+    return result;
+}
+
+void fillHistogramResult(const Trace::LatencyHistogram& hist, Command::Result& res, const String& prefix) {
+    res.put(prefix + "count", hist.count());
+    res.put(prefix + "mean", hist.mean().toString());
+    res.put(prefix + "p50", hist.percentile(.5).toString());
+    res.put(prefix + "p90", hist.percentile(.9).toString());
+    res.put(prefix + "p99", hist.percentile(.99).toString());
+    res.put(prefix + "max", hist.maximum().toString());
+}
+
+void reportHistogram(Trace::TimeSeries* ts, const Trace::LatencyHistogram& hist, const String& prefix) {
+    // Values are reported in milliseconds
+    ts->report(prefix + ".count", hist.count());
+    ts->report(prefix + ".mean", hist.mean().toSeconds() * 1000.0);
+    ts->report(prefix + ".p50", hist.percentile(.5).toSeconds() * 1000.0);
+    ts->report(prefix + ".p90", hist.percentile(.9).toSeconds() * 1000.0);
+    ts->report(prefix + ".p99", hist.percentile(.99).toSeconds() * 1000.0);
+    ts->report(prefix + ".max", hist.maximum().toSeconds() * 1000.0);
+}
+
 }
 
 TimeProfiler::TimeProfiler(const Context* ctx, const String& name)
- : mContext(ctx), mName(name)
+ : mContext(ctx), mName(name), mStrandProfiling(true), mReportPoller(NULL)
 {
 }
 
 TimeProfiler::~TimeProfiler() {
+    delete mReportPoller;
+
     // Ownership of stages remains with the caller of addStage. Instead, we just
     // invalidate pointers to us in those stages that still exist
 
@@ -121,18 +165,81 @@ TimeProfiler::~TimeProfiler() {
 }
 
 TimeProfiler::Stage* TimeProfiler::addStage(const String& name) {
+    boost::lock_guard<boost::mutex> lck(mMutex);
     Stage* sinfo = new Stage(this, name);
     mFreeStages.push_back(sinfo);
     return sinfo;
 }
 
 TimeProfiler::Stage* TimeProfiler::addStage(const String& group_name, const String& name) {
+    boost::lock_guard<boost::mutex> lck(mMutex);
     Stage* sinfo = new Stage(this, name);
     mGroups[group_name].push_back(sinfo);
     return sinfo;
 }
 
+void TimeProfiler::addStrand(Network::IOStrand* strand) {
+    boost::lock_guard<boost::mutex> lck(mMutex);
+    StrandHistograms hists;
+    hists.strand = strand;
+    hists.name = strand->name();
+    hists.queueDelay = Trace::LatencyHistogramPtr(new Trace::LatencyHistogram());
+    hists.handlers = Trace::TaggedLatencyHistogramsPtr(new Trace::TaggedLatencyHistograms());
+    mStrands.push_back(hists);
+    strand->enableProfiling(hists.queueDelay, hists.handlers, mStrandProfiling);
+}
+
+void TimeProfiler::setStrandProfiling(bool enabled) {
+    boost::lock_guard<boost::mutex> lck(mMutex);
+    mStrandProfiling = enabled;
+    for(StrandList::iterator sit = mStrands.begin(); sit != mStrands.end(); sit++)
+        sit->strand->setProfilingEnabled(enabled);
+}
+
+bool TimeProfiler::strandProfiling() const {
+    boost::lock_guard<boost::mutex> lck(mMutex);
+    return mStrandProfiling;
+}
+
+void TimeProfiler::reset() {
+    boost::lock_guard<boost::mutex> lck(mMutex);
+    resetNoLock();
+}
+
+void TimeProfiler::resetNoLock() {
+    for(GroupMap::iterator git = mGroups.begin(); git != mGroups.end(); git++) {
+        for(StageList::iterator it = git->second.begin(); it != git->second.end(); it++)
+            (*it)->mHistogram.reset();
+    }
+    for(StageList::iterator it = mFreeStages.begin(); it != mFreeStages.end(); it++)
+        (*it)->mHistogram.reset();
+
+    for(StrandList::iterator sit = mStrands.begin(); sit != mStrands.end(); sit++) {
+        sit->queueDelay->reset();
+        sit->handlers->reset();
+    }
+}
+
+void TimeProfiler::start() {
+    if (mReportPoller == NULL) {
+        mReportPoller = new Poller(
+            mContext->mainStrand,
+            std::tr1::bind(&TimeProfiler::reportTimeSeries, this),
+            "TimeProfiler::reportTimeSeries",
+            Duration::seconds((int64)10)
+        );
+    }
+    mReportPoller->start();
+}
+
+void TimeProfiler::stop() {
+    if (mReportPoller != NULL)
+        mReportPoller->stop();
+}
+
 void TimeProfiler::remove(Stage* stage) {
+    boost::lock_guard<boost::mutex> lck(mMutex);
+
     // This could be handled better, but here we just iterate through all the
     // stages looking for the one we're removing.
     for(GroupMap::iterator git = mGroups.begin(); git != mGroups.end(); git++) {
@@ -153,6 +260,7 @@ void TimeProfiler::remove(Stage* stage) {
 }
 
 void TimeProfiler::report() const {
+    boost::lock_guard<boost::mutex> lck(mMutex);
     PROFILER_LOG(info,"Profiler report: " << mName << " (" << mContext->recentSimTime()-Time::null() << ")");
 
     // Group stages
@@ -173,4 +281,90 @@ void TimeProfiler::report() const {
     }
 }
 
+void TimeProfiler::commandReport(const Command::Command& cmd, Command::Commander* cmdr, Command::CommandID cmdid) {
+    Command::Result result = Command::EmptyResult();
+    result.put("name", mName);
+
+    if (cmd.contains("strands"))
+        setStrandProfiling(cmd.getBool("strands"));
+
+    {
+        boost::lock_guard<boost::mutex> lck(mMutex);
+        result.put("strands-enabled", mStrandProfiling);
+
+        // Stages, with ungrouped stages under an empty group name
+        result.put("groups", Command::Array());
+        Command::Array& groups = result.getArray("groups");
+        for(GroupMap::const_iterator git = mGroups.begin(); git != mGroups.end(); git++) {
+            groups.push_back(Command::Object());
+            Command::Result& group = groups.back();
+            group.put("name", git->first);
+            group.put("stages", Command::Array());
+            Command::Array& stages = group.getArray("stages");
+            for(StageList::const_iterator it = git->second.begin(); it != git->second.end(); it++) {
+                stages.push_back(Command::Object());
+                stages.back().put("name", (*it)->name());
+                fillHistogramResult((*it)->histogram(), stages.back(), "");
+            }
+        }
+        if (!mFreeStages.empty()) {
+            groups.push_back(Command::Object());
+            Command::Result& group = groups.back();
+            group.put("name", "");
+            group.put("stages", Command::Array());
+            Command::Array& stages = group.getArray("stages");
+            for(StageList::const_iterator it = mFreeStages.begin(); it != mFreeStages.end(); it++) {
+                stages.push_back(Command::Object());
+                stages.back().put("name", (*it)->name());
+                fillHistogramResult((*it)->histogram(), stages.back(), "");
+            }
+        }
+
+        // Strands, with queueing delay and per-tag handler times
+        result.put("strands", Command::Array());
+        Command::Array& strands = result.getArray("strands");
+        for(StrandList::const_iterator sit = mStrands.begin(); sit != mStrands.end(); sit++) {
+            strands.push_back(Command::Object());
+            Command::Result& strand = strands.back();
+            strand.put("name", sit->name);
+            fillHistogramResult(*(sit->queueDelay), strand, "queue.");
+            strand.put("handlers", Command::Array());
+            Command::Array& handlers = strand.getArray("handlers");
+            for(uint32 i = 0; i < sit->handlers->size(); i++) {
+                handlers.push_back(Command::Object());
+                handlers.back().put("tag", String(sit->handlers->tag(i)));
+                fillHistogramResult(sit->handlers->histogram(i), handlers.back(), "");
+            }
+        }
+
+        if (cmd.contains("reset") && cmd.getBool("reset"))
+            resetNoLock();
+    }
+
+    cmdr->result(cmdid, result);
+}
+
+void TimeProfiler::reportTimeSeries() {
+    Trace::TimeSeries* ts = mContext->timeSeries;
+    if (ts == NULL) return;
+
+    boost::lock_guard<boost::mutex> lck(mMutex);
+    String prefix = sanitizeSeriesName(mName) + ".profiler";
+
+    for(GroupMap::const_iterator git = mGroups.begin(); git != mGroups.end(); git++) {
+        String group_prefix = prefix + "." + sanitizeSeriesName(git->first);
+        for(StageList::const_iterator it = git->second.begin(); it != git->second.end(); it++)
+            reportHistogram(ts, (*it)->histogram(), group_prefix + "." + sanitizeSeriesName((*it)->name()));
+    }
+    for(StageList::const_iterator it = mFreeStages.begin(); it != mFreeStages.end(); it++)
+        reportHistogram(ts, (*it)->histogram(), prefix + "." + sanitizeSeriesName((*it)->name()));
+
+    for(StrandList::const_iterator sit = mStrands.begin(); sit != mStrands.end(); sit++) {
+        String strand_prefix = prefix + ".strands." + sanitizeSeriesName(sit->name);
+        reportHistogram(ts, *(sit->queueDelay), strand_prefix + ".queue");
+        for(uint32 i = 0; i < sit->handlers->size(); i++)
+            reportHistogram(ts, sit->handlers->histogram(i), strand_prefix + ".handlers." + sanitizeSeriesName(sit->handlers->tag(i)));
+    }
+}
+
 } // namespace Sirikata
@@ -0,0 +1,159 @@
+// Copyright (c) 2015 Sirikata Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can
+// be found in the LICENSE file.
+
+#include <sirikata/core/util/Standard.hh>
+#include <sirikata/core/trace/LatencyHistogram.hpp>
+
+namespace Sirikata {
+namespace Trace {
+
+LatencyHistogram::LatencyHistogram()
+{
+    reset();
+}
+
+uint32 LatencyHistogram::bucketIndex(uint64 val) {
+    if (val < SubBuckets)
+        return (uint32)val;
+
+    uint64 max_val = (((uint64)1) << MaxExponent) - 1;
+    if (val > max_val) val = max_val;
+
+    // Find the power of two, i.e. the position of the highest set bit
+    uint32 exponent = 0;
+    for(uint64 v = val; v > 1; v >>= 1)
+        exponent++;
+    // The top SubBucketBits+1 bits select the linear sub-bucket
+    uint32 sub = (uint32)(val >> (exponent - SubBucketBits)) - SubBuckets;
+    return (exponent - SubBucketBits + 1) * SubBuckets + sub;
+}
+
+uint64 LatencyHistogram::bucketUpperBound(uint32 idx) {
+    uint32 group = idx / SubBuckets;
+    uint64 sub = idx % SubBuckets;
+    if (group == 0)
+        return sub;
+    uint32 shift = group - 1;
+    return ((SubBuckets + sub + 1) << shift) - 1;
+}
+
+void LatencyHistogram::record(const Duration& dur) {
+    int64 us = dur.toMicro();
+    uint64 val = (us > 0 ? (uint64)us : 0);
+
+    mBuckets[bucketIndex(val)]++;
+    mCount++;
+    mSum += val;
+    // Racy, but we can only lose a maximum to another, nearly concurrent
+    // maximum
+    if (val > mMax.read())
+        mMax = val;
+}
+
+void LatencyHistogram::reset() {
+    for(uint32 i = 0; i < NumBuckets; i++)
+        mBuckets[i] = 0;
+    mCount = 0;
+    mSum = 0;
+    mMax = 0;
+}
+
+uint64 LatencyHistogram::count() const {
+    return mCount.read();
+}
+
+Duration LatencyHistogram::mean() const {
+    uint64 count = mCount.read();
+    if (count == 0) return Duration::zero();
+    return Duration::microseconds((int64)(mSum.read() / count));
+}
+
+Duration LatencyHistogram::maximum() const {
+    return Duration::microseconds((int64)mMax.read());
+}
+
+Duration LatencyHistogram::percentile(float64 frac) const {
+    // Use the sum of the buckets rather than mCount so we're consistent with
+    // the buckets we scan.
+    uint64 total = 0;
+    for(uint32 i = 0; i < NumBuckets; i++)
+        total += mBuckets[i].read();
+    if (total == 0) return Duration::zero();
+
+    if (frac < 0) frac = 0;
+    if (frac > 1) frac = 1;
+    uint64 target = (uint64)(frac * total + .5);
+    if (target == 0) target = 1;
+
+    uint64 seen = 0;
+    for(uint32 i = 0; i < NumBuckets; i++) {
+        seen += mBuckets[i].read();
+        if (seen >= target)
+            return Duration::microseconds((int64)std::min(bucketUpperBound(i), mMax.read()));
+    }
+    return maximum();
+}
+
+
+
+TaggedLatencyHistograms::TaggedLatencyHistograms()
+ : mSize(0)
+{
+}
+
+TaggedLatencyHistograms::~TaggedLatencyHistograms() {
+    uint32 sz = mSize.read();
+    for(uint32 i = 0; i < sz; i++)
+        delete mHistograms[i];
+}
+
+void TaggedLatencyHistograms::record(const char* tag, const Duration& dur) {
+    LatencyHistogram* hist = lookup(tag);
+    if (hist != NULL)
+        hist->record(dur);
+}
+
+void TaggedLatencyHistograms::reset() {
+    uint32 sz = mSize.read();
+    for(uint32 i = 0; i < sz; i++)
+        mHistograms[i]->reset();
+}
+
+LatencyHistogram* TaggedLatencyHistograms::lookup(const char* tag) {
+    // Fast path, no locking for existing entries
+    uint32 sz = mSize.read();
+    for(uint32 i = 0; i < sz; i++) {
+        if (mTags[i] == tag) return mHistograms[i];
+    }
+
+    boost::lock_guard<boost::mutex> lck(mMutex);
+    // Someone else may have added it or more entries
+    sz = mSize.read();
+    for(uint32 i = 0; i < sz; i++) {
+        if (mTags[i] == tag) return mHistograms[i];
+    }
+    if (sz >= MaxTags) return NULL;
+
+    mTags[sz] = tag;
+    mHistograms[sz] = new LatencyHistogram();
+    mSize++;
+    return mHistograms[sz];
+}
+
+uint32 TaggedLatencyHistograms::size() const {
+    return mSize.read();
+}
+
+const char* TaggedLatencyHistograms::tag(uint32 idx) const {
+    assert(idx < mSize.read());
+    return (mTags[idx] != NULL ? mTags[idx] : "(untagged)");
+}
+
+const LatencyHistogram& TaggedLatencyHistograms::histogram(uint32 idx) const {
+    assert(idx < mSize.read());
+    return *(mHistograms[idx]);
+}
+
+} // namespace Trace
+} // namespace Sirikata
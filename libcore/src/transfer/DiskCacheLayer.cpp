@@ -35,6 +35,10 @@
 
 #include <sirikata/core/options/Options.hpp>
 #include <sirikata/core/util/Paths.hpp>
+#include <sirikata/core/util/Timer.hpp>
+#include <sirikata/core/jpeg-arhc/Decoder.hpp>
+#include <sirikata/core/jpeg-arhc/Compression.hpp>
+#include <sirikata/core/jpeg-arhc/MultiCompression.hpp>
 
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -83,6 +87,8 @@ namespace Transfer {
 
 static const char *PARTIAL_SUFFIX = ".part";
 static const char *RANGES_SUFFIX = ".ranges";
+static const char *COMPRESSED_SUFFIX = ".arhc";
+static const char *TEMP_SUFFIX = ".temp";
 
 namespace {
 
@@ -175,12 +181,44 @@ cache_usize_type sizeFromDirentry(const std::string &name, dirent *ent, bool &is
 
 #endif
 
+bool hasSuffix(const std::string &name, const char *suffix) {
+	return name.length() > strlen(suffix) &&
+		name.substr(name.length()-strlen(suffix)) == suffix;
+}
+
+bool readWholeFile(const std::string &path, std::vector<uint8, JpegAllocator<uint8> > &out) {
+	FILE *fp = fopen(path.c_str(), "rb");
+	if (!fp) {
+		return false;
+	}
+	fseek(fp, 0, SEEK_END);
+	long size = ftell(fp);
+	fseek(fp, 0, SEEK_SET);
+	bool ok = size >= 0;
+	if (ok) {
+		out.resize(size);
+		ok = size == 0 || fread(&out[0], (size_t)size, 1, fp) == 1;
+	}
+	fclose(fp);
+	return ok;
+}
+
+bool looksLikeJpeg(const std::vector<uint8, JpegAllocator<uint8> > &data) {
+	return data.size() > 3 && data[0] == 0xFF && data[1] == 0xD8 && data[2] == 0xFF;
+}
+
 } // anon namespace.
 
-DiskCacheLayer::DiskCacheLayer(CachePolicy *policy, const std::string &prefix, CacheLayer *tryNext)
+DiskCacheLayer::DiskCacheLayer(CachePolicy *policy, const std::string &prefix, CacheLayer *tryNext,
+	const CompressionOptions &compression)
  : CacheLayer(tryNext),
    mFiles(NULL, policy),
    mPrefix(),
+   mCompression(compression),
+   mCompressionThread(NULL),
+   mStopCompression(false),
+   mCompressContext(NULL),
+   mDecompressContext(NULL),
    mCleaningUp(false)
 {
     // If absolute, use directly. Otherwise, append to temp directory
@@ -188,7 +226,22 @@ DiskCacheLayer::DiskCacheLayer(CachePolicy *policy, const std::string &prefix, C
     if (mPrefix[mPrefix.size()-1] != '/')
         mPrefix += '/';
 
+    if (mCompression.threads < 1)
+        mCompression.threads = 1;
+    if (mCompression.threads > MAX_COMPRESSION_THREADS)
+        mCompression.threads = MAX_COMPRESSION_THREADS;
+    if (mCompression.cpuFraction <= 0.f || mCompression.cpuFraction > 1.f)
+        mCompression.cpuFraction = 1.f;
+
     mFiles.setOwner(this);
+    // The decompression context is always created so entries compressed by
+    // an earlier run stay readable after the tier is switched off.
+    JpegAllocator<uint8> alloc;
+    mDecompressContext = MakeThreadContext(mCompression.threads, alloc);
+    if (mCompression.enabled) {
+        mCompressContext = MakeThreadContext(mCompression.threads, alloc);
+        mCompressionThread = new Thread("DiskCacheLayer Compression", std::tr1::bind(&DiskCacheLayer::compressionThread, this));
+    }
     mWorkerThread=new Thread("DiskCacheLayer", std::tr1::bind(&DiskCacheLayer::workerThread, this));
     try {
         unserialize();
@@ -198,6 +251,208 @@ DiskCacheLayer::DiskCacheLayer(CachePolicy *policy, const std::string &prefix, C
     }
 }
 
+DiskCacheLayer::~DiskCacheLayer() {
+	if (mCompressionThread) {
+		// Anything still waiting to be compressed just stays uncompressed;
+		// it'll be picked up again the next time the cache is loaded.
+		mStopCompression = true;
+		std::deque<std::tr1::shared_ptr<DiskRequest> > pending;
+		mCompressionQueue.popAll(&pending);
+		std::tr1::shared_ptr<DiskRequest> req
+			(new DiskRequest(DiskRequest::OPEXIT, Fingerprint(), Range(true)));
+		mCompressionQueue.push(req);
+		mCompressionThread->join();
+		delete mCompressionThread;
+	}
+
+	std::tr1::shared_ptr<DiskRequest> req
+		(new DiskRequest(DiskRequest::OPEXIT, Fingerprint(), Range(true)));
+	boost::unique_lock<boost::mutex> sleep_cv(destroyLock);
+	mRequestQueue.push(req);
+	destroyCV.wait(sleep_cv); // we know the thread has terminated.
+
+	mCleaningUp = true; // don't allow destroyCacheEntry to delete files.
+	delete mWorkerThread;
+
+	if (mCompressContext)
+		DestroyThreadContext(mCompressContext);
+	DestroyThreadContext(mDecompressContext);
+
+	if (mCompression.enabled) {
+		CompressionStats stats = compressionStats();
+		SILOG(transfer,info,"Disk cache compression: " << stats.entriesCompressed <<
+			" entries compressed, " << stats.entriesSkipped << " skipped, " <<
+			stats.bytesSaved() << " bytes saved");
+	}
+}
+
+void DiskCacheLayer::queueCompression(const Fingerprint &fileId) {
+	if (!mCompression.enabled) {
+		return;
+	}
+	std::tr1::shared_ptr<DiskRequest> req
+		(new DiskRequest(DiskRequest::OPCOMPRESS, fileId, Range(true)));
+	mCompressionQueue.push(req);
+}
+
+void DiskCacheLayer::compressionThread() {
+	while (true) {
+		std::tr1::shared_ptr<DiskRequest> req;
+
+		mCompressionQueue.blockingPop(req);
+		if (req->op == DiskRequest::OPEXIT || mStopCompression.read()) {
+			break;
+		}
+		Time start = Timer::now();
+		compressEntry(req->fileId);
+		// Stay within the CPU budget by idling in proportion to the time
+		// just spent compressing.
+		Duration busy = Timer::now() - start;
+		if (mCompression.cpuFraction < 1.f && busy > Duration::zero()) {
+			Timer::sleep(busy * ((1.f - mCompression.cpuFraction) / mCompression.cpuFraction));
+		}
+	}
+}
+
+void DiskCacheLayer::compressEntry(const Fingerprint &fileId) {
+	{
+		CacheMap::read_iterator iter(mFiles);
+		if (!iter.find(fileId)) {
+			return; // evicted while queued.
+		}
+		const CacheData *cdata = static_cast<const CacheData*>(*iter);
+		if (!cdata->wholeFile() || cdata->compressed) {
+			return;
+		}
+	}
+
+	std::string fileIdStr = fileId.convertToHexString();
+	std::string filePath = mPrefix + fileIdStr;
+	std::string compressedPath = filePath + COMPRESSED_SUFFIX;
+	std::string tempPath = compressedPath + TEMP_SUFFIX;
+
+	// Check the size before reading anything so oversized entries cost
+	// nothing more than a stat.
+	cache_usize_type originalUsage, compressedUsage;
+	{
+		struct stat64 st;
+		if (stat64(filePath.c_str(), &st) != 0) {
+			return;
+		}
+		if ((cache_usize_type)st.st_size > mCompression.maxEntrySize) {
+			boost::unique_lock<boost::mutex> lock(mStatsLock);
+			mStats.entriesSkipped++;
+			return;
+		}
+		originalUsage = getDiskUsage(&st);
+	}
+
+	JpegAllocator<uint8> alloc;
+	std::vector<uint8, JpegAllocator<uint8> > contents(alloc);
+	if (!readWholeFile(filePath, contents) || !looksLikeJpeg(contents)) {
+		return;
+	}
+	MemReadWriter original(alloc);
+	original.CopyIn(contents, 0);
+	size_t originalSize = contents.size();
+
+	// LZHAM rather than xz: slightly larger, but much cheaper to decode on
+	// the read path.
+	MemReadWriter arhc(alloc);
+	JpegError err = CompressJPEGtoARHCMulti(original, arhc, 6, Decoder::comp12coalesce,
+		true, mCompressContext);
+	bool useful = (err == JpegError::nil()) &&
+		arhc.buffer().size() <= originalSize * (1.f - mCompression.minSavings);
+	if (useful) {
+		// Only ever trade the original for something that provably
+		// decodes back to it.
+		MemReadWriter roundTrip(alloc);
+		err = DecompressARHCtoJPEGMulti(arhc, roundTrip, mCompressContext);
+		useful = (err == JpegError::nil()) && roundTrip.buffer() == contents;
+	}
+	if (!useful) {
+		SILOG(transfer,detailed,"Not compressing " << fileIdStr << " in disk cache");
+		boost::unique_lock<boost::mutex> lock(mStatsLock);
+		mStats.entriesSkipped++;
+		return;
+	}
+
+	int fd = open(tempPath.c_str(), O_CREAT|O_WRONLY|O_TRUNC|DEFAULT_OPEN_OPTIONS, 0666);
+	if (fd < 0) {
+		SILOG(transfer,error, "Failed to open " << tempPath <<
+			" for writing; reason: " << errno);
+		return;
+	}
+	bool written = write(fd, &arhc.buffer()[0], arhc.buffer().size()) == (cache_ssize_type)arhc.buffer().size();
+	{
+		struct stat64 st;
+		fstat64(fd, &st);
+		compressedUsage = getDiskUsage(&st);
+	}
+	close(fd);
+	if (!written) {
+		unlink(tempPath.c_str());
+		return;
+	}
+
+	{
+		CacheMap::write_iterator writer(mFiles);
+		if (!writer.find(fileId) ||
+			!static_cast<CacheData*>(*writer)->wholeFile() ||
+			static_cast<CacheData*>(*writer)->compressed) {
+			// Evicted or rewritten while we were compressing.
+			unlink(tempPath.c_str());
+			return;
+		}
+		rename(tempPath.c_str(), compressedPath.c_str());
+		static_cast<CacheData*>(*writer)->compressed = true;
+		writer.update(compressedUsage);
+	}
+	// Readers that saw the entry as uncompressed fall back to the
+	// compressed file if this disappears under them.
+	unlink(filePath.c_str());
+
+	{
+		boost::unique_lock<boost::mutex> lock(mStatsLock);
+		mStats.entriesCompressed++;
+		mStats.bytesBefore += originalUsage;
+		mStats.bytesAfter += compressedUsage;
+	}
+	SILOG(transfer,detailed,"Compressed " << fileIdStr << " in disk cache from " <<
+		originalUsage << " to " << compressedUsage << " bytes");
+}
+
+bool DiskCacheLayer::readCompressed(const std::string &filePath, Range &toRead, MutableDenseDataPtr &datum) {
+	JpegAllocator<uint8> alloc;
+	std::vector<uint8, JpegAllocator<uint8> > contents(alloc);
+	if (!readWholeFile(filePath, contents)) {
+		return false;
+	}
+	MemReadWriter arhc(alloc);
+	arhc.SwapIn(contents, 0);
+	MemReadWriter jpeg(alloc);
+	JpegError err = DecompressARHCtoJPEGMulti(arhc, jpeg, mDecompressContext);
+	if (err != JpegError::nil()) {
+		SILOG(transfer,error, "Failed to decompress " << filePath << ": " << err.what());
+		return false;
+	}
+	cache_usize_type fileSize = jpeg.buffer().size();
+	if (toRead.goesToEndOfFile()) {
+		if (toRead.startbyte() > fileSize) {
+			return false;
+		}
+		toRead.setLength(fileSize - toRead.startbyte(), true);
+	}
+	if (toRead.endbyte() > fileSize) {
+		return false;
+	}
+	datum.reset(new DenseData(toRead));
+	if (toRead.length()) {
+		memcpy(datum->writableData(), &jpeg.buffer()[toRead.startbyte()], (size_t)toRead.length());
+	}
+	return true;
+}
+
 void DiskCacheLayer::workerThread() {
 	while (true) {
 		std::tr1::shared_ptr<DiskRequest> req;
@@ -269,6 +524,7 @@ void DiskCacheLayer::workerThread() {
 				// first do atomic rename, the delete ranges file.
 				rename(filePath.c_str(), renameToPath.c_str());
 				unlink(rangesPath.c_str());
+				queueCompression(req->fileId);
 			} else {
 				std::string rangesTempPath = rangesPath + ".temp";
 				FILE * fp = fopen(rangesTempPath.c_str(), "wb");
@@ -278,12 +534,14 @@ void DiskCacheLayer::workerThread() {
 			}
 		} else if (req->op == DiskRequest::OPREAD) {
 			bool useWholeFile = false;
+			bool useCompressed = false;
 			{
 				CacheMap::read_iterator iter(mFiles);
 				if (iter.find(req->fileId)) {
 					CacheData *rlist = static_cast<CacheData*>(*iter);
 					if (rlist->wholeFile()) {
 						useWholeFile = true;
+						useCompressed = rlist->compressed;
 					} else if (!rlist->contains(req->toRead)) {
 						// this range is already written to disk.
 						CacheLayer::getData(req->fileId, req->toRead, req->finished);
@@ -296,7 +554,24 @@ void DiskCacheLayer::workerThread() {
 			if (!useWholeFile) {
 				filePath += PARTIAL_SUFFIX;
 			}
-			int fd = open(filePath.c_str(), O_RDONLY|DEFAULT_OPEN_OPTIONS);
+			int fd = -1;
+			if (!useCompressed) {
+				fd = open(filePath.c_str(), O_RDONLY|DEFAULT_OPEN_OPTIONS);
+				// The compression thread may have just replaced the file.
+				useCompressed = (fd < 0 && useWholeFile);
+			}
+			if (useCompressed) {
+				MutableDenseDataPtr datum;
+				if (!readCompressed(filePath + COMPRESSED_SUFFIX, req->toRead, datum)) {
+					CacheLayer::getData(req->fileId, req->toRead, req->finished);
+					continue;
+				}
+				CacheLayer::populateParentCaches(req->fileId, datum);
+				SparseData data;
+				data.addValidData(datum);
+				req->finished(&data);
+				continue;
+			}
 			if (fd < 0) {
 				SILOG(transfer,error, "Failed to open " << fileId <<
 					"for writing; reason: " << errno);
@@ -334,6 +609,8 @@ void DiskCacheLayer::workerThread() {
 			unlink(rangesPath.c_str());
 			std::string partialPath = filePath + PARTIAL_SUFFIX;
 			unlink(partialPath.c_str());
+			std::string compressedPath = filePath + COMPRESSED_SUFFIX;
+			unlink(compressedPath.c_str());
 		}
 	}
 	{
@@ -388,7 +665,10 @@ void DiskCacheLayer::unserialize() {
 			CacheData *cdata = new CacheData();
 			std::string fingerprintName(strName);
 			bool thisispartial = false;
-			if (strName.length() > strlen(PARTIAL_SUFFIX) &&
+			if (hasSuffix(strName, COMPRESSED_SUFFIX)) {
+				fingerprintName = strName.substr(0, strName.length()-strlen(COMPRESSED_SUFFIX));
+				cdata->compressed = true;
+			} else if (strName.length() > strlen(PARTIAL_SUFFIX) &&
 					strName.substr(strName.length()-strlen(PARTIAL_SUFFIX)) == PARTIAL_SUFFIX) {
 				thisispartial = true;
 				fingerprintName = strName.substr(0, strName.length()-strlen(PARTIAL_SUFFIX));
@@ -416,6 +696,26 @@ void DiskCacheLayer::unserialize() {
 				continue;
 			}
 
+                        if (writer.find(fprint) &&
+                            (cdata->compressed || static_cast<CacheData*>(*writer)->compressed)) {
+                            // The compressed copy exists alongside the
+                            // original or a partial download, e.g. after a
+                            // crash between the rename and the unlink. The
+                            // compressed one wins and the others are removed
+                            // so they aren't found again on the next start.
+                            CacheData *existing = static_cast<CacheData*>(*writer);
+                            std::string originalPath = mPrefix + fingerprintName;
+                            unlink(originalPath.c_str());
+                            unlink((originalPath + PARTIAL_SUFFIX).c_str());
+                            unlink((originalPath + RANGES_SUFFIX).c_str());
+                            if (!existing->compressed) {
+                                existing->mRanges.clear();
+                                existing->compressed = true;
+                                writer.update(totalLength);
+                            }
+                            delete cdata;
+                            continue;
+                        }
                         if (writer.find(fprint)) {
                             // Some sort of conflict, maybe between
                             // partial/whole files?
@@ -449,6 +749,8 @@ void DiskCacheLayer::unserialize() {
 			if (writer.insert(fprint, totalLength)) {
                             *writer = cdata;
                             writer.use();
+                            if (!thisispartial && !cdata->compressed)
+                                queueCompression(fprint);
                         }
 		}
 		closedir(mydir);
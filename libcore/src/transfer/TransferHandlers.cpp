@@ -1,4 +1,5 @@
 #include <sirikata/core/transfer/TransferHandlers.hpp>
+#include <sirikata/core/options/CommonOptions.hpp>
 
 AUTO_SINGLETON_INSTANCE(Sirikata::Transfer::SharedChunkCache);
 
@@ -13,14 +14,22 @@ void SharedChunkCache::destroy() {
 }
 const unsigned int SharedChunkCache::DISK_LRU_CACHE_SIZE = 1024 * 1024 * 1024; //1GB
 const unsigned int SharedChunkCache::MEMORY_LRU_CACHE_SIZE = 1024 * 1024 * 50; //50MB
+const unsigned int SharedChunkCache::DERIVED_DISK_LRU_CACHE_SIZE = 1024 * 1024 * 256; //256MB
 
 SharedChunkCache::SharedChunkCache() {
     //Use LRU for eviction
     mDiskCachePolicy = new LRUPolicy(DISK_LRU_CACHE_SIZE);
     mMemoryCachePolicy = new LRUPolicy(MEMORY_LRU_CACHE_SIZE);
+    mDerivedCachePolicy = new LRUPolicy(DERIVED_DISK_LRU_CACHE_SIZE);
+
+    DiskCacheLayer::CompressionOptions compression;
+    compression.enabled = GetOptionValue<bool>(OPT_DISK_CACHE_COMPRESS);
+    compression.threads = GetOptionValue<uint32>(OPT_DISK_CACHE_COMPRESS_THREADS);
+    compression.maxEntrySize = GetOptionValue<uint32>(OPT_DISK_CACHE_COMPRESS_MAX_SIZE);
+    compression.cpuFraction = GetOptionValue<float>(OPT_DISK_CACHE_COMPRESS_CPU_FRACTION);
 
     //Make a disk cache as the bottom cache layer
-    CacheLayer* diskCache = new DiskCacheLayer(mDiskCachePolicy, "HttpChunkHandlerCache", NULL);
+    CacheLayer* diskCache = new DiskCacheLayer(mDiskCachePolicy, "HttpChunkHandlerCache", NULL, compression);
     mCacheLayers.push_back(diskCache);
 
     //Make a mem cache on top of the disk cache
@@ -29,6 +38,10 @@ SharedChunkCache::SharedChunkCache() {
 
     //Store top memory cache as the one we'll use
     mCache = memCache;
+
+    //Derived data gets a separate disk cache with nothing on top of it
+    mDerivedCache = new DiskCacheLayer(mDerivedCachePolicy, "DerivedDataCache", NULL, compression);
+    mCacheLayers.push_back(mDerivedCache);
 }
 
 SharedChunkCache::~SharedChunkCache() {
@@ -41,11 +54,16 @@ SharedChunkCache::~SharedChunkCache() {
     //And delete LRU cache policies
     delete mDiskCachePolicy;
     delete mMemoryCachePolicy;
+    delete mDerivedCachePolicy;
 }
 
 CacheLayer* SharedChunkCache::getCache() {
     return mCache;
 }
 
+CacheLayer* SharedChunkCache::getDerivedCache() {
+    return mDerivedCache;
+}
+
 }
 }
@@ -0,0 +1,68 @@
+// Copyright (c) 2015 Sirikata Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can
+// be found in the LICENSE file.
+
+#include <sirikata/core/util/Standard.hh>
+#include <sirikata/core/util/InternedString.hpp>
+
+namespace Sirikata {
+
+namespace {
+const uint32 MinSweepThreshold = 64;
+}
+
+const String& InternedString::emptyString() {
+    static String sEmpty;
+    return sEmpty;
+}
+
+
+InternedStringTable::InternedStringTable()
+ : mSweepThreshold(MinSweepThreshold)
+{
+}
+
+InternedString InternedStringTable::intern(const String& val) {
+    if (val.empty())
+        return InternedString();
+
+    boost::lock_guard<boost::mutex> lck(mMutex);
+
+    StringMap::iterator it = mStrings.find(val);
+    if (it != mStrings.end()) {
+        InternedString::StringPtr existing = it->second.lock();
+        if (existing)
+            return InternedString(existing);
+    }
+
+    InternedString::StringPtr data(new String(val));
+    if (it != mStrings.end()) {
+        // Expired, reuse the slot
+        it->second = data;
+    }
+    else {
+        mStrings.insert(StringMap::value_type(val, data));
+        if (mStrings.size() >= mSweepThreshold)
+            sweep();
+    }
+    return InternedString(data);
+}
+
+uint32 InternedStringTable::size() const {
+    boost::lock_guard<boost::mutex> lck(mMutex);
+    return mStrings.size();
+}
+
+void InternedStringTable::sweep() {
+    for(StringMap::iterator it = mStrings.begin(); it != mStrings.end(); ) {
+        if (it->second.expired())
+            it = mStrings.erase(it);
+        else
+            it++;
+    }
+    // Wait until the table doubles before sweeping again so the cost is
+    // amortized over the inserts.
+    mSweepThreshold = std::max(MinSweepThreshold, (uint32)mStrings.size() * 2);
+}
+
+} // namespace Sirikata
@@ -0,0 +1,117 @@
+// Copyright (c) 2015 Sirikata Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can
+// be found in the LICENSE file.
+
+#include <sirikata/core/util/Standard.hh>
+#include <sirikata/core/util/PackedPriorities.hpp>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SIRIKATA_PACKED_PRIORITIES_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace Sirikata {
+namespace PackedPriorities {
+
+namespace {
+
+// Priority for objects whose bounds contain the viewer
+const float32 InsideBoundsPriority = 0.99f;
+
+inline float32 distanceOne(float32 dx, float32 dy, float32 dz) {
+    float32 len = sqrtf(dx*dx + dy*dy + dz*dz);
+    if (len <= 0) return 1.f;
+    return 1.f / len;
+}
+
+inline float32 solidAngleOne(float32 dx, float32 dy, float32 dz, float32 r) {
+    if (fabsf(dx) <= r && fabsf(dy) <= r && fabsf(dz) <= r)
+        return InsideBoundsPriority;
+    // Outside the bounding box, so also outside the sphere. This is
+    // SolidAngle::fromCenterRadius, 2*pi*(1-cos(alpha)), divided by
+    // SolidAngle::Max, 4*pi.
+    float32 sin_alpha_sq = (r*r) / (dx*dx + dy*dy + dz*dz);
+    float32 cos_alpha = sqrtf(std::max(1.f - sin_alpha_sq, 0.f));
+    return 0.5f * (1.f - cos_alpha);
+}
+
+} // namespace
+
+void distance(
+    const Vector3f& viewer,
+    const float32* x, const float32* y, const float32* z,
+    uint32 count, float32* out)
+{
+    uint32 i = 0;
+#ifdef SIRIKATA_PACKED_PRIORITIES_SSE2
+    const __m128 vx = _mm_set1_ps(viewer.x);
+    const __m128 vy = _mm_set1_ps(viewer.y);
+    const __m128 vz = _mm_set1_ps(viewer.z);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.f);
+    for(; i + 4 <= count; i += 4) {
+        __m128 dx = _mm_sub_ps(vx, _mm_loadu_ps(x + i));
+        __m128 dy = _mm_sub_ps(vy, _mm_loadu_ps(y + i));
+        __m128 dz = _mm_sub_ps(vz, _mm_loadu_ps(z + i));
+        __m128 len = _mm_sqrt_ps(
+            _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz))
+        );
+        __m128 at_viewer = _mm_cmple_ps(len, zero);
+        __m128 inv = _mm_div_ps(one, len);
+        _mm_storeu_ps(out + i,
+            _mm_or_ps(_mm_and_ps(at_viewer, one), _mm_andnot_ps(at_viewer, inv))
+        );
+    }
+#endif
+    for(; i < count; i++)
+        out[i] = distanceOne(viewer.x - x[i], viewer.y - y[i], viewer.z - z[i]);
+}
+
+void solidAngle(
+    const Vector3f& viewer,
+    const float32* x, const float32* y, const float32* z, const float32* radius,
+    uint32 count, float32* out)
+{
+    uint32 i = 0;
+#ifdef SIRIKATA_PACKED_PRIORITIES_SSE2
+    const __m128 vx = _mm_set1_ps(viewer.x);
+    const __m128 vy = _mm_set1_ps(viewer.y);
+    const __m128 vz = _mm_set1_ps(viewer.z);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.f);
+    const __m128 half = _mm_set1_ps(0.5f);
+    const __m128 inside = _mm_set1_ps(InsideBoundsPriority);
+    // Clears the sign bit for fabs
+    const __m128 abs_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+    for(; i + 4 <= count; i += 4) {
+        __m128 r = _mm_loadu_ps(radius + i);
+        __m128 dx = _mm_sub_ps(vx, _mm_loadu_ps(x + i));
+        __m128 dy = _mm_sub_ps(vy, _mm_loadu_ps(y + i));
+        __m128 dz = _mm_sub_ps(vz, _mm_loadu_ps(z + i));
+
+        __m128 in_box = _mm_and_ps(
+            _mm_and_ps(
+                _mm_cmple_ps(_mm_and_ps(dx, abs_mask), r),
+                _mm_cmple_ps(_mm_and_ps(dy, abs_mask), r)
+            ),
+            _mm_cmple_ps(_mm_and_ps(dz, abs_mask), r)
+        );
+
+        // Lanes inside the box may divide by zero here, but they're replaced
+        // by the constant below
+        __m128 dist_sq = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+        __m128 sin_alpha_sq = _mm_div_ps(_mm_mul_ps(r, r), dist_sq);
+        __m128 cos_alpha = _mm_sqrt_ps(_mm_max_ps(_mm_sub_ps(one, sin_alpha_sq), zero));
+        __m128 sa = _mm_mul_ps(half, _mm_sub_ps(one, cos_alpha));
+
+        _mm_storeu_ps(out + i,
+            _mm_or_ps(_mm_and_ps(in_box, inside), _mm_andnot_ps(in_box, sa))
+        );
+    }
+#endif
+    for(; i < count; i++)
+        out[i] = solidAngleOne(viewer.x - x[i], viewer.y - y[i], viewer.z - z[i], radius[i]);
+}
+
+} // namespace PackedPriorities
+} // namespace Sirikata
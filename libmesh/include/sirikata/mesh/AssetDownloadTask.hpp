@@ -19,10 +19,11 @@ typedef std::tr1::shared_ptr<ParseMeshTaskInfo> ParseMeshTaskHandle;
  *  dependencies. It builds upon the basic functionality of
  *  ResourceDownloadTask.
  *
- *  Eventually this class should handle progressive downloads, letting you know
- *  when some minimum loadable unit is available, and then providing additional
- *  callbacks as more data becomes available. Currently, it just manages
- *  downloading all dependencies and notifying you when the are complete.
+ *  By default it downloads the asset and all its dependencies and notifies you
+ *  when they are complete. In streaming mode, textures with progressive
+ *  mipmaps are first fetched at a low resolution so you are notified as soon as
+ *  the asset is usable, and then higher resolution mipmaps are fetched and
+ *  delivered through additional callbacks.
  */
 class SIRIKATA_MESH_EXPORT AssetDownloadTask : public SelfWeakPtr<AssetDownloadTask>{
 public:
@@ -33,15 +34,31 @@ public:
         Transfer::DenseDataPtr response;
     };
     typedef std::map<Transfer::URI, ResourceData> Dependencies;
+    // Invoked with the new data for a dependency when a higher resolution
+    // version of it has been downloaded. If downloading it failed, it's invoked
+    // with an empty ResourceData instead so the owner still hears about every
+    // refinement, e.g. to release the task once refining() is false.
+    typedef std::tr1::function<void(const Transfer::URI&, const ResourceData&)> RefinedCallback;
 private:
-    AssetDownloadTask(const Transfer::URI& uri, Transfer::TransferPoolPtr tpool, ParserService* const parser, double priority, bool isAgg, FinishedCallback cb);
+    AssetDownloadTask(const Transfer::URI& uri, Transfer::TransferPoolPtr tpool, ParserService* const parser, double priority, bool isAgg, FinishedCallback cb, RefinedCallback refined_cb);
 public:
     static std::tr1::shared_ptr<AssetDownloadTask> construct(const Transfer::URI& uri, Transfer::TransferPoolPtr tpool, ParserService* const parser, double priority, FinishedCallback cb);
     static std::tr1::shared_ptr<AssetDownloadTask> construct(const Transfer::URI& uri, Transfer::TransferPoolPtr tpool, ParserService* const parser, double priority, bool isAgg, FinishedCallback cb);
+    /** Construct a task in streaming mode. cb is invoked once the asset and a
+     *  low resolution version of each dependency are available. Higher
+     *  resolution versions are then downloaded at the task's priority, with
+     *  refined_cb invoked as each arrives. The task must be kept alive until
+     *  refining() is false to get all the refinements.
+     */
+    static std::tr1::shared_ptr<AssetDownloadTask> constructStreaming(const Transfer::URI& uri, Transfer::TransferPoolPtr tpool, ParserService* const parser, double priority, bool isAgg, FinishedCallback cb, RefinedCallback refined_cb);
 
     ~AssetDownloadTask();
 
     Mesh::VisualPtr asset() const { return mAsset; }
+    /** The initial version of each dependency. Complete once cb has been
+     *  invoked, and never modified afterwards, so it's safe to read without
+     *  synchronization from then on. Refinements only go to refined_cb.
+     */
     const Dependencies& dependencies() const { return mDependencies; }
     float64 priority() const { return mPriority; }
 
@@ -52,6 +69,10 @@ public:
     void updatePriority(float64 priority);
     void cancel();
 
+    // Whether the initial download finished and refinements are still being
+    // downloaded.
+    bool refining();
+
     typedef std::map<const String, Transfer::ResourceDownloadTaskPtr> ActiveDownloadMap;
 
 private:
@@ -71,12 +92,25 @@ private:
     // modified after we start the downloads, except by the completion handler
     void startDependentDownloads();
 
+    // Start downloading the queued higher resolution versions of
+    // dependencies. Must be called with mDependentDownloadMutex held.
+    void startRefinementsNoLock();
+
     static void weakTextureDownloaded(const std::tr1::weak_ptr<AssetDownloadTask>&, Transfer::URI uri, Transfer::ResourceDownloadTaskPtr taskptr,
             Transfer::TransferRequestPtr request, Transfer::DenseDataPtr response);
 
     void textureDownloaded(Transfer::URI uri, Transfer::ResourceDownloadTaskPtr taskptr, Transfer::TransferRequestPtr request,
             Transfer::DenseDataPtr response);
 
+    // A refinement can replace several dependencies, e.g. textures which all
+    // come from the same atlas.
+    typedef std::vector<Transfer::URI> URIList;
+    typedef std::tr1::shared_ptr<URIList> URIListPtr;
+    static void weakTextureRefined(const std::tr1::weak_ptr<AssetDownloadTask>&, URIListPtr uris, Transfer::ResourceDownloadTaskPtr taskptr,
+            Transfer::TransferRequestPtr request, Transfer::DenseDataPtr response);
+    void textureRefined(URIListPtr uris, Transfer::ResourceDownloadTaskPtr taskptr, Transfer::TransferRequestPtr request,
+            Transfer::DenseDataPtr response);
+
 
     // Fails the entire process as a result of one dependency (or the original
     // asset) failing to download.
@@ -93,6 +127,7 @@ private:
     Transfer::URI mAssetURI;
     double mPriority;
     FinishedCallback mCB;
+    RefinedCallback mRefinedCB;
 
     ParseMeshTaskHandle mParseMeshHandle;
     Mesh::VisualPtr mAsset;
@@ -103,6 +138,16 @@ private:
     ActiveDownloadMap mActiveDownloads;
     std::vector<String> mFinishedDownloads;
 
+    // Streaming mode state. Refinements are queued while handling the parsed
+    // asset and started once the initial set of downloads completes.
+    bool mStreaming;
+    bool mInitialFinished;
+    struct Refinement {
+        Transfer::URI uri;
+        Transfer::Chunk chunk;
+    };
+    std::vector<Refinement> mPendingRefinements;
+
     boost::mutex mDependentDownloadMutex;
 
 public:
@@ -0,0 +1,50 @@
+// Copyright (c) 2015 Sirikata Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can
+// be found in the LICENSE file.
+
+#ifndef _SIRIKATA_MESH_MESHDATA_BINARY_HPP_
+#define _SIRIKATA_MESH_MESHDATA_BINARY_HPP_
+
+#include <sirikata/mesh/Meshdata.hpp>
+
+namespace Sirikata {
+namespace Mesh {
+
+/** Compact binary serialization of Meshdata. Unlike COLLADA, loading it
+ *  doesn't require any parsing: all strings are collected into a single table
+ *  at the start of the file and all vertex, index, weight and matrix data is
+ *  stored as flat arrays in native layout, 8-byte aligned, so a file can be
+ *  memory-mapped and each array copied out in one step.
+ *
+ *  The format is versioned and data is written in the host's byte order.
+ *  Files with a different version or byte order are rejected rather than
+ *  converted, so they'll just get reparsed from the original source.
+ */
+namespace MeshdataBinary {
+
+/// Name of the format for ModelsSystem::convertVisual
+extern SIRIKATA_MESH_EXPORT const String FormatName;
+/// Current version of the format. Bump this when the layout changes.
+extern SIRIKATA_MESH_EXPORT const uint32 Version;
+
+/// Returns true if data looks like serialized Meshdata, of any version.
+SIRIKATA_MESH_FUNCTION_EXPORT bool isBinary(const void* data, size_t size);
+
+SIRIKATA_MESH_FUNCTION_EXPORT void serialize(const Meshdata& md, std::ostream& out);
+SIRIKATA_MESH_FUNCTION_EXPORT String serialize(const Meshdata& md);
+
+/** Decode serialized Meshdata. Returns an empty pointer if the data is
+ *  truncated, corrupt or from an incompatible version.
+ */
+SIRIKATA_MESH_FUNCTION_EXPORT MeshdataPtr deserialize(const void* data, size_t size);
+
+/** Memory-map a file containing serialized Meshdata and decode it. Returns an
+ *  empty pointer if the file can't be read or isn't valid.
+ */
+SIRIKATA_MESH_FUNCTION_EXPORT MeshdataPtr loadFile(const String& filename);
+
+} // namespace MeshdataBinary
+} // namespace Mesh
+} // namespace Sirikata
+
+#endif //_SIRIKATA_MESH_MESHDATA_BINARY_HPP_
@@ -0,0 +1,43 @@
+// Copyright (c) 2015 Sirikata Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can
+// be found in the LICENSE file.
+
+#ifndef _SIRIKATA_MESH_PARSED_MESH_CACHE_HPP_
+#define _SIRIKATA_MESH_PARSED_MESH_CACHE_HPP_
+
+#include <sirikata/mesh/Meshdata.hpp>
+#include <sirikata/core/transfer/RemoteFileMetadata.hpp>
+
+namespace Sirikata {
+namespace Mesh {
+
+/** Keeps the result of parsing meshes in the transfer system's derived data
+ *  cache, in MeshdataBinary format, so a mesh only has to go through the COLLADA loader
+ *  once no matter how many times or by which component it gets loaded.
+ *
+ *  Entries are keyed by the fingerprint of the original file together with its
+ *  headers, since loaders use headers (e.g. subfile names, progressive data) to
+ *  fill in the Meshdata, and with the binary format version so old entries are
+ *  just ignored after the format changes.
+ */
+class SIRIKATA_MESH_EXPORT ParsedMeshCache {
+public:
+    /// Whether the cache is enabled by the disk-cache.parsed-meshes option
+    static bool enabled();
+
+    static Transfer::Fingerprint key(const Transfer::RemoteFileMetadata& metadata, const Transfer::Fingerprint& fp);
+
+    /** Look up the parsed version of a file. Only waits briefly for the disk
+     *  cache, since parsing is the fallback. Returns an empty pointer if there
+     *  isn't a valid entry or the cache didn't respond in time.
+     */
+    static MeshdataPtr lookup(const Transfer::RemoteFileMetadata& metadata, const Transfer::Fingerprint& fp);
+
+    /// Store the parsed version of a file
+    static void store(const Transfer::RemoteFileMetadata& metadata, const Transfer::Fingerprint& fp, const Meshdata& md);
+};
+
+} // namespace Mesh
+} // namespace Sirikata
+
+#endif //_SIRIKATA_MESH_PARSED_MESH_CACHE_HPP_
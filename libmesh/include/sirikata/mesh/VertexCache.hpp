@@ -0,0 +1,39 @@
+// Copyright (c) 2015 Sirikata Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can
+// be found in the LICENSE file.
+
+#ifndef _SIRIKATA_MESH_VERTEX_CACHE_HPP_
+#define _SIRIKATA_MESH_VERTEX_CACHE_HPP_
+
+#include <sirikata/mesh/Meshdata.hpp>
+
+namespace Sirikata {
+namespace Mesh {
+
+/// Post-transform vertex cache size assumed when none is specified.
+const uint32 DefaultVertexCacheSize = 32;
+
+/** Compute the average cache miss ratio (ACMR) of a triangle list, i.e. the
+ *  number of vertices that have to be transformed per triangle when drawn
+ *  through a FIFO post-transform cache of the given size. It ranges from about
+ *  0.5 for a well ordered regular mesh up to 3.
+ */
+SIRIKATA_MESH_FUNCTION_EXPORT float32 ComputeACMR(const std::vector<uint32>& indices, uint32 cache_size = DefaultVertexCacheSize);
+
+/** Compute the ACMR over all the triangle list primitives in a
+ *  SubMeshGeometry. Returns 0 if it doesn't have any triangles.
+ */
+SIRIKATA_MESH_FUNCTION_EXPORT float32 ComputeACMR(const SubMeshGeometry& geometry, uint32 cache_size = DefaultVertexCacheSize);
+
+/** Reorder the triangles in a triangle list to improve post-transform vertex
+ *  cache hits, using Tipsify (Sander, Nehab and Barczak, 2007). This runs in
+ *  linear time and preserves the winding of each triangle. vertex_count must be
+ *  larger than every index; if it isn't, the list is left unchanged and false
+ *  is returned.
+ */
+SIRIKATA_MESH_FUNCTION_EXPORT bool OptimizeTriangleOrder(std::vector<uint32>* indices, uint32 vertex_count, uint32 cache_size = DefaultVertexCacheSize);
+
+} // namespace Mesh
+} // namespace Sirikata
+
+#endif //_SIRIKATA_MESH_VERTEX_CACHE_HPP_
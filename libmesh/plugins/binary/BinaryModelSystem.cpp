@@ -0,0 +1,56 @@
+// Copyright (c) 2015 Sirikata Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can
+// be found in the LICENSE file.
+
+#include "BinaryModelSystem.hpp"
+#include <sirikata/mesh/MeshdataBinary.hpp>
+#include <fstream>
+
+namespace Sirikata {
+
+BinaryModelSystem::BinaryModelSystem() {
+}
+
+BinaryModelSystem::~BinaryModelSystem () {
+}
+
+bool BinaryModelSystem::canLoad(Transfer::DenseDataPtr data) {
+    if (!data) return false;
+    return Mesh::MeshdataBinary::isBinary(data->begin(), data->length());
+}
+
+Mesh::VisualPtr BinaryModelSystem::load(const Transfer::RemoteFileMetadata& metadata, const Transfer::Fingerprint& fp,
+    Transfer::DenseDataPtr data)
+{
+    Mesh::MeshdataPtr mesh = std::tr1::dynamic_pointer_cast<Mesh::Meshdata>(load(data));
+    if (!mesh) return Mesh::VisualPtr();
+
+    // Like the other loaders, identify the mesh by where it was actually
+    // loaded from rather than wherever it was serialized from.
+    mesh->uri = metadata.getURI().toString();
+    mesh->hash = fp;
+    return mesh;
+}
+
+Mesh::VisualPtr BinaryModelSystem::load(Transfer::DenseDataPtr data) {
+    if (!canLoad(data)) return Mesh::VisualPtr();
+    return Mesh::MeshdataBinary::deserialize(data->begin(), data->length());
+}
+
+bool BinaryModelSystem::convertVisual(const Mesh::VisualPtr& visual, const String& format, std::ostream& vout) {
+    Mesh::MeshdataPtr meshdata(std::tr1::dynamic_pointer_cast<Mesh::Meshdata>(visual));
+    if (!meshdata) return false;
+    // format is ignored, we only know one format
+    Mesh::MeshdataBinary::serialize(*meshdata, vout);
+    return vout.good();
+}
+
+bool BinaryModelSystem::convertVisual(const Mesh::VisualPtr& visual, const String& format, const String& filename) {
+    std::ofstream fout(filename.c_str(), std::ios::out | std::ios::binary);
+    if (!fout) return false;
+    bool converted = convertVisual(visual, format, fout);
+    fout.close();
+    return converted;
+}
+
+} // namespace Sirikata
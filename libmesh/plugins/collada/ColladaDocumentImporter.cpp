@@ -53,6 +53,9 @@
 
 #include "MeshdataToCollada.hpp"
 
+#include <sirikata/core/network/IOService.hpp>
+#include <boost/thread.hpp>
+
 
 #define COLLADA_LOG(lvl,msg) SILOG(collada, lvl, msg);
 
@@ -92,9 +95,11 @@ namespace Sirikata { namespace Models {
     } // namespace Collada
 
 
-    ColladaDocumentImporter::ColladaDocumentImporter ( Transfer::URI const& uri, const SHA256& hash )
+    ColladaDocumentImporter::ColladaDocumentImporter ( Transfer::URI const& uri, const SHA256& hash, Network::IOService* geometry_workers )
       :   mDocument ( new ColladaDocument ( uri ) ),
           mState ( IDLE ),
+          mGeometryWorkers(geometry_workers),
+          mPendingGeometry(new PendingGeometry()),
           mMesh(new Mesh::Meshdata())
     {
       COLLADA_LOG(insane, "ColladaDocumentImporter::ColladaDocumentImporter() entered, uri: " << uri);
@@ -106,7 +111,10 @@ namespace Sirikata { namespace Models {
       mOnlyHasDefaultAnimation = true;
     }
 
-    ColladaDocumentImporter::ColladaDocumentImporter ( std::vector<Transfer::URI> uriList ) {
+    ColladaDocumentImporter::ColladaDocumentImporter ( std::vector<Transfer::URI> uriList )
+      :   mGeometryWorkers(NULL),
+          mPendingGeometry(new PendingGeometry())
+    {
       COLLADA_LOG(insane, "ColladaDocumentImporter::ColladaDocumentImporter() entered, uriListLen: " << uriList.size());
       //mMesh = new Meshdata();
 
@@ -565,6 +573,7 @@ namespace Sirikata { namespace Models {
 
       // Add geometries
       // FIXME only store the geometries we need
+      finishGeometryJobs();
       mMesh->geometry.swap(mGeometries);
       mMesh->lights.swap( mLights);
 
@@ -822,13 +831,81 @@ namespace Sirikata { namespace Models {
       }
     };
 
+    struct ColladaDocumentImporter::PrimitiveSource {
+      COLLADAFW::MeshPrimitive::PrimitiveType type;
+      SubMeshGeometry::Primitive::MaterialId materialId;
+      // Whether this holds multiple primitives (e.g. polygons or strips),
+      // each a separate group of vertices
+      bool multiPrim;
+      // Number of indices used by each group of vertices
+      std::vector<size_t> groupSizes;
+
+      std::vector<unsigned int> positionIndices;
+      // Empty if the normals use the position indices
+      std::vector<unsigned int> normalIndices;
+      // For each UV set, the set index in the document and the indices
+      std::vector<size_t> uvSetIndices;
+      std::vector< std::vector<unsigned int> > uvIndices;
+
+      IndexSet createIndexSet(unsigned int whichIndex) const {
+        IndexSet uniqueIndexSet;
+        //gather the indices from the previous set
+        uniqueIndexSet.positionIndices=positionIndices[whichIndex];
+        uniqueIndexSet.normalIndices=normalIndices.empty()?uniqueIndexSet.positionIndices:normalIndices[whichIndex];
+        for (size_t uvSet=0;uvSet < uvIndices.size();++uvSet) {
+          uniqueIndexSet.uvIndices.push_back(uvIndices[uvSet][whichIndex]);
+        }
+        return uniqueIndexSet;
+      }
+    };
+
+    struct ColladaDocumentImporter::GeometryJob {
+      COLLADAFW::UniqueId id;
+      String name;
+
+      // Vertex data is converted to floats up front since that's how it ends
+      // up in SubMeshGeometry anyway.
+      bool hasPositions;
+      bool hasNormals;
+      bool hasUVs;
+      std::vector<float> positions;
+      std::vector<float> normals;
+      std::vector<float> uvs;
+      std::vector<unsigned int> uvStrides;
+      std::vector<PrimitiveSource> primitives;
+
+      // Results when converted on a worker
+      SubMeshGeometryList geometries;
+      std::vector<ExtraGeometryData> extra;
+    };
+
+    struct ColladaDocumentImporter::PendingGeometry {
+      PendingGeometry() : remaining(0) {}
+
+      boost::mutex mutex;
+      boost::condition_variable cond;
+      uint32 remaining;
+    };
+
+    namespace {
+    template<typename ArrayType>
+    void copyValues(const ArrayType* src, std::vector<float>* dest) {
+      if (src == NULL || src->getData() == NULL) return;
+      dest->assign(src->getData(), src->getData() + src->getCount());
+    }
+    void copyIndices(const COLLADAFW::UIntValuesArray& src, std::vector<unsigned int>* dest) {
+      if (src.getData() == NULL) return;
+      dest->assign(src.getData(), src.getData() + src.getCount());
+    }
+    }
+
     void ColladaDocumentImporter::setupPrim(SubMeshGeometry::Primitive* outputPrim,
                                             ExtraPrimitiveData&outputPrimExtra,
-                                            const COLLADAFW::MeshPrimitive*prim) {
-      for (size_t uvSet=0;uvSet < prim->getUVCoordIndicesArray().getCount();++uvSet) {
-        outputPrimExtra.uvSetMap[prim->getUVCoordIndices(uvSet)->getSetIndex()]=uvSet;
+                                            const PrimitiveSource& prim) {
+      for (size_t uvSet=0;uvSet < prim.uvSetIndices.size();++uvSet) {
+        outputPrimExtra.uvSetMap[prim.uvSetIndices[uvSet]]=uvSet;
       }
-      switch(prim->getPrimitiveType()) {
+      switch(prim.type) {
       case COLLADAFW::MeshPrimitive::POLYGONS:
       case COLLADAFW::MeshPrimitive::POLYLIST:
       case COLLADAFW::MeshPrimitive::TRIANGLE_FANS:
@@ -846,85 +923,42 @@ namespace Sirikata { namespace Models {
       default:
         outputPrim->primitiveType = SubMeshGeometry::Primitive::TRIANGLES;
       }
-      outputPrim->materialId= prim->getMaterialId();
-    }
-    IndexSet createIndexSet(const COLLADAFW::MeshPrimitive*prim,
-                            unsigned int whichIndex) {
-      IndexSet uniqueIndexSet;
-      //gather the indices from the previous set
-      uniqueIndexSet.positionIndices=prim->getPositionIndices()[whichIndex];
-      uniqueIndexSet.normalIndices=prim->hasNormalIndices()?prim->getNormalIndices()[whichIndex]:uniqueIndexSet.positionIndices;
-      for (size_t uvSet=0;uvSet < prim->getUVCoordIndicesArray().getCount();++uvSet) {
-        uniqueIndexSet.uvIndices.push_back(prim->getUVCoordIndices(uvSet)->getIndex(whichIndex));
-      }
-      return uniqueIndexSet;
+      outputPrim->materialId= prim.materialId;
     }
-    bool ColladaDocumentImporter::writeGeometry ( COLLADAFW::Geometry const* geometry )
-    {
-      String uri = mDocument->getURI().toString();
-      COLLADA_LOG(insane, "ColladaDocumentImporter::writeGeometry(" << geometry << ") entered");
-      if (geometry->getType()!=COLLADAFW::Geometry::GEO_TYPE_MESH) {
-        std::cerr << "ERROR: we only support collada Mesh\n";
-        return true;
-      }
-      COLLADAFW::Mesh const* mesh = static_cast<COLLADAFW::Mesh const*>(geometry);
-      mGeometryMap.insert(IndicesMultimap::value_type(geometry->getUniqueId(),mGeometries.size()));
-      mGeometries.push_back(SubMeshGeometry());
-      mExtraGeometryData.push_back(ExtraGeometryData());
-      SubMeshGeometry* submesh = &mGeometries.back();
+
+    void ColladaDocumentImporter::convertGeometry(GeometryJob* job,
+                                                  SubMeshGeometryList* geometries,
+                                                  std::vector<ExtraGeometryData>* extra) {
+      geometries->push_back(SubMeshGeometry());
+      extra->push_back(ExtraGeometryData());
+      SubMeshGeometry* submesh = &geometries->back();
       submesh->radius=0;
       submesh->aabb=BoundingBox3f3f::null();
-      submesh->name = mesh->getName();
+      submesh->name = job->name;
 
-      COLLADAFW::MeshVertexData const& verts((mesh->getPositions()));
-      COLLADAFW::MeshVertexData const& norms((mesh->getNormals()));
-      COLLADAFW::MeshVertexData const& UVs((mesh->getUVCoords()));
       std::tr1::unordered_map<IndexSet,unsigned short,IndexSet::IndexSetHash> indexSetMap;
 
-      COLLADAFW::FloatArray const* vdata = verts.getFloatValues();
-      COLLADAFW::FloatArray const* ndata = norms.getFloatValues();
-      COLLADAFW::FloatArray const* uvdata = UVs.getFloatValues();
-
-      COLLADAFW::DoubleArray const* vdatad = verts.getDoubleValues();
-      COLLADAFW::DoubleArray const* ndatad = norms.getDoubleValues();
-      COLLADAFW::DoubleArray const* uvdatad = UVs.getDoubleValues();
+      const float* vdata = job->positions.empty() ? NULL : &job->positions[0];
+      const float* ndata = job->normals.empty() ? NULL : &job->normals[0];
+      const float* uvdata = job->uvs.empty() ? NULL : &job->uvs[0];
 
-      COLLADAFW::MeshPrimitiveArray const& primitives((mesh->getMeshPrimitives()));
       SubMeshGeometry::Primitive *outputPrim=NULL;
-      for(size_t prim_index=0;prim_index<primitives.getCount();++prim_index) {
-        COLLADAFW::MeshPrimitive * prim = primitives[prim_index];
-        if (prim->getPrimitiveType()==COLLADAFW::MeshPrimitive::POLYLIST||
-            prim->getPrimitiveType()==COLLADAFW::MeshPrimitive::POLYGONS) {
+      for(size_t prim_index=0;prim_index<job->primitives.size();++prim_index) {
+        const PrimitiveSource& prim = job->primitives[prim_index];
+        if (prim.type==COLLADAFW::MeshPrimitive::POLYLIST||
+            prim.type==COLLADAFW::MeshPrimitive::POLYGONS) {
           COLLADA_LOG(insane,"Polygons found in a COLLADA model. Transforming into trifans, but this is only a heuristic, they may render incorrectly.");
         }
-        size_t groupedVertexElementCount;
-        bool multiPrim;
-        switch (prim->getPrimitiveType()) {
-        case COLLADAFW::MeshPrimitive::POLYLIST:
-        case COLLADAFW::MeshPrimitive::POLYGONS:
-        case COLLADAFW::MeshPrimitive::TRIANGLE_FANS:
-        case COLLADAFW::MeshPrimitive::TRIANGLE_STRIPS:
-        case COLLADAFW::MeshPrimitive::LINE_STRIPS:
-          groupedVertexElementCount = prim->getGroupedVertexElementsCount();
-          multiPrim=true;
-          break;
-        default:
-          groupedVertexElementCount = 1;
-          multiPrim=false;
-          break;
-        }
         size_t offset=0;
-        for (size_t i=0;i<groupedVertexElementCount;++i) {
+        for (size_t i=0;i<prim.groupSizes.size();++i) {
           submesh->primitives.push_back(SubMeshGeometry::Primitive());
-          mExtraGeometryData.back().primitives.push_back(ExtraPrimitiveData());
+          extra->back().primitives.push_back(ExtraPrimitiveData());
           outputPrim=&submesh->primitives.back();
-          setupPrim(outputPrim,mExtraGeometryData.back().primitives.back(),prim);
-          size_t faceCount=prim->getGroupedVerticesVertexCount(i);
-          if (!multiPrim)
-            faceCount *= prim->getGroupedVertexElementsCount();
+          setupPrim(outputPrim,extra->back().primitives.back(),prim);
+          size_t faceCount=prim.groupSizes[i];
           for (size_t j=0;j<faceCount;++j) {
             size_t whichIndex = offset+j;
-            IndexSet uniqueIndexSet=createIndexSet(prim,whichIndex);
+            IndexSet uniqueIndexSet=prim.createIndexSet(whichIndex);
             //now that we know what the indices are, find them in the indexSetMap...if this is the first time we see the indices, we must gather the data and place it
             //into our output list
 
@@ -932,26 +966,25 @@ namespace Sirikata { namespace Models {
             int vertStride = 3;//verts.getStride(0);<-- OpenCollada returns bad values for this
             int normStride = 3;//norms.getStride(0);<-- OpenCollada returns bad values for this
             if (where==indexSetMap.end()&&indexSetMap.size()>=65530&&j%6==0) {//want a multiple of 6 so that lines and triangles terminate properly 65532%6==0
-              mGeometryMap.insert(IndicesMultimap::value_type(geometry->getUniqueId(),mGeometries.size()));
-              mGeometries.push_back(SubMeshGeometry());
-              mExtraGeometryData.push_back(ExtraGeometryData());
-              submesh = &mGeometries.back();
+              geometries->push_back(SubMeshGeometry());
+              extra->push_back(ExtraGeometryData());
+              submesh = &geometries->back();
               submesh->radius=0;
               submesh->aabb=BoundingBox3f3f::null();
-              submesh->name = mesh->getName();
-              //duplicated code from beginning of writeGeometry
+              submesh->name = job->name;
+              //duplicated code from beginning of convertGeometry
               submesh->primitives.push_back(SubMeshGeometry::Primitive());
-              mExtraGeometryData.back().primitives.push_back(ExtraPrimitiveData());
+              extra->back().primitives.push_back(ExtraPrimitiveData());
               outputPrim=&submesh->primitives.back();
-              setupPrim(outputPrim,mExtraGeometryData.back().primitives.back(),prim);
-              switch(prim->getPrimitiveType()) {
+              setupPrim(outputPrim,extra->back().primitives.back(),prim);
+              switch(prim.type) {
               case COLLADAFW::MeshPrimitive::TRIANGLE_FANS:
                 SILOG(collada,error,"Do not support triangle fans with more than 64K elements");
                 if (whichIndex-2>=offset) {
                   j-=2;
                 }
                 whichIndex=offset;
-                uniqueIndexSet=createIndexSet(prim,whichIndex);
+                uniqueIndexSet=prim.createIndexSet(whichIndex);
                 break;
               case COLLADAFW::MeshPrimitive::TRIANGLE_STRIPS:
                 if (whichIndex-1>=offset) {
@@ -963,14 +996,14 @@ namespace Sirikata { namespace Models {
                   whichIndex--;
                 }
 
-                uniqueIndexSet=createIndexSet(prim,whichIndex);
+                uniqueIndexSet=prim.createIndexSet(whichIndex);
                 break;
               case COLLADAFW::MeshPrimitive::LINE_STRIPS:
                 if (whichIndex-1>=offset) {
                   j--;
                   whichIndex--;
                 }
-                uniqueIndexSet=createIndexSet(prim,whichIndex);
+                uniqueIndexSet=prim.createIndexSet(whichIndex);
                 break;
               default:break;
               }
@@ -979,25 +1012,18 @@ namespace Sirikata { namespace Models {
             }
             if (where==indexSetMap.end()) {
               indexSetMap[uniqueIndexSet]=submesh->positions.size();
-              uint32 new_vert_idx = submesh->positions.size();
               // inverse_vert_index_map lets us map back to original
               // indices for each *vertex* (i.e. position). Used to map
               // backward in weights for bones to map to the expanded
               // number of vertices.
               // -Note the push_back puts it at submesh->positions.size(),
               // i.e. the index is *new vertex index*.
-              mExtraGeometryData.back().inverseVertexIndexMap.push_back(uniqueIndexSet.positionIndices);
+              extra->back().inverseVertexIndexMap.push_back(uniqueIndexSet.positionIndices);
               outputPrim->indices.push_back(submesh->positions.size());
-              if (vdata||vdatad) {
-                if (vdata) {
-                  submesh->positions.push_back(Vector3f(vdata->getData()[uniqueIndexSet.positionIndices*vertStride],//FIXME: is stride 3 or 3*sizeof(float)
-                                                        vdata->getData()[uniqueIndexSet.positionIndices*vertStride+1],
-                                                        vdata->getData()[uniqueIndexSet.positionIndices*vertStride+2]));
-                }else if (vdatad) {
-                  submesh->positions.push_back(Vector3f(vdatad->getData()[uniqueIndexSet.positionIndices*vertStride],//FIXME: is stride 3 or 3*sizeof(float)
-                                                        vdatad->getData()[uniqueIndexSet.positionIndices*vertStride+1],
-                                                        vdatad->getData()[uniqueIndexSet.positionIndices*vertStride+2]));
-                }
+              if (job->hasPositions) {
+                submesh->positions.push_back(Vector3f(vdata[uniqueIndexSet.positionIndices*vertStride],//FIXME: is stride 3 or 3*sizeof(float)
+                                                      vdata[uniqueIndexSet.positionIndices*vertStride+1],
+                                                      vdata[uniqueIndexSet.positionIndices*vertStride+2]));
                 if (submesh->aabb==BoundingBox3f3f::null())
                   submesh->aabb=BoundingBox3f3f(submesh->positions.back(),0);
                 else
@@ -1009,14 +1035,10 @@ namespace Sirikata { namespace Models {
               }else {
                 COLLADA_LOG(error,"SubMesh without position index data\n");
               }
-              if (ndata) {
-                submesh->normals.push_back(Vector3f(ndata->getData()[uniqueIndexSet.normalIndices*normStride],//FIXME: is stride 3 or 3*sizeof(float)
-                                                    ndata->getData()[uniqueIndexSet.normalIndices*normStride+1],
-                                                    ndata->getData()[uniqueIndexSet.normalIndices*normStride+2]));
-              }else if (ndatad) {
-                submesh->normals.push_back(Vector3f(ndatad->getData()[uniqueIndexSet.normalIndices*normStride],//FIXME: is stride 3 or 3*sizeof(float)
-                                                    ndatad->getData()[uniqueIndexSet.normalIndices*normStride+1],
-                                                    ndatad->getData()[uniqueIndexSet.normalIndices*normStride+2]));
+              if (job->hasNormals) {
+                submesh->normals.push_back(Vector3f(ndata[uniqueIndexSet.normalIndices*normStride],//FIXME: is stride 3 or 3*sizeof(float)
+                                                    ndata[uniqueIndexSet.normalIndices*normStride+1],
+                                                    ndata[uniqueIndexSet.normalIndices*normStride+2]));
               }
 
 
@@ -1029,20 +1051,12 @@ namespace Sirikata { namespace Models {
               if (submesh->texUVs.size()<uniqueIndexSet.uvIndices.size())
                 submesh->texUVs.resize(uniqueIndexSet.uvIndices.size());
               // Add in these texture coordinates.
-              if (uvdata) {
+              if (job->hasUVs) {
                 for (size_t uvSet=0;uvSet<uniqueIndexSet.uvIndices.size();++uvSet) {
-                  unsigned int stride=UVs.getStride(uvSet);
+                  unsigned int stride=job->uvStrides[uvSet];
                   submesh->texUVs.back().stride=stride;
                   for (unsigned int s=0;s<stride;++s) {
-                    submesh->texUVs[uvSet].uvs.push_back(uvdata->getData()[uniqueIndexSet.uvIndices[uvSet]*stride+s]);//FIXME: is stride k or k*sizeof(float)
-                  }
-                }
-              }else if (uvdatad) {
-                for (size_t uvSet=0;uvSet<uniqueIndexSet.uvIndices.size();++uvSet) {
-                  unsigned int stride=UVs.getStride(uvSet);
-                  submesh->texUVs.back().stride=stride;
-                  for (unsigned int s=0;s<stride;++s) {
-                    submesh->texUVs[uvSet].uvs.push_back(uvdatad->getData()[uniqueIndexSet.uvIndices[uvSet]*stride+s]);//FIXME: is stride k or k*sizeof(float)
+                    submesh->texUVs[uvSet].uvs.push_back(uvdata[uniqueIndexSet.uvIndices[uvSet]*stride+s]);//FIXME: is stride k or k*sizeof(float)
                   }
                 }
               }
@@ -1080,6 +1094,139 @@ namespace Sirikata { namespace Models {
         }
 
       }
+
+      // The source data isn't needed anymore, don't hold onto it until the
+      // whole document is done
+      std::vector<float>().swap(job->positions);
+      std::vector<float>().swap(job->normals);
+      std::vector<float>().swap(job->uvs);
+      std::vector<PrimitiveSource>().swap(job->primitives);
+    }
+
+    void ColladaDocumentImporter::runGeometryJob(GeometryJobPtr job, PendingGeometryPtr pending) {
+      convertGeometry(job.get(), &job->geometries, &job->extra);
+
+      boost::unique_lock<boost::mutex> lock(pending->mutex);
+      pending->remaining--;
+      if (pending->remaining == 0)
+        pending->cond.notify_all();
+    }
+
+    void ColladaDocumentImporter::finishGeometryJobs() {
+      if (mGeometryJobs.empty()) return;
+
+      {
+        boost::unique_lock<boost::mutex> lock(mPendingGeometry->mutex);
+        while(mPendingGeometry->remaining > 0)
+          mPendingGeometry->cond.wait(lock);
+      }
+
+      for(size_t job_idx = 0; job_idx < mGeometryJobs.size(); job_idx++) {
+        GeometryJob* job = mGeometryJobs[job_idx].get();
+        for(size_t i = 0; i < job->geometries.size(); i++)
+          mGeometryMap.insert(IndicesMultimap::value_type(job->id, mGeometries.size() + i));
+        mGeometries.insert(mGeometries.end(), job->geometries.begin(), job->geometries.end());
+        mExtraGeometryData.insert(mExtraGeometryData.end(), job->extra.begin(), job->extra.end());
+      }
+      mGeometryJobs.clear();
+    }
+
+    bool ColladaDocumentImporter::writeGeometry ( COLLADAFW::Geometry const* geometry )
+    {
+      COLLADA_LOG(insane, "ColladaDocumentImporter::writeGeometry(" << geometry << ") entered");
+      if (geometry->getType()!=COLLADAFW::Geometry::GEO_TYPE_MESH) {
+        std::cerr << "ERROR: we only support collada Mesh\n";
+        return true;
+      }
+      COLLADAFW::Mesh const* mesh = static_cast<COLLADAFW::Mesh const*>(geometry);
+
+      // Copy out everything needed for conversion
+      GeometryJobPtr job(new GeometryJob());
+      job->id = geometry->getUniqueId();
+      job->name = mesh->getName();
+
+      COLLADAFW::MeshVertexData const& verts((mesh->getPositions()));
+      COLLADAFW::MeshVertexData const& norms((mesh->getNormals()));
+      COLLADAFW::MeshVertexData const& UVs((mesh->getUVCoords()));
+
+      job->hasPositions = (verts.getFloatValues() || verts.getDoubleValues());
+      if (verts.getFloatValues()) copyValues(verts.getFloatValues(), &job->positions);
+      else copyValues(verts.getDoubleValues(), &job->positions);
+      job->hasNormals = (norms.getFloatValues() || norms.getDoubleValues());
+      if (norms.getFloatValues()) copyValues(norms.getFloatValues(), &job->normals);
+      else copyValues(norms.getDoubleValues(), &job->normals);
+      job->hasUVs = (UVs.getFloatValues() || UVs.getDoubleValues());
+      if (UVs.getFloatValues()) copyValues(UVs.getFloatValues(), &job->uvs);
+      else copyValues(UVs.getDoubleValues(), &job->uvs);
+
+      COLLADAFW::MeshPrimitiveArray const& primitives((mesh->getMeshPrimitives()));
+      job->primitives.resize(primitives.getCount());
+      size_t max_uv_sets = 0;
+      for(size_t prim_index=0;prim_index<primitives.getCount();++prim_index) {
+        COLLADAFW::MeshPrimitive * prim = primitives[prim_index];
+        PrimitiveSource& prim_src = job->primitives[prim_index];
+        prim_src.type = prim->getPrimitiveType();
+        prim_src.materialId = prim->getMaterialId();
+
+        size_t groupedVertexElementCount;
+        switch (prim->getPrimitiveType()) {
+        case COLLADAFW::MeshPrimitive::POLYLIST:
+        case COLLADAFW::MeshPrimitive::POLYGONS:
+        case COLLADAFW::MeshPrimitive::TRIANGLE_FANS:
+        case COLLADAFW::MeshPrimitive::TRIANGLE_STRIPS:
+        case COLLADAFW::MeshPrimitive::LINE_STRIPS:
+          groupedVertexElementCount = prim->getGroupedVertexElementsCount();
+          prim_src.multiPrim=true;
+          break;
+        default:
+          groupedVertexElementCount = 1;
+          prim_src.multiPrim=false;
+          break;
+        }
+        for (size_t i=0;i<groupedVertexElementCount;++i) {
+          size_t faceCount=prim->getGroupedVerticesVertexCount(i);
+          if (!prim_src.multiPrim)
+            faceCount *= prim->getGroupedVertexElementsCount();
+          prim_src.groupSizes.push_back(faceCount);
+        }
+
+        copyIndices(prim->getPositionIndices(), &prim_src.positionIndices);
+        if (prim->hasNormalIndices())
+          copyIndices(prim->getNormalIndices(), &prim_src.normalIndices);
+        size_t uv_sets = prim->getUVCoordIndicesArray().getCount();
+        prim_src.uvSetIndices.resize(uv_sets);
+        prim_src.uvIndices.resize(uv_sets);
+        for (size_t uvSet=0;uvSet < uv_sets;++uvSet) {
+          const COLLADAFW::IndexList* uv_indices = prim->getUVCoordIndices(uvSet);
+          prim_src.uvSetIndices[uvSet] = uv_indices->getSetIndex();
+          size_t nindices = uv_indices->getIndices().getCount();
+          prim_src.uvIndices[uvSet].resize(nindices);
+          for (size_t idx=0;idx<nindices;++idx)
+            prim_src.uvIndices[uvSet][idx] = uv_indices->getIndex(idx);
+        }
+        max_uv_sets = std::max(max_uv_sets, uv_sets);
+      }
+      for (size_t uvSet=0;uvSet<max_uv_sets;++uvSet)
+        job->uvStrides.push_back(UVs.getStride(uvSet));
+
+      if (mGeometryWorkers == NULL) {
+        size_t first_index = mGeometries.size();
+        convertGeometry(job.get(), &mGeometries, &mExtraGeometryData);
+        for(size_t idx = first_index; idx < mGeometries.size(); idx++)
+          mGeometryMap.insert(IndicesMultimap::value_type(job->id, idx));
+      }
+      else {
+        mGeometryJobs.push_back(job);
+        {
+          boost::unique_lock<boost::mutex> lock(mPendingGeometry->mutex);
+          mPendingGeometry->remaining++;
+        }
+        mGeometryWorkers->post(
+          std::tr1::bind(&ColladaDocumentImporter::runGeometryJob, job, mPendingGeometry),
+          "ColladaDocumentImporter::runGeometryJob"
+        );
+      }
+
       bool ok = mDocument->import ( *this, *geometry );
 
       return ok;
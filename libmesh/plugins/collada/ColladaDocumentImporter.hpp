@@ -62,6 +62,12 @@ class URI;
 
 }
 
+namespace Network {
+
+class IOService;
+
+}
+
 namespace Models {
 
 /////////////////////////////////////////////////////////////////////
@@ -74,7 +80,7 @@ class SIRIKATA_PLUGIN_EXPORT ColladaDocumentImporter
     :   public COLLADAFW::IWriter
 {
     public:
-    explicit ColladaDocumentImporter ( Transfer::URI const& uri, const SHA256& hash );
+    explicit ColladaDocumentImporter ( Transfer::URI const& uri, const SHA256& hash, Network::IOService* geometry_workers = NULL );
     explicit ColladaDocumentImporter ( std::vector<Transfer::URI> uriList );
 
         ~ColladaDocumentImporter ();
@@ -220,15 +226,40 @@ class SIRIKATA_PLUGIN_EXPORT ColladaDocumentImporter
             // per-vertex weights since they are applied separately
             std::vector<uint32> inverseVertexIndexMap;
         };
-        void setupPrim(Mesh::SubMeshGeometry::Primitive* outputPrim,
-                       ExtraPrimitiveData&outputPrimExtra,
-                       const COLLADAFW::MeshPrimitive*prim);
+        // The data needed to convert a COLLADAFW::Mesh into SubMeshGeometry,
+        // copied out of it. OpenCOLLADA frees each mesh as soon as
+        // writeGeometry returns, so this lets conversion happen later, on
+        // another thread, while the rest of the document is parsed.
+        struct PrimitiveSource;
+        struct GeometryJob;
+        typedef std::tr1::shared_ptr<GeometryJob> GeometryJobPtr;
+        // Tracks the jobs that are still running on the geometry workers
+        struct PendingGeometry;
+        typedef std::tr1::shared_ptr<PendingGeometry> PendingGeometryPtr;
+
+        static void setupPrim(Mesh::SubMeshGeometry::Primitive* outputPrim,
+                              ExtraPrimitiveData&outputPrimExtra,
+                              const PrimitiveSource& prim);
+        // Converts the job's source data, appending the resulting
+        // geometries. A geometry may be split into multiple SubMeshGeometries
+        // to keep indices within 16 bits.
+        static void convertGeometry(GeometryJob* job,
+                                    Mesh::SubMeshGeometryList* geometries,
+                                    std::vector<ExtraGeometryData>* extra);
+        static void runGeometryJob(GeometryJobPtr job, PendingGeometryPtr pending);
+        // Waits for all outstanding geometry jobs and adds their results, in
+        // document order, so geometry indices match a serial import.
+        void finishGeometryJobs();
         //a list of:
         //  mappings from texture coordinate set to list indices
         //  mappings from new position indices to original (for mapping indices
         //     backward into animation weight data to make vertices that were
         //     expanded to multiple vertices get weights applied to both).
         std::vector<ExtraGeometryData> mExtraGeometryData;
+
+        Network::IOService* mGeometryWorkers;
+        PendingGeometryPtr mPendingGeometry;
+        std::vector<GeometryJobPtr> mGeometryJobs;
         IndicesMap mLightMap;
         Mesh::LightInfoList mLights;
 
@@ -46,10 +46,10 @@
 
 namespace Sirikata { namespace Models {
 
-ColladaDocumentLoader::ColladaDocumentLoader (Transfer::URI const& uri, const SHA256& hash)
+ColladaDocumentLoader::ColladaDocumentLoader (Transfer::URI const& uri, const SHA256& hash, Network::IOService* geometry_workers)
     :   mErrorHandler ( new ColladaErrorHandler ),
         mSaxLoader ( new COLLADASaxFWL::Loader ( mErrorHandler ) ),
-        mDocumentImporter ( new ColladaDocumentImporter ( uri, hash ) ),
+        mDocumentImporter ( new ColladaDocumentImporter ( uri, hash, geometry_workers ) ),
         mFramework ( new COLLADAFW::Root ( mSaxLoader, mDocumentImporter ) )
 {
     COLLADA_LOG(insane, "ColladaDocumentLoader::ColladaDocumentLoader() entered");
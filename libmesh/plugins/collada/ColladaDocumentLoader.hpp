@@ -53,7 +53,13 @@ class Loader;
 
 /////////////////////////////////////////////////////////////////////
 
-namespace Sirikata { namespace Models {
+namespace Sirikata {
+
+namespace Network {
+class IOService;
+}
+
+namespace Models {
 
 class ColladaDocumentImporter;
 class ColladaErrorHandler;
@@ -66,7 +72,10 @@ class ColladaErrorHandler;
 class SIRIKATA_PLUGIN_EXPORT ColladaDocumentLoader
 {
     public:
-    explicit ColladaDocumentLoader ( Transfer::URI const& uri, const SHA256& hash);
+    /** If geometry_workers is non-NULL, geometry is converted on them as
+     *  soon as it has been parsed instead of on the loading thread.
+     */
+    explicit ColladaDocumentLoader ( Transfer::URI const& uri, const SHA256& hash, Network::IOService* geometry_workers = NULL );
         ~ColladaDocumentLoader ();
 
         bool load ( char const* buffer, size_t bufferLength );
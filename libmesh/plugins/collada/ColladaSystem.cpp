@@ -41,6 +41,8 @@
 #include "boost/algorithm/string/classification.hpp"
 
 #include <sirikata/core/options/Options.hpp>
+#include <sirikata/core/network/IOServicePool.hpp>
+#include <sirikata/core/util/Thread.hpp>
 
 // OpenCOLLADA headers
 
@@ -70,7 +72,8 @@ using namespace Sirikata::Transfer;
 namespace Sirikata { namespace Models {
 
 ColladaSystem::ColladaSystem ()
-    :   mDocuments ()
+    :   mDocuments (),
+        mImportWorkers(NULL)
 {
     COLLADA_LOG(insane, "ColladaSystem::ColladaSystem() entered");
 }
@@ -78,6 +81,10 @@ ColladaSystem::ColladaSystem ()
 ColladaSystem::~ColladaSystem ()
 {
     COLLADA_LOG(insane, "ColladaSystem::~ColladaSystem() entered");
+    if (mImportWorkers != NULL) {
+        mImportWorkers->join();
+        delete mImportWorkers;
+    }
 }
 
 ColladaSystem* ColladaSystem::create (String const& options)
@@ -95,8 +102,22 @@ bool ColladaSystem::initialize(String const& options)
 {
     COLLADA_LOG(insane, "ColladaSystem::initialize() entered");
 
-    InitializeClassOptions ( "colladamodels", this, NULL );
-    OptionSet::getOptions ( "colladamodels", this )->parse ( options );
+    InitializeClassOptions ( "colladamodels", this,
+        new OptionValue("import-threads", "0", Sirikata::OptionValueType<uint32>(), "Threads used to convert geometry while a document is still being parsed. 0 picks a number based on the number of cores, 1 converts geometry on the loading thread."),
+        NULL);
+    OptionSet* optionSet = OptionSet::getOptions ( "colladamodels", this );
+    optionSet->parse ( options );
+
+    uint32 import_threads = optionSet->referenceOption("import-threads")->as<uint32>();
+    if (import_threads == 0)
+        import_threads = std::min(std::max(Thread::hardware_concurrency(), (unsigned)1), (unsigned)4);
+    // With a single thread we might as well just convert on the loading
+    // thread, which keeps the original single-threaded behavior.
+    if (import_threads > 1) {
+        mImportWorkers = new Network::IOServicePool("ColladaSystem Import", import_threads);
+        mImportWorkers->startWork();
+        mImportWorkers->run();
+    }
 
     return true;
 }
@@ -298,7 +319,7 @@ Mesh::VisualPtr ColladaSystem::load(const Transfer::RemoteFileMetadata& metadata
 {
 	if(!canLoad(data))
 		return Mesh::VisualPtr();
-	ColladaDocumentLoader loader(metadata.getURI(), fp);
+	ColladaDocumentLoader loader(metadata.getURI(), fp, importWorkers());
 
     SparseData data_reflatten = SparseData();
     data_reflatten.addValidData(data);
@@ -317,7 +338,7 @@ Mesh::VisualPtr ColladaSystem::load(const Transfer::RemoteFileMetadata& metadata
 Mesh::VisualPtr ColladaSystem::load(Transfer::DenseDataPtr data) {
 	if(!canLoad(data))
 		return Mesh::VisualPtr();
-    ColladaDocumentLoader loader(Transfer::URI(""), Transfer::Fingerprint::null() );
+    ColladaDocumentLoader loader(Transfer::URI(""), Transfer::Fingerprint::null(), importWorkers());
 
     SparseData data_reflatten = SparseData();
     data_reflatten.addValidData(data);
@@ -333,6 +354,10 @@ Mesh::VisualPtr ColladaSystem::load(Transfer::DenseDataPtr data) {
 
 }
 
+Network::IOService* ColladaSystem::importWorkers() {
+    return (mImportWorkers != NULL ? mImportWorkers->service() : NULL);
+}
+
 bool ColladaSystem::convertVisual(const Mesh::VisualPtr& visual, const String& format, std::ostream& vout) {
     // Currently OpenCOLLADA only seems to support writing to files, despite
     // having a generic StreamWriter interface. To save to a stream, we save to
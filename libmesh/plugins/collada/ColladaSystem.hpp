@@ -51,6 +51,11 @@ namespace Sirikata {
 
 class OptionValue;
 
+namespace Network {
+class IOService;
+class IOServicePool;
+}
+
 namespace Models {
 
 /////////////////////////////////////////////////////////////////////
@@ -82,12 +87,18 @@ class SIRIKATA_PLUGIN_EXPORT ColladaSystem
 
     void addHeaderData(const Transfer::RemoteFileMetadata& metadata, Mesh::MeshdataPtr mesh);
 
+    // Workers that geometry is handed off to during import, or NULL if
+    // geometry is converted on the loading thread.
+    Network::IOService* importWorkers();
+
     // documents that have been transfered, parsed, and loaded.
     // MCB: make this a map when/if a key becomes useful
 
     typedef std::set< ColladaDocumentPtr > DocumentSet;
     DocumentSet mDocuments;
 
+    Network::IOServicePool* mImportWorkers;
+
 };
 
 } // namespace Models
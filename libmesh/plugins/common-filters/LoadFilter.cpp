@@ -32,6 +32,7 @@
 
 #include "LoadFilter.hpp"
 #include <sirikata/mesh/ModelsSystemFactory.hpp>
+#include <sirikata/mesh/MeshdataBinary.hpp>
 
 namespace Sirikata {
 namespace Mesh {
@@ -67,6 +68,23 @@ FilterDataPtr LoadFilter::apply(FilterDataPtr input) {
     }
     else {
         FILE* fp = fopen(mFilename.c_str(), "rb");
+        // Serialized Meshdata is decoded directly from a mapping of the file
+        // rather than being read in and handed to a parser.
+        char prefix[64];
+        size_t prefix_len = fread(prefix, 1, sizeof(prefix), fp);
+        if (MeshdataBinary::isBinary(prefix, prefix_len)) {
+            fclose(fp);
+            MeshdataPtr mesh = MeshdataBinary::loadFile(mFilename);
+            if (!mesh) {
+                std::cout << "Error applying LoadFilter: " << mFilename << std::endl;
+                return FilterDataPtr();
+            }
+            mesh->uri = std::string("file://") + mFilename;
+            MutableFilterDataPtr output(new FilterData(*input.get()));
+            output->push_back(mesh);
+            return output;
+        }
+
         fseek(fp, 0, SEEK_END);
         int fp_len = ftell(fp);
         fseek(fp, 0, SEEK_SET);
@@ -49,6 +49,7 @@
 #include "TriangulateFilter.hpp"
 #include "ComputeNormalsFilter.hpp"
 #include "DeduplicationFilter.hpp"
+#include "VertexCacheFilter.hpp"
 
 static int common_filters_plugin_refcount = 0;
 
@@ -78,6 +79,8 @@ SIRIKATA_PLUGIN_EXPORT_C void init ()
         FilterFactory::getSingleton().registerConstructor("compute-normals", ComputeNormalsFilter::create);
 
         FilterFactory::getSingleton().registerConstructor("deduplication", DeduplicationFilter::create);
+
+        FilterFactory::getSingleton().registerConstructor("optimize-vertex-cache", VertexCacheFilter::create);
     }
 
     ++common_filters_plugin_refcount;
@@ -127,6 +130,8 @@ SIRIKATA_PLUGIN_EXPORT_C void destroy ()
             FilterFactory::getSingleton().unregisterConstructor("compute-normals");
 
             FilterFactory::getSingleton().unregisterConstructor("deduplication");
+
+            FilterFactory::getSingleton().unregisterConstructor("optimize-vertex-cache");
         }
     }
 }
@@ -33,6 +33,7 @@
 #include "PrintFilter.hpp"
 #include <sirikata/mesh/Meshdata.hpp>
 #include <sirikata/mesh/Billboard.hpp>
+#include <sirikata/mesh/VertexCache.hpp>
 #include <stack>
 
 namespace Sirikata {
@@ -142,6 +143,7 @@ void PrintFilter::printMeshdata(MeshdataPtr md) {
         printf("   Name: %s, Positions: %d Normals: %d Primitives: %d, UVs: %d (sets) x %d (stride) x %d (count)\n", it->name.c_str(),
             (int)it->positions.size(), (int)it->normals.size(), (int)it->primitives.size(),
             (int)it->texUVs.size(), (int)( it->texUVs.size() ? it->texUVs[0].stride : 0), (int)( it->texUVs.size() ? it->texUVs[0].uvs.size() : 0));
+        printf("      Vertex cache ACMR: %f (cache size %d)\n", ComputeACMR(*it), (int)DefaultVertexCacheSize);
 
         for(std::vector<SubMeshGeometry::Primitive>::const_iterator p = it->primitives.begin(); p != it->primitives.end(); p++) {
             printf("      Primitive: material: %d, indices: %d, type: %s\n", (int)p->materialId, (int)p->indices.size(), PrimitiveTypeToString(p->primitiveType));
@@ -225,14 +227,30 @@ void PrintFilter::printMeshdata(MeshdataPtr md) {
     // This really should trace from the root to make sure that all instances
     // are actually drawn...
     uint32 draw_calls = 0;
+    // Similarly, the average number of vertices transformed per triangle drawn,
+    // weighting each instance by its number of triangles.
+    std::vector<float32> geo_acmr(md->geometry.size(), -1.f);
+    double vertex_misses = 0;
+    uint32 triangles = 0;
 
     Meshdata::GeometryInstanceIterator geoinst_it = md->getGeometryInstanceIterator();
     uint32 geoinst_idx;
     Matrix4x4f pos_xform;
     while( geoinst_it.next(&geoinst_idx, &pos_xform) ) {
-        draw_calls += md->geometry[ md->instances[geoinst_idx].geometryIndex ].primitives.size();
+        uint32 geo_idx = md->instances[geoinst_idx].geometryIndex;
+        const SubMeshGeometry& geo = md->geometry[geo_idx];
+        draw_calls += geo.primitives.size();
+
+        if (geo_acmr[geo_idx] < 0) geo_acmr[geo_idx] = ComputeACMR(geo);
+        uint32 geo_tris = 0;
+        for(uint32 pi = 0; pi < geo.primitives.size(); pi++)
+            if (geo.primitives[pi].primitiveType == SubMeshGeometry::Primitive::TRIANGLES)
+                geo_tris += geo.primitives[pi].indices.size() / 3;
+        vertex_misses += geo_acmr[geo_idx] * geo_tris;
+        triangles += geo_tris;
     }
     printf("Estimated draw calls: %d\n", draw_calls);
+    printf("Estimated vertex cache ACMR: %f (%d triangles)\n", (triangles > 0 ? (float32)(vertex_misses / triangles) : 0.f), triangles);
 
 }
 
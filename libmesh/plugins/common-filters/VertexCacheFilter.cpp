@@ -0,0 +1,204 @@
+// Copyright (c) 2015 Sirikata Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can
+// be found in the LICENSE file.
+
+#include "VertexCacheFilter.hpp"
+#include <sirikata/mesh/VertexCache.hpp>
+#include <sirikata/core/options/Options.hpp>
+
+namespace Sirikata {
+namespace Mesh {
+
+namespace {
+
+const uint32 UnusedVertex = (uint32)-1;
+
+// Reorder per-vertex data with stride elements per vertex so new vertex i is
+// old vertex new_to_old[i].
+template<typename T>
+void permute(std::vector<T>& data, const std::vector<uint32>& new_to_old, uint32 stride = 1) {
+    if (data.empty()) return;
+    std::vector<T> result;
+    result.reserve(new_to_old.size() * stride);
+    for(uint32 i = 0; i < new_to_old.size(); i++)
+        for(uint32 s = 0; s < stride; s++)
+            result.push_back(data[new_to_old[i]*stride + s]);
+    data.swap(result);
+}
+
+void permuteSkin(SkinController& skin, const std::vector<uint32>& new_to_old) {
+    std::vector<unsigned int> starts;
+    std::vector<float> weights;
+    std::vector<unsigned int> joints;
+    starts.reserve(new_to_old.size() + 1);
+    for(uint32 i = 0; i < new_to_old.size(); i++) {
+        starts.push_back(weights.size());
+        uint32 old = new_to_old[i];
+        for(uint32 w = skin.weightStartIndices[old]; w < skin.weightStartIndices[old+1]; w++) {
+            weights.push_back(skin.weights[w]);
+            joints.push_back(skin.jointIndices[w]);
+        }
+    }
+    starts.push_back(weights.size());
+    skin.weightStartIndices.swap(starts);
+    skin.weights.swap(weights);
+    skin.jointIndices.swap(joints);
+}
+
+// Whether every per-vertex array either is empty or has one entry per vertex,
+// which is required to reorder vertices.
+bool perVertexDataConsistent(const SubMeshGeometry& submesh) {
+    uint32 n = submesh.positions.size();
+    if (!submesh.normals.empty() && submesh.normals.size() != n) return false;
+    if (!submesh.tangents.empty() && submesh.tangents.size() != n) return false;
+    if (!submesh.colors.empty() && submesh.colors.size() != n) return false;
+    for(uint32 i = 0; i < submesh.texUVs.size(); i++) {
+        const SubMeshGeometry::TextureSet& ts = submesh.texUVs[i];
+        if (!ts.uvs.empty() && ts.uvs.size() != ts.stride * n) return false;
+    }
+    for(uint32 i = 0; i < submesh.skinControllers.size(); i++) {
+        const SkinController& skin = submesh.skinControllers[i];
+        if (skin.weightStartIndices.size() != n+1) return false;
+        if (skin.weights.size() < skin.weightStartIndices.back() || skin.jointIndices.size() < skin.weightStartIndices.back()) return false;
+    }
+    return true;
+}
+
+} // namespace
+
+Filter* VertexCacheFilter::create(const String& args) {
+    return new VertexCacheFilter(args);
+}
+
+VertexCacheFilter::VertexCacheFilter(const String& args) {
+    // Parse into our own OptionSet so filters created with different
+    // arguments, possibly concurrently, don't share values.
+    OptionSet options;
+    options.addOption(new OptionValue("cache-size","32",Sirikata::OptionValueType<uint32>(),"Size of the post-transform vertex cache to optimize for."));
+    options.addOption(new OptionValue("max-indices","0",Sirikata::OptionValueType<uint32>(),"Maximum number of indices in a single primitive, or 0 for no limit."));
+    options.parse(args);
+
+    mCacheSize = std::max(options.referenceOption("cache-size")->as<uint32>(), (uint32)3);
+    mMaxIndices = options.referenceOption("max-indices")->as<uint32>();
+    // Triangle lists can only be split on triangle boundaries
+    if (mMaxIndices > 0)
+        mMaxIndices = std::max(mMaxIndices - (mMaxIndices % 3), (uint32)3);
+}
+
+FilterDataPtr VertexCacheFilter::apply(FilterDataPtr input) {
+    for(FilterData::const_iterator md_it = input->begin(); md_it != input->end(); md_it++) {
+        MeshdataPtr mesh( std::tr1::dynamic_pointer_cast<Meshdata>(*md_it) );
+        // Nothing to reorder in other types of visuals
+        if (!mesh) continue;
+
+        for(SubMeshGeometryList::iterator sm_it = mesh->geometry.begin(); sm_it != mesh->geometry.end(); sm_it++)
+            optimize(*sm_it);
+    }
+    return input;
+}
+
+void VertexCacheFilter::optimize(SubMeshGeometry& submesh) {
+    typedef SubMeshGeometry::Primitive Primitive;
+
+    uint32 nverts = submesh.positions.size();
+    if (nverts == 0 || submesh.primitives.empty()) return;
+
+    for(uint32 pi = 0; pi < submesh.primitives.size(); pi++) {
+        const Primitive& prim = submesh.primitives[pi];
+        for(uint32 i = 0; i < prim.indices.size(); i++) {
+            if (prim.indices[i] >= nverts) {
+                SILOG(vertex-cache-filter, warn, "Submesh " << submesh.name << " has out of range indices, leaving it alone.");
+                return;
+            }
+        }
+    }
+
+    // Merge triangle lists by material, since they can be drawn with a
+    // single call and the cache optimization works better with more
+    // triangles. Other primitive types are kept as they are.
+    std::vector<Primitive::MaterialId> material_order;
+    std::map<Primitive::MaterialId, std::vector<uint32> > triangles;
+    std::vector<Primitive> others;
+    for(uint32 pi = 0; pi < submesh.primitives.size(); pi++) {
+        const Primitive& prim = submesh.primitives[pi];
+        if (prim.primitiveType != Primitive::TRIANGLES) {
+            others.push_back(prim);
+            continue;
+        }
+        if (triangles.find(prim.materialId) == triangles.end())
+            material_order.push_back(prim.materialId);
+        std::vector<uint32>& group = triangles[prim.materialId];
+        group.insert(group.end(), prim.indices.begin(), prim.indices.begin() + (prim.indices.size() / 3) * 3);
+    }
+
+    for(uint32 mi = 0; mi < material_order.size(); mi++)
+        OptimizeTriangleOrder(&triangles[material_order[mi]], nverts, mCacheSize);
+
+    // Renumber vertices in the order they are first referenced so vertex
+    // fetches walk through memory sequentially.
+    std::vector<uint32> old_to_new(nverts, UnusedVertex);
+    std::vector<uint32> new_to_old;
+    new_to_old.reserve(nverts);
+    for(uint32 mi = 0; mi < material_order.size(); mi++) {
+        const std::vector<uint32>& group = triangles[material_order[mi]];
+        for(uint32 i = 0; i < group.size(); i++) {
+            if (old_to_new[group[i]] != UnusedVertex) continue;
+            old_to_new[group[i]] = new_to_old.size();
+            new_to_old.push_back(group[i]);
+        }
+    }
+    for(uint32 pi = 0; pi < others.size(); pi++) {
+        const std::vector<unsigned short>& indices = others[pi].indices;
+        for(uint32 i = 0; i < indices.size(); i++) {
+            if (old_to_new[indices[i]] != UnusedVertex) continue;
+            old_to_new[indices[i]] = new_to_old.size();
+            new_to_old.push_back(indices[i]);
+        }
+    }
+
+    bool remap = perVertexDataConsistent(submesh);
+    if (remap) {
+        permute(submesh.positions, new_to_old);
+        permute(submesh.normals, new_to_old);
+        permute(submesh.tangents, new_to_old);
+        permute(submesh.colors, new_to_old);
+        for(uint32 i = 0; i < submesh.texUVs.size(); i++)
+            permute(submesh.texUVs[i].uvs, new_to_old, submesh.texUVs[i].stride);
+        for(uint32 i = 0; i < submesh.skinControllers.size(); i++)
+            permuteSkin(submesh.skinControllers[i], new_to_old);
+    }
+    else {
+        SILOG(vertex-cache-filter, detailed, "Submesh " << submesh.name << " has mismatched vertex attributes, only reordering triangles.");
+    }
+
+    // Rebuild the primitives, splitting triangle lists that are over budget.
+    submesh.primitives.clear();
+    for(uint32 mi = 0; mi < material_order.size(); mi++) {
+        const std::vector<uint32>& group = triangles[material_order[mi]];
+        uint32 chunk = (mMaxIndices > 0 ? mMaxIndices : group.size());
+        for(uint32 start = 0; start < group.size(); start += chunk) {
+            uint32 end = std::min(start + chunk, (uint32)group.size());
+            submesh.primitives.push_back(Primitive());
+            Primitive& prim = submesh.primitives.back();
+            prim.primitiveType = Primitive::TRIANGLES;
+            prim.materialId = material_order[mi];
+            prim.indices.reserve(end - start);
+            for(uint32 i = start; i < end; i++)
+                prim.indices.push_back(remap ? old_to_new[group[i]] : group[i]);
+        }
+    }
+    for(uint32 pi = 0; pi < others.size(); pi++) {
+        if (remap) {
+            std::vector<unsigned short>& indices = others[pi].indices;
+            for(uint32 i = 0; i < indices.size(); i++)
+                indices[i] = old_to_new[indices[i]];
+        }
+        submesh.primitives.push_back(others[pi]);
+    }
+
+    if (remap && new_to_old.size() != nverts)
+        submesh.recomputeBounds();
+}
+
+} // namespace Mesh
+} // namespace Sirikata
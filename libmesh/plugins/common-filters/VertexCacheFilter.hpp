@@ -0,0 +1,42 @@
+// Copyright (c) 2015 Sirikata Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can
+// be found in the LICENSE file.
+
+#ifndef _LIBMESH_PLUGIN_COMMON_FILTERS_VERTEX_CACHE_FILTER_HPP_
+#define _LIBMESH_PLUGIN_COMMON_FILTERS_VERTEX_CACHE_FILTER_HPP_
+
+#include <sirikata/mesh/Filter.hpp>
+#include <sirikata/mesh/Meshdata.hpp>
+
+namespace Sirikata {
+namespace Mesh {
+
+/** Reorders geometry so it renders efficiently. Triangle list primitives that
+ *  share a material are merged and their triangles are reordered for the
+ *  post-transform vertex cache, then vertices are reordered into the order they
+ *  are first used so fetches are sequential, dropping any that aren't used at
+ *  all. Primitives are split again if they exceed the index budget.
+ *
+ *  Options: --cache-size=<vertex cache size to optimize for>
+ *           --max-indices=<maximum indices per primitive, 0 for no limit>
+ */
+class VertexCacheFilter : public Filter {
+public:
+    static Filter* create(const String& args);
+
+    VertexCacheFilter(const String& args);
+    virtual ~VertexCacheFilter() {}
+
+    virtual FilterDataPtr apply(FilterDataPtr input);
+
+private:
+    void optimize(SubMeshGeometry& submesh);
+
+    uint32 mCacheSize;
+    uint32 mMaxIndices;
+};
+
+} // namespace Mesh
+} // namespace Sirikata
+
+#endif //_LIBMESH_PLUGIN_COMMON_FILTERS_VERTEX_CACHE_FILTER_HPP_
@@ -36,6 +36,13 @@
 #include "TextureAtlasFilter.hpp"
 #include "FreeImage.hpp"
 #include <nvtt/nvtt.h>
+#include <sirikata/core/network/IOServicePool.hpp>
+#include <sirikata/core/network/IOService.hpp>
+#include <sirikata/core/options/Options.hpp>
+#include <sirikata/core/util/Sha256.hpp>
+#include <sirikata/core/util/Thread.hpp>
+#include <fstream>
+#include <algorithm>
 
 namespace Sirikata {
 namespace Mesh {
@@ -150,6 +157,9 @@ Rect Rect::region(const Region& subreg) {
 // Track some information about the texture that we need as we process it.
 struct TexInfo {
     String url;
+    String file;
+    // Hash of the file contents, only computed in incremental mode
+    String digest;
     Rect orig_size;
     FIBITMAP* image;
     Region atlas_region;
@@ -159,48 +169,431 @@ struct TexInfo {
     //where the charted texture is not available.
     Rect num_copies;
 
-    TexInfo() {
+    // Size of one copy of the texture and of all the tiled copies, and where
+    // the tiled copies are placed, in atlas pixels before the atlas is scaled
+    // down to its final size.
+    float32 tex_width;
+    float32 tex_height;
+    int32 tile_width;
+    int32 tile_height;
+    int32 x;
+    int32 y;
+
+    // Whether the placement and pixels are being kept from the previous atlas
+    bool reused;
+    // Final, scaled tile to paste into the atlas
+    FIBITMAP* tile;
+
+    TexInfo()
+     : image(NULL),
+       tex_width(0), tex_height(0),
+       tile_width(0), tile_height(0),
+       x(0), y(0),
+       reused(false),
+       tile(NULL)
+    {
       num_copies.min_x = 0;
       num_copies.min_y = 0;
       num_copies.max_x = 1;
       num_copies.max_y = 1;
     }
 };
+typedef std::map<String, TexInfo> TexInfoMap;
 
 // Compute a hash value for texture sets in a Meshdata.
 int TextureSetHash(MeshdataPtr md, int sub_mesh_idx, int tex_set_idx) {
     return (tex_set_idx * md->geometry.size()) + sub_mesh_idx;
 }
 
+// Runs the jobs on a temporary pool of threads and waits for them to finish,
+// or just runs them on this thread if there's only one thread or job.
+void RunJobs(const std::vector<Network::IOCallback>& jobs, uint32 nthreads) {
+    if (jobs.empty()) return;
+    nthreads = std::min(nthreads, (uint32)jobs.size());
+    if (nthreads <= 1) {
+        for(uint32 i = 0; i < jobs.size(); i++)
+            jobs[i]();
+        return;
+    }
 
-void getColors(MeshdataPtr md, std::vector<Vector4f>& colors) {
-  std::tr1::unordered_set<String> colorSet;
+    Network::IOServicePool* pool = new Network::IOServicePool("TextureAtlasFilter", nthreads);
+    for(uint32 i = 0; i < jobs.size(); i++)
+        pool->service()->post(jobs[i], "TextureAtlasFilter::job");
+    // No outstanding work, so the threads exit once the jobs are done
+    pool->run();
+    pool->join();
+    delete pool;
+}
 
-  for (uint32 i = 0; i < md->materials.size(); i++) {
-    for (uint32 j = 0; j < md->materials[i].textures.size(); j++) {
-      const MaterialEffectInfo::Texture& texture = md->materials[i].textures[j];
-      if (texture.uri == "" && texture.affecting == texture.DIFFUSE) {
-	char colorEncodingStr[512];
-	sprintf(colorEncodingStr, "%f %f %f %f %d", texture.color.x, texture.color.y,
-		texture.color.z, texture.color.w, texture.affecting);
-	String colorEncoding = colorEncodingStr;
+void DigestTexture(TexInfo* tex) {
+    std::ifstream fin(tex->file.c_str(), std::ios::in | std::ios::binary);
+    if (!fin) return;
+    std::ostringstream data;
+    data << fin.rdbuf();
+    tex->digest = SHA256::computeDigest(data.str()).convertToHexString();
+}
 
-        if (colorSet.find(colorEncoding) == colorSet.end()) {
-	  colorSet.insert(colorEncoding);
-	  colors.push_back(texture.color);
-	}
-      }
+void DecodeTexture(TexInfo* tex) {
+    // Load the data from the original file
+    FIBITMAP* input_image = GenericLoader(tex->file.c_str(), 0);
+    if (input_image == NULL) // Couldn't figure out how to load it
+        return;
+
+    // Make sure we get the data in BGRA 8UB and properly packed
+    tex->image = FreeImage_ConvertTo32Bits(input_image);
+    FreeImage_Unload(input_image);
+    if (tex->image == NULL) return;
+
+    int32 width = FreeImage_GetWidth(tex->image);
+    int32 height = FreeImage_GetHeight(tex->image);
+    tex->orig_size = Rect::fromBaseOffset(0, 0, width, height);
+}
+
+void ComputeTileSize(TexInfo* tex) {
+    uint32 minHeight = 256, minWidth = 256;
+
+    float32 tex_width = tex->orig_size.width(), tex_height = tex->orig_size.height();
+    if (tex_width < minWidth && tex_height < minHeight) {
+        // Textures that are really small
+        // should be enlarged, so that they can be indexed
+        // into more accurately.
+        tex_height = tex_height / tex_width * minWidth;
+        tex_width = minWidth;
+    }
+    int32 num_copies_x = ( tex->num_copies.max_x - tex->num_copies.min_x );
+    int32 num_copies_y = ( tex->num_copies.max_y - tex->num_copies.min_y );
+
+    float32 tiled_texture_width = tex_width * num_copies_x;
+    float32 tiled_texture_height = tex_height * num_copies_y;
+    if (tiled_texture_width * tiled_texture_height > 256.0 * 256.0) {
+        float32 factor = sqrtf(tiled_texture_width * tiled_texture_height / (256.0 * 256.0));
+        tex_width = tex_width/factor;
+        tex_height = tex_height/factor;
+        tiled_texture_width = tex_width * num_copies_x;
+        tiled_texture_height = tex_height * num_copies_y;
+    }
+
+    tex->tex_width = tex_width;
+    tex->tex_height = tex_height;
+    tex->tile_width = std::max((int32)tiled_texture_width, (int32)1);
+    tex->tile_height = std::max((int32)tiled_texture_height, (int32)1);
+}
+
+// The region of the scaled atlas covered by a texture's tiled copies
+Rect ScaledTileRect(const TexInfo& tex, float32 largeFactor) {
+    return Rect::fromBaseOffset(tex.x/largeFactor, tex.y/largeFactor, tex.tile_width/largeFactor, tex.tile_height/largeFactor);
+}
+
+// Resizes the texture, tiles copies of it to deal with texture wrapping and
+// scales the result down to the size it'll have in the final atlas.
+void RenderTile(TexInfo* tex, float32 largeFactor) {
+    int32 num_copies_x = ( tex->num_copies.max_x - tex->num_copies.min_x );
+    int32 num_copies_y = ( tex->num_copies.max_y - tex->num_copies.min_y );
+
+    //Create a single texture multiple tiled copies of the original texture
+    //to deal with texture wrapping. Only works for repeating wrap mode.
+    FIBITMAP* resized = FreeImage_Rescale(tex->image, tex->tex_width, tex->tex_height, FILTER_LANCZOS3);
+    FIBITMAP* tiled_texture =
+            FreeImage_Allocate(tex->tile_width, tex->tile_height, 32);
+    for (int32 xcopy = 0; xcopy < num_copies_x; xcopy++) {
+        for (int32 ycopy = 0; ycopy < num_copies_y; ycopy++) {
+            FreeImage_Paste(tiled_texture, resized, xcopy * tex->tex_width, ycopy * tex->tex_height, 256);
+        }
+    }
+    FreeImage_Unload(resized);
+
+    Rect scaled = ScaledTileRect(*tex, largeFactor);
+    tex->tile = FreeImage_Rescale(tiled_texture, scaled.width(), scaled.height(), FILTER_LANCZOS3);
+
+    FreeImage_Unload(tiled_texture);
+    FreeImage_Unload(tex->image);
+    tex->image = NULL;
+}
+
+// Packs rectangles into a fixed size bin using the MaxRects approach: all the
+// maximal free rectangles are tracked, so any free region can be claimed and
+// new rectangles are put in the lowest, then leftmost, position they fit.
+class AtlasPacker {
+public:
+    AtlasPacker(int32 width, int32 height) {
+        mFree.push_back(Rect::fromBaseOffset(0, 0, width, height));
+    }
+
+    bool insert(int32 width, int32 height, int32* x, int32* y) {
+        int32 best = -1;
+        for(uint32 i = 0; i < mFree.size(); i++) {
+            const Rect& f = mFree[i];
+            if (f.width() < width || f.height() < height) continue;
+            if (best == -1 ||
+                f.min_y < mFree[best].min_y ||
+                (f.min_y == mFree[best].min_y && f.min_x < mFree[best].min_x))
+                best = i;
+        }
+        if (best == -1) return false;
+
+        *x = mFree[best].min_x;
+        *y = mFree[best].min_y;
+        claim(Rect::fromBaseOffset(*x, *y, width, height));
+        return true;
+    }
+
+    // Claim a specific region, e.g. one kept from a previous layout. Any free
+    // region is contained in one of the maximal free rectangles, so this only
+    // needs to check them individually.
+    bool place(int32 x, int32 y, int32 width, int32 height) {
+        Rect used = Rect::fromBaseOffset(x, y, width, height);
+        for(uint32 i = 0; i < mFree.size(); i++) {
+            const Rect& f = mFree[i];
+            if (f.min_x <= used.min_x && f.min_y <= used.min_y &&
+                f.max_x >= used.max_x && f.max_y >= used.max_y) {
+                claim(used);
+                return true;
+            }
+        }
+        return false;
+    }
+
+private:
+    void claim(const Rect& used) {
+        std::vector<Rect> result;
+        for(uint32 i = 0; i < mFree.size(); i++) {
+            const Rect& f = mFree[i];
+            if (used.min_x > f.max_x || used.max_x < f.min_x ||
+                used.min_y > f.max_y || used.max_y < f.min_y) {
+                result.push_back(f);
+                continue;
+            }
+            // Replace it with the (overlapping) maximal pieces left around used
+            if (used.min_x > f.min_x)
+                result.push_back(Rect::fromBounds(f.min_x, f.min_y, used.min_x - 1, f.max_y));
+            if (used.max_x < f.max_x)
+                result.push_back(Rect::fromBounds(used.max_x + 1, f.min_y, f.max_x, f.max_y));
+            if (used.min_y > f.min_y)
+                result.push_back(Rect::fromBounds(f.min_x, f.min_y, f.max_x, used.min_y - 1));
+            if (used.max_y < f.max_y)
+                result.push_back(Rect::fromBounds(f.min_x, used.max_y + 1, f.max_x, f.max_y));
+        }
+
+        // Drop any rectangles contained in others so only maximal ones remain
+        mFree.clear();
+        for(uint32 i = 0; i < result.size(); i++) {
+            bool contained = false;
+            for(uint32 j = 0; j < result.size() && !contained; j++) {
+                if (i == j) continue;
+                const Rect& a = result[i];
+                const Rect& b = result[j];
+                if (b.min_x <= a.min_x && b.min_y <= a.min_y &&
+                    b.max_x >= a.max_x && b.max_y >= a.max_y &&
+                    // Break ties between identical rects by index
+                    (b.min_x != a.min_x || b.min_y != a.min_y || b.max_x != a.max_x || b.max_y != a.max_y || j < i))
+                    contained = true;
+            }
+            if (!contained) mFree.push_back(result[i]);
+        }
+    }
+
+    std::vector<Rect> mFree;
+};
+
+// Larger textures first, which packs much more tightly. Ties are broken by URL
+// so the layout is deterministic.
+bool TallerTileFirst(const TexInfo* lhs, const TexInfo* rhs) {
+    if (lhs->tile_height != rhs->tile_height) return lhs->tile_height > rhs->tile_height;
+    if (lhs->tile_width != rhs->tile_width) return lhs->tile_width > rhs->tile_width;
+    return lhs->url < rhs->url;
+}
+
+// The layout of a previously generated atlas, saved alongside it so later
+// versions of the same mesh can keep the placements of unchanged textures.
+struct AtlasLayout {
+    struct Entry {
+        String digest;
+        Rect orig_size;
+        Rect num_copies;
+        int32 x;
+        int32 y;
+    };
+    typedef std::map<String, Entry> EntryMap;
+
+    int32 width;
+    int32 height;
+    EntryMap entries;
+};
+
+const char* AtlasLayoutMagic = "sirikata-texture-atlas-layout";
+const int32 AtlasLayoutVersion = 1;
+
+bool LoadAtlasLayout(const String& filename, AtlasLayout* layout) {
+    std::ifstream fin(filename.c_str());
+    if (!fin) return false;
+
+    String magic;
+    int32 version;
+    fin >> magic >> version >> layout->width >> layout->height;
+    if (!fin || magic != AtlasLayoutMagic || version != AtlasLayoutVersion) return false;
+
+    while(true) {
+        AtlasLayout::Entry entry;
+        int32 orig_width, orig_height;
+        fin >> entry.x >> entry.y >> orig_width >> orig_height
+            >> entry.num_copies.min_x >> entry.num_copies.min_y >> entry.num_copies.max_x >> entry.num_copies.max_y
+            >> entry.digest;
+        String url;
+        std::getline(fin, url);
+        if (!fin) break;
+        // Strip the separator, the URL is the rest of the line
+        if (url.empty()) return false;
+        url = url.substr(1);
+        entry.orig_size = Rect::fromBaseOffset(0, 0, orig_width, orig_height);
+        layout->entries[url] = entry;
+    }
+    return fin.eof();
+}
+
+void SaveAtlasLayout(const String& filename, int32 width, int32 height, const TexInfoMap& tex_info) {
+    std::ofstream fout(filename.c_str(), std::ios::out | std::ios::trunc);
+    if (!fout) {
+        SILOG(textureatlas, warn, "Couldn't save texture atlas layout to " << filename);
+        return;
+    }
+    fout << AtlasLayoutMagic << " " << AtlasLayoutVersion << "\n" << width << " " << height << "\n";
+    for(TexInfoMap::const_iterator tex_it = tex_info.begin(); tex_it != tex_info.end(); tex_it++) {
+        const TexInfo& tex = tex_it->second;
+        if (tex.digest.empty()) continue;
+        fout << tex.x << " " << tex.y << " "
+             << tex.orig_size.width() << " " << tex.orig_size.height() << " "
+             << tex.num_copies.min_x << " " << tex.num_copies.min_y << " " << tex.num_copies.max_x << " " << tex.num_copies.max_y << " "
+             << tex.digest << " " << tex.url << "\n";
+    }
+}
+
+bool SameRect(const Rect& lhs, const Rect& rhs) {
+    return lhs.min_x == rhs.min_x && lhs.min_y == rhs.min_y &&
+        lhs.max_x == rhs.max_x && lhs.max_y == rhs.max_y;
+}
+
+// Scale factor to get the atlas down to the number of pixels we want.
+float32 AtlasScaleFactor(float32 atlas_width, float32 atlas_height) {
+    // The number of pixels we want per atlas. 32768 px at 8 bit RGBA
+    // corresponds to 128 KB of texture RAM,
+    // 65536 px corresponds to 256 KB of texture RAM and so on.
+    float32 scaled_atlas_pixels = 32768/2.0;
+    float32 largeFactor = 1.0;
+    if (atlas_width * atlas_height > scaled_atlas_pixels)
+      largeFactor = sqrtf(atlas_width * atlas_height/scaled_atlas_pixels);
+    return largeFactor;
+}
+
+// Tries to lay out the textures in the same atlas as before, keeping the
+// placements of textures marked as reused. On success, also returns the old
+// atlas image to copy their pixels from.
+bool LayoutIncremental(const AtlasLayout& layout, const String& atlas_file, TexInfoMap& tex_info, int32* atlas_width, int32* atlas_height, FIBITMAP** old_atlas) {
+    // Placements are only reusable if the atlas they're in keeps the same size
+    // and scale, so new textures have to fit in the space that's left.
+    AtlasPacker packer(layout.width, layout.height);
+    std::vector<TexInfo*> added;
+    int64 used_area = 0;
+    for(TexInfoMap::iterator tex_it = tex_info.begin(); tex_it != tex_info.end(); tex_it++) {
+        TexInfo& tex = tex_it->second;
+        used_area += (int64)tex.tile_width * tex.tile_height;
+        AtlasLayout::EntryMap::const_iterator entry_it = layout.entries.find(tex.url);
+        if (!tex.reused || entry_it == layout.entries.end() ||
+            !SameRect(entry_it->second.num_copies, tex.num_copies) ||
+            !packer.place(entry_it->second.x, entry_it->second.y, tex.tile_width, tex.tile_height)) {
+            tex.reused = false;
+            added.push_back(&tex);
+            continue;
+        }
+        tex.x = entry_it->second.x;
+        tex.y = entry_it->second.y;
+    }
+
+    // Once removed textures leave too much of the atlas empty, start over
+    // so it shrinks back down.
+    if (used_area * 2 < (int64)layout.width * layout.height) return false;
+
+    std::sort(added.begin(), added.end(), TallerTileFirst);
+    for(uint32 i = 0; i < added.size(); i++) {
+        if (!packer.insert(added[i]->tile_width, added[i]->tile_height, &added[i]->x, &added[i]->y))
+            return false;
+    }
+
+    // Nothing to gain from keeping the old size if nothing is reused
+    bool any_reused = false;
+    for(TexInfoMap::iterator tex_it = tex_info.begin(); tex_it != tex_info.end(); tex_it++)
+        any_reused = any_reused || tex_it->second.reused;
+    if (!any_reused) return false;
+
+    // Only load the old atlas once we know we can use it
+    float32 largeFactor = AtlasScaleFactor(layout.width, layout.height);
+    FIBITMAP* atlas = GenericLoader(atlas_file.c_str(), 0);
+    if (atlas == NULL) return false;
+    if ((int32)FreeImage_GetWidth(atlas) != (int32)(layout.width/largeFactor) ||
+        (int32)FreeImage_GetHeight(atlas) != (int32)(layout.height/largeFactor) ||
+        FreeImage_GetBPP(atlas) != 32) {
+        FreeImage_Unload(atlas);
+        return false;
+    }
+    *old_atlas = atlas;
+
+    *atlas_width = layout.width;
+    *atlas_height = layout.height;
+    return true;
+}
+
+// Lays out all the textures from scratch.
+void LayoutFull(TexInfoMap& tex_info, int32* atlas_width, int32* atlas_height) {
+    std::vector<TexInfo*> sorted;
+    int64 total_area = 0;
+    int32 max_width = 1, total_height = 0;
+    for(TexInfoMap::iterator tex_it = tex_info.begin(); tex_it != tex_info.end(); tex_it++) {
+        TexInfo& tex = tex_it->second;
+        tex.reused = false;
+        sorted.push_back(&tex);
+        total_area += (int64)tex.tile_width * tex.tile_height;
+        max_width = std::max(max_width, tex.tile_width);
+        total_height += tex.tile_height;
+    }
+    std::sort(sorted.begin(), sorted.end(), TallerTileFirst);
+
+    // Aim for a roughly square atlas. The bin is tall enough to stack
+    // everything, so inserts can't fail, and we trim it to what's used.
+    int32 bin_width = std::max(max_width, (int32)ceil(sqrt((double)total_area)));
+    AtlasPacker packer(bin_width, std::max(total_height, (int32)1));
+    *atlas_width = 1;
+    *atlas_height = 1;
+    for(uint32 i = 0; i < sorted.size(); i++) {
+        TexInfo& tex = *sorted[i];
+        bool inserted = packer.insert(tex.tile_width, tex.tile_height, &tex.x, &tex.y);
+        assert(inserted);
+        (void)inserted;
+        *atlas_width = std::max(*atlas_width, tex.x + tex.tile_width);
+        *atlas_height = std::max(*atlas_height, tex.y + tex.tile_height);
     }
-  }
 }
 
 } // namespace
 
 TextureAtlasFilter::TextureAtlasFilter(const String& args) {
+    // Parse into our own OptionSet rather than a registered one. One filter is
+    // created per aggregate, possibly concurrently, and a shared set would be
+    // re-registered and re-parsed by each of them.
+    OptionSet options;
+    options.addOption(new OptionValue("threads","0",Sirikata::OptionValueType<uint32>(),"Number of threads to decode and resize textures with, or 0 to pick automatically."));
+    options.addOption(new OptionValue("incremental","false",Sirikata::OptionValueType<bool>(),"If true, save the atlas layout alongside the atlas and reuse it for textures that haven't changed the next time the same mesh is atlased."));
+    options.addOption(new OptionValue("cache-dir","",Sirikata::OptionValueType<String>(),"Directory to keep atlas layouts and copies of atlases in for incremental mode. By default they are kept next to the mesh."));
+    options.parse(args);
+
+    mThreads = options.referenceOption("threads")->as<uint32>();
+    if (mThreads == 0)
+        mThreads = std::min(std::max(Thread::hardware_concurrency(), (unsigned)1), (unsigned)4);
+    mIncremental = options.referenceOption("incremental")->as<bool>();
+    mCacheDir = options.referenceOption("cache-dir")->as<String>();
+    if (!mCacheDir.empty() && mCacheDir[mCacheDir.size()-1] != '/')
+        mCacheDir += "/";
 }
 
 MeshdataPtr TextureAtlasFilter::apply(MeshdataPtr md) {
-    typedef std::map<String, TexInfo> TexInfoMap;
     TexInfoMap tex_info;
 
 
@@ -271,43 +664,73 @@ MeshdataPtr TextureAtlasFilter::apply(MeshdataPtr md) {
         }
     }
 
-    // First compute some stats.
+    String atlas_url = uri_dir + file_name + ".atlas.png";
+    // The previous atlas and its layout, which may need to be kept elsewhere if
+    // the mesh's directory doesn't stick around.
+    String cache_dir = (mCacheDir.empty() ? uri_dir : mCacheDir);
+    String cached_atlas_file = cache_dir + file_name + ".atlas.png";
+    String layout_file = cache_dir + file_name + ".atlas.layout";
+
     for(uint32 tex_i = 0; tex_i < md->textures.size(); tex_i++) {
         String tex_url = md->textures[tex_i];
-        String texfile = uri_dir + tex_url;
-
         tex_info[tex_url] = TexInfo();
         tex_info[tex_url].url = tex_url;
+        tex_info[tex_url].file = uri_dir + tex_url;
+    }
 
-        // Load the data from the original file
-        FIBITMAP* input_image = GenericLoader(texfile.c_str(), 0);
-        if (input_image == NULL) { // Couldn't figure out how to load it
-            tex_info[tex_url].image = NULL;
-            continue;
+    // In incremental mode, textures whose contents match the previous layout
+    // don't need to be decoded unless the layout ends up being rebuilt.
+    AtlasLayout prev_layout;
+    bool have_layout = false;
+    if (mIncremental) {
+        std::vector<Network::IOCallback> jobs;
+        for(TexInfoMap::iterator tex_it = tex_info.begin(); tex_it != tex_info.end(); tex_it++)
+            jobs.push_back(std::tr1::bind(&DigestTexture, &tex_it->second));
+        RunJobs(jobs, mThreads);
+
+        have_layout = LoadAtlasLayout(layout_file, &prev_layout);
+        if (have_layout) {
+            for(TexInfoMap::iterator tex_it = tex_info.begin(); tex_it != tex_info.end(); tex_it++) {
+                TexInfo& tex = tex_it->second;
+                AtlasLayout::EntryMap::const_iterator entry_it = prev_layout.entries.find(tex.url);
+                if (tex.digest.empty() || entry_it == prev_layout.entries.end() || entry_it->second.digest != tex.digest)
+                    continue;
+                tex.orig_size = entry_it->second.orig_size;
+                tex.reused = true;
+            }
         }
+    }
 
-        // Make sure we get the data in BGRA 8UB and properly packed
-        FIBITMAP* input_image_32 = FreeImage_ConvertTo32Bits(input_image);
-        FreeImage_Unload(input_image);
-        tex_info[tex_url].image = input_image_32;
-
-        int32 width = FreeImage_GetWidth(input_image_32);
-        int32 height = FreeImage_GetHeight(input_image_32);
-
-        tex_info[tex_url].orig_size = Rect::fromBaseOffset(0, 0, width, height);
+    // Decode everything we can't reuse in parallel, then drop any textures
+    // that couldn't be loaded.
+    {
+        std::vector<Network::IOCallback> jobs;
+        for(TexInfoMap::iterator tex_it = tex_info.begin(); tex_it != tex_info.end(); tex_it++)
+            if (!tex_it->second.reused)
+                jobs.push_back(std::tr1::bind(&DecodeTexture, &tex_it->second));
+        RunJobs(jobs, mThreads);
+
+        for(TexInfoMap::iterator tex_it = tex_info.begin(); tex_it != tex_info.end(); ) {
+            if (!tex_it->second.reused && tex_it->second.image == NULL) {
+                SILOG(textureatlas, warn, "Couldn't load texture " << tex_it->second.file << ", leaving it out of the atlas.");
+                tex_info.erase(tex_it++);
+            }
+            else {
+                tex_it++;
+            }
+        }
     }
 
     //Count how many times the UV-coords for each texture wrap-around.
     for(uint32 geo_idx = 0; geo_idx < md->geometry.size(); geo_idx++) {
       SubMeshGeometry& submesh = md->geometry[geo_idx];
 
-      // We need to iterate over each texture coordinate set in this geometry. 
+      // We need to iterate over each texture coordinate set in this geometry.
       for(uint32 tex_set_idx = 0; tex_set_idx < submesh.texUVs.size(); tex_set_idx++) {
         SubMeshGeometry::TextureSet& tex_set = submesh.texUVs[tex_set_idx];
-        std::vector<float> new_uvs = tex_set.uvs;
 
-        // Each prim defines a material mapping, so we need to split the                                     
-        // texture coordinates up by prim.                                                             
+        // Each prim defines a material mapping, so we need to split the
+        // texture coordinates up by prim.
         for(uint32 prim_idx = 0; prim_idx < submesh.primitives.size(); prim_idx++) {
           SubMeshGeometry::Primitive& prim = submesh.primitives[prim_idx];
           int mat_id = prim.materialId;
@@ -329,7 +752,6 @@ MeshdataPtr TextureAtlasFilter::apply(MeshdataPtr md) {
             for(uint32 index_idx = 0; index_idx < prim.indices.size(); index_idx++) {
               int index = prim.indices[index_idx]; assert (index_idx < prim.indices.size());
 
-              float new_u, new_v;
               assert(tex_set.stride >= 2);
               float old_u = tex_set.uvs[index * tex_set.stride];
               float old_v = 1.f - tex_set.uvs[index * tex_set.stride + 1]; //inverted vcoord
@@ -350,220 +772,97 @@ MeshdataPtr TextureAtlasFilter::apply(MeshdataPtr md) {
       }
     }
 
-    //Get all the colors referenced by the model
-    std::vector<Vector4f> colorList;
-    getColors(md, colorList);
-
-    // Select the block size and layout, create target image
-    int ntextures = tex_info.size()+colorList.size();
-    int ntextures_side = (int)(sqrtf((float)ntextures) + 1.f);
-
-    // Figure out how large the overall atlas should be.
-    uint32 minHeight = 256, minWidth = 256;
-    uint32 maxRowWidth = 0, curRowWidth = 0, totalHeight = 0, curRowHeight = 0;
-    uint32 counter = 0;
-    for(TexInfoMap::iterator tex_it = tex_info.begin(); tex_it != tex_info.end(); tex_it++) {
-      TexInfo& tex = tex_it->second;
-      if (counter % ntextures_side == 0) {
-        //New row starting... do some book-keeping.
-        if (curRowWidth > maxRowWidth) {
-          maxRowWidth = curRowWidth;
+    for(TexInfoMap::iterator tex_it = tex_info.begin(); tex_it != tex_info.end(); tex_it++)
+        ComputeTileSize(&tex_it->second);
+
+    // Select the layout. Colors aren't currently included in the atlas since
+    // they increase pressure on texture RAM.
+    int32 atlas_width = 0, atlas_height = 0;
+    FIBITMAP* old_atlas = NULL;
+    if (!have_layout || !LayoutIncremental(prev_layout, cached_atlas_file, tex_info, &atlas_width, &atlas_height, &old_atlas)) {
+        // Starting over, so anything we skipped decoding needs to be loaded now
+        std::vector<Network::IOCallback> jobs;
+        for(TexInfoMap::iterator tex_it = tex_info.begin(); tex_it != tex_info.end(); tex_it++) {
+            tex_it->second.reused = false;
+            if (tex_it->second.image == NULL)
+                jobs.push_back(std::tr1::bind(&DecodeTexture, &tex_it->second));
         }
-        curRowWidth = 0;
-        totalHeight += curRowHeight;
-        curRowHeight = 0;
-      }
-      counter++;
-
-      float32 tex_width = tex.orig_size.width(), tex_height = tex.orig_size.height();
-      if (tex_width < minWidth && tex_height < minHeight) {
-        // Textures that are really small 
-        // should be enlarged, so that they can be indexed
-        // into more accurately.
-        tex_height = tex_height / tex_width * minWidth;
-        tex_width = minWidth;
-      }
-      float32 num_copies_x = ( tex.num_copies.max_x - tex.num_copies.min_x );
-      float32 num_copies_y = ( tex.num_copies.max_y - tex.num_copies.min_y ) ;
-
-      if (tex_width * num_copies_x * tex_height * num_copies_y > 256*256) {
-        float32 factor = sqrtf(tex_width * num_copies_x * tex_height * num_copies_y / (256.0 * 256.0));
-        tex_width = tex_width/factor * num_copies_x;
-        tex_height = tex_height/factor * num_copies_y;
-      }
-      else {
-        tex_width *= num_copies_x;
-        tex_height *= num_copies_y;
-      }
-  
-      curRowWidth += tex_width;  
-      if (tex_height > curRowHeight)
-        curRowHeight = tex_height;
-    }
-    //Include colors in the atlas... find out how many color elements are needed.
-    /*for (uint32 i=0; i < colorList.size() ; i++) {
-      if (counter % ntextures_side == 0) {
-        //New row starting... do some book-keeping.
-        if (curRowWidth > maxRowWidth) {
-          maxRowWidth = curRowWidth;
+        RunJobs(jobs, mThreads);
+        for(TexInfoMap::iterator tex_it = tex_info.begin(); tex_it != tex_info.end(); ) {
+            if (tex_it->second.image == NULL)
+                tex_info.erase(tex_it++);
+            else
+                tex_it++;
         }
-        curRowWidth = 0;
-        totalHeight += curRowHeight;
-        curRowHeight = 0;
-      }
-      counter++;
 
-      float32 tex_width = 32, tex_height = 32;
-      curRowWidth += tex_width;
-      if (tex_height > curRowHeight)
-        curRowHeight = tex_height;
-    } */
-    
-    if (curRowWidth > maxRowWidth) {
-      maxRowWidth = curRowWidth;
+        LayoutFull(tex_info, &atlas_width, &atlas_height);
+    }
+    else {
+        // Any textures we're not reusing need decoding if they were only
+        // digested, e.g. because they moved out of their old placement.
+        std::vector<Network::IOCallback> jobs;
+        for(TexInfoMap::iterator tex_it = tex_info.begin(); tex_it != tex_info.end(); tex_it++)
+            if (!tex_it->second.reused && tex_it->second.image == NULL)
+                jobs.push_back(std::tr1::bind(&DecodeTexture, &tex_it->second));
+        RunJobs(jobs, mThreads);
+        for(TexInfoMap::iterator tex_it = tex_info.begin(); tex_it != tex_info.end(); ) {
+            if (!tex_it->second.reused && tex_it->second.image == NULL)
+                tex_info.erase(tex_it++);
+            else
+                tex_it++;
+        }
     }
-    totalHeight += curRowHeight;
-    
 
     // OK, create the atlas!!
-    float32 atlas_width = maxRowWidth, atlas_height = totalHeight;
-    
-    // The number of pixels we want per atlas. 32768 px at 8 bit RGBA
-    // corresponds to 128 KB of texture RAM,
-    // 65536 px corresponds to 256 KB of texture RAM and so on.
-    float32 scaled_atlas_pixels = 32768/2.0;
-    float32 largeFactor = 1.0;
-    if (atlas_width * atlas_height > scaled_atlas_pixels)
-      largeFactor = sqrtf(atlas_width * atlas_height/scaled_atlas_pixels);
-    
-    float32 scaled_atlas_width = atlas_width/largeFactor, 
+    float32 largeFactor = AtlasScaleFactor(atlas_width, atlas_height);
+    float32 scaled_atlas_width = atlas_width/largeFactor,
             scaled_atlas_height= atlas_height/largeFactor;
 
-    FIBITMAP* scaled_atlas = 
+    FIBITMAP* scaled_atlas =
               FreeImage_Allocate(scaled_atlas_width, scaled_atlas_height, 32);
-
-    uint32 xLoc = 0, yLoc = 0;
-    counter = 0;
-    curRowHeight = 0;
-    curRowWidth = 0;
     Rect atlas_rect = Rect::fromBaseOffset(0, 0, scaled_atlas_width, scaled_atlas_height);
 
-    //Copy and paste the re-scaled textures first
+    // Resize and tile the textures in parallel, and pull out the ones we're
+    // keeping from the old atlas.
+    {
+        std::vector<Network::IOCallback> jobs;
+        for(TexInfoMap::iterator tex_it = tex_info.begin(); tex_it != tex_info.end(); tex_it++) {
+            TexInfo& tex = tex_it->second;
+            if (tex.reused) {
+                Rect tex_sub_rect = ScaledTileRect(tex, largeFactor);
+                tex.tile = FreeImage_Copy(old_atlas, tex_sub_rect.min_x, tex_sub_rect.min_y, tex_sub_rect.max_x+1, tex_sub_rect.max_y+1);
+            }
+            else if (tex.image != NULL) {
+                jobs.push_back(std::tr1::bind(&RenderTile, &tex, largeFactor));
+            }
+        }
+        RunJobs(jobs, mThreads);
+    }
+    if (old_atlas != NULL)
+        FreeImage_Unload(old_atlas);
+
+    //Copy the texture images into the atlas
     for(TexInfoMap::iterator tex_it = tex_info.begin(); tex_it != tex_info.end(); tex_it++) {
       TexInfo& tex = tex_it->second;
-      if (counter % ntextures_side == 0) {
-        //Book-keeping for a new row.
-        xLoc = 0;
-        yLoc += curRowHeight;
-        curRowHeight = 0;
-        curRowWidth = 0;
-      }
-      counter++;
 
-      //First create the individual tiled texture.
-      float32 tex_width = tex.orig_size.width(), tex_height = tex.orig_size.height();
-      if (tex_width < minWidth && tex_height < minHeight) {
-        // Textures that are really small 
-        // should be enlarged, so that they can be indexed
-        // into more accurately.
-        tex_height = tex_height / tex_width * minWidth;
-        tex_width = minWidth;
-      }
-      int32 num_copies_x = ( tex.num_copies.max_x - tex.num_copies.min_x );
-      int32 num_copies_y = ( tex.num_copies.max_y - tex.num_copies.min_y );
-
-      //Create a single texture multiple tiled copies of the original texture
-      //to deal with texture wrapping. Only works for repeating wrap mode.
-
-      float32 tiled_texture_width = tex_width * num_copies_x;
-      float32 tiled_texture_height = tex_height * num_copies_y; 
-      if (tiled_texture_width * tiled_texture_height > 256.0 * 256.0) {
-        float32 factor = sqrtf(tiled_texture_width * tiled_texture_height / (256.0 * 256.0));
-        tex_width = tex_width/factor;
-        tex_height = tex_height/factor;
-        tiled_texture_width = tex_width * num_copies_x;
-        tiled_texture_height = tex_height * num_copies_y;
-      }
-      FIBITMAP* resized = FreeImage_Rescale(tex.image, tex_width, tex_height, FILTER_LANCZOS3);
-      FIBITMAP* tiled_texture =
-              FreeImage_Allocate(tiled_texture_width, tiled_texture_height, 32);
-      for (uint32 xcopy = 0; xcopy < num_copies_x; xcopy++) {
-         for (uint32 ycopy = 0; ycopy < num_copies_y; ycopy++) {
-           FreeImage_Paste(tiled_texture, resized, xcopy * tex_width, ycopy * tex_height, 256);
-         }
+      Rect tex_sub_rect = ScaledTileRect(tex, largeFactor);
+      if (tex.tile != NULL) {
+        FreeImage_Paste(scaled_atlas, tex.tile, tex_sub_rect.min_x, tex_sub_rect.min_y, 256);
+        FreeImage_Unload(tex.tile);
+        tex.tile = NULL;
       }
-      FreeImage_Unload(resized);
 
-      FIBITMAP* resized_tiled = FreeImage_Rescale(tiled_texture, (int)(tiled_texture_width/largeFactor), (int)(tiled_texture_height/largeFactor), FILTER_LANCZOS3);
-
-      //Copy the texture image into the atlas
-      Rect tex_sub_rect = Rect::fromBaseOffset(xLoc/largeFactor, yLoc/largeFactor, tiled_texture_width/largeFactor, tiled_texture_height/largeFactor);
-      FreeImage_Paste(scaled_atlas, resized_tiled, tex_sub_rect.min_x, tex_sub_rect.min_y, 256);
-
-      tex_sub_rect = Rect::fromBaseOffset( (xLoc - tex.num_copies.min_x*tex_width)/largeFactor, (yLoc - tex.num_copies.min_y*tex_height)/largeFactor, tex_width/largeFactor, tex_height/largeFactor);
+      tex_sub_rect = Rect::fromBaseOffset( (tex.x - tex.num_copies.min_x*tex.tex_width)/largeFactor, (tex.y - tex.num_copies.min_y*tex.tex_height)/largeFactor, tex.tex_width/largeFactor, tex.tex_height/largeFactor);
       tex.atlas_region = atlas_rect.region(tex_sub_rect);
-
-      FreeImage_Unload(resized_tiled);
-      FreeImage_Unload(tiled_texture);
-      FreeImage_Unload(tex_it->second.image);
-      tex_it->second.image = NULL;
-
-      //more book-keeping.
-      curRowWidth += tiled_texture_width;
-      if (tiled_texture_height > curRowHeight)
-        curRowHeight = tiled_texture_height;
-      xLoc = curRowWidth;
-    }
-
-    //Now include the colors in the atlas. Commented out currently since this
-    //increases pressure on texture RAM.
-    std::tr1::unordered_map<Vector4f, Region, Vector4f::Hasher> colorRegionMap;
-    /*for (uint32 i=0; i < colorList.size(); i++) {
-      if (counter % ntextures_side == 0) {
-        //New row starting... do some book-keeping.
-        xLoc = 0;
-        yLoc += curRowHeight;
-        curRowWidth = 0;
-        curRowHeight = 0;
-      }
-      counter++;
-
-      float32 tex_width = 32, tex_height = 32;
-      FIBITMAP* color_texture = FreeImage_Allocate(tex_width, tex_height, 32);
-      Vector4f color = colorList[i];
-      SILOG(textureatlas, detailed, colorList[i] << " : colorList[i]");
-      RGBQUAD rgbColor;  
-      rgbColor.rgbRed =   color.x*255.f;
-      rgbColor.rgbGreen = color.y*255.f;
-      rgbColor.rgbBlue = color.z*255.f;
-      rgbColor.rgbReserved =  color.w*255.f;
-      for (uint32 w = 0; w < tex_width; w++) {
-        for (uint32 h = 0; h < tex_height; h++)
-          FreeImage_SetPixelColor(color_texture, w, h, &rgbColor);
-      }
-   
-      FIBITMAP* resized_color = FreeImage_Rescale(color_texture, (int)(tex_width/largeFactor), (int)(tex_height/largeFactor), FILTER_LANCZOS3);
-      //copy the texture image into the atlas
-      Rect tex_sub_rect = Rect::fromBaseOffset(xLoc/largeFactor, yLoc/largeFactor, tex_width/largeFactor, tex_height/largeFactor);
-      SILOG(textureatlas, detailed, "Copying into: "); tex_sub_rect.printString();
-      FreeImage_Paste(scaled_atlas, resized_color, tex_sub_rect.min_x, tex_sub_rect.min_y, 256);
-
-      colorRegionMap[color] = atlas_rect.region(tex_sub_rect);
-      SILOG(textureatlas, detailed,  "Setting uv range to: "); tex_sub_rect.printString();
-      colorRegionMap[color].printString();
-
-      FreeImage_Unload(color_texture);      
-      FreeImage_Unload(resized_color);
-
-      curRowWidth += tex_width;
-      if (tex_height > curRowHeight)
-        curRowHeight = tex_height;
-      xLoc = curRowWidth;
-    } */
+    }
 
     // Generate the final, scaled-to-fit-on-GPU-memory texture atlas
-    String atlas_url = uri_dir + file_name + ".atlas.png";
     FreeImage_Save(FIF_PNG, scaled_atlas, atlas_url.c_str());
+    if (mIncremental) {
+        if (cached_atlas_file != atlas_url)
+            FreeImage_Save(FIF_PNG, scaled_atlas, cached_atlas_file.c_str());
+        SaveAtlasLayout(layout_file, atlas_width, atlas_height, tex_info);
+    }
     FreeImage_Unload(scaled_atlas);
 
     // Now we need to run through and fix up texture references and texture
@@ -597,7 +896,7 @@ MeshdataPtr TextureAtlasFilter::apply(MeshdataPtr md) {
                 // We stored up the correct material index to find it in the
                 // Meshdata in the tex_set_materials when we were sanity checking
                 // that there were no conflicts.
-                int mat_idx = tex_set_materials[tex_set_hash]; 
+                int mat_idx = tex_set_materials[tex_set_hash];
 
                 // Finally, having extracted all the material mapping info, we
                 // can loop through referenced indices and transform them.
@@ -608,38 +907,23 @@ MeshdataPtr TextureAtlasFilter::apply(MeshdataPtr md) {
                 // ensures we catch everything.
                 for(uint32 mat_tex_idx = 0; mat_tex_idx < mat.textures.size(); mat_tex_idx++) {
                     MaterialEffectInfo::Texture& real_tex = mat.textures[mat_tex_idx];
-                    Region& final_tex_info_region = (real_tex.uri.empty()) ? colorRegionMap[real_tex.color] : tex_info[real_tex.uri].atlas_region;
-                    if (tex_info.find(real_tex.uri) == tex_info.end()) continue;
-                    bool colorRegion = false;
-                    if (real_tex.uri.empty()) { 
-                      continue;
-                      if (real_tex.affecting != real_tex.DIFFUSE) {
-                        continue;
-                      }
-                      //SILOG(textureatlas, detailed, real_tex.color << " : real_tex.color");
-                      //final_tex_info_region.printString();
-                      colorRegion = true;
-                    }
-                    
+                    if (real_tex.uri.empty()) continue;
+                    TexInfoMap::iterator tex_it = tex_info.find(real_tex.uri);
+                    if (tex_it == tex_info.end()) continue;
+                    Region& final_tex_info_region = tex_it->second.atlas_region;
 
                     for(uint32 index_idx = 0; index_idx < prim.indices.size(); index_idx++) {
-                        int index = prim.indices[index_idx]; 
+                        int index = prim.indices[index_idx];
 
                         float new_u, new_v;
                         assert(tex_set.stride >= 2);
                         float old_u = tex_set.uvs[index * tex_set.stride];
                         float old_v = tex_set.uvs[index * tex_set.stride + 1];
 
-                        if (colorRegion) {
-                           new_u = 0.5*(final_tex_info_region.min_x + final_tex_info_region.max_x);
-                           new_v = 0.5*(final_tex_info_region.min_y + final_tex_info_region.max_y);
-                        }
-                        else {
-                          final_tex_info_region.convert(
-                              old_u,
-                              (1.f-old_v), // inverted v coords
-                              &new_u, &new_v);  
-                        }
+                        final_tex_info_region.convert(
+                            old_u,
+                            (1.f-old_v), // inverted v coords
+                            &new_u, &new_v);
                         new_uvs[ index * tex_set.stride ] = new_u;
                         new_uvs[ index * tex_set.stride + 1 ] = 1.f - new_v; // inverted
                                                                              // v coords
@@ -39,6 +39,16 @@
 namespace Sirikata {
 namespace Mesh {
 
+/** Packs all the textures used by a mesh into a single atlas and rewrites
+ *  texture coordinates to match. The atlas is saved alongside the mesh, which
+ *  must be a local file.
+ *
+ *  Options: --threads=<threads to decode and resize textures with, 0 for automatic>
+ *           --incremental=<if true, keep the placements and pixels of unchanged
+ *                          textures from the last atlas generated for the mesh>
+ *           --cache-dir=<where to keep the layout and a copy of the atlas for
+ *                        incremental mode, defaults to next to the mesh>
+ */
 class TextureAtlasFilter : public Filter {
 public:
     static Filter* create(const String& args) { return new TextureAtlasFilter(args); }
@@ -49,6 +59,10 @@ public:
     virtual FilterDataPtr apply(FilterDataPtr input);
 private:
     MeshdataPtr apply(MeshdataPtr md);
+
+    uint32 mThreads;
+    bool mIncremental;
+    String mCacheDir;
 }; // class TextureAtlasFilter
 
 } // namespace Mesh
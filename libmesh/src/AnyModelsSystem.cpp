@@ -32,6 +32,8 @@
 
 #include <sirikata/mesh/AnyModelsSystem.hpp>
 #include <sirikata/mesh/ModelsSystemFactory.hpp>
+#include <sirikata/mesh/MeshdataBinary.hpp>
+#include <sirikata/mesh/ParsedMeshCache.hpp>
 
 namespace Sirikata {
 
@@ -71,11 +73,26 @@ bool AnyModelsSystem::canLoad(Transfer::DenseDataPtr data) {
 Mesh::VisualPtr AnyModelsSystem::load(const Transfer::RemoteFileMetadata& metadata, const Transfer::Fingerprint& fp,
     Transfer::DenseDataPtr data) {
     Mesh::VisualPtr result;
+
+    // Meshes that have been parsed before can be loaded from the binary copy
+    // in the disk cache instead of being parsed again.
+    bool use_cache = (fp != Transfer::Fingerprint::null() && Mesh::ParsedMeshCache::enabled() &&
+        !(data && Mesh::MeshdataBinary::isBinary(data->begin(), data->length())));
+    if (use_cache) {
+        result = Mesh::ParsedMeshCache::lookup(metadata, fp);
+        if (result) return result;
+    }
+
     for(SystemsMap::iterator it = mModelsSystems.begin(); it != mModelsSystems.end(); it++) {
         ModelsSystem* ms = it->second;
         if (ms->canLoad(data)) {
             result = ms->load(metadata, fp, data);
-            if (result) return result;
+            if (result) {
+                Mesh::MeshdataPtr mesh = std::tr1::dynamic_pointer_cast<Mesh::Meshdata>(result);
+                if (use_cache && mesh)
+                    Mesh::ParsedMeshCache::store(metadata, fp, *mesh);
+                return result;
+            }
         }
     }
     SILOG(AnyModelsSystem,error,"Couldn't find parser for " << metadata.getURI());
@@ -43,26 +43,61 @@ using namespace Sirikata::Transfer;
 namespace Sirikata {
 namespace Mesh {
 
+namespace {
+
+// Progressive textures are displayed at the first mipmap level with a
+// dimension at least this large.
+const uint32 FullMipmapDimension = 128;
+// In streaming mode, the first level with a dimension at least this large is
+// downloaded first so the asset can be displayed quickly.
+const uint32 InitialMipmapDimension = 32;
+
+// Find the first (smallest) mipmap level with a dimension of at least min_dim,
+// or the largest level if none is that big. mipmaps must not be empty.
+ProgressiveMipmaps::const_iterator SelectMipmapLevel(const ProgressiveMipmaps& mipmaps, uint32 min_dim) {
+    ProgressiveMipmaps::const_iterator it = mipmaps.begin(), last = mipmaps.begin();
+    for( ; it != mipmaps.end(); last = it++) {
+        if (it->second.width >= min_dim || it->second.height >= min_dim)
+            return it;
+    }
+    return last;
+}
+
+Transfer::Chunk MipmapChunk(const ProgressiveMipmapArchive& tex, const ProgressiveMipmapLevel& level) {
+    return Transfer::Chunk(tex.archiveHash, Transfer::Range(level.offset, level.length, Transfer::LENGTH));
+}
+
+} // namespace
+
   std::tr1::shared_ptr<AssetDownloadTask> AssetDownloadTask::construct(const Transfer::URI& uri, Transfer::TransferPoolPtr tpool, ParserService* const parser, double priority, FinishedCallback cb){
-      std::tr1::shared_ptr<AssetDownloadTask> retval(SelfWeakPtr<AssetDownloadTask>::internalConstruct(new AssetDownloadTask(uri,tpool,parser,priority,false,cb)));
+      std::tr1::shared_ptr<AssetDownloadTask> retval(SelfWeakPtr<AssetDownloadTask>::internalConstruct(new AssetDownloadTask(uri,tpool,parser,priority,false,cb,RefinedCallback())));
     retval->downloadAssetFile();
     return retval;
 }
 
 std::tr1::shared_ptr<AssetDownloadTask> AssetDownloadTask::construct(const Transfer::URI& uri, Transfer::TransferPoolPtr tpool, ParserService* const parser, double priority, bool isAgg, FinishedCallback cb){
-    std::tr1::shared_ptr<AssetDownloadTask> retval(SelfWeakPtr<AssetDownloadTask>::internalConstruct(new AssetDownloadTask(uri,tpool,parser,priority,isAgg,cb)));
+    std::tr1::shared_ptr<AssetDownloadTask> retval(SelfWeakPtr<AssetDownloadTask>::internalConstruct(new AssetDownloadTask(uri,tpool,parser,priority,isAgg,cb,RefinedCallback())));
     retval->downloadAssetFile();
     return retval;
 }
 
-AssetDownloadTask::AssetDownloadTask(const Transfer::URI& uri, Transfer::TransferPoolPtr tpool, ParserService* const parser, double priority, bool isAgg, FinishedCallback cb)
+std::tr1::shared_ptr<AssetDownloadTask> AssetDownloadTask::constructStreaming(const Transfer::URI& uri, Transfer::TransferPoolPtr tpool, ParserService* const parser, double priority, bool isAgg, FinishedCallback cb, RefinedCallback refined_cb){
+    std::tr1::shared_ptr<AssetDownloadTask> retval(SelfWeakPtr<AssetDownloadTask>::internalConstruct(new AssetDownloadTask(uri,tpool,parser,priority,isAgg,cb,refined_cb)));
+    retval->downloadAssetFile();
+    return retval;
+}
+
+AssetDownloadTask::AssetDownloadTask(const Transfer::URI& uri, Transfer::TransferPoolPtr tpool, ParserService* const parser, double priority, bool isAgg, FinishedCallback cb, RefinedCallback refined_cb)
  : mTransferPool(tpool),
    mMeshParser(parser),
    mAssetURI(uri),
    mPriority(priority),
    mCB(cb),
+   mRefinedCB(refined_cb),
    mAsset(),
-   mIsAggregate(isAgg)
+   mIsAggregate(isAgg),
+   mStreaming(refined_cb ? true : false),
+   mInitialFinished(false)
 {
 }
 
@@ -99,10 +134,16 @@ void AssetDownloadTask::cancel() {
     cancelNoLock();
 }
 
+bool AssetDownloadTask::refining() {
+    boost::mutex::scoped_lock lok(mDependentDownloadMutex);
+    return mInitialFinished && !mActiveDownloads.empty();
+}
+
 void AssetDownloadTask::cancelNoLock() {
     for(ActiveDownloadMap::iterator it = mActiveDownloads.begin(); it != mActiveDownloads.end(); it++)
         it->second->cancel();
     mActiveDownloads.clear();
+    mPendingRefinements.clear();
     if (mParseMeshHandle) {
         mParseMeshHandle->cancel();
         mParseMeshHandle.reset();
@@ -259,20 +300,25 @@ void AssetDownloadTask::handleAssetParsed(Mesh::VisualPtr vis) {
                 findProgTex = md->progressiveData->mipmaps.find("./atlas.jpg");
             }
 
-            if (md->progressiveData && findProgTex != md->progressiveData->mipmaps.end()) {
-                const ProgressiveMipmaps& progMipmaps = findProgTex->second.mipmaps;
-                uint32 mipmapLevel = 0;
-                for ( ; mipmapLevel < progMipmaps.size(); mipmapLevel++) {
-                    if (progMipmaps.find(mipmapLevel)->second.width >= 128 || progMipmaps.find(mipmapLevel)->second.height >= 128) {
-                        break;
+            if (md->progressiveData && findProgTex != md->progressiveData->mipmaps.end() && !findProgTex->second.mipmaps.empty()) {
+                const ProgressiveMipmapArchive& progTex = findProgTex->second;
+                ProgressiveMipmaps::const_iterator fullLevel = SelectMipmapLevel(progTex.mipmaps, FullMipmapDimension);
+                if (mStreaming) {
+                    // Start with a small level so the asset is usable quickly
+                    // and queue the full level to replace it afterwards.
+                    ProgressiveMipmaps::const_iterator initialLevel = SelectMipmapLevel(progTex.mipmaps, InitialMipmapDimension);
+                    addDependentDownload(texURI, MipmapChunk(progTex, initialLevel->second));
+                    if (initialLevel != fullLevel) {
+                        boost::mutex::scoped_lock lok(mDependentDownloadMutex);
+                        Refinement refinement;
+                        refinement.uri = texURI;
+                        refinement.chunk = MipmapChunk(progTex, fullLevel->second);
+                        mPendingRefinements.push_back(refinement);
                     }
                 }
-                if (mipmapLevel >= progMipmaps.size() ) mipmapLevel = progMipmaps.size() - 1;
-
-                uint32 offset = progMipmaps.find(mipmapLevel)->second.offset;
-                uint32 length = progMipmaps.find(mipmapLevel)->second.length;
-                Transfer::Fingerprint hash = findProgTex->second.archiveHash;
-                addDependentDownload(texURI, Transfer::Chunk(hash, Transfer::Range(offset, length, Transfer::LENGTH)));
+                else {
+                    addDependentDownload(texURI, MipmapChunk(progTex, fullLevel->second));
+                }
             } else {
                 addDependentDownload(texURI);
             }
@@ -339,6 +385,39 @@ void AssetDownloadTask::startDependentDownloads() {
         it->second->start();
 }
 
+void AssetDownloadTask::startRefinementsNoLock() {
+    // Several dependencies can be refined by the same chunk, e.g. textures
+    // packed into one atlas, so download each chunk once and deliver it for
+    // all of them.
+    typedef std::map<String, URIListPtr> ChunkURIMap;
+    ChunkURIMap chunk_uris;
+    std::vector<ResourceDownloadTaskPtr> started;
+    for(std::vector<Refinement>::const_iterator it = mPendingRefinements.begin(); it != mPendingRefinements.end(); it++) {
+        URIListPtr uris(new URIList());
+        ResourceDownloadTaskPtr dl = ResourceDownloadTask::construct(
+            it->chunk, mTransferPool,
+            mPriority,
+            std::tr1::bind(&AssetDownloadTask::weakTextureRefined, getWeakPtr(), uris, _1, _2, _3)
+        );
+        ChunkURIMap::iterator existing = chunk_uris.find(dl->getIdentifier());
+        if (existing != chunk_uris.end()) {
+            if (std::find(existing->second->begin(), existing->second->end(), it->uri) == existing->second->end())
+                existing->second->push_back(it->uri);
+            continue;
+        }
+        uris->push_back(it->uri);
+        chunk_uris[dl->getIdentifier()] = uris;
+        mActiveDownloads[dl->getIdentifier()] = dl;
+        started.push_back(dl);
+    }
+    mPendingRefinements.clear();
+
+    // Callbacks come from other threads and take the lock, so it's safe to
+    // start these while holding it.
+    for(std::vector<ResourceDownloadTaskPtr>::iterator it = started.begin(); it != started.end(); it++)
+        (*it)->start();
+}
+
 void AssetDownloadTask::weakTextureDownloaded(const std::tr1::weak_ptr<AssetDownloadTask>& thus, Transfer::URI uri, ResourceDownloadTaskPtr taskptr,
         Transfer::TransferRequestPtr request, Transfer::DenseDataPtr response) {
     std::tr1::shared_ptr<AssetDownloadTask>locked(thus.lock());
@@ -349,7 +428,7 @@ void AssetDownloadTask::weakTextureDownloaded(const std::tr1::weak_ptr<AssetDown
 
 void AssetDownloadTask::textureDownloaded(Transfer::URI uri, ResourceDownloadTaskPtr taskptr, Transfer::TransferRequestPtr request, Transfer::DenseDataPtr response) {
     // This could be triggered by any CDN thread, protect access
-    // (mActiveDownloads, mDependencies)
+    // (mActiveDownloads, and mDependencies until the initial set is done)
     boost::mutex::scoped_lock lok(mDependentDownloadMutex);
 
     if (!taskptr) {
@@ -379,8 +458,49 @@ void AssetDownloadTask::textureDownloaded(Transfer::URI uri, ResourceDownloadTas
     mDependencies[uri].request = request;
     mDependencies[uri].response = response;
 
-    if (mActiveDownloads.size() == 0)
-        mCB();
+    if (mActiveDownloads.size() == 0) {
+        if (mStreaming) {
+            mInitialFinished = true;
+            mCB();
+            startRefinementsNoLock();
+        }
+        else {
+            mCB();
+        }
+    }
+}
+
+void AssetDownloadTask::weakTextureRefined(const std::tr1::weak_ptr<AssetDownloadTask>& thus, URIListPtr uris, ResourceDownloadTaskPtr taskptr,
+        Transfer::TransferRequestPtr request, Transfer::DenseDataPtr response) {
+    std::tr1::shared_ptr<AssetDownloadTask>locked(thus.lock());
+    if (locked) {
+        locked->textureRefined(uris, taskptr, request, response);
+    }
+}
+
+void AssetDownloadTask::textureRefined(URIListPtr uris, ResourceDownloadTaskPtr taskptr, Transfer::TransferRequestPtr request, Transfer::DenseDataPtr response) {
+    boost::mutex::scoped_lock lok(mDependentDownloadMutex);
+
+    // Cancelled, nobody is waiting for the refinement anymore
+    if (!taskptr || mActiveDownloads.find(taskptr->getIdentifier()) == mActiveDownloads.end())
+        return;
+    mActiveDownloads.erase(taskptr->getIdentifier());
+    mFinishedDownloads.push_back(taskptr->getIdentifier());
+
+    // Failing a refinement just leaves the lower resolution version in place,
+    // but we still report it so the owner knows once we're done refining.
+    // mDependencies is left alone since the owner may be iterating over it
+    // without our lock; the refined data only goes to the callback.
+    ResourceData data;
+    if (request && response) {
+        data.request = request;
+        data.response = response;
+    }
+    else {
+        SILOG(ogre, warn, "failed refinement callback " << taskptr->getIdentifier());
+    }
+    for(URIList::const_iterator it = uris->begin(); it != uris->end(); it++)
+        mRefinedCB(*it, data);
 }
 
 void AssetDownloadTask::failDownload() {
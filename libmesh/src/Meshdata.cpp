@@ -39,19 +39,22 @@ namespace Mesh {
 SIRIKATA_MESH_EXPORT NodeIndex NullNodeIndex = -1;
 
 Node::Node()
- : parent(NullNodeIndex),
+ : containsInstanceController(false),
+   parent(NullNodeIndex),
    transform(Matrix4x4f::identity())
 {
 }
 
 Node::Node(NodeIndex par, const Matrix4x4f& xform)
- : parent(par),
+ : containsInstanceController(false),
+   parent(par),
    transform(xform)
 {
 }
 
 Node::Node(const Matrix4x4f& xform)
- : parent(NullNodeIndex),
+ : containsInstanceController(false),
+   parent(NullNodeIndex),
    transform(xform)
 {
 }
@@ -217,7 +220,9 @@ bool MaterialEffectInfo::operator!=(const MaterialEffectInfo& rhs) const {
 String Meshdata::sType("Meshdata");
 
 Meshdata::Meshdata()
-:globalTransform(Matrix4x4f::identity())
+:id(0),
+ hasAnimations(false),
+ globalTransform(Matrix4x4f::identity())
 {
 }
 
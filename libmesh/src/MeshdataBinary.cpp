@@ -0,0 +1,645 @@
+// Copyright (c) 2015 Sirikata Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can
+// be found in the LICENSE file.
+
+#include <sirikata/mesh/MeshdataBinary.hpp>
+
+#include <sstream>
+#include <boost/static_assert.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#define MESHBIN_LOG(lvl, msg) SILOG(mesh-binary, lvl, msg)
+
+namespace Sirikata {
+namespace Mesh {
+namespace MeshdataBinary {
+
+const String FormatName("mesh-binary");
+const uint32 Version = 1;
+
+namespace {
+
+// Flat arrays are copied straight out of the file, so the layout of these
+// types is part of the format.
+BOOST_STATIC_ASSERT(sizeof(Vector3f) == 3*sizeof(float32));
+BOOST_STATIC_ASSERT(sizeof(Vector4f) == 4*sizeof(float32));
+BOOST_STATIC_ASSERT(sizeof(Matrix4x4f) == 16*sizeof(float32));
+
+const char Magic[8] = { 'S', 'I', 'R', 'I', 'M', 'E', 'S', 'H' };
+// Written in native byte order, so reading it back checks endianness
+const uint32 ByteOrderMark = 0x01020304;
+const uint32 Alignment = 8;
+
+/** File header. Followed by the string table, then the body, each starting
+ *  on an Alignment boundary.
+ *
+ *  The string table is a uint32 count, count+1 uint32 offsets into the
+ *  character data, then the character data. Strings in the body are uint32
+ *  indices into the table. Arrays in the body are a uint32 element count
+ *  followed by the elements, starting at the next Alignment boundary.
+ */
+struct Header {
+    char magic[8];
+    uint32 version;
+    uint32 byteOrder;
+    uint64 stringTableSize;
+    uint64 bodySize;
+};
+
+uint64 padding(uint64 size) {
+    return (Alignment - (size % Alignment)) % Alignment;
+}
+
+class Writer {
+public:
+    Writer() {}
+
+    template<typename T>
+    void pod(const T& val) {
+        mBody.append((const char*)&val, sizeof(T));
+    }
+    void u8(uint8 val) { pod(val); }
+    void u32(uint32 val) { pod(val); }
+    void u64(uint64 val) { pod(val); }
+    void i32(int32 val) { pod(val); }
+    void f32(float32 val) { pod(val); }
+    void f64(float64 val) { pod(val); }
+
+    void str(const String& val) {
+        StringIndex::iterator it = mStringIndex.find(val);
+        if (it == mStringIndex.end()) {
+            it = mStringIndex.insert(StringIndex::value_type(val, mStrings.size())).first;
+            mStrings.push_back(val);
+        }
+        u32(it->second);
+    }
+
+    void sha(const SHA256& val) {
+        mBody.append((const char*)val.rawData().data(), SHA256::static_size);
+    }
+
+    template<typename T>
+    void array(const std::vector<T>& vals) {
+        u32(vals.size());
+        align();
+        if (!vals.empty())
+            mBody.append((const char*)&vals[0], vals.size() * sizeof(T));
+    }
+
+    void write(std::ostream& out) {
+        align();
+
+        String table;
+        uint32 count = mStrings.size();
+        table.append((const char*)&count, sizeof(count));
+        uint32 offset = 0;
+        for(uint32 i = 0; i < count; i++) {
+            table.append((const char*)&offset, sizeof(offset));
+            offset += mStrings[i].size();
+        }
+        table.append((const char*)&offset, sizeof(offset));
+        for(uint32 i = 0; i < count; i++)
+            table.append(mStrings[i]);
+        table.append(padding(table.size()), '\0');
+
+        Header header;
+        memcpy(header.magic, Magic, sizeof(Magic));
+        header.version = Version;
+        header.byteOrder = ByteOrderMark;
+        header.stringTableSize = table.size();
+        header.bodySize = mBody.size();
+
+        out.write((const char*)&header, sizeof(header));
+        out.write(table.data(), table.size());
+        out.write(mBody.data(), mBody.size());
+    }
+
+private:
+    void align() {
+        mBody.append(padding(mBody.size()), '\0');
+    }
+
+    String mBody;
+    typedef std::tr1::unordered_map<String, uint32> StringIndex;
+    StringIndex mStringIndex;
+    std::vector<String> mStrings;
+};
+
+class Reader {
+public:
+    Reader()
+     : mBase(NULL), mPos(0), mSize(0),
+       mStringData(NULL), mStringOffsets(NULL), mStringCount(0), mStringDataSize(0),
+       mFailed(false)
+    {}
+
+    // Validates the header and string table and positions the reader at the
+    // start of the body.
+    bool init(const uint8* data, uint64 size) {
+        Header header;
+        if (data == NULL || size < sizeof(header)) return false;
+        memcpy(&header, data, sizeof(header));
+        if (memcmp(header.magic, Magic, sizeof(Magic)) != 0)
+            return false;
+        if (header.byteOrder != ByteOrderMark) {
+            MESHBIN_LOG(warn, "Ignoring binary mesh with different byte order");
+            return false;
+        }
+        if (header.version != Version) {
+            MESHBIN_LOG(warn, "Ignoring binary mesh with version " << header.version << ", expected " << Version);
+            return false;
+        }
+        if (header.stringTableSize > size - sizeof(header) ||
+            header.bodySize > size - sizeof(header) - header.stringTableSize)
+            return false;
+
+        // String table
+        const uint8* table = data + sizeof(header);
+        if (header.stringTableSize < sizeof(uint32)) return false;
+        memcpy(&mStringCount, table, sizeof(uint32));
+        uint64 offsets_size = ((uint64)mStringCount + 1) * sizeof(uint32);
+        if (offsets_size > header.stringTableSize - sizeof(uint32)) return false;
+        mStringOffsets = table + sizeof(uint32);
+        mStringData = mStringOffsets + offsets_size;
+        uint64 chars_size = header.stringTableSize - sizeof(uint32) - offsets_size;
+        mStringDataSize = chars_size;
+
+        mBase = table + header.stringTableSize;
+        mSize = header.bodySize;
+        mPos = 0;
+        return true;
+    }
+
+    bool failed() const { return mFailed; }
+
+    template<typename T>
+    T pod() {
+        T val = T();
+        if (!check(sizeof(T))) return val;
+        memcpy(&val, mBase + mPos, sizeof(T));
+        mPos += sizeof(T);
+        return val;
+    }
+    uint8 u8() { return pod<uint8>(); }
+    uint32 u32() { return pod<uint32>(); }
+    uint64 u64() { return pod<uint64>(); }
+    int32 i32() { return pod<int32>(); }
+    float32 f32() { return pod<float32>(); }
+    float64 f64() { return pod<float64>(); }
+
+    String str() {
+        uint32 idx = u32();
+        if (mFailed) return String();
+        if (idx >= mStringCount) {
+            mFailed = true;
+            return String();
+        }
+        uint32 offsets[2];
+        memcpy(offsets, mStringOffsets + idx * sizeof(uint32), sizeof(offsets));
+        if (offsets[1] < offsets[0] || offsets[1] > mStringDataSize) {
+            mFailed = true;
+            return String();
+        }
+        return String((const char*)mStringData + offsets[0], offsets[1] - offsets[0]);
+    }
+
+    SHA256 sha() {
+        if (!check(SHA256::static_size)) return SHA256::null();
+        SHA256 val = SHA256::convertFromBinary(mBase + mPos);
+        mPos += SHA256::static_size;
+        return val;
+    }
+
+    // Number of elements in the next container, checked against what's left
+    // so corrupt counts can't trigger huge allocations.
+    uint32 count(uint64 min_element_size) {
+        uint32 n = u32();
+        if (!mFailed && (uint64)n * min_element_size > mSize - mPos) {
+            mFailed = true;
+            return 0;
+        }
+        return n;
+    }
+
+    template<typename T>
+    void array(std::vector<T>* out) {
+        uint32 n = u32();
+        align();
+        uint64 bytes = (uint64)n * sizeof(T);
+        if (!check(bytes)) return;
+        out->resize(n);
+        if (n > 0)
+            memcpy(&(*out)[0], mBase + mPos, bytes);
+        mPos += bytes;
+    }
+
+private:
+    bool check(uint64 bytes) {
+        if (mFailed || bytes > mSize - mPos) {
+            mFailed = true;
+            return false;
+        }
+        return true;
+    }
+
+    void align() {
+        uint64 pad = padding(mPos);
+        if (check(pad)) mPos += pad;
+    }
+
+    const uint8* mBase;
+    uint64 mPos;
+    uint64 mSize;
+    const uint8* mStringData;
+    const uint8* mStringOffsets;
+    uint32 mStringCount;
+    uint64 mStringDataSize;
+    bool mFailed;
+};
+
+
+// Writers and readers for each part of Meshdata. These must be kept in sync,
+// and any change to them requires bumping Version.
+
+void writeSkinController(Writer& w, const SkinController& sc) {
+    w.array(sc.joints);
+    w.pod(sc.bindShapeMatrix);
+    w.array(sc.weightStartIndices);
+    w.array(sc.weights);
+    w.array(sc.jointIndices);
+    w.array(sc.inverseBindMatrices);
+}
+
+void readSkinController(Reader& r, SkinController* sc) {
+    r.array(&sc->joints);
+    sc->bindShapeMatrix = r.pod<Matrix4x4f>();
+    r.array(&sc->weightStartIndices);
+    r.array(&sc->weights);
+    r.array(&sc->jointIndices);
+    r.array(&sc->inverseBindMatrices);
+}
+
+void writeGeometry(Writer& w, const SubMeshGeometry& geo) {
+    w.str(geo.name);
+    w.array(geo.positions);
+    w.array(geo.normals);
+    w.array(geo.tangents);
+    w.array(geo.colors);
+
+    w.u32(geo.texUVs.size());
+    for(uint32 i = 0; i < geo.texUVs.size(); i++) {
+        w.u32(geo.texUVs[i].stride);
+        w.array(geo.texUVs[i].uvs);
+    }
+
+    w.u32(geo.primitives.size());
+    for(uint32 i = 0; i < geo.primitives.size(); i++) {
+        const SubMeshGeometry::Primitive& prim = geo.primitives[i];
+        w.u32(prim.primitiveType);
+        w.u64(prim.materialId);
+        w.array(prim.indices);
+    }
+
+    w.pod(geo.aabb.min());
+    w.pod(geo.aabb.max());
+    w.f64(geo.radius);
+
+    w.u32(geo.skinControllers.size());
+    for(uint32 i = 0; i < geo.skinControllers.size(); i++)
+        writeSkinController(w, geo.skinControllers[i]);
+}
+
+void readGeometry(Reader& r, SubMeshGeometry* geo) {
+    geo->name = r.str();
+    r.array(&geo->positions);
+    r.array(&geo->normals);
+    r.array(&geo->tangents);
+    r.array(&geo->colors);
+
+    geo->texUVs.resize(r.count(2*sizeof(uint32)));
+    for(uint32 i = 0; i < geo->texUVs.size(); i++) {
+        geo->texUVs[i].stride = r.u32();
+        r.array(&geo->texUVs[i].uvs);
+    }
+
+    geo->primitives.resize(r.count(2*sizeof(uint32) + sizeof(uint64)));
+    for(uint32 i = 0; i < geo->primitives.size(); i++) {
+        SubMeshGeometry::Primitive& prim = geo->primitives[i];
+        prim.primitiveType = (SubMeshGeometry::Primitive::PrimitiveType)r.u32();
+        prim.materialId = r.u64();
+        r.array(&prim.indices);
+    }
+
+    Vector3f aabb_min = r.pod<Vector3f>();
+    Vector3f aabb_max = r.pod<Vector3f>();
+    geo->aabb = BoundingBox3f3f(aabb_min, aabb_max);
+    geo->radius = r.f64();
+
+    geo->skinControllers.resize(r.count(5*sizeof(uint32) + sizeof(Matrix4x4f)));
+    for(uint32 i = 0; i < geo->skinControllers.size(); i++)
+        readSkinController(r, &geo->skinControllers[i]);
+}
+
+void writeLight(Writer& w, const LightInfo& light) {
+    w.i32(light.mWhichFields);
+    w.pod(light.mDiffuseColor);
+    w.pod(light.mSpecularColor);
+    w.f32(light.mPower);
+    w.pod(light.mAmbientColor);
+    w.pod(light.mShadowColor);
+    w.f64(light.mLightRange);
+    w.f32(light.mConstantFalloff);
+    w.f32(light.mLinearFalloff);
+    w.f32(light.mQuadraticFalloff);
+    w.f32(light.mConeInnerRadians);
+    w.f32(light.mConeOuterRadians);
+    w.f32(light.mConeFalloff);
+    w.u32(light.mType);
+    w.u8(light.mCastsShadow ? 1 : 0);
+}
+
+void readLight(Reader& r, LightInfo* light) {
+    light->mWhichFields = r.i32();
+    light->mDiffuseColor = r.pod<Color>();
+    light->mSpecularColor = r.pod<Color>();
+    light->mPower = r.f32();
+    light->mAmbientColor = r.pod<Color>();
+    light->mShadowColor = r.pod<Color>();
+    light->mLightRange = r.f64();
+    light->mConstantFalloff = r.f32();
+    light->mLinearFalloff = r.f32();
+    light->mQuadraticFalloff = r.f32();
+    light->mConeInnerRadians = r.f32();
+    light->mConeOuterRadians = r.f32();
+    light->mConeFalloff = r.f32();
+    light->mType = (LightInfo::LightTypes)r.u32();
+    light->mCastsShadow = (r.u8() != 0);
+}
+
+void writeMaterial(Writer& w, const MaterialEffectInfo& mat) {
+    w.u32(mat.textures.size());
+    for(uint32 i = 0; i < mat.textures.size(); i++) {
+        const MaterialEffectInfo::Texture& tex = mat.textures[i];
+        w.str(tex.uri);
+        w.pod(tex.color);
+        w.u64(tex.texCoord);
+        w.u32(tex.affecting);
+        w.u32(tex.samplerType);
+        w.u32(tex.minFilter);
+        w.u32(tex.magFilter);
+        w.u32(tex.wrapS);
+        w.u32(tex.wrapT);
+        w.u32(tex.wrapU);
+        w.u32(tex.maxMipLevel);
+        w.f32(tex.mipBias);
+    }
+    w.f32(mat.shininess);
+    w.f32(mat.reflectivity);
+}
+
+void readMaterial(Reader& r, MaterialEffectInfo* mat) {
+    mat->textures.resize(r.count(sizeof(Vector4f) + 11*sizeof(uint32)));
+    for(uint32 i = 0; i < mat->textures.size(); i++) {
+        MaterialEffectInfo::Texture& tex = mat->textures[i];
+        tex.uri = r.str();
+        tex.color = r.pod<Vector4f>();
+        tex.texCoord = r.u64();
+        tex.affecting = (MaterialEffectInfo::Texture::Affecting)r.u32();
+        tex.samplerType = (MaterialEffectInfo::Texture::SamplerType)r.u32();
+        tex.minFilter = (MaterialEffectInfo::Texture::SamplerFilter)r.u32();
+        tex.magFilter = (MaterialEffectInfo::Texture::SamplerFilter)r.u32();
+        tex.wrapS = (MaterialEffectInfo::Texture::WrapMode)r.u32();
+        tex.wrapT = (MaterialEffectInfo::Texture::WrapMode)r.u32();
+        tex.wrapU = (MaterialEffectInfo::Texture::WrapMode)r.u32();
+        tex.maxMipLevel = r.u32();
+        tex.mipBias = r.f32();
+    }
+    mat->shininess = r.f32();
+    mat->reflectivity = r.f32();
+}
+
+void writeNode(Writer& w, const Node& node) {
+    w.u8(node.containsInstanceController ? 1 : 0);
+    w.i32(node.parent);
+    w.pod(node.transform);
+    w.array(node.children);
+    w.array(node.instanceChildren);
+    w.u32(node.animations.size());
+    for(Node::AnimationMap::const_iterator it = node.animations.begin(); it != node.animations.end(); it++) {
+        w.str(it->first);
+        w.array(it->second.inputs);
+        w.array(it->second.outputs);
+    }
+}
+
+void readNode(Reader& r, Node* node) {
+    node->containsInstanceController = (r.u8() != 0);
+    node->parent = r.i32();
+    node->transform = r.pod<Matrix4x4f>();
+    r.array(&node->children);
+    r.array(&node->instanceChildren);
+    uint32 nanims = r.count(3*sizeof(uint32));
+    for(uint32 i = 0; i < nanims && !r.failed(); i++) {
+        TransformationKeyFrames& frames = node->animations[r.str()];
+        r.array(&frames.inputs);
+        r.array(&frames.outputs);
+    }
+}
+
+void writeProgressiveData(Writer& w, const ProgressiveDataPtr& prog) {
+    w.u8(prog ? 1 : 0);
+    if (!prog) return;
+
+    w.sha(prog->progressiveHash);
+    w.u32(prog->numProgressiveTriangles);
+    w.u32(prog->mipmaps.size());
+    for(ProgressiveMipmapMap::const_iterator it = prog->mipmaps.begin(); it != prog->mipmaps.end(); it++) {
+        const ProgressiveMipmapArchive& archive = it->second;
+        w.str(it->first);
+        w.str(archive.name);
+        w.sha(archive.archiveHash);
+        w.u32(archive.mipmaps.size());
+        for(ProgressiveMipmaps::const_iterator lvl_it = archive.mipmaps.begin(); lvl_it != archive.mipmaps.end(); lvl_it++) {
+            w.u32(lvl_it->first);
+            w.u32(lvl_it->second.offset);
+            w.u32(lvl_it->second.length);
+            w.u32(lvl_it->second.width);
+            w.u32(lvl_it->second.height);
+        }
+    }
+}
+
+void readProgressiveData(Reader& r, ProgressiveDataPtr* prog_out) {
+    if (r.u8() == 0) return;
+
+    ProgressiveDataPtr prog(new ProgressiveData());
+    prog->progressiveHash = r.sha();
+    prog->numProgressiveTriangles = r.u32();
+    uint32 narchives = r.count(3*sizeof(uint32) + SHA256::static_size);
+    for(uint32 i = 0; i < narchives && !r.failed(); i++) {
+        ProgressiveMipmapArchive& archive = prog->mipmaps[r.str()];
+        archive.name = r.str();
+        archive.archiveHash = r.sha();
+        uint32 nlevels = r.count(5*sizeof(uint32));
+        for(uint32 l = 0; l < nlevels && !r.failed(); l++) {
+            ProgressiveMipmapLevel& level = archive.mipmaps[r.u32()];
+            level.offset = r.u32();
+            level.length = r.u32();
+            level.width = r.u32();
+            level.height = r.u32();
+        }
+    }
+    *prog_out = prog;
+}
+
+} // namespace
+
+bool isBinary(const void* data, size_t size) {
+    return (data != NULL && size >= sizeof(Header) && memcmp(data, Magic, sizeof(Magic)) == 0);
+}
+
+void serialize(const Meshdata& md, std::ostream& out) {
+    Writer w;
+
+    w.str(md.uri);
+    w.sha(md.hash);
+
+    w.u32(md.geometry.size());
+    for(uint32 i = 0; i < md.geometry.size(); i++)
+        writeGeometry(w, md.geometry[i]);
+
+    w.u32(md.textures.size());
+    for(uint32 i = 0; i < md.textures.size(); i++)
+        w.str(md.textures[i]);
+
+    w.u32(md.lights.size());
+    for(uint32 i = 0; i < md.lights.size(); i++)
+        writeLight(w, md.lights[i]);
+
+    w.u32(md.materials.size());
+    for(uint32 i = 0; i < md.materials.size(); i++)
+        writeMaterial(w, md.materials[i]);
+
+    w.u64((uint64)md.id);
+    w.u8(md.hasAnimations ? 1 : 0);
+
+    w.u32(md.instances.size());
+    for(uint32 i = 0; i < md.instances.size(); i++) {
+        const GeometryInstance& inst = md.instances[i];
+        w.u32(inst.geometryIndex);
+        w.i32(inst.parentNode);
+        w.u32(inst.materialBindingMap.size());
+        for(GeometryInstance::MaterialBindingMap::const_iterator it = inst.materialBindingMap.begin(); it != inst.materialBindingMap.end(); it++) {
+            w.u64(it->first);
+            w.u64(it->second);
+        }
+    }
+
+    w.u32(md.lightInstances.size());
+    for(uint32 i = 0; i < md.lightInstances.size(); i++) {
+        w.i32(md.lightInstances[i].lightIndex);
+        w.i32(md.lightInstances[i].parentNode);
+    }
+
+    w.pod(md.globalTransform);
+
+    w.u32(md.nodes.size());
+    for(uint32 i = 0; i < md.nodes.size(); i++)
+        writeNode(w, md.nodes[i]);
+    w.array(md.rootNodes);
+    w.array(md.mInstanceControllerTransformList);
+    w.array(md.joints);
+
+    writeProgressiveData(w, md.progressiveData);
+
+    w.write(out);
+}
+
+String serialize(const Meshdata& md) {
+    std::ostringstream out(std::ios::out | std::ios::binary);
+    serialize(md, out);
+    return out.str();
+}
+
+MeshdataPtr deserialize(const void* data, size_t size) {
+    Reader r;
+    if (!r.init((const uint8*)data, size))
+        return MeshdataPtr();
+
+    MeshdataPtr md(new Meshdata());
+
+    md->uri = r.str();
+    md->hash = r.sha();
+
+    md->geometry.resize(r.count(8*sizeof(uint32)));
+    for(uint32 i = 0; i < md->geometry.size(); i++)
+        readGeometry(r, &md->geometry[i]);
+
+    md->textures.resize(r.count(sizeof(uint32)));
+    for(uint32 i = 0; i < md->textures.size(); i++)
+        md->textures[i] = r.str();
+
+    md->lights.resize(r.count(sizeof(int32)));
+    for(uint32 i = 0; i < md->lights.size(); i++)
+        readLight(r, &md->lights[i]);
+
+    md->materials.resize(r.count(3*sizeof(uint32)));
+    for(uint32 i = 0; i < md->materials.size(); i++)
+        readMaterial(r, &md->materials[i]);
+
+    md->id = (long)r.u64();
+    md->hasAnimations = (r.u8() != 0);
+
+    md->instances.resize(r.count(3*sizeof(uint32)));
+    for(uint32 i = 0; i < md->instances.size(); i++) {
+        GeometryInstance& inst = md->instances[i];
+        inst.geometryIndex = r.u32();
+        inst.parentNode = r.i32();
+        uint32 nbindings = r.count(2*sizeof(uint64));
+        for(uint32 b = 0; b < nbindings && !r.failed(); b++) {
+            uint64 mat_id = r.u64();
+            inst.materialBindingMap[mat_id] = r.u64();
+        }
+    }
+
+    md->lightInstances.resize(r.count(2*sizeof(int32)));
+    for(uint32 i = 0; i < md->lightInstances.size(); i++) {
+        md->lightInstances[i].lightIndex = r.i32();
+        md->lightInstances[i].parentNode = r.i32();
+    }
+
+    md->globalTransform = r.pod<Matrix4x4f>();
+
+    md->nodes.resize(r.count(sizeof(Matrix4x4f)));
+    for(uint32 i = 0; i < md->nodes.size(); i++)
+        readNode(r, &md->nodes[i]);
+    r.array(&md->rootNodes);
+    r.array(&md->mInstanceControllerTransformList);
+    r.array(&md->joints);
+
+    readProgressiveData(r, &md->progressiveData);
+
+    if (r.failed()) {
+        MESHBIN_LOG(warn, "Failed to decode truncated or corrupt binary mesh");
+        return MeshdataPtr();
+    }
+    return md;
+}
+
+MeshdataPtr loadFile(const String& filename) {
+    using namespace boost::interprocess;
+    try {
+        file_mapping mapping(filename.c_str(), read_only);
+        mapped_region region(mapping, read_only);
+        return deserialize(region.get_address(), region.get_size());
+    }
+    catch(interprocess_exception& e) {
+        MESHBIN_LOG(error, "Couldn't map binary mesh " << filename << ": " << e.what());
+    }
+    return MeshdataPtr();
+}
+
+} // namespace MeshdataBinary
+} // namespace Mesh
+} // namespace Sirikata
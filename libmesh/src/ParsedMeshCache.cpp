@@ -0,0 +1,102 @@
+// Copyright (c) 2015 Sirikata Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can
+// be found in the LICENSE file.
+
+#include <sirikata/mesh/ParsedMeshCache.hpp>
+#include <sirikata/mesh/MeshdataBinary.hpp>
+#include <sirikata/core/transfer/TransferHandlers.hpp>
+#include <sirikata/core/options/CommonOptions.hpp>
+#include <boost/thread.hpp>
+
+#define PMC_LOG(lvl, msg) SILOG(parsed-mesh-cache, lvl, msg)
+
+namespace Sirikata {
+namespace Mesh {
+
+namespace {
+
+// How long to wait for the disk cache before giving up and parsing the
+// original file instead. A hit is a single read on the derived cache's own
+// thread, so anything slower means the disk is busy and parsing is likely to
+// be just as fast.
+const int32 LookupTimeoutMilliseconds = 100;
+
+// Shared with the cache callback, which may run on the disk cache's thread and
+// can outlive lookup() if it times out.
+struct LookupState {
+    LookupState() : done(false) {}
+
+    boost::mutex mutex;
+    boost::condition_variable cond;
+    bool done;
+    Transfer::DenseDataPtr data;
+};
+typedef std::tr1::shared_ptr<LookupState> LookupStatePtr;
+
+void handleCacheData(LookupStatePtr state, const Transfer::SparseData* data) {
+    Transfer::DenseDataPtr flattened;
+    if (data != NULL)
+        flattened = data->flatten();
+
+    boost::unique_lock<boost::mutex> lock(state->mutex);
+    state->data = flattened;
+    state->done = true;
+    state->cond.notify_all();
+}
+
+} // namespace
+
+bool ParsedMeshCache::enabled() {
+    return GetOptionValue<bool>(OPT_DISK_CACHE_PARSED_MESHES);
+}
+
+Transfer::Fingerprint ParsedMeshCache::key(const Transfer::RemoteFileMetadata& metadata, const Transfer::Fingerprint& fp) {
+    std::stringstream key_str;
+    key_str << "parsed-mesh:" << MeshdataBinary::FormatName << ":" << MeshdataBinary::Version << ":" << fp.convertToHexString() << "\n";
+    const Transfer::FileHeaders& headers = metadata.getHeaders();
+    for(Transfer::FileHeaders::const_iterator it = headers.begin(); it != headers.end(); it++)
+        key_str << it->first << ": " << it->second << "\n";
+    return Transfer::Fingerprint::computeDigest(key_str.str());
+}
+
+MeshdataPtr ParsedMeshCache::lookup(const Transfer::RemoteFileMetadata& metadata, const Transfer::Fingerprint& fp) {
+    LookupStatePtr state(new LookupState());
+    Transfer::SharedChunkCache::getSingleton().getDerivedCache()->getData(
+        key(metadata, fp), Transfer::Range(true),
+        std::tr1::bind(&handleCacheData, state, std::tr1::placeholders::_1)
+    );
+
+    Transfer::DenseDataPtr data;
+    {
+        boost::unique_lock<boost::mutex> lock(state->mutex);
+        boost::system_time stop_at = boost::get_system_time() + boost::posix_time::milliseconds(LookupTimeoutMilliseconds);
+        while(!state->done) {
+            if (!state->cond.timed_wait(lock, stop_at)) break;
+        }
+        if (!state->done) {
+            PMC_LOG(detailed, "Timed out looking up parsed mesh for " << metadata.getURI());
+            return MeshdataPtr();
+        }
+        data = state->data;
+    }
+
+    if (!data || data->length() == 0) return MeshdataPtr();
+
+    MeshdataPtr mesh = MeshdataBinary::deserialize(data->begin(), data->length());
+    if (!mesh) {
+        PMC_LOG(warn, "Ignoring invalid parsed mesh cache entry for " << metadata.getURI());
+        return MeshdataPtr();
+    }
+    PMC_LOG(detailed, "Loaded parsed mesh for " << metadata.getURI() << " from cache");
+    mesh->uri = metadata.getURI().toString();
+    mesh->hash = fp;
+    return mesh;
+}
+
+void ParsedMeshCache::store(const Transfer::RemoteFileMetadata& metadata, const Transfer::Fingerprint& fp, const Meshdata& md) {
+    Transfer::DenseDataPtr data(new Transfer::DenseData(MeshdataBinary::serialize(md)));
+    Transfer::SharedChunkCache::getSingleton().getDerivedCache()->addToCache(key(metadata, fp), data);
+}
+
+} // namespace Mesh
+} // namespace Sirikata
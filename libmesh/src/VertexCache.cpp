@@ -0,0 +1,165 @@
+// Copyright (c) 2015 Sirikata Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can
+// be found in the LICENSE file.
+
+#include <sirikata/mesh/VertexCache.hpp>
+
+namespace Sirikata {
+namespace Mesh {
+
+float32 ComputeACMR(const std::vector<uint32>& indices, uint32 cache_size) {
+    uint32 ntris = indices.size() / 3;
+    if (ntris == 0) return 0.f;
+
+    uint32 max_index = 0;
+    for(uint32 i = 0; i < ntris*3; i++)
+        max_index = std::max(max_index, indices[i]);
+
+    // A vertex is in the FIFO if it was inserted within the last cache_size
+    // insertions. Timestamps start past cache_size so nothing starts out
+    // cached, the same as in Tipsify below.
+    std::vector<uint32> inserted(max_index+1, 0);
+    uint32 time = cache_size+1;
+    uint32 misses = 0;
+    for(uint32 i = 0; i < ntris*3; i++) {
+        uint32 v = indices[i];
+        if (time - inserted[v] > cache_size) {
+            inserted[v] = time++;
+            misses++;
+        }
+    }
+    return misses / (float32)ntris;
+}
+
+float32 ComputeACMR(const SubMeshGeometry& geometry, uint32 cache_size) {
+    std::vector<uint32> indices;
+    for(uint32 pi = 0; pi < geometry.primitives.size(); pi++) {
+        const SubMeshGeometry::Primitive& prim = geometry.primitives[pi];
+        if (prim.primitiveType != SubMeshGeometry::Primitive::TRIANGLES) continue;
+        // Each primitive is drawn separately, so the cache doesn't carry over
+        // between them. Approximate that by simulating them all together,
+        // which is close for anything with more than a handful of triangles.
+        indices.insert(indices.end(), prim.indices.begin(), prim.indices.begin() + (prim.indices.size() / 3) * 3);
+    }
+    return ComputeACMR(indices, cache_size);
+}
+
+namespace {
+
+// State for Tipsify. Names follow the paper.
+struct Tipsify {
+    Tipsify(const std::vector<uint32>& indices, uint32 vertex_count, uint32 cache_size)
+     : I(indices),
+       k(cache_size),
+       n(vertex_count),
+       adjacencyStart(vertex_count+1, 0),
+       L(vertex_count, 0),
+       C(vertex_count, 0),
+       emitted(indices.size() / 3, false),
+       s(cache_size+1),
+       cursor(0)
+    {
+        // Triangles adjacent to each vertex, packed by vertex
+        uint32 ntris = I.size() / 3;
+        for(uint32 i = 0; i < ntris*3; i++)
+            L[I[i]]++;
+        for(uint32 v = 0; v < n; v++)
+            adjacencyStart[v+1] = adjacencyStart[v] + L[v];
+        adjacency.resize(adjacencyStart[n]);
+        std::vector<uint32> fill(adjacencyStart.begin(), adjacencyStart.end()-1);
+        for(uint32 i = 0; i < ntris*3; i++)
+            adjacency[fill[I[i]]++] = i / 3;
+    }
+
+    void run(std::vector<uint32>* output) {
+        output->reserve(I.size());
+        std::vector<uint32> candidates;
+        int64 f = skipDeadEnd();
+        while(f >= 0) {
+            candidates.clear();
+            for(uint32 ai = adjacencyStart[f]; ai < adjacencyStart[f+1]; ai++) {
+                uint32 t = adjacency[ai];
+                if (emitted[t]) continue;
+                for(uint32 j = 0; j < 3; j++) {
+                    uint32 v = I[t*3+j];
+                    output->push_back(v);
+                    deadEnds.push_back(v);
+                    candidates.push_back(v);
+                    L[v]--;
+                    if (s - C[v] > k)
+                        C[v] = s++;
+                }
+                emitted[t] = true;
+            }
+            f = nextVertex(candidates);
+        }
+    }
+
+    // Pick the candidate that will still be in the cache after its remaining
+    // triangles are emitted and that entered the cache earliest.
+    int64 nextVertex(const std::vector<uint32>& candidates) {
+        int64 best = -1;
+        int64 best_priority = -1;
+        for(uint32 ci = 0; ci < candidates.size(); ci++) {
+            uint32 v = candidates[ci];
+            if (L[v] == 0) continue;
+            int64 priority = 0;
+            if (s - C[v] + 2*L[v] <= k)
+                priority = s - C[v];
+            if (priority > best_priority) {
+                best_priority = priority;
+                best = v;
+            }
+        }
+        if (best == -1)
+            best = skipDeadEnd();
+        return best;
+    }
+
+    int64 skipDeadEnd() {
+        while(!deadEnds.empty()) {
+            uint32 d = deadEnds.back();
+            deadEnds.pop_back();
+            if (L[d] > 0) return d;
+        }
+        while(cursor < n) {
+            if (L[cursor] > 0) return cursor;
+            cursor++;
+        }
+        return -1;
+    }
+
+    const std::vector<uint32>& I;
+    const uint32 k;
+    const uint32 n;
+    std::vector<uint32> adjacencyStart;
+    std::vector<uint32> adjacency;
+    // Live triangles per vertex
+    std::vector<uint32> L;
+    // Time each vertex entered the cache
+    std::vector<uint32> C;
+    std::vector<bool> emitted;
+    std::vector<uint32> deadEnds;
+    uint32 s;
+    uint32 cursor;
+};
+
+} // namespace
+
+bool OptimizeTriangleOrder(std::vector<uint32>* indices, uint32 vertex_count, uint32 cache_size) {
+    uint32 ntris = indices->size() / 3;
+    if (ntris == 0) return true;
+    for(uint32 i = 0; i < ntris*3; i++)
+        if ((*indices)[i] >= vertex_count) return false;
+
+    std::vector<uint32> output;
+    Tipsify tipsify(*indices, vertex_count, std::max(cache_size, (uint32)3));
+    tipsify.run(&output);
+    // Keep any trailing partial triangle, though it's meaningless
+    output.insert(output.end(), indices->begin() + ntris*3, indices->end());
+    indices->swap(output);
+    return true;
+}
+
+} // namespace Mesh
+} // namespace Sirikata
@@ -69,6 +69,12 @@ public:
    */
   void addArchiveData(unsigned int archiveName, const String &uri, const Transfer::SparseData &rbuffer);
 
+  /**
+   * Like addArchiveData, but replaces the data if the file already exists,
+   * e.g. when a higher resolution version of a texture arrives.
+   */
+  void replaceArchiveData(unsigned int archiveName, const String &uri, const Transfer::SparseData &rbuffer);
+
   /**
    * Adds a package to the CDNArchive that will stay open until all items are used
    * Must be called from main thread
@@ -322,6 +322,7 @@ bool OgreRenderer::initialize(const String& options, bool with_berkelium) {
     OptionValue*grabCursor;
     OptionValue* backColor;
     OptionValue *searchPaths;
+    OptionValue* plannerCameraThreshold;
     InitializeClassOptions("ogregraphics",this,
                            pluginFile=new OptionValue("pluginfile","",OptionValueType<String>(),"sets the file ogre should read options from."),
                            configFile=new OptionValue("configfile","ogre.cfg",OptionValueType<String>(),"sets the ogre config file for config options"),
@@ -343,6 +344,7 @@ bool OgreRenderer::initialize(const String& options, bool with_berkelium) {
                            mWindowDepth=new OptionValue("colordepth","8a",OgrePixelFormatParser(),"Pixel color depth"),
                            renderBufferAutoMipmap=new OptionValue("rendertargetautomipmap","false",OptionValueType<bool>(),"If the render target needs auto mipmaps generated"),
                            frameLoadDuration=new OptionValue("load-duration","1ms",OptionValueType<Duration>(),"Amount of time to spend loading resources per frame. Keep low to maintain good frame rates."),
+                           plannerCameraThreshold=new OptionValue("planner-camera-threshold","0",OptionValueType<float32>(),"Distance the camera must move before the download planner recomputes every object's priority. Below it, only objects that changed are updated."),
                            shadowTechnique=new OptionValue("shadows","none",ShadowType(),"Shadow Style=[none,texture_additive,texture_modulative,stencil_additive,stencil_modulaive]"),
                            shadowFarDistance=new OptionValue("shadowfar","1000",OptionValueType<float32>(),"The distance away a shadowcaster may hide the light"),
                            mParallaxSteps=new OptionValue("parallax-steps","1.0",OptionValueType<float>(),"Multiplies the per-material parallax steps by this constant (default 1.0)"),
@@ -536,7 +538,7 @@ bool OgreRenderer::initialize(const String& options, bool with_berkelium) {
 
     mResourceLoader = new ResourceLoader(mContext, frameLoadDuration->as<Duration>());
     PriorityDownloadPlannerMetricPtr metric(new SolidAngleDownloadPlannerMetric());
-    mDownloadPlanner = new PriorityDownloadPlanner(mContext, this, metric);
+    mDownloadPlanner = new PriorityDownloadPlanner(mContext, this, metric, plannerCameraThreshold->as<float32>());
 
     if (with_berkelium)
         new WebViewManager(0, mInputManager, getOgreResourcesDir(mSearchPaths));
@@ -11,6 +11,7 @@
 #include <sirikata/core/network/IOStrandImpl.hpp>
 
 #include <sirikata/core/transfer/MaxPriorityAggregation.hpp>
+#include <sirikata/core/util/PackedPriorities.hpp>
 
 #include <sirikata/ogre/OgreRenderer.hpp>
 #include <sirikata/ogre/OgreHeaders.hpp>
@@ -46,6 +47,15 @@ double DistanceDownloadPlannerMetric::calculatePriority(Graphics::Camera *camera
     return priority;
 }
 
+bool DistanceDownloadPlannerMetric::calculatePriorities(
+    const Vector3f& camera_pos,
+    const float32* x, const float32* y, const float32* z, const float32* radius,
+    uint32 count, float32* out)
+{
+    PackedPriorities::distance(camera_pos, x, y, z, count, out);
+    return true;
+}
+
 static bool withinBound(float radius, Vector3d objLoc, Vector3d cameraLoc)
 {
     if (cameraLoc.x < objLoc.x - radius || cameraLoc.x > objLoc.x + radius) return false;
@@ -70,6 +80,15 @@ double SolidAngleDownloadPlannerMetric::calculatePriority(Graphics::Camera *came
     return (double)priority;
 }
 
+bool SolidAngleDownloadPlannerMetric::calculatePriorities(
+    const Vector3f& camera_pos,
+    const float32* x, const float32* y, const float32* z, const float32* radius,
+    uint32 count, float32* out)
+{
+    PackedPriorities::solidAngle(camera_pos, x, y, z, radius, count, out);
+    return true;
+}
+
 
 
 
@@ -79,7 +98,8 @@ PriorityDownloadPlanner::Object::Object(Graphics::Entity *m, const Transfer::URI
   mesh(m),
   name(m->id()),
   loaded(false),
-  priority(0),
+  slot(0),
+  dirty(false),
   proxy(_proxy)
 {}
 
@@ -99,10 +119,15 @@ PriorityDownloadPlanner::Asset::~Asset() {
     Liveness::letDie();
 }
 
-PriorityDownloadPlanner::PriorityDownloadPlanner(Context* c, OgreRenderer* renderer, PriorityDownloadPlannerMetricPtr metric)
+PriorityDownloadPlanner::PriorityDownloadPlanner(Context* c, OgreRenderer* renderer, PriorityDownloadPlannerMetricPtr metric, float32 camera_threshold)
  : ResourceDownloadPlanner(c, renderer),
    mStopped(false),
-   mMetric(metric)
+   mMetric(metric),
+   mLoadedHeap(LoadedHeapCompare(&mPriorities)),
+   mWaitingHeap(WaitingHeapCompare(&mPriorities)),
+   mCameraThreshold(camera_threshold),
+   mLastCamera(NULL),
+   mNeedsFullUpdate(true)
 {
     assert(mMetric);
 
@@ -155,13 +180,89 @@ void PriorityDownloadPlanner::iAddObject(Object* r, Liveness::Token alive)
     }
 
     RMutex::scoped_lock lock(mDlPlannerMutex);
-    r->priority = mMetric->calculatePriority(camera, r->proxy);
+    allocateSlot(r);
+    computePriorities(r->slot, 1);
     mObjects[r->name] = r;
     mWaitingObjects[r->name] = r;
+    mWaitingHeap.push(r->slot);
     DLPLANNER_LOG(detailed, "Adding object " << r->name << " (" << r->file << "), " << mLoadedObjects.size() << " loaded, " << mWaitingObjects.size() << " waiting");
     checkShouldLoadNewObject(r);
 }
 
+void PriorityDownloadPlanner::allocateSlot(Object* r) {
+    if (!mFreeSlots.empty()) {
+        r->slot = mFreeSlots.back();
+        mFreeSlots.pop_back();
+    }
+    else {
+        r->slot = mSlotObjects.size();
+        mPosX.push_back(0); mPosY.push_back(0); mPosZ.push_back(0);
+        mRadius.push_back(0);
+        mPriorities.push_back(0);
+        mLocated.push_back(0);
+        mSlotObjects.push_back(NULL);
+    }
+    mSlotObjects[r->slot] = r;
+    r->dirty = false;
+    updatePackedLocation(r);
+}
+
+void PriorityDownloadPlanner::releaseSlot(Object* r) {
+    mLoadedHeap.remove(r->slot);
+    mWaitingHeap.remove(r->slot);
+    mSlotObjects[r->slot] = NULL;
+    mLocated[r->slot] = 0;
+    mPriorities[r->slot] = 0;
+    mFreeSlots.push_back(r->slot);
+    // Any entry left in mDirtySlots is skipped since the slot has no object
+}
+
+void PriorityDownloadPlanner::updatePackedLocation(Object* r) {
+    uint32 slot = r->slot;
+    if (!r->proxy) {
+        mLocated[slot] = 0;
+        return;
+    }
+    Vector3f pos = r->proxy->location().position();
+    mPosX[slot] = pos.x;
+    mPosY[slot] = pos.y;
+    mPosZ[slot] = pos.z;
+    mRadius[slot] = r->proxy->bounds().fullRadius();
+    mLocated[slot] = 1;
+}
+
+void PriorityDownloadPlanner::markDirty(Object* r) {
+    if (r->dirty) return;
+    r->dirty = true;
+    mDirtySlots.push_back(r->slot);
+}
+
+void PriorityDownloadPlanner::computePriorities(uint32 start, uint32 count) {
+    if (count == 0) return;
+
+    if (camera != NULL) {
+        Vector3f camera_pos(camera->getPosition());
+        bool computed = mMetric->calculatePriorities(
+            camera_pos,
+            &mPosX[start], &mPosY[start], &mPosZ[start], &mRadius[start],
+            count, &mPriorities[start]
+        );
+        if (computed) {
+            // Objects without a proxy have no location to compute a priority
+            // from, and released slots hold stale data
+            for(uint32 i = start; i < start + count; i++) {
+                if (!mLocated[i]) mPriorities[i] = 0;
+            }
+            return;
+        }
+    }
+
+    for(uint32 i = start; i < start + count; i++) {
+        Object* r = mSlotObjects[i];
+        mPriorities[i] = (r != NULL ? mMetric->calculatePriority(camera, r->proxy) : 0);
+    }
+}
+
 PriorityDownloadPlanner::Object* PriorityDownloadPlanner::findObject(const String& name)
 {
     RMutex::scoped_lock lock(mDlPlannerMutex);
@@ -183,7 +284,7 @@ void PriorityDownloadPlanner::commandGetData(
          omIter != mObjects.end(); ++omIter)
     {
         Command::Object individualObject = Command::Object();
-        individualObject["priority"] = omIter->second->priority;
+        individualObject["priority"] = priority(omIter->second);
         individualObject["name"] = omIter->second->name;
         individualObject["loaded"] = omIter->second->loaded;
         //append known object to map of results
@@ -199,7 +300,7 @@ void PriorityDownloadPlanner::commandGetData(
          omIter != mObjects.end(); ++omIter)
     {
         Command::Object individualObject = Command::Object();
-        individualObject["priority"] = omIter->second->priority;
+        individualObject["priority"] = priority(omIter->second);
         individualObject["name"] = omIter->second->name;
         individualObject["loaded"] = omIter->second->loaded;
         //append known object to map of results
@@ -384,6 +485,7 @@ void PriorityDownloadPlanner::iRemoveObject(
         // It should definitely be in waiting objects now
         ObjectMap::iterator waiting_it = mWaitingObjects.find(name);
         if (waiting_it != mWaitingObjects.end()) mWaitingObjects.erase(waiting_it);
+        releaseSlot(r);
 
         // Log and cleanup
         DLPLANNER_LOG(detailed, "Removing object " << r->name << " (" << r->file << "), " << mLoadedObjects.size() << " loaded, " << mWaitingObjects.size() << " waiting");
@@ -432,7 +534,10 @@ void PriorityDownloadPlanner::iUpdateObject(
         unrequestAssetForObject(r);
     }
     r->file = new_file;
-    r->priority = mMetric->calculatePriority(camera, p);
+    // Location updates can arrive many times per frame, so just record the
+    // change and recompute the priority once on the next poll.
+    updatePackedLocation(r);
+    markDirty(r);
     if (new_file != last_file && r->loaded) {
         requestAssetForObject(r);
     }
@@ -466,6 +571,8 @@ void PriorityDownloadPlanner::loadObject(Object* r) {
     RMutex::scoped_lock lock(mDlPlannerMutex);
     mWaitingObjects.erase(r->name);
     mLoadedObjects[r->name] = r;
+    mWaitingHeap.remove(r->slot);
+    mLoadedHeap.push(r->slot);
 
     // After operation to get updated stats
     DLPLANNER_LOG(detailed, "Loading object " << r->name << " (" << r->file << "), " << mLoadedObjects.size() << " loaded, " << mWaitingObjects.size() << " waiting");
@@ -478,6 +585,8 @@ void PriorityDownloadPlanner::unloadObject(Object* r) {
     RMutex::scoped_lock lock(mDlPlannerMutex);
     mLoadedObjects.erase(r->name);
     mWaitingObjects[r->name] = r;
+    mLoadedHeap.remove(r->slot);
+    mWaitingHeap.push(r->slot);
 
     // After operation to get updated stats
     DLPLANNER_LOG(detailed, "Unloading object " << r->name << " (" << r->file << "), " << mLoadedObjects.size() << " loaded, " << mWaitingObjects.size() << " waiting");
@@ -503,82 +612,74 @@ void PriorityDownloadPlanner::iPoll(Liveness::Token dpAlive)
     if (mContext->stopped()) return;
 
     RMutex::scoped_lock lock(mDlPlannerMutex);
-    // Update priorities, tracking the largest undisplayed priority and the
-    // smallest displayed priority to decide if we're going to have to swap.
-    float32 mMinLoadedPriority = 1000000, mMaxWaitingPriority = 0;
-    for (ObjectMap::iterator it = mObjects.begin(); it != mObjects.end(); it++) {
-        Object* r = it->second;
-        r->priority = mMetric->calculatePriority(camera, r->proxy);
 
-        if (r->loaded)
-            mMinLoadedPriority = std::min(mMinLoadedPriority, (float32)r->priority);
-        else
-            mMaxWaitingPriority = std::max(mMaxWaitingPriority, (float32)r->priority);
-    }
+    // Update priorities. If the camera has moved far enough, everything needs
+    // to be recomputed, which we do in one batch over the packed arrays and
+    // then reorder the heaps in one pass. Otherwise, only objects that changed
+    // since the last poll are updated.
+    Vector3d camera_pos = camera->getPosition();
+    if (mNeedsFullUpdate || camera != mLastCamera ||
+        (camera_pos - mLastCameraPos).length() > mCameraThreshold)
+    {
+        computePriorities(0, mSlotObjects.size());
+        mLoadedHeap.rebuild();
+        mWaitingHeap.rebuild();
 
-    // If the min and max computed above are on the wrong sides, then, we need
-    // to do more work to figure out which things to swap between loaded &
-    // waiting.
-    //
-    // Or, if we've just gone under budget (e.g. the max number
-    // allowed increased, objects left the scene, etc) then we also
-    // run this, which will safely add if we're under budget.
-    if (mMinLoadedPriority < mMaxWaitingPriority || budgetRequiresChange()) {
-        std::vector<Object*> loaded_resource_heap;
-        std::vector<Object*> waiting_resource_heap;
-
-        for (ObjectMap::iterator it = mObjects.begin(); it != mObjects.end(); it++) {
-            Object* r = it->second;
-            if (r->loaded)
-                loaded_resource_heap.push_back(r);
-            else
-                waiting_resource_heap.push_back(r);
+        for(std::vector<uint32>::iterator it = mDirtySlots.begin(); it != mDirtySlots.end(); it++) {
+            Object* r = mSlotObjects[*it];
+            if (r != NULL) r->dirty = false;
         }
-        std::make_heap(loaded_resource_heap.begin(), loaded_resource_heap.end(), Object::MinHeapComparator());
-        std::make_heap(waiting_resource_heap.begin(), waiting_resource_heap.end(), Object::MaxHeapComparator());
+        mDirtySlots.clear();
 
-        while(true) {
-            if ((int32)mLoadedObjects.size() < mMaxLoaded && !waiting_resource_heap.empty()) {
-                // If we're under budget, just add to top waiting items
-                Object* max_waiting = waiting_resource_heap.front();
-                std::pop_heap(waiting_resource_heap.begin(), waiting_resource_heap.end(), Object::MaxHeapComparator());
-                waiting_resource_heap.pop_back();
+        mNeedsFullUpdate = false;
+        mLastCamera = camera;
+        mLastCameraPos = camera_pos;
+    }
+    else {
+        for(std::vector<uint32>::iterator it = mDirtySlots.begin(); it != mDirtySlots.end(); it++) {
+            Object* r = mSlotObjects[*it];
+            if (r == NULL || !r->dirty) continue;
+            r->dirty = false;
+            computePriorities(r->slot, 1);
+            mLoadedHeap.update(r->slot);
+            mWaitingHeap.update(r->slot);
+        }
+        mDirtySlots.clear();
+    }
 
-                DLPLANNER_LOG(detailed, "Adding object " << max_waiting->name);
-                loadObject(max_waiting);
-            }
-            else if ((int32)mLoadedObjects.size() > mMaxLoaded && !loaded_resource_heap.empty()) {
-                // Otherwise, extract the min and check if we can continue
-                Object* min_loaded = loaded_resource_heap.front();
-                std::pop_heap(loaded_resource_heap.begin(), loaded_resource_heap.end(), Object::MinHeapComparator());
-                loaded_resource_heap.pop_back();
+    // Swap between loaded & waiting while the least important loaded object is
+    // less important than the most important waiting one. Also handles going
+    // over or under budget (e.g. the max number allowed changed, objects left
+    // the scene, etc).
+    while(true) {
+        if ((int32)mLoadedObjects.size() < mMaxLoaded && !mWaitingHeap.empty()) {
+            // If we're under budget, just add to top waiting items
+            Object* max_waiting = mSlotObjects[mWaitingHeap.top()];
+            DLPLANNER_LOG(detailed, "Adding object " << max_waiting->name);
+            loadObject(max_waiting);
+        }
+        else if ((int32)mLoadedObjects.size() > mMaxLoaded && !mLoadedHeap.empty()) {
+            Object* min_loaded = mSlotObjects[mLoadedHeap.top()];
+            DLPLANNER_LOG(detailed, "Removing object " << min_loaded->name);
+            unloadObject(min_loaded);
+        }
+        else if (!mWaitingHeap.empty() && !mLoadedHeap.empty()) {
+            // At budget, we're (potentially) exchanging
+            Object* max_waiting = mSlotObjects[mWaitingHeap.top()];
+            Object* min_loaded = mSlotObjects[mLoadedHeap.top()];
 
-                DLPLANNER_LOG(detailed, "Removing object " << min_loaded->name);
+            if (priority(min_loaded) < priority(max_waiting)) {
+                DLPLANNER_LOG(detailed, "Swapping object " << max_waiting->name << " for " << min_loaded->name);
                 unloadObject(min_loaded);
-            }
-            else if (!waiting_resource_heap.empty() && !loaded_resource_heap.empty()) {
-                // They're equal, we're (potentially) exchanging
-                Object* max_waiting = waiting_resource_heap.front();
-                std::pop_heap(waiting_resource_heap.begin(), waiting_resource_heap.end(), Object::MaxHeapComparator());
-                waiting_resource_heap.pop_back();
-
-                Object* min_loaded = loaded_resource_heap.front();
-                std::pop_heap(loaded_resource_heap.begin(), loaded_resource_heap.end(), Object::MinHeapComparator());
-                loaded_resource_heap.pop_back();
-
-                if (min_loaded->priority < max_waiting->priority) {
-                    DLPLANNER_LOG(detailed, "Swapping object " << max_waiting->name << " for " << min_loaded->name);
-                    unloadObject(min_loaded);
-                    loadObject(max_waiting);
-                }
-                else {
-                    break;
-                }
+                loadObject(max_waiting);
             }
             else {
                 break;
             }
         }
+        else {
+            break;
+        }
     }
 
 
@@ -625,6 +726,16 @@ void PriorityDownloadPlanner::iStop(Liveness::Token dpAlive)
     mObjects.clear();
     mLoadedObjects.clear();
     mWaitingObjects.clear();
+
+    mLoadedHeap.clear();
+    mWaitingHeap.clear();
+    mPosX.clear(); mPosY.clear(); mPosZ.clear();
+    mRadius.clear();
+    mPriorities.clear();
+    mLocated.clear();
+    mSlotObjects.clear();
+    mFreeSlots.clear();
+    mDirtySlots.clear();
 }
 
 void PriorityDownloadPlanner::requestAssetForObject(Object* forObject) {
@@ -683,9 +794,11 @@ void PriorityDownloadPlanner::downloadAsset(Asset* asset, Object* forObject) {
     DLPLANNER_LOG(detailed, "Starting download of " << asset->uri);
 
     bool is_aggregate = (forObject->proxy ? forObject->proxy->isAggregate() : false);
+    // Stream the asset so it can be displayed as soon as low resolution
+    // textures are available, then swap in the full resolution versions.
     asset->downloadTask =
-        Mesh::AssetDownloadTask::construct(
-            asset->uri, getScene()->transferPool(), getScene(), forObject->priority,
+        Mesh::AssetDownloadTask::constructStreaming(
+            asset->uri, getScene()->transferPool(), getScene(), priority(forObject),
             is_aggregate,
             // We need some indirection because this callback is invoked
             // with a lock on in AssetDownload task and triggers
@@ -693,6 +806,9 @@ void PriorityDownloadPlanner::downloadAsset(Asset* asset, Object* forObject) {
             // be better, posting to a strand works ok
             mScene->renderStrand()->wrap(
                 std::tr1::bind(&PriorityDownloadPlanner::loadAsset, this, asset->uri,asset->internalId)
+            ),
+            mScene->renderStrand()->wrap(
+                std::tr1::bind(&PriorityDownloadPlanner::handleTextureRefined, this, asset->uri, asset->internalId, _1, _2)
             )
         );
 }
@@ -804,11 +920,45 @@ void PriorityDownloadPlanner::finishLoadAsset(Asset* asset, bool success) {
 
         asset->usingObjects.insert(resource_id);
     }
+    // Hold onto the task if it's still downloading higher resolution data
+    if (success && asset->downloadTask && asset->downloadTask->refining())
+        asset->refineTask = asset->downloadTask;
     asset->downloadTask.reset();
     asset->waitingObjects.clear();
     checkRemoveAsset(asset,asset->livenessToken());
 }
 
+void PriorityDownloadPlanner::handleTextureRefined(Transfer::URI asset_uri, uint64 assetId, Transfer::URI tex_uri, Mesh::AssetDownloadTask::ResourceData tex_data) {
+    RMutex::scoped_lock lock(mDlPlannerMutex);
+
+    AssetMap::iterator asset_it = mAssets.find(asset_uri);
+    if (asset_it == mAssets.end()) return;
+    Asset* asset = asset_it->second;
+    // See loadAsset for why we check the id
+    if (asset->internalId != assetId) return;
+
+    // Release the task once it's delivered everything, including failed
+    // refinements
+    if (asset->refineTask && !asset->refineTask->refining())
+        asset->refineTask.reset();
+
+    // Failed, keep the low resolution version
+    if (!tex_data.response) return;
+
+    // If the low resolution version was never loaded as a texture (e.g. it's
+    // displayed in a WebView instead) there's nothing to replace.
+    TextureBindingsMap::const_iterator binding = asset->textureFingerprints->find(tex_uri.toString());
+    if (!mActiveCDNArchive || binding == asset->textureFingerprints->end()) return;
+    const String& id = binding->second;
+    if (std::find(asset->loadedResources.begin(), asset->loadedResources.end(), id) == asset->loadedResources.end()) return;
+
+    DLPLANNER_LOG(detailed, "Refining texture " << tex_uri << " for asset " << asset_uri);
+    // Keep the same name so the materials referring to it pick up the new
+    // data when it's reloaded.
+    CDNArchiveFactory::getSingleton().replaceArchiveData(mCDNArchive, id, SparseData(tex_data.response));
+    getScene()->getResourceLoader()->reloadTexture(id);
+}
+
 void PriorityDownloadPlanner::loadMeshdata(Asset* asset, const Mesh::MeshdataPtr& mdptr, bool usingDefault) {
     RMutex::scoped_lock lock(mDlPlannerMutex);
 
@@ -1021,19 +1171,25 @@ void PriorityDownloadPlanner::handleLoadedResource(Asset* asset,Liveness::Token
 void PriorityDownloadPlanner::updateAssetPriority(Asset* asset) {
     RMutex::scoped_lock lock(mDlPlannerMutex);
     // We only care about updating priorities when we're still downloading
-    // the asset.
-    if (!asset->downloadTask) return;
+    // the asset, either initially or to refine it for the objects using it.
+    Mesh::AssetDownloadTaskPtr task = asset->downloadTask;
+    const ObjectSet* objects = &asset->waitingObjects;
+    if (!task) {
+        task = asset->refineTask;
+        objects = &asset->usingObjects;
+    }
+    if (!task) return;
 
     std::vector<Priority> priorities;
-    for(ObjectSet::iterator obj_it = asset->waitingObjects.begin(); obj_it != asset->waitingObjects.end(); obj_it++) {
+    for(ObjectSet::const_iterator obj_it = objects->begin(); obj_it != objects->end(); obj_it++) {
         String objid = *obj_it;
         assert(mObjects.find(objid) != mObjects.end());
         Object* obj = mObjects[objid];
 
-        priorities.push_back(obj->priority);
+        priorities.push_back(priority(obj));
     }
     if (!priorities.empty())
-        asset->downloadTask->updatePriority( mAggregationAlgorithm->aggregate(priorities) );
+        task->updatePriority( mAggregationAlgorithm->aggregate(priorities) );
 }
 
 void PriorityDownloadPlanner::unrequestAssetForObject(Object* forObject) {
@@ -1085,6 +1241,8 @@ void PriorityDownloadPlanner::checkRemoveAsset(Asset* asset,Liveness::Token asse
         // We need to be careful if a download is in progress.
         if (asset->downloadTask)
             asset->downloadTask->cancel();
+        if (asset->refineTask)
+            asset->refineTask->cancel();
 
 
         DLPLANNER_LOG(detailed, "Destroying unused asset " << asset->uri);
@@ -12,6 +12,7 @@
 #include <sirikata/mesh/Billboard.hpp>
 #include <sirikata/core/util/Liveness.hpp>
 #include <sirikata/core/command/Commander.hpp>
+#include <sirikata/core/util/IndexedHeap.hpp>
 
 namespace Sirikata {
 namespace Graphics {
@@ -23,6 +24,17 @@ class PriorityDownloadPlannerMetric {
 public:
     virtual ~PriorityDownloadPlannerMetric() {}
     virtual double calculatePriority(Graphics::Camera *camera, ProxyObjectPtr proxy) = 0;
+    /** Calculate priorities for count objects at once, given their positions
+     *  and bounding radii as packed arrays. Returns false if the metric can't
+     *  do this, in which case calculatePriority is used for each object.
+     */
+    virtual bool calculatePriorities(
+        const Vector3f& camera_pos,
+        const float32* x, const float32* y, const float32* z, const float32* radius,
+        uint32 count, float32* out)
+    {
+        return false;
+    }
     virtual String name() const = 0;
 };
 typedef std::tr1::shared_ptr<PriorityDownloadPlannerMetric> PriorityDownloadPlannerMetricPtr;
@@ -31,6 +43,10 @@ class DistanceDownloadPlannerMetric : public PriorityDownloadPlannerMetric {
 public:
     virtual ~DistanceDownloadPlannerMetric() {}
     virtual double calculatePriority(Graphics::Camera *camera, ProxyObjectPtr proxy);
+    virtual bool calculatePriorities(
+        const Vector3f& camera_pos,
+        const float32* x, const float32* y, const float32* z, const float32* radius,
+        uint32 count, float32* out);
     virtual String name() const { return "distance"; }
 };
 
@@ -38,6 +54,10 @@ class SolidAngleDownloadPlannerMetric : public PriorityDownloadPlannerMetric {
 public:
     virtual ~SolidAngleDownloadPlannerMetric() {}
     virtual double calculatePriority(Graphics::Camera *camera, ProxyObjectPtr proxy);
+    virtual bool calculatePriorities(
+        const Vector3f& camera_pos,
+        const float32* x, const float32* y, const float32* z, const float32* radius,
+        uint32 count, float32* out);
     virtual String name() const { return "solid_angle"; }
 };
 
@@ -45,12 +65,18 @@ public:
 /** Implementation of ResourceDownloadPlanner that orders loading by a priority
  *  metric computed on each object. The priority metric is pluggable and a
  *  maximum number of objects can also be enforced.
+ *
+ *  Object positions, radii and priorities are kept in packed arrays indexed by
+ *  a per-object slot so metrics can evaluate them in bulk, and the loaded and
+ *  waiting sets are kept in heaps between polls. Priorities for every object
+ *  are only recomputed when the camera moves more than camera_threshold;
+ *  otherwise only objects which were updated since the last poll are.
  */
 class PriorityDownloadPlanner : public ResourceDownloadPlanner,
                                 public virtual Liveness
 {
 public:
-    PriorityDownloadPlanner(Context* c, OgreRenderer* renderer, PriorityDownloadPlannerMetricPtr metric);
+    PriorityDownloadPlanner(Context* c, OgreRenderer* renderer, PriorityDownloadPlannerMetricPtr metric, float32 camera_threshold = 0.f);
     ~PriorityDownloadPlanner();
 
     virtual void addNewObject(Graphics::Entity *ent, const Transfer::URI& mesh);
@@ -68,6 +94,7 @@ public:
     }
     void setPrioritizationMetric(PriorityDownloadPlannerMetricPtr metric) {
         mMetric = metric;
+        mNeedsFullUpdate = true;
     }
 
     virtual Stats stats();
@@ -85,6 +112,16 @@ protected:
 
     double calculatePriority(ProxyObjectPtr proxy);
 
+    // Slot management for the packed per-object arrays
+    void allocateSlot(Object* r);
+    void releaseSlot(Object* r);
+    // Copy the object's current location and bounds into its slot
+    void updatePackedLocation(Object* r);
+    void markDirty(Object* r);
+    // Recompute priorities for count slots starting at start
+    void computePriorities(uint32 start, uint32 count);
+    float32 priority(const Object* r) const { return mPriorities[r->slot]; }
+
     void commandGetData(
         const Command::Command& cmd, Command::Commander* cmdr, Command::CommandID cmdid);
     void commandGetStats(
@@ -111,7 +148,10 @@ protected:
         Graphics::Entity *mesh;
         String name;
         bool loaded;
-        float32 priority;
+        // Index into the packed arrays
+        uint32 slot;
+        // Needs its priority recomputed on the next poll
+        bool dirty;
         ProxyObjectPtr proxy;
 
         class Hasher {
@@ -120,18 +160,6 @@ protected:
                 return std::tr1::hash<String>()(r.name);
             }
         };
-
-        struct MaxHeapComparator {
-            bool operator()(Object* lhs, Object* rhs) {
-                return lhs->priority < rhs->priority;
-            }
-        };
-        struct MinHeapComparator {
-            bool operator()(Object* lhs, Object* rhs) {
-                return lhs->priority > rhs->priority;
-            }
-        };
-
     };
 
     typedef std::tr1::unordered_set<String> ObjectSet;
@@ -144,8 +172,41 @@ protected:
     ObjectMap mWaitingObjects;
 
 
-    // Heap storage for Objects. Choice between min/max heap is at call time.
-    typedef std::vector<Object*> ObjectHeap;
+    // Packed per-slot data. Released slots have a NULL object and are reused.
+    typedef std::vector<float32> FloatArray;
+    FloatArray mPosX, mPosY, mPosZ, mRadius;
+    FloatArray mPriorities;
+    // Whether the slot has a location to compute a priority from
+    std::vector<uint8> mLocated;
+    std::vector<Object*> mSlotObjects;
+    std::vector<uint32> mFreeSlots;
+    std::vector<uint32> mDirtySlots;
+
+    // Heaps of slots, keyed by priority. Loaded objects are in a min-heap so
+    // the least important can be evicted, waiting objects in a max-heap so the
+    // most important can be loaded.
+    struct LoadedHeapCompare {
+        LoadedHeapCompare(const FloatArray* p) : priorities(p) {}
+        bool operator()(uint32 lhs, uint32 rhs) const {
+            return (*priorities)[lhs] > (*priorities)[rhs];
+        }
+        const FloatArray* priorities;
+    };
+    struct WaitingHeapCompare {
+        WaitingHeapCompare(const FloatArray* p) : priorities(p) {}
+        bool operator()(uint32 lhs, uint32 rhs) const {
+            return (*priorities)[lhs] < (*priorities)[rhs];
+        }
+        const FloatArray* priorities;
+    };
+    IndexedHeap<LoadedHeapCompare> mLoadedHeap;
+    IndexedHeap<WaitingHeapCompare> mWaitingHeap;
+
+    // Camera state as of the last time all priorities were recomputed
+    float32 mCameraThreshold;
+    Graphics::Camera* mLastCamera;
+    Vector3d mLastCameraPos;
+    bool mNeedsFullUpdate;
 
 
     typedef std::vector<WebView*> WebMaterialList;
@@ -158,6 +219,9 @@ protected:
     {
         Transfer::URI uri;
         Mesh::AssetDownloadTaskPtr downloadTask;
+        // Once loaded, the download task is kept here while it's still
+        // fetching higher resolution textures.
+        Mesh::AssetDownloadTaskPtr refineTask;
         // Objects that want this asset to be loaded and are waiting for it
         ObjectSet waitingObjects;
         // Objects that are using this asset
@@ -218,6 +282,8 @@ protected:
     void downloadAsset(Asset* asset, Object* forObject);
     void loadAsset(Transfer::URI asset_uri,uint64 assetId);
     void finishLoadAsset(Asset* asset, bool success);
+    // Swap in a higher resolution version of one of an asset's textures
+    void handleTextureRefined(Transfer::URI asset_uri, uint64 assetId, Transfer::URI tex_uri, Mesh::AssetDownloadTask::ResourceData tex_data);
 
     void loadMeshdata(Asset* asset, const Mesh::MeshdataPtr& mdptr, bool usingDefault);
     void loadBillboard(Asset* asset, const Mesh::BillboardPtr& bbptr, bool usingDefault);
@@ -169,6 +169,20 @@ void ResourceLoader::loadTextureWork(const String& name, LoadedCallback cb) {
     if (cb) cb();
 }
 
+void ResourceLoader::reloadTexture(const String& name) {
+    // Nothing to do if nobody is using it anymore. Otherwise, this is queued
+    // behind any pending load so it's ordered properly.
+    if (mRefCounts.find(name) == mRefCounts.end()) return;
+    mTasks.push( std::tr1::bind(&ResourceLoader::reloadTextureWork, this, name) );
+}
+
+void ResourceLoader::reloadTextureWork(const String& name) {
+    Ogre::TextureManager& tm = Ogre::TextureManager::getSingleton();
+    Ogre::ResourcePtr tex = tm.getByName(name);
+    if (!tex.isNull() && tex->isLoaded())
+        tex->reload();
+}
+
 void ResourceLoader::unloadResource(const String& name) {
     decRefCount(name);
 }
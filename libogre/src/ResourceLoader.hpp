@@ -52,6 +52,9 @@ public:
     void loadMesh(const String& name, Mesh::MeshdataPtr mesh, const String& skeletonName, TextureBindingsMapPtr textureFingerprints, LoadedCallback cb);
 
     void loadTexture(const String& name, LoadedCallback cb);
+    // Reload a texture whose underlying data has changed, if it's still
+    // loaded.
+    void reloadTexture(const String& name);
 
     void unloadResource(const String& name);
 
@@ -75,6 +78,8 @@ private:
 
     void loadTextureWork(const String& name, LoadedCallback cb);
 
+    void reloadTextureWork(const String& name);
+
     void unloadResourceWork(const String& name, ResourceType type);
 
     // Refcounting utilities:
@@ -102,6 +102,13 @@ void CDNArchiveFactory::addArchiveData(unsigned int archiveName, const String &u
   addArchiveDataNoLock(archiveName, uri,rbuffer);
 }
 
+void CDNArchiveFactory::replaceArchiveData(unsigned int archiveName, const String &uri, const SparseData &rbuffer)
+{
+  boost::mutex::scoped_lock lok(CDNArchiveMutex);
+  CDNArchiveFiles.erase(uri);
+  addArchiveDataNoLock(archiveName, uri,rbuffer);
+}
+
 void CDNArchiveFactory::clearArchive(unsigned int which)
 {
   boost::mutex::scoped_lock lok(CDNArchiveMutex);
@@ -140,6 +140,12 @@ protected:
     AtomicValue<int> mNumOutstandingConnections;
     bool mDestroyWhenConnected;
 
+    // Location update requests that don't change velocity and stay within
+    // this distance of what the space server will extrapolate from the last
+    // request we sent are suppressed. Only used when location updates are
+    // coalesced by the SessionManager; 0 disables it.
+    const float32 mLocDeadReckoning;
+
 public:
     typedef ODPSST::Endpoint EndPointType;
     typedef ODPSST::BaseDatagramLayerPtr BaseDatagramLayerPtr;
@@ -374,6 +380,12 @@ public:
     // Helper for constructing and sending location update
     void updateLocUpdateRequest(const SpaceID& space, const ObjectReference& oref, const TimedMotionVector3f* const loc, const TimedMotionQuaternion* const orient, const BoundingSphere3f* const bounds, const String* const mesh, const String* const phy, const String* query_data);
     void sendLocUpdateRequest(const SpaceID& space, const ObjectReference& oref);
+    // Fill in a Loc.Container with the presence's outstanding update fields
+    // and clear them. Must be called with presenceDataMutex held. Returns
+    // false if there's nothing to send.
+    bool buildLocUpdateRequest(PerPresenceData& pd, std::string* payload);
+    // SessionManager::LocationUpdateBuilder for coalesced location updates
+    static bool buildQueuedLocUpdateRequest(const HostedObjectWPtr& weakSelf, const SpaceObjectReference& sporef, std::string* payload);
 
 }; // class HostedObject
 
@@ -274,6 +274,17 @@ public:
     typedef ODPSST::StreamPtr SSTStreamPtr;
     SSTStreamPtr getSpaceStream(const SpaceID& space, const ObjectReference& internalID);
 
+    /** Returns true if location update requests for objects in the space
+     *  should be queued with queueLocationUpdate() instead of being sent
+     *  individually.
+     */
+    bool coalescingLocationUpdates(const SpaceID& space);
+    /** Queue a location update request to be built and sent with other
+     *  requests to the same space server. See
+     *  SessionManager::queueLocationUpdate.
+     */
+    void queueLocationUpdate(const SpaceID& space, const ObjectReference& oref, const SessionManager::LocationUpdateBuilder& builder);
+
     // Service Interface
     virtual void start();
     virtual void stop();
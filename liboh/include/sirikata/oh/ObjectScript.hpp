@@ -60,6 +60,14 @@ class SIRIKATA_OH_EXPORT ObjectScript : public Service {
 
     virtual void  notifyProximateGone(std::tr1::shared_ptr<ProxyObject> p, const SpaceObjectReference&){}
     virtual void  notifyProximate(std::tr1::shared_ptr<ProxyObject> p, const SpaceObjectReference&){ }
+    /** Notify the script of many proximate objects at once, e.g. all the
+     *  additions from a single proximity update. By default this just calls
+     *  notifyProximate for each of them.
+     */
+    virtual void  notifyProximateBatch(const std::vector< std::tr1::shared_ptr<ProxyObject> >& proxies, const SpaceObjectReference& querier) {
+        for(std::vector< std::tr1::shared_ptr<ProxyObject> >::const_iterator it = proxies.begin(); it != proxies.end(); it++)
+            notifyProximate(*it, querier);
+    }
 
     /*
       Returns true if decoded payload as a scripting communication message,
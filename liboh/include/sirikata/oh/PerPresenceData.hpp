@@ -44,6 +44,9 @@ public:
     // resolve differences for each component independently.
     SequencedPresencePropertiesPtr requestLoc;
     Network::IOTimerPtr rerequestTimer;
+    // The last location actually sent in a request, which the space server
+    // extrapolates from. Used for dead reckoning when coalescing requests.
+    TimedMotionVector3f sentLoc;
 
     // This tracks the latest epoch we've seen *reported* from the space server,
     // i.e. what requests the server has handled.
@@ -113,6 +113,10 @@ class SIRIKATA_OH_EXPORT SessionManager
     // Notifies the ObjectHost of object connection that was closed, including a
     // reason.
     typedef std::tr1::function<void(const SpaceObjectReference&, Disconnect::Code)> ObjectDisconnectedCallback;
+    // Builds an object's pending location update request, a serialized
+    // Sirikata.Protocol.Loc.Container, when the coalesced updates are
+    // flushed. Returns false if there turned out to be nothing to send.
+    typedef std::tr1::function<bool(std::string*)> LocationUpdateBuilder;
 
     // SST stream related typedefs
     typedef ODPSST::StreamPtr SSTStreamPtr;
@@ -164,9 +168,23 @@ class SIRIKATA_OH_EXPORT SessionManager
     // (no callback from SpaceNodeConnection yet) so we can build OHDP::SST
     // streams as part of the connection process.
     bool send(const SpaceObjectReference& sporef_objid, const ObjectMessagePort src_port, const UUID& dest, const ObjectMessagePort dest_port, const std::string& payload, ServerID dest_server = NullServerID);
+    // As above, but the payload is only referenced, never copied into an
+    // intermediate message, and only needs to stay valid until this returns.
+    bool send(const SpaceObjectReference& sporef_objid, const ObjectMessagePort src_port, const UUID& dest, const ObjectMessagePort dest_port, MemoryReference payload, ServerID dest_server = NullServerID);
 
     SSTStreamPtr getSpaceStream(const ObjectReference& objectID);
 
+    /** Returns true if location update requests should be queued with
+     *  queueLocationUpdate() rather than sent individually.
+     */
+    bool coalescingLocationUpdates() const { return mLocationUpdateTick != Duration::zero(); }
+    /** Mark the object as having a pending location update request. Once per
+     *  tick, builders for all dirty objects are invoked and their requests
+     *  are sent as one message per space server. Queueing an object that is
+     *  already dirty just replaces its builder.
+     */
+    void queueLocationUpdate(const SpaceObjectReference& sporef, const LocationUpdateBuilder& builder);
+
     // Service Implementation
     virtual void start();
     virtual void stop();
@@ -202,6 +220,8 @@ private:
 
     // Handles session messages received from the server -- connection replies, migration requests, etc.
     void handleSessionMessage(Sirikata::Protocol::Object::ObjectMessage* msg, ServerID from_server);
+    // Handles a batch of session messages from the server, dispatching each to handleSessionMessage
+    void handleBulkSessionMessage(Sirikata::Protocol::Object::ObjectMessage* msg, ServerID from_server);
     // Handlers for specific parts of session messages
     void handleSessionMessageConnectResponseSuccess(ServerID from_server, const SpaceObjectReference& sporef_obj, Sirikata::Protocol::Session::Container& session_msg);
     void handleSessionMessageConnectResponseRedirect(ServerID from_server, const SpaceObjectReference& sporef_obj, Sirikata::Protocol::Session::Container& session_msg);
@@ -229,6 +249,17 @@ private:
     // the connection success response back).
     void sendDisconnectMessage(const SpaceObjectReference& sporef, ServerID connected_to, uint64 session_seqno);
 
+    // Send a session message from the object to the space server, batching it
+    // with other objects' session messages to the same server if bulk sessions
+    // are enabled. The message is retried until it is sent.
+    void sendSessionMessage(const SpaceObjectReference& sporef, ServerID dest_server, const std::string& payload);
+    // Send pending batched session messages for one or all servers
+    void flushBulkSessionMessages(ServerID dest_server);
+    void flushAllBulkSessionMessages();
+
+    // Build requests for all dirty objects and send them to their servers
+    void flushLocationUpdates();
+
     // Utility method which keeps trying to resend a message
     void sendRetryingMessage(const SpaceObjectReference& sporef_src, const ObjectMessagePort src_port, const UUID& dest, const ObjectMessagePort dest_port, const std::string& payload, ServerID dest_server, Network::IOStrand* strand, const Duration& rate);
 
@@ -458,6 +489,27 @@ private:
 
     bool mShuttingDown;
 
+    // Bulk sessions: session messages for objects connecting to the same
+    // server are collected as (object, serialized Session.Container) pairs and
+    // flushed as a single message after the current burst of connections.
+    bool mBulkSessions;
+    typedef std::vector< std::pair<UUID, std::string> > BulkSessionEntryList;
+    typedef std::tr1::unordered_map<ServerID, BulkSessionEntryList> PendingBulkSessionMap;
+    PendingBulkSessionMap mPendingBulkSessions;
+    bool mBulkSessionFlushScheduled;
+
+    // Coalesced location updates: objects with pending location update
+    // requests are collected and flushed every mLocationUpdateTick, building
+    // one bulk message per server. Requests that have been built but couldn't
+    // be sent yet are held per server and retried on the next tick.
+    const Duration mLocationUpdateTick;
+    Poller* mLocationUpdatePoller;
+    typedef std::tr1::unordered_map<SpaceObjectReference, LocationUpdateBuilder, SpaceObjectReference::Hasher> DirtyLocationMap;
+    DirtyLocationMap mDirtyLocations;
+    typedef std::vector< std::pair<UUID, std::string> > LocationEntryList;
+    typedef std::tr1::unordered_map<ServerID, LocationEntryList> PendingLocationMap;
+    PendingLocationMap mPendingLocations;
+
     void spaceConnectCallback(int err, SSTStreamPtr s, SpaceObjectReference obj, ConnectionEvent after);
     std::map<ObjectReference, SSTStreamPtr> mObjectToSpaceStreams;
 
@@ -66,8 +66,9 @@ struct SIRIKATA_OH_EXPORT SpaceNodeConnection : public Liveness {
     SpaceNodeConnection(ObjectHostContext* ctx, Network::IOStrand* ioStrand, TimeProfiler::Stage* handle_read_stage, OptionSet *streamOptions, const SpaceID& spaceid, ServerID sid, OHDP::Service* ohdp_service, ConnectionEventCallback ccb, ReceiveCallback rcb);
     ~SpaceNodeConnection();
 
-    // Push a packet to be sent out
-    bool push(const ObjectMessage& msg);
+    // Push a packet to be sent out. msg holds everything but the payload,
+    // which is only referenced until this returns.
+    bool push(const ObjectMessage& msg, MemoryReference payload);
 
     // Pull a packet from the receive queue
     ObjectMessage* pull();
@@ -97,6 +98,10 @@ struct SIRIKATA_OH_EXPORT SpaceNodeConnection : public Liveness {
     Network::Stream* socket;
     Network::Address mAddr;
 
+    // Send out everything in mSendBatch
+    void handleFlushSendBatch(Liveness::Token alive);
+    void flushSendBatch();
+
     // Callback for connection event
     void handleConnectionEvent(const Network::Stream::ConnectionStatus status, const std::string&reason);
 
@@ -113,6 +118,16 @@ struct SIRIKATA_OH_EXPORT SpaceNodeConnection : public Liveness {
     ConnectionCallbackList mConnectCallbacks;
     bool mConnecting;
 
+    // Reused for serializing outgoing message headers
+    std::string mSendHeader;
+    // If batching, messages pushed during a burst of events are collected here
+    // and sent as a single chunk
+    bool mBatchSends;
+    std::string mSendBatch;
+    // Unique IDs of the messages in mSendBatch, for tracing when it's sent
+    std::vector<uint64> mSendBatchIDs;
+    bool mSendBatchFlushScheduled;
+
     // IO Strand
     QueueRouterElement<ObjectMessage> receive_queue;
 
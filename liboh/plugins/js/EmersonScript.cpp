@@ -558,21 +558,77 @@ void  EmersonScript::iNotifyProximate(
         return;
     }
 
+    iNotifyProximateHelper(proximateObject, querier);
+}
+
+
+void  EmersonScript::notifyProximateBatch(const std::vector<ProxyObjectPtr>& proximateObjects, const SpaceObjectReference& querier)
+{
+    if (JSObjectScript::mCtx->stopped())
+    {
+        JSLOG(warn, "Ignoring proximity addition callback after shutdown request.");
+        return;
+    }
+
+    if (proximateObjects.empty())
+        return;
+
+    // A single event for the whole batch, so a burst of additions doesn't
+    // flood the object strand
+    JSObjectScript::mCtx->objStrand->post(
+        std::tr1::bind(&EmersonScript::iNotifyProximateBatch,this,
+            ProxyObjectListPtr(new std::vector<ProxyObjectPtr>(proximateObjects)),
+            querier,Liveness::livenessToken()),
+        "EmersonScript::iNotifyProximateBatch"
+    );
+}
+
+
+void  EmersonScript::iNotifyProximateBatch(
+    ProxyObjectListPtr proximateObjects, const SpaceObjectReference& querier,
+    Liveness::Token alive)
+{
+    if (!alive) return;
+    Liveness::Lock locked(alive);
+    if (!locked) return;
+
+
+    EMERSCRIPT_SERIAL_CHECK();
+    while(!JSObjectScript::mCtx->initialized())
+    {}
+
+    v8::Locker locker (mCtx->mIsolate);
+    v8::Isolate::Scope iscope(JSObjectScript::mCtx->mIsolate);
+
+    for (std::vector<ProxyObjectPtr>::iterator proxIter = proximateObjects->begin();
+         proxIter != proximateObjects->end(); ++proxIter)
+    {
+        if (!iNotifyProximateHelper(*proxIter, querier))
+            return;
+    }
+}
+
+
+bool EmersonScript::iNotifyProximateHelper(
+    ProxyObjectPtr proximateObject, const SpaceObjectReference& querier)
+{
     std::map<uint32, JSContextStruct*>::iterator contIter;
     for (contIter  =  mContStructMap.begin(); contIter != mContStructMap.end();
          ++contIter)
     {
+        if (JSObjectScript::mCtx->stopped())
+        {
+            JSLOG(warn, "Ignoring remaining addition callbacks after shutdown request.");
+            return false;
+        }
+
         //must create a separate visible per sandbox so that garbage collection
         //destruction in one sandbox does not interfere with another sandbox.
         JSVisibleStruct* jsvis =
             jsVisMan.createVisStruct(this, proximateObject->getObjectReference());
         contIter->second->proximateEvent(querier, jsvis,false);
-        if (JSObjectScript::mCtx->stopped())
-        {
-            JSLOG(warn, "Ignoring remaining addition callbacks after shutdown request.");
-            return;
-        }
     }
+    return true;
 }
 
 
@@ -96,6 +96,7 @@ public:
 
     virtual void  notifyProximateGone(ProxyObjectPtr proximateObject, const SpaceObjectReference& querier);
     virtual void  notifyProximate(ProxyObjectPtr proximateObject, const SpaceObjectReference& querier);
+    virtual void  notifyProximateBatch(const std::vector<ProxyObjectPtr>& proximateObjects, const SpaceObjectReference& querier);
 
 
     /*
@@ -448,9 +449,19 @@ private:
     void iResetProximateHelper(
         JSVisibleStruct* proxVis, const SpaceObjectReference& proxTo);
 
+    // Delivers a single proximity addition to every sandbox. Returns false if
+    // the script was stopped partway through. Must be called with the v8
+    // isolate locked and entered.
+    bool iNotifyProximateHelper(
+        ProxyObjectPtr proximateObject, const SpaceObjectReference& querier);
+
     void  iNotifyProximate(
         ProxyObjectPtr proximateObject, const SpaceObjectReference& querier,
         Liveness::Token alive);
+    typedef std::tr1::shared_ptr< std::vector<ProxyObjectPtr> > ProxyObjectListPtr;
+    void  iNotifyProximateBatch(
+        ProxyObjectListPtr proximateObjects, const SpaceObjectReference& querier,
+        Liveness::Token alive);
 
     void iOnConnected(SessionEventProviderPtr from,
         const SpaceObjectReference& name, HostedObject::PresenceToken token,
@@ -13,6 +13,10 @@
 
 #include <json_spirit/json_spirit.h>
 
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/locks.hpp>
+#include <boost/thread/condition_variable.hpp>
+
 #define QPLOG(level,msg) SILOG(manual-query-processor,level,msg)
 
 namespace Sirikata {
@@ -58,6 +62,30 @@ bool parseQueryRequest(const String& query, SolidAngle* qangle_out, uint32* max_
     return true;
 }
 
+// Don't bother splitting query event generation into batches smaller than
+// this, the overhead of dispatching to workers would dominate.
+const std::size_t MinQueriesPerBatch = 32;
+
+// Tracks completion of a set of tasks dispatched to workers.
+struct TaskBarrier {
+    TaskBarrier(std::size_t count)
+     : remaining(count)
+    {}
+
+    boost::mutex mutex;
+    boost::condition_variable done;
+    std::size_t remaining;
+};
+
+void runBarrierTask(const std::tr1::function<void()>& task, TaskBarrier* barrier) {
+    task();
+
+    boost::unique_lock<boost::mutex> lck(barrier->mutex);
+    barrier->remaining--;
+    if (barrier->remaining == 0)
+        barrier->done.notify_all();
+}
+
 }
 
 ObjectQueryHandler::ObjectQueryHandler(ObjectHostContext* ctx, ManualObjectQueryProcessor* parent, const OHDP::SpaceNodeID& space, Network::IOStrandPtr prox_strand)
@@ -65,14 +93,31 @@ ObjectQueryHandler::ObjectQueryHandler(ObjectHostContext* ctx, ManualObjectQuery
    mObjectQueries(),
    mObjectDistance(false),
    mObjectHandlerPoller(mProxStrand.get(), std::tr1::bind(&ObjectQueryHandler::tickQueryHandler, this), "ObjectQueryHandler Poller", Duration::milliseconds((int64)100)),
+   mNumThreads(1),
+   mWorkers(NULL),
+   mParallelTick(false),
    mObjectResults( std::tr1::bind(&ObjectQueryHandler::handleDeliverEvents, this) )
 {
     String object_handler_type = GetOptionValue<String>(OPT_MANUAL_QUERY_HANDLER_TYPE);
     if (object_handler_type == "dist" || object_handler_type == "rtreedist") mObjectDistance = true;
+
+    mNumThreads = std::max(GetOptionValue<uint32>(OPT_MANUAL_QUERY_THREADS), (uint32)1);
+    if (mNumThreads > 1) {
+        // The workers live as long as we do so a tick that is in progress
+        // while we're stopped can always complete.
+        mWorkers = new Network::IOServicePool("ObjectQueryHandler Workers", mNumThreads - 1);
+        mWorkers->startWork();
+        mWorkers->run();
+    }
 }
 
 ObjectQueryHandler::~ObjectQueryHandler() {
     Liveness::letDie();
+    if (mWorkers != NULL) {
+        mWorkers->join();
+        delete mWorkers;
+        mWorkers = NULL;
+    }
     for(ReplicatedIndexQueryHandlerMap::iterator it = mObjectQueryHandlers.begin(); it != mObjectQueryHandlers.end(); it++)
         delete it->second.handler;
     mObjectQueryHandlers.clear();
@@ -208,6 +253,19 @@ void ObjectQueryHandler::handleNotifySubscribersLocUpdate(Liveness::Token alive,
     Liveness::Lock lck(alive);
     if (!lck) return;
 
+    notifySubscribersLocUpdate(loccache, oref);
+}
+
+void ObjectQueryHandler::handleNotifySubscribersLocUpdates(Liveness::Token alive, ReplicatedLocationServiceCache* loccache, ObjectReferenceListPtr orefs) {
+    if (!alive) return;
+    Liveness::Lock lck(alive);
+    if (!lck) return;
+
+    for(ObjectReferenceList::const_iterator it = orefs->begin(); it != orefs->end(); it++)
+        notifySubscribersLocUpdate(loccache, *it);
+}
+
+void ObjectQueryHandler::notifySubscribersLocUpdate(ReplicatedLocationServiceCache* loccache, const ObjectReference& oref) {
     SubscribersMap::iterator it = mSubscribers.find(oref);
     if (it == mSubscribers.end()) return;
     SubscriberSetPtr subscribers = it->second;
@@ -238,9 +296,22 @@ void ObjectQueryHandler::handleNotifySubscribersLocUpdate(Liveness::Token alive,
 
 
 void ObjectQueryHandler::queryHasEvents(Query* query) {
+    if (mParallelTick) {
+        // We're being called from one of the workers ticking replicated
+        // indices. Each index is owned by one worker, so we can safely record
+        // the query with its index and generate events once all indices have
+        // been ticked. The maps are only read while ticking.
+        InvertedObjectQueryMap::const_iterator query_it = mInvertedObjectQueries.find(query);
+        assert(query_it != mInvertedObjectQueries.end());
+        ReplicatedIndexQueryHandlerMap::iterator index_it = mObjectQueryHandlers.find(query_it->second.second);
+        assert(index_it != mObjectQueryHandlers.end());
+        index_it->second.pendingQueries.push_back(query);
+        return;
+    }
+
     InstanceMethodNotReentrant nr(mQueryHasEventsNotRentrant);
 
-    generateObjectQueryEvents(query);
+    generateObjectQueryEvents(query, NULL);
 }
 
 // AggregateListener Interface
@@ -262,9 +333,16 @@ void ObjectQueryHandler::aggregateQueryDataUpdated(ProxAggregator* handler, cons
 
 void ObjectQueryHandler::aggregateDestroyed(ProxAggregator* handler, const ObjectReference& objid) {
     // Allow canceling of unobserved timeouts for this node
-    assert(mInverseObjectQueryHandlers.find(handler) != mInverseObjectQueryHandlers.end());
-    ProxIndexID indexid = mInverseObjectQueryHandlers[handler];
-    mParent->replicatedNodeRemoved(mSpaceNodeID, indexid, objid);
+    InverseReplicatedIndexQueryHandlerMap::const_iterator inv_it = mInverseObjectQueryHandlers.find(handler);
+    assert(inv_it != mInverseObjectQueryHandlers.end());
+    ProxIndexID indexid = inv_it->second;
+
+    // The parent isn't thread safe, so during parallel ticks this is held
+    // until the tick completes
+    runOrDefer(
+        mParallelTick ? &(mObjectQueryHandlers.find(indexid)->second.deferredAggregateEvents) : NULL,
+        std::tr1::bind(&ManualObjectQueryProcessor::replicatedNodeRemoved, mParent, mSpaceNodeID, indexid, objid)
+    );
 }
 
 void ObjectQueryHandler::aggregateObserved(ProxAggregator* handler, const ObjectReference& objid, uint32 nobservers, uint32 nchildren) {
@@ -277,13 +355,15 @@ void ObjectQueryHandler::aggregateObserved(ProxAggregator* handler, const Object
     // Note that we don't have to post anything here currently because we should
     // be in the same strand as the parent
 
-    assert(mInverseObjectQueryHandlers.find(handler) != mInverseObjectQueryHandlers.end());
-    ProxIndexID indexid = mInverseObjectQueryHandlers[handler];
+    InverseReplicatedIndexQueryHandlerMap::const_iterator inv_it = mInverseObjectQueryHandlers.find(handler);
+    assert(inv_it != mInverseObjectQueryHandlers.end());
+    ProxIndexID indexid = inv_it->second;
+    DeferredActionList* deferred = mParallelTick ? &(mObjectQueryHandlers.find(indexid)->second.deferredAggregateEvents) : NULL;
     if (nobservers == 1 && nchildren == 0) {
-        mParent->queriersAreObserving(mSpaceNodeID, indexid, objid);
+        runOrDefer(deferred, std::tr1::bind(&ManualObjectQueryProcessor::queriersAreObserving, mParent, mSpaceNodeID, indexid, objid));
     }
     else if (nobservers == 0 && nchildren > 0) {
-        mParent->queriersStoppedObserving(mSpaceNodeID, indexid, objid);
+        runOrDefer(deferred, std::tr1::bind(&ManualObjectQueryProcessor::queriersStoppedObserving, mParent, mSpaceNodeID, indexid, objid));
     }
 }
 
@@ -409,6 +489,16 @@ void ObjectQueryHandler::commandForceRebuild(const Command::Command& cmd, Comman
 
 
 
+void ObjectQueryHandler::postNotifySubscribersLocUpdate(ReplicatedLocationServiceCache* loccache, const ObjectReference& obj) {
+    // Updates that are part of a batch get a single post from onBatchUpdated
+    if (loccache->deliveringBatch()) return;
+
+    mContext->mainStrand->post(
+        std::tr1::bind(&ObjectQueryHandler::handleNotifySubscribersLocUpdate, this, livenessToken(), loccache, obj),
+        "ObjectQueryHandler::handleNotifySubscribersLocUpdate"
+    );
+}
+
 void ObjectQueryHandler::onObjectAdded(ReplicatedLocationServiceCache* loccache, const ObjectReference& obj) {
 }
 
@@ -419,55 +509,59 @@ void ObjectQueryHandler::onParentUpdated(ReplicatedLocationServiceCache* loccach
 }
 
 void ObjectQueryHandler::onEpochUpdated(ReplicatedLocationServiceCache* loccache, const ObjectReference& obj) {
-    mContext->mainStrand->post(
-        std::tr1::bind(&ObjectQueryHandler::handleNotifySubscribersLocUpdate, this, livenessToken(), loccache, obj),
-        "ObjectQueryHandler::handleNotifySubscribersLocUpdate"
-    );
+    postNotifySubscribersLocUpdate(loccache, obj);
 }
 
 void ObjectQueryHandler::onLocationUpdated(ReplicatedLocationServiceCache* loccache, const ObjectReference& obj) {
     updateQuery(obj, loccache->location(obj), loccache->bounds(obj).fullBounds(), NoUpdateSolidAngle, NoUpdateMaxResults, NoUpdateCustomQueryString);
 
-    mContext->mainStrand->post(
-        std::tr1::bind(&ObjectQueryHandler::handleNotifySubscribersLocUpdate, this, livenessToken(), loccache, obj),
-        "ObjectQueryHandler::handleNotifySubscribersLocUpdate"
-    );
+    postNotifySubscribersLocUpdate(loccache, obj);
 }
 
 void ObjectQueryHandler::onOrientationUpdated(ReplicatedLocationServiceCache* loccache, const ObjectReference& obj) {
-    mContext->mainStrand->post(
-        std::tr1::bind(&ObjectQueryHandler::handleNotifySubscribersLocUpdate, this, livenessToken(), loccache, obj),
-        "ObjectQueryHandler::handleNotifySubscribersLocUpdate"
-    );
+    postNotifySubscribersLocUpdate(loccache, obj);
 }
 
 void ObjectQueryHandler::onBoundsUpdated(ReplicatedLocationServiceCache* loccache, const ObjectReference& obj) {
     updateQuery(obj, loccache->location(obj), loccache->bounds(obj).fullBounds(), NoUpdateSolidAngle, NoUpdateMaxResults, NoUpdateCustomQueryString);
 
-    mContext->mainStrand->post(
-        std::tr1::bind(&ObjectQueryHandler::handleNotifySubscribersLocUpdate, this, livenessToken(), loccache, obj),
-        "ObjectQueryHandler::handleNotifySubscribersLocUpdate"
-    );
+    postNotifySubscribersLocUpdate(loccache, obj);
 }
 
 void ObjectQueryHandler::onMeshUpdated(ReplicatedLocationServiceCache* loccache, const ObjectReference& obj) {
-    mContext->mainStrand->post(
-        std::tr1::bind(&ObjectQueryHandler::handleNotifySubscribersLocUpdate, this, livenessToken(), loccache, obj),
-        "ObjectQueryHandler::handleNotifySubscribersLocUpdate"
-    );
+    postNotifySubscribersLocUpdate(loccache, obj);
 }
 
 void ObjectQueryHandler::onPhysicsUpdated(ReplicatedLocationServiceCache* loccache, const ObjectReference& obj) {
-    mContext->mainStrand->post(
-        std::tr1::bind(&ObjectQueryHandler::handleNotifySubscribersLocUpdate, this, livenessToken(), loccache, obj),
-        "ObjectQueryHandler::handleNotifySubscribersLocUpdate"
-    );
+    postNotifySubscribersLocUpdate(loccache, obj);
 }
 
 void ObjectQueryHandler::onQueryDataUpdated(ReplicatedLocationServiceCache* loccache, const ObjectReference& obj) {
+    postNotifySubscribersLocUpdate(loccache, obj);
+}
+
+void ObjectQueryHandler::onBatchUpdated(ReplicatedLocationServiceCache* loccache, const Batch& batch) {
+    // Collect each object that needs its subscribers notified once, in the
+    // order they were first updated, and notify them all in one go.
+    ObjectReferenceListPtr objs(new ObjectReferenceList());
+    std::tr1::unordered_set<ObjectReference, ObjectReference::Hasher> seen;
+    for(Batch::const_iterator it = batch.begin(); it != batch.end(); it++) {
+        switch(it->type) {
+          case BatchEntry::ObjectAdded:
+          case BatchEntry::ObjectRemoved:
+          case BatchEntry::ParentUpdated:
+            continue;
+          default:
+            break;
+        }
+        if (seen.insert(it->obj).second)
+            objs->push_back(it->obj);
+    }
+    if (objs->empty()) return;
+
     mContext->mainStrand->post(
-        std::tr1::bind(&ObjectQueryHandler::handleNotifySubscribersLocUpdate, this, livenessToken(), loccache, obj),
-        "ObjectQueryHandler::handleNotifySubscribersLocUpdate"
+        std::tr1::bind(&ObjectQueryHandler::handleNotifySubscribersLocUpdates, this, livenessToken(), loccache, objs),
+        "ObjectQueryHandler::handleNotifySubscribersLocUpdates"
     );
 }
 
@@ -542,20 +636,135 @@ void ObjectQueryHandler::handleRemovedReplicatedIndex(Liveness::Token alive, Pro
 void ObjectQueryHandler::tickQueryHandler() {
     Time simT = mContext->simTime();
 
+    if (mWorkers == NULL)
+        tickQueryHandlerSerial(simT);
+    else
+        tickQueryHandlerParallel(simT);
+}
+
+void ObjectQueryHandler::tickQueryHandlerSerial(const Time& simT) {
     for(ReplicatedIndexQueryHandlerMap::iterator it = mObjectQueryHandlers.begin(); it != mObjectQueryHandlers.end(); it++)
         it->second.handler->tick(simT);
 }
 
+void ObjectQueryHandler::tickQueryHandlerParallel(const Time& simT) {
+    // Phase 1: Tick each replicated index on its own worker. Query events and
+    // aggregate notifications are recorded per-index (see queryHasEvents) so
+    // no shared state is modified.
+    std::vector<DeferredAction> tick_tasks;
+    for(ReplicatedIndexQueryHandlerMap::iterator it = mObjectQueryHandlers.begin(); it != mObjectQueryHandlers.end(); it++)
+        tick_tasks.push_back( std::tr1::bind(&ObjectQueryHandler::tickReplicatedIndex, this, &(it->second), simT) );
+    mParallelTick = true;
+    runOnWorkers(tick_tasks);
+    mParallelTick = false;
+
+    // Collect the queries with events in the order they were reported. A query
+    // may report more than once, but only needs to be processed once.
+    std::vector<Query*> pending;
+    std::tr1::unordered_set<Query*> pending_set;
+    for(ReplicatedIndexQueryHandlerMap::iterator it = mObjectQueryHandlers.begin(); it != mObjectQueryHandlers.end(); it++) {
+        ReplicatedIndexQueryHandler& rep_index = it->second;
+        for(std::vector<Query*>::iterator q_it = rep_index.pendingQueries.begin(); q_it != rep_index.pendingQueries.end(); q_it++) {
+            if (pending_set.insert(*q_it).second)
+                pending.push_back(*q_it);
+        }
+        rep_index.pendingQueries.clear();
+
+        // Parent aggregate notifications can be applied immediately
+        for(DeferredActionList::iterator ev_it = rep_index.deferredAggregateEvents.begin(); ev_it != rep_index.deferredAggregateEvents.end(); ev_it++)
+            (*ev_it)();
+        rep_index.deferredAggregateEvents.clear();
+    }
+    if (pending.empty()) return;
+
+    // Phase 2: Build results for batches of queries in parallel. Each query is
+    // handled by exactly one batch, so its events stay in order.
+    std::size_t nbatches = std::min((std::size_t)mNumThreads, (pending.size() + MinQueriesPerBatch - 1) / MinQueriesPerBatch);
+    std::size_t batch_size = (pending.size() + nbatches - 1) / nbatches;
+    std::vector<DeferredActionList> batch_actions(nbatches);
+    std::vector<DeferredAction> batch_tasks;
+    for(std::size_t bidx = 0; bidx < nbatches; bidx++) {
+        std::size_t begin = bidx * batch_size;
+        std::size_t end = std::min(begin + batch_size, pending.size());
+        batch_tasks.push_back( std::tr1::bind(&ObjectQueryHandler::generateObjectQueryEventsBatch, this, &pending, begin, end, &(batch_actions[bidx])) );
+    }
+    runOnWorkers(batch_tasks);
+
+    // Phase 3: Apply results, subscription changes and TL-Pinto server
+    // (un)registration serially, in batch order, which preserves per-query
+    // ordering of delivered events.
+    for(std::size_t bidx = 0; bidx < nbatches; bidx++) {
+        for(DeferredActionList::iterator act_it = batch_actions[bidx].begin(); act_it != batch_actions[bidx].end(); act_it++)
+            (*act_it)();
+    }
+}
+
+void ObjectQueryHandler::tickReplicatedIndex(ReplicatedIndexQueryHandler* rep_index, const Time& simT) {
+    rep_index->handler->tick(simT);
+}
+
+void ObjectQueryHandler::runOnWorkers(const std::vector<DeferredAction>& tasks) {
+    if (tasks.empty()) return;
+
+    TaskBarrier barrier(tasks.size());
+    for(std::size_t i = 1; i < tasks.size(); i++)
+        mWorkers->service()->post(std::tr1::bind(runBarrierTask, tasks[i], &barrier), "ObjectQueryHandler::runOnWorkers");
+    // This thread would just be waiting, so it takes the first task
+    runBarrierTask(tasks[0], &barrier);
+
+    boost::unique_lock<boost::mutex> lck(barrier.mutex);
+    while(barrier.remaining > 0)
+        barrier.done.wait(lck);
+}
+
+void ObjectQueryHandler::runOrDefer(DeferredActionList* deferred, const DeferredAction& action) {
+    if (deferred != NULL)
+        deferred->push_back(action);
+    else
+        action();
+}
+
+void ObjectQueryHandler::generateObjectQueryEventsBatch(const std::vector<Query*>* queries, std::size_t begin, std::size_t end, DeferredActionList* deferred) {
+    for(std::size_t i = begin; i < end; i++)
+        generateObjectQueryEvents((*queries)[i], deferred);
+}
+
+void ObjectQueryHandler::postAddObjectLocSubscription(const ObjectReference& querier, const ObjectReference& observed) {
+    mContext->mainStrand->post(
+        std::tr1::bind(&ObjectQueryHandler::handleAddObjectLocSubscription, this, livenessToken(), querier, observed),
+        "ObjectQueryHandler::handleAddObjectLocSubscription"
+    );
+}
+
+void ObjectQueryHandler::postRemoveObjectLocSubscription(const ObjectReference& querier, const ObjectReference& observed) {
+    mContext->mainStrand->post(
+        std::tr1::bind(&ObjectQueryHandler::handleRemoveObjectLocSubscription, this, livenessToken(), querier, observed),
+        "ObjectQueryHandler::handleRemoveObjectLocSubscription"
+    );
+}
 
-void ObjectQueryHandler::generateObjectQueryEvents(Query* query) {
+void ObjectQueryHandler::registerObjectQueryWithLeafServer(const ObjectReference& querier, ServerID sid) {
+    ObjectQueryDataPtr query_data = mObjectQueries[querier];
+    registerObjectQueryWithServer(querier, sid, query_data->loc, query_data->bounds, query_data->angle, query_data->max_results, query_data->custom_query_string);
+}
+
+void ObjectQueryHandler::pushObjectQueryResult(const ObjectReference& querier, Sirikata::Protocol::Prox::ProximityUpdate* results) {
+    mObjectResults.push( ProximityResultInfo(querier, results) );
+}
+
+void ObjectQueryHandler::generateObjectQueryEvents(Query* query, DeferredActionList* deferred) {
     typedef std::deque<QueryEvent> QueryEventList;
 
-    assert(mInvertedObjectQueries.find(query) != mInvertedObjectQueries.end());
-    ObjectIndexQueryKey query_id = mInvertedObjectQueries[query];
+    // Only use lookups which can't modify the maps since we may be running in
+    // a worker thread
+    InvertedObjectQueryMap::const_iterator query_it = mInvertedObjectQueries.find(query);
+    assert(query_it != mInvertedObjectQueries.end());
+    ObjectIndexQueryKey query_id = query_it->second;
     ObjectReference querier_id = query_id.first;
     ProxIndexID index_id = query_id.second;
-    assert(mObjectQueryHandlers.find(index_id) != mObjectQueryHandlers.end());
-    ReplicatedIndexQueryHandler& handler_data = mObjectQueryHandlers[index_id];
+    ReplicatedIndexQueryHandlerMap::iterator handler_it = mObjectQueryHandlers.find(index_id);
+    assert(handler_it != mObjectQueryHandlers.end());
+    ReplicatedIndexQueryHandler& handler_data = handler_it->second;
 
     QueryEventList evts;
     query->popEvents(evts);
@@ -568,10 +777,7 @@ void ObjectQueryHandler::generateObjectQueryEvents(Query* query) {
             ObjectReference objid = evt.additions()[aidx].id();
             assert(handler_data.loccache->tracking(objid));
 
-            mContext->mainStrand->post(
-                std::tr1::bind(&ObjectQueryHandler::handleAddObjectLocSubscription, this, livenessToken(), querier_id, objid),
-                "ObjectQueryHandler::handleAddObjectLocSubscription"
-            );
+            runOrDefer(deferred, std::tr1::bind(&ObjectQueryHandler::postAddObjectLocSubscription, this, querier_id, objid));
 
             Sirikata::Protocol::Prox::IObjectAddition addition = event_results->add_addition();
             addition.set_object( objid.getAsUUID() );
@@ -611,8 +817,7 @@ void ObjectQueryHandler::generateObjectQueryEvents(Query* query) {
             if (handler_data.from == NullServerID && evt.additions()[aidx].type() == QueryEvent::Normal) {
                 // Need to unpack real ID from the UUID
                 ServerID leaf_server = (ServerID)objid.getAsUUID().asUInt32();
-                ObjectQueryDataPtr query_data = mObjectQueries[querier_id];
-                registerObjectQueryWithServer(querier_id, leaf_server, query_data->loc, query_data->bounds, query_data->angle, query_data->max_results, query_data->custom_query_string);
+                runOrDefer(deferred, std::tr1::bind(&ObjectQueryHandler::registerObjectQueryWithLeafServer, this, querier_id, leaf_server));
             }
         }
         for(uint32 pidx = 0; pidx < evt.reparents().size(); pidx++) {
@@ -633,10 +838,7 @@ void ObjectQueryHandler::generateObjectQueryEvents(Query* query) {
             ObjectReference objid = evt.removals()[ridx].id();
             // Clear out seqno and let main strand remove loc
             // subcription
-            mContext->mainStrand->post(
-                std::tr1::bind(&ObjectQueryHandler::handleRemoveObjectLocSubscription, this, livenessToken(), querier_id, objid),
-                "ObjectQueryHandler::handleRemoveObjectLocSubscription"
-            );
+            runOrDefer(deferred, std::tr1::bind(&ObjectQueryHandler::postRemoveObjectLocSubscription, this, querier_id, objid));
 
             Sirikata::Protocol::Prox::IObjectRemoval removal = event_results->add_removal();
             removal.set_object( objid.getAsUUID() );
@@ -659,12 +861,12 @@ void ObjectQueryHandler::generateObjectQueryEvents(Query* query) {
             if (handler_data.from == NullServerID && evt.additions()[ridx].type() == QueryEvent::Normal) {
                 // Need to unpack real ID from the UUID
                 ServerID leaf_server = (ServerID)objid.getAsUUID().asUInt32();
-                unregisterObjectQueryWithServer(querier_id, leaf_server);
+                runOrDefer(deferred, std::tr1::bind(&ObjectQueryHandler::unregisterObjectQueryWithServer, this, querier_id, leaf_server));
             }
         }
         evts.pop_front();
 
-        mObjectResults.push( ProximityResultInfo(querier_id, event_results) );
+        runOrDefer(deferred, std::tr1::bind(&ObjectQueryHandler::pushObjectQueryResult, this, querier_id, event_results));
     }
 }
 
@@ -16,6 +16,7 @@
 #include <sirikata/oh/HostedObject.hpp>
 #include <sirikata/core/prox/Defs.hpp>
 #include <sirikata/core/util/InstanceMethodNotReentrant.hpp>
+#include <sirikata/core/network/IOServicePool.hpp>
 
 namespace Sirikata {
 
@@ -89,6 +90,7 @@ public:
     virtual void onMeshUpdated(ReplicatedLocationServiceCache* loccache, const ObjectReference& obj);
     virtual void onPhysicsUpdated(ReplicatedLocationServiceCache* loccache, const ObjectReference& obj);
     virtual void onQueryDataUpdated(ReplicatedLocationServiceCache* loccache, const ObjectReference& obj);
+    virtual void onBatchUpdated(ReplicatedLocationServiceCache* loccache, const Batch& batch);
 
     // PROX Thread:
 
@@ -118,6 +120,10 @@ public:
 
 private:
 
+    // Posts a subscriber update for obj to the main thread, unless it's part of
+    // a batch, which onBatchUpdated handles with a single post.
+    void postNotifySubscribersLocUpdate(ReplicatedLocationServiceCache* loccache, const ObjectReference& obj);
+
     // MAIN Thread: These are utility methods which should only be called from the main thread.
 
     // Update queries based on current state.
@@ -128,6 +134,12 @@ private:
     // uses the most up-to-date info, even if that's actually newer than the
     // update that triggered this.
     void handleNotifySubscribersLocUpdate(Liveness::Token alive, ReplicatedLocationServiceCache* loccache, const ObjectReference& oref);
+    // Same as above for all the objects updated in one batch, so a bulk update
+    // only costs a single post to the main strand.
+    typedef std::vector<ObjectReference> ObjectReferenceList;
+    typedef std::tr1::shared_ptr<ObjectReferenceList> ObjectReferenceListPtr;
+    void handleNotifySubscribersLocUpdates(Liveness::Token alive, ReplicatedLocationServiceCache* loccache, ObjectReferenceListPtr orefs);
+    void notifySubscribersLocUpdate(ReplicatedLocationServiceCache* loccache, const ObjectReference& oref);
 
     // Object queries
     void updateQuery(HostedObjectPtr ho, const SpaceObjectReference& sporef, SolidAngle sa, uint32 max_results, const String& custom_query_string);
@@ -151,8 +163,25 @@ private:
     void handleRemoveObjectQuery(Liveness::Token alive, const ObjectReference& object, bool notify_main_thread);
     void handleDisconnectedObject(Liveness::Token alive, const ObjectReference& object);
 
-    // Generate query events based on results collected from query handlers
-    void generateObjectQueryEvents(Query* query);
+    // Actions which modify shared prox strand state or must be delivered in
+    // order. While evaluating in parallel these are recorded and replayed
+    // serially once all the workers have finished.
+    typedef std::tr1::function<void()> DeferredAction;
+    typedef std::vector<DeferredAction> DeferredActionList;
+    // Invokes action immediately if deferred is NULL, otherwise records it.
+    void runOrDefer(DeferredActionList* deferred, const DeferredAction& action);
+
+    // Generate query events based on results collected from query
+    // handlers. If deferred is non-NULL, this only reads shared state and may
+    // be called from worker threads.
+    void generateObjectQueryEvents(Query* query, DeferredActionList* deferred);
+    void generateObjectQueryEventsBatch(const std::vector<Query*>* queries, std::size_t begin, std::size_t end, DeferredActionList* deferred);
+
+    // Pieces of generateObjectQueryEvents that may need to be deferred
+    void postAddObjectLocSubscription(const ObjectReference& querier, const ObjectReference& observed);
+    void postRemoveObjectLocSubscription(const ObjectReference& querier, const ObjectReference& observed);
+    void registerObjectQueryWithLeafServer(const ObjectReference& querier, ServerID sid);
+    void pushObjectQueryResult(const ObjectReference& querier, Sirikata::Protocol::Prox::ProximityUpdate* results);
 
     typedef std::set<ObjectReference> ObjectSet;
     typedef std::tr1::unordered_map<ProxIndexID, Query*> IndexQueryMap;
@@ -186,9 +215,9 @@ private:
     // about, we put it in a struct with a bit more metadata
     struct ReplicatedIndexQueryHandler {
         ReplicatedIndexQueryHandler(ProxQueryHandler* handler_, ReplicatedLocationServiceCachePtr loccache_, ServerID from_, bool dynamic_)
-         : handler(handler_), loccache(loccache_), from(from_), dynamic(dynamic_) {}
+         : handler(handler_), loccache(loccache_), from(from_), dynamic(dynamic_), pendingQueries(), deferredAggregateEvents() {}
         ReplicatedIndexQueryHandler()
-         : handler(NULL), loccache(), from(NullServerID), dynamic(true) {}
+         : handler(NULL), loccache(), from(NullServerID), dynamic(true), pendingQueries(), deferredAggregateEvents() {}
 
         ProxQueryHandler* handler;
         ReplicatedLocationServiceCachePtr loccache;
@@ -196,6 +225,13 @@ private:
         ServerID from;
         // Whether this tree includes dynamic objects
         bool dynamic;
+
+        // Only used during parallel ticks. Each index is ticked by a single
+        // worker, which is the only one to touch these until the tick
+        // completes: queries which reported events and aggregate
+        // notifications destined for the parent.
+        std::vector<Query*> pendingQueries;
+        DeferredActionList deferredAggregateEvents;
     };
     typedef std::tr1::unordered_map<ProxIndexID, ReplicatedIndexQueryHandler> ReplicatedIndexQueryHandlerMap;
     // Sort of the inverse of the above: aggregator (libprox handler) ->
@@ -221,6 +257,13 @@ private:
     // PROX Thread - Should only be accessed in methods used by the prox thread
 
     void tickQueryHandler();
+    // Serial and parallel implementations of tickQueryHandler
+    void tickQueryHandlerSerial(const Time& simT);
+    void tickQueryHandlerParallel(const Time& simT);
+    void tickReplicatedIndex(ReplicatedIndexQueryHandler* rep_index, const Time& simT);
+    // Runs all the tasks on the worker pool (and this thread), returning once
+    // they have all completed.
+    void runOnWorkers(const std::vector<DeferredAction>& tasks);
 
     // All queryHasEvents calls are going to not be reentrant unless you're very
     // careful, so the base class provides this so it's easy to verify it.
@@ -235,6 +278,16 @@ private:
     bool mObjectDistance; // Using distance queries
     PollerService mObjectHandlerPoller;
 
+    // Workers for parallel evaluation of replicated indices and query
+    // batches. NULL if only a single thread is configured, in which case
+    // everything is evaluated directly in the prox strand. The prox strand
+    // participates in the work, so this has one fewer thread than requested.
+    uint32 mNumThreads;
+    Network::IOServicePool* mWorkers;
+    // True while replicated indices are being ticked concurrently. Only
+    // modified by the prox strand while no workers are running.
+    bool mParallelTick;
+
     // Threads: Thread-safe data used for exchange between threads
     struct ProximityResultInfo {
         ProximityResultInfo(const ObjectReference& q, Sirikata::Protocol::Prox::ProximityUpdate* res)
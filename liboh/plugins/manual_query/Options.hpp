@@ -11,4 +11,6 @@
 #define OPT_MANUAL_QUERY_HANDLER_OPTIONS      "manual-query.handler-options"
 #define OPT_MANUAL_QUERY_HANDLER_NODE_DATA    "manual-query.handler-node-data"
 
+#define OPT_MANUAL_QUERY_THREADS              "manual-query.threads"
+
 #endif //_SIRIKATA_OH_MQ_OPTIONS_HPP_
@@ -317,11 +317,8 @@ bool ServerQueryHandler::handleLocationMessage(const OHDP::SpaceNodeID& snid, co
     }
     ServerQueryStatePtr& query_state = serv_it->second;
 
-    for(int32 idx = 0; idx < contents.update_size(); idx++) {
-        Sirikata::Protocol::Loc::LocationUpdate update = contents.update(idx);
-	LocProtocolLocUpdate tmp(update, *(query_state->sync));
-        query_state->client.locUpdate(tmp);
-    }
+    // The client converts times using the same TimeSynced as query_state->sync
+    query_state->client.locUpdates(contents);
 
     return true;
 }
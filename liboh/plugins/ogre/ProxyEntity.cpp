@@ -144,6 +144,11 @@ void ProxyEntity::iUpdateLocation(
     setOgreOrientation(newOrient.position());
     updateScale( newBounds.fullRadius() );
     checkDynamic();
+    // The planner only recomputes priorities for objects it's told about, so
+    // it needs to hear about movement too. Location updates are frequent, so
+    // skip the warning about unknown objects before we've been added.
+    if (mActive)
+        getScene()->downloadPlanner()->updateObject(proxy);
 }
 
 
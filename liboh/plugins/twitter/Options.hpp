@@ -10,4 +10,6 @@
 #define OPT_TWITTER_BLOOM_BUCKETS         "twitter.bloom.buckets"
 #define OPT_TWITTER_BLOOM_HASHES          "twitter.bloom.hashes"
 
+#define OPT_TWITTER_TERM_REGION_BATCH     "twitter.term-region.batch-updates"
+
 #endif //_SIRIKATA_OH_TWITTER_OPTIONS_HPP_
@@ -23,6 +23,7 @@ static void InitPluginOptions() {
     Sirikata::InitializeClassOptions ico(SIRIKATA_OPTIONS_MODULE, NULL,
         new Sirikata::OptionValue(OPT_TWITTER_BLOOM_BUCKETS, "1024", Sirikata::OptionValueType<uint32>(), "Number of bloom filter buckets"),
         new Sirikata::OptionValue(OPT_TWITTER_BLOOM_HASHES, "1", Sirikata::OptionValueType<uint16>(), "Number of hashes to compute for each item in the bloom filter."),
+        new Sirikata::OptionValue(OPT_TWITTER_TERM_REGION_BATCH, "false", Sirikata::OptionValueType<bool>(), "If true, term-region query handlers queue object additions and removals until their next tick, bulk loading large bursts of additions."),
         NULL);
 }
 
@@ -47,7 +48,7 @@ static ObjectProxGeomQueryHandlerFactoryType::QueryHandler* createGeomRTreeCutAg
 // This one's the real useful one
 static ObjectProxGeomQueryHandlerFactoryType::QueryHandler* createGeomTermRegionTwitterQueryHandler() {
     // FIXME custom branching size
-    return new TermRegionQueryHandler<ObjectProxSimulationTraits, TermBloomFilterNodeData<ObjectProxSimulationTraits> >(10);
+    return new TermRegionQueryHandler<ObjectProxSimulationTraits, TermBloomFilterNodeData<ObjectProxSimulationTraits> >(10, GetOptionValue<bool>(OPT_TWITTER_TERM_REGION_BATCH));
 }
 }
 
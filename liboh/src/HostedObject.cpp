@@ -85,7 +85,8 @@ HostedObject::HostedObject(ObjectHostContext* ctx, ObjectHost*parent, const UUID
    mID(_id),
    mObjectHost(parent),
    mObjectScript(NULL),
-   destroyed(false)
+   destroyed(false),
+   mLocDeadReckoning(GetOptionValue<float32>(OPT_OH_LOC_DEAD_RECKONING))
 {
     mNumOutstandingConnections=0;
     mDestroyWhenConnected=false;
@@ -825,6 +826,14 @@ void HostedObject::handleProximityUpdate(const SpaceObjectReference& spaceobj, c
         return;
     }
 
+    // Entering a dense area can produce thousands of additions at once, so
+    // make room for them up front and notify the script of all of them
+    // together
+    if (update.addition_size() > 0)
+        proxy_manager->reserve(update.addition_size());
+    std::vector<ProxyObjectPtr> added_proxies;
+    added_proxies.reserve(update.addition_size());
+
     for(int32 aidx = 0; aidx < update.addition_size(); aidx++) {
         Sirikata::Protocol::Prox::ObjectAddition addition = update.addition(aidx);
         ProxProtocolLocUpdate add(addition);
@@ -861,8 +870,10 @@ void HostedObject::handleProximityUpdate(const SpaceObjectReference& spaceobj, c
                  add.location_seqno() == add.bounds_seqno() &&
                 add.location_seqno() == add.mesh_seqno() &&
                 add.location_seqno() == add.physics_seqno());
-            proxy_obj = self->createProxy(proximateID, spaceobj, meshuri, loc, orient, bnds, phy, "",
-                                          isAggregate, proxyAddSeqNo);
+            // We already have the ProxyManager, so skip createProxy's
+            // lookup (and locking) for each of these
+            proxy_obj = proxy_manager->createObject(proximateID, loc, orient, bnds, meshuri, phy,
+                                                    isAggregate, proxyAddSeqNo);
         }
         else {
             // We need to handle optional values properly -- they
@@ -883,12 +894,13 @@ void HostedObject::handleProximityUpdate(const SpaceObjectReference& spaceobj, c
         // valid for the first time)
         if (proxy_obj) proxy_obj->validate();
 
-        //tells the object script that something that was close has come
-        //into view
-        if(self->mObjectScript)
-            self->mObjectScript->notifyProximate(proxy_obj,spaceobj);
+        if (proxy_obj) added_proxies.push_back(proxy_obj);
     }
 
+    //tells the object script that things that were close have come into view
+    if(self->mObjectScript && !added_proxies.empty())
+        self->mObjectScript->notifyProximateBatch(added_proxies,spaceobj);
+
     // NOTE we ignore reparents here. For now, we are only getting "regular"
     // queries here, where we just need the nodes along the cut (i.e. we're not
     // replicating). We can get one of these events because they'll be reported
@@ -1182,6 +1194,16 @@ void HostedObject::updateLocUpdateRequest(const SpaceID& space, const ObjectRefe
         pd.rerequestTimer->cancel();
     }
 
+    // With coalescing, the request is built when the SessionManager flushes
+    // it, so any further changes before then are folded into the same request
+    if (mObjectHost->coalescingLocationUpdates(space)) {
+        mObjectHost->queueLocationUpdate(
+            space, oref,
+            std::tr1::bind(&HostedObject::buildQueuedLocUpdateRequest, getWeakPtr(), SpaceObjectReference(space, oref), _1)
+        );
+        return;
+    }
+
     sendLocUpdateRequest(space, oref);
 }
 
@@ -1212,9 +1234,39 @@ void HostedObject::sendLocUpdateRequest(const SpaceID& space, const ObjectRefere
     // coalesced if one of them needs to do an async lookup of query
     // data for a mesh. However, we'll still get invoked twice. We can
     // safely ignore this request.
-    if (pd.updateFields == PerPresenceData::LOC_FIELD_NONE) return;
+    std::string payload;
+    if (!buildLocUpdateRequest(pd, &payload)) return;
+
+    bool send_succeeded = false;
+    SSTStreamPtr spaceStream = mObjectHost->getSpaceStream(space, oref);
+    if (spaceStream) {
+        spaceStream->createChildStream(
+            std::tr1::bind(discardChildStream, _1, _2),
+            (void*)payload.data(), payload.size(),
+            OBJECT_PORT_LOCATION, OBJECT_PORT_LOCATION
+        );
+        send_succeeded = true;
+    }
+
+    if (send_succeeded) {
+        pd.updateFields = PerPresenceData::LOC_FIELD_NONE;
+    }
+    else {
+        // Set up retry timer. Just rerun this method, but add no new
+        // update fields.
+        pd.rerequestTimer->wait(
+            Duration::milliseconds((int64)10),
+            std::tr1::bind(&HostedObject::sendLocUpdateRequest, this, space, oref)
+        );
+    }
+}
 
-    // Generate and send an update to Loc
+bool HostedObject::buildLocUpdateRequest(PerPresenceData& pd, std::string* payload) {
+    if (pd.updateFields == PerPresenceData::LOC_FIELD_NONE) return false;
+
+    const SpaceID& space = pd.space;
+
+    // Generate an update to Loc
     Protocol::Loc::Container container;
     Protocol::Loc::ILocationUpdateRequest loc_request = container.mutable_update_request();
     uint64 epoch = pd.requestEpoch++;
@@ -1226,6 +1278,7 @@ void HostedObject::sendLocUpdateRequest(const SpaceID& space, const ObjectRefere
         requested_loc.set_velocity(pd.requestLoc->location().velocity());
         // Save value but bump the epoch
         pd.requestLoc->setLocation(pd.requestLoc->location(), epoch);
+        pd.sentLoc = pd.requestLoc->location();
     }
     if (pd.updateFields & PerPresenceData::LOC_FIELD_ORIENTATION) {
         Protocol::ITimedMotionQuaternion requested_orient = loc_request.mutable_orientation();
@@ -1262,31 +1315,37 @@ void HostedObject::sendLocUpdateRequest(const SpaceID& space, const ObjectRefere
         pd.requestLoc->setQueryData(pd.requestLoc->queryData(), epoch);
     }
 
-    std::string payload = serializePBJMessage(container);
+    *payload = serializePBJMessage(container);
+    return true;
+}
 
+bool HostedObject::buildQueuedLocUpdateRequest(const HostedObjectWPtr& weakSelf, const SpaceObjectReference& sporef, std::string* payload) {
+    HostedObjectPtr self(weakSelf.lock());
+    if (!self || self->stopped())
+        return false;
 
-    bool send_succeeded = false;
-    SSTStreamPtr spaceStream = mObjectHost->getSpaceStream(space, oref);
-    if (spaceStream) {
-        spaceStream->createChildStream(
-            std::tr1::bind(discardChildStream, _1, _2),
-            (void*)payload.data(), payload.size(),
-            OBJECT_PORT_LOCATION, OBJECT_PORT_LOCATION
-        );
-        send_succeeded = true;
+    Mutex::scoped_lock locker(self->presenceDataMutex);
+    PresenceDataMap::iterator pdmIter = self->mPresenceData.find(sporef);
+    if (pdmIter == self->mPresenceData.end())
+        return false;
+    PerPresenceData& pd = *(pdmIter->second);
+
+    // Dead reckoning: the space server extrapolates from the last location we
+    // sent, so if the velocity hasn't changed and the requested position is
+    // still close to that extrapolation, there's no need to send it.
+    if (self->mLocDeadReckoning > 0.f && (pd.updateFields & PerPresenceData::LOC_FIELD_LOC)) {
+        const TimedMotionVector3f& requested = pd.requestLoc->location();
+        Vector3f error = requested.position() - pd.sentLoc.position(requested.updateTime());
+        if ((requested.velocity() - pd.sentLoc.velocity()).lengthSquared() < 1e-8f &&
+            error.lengthSquared() < self->mLocDeadReckoning * self->mLocDeadReckoning)
+        {
+            pd.updateFields = static_cast<PerPresenceData::LocField>(pd.updateFields & ~PerPresenceData::LOC_FIELD_LOC);
+        }
     }
 
-    if (send_succeeded) {
-        pd.updateFields = PerPresenceData::LOC_FIELD_NONE;
-    }
-    else {
-        // Set up retry timer. Just rerun this method, but add no new
-        // update fields.
-        pd.rerequestTimer->wait(
-            Duration::milliseconds((int64)10),
-            std::tr1::bind(&HostedObject::sendLocUpdateRequest, this, space, oref)
-        );
-    }
+    bool built = self->buildLocUpdateRequest(pd, payload);
+    pd.updateFields = PerPresenceData::LOC_FIELD_NONE;
+    return built;
 }
 
 
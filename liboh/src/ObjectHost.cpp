@@ -342,9 +342,7 @@ Time ObjectHost::currentLocalTime() const {
 
 bool ObjectHost::send(SpaceObjectReference& sporef_src, const SpaceID& space, const ObjectMessagePort src_port, const UUID& dest, const ObjectMessagePort dest_port, MemoryReference payload) {
     Sirikata::SerializationCheck::Scoped sc(&mSessionSerialization);
-
-    std::string payload_str( (char*)payload.begin(), (char*)payload.end() );
-    return send(sporef_src, space, src_port, dest, dest_port, payload_str);
+    return mSessionManagers[space]->send(sporef_src, src_port, dest, dest_port, payload);
 }
 
 bool ObjectHost::send(SpaceObjectReference& sporef_src, const SpaceID& space, const ObjectMessagePort src_port, const UUID& dest, const ObjectMessagePort dest_port, const std::string& payload) {
@@ -413,6 +411,17 @@ ObjectHost::SSTStreamPtr ObjectHost::getSpaceStream(const SpaceID& space, const
     return mSessionManagers[space]->getSpaceStream(oref);
 }
 
+bool ObjectHost::coalescingLocationUpdates(const SpaceID& space)
+{
+    SpaceSessionManagerMap::iterator it = mSessionManagers.find(space);
+    return (it != mSessionManagers.end() && it->second->coalescingLocationUpdates());
+}
+
+void ObjectHost::queueLocationUpdate(const SpaceID& space, const ObjectReference& oref, const SessionManager::LocationUpdateBuilder& builder)
+{
+    mSessionManagers[space]->queueLocationUpdate(SpaceObjectReference(space, oref), builder);
+}
+
 
 void ObjectHost::start()
 {
@@ -37,6 +37,8 @@
 #include <sirikata/core/options/CommonOptions.hpp>
 #include <sirikata/core/util/SpaceObjectReference.hpp>
 #include "Protocol_Session.pbj.hpp"
+#include "Protocol_BulkSession.pbj.hpp"
+#include "Protocol_BulkLocation.pbj.hpp"
 #include <sirikata/core/util/Platform.hpp>
 #include <sirikata/core/odp/SST.hpp>
 
@@ -350,7 +352,11 @@ SessionManager::SessionManager(
    mObjectDisconnectedCallback(disconn_cb),
    mObjectConnections(this),
    mTimeSyncClient(NULL),
-   mShuttingDown(false)
+   mShuttingDown(false),
+   mBulkSessions(GetOptionValue<bool>(OPT_OH_BULK_SESSION)),
+   mBulkSessionFlushScheduled(false),
+   mLocationUpdateTick(GetOptionValue<Duration>(OPT_OH_LOC_UPDATE_TICK)),
+   mLocationUpdatePoller(NULL)
 #ifdef PROFILE_OH_PACKET_RTT
    ,
    mClearOutstandingCount(0),
@@ -363,11 +369,21 @@ SessionManager::SessionManager(
 
     mHandleReadProfiler = mContext->profiler->addStage("Handle Read Network");
     mHandleMessageProfiler = mContext->profiler->addStage("Handle Server Message");
+
+    if (coalescingLocationUpdates()) {
+        mLocationUpdatePoller = new Poller(
+            mContext->mainStrand,
+            std::tr1::bind(&SessionManager::flushLocationUpdates, this),
+            "SessionManager::flushLocationUpdates",
+            mLocationUpdateTick
+        );
+    }
 }
 
 
 SessionManager::~SessionManager() {
     delete mTimeSyncClient;
+    delete mLocationUpdatePoller;
 
     // Close all connections
     for (ServerConnectionMap::iterator it = mConnections.begin(); it != mConnections.end(); it++) {
@@ -384,10 +400,14 @@ SessionManager::~SessionManager() {
 
 void SessionManager::start() {
     PollingService::start();
+    if (mLocationUpdatePoller != NULL)
+        mLocationUpdatePoller->start();
 }
 
 void SessionManager::stop() {
     PollingService::stop();
+    if (mLocationUpdatePoller != NULL)
+        mLocationUpdatePoller->stop();
 
     mShuttingDown = true;
 
@@ -582,7 +602,17 @@ void SessionManager::openConnectionStartSession(const SpaceObjectReference& spor
     if (ci.query_data.size() > 0)
       connect_msg.set_query_data( ci.query_data );
 
-    if (!send(sporef_uuid, OBJECT_PORT_SESSION,
+    if (mBulkSessions) {
+        // Batched requests keep retrying until they're sent, so we only need
+        // the timeout for a lost response
+        sendSessionMessage(sporef_uuid, conn->server(), serializePBJMessage(session_msg));
+        mContext->mainStrand->post(
+            Duration::seconds(3),
+            std::tr1::bind(&SessionManager::checkConnectedAndRetry, this, sporef_uuid, conn->server()),
+            "SessionManager::checkConnectedAndRetry"
+        );
+    }
+    else if (!send(sporef_uuid, OBJECT_PORT_SESSION,
               UUID::null(), OBJECT_PORT_SESSION,
               serializePBJMessage(session_msg),
             conn->server()
@@ -730,6 +760,10 @@ void SessionManager::timeSyncUpdated() {
 }
 
 bool SessionManager::send(const SpaceObjectReference& sporef_src, const ObjectMessagePort src_port, const UUID& dest, const ObjectMessagePort dest_port, const std::string& payload, ServerID dest_server) {
+    return send(sporef_src, src_port, dest, dest_port, MemoryReference(payload), dest_server);
+}
+
+bool SessionManager::send(const SpaceObjectReference& sporef_src, const ObjectMessagePort src_port, const UUID& dest, const ObjectMessagePort dest_port, MemoryReference payload, ServerID dest_server) {
     Sirikata::SerializationCheck::Scoped sc(&mSerialization);
 
     if (mShuttingDown)
@@ -752,11 +786,13 @@ bool SessionManager::send(const SpaceObjectReference& sporef_src, const ObjectMe
     }
     SpaceNodeConnection* conn = it->second;
 
-    // FIXME would be nice not to have to do this alloc/dealloc
+    // Only the header goes into the message, the connection serializes the
+    // payload straight from the caller's buffer
+    static const std::string empty_payload;
     ObjectMessage obj_msg;
-    createObjectHostMessage(mContext->id, sporef_src, src_port, dest, dest_port, payload, &obj_msg);
+    createObjectHostMessage(mContext->id, sporef_src, src_port, dest, dest_port, empty_payload, &obj_msg);
     TIMESTAMP_CREATED((&obj_msg), Trace::CREATED);
-    bool pushed = conn->push(obj_msg);
+    bool pushed = conn->push(obj_msg, payload);
 #ifdef PROFILE_OH_PACKET_RTT
     if (pushed) {
         mOutstandingPackets[obj_msg.unique()] = mContext->simTime();
@@ -1054,6 +1090,12 @@ void SessionManager::handleServerMessage(ObjectMessage* msg, ServerID server_id)
     if (msg->source_object() == UUID::null() && msg->dest_port() == OBJECT_PORT_SESSION) {
         handleSessionMessage(msg, server_id);
     }
+    else if (msg->source_object() == UUID::null() && msg->dest_object() == UUID::null() &&
+        msg->dest_port() == OBJECT_PORT_BULK_SESSION) {
+        // Batched session messages, only sent if we sent batched requests.
+        // Also must be handled before OHDP.
+        handleBulkSessionMessage(msg, server_id);
+    }
     else if (msg->source_object() == UUID::null() && msg->dest_object() == UUID::null()) {
         // Non-session messages between the space and OH, i.e. OHDP. Note that
         // the Session messages must be handled *before* this case since they
@@ -1120,6 +1162,30 @@ void SessionManager::handleSessionMessage(Sirikata::Protocol::Object::ObjectMess
     delete msg;
 }
 
+void SessionManager::handleBulkSessionMessage(Sirikata::Protocol::Object::ObjectMessage* msg, ServerID from_server) {
+    Sirikata::Protocol::BulkSession::BulkSessionMessage bulk_msg;
+    bool parse_success = bulk_msg.ParseFromString(msg->payload());
+    if (!parse_success) {
+        LOG_INVALID_MESSAGE(session, error, msg->payload());
+        delete msg;
+        return;
+    }
+    delete msg;
+
+    for(int32 i = 0; i < bulk_msg.entries_size(); i++) {
+        Sirikata::Protocol::BulkSession::SessionEntry entry = bulk_msg.entries(i);
+        handleSessionMessage(
+            createObjectMessage(
+                from_server,
+                UUID::null(), OBJECT_PORT_SESSION,
+                entry.object(), OBJECT_PORT_SESSION,
+                entry.container()
+            ),
+            from_server
+        );
+    }
+}
+
 void SessionManager::handleSessionMessageConnectResponseSuccess(ServerID from_server, const SpaceObjectReference& sporef_obj, Sirikata::Protocol::Session::Container& session_msg) {
     uint64 seqno = (session_msg.has_seqno() ? session_msg.seqno() : 0);
 
@@ -1276,16 +1342,141 @@ void SessionManager::sendConnectSuccessAck(const SpaceObjectReference& sporef, S
     Sirikata::Protocol::Session::Container ack_msg;
     ack_msg.set_seqno( mObjectConnections.getSeqno(sporef) );
     Sirikata::Protocol::Session::IConnectAck connect_ack_msg = ack_msg.mutable_connect_ack();
+    sendSessionMessage(sporef, connected_to, serializePBJMessage(ack_msg));
+}
+
+void SessionManager::sendSessionMessage(const SpaceObjectReference& sporef, ServerID dest_server, const std::string& payload) {
+    if (!mBulkSessions) {
+        sendRetryingMessage(
+            sporef, OBJECT_PORT_SESSION,
+            UUID::null(), OBJECT_PORT_SESSION,
+            payload,
+            dest_server,
+            mContext->mainStrand,
+            Duration::seconds(0.05)
+        );
+        return;
+    }
+
+    BulkSessionEntryList& entries = mPendingBulkSessions[dest_server];
+    entries.push_back( std::make_pair(sporef.object().getAsUUID(), payload) );
+
+    if (entries.size() >= MAX_BULK_SESSION_ENTRIES) {
+        flushBulkSessionMessages(dest_server);
+    }
+    else if (!mBulkSessionFlushScheduled) {
+        // Connections for many objects are usually started by a burst of
+        // events, e.g. a space server connection completing, so give the rest
+        // of the burst a chance to join this batch
+        mBulkSessionFlushScheduled = true;
+        mContext->mainStrand->post(
+            std::tr1::bind(&SessionManager::flushAllBulkSessionMessages, this),
+            "SessionManager::flushAllBulkSessionMessages"
+        );
+    }
+}
+
+void SessionManager::flushBulkSessionMessages(ServerID dest_server) {
+    PendingBulkSessionMap::iterator it = mPendingBulkSessions.find(dest_server);
+    if (it == mPendingBulkSessions.end())
+        return;
+
+    Sirikata::Protocol::BulkSession::BulkSessionMessage bulk_msg;
+    for(BulkSessionEntryList::iterator entry_it = it->second.begin(); entry_it != it->second.end(); entry_it++) {
+        Sirikata::Protocol::BulkSession::ISessionEntry entry = bulk_msg.add_entries();
+        entry.set_object(entry_it->first);
+        entry.set_container(entry_it->second);
+    }
+    mPendingBulkSessions.erase(it);
+
+    // Sent from the object host itself rather than any of the objects
     sendRetryingMessage(
-        sporef, OBJECT_PORT_SESSION,
-        UUID::null(), OBJECT_PORT_SESSION,
-        serializePBJMessage(ack_msg),
-        connected_to,
+        SpaceObjectReference(mSpace, ObjectReference::null()), OBJECT_PORT_BULK_SESSION,
+        UUID::null(), OBJECT_PORT_BULK_SESSION,
+        serializePBJMessage(bulk_msg),
+        dest_server,
         mContext->mainStrand,
         Duration::seconds(0.05)
     );
 }
 
+void SessionManager::flushAllBulkSessionMessages() {
+    mBulkSessionFlushScheduled = false;
+    while(!mPendingBulkSessions.empty())
+        flushBulkSessionMessages(mPendingBulkSessions.begin()->first);
+}
+
+void SessionManager::queueLocationUpdate(const SpaceObjectReference& sporef, const LocationUpdateBuilder& builder) {
+    assert(coalescingLocationUpdates());
+    mDirtyLocations[sporef] = builder;
+}
+
+void SessionManager::flushLocationUpdates() {
+    Sirikata::SerializationCheck::Scoped sc(&mSerialization);
+
+    if (mShuttingDown)
+        return;
+
+    // Build requests for everything that changed since the last tick. Objects
+    // which aren't connected to a server right now (e.g. mid-migration) stay
+    // dirty until they are, and objects which have gone away are dropped.
+    for(DirtyLocationMap::iterator it = mDirtyLocations.begin(); it != mDirtyLocations.end(); ) {
+        if (!mObjectConnections.exists(it->first)) {
+            mDirtyLocations.erase(it++);
+            continue;
+        }
+        ServerID dest_server = mObjectConnections.getConnectedServer(it->first);
+        if (dest_server == NullServerID) {
+            it++;
+            continue;
+        }
+
+        std::string container;
+        if (it->second(&container))
+            mPendingLocations[dest_server].push_back( std::make_pair(it->first.object().getAsUUID(), container) );
+        mDirtyLocations.erase(it++);
+    }
+
+    for(PendingLocationMap::iterator it = mPendingLocations.begin(); it != mPendingLocations.end(); ) {
+        // Nothing will ever get through to a server we've lost our
+        // connection to
+        if (mConnections.find(it->first) == mConnections.end()) {
+            mPendingLocations.erase(it++);
+            continue;
+        }
+
+        LocationEntryList& entries = it->second;
+        LocationEntryList::iterator sent_end = entries.begin();
+        while(sent_end != entries.end()) {
+            LocationEntryList::iterator batch_end = sent_end + std::min((std::size_t)MAX_BULK_LOCATION_ENTRIES, (std::size_t)(entries.end() - sent_end));
+
+            Sirikata::Protocol::BulkLocation::BulkLocationMessage bulk_msg;
+            for(LocationEntryList::iterator entry_it = sent_end; entry_it != batch_end; entry_it++) {
+                Sirikata::Protocol::BulkLocation::ILocationEntry entry = bulk_msg.add_entries();
+                entry.set_object(entry_it->first);
+                entry.set_container(entry_it->second);
+            }
+
+            // Sent from the object host itself rather than any of the objects
+            bool sent = send(
+                SpaceObjectReference(mSpace, ObjectReference::null()), OBJECT_PORT_BULK_LOCATION,
+                UUID::null(), OBJECT_PORT_BULK_LOCATION,
+                serializePBJMessage(bulk_msg),
+                it->first
+            );
+            // The queue is full, try again next tick
+            if (!sent) break;
+            sent_end = batch_end;
+        }
+        entries.erase(entries.begin(), sent_end);
+
+        if (entries.empty())
+            mPendingLocations.erase(it++);
+        else
+            it++;
+    }
+}
+
 void SessionManager::handleObjectFullyConnected(const SpaceID& space, const ObjectReference& obj, ServerID server, const ConnectingInfo& ci, ConnectedCallback real_cb) {
     // Do the callback even if the connection failed so the object is notified.
 
@@ -42,6 +42,11 @@
 using namespace Sirikata;
 using namespace Sirikata::Network;
 
+// Flush a batch early rather than let it grow past this size
+#define MAX_SEND_BATCH_SIZE 65536
+// Batch key and length prefixed to each message
+#define MAX_BATCH_ENTRY_OVERHEAD 11
+
 namespace Sirikata {
 
 SpaceNodeConnection::SpaceNodeConnection(ObjectHostContext* ctx, Network::IOStrand* ioStrand, TimeProfiler::Stage* handle_read_stage, OptionSet *streamOptions, const SpaceID& spaceid, ServerID sid, OHDP::Service* ohdp_service, ConnectionEventCallback ccb, ReceiveCallback rcb)
@@ -53,6 +58,8 @@ SpaceNodeConnection::SpaceNodeConnection(ObjectHostContext* ctx, Network::IOStra
    socket(Sirikata::Network::StreamFactory::getSingleton().getConstructor(GetOptionValue<String>("ohstreamlib"))(ioStrand,streamOptions)),
    mAddr(Network::Address::null()),
    mConnecting(false),
+   mBatchSends(GetOptionValue<bool>(OPT_OH_BATCH_SEND)),
+   mSendBatchFlushScheduled(false),
    receive_queue(GetOptionValue<int32>("object-host-receive-buffer"), std::tr1::bind(&ObjectMessage::size, std::tr1::placeholders::_1)),
    mConnectCB(ccb),
    mReceiveCB(rcb)
@@ -65,20 +72,47 @@ SpaceNodeConnection::~SpaceNodeConnection() {
     delete socket;
 }
 
-bool SpaceNodeConnection::push(const ObjectMessage& msg) {
+bool SpaceNodeConnection::push(const ObjectMessage& msg, MemoryReference payload) {
     TIMESTAMP_START(tstamp, (&msg));
 
-    std::string data;
-    msg.serialize(&data);
+    serializeObjectMessageHeader(msg, payload.size(), &mSendHeader);
+
+    bool success;
+    if (mBatchSends) {
+        size_t entry_size = mSendHeader.size() + payload.size() + MAX_BATCH_ENTRY_OVERHEAD;
+        if (!mSendBatch.empty() && mSendBatch.size() + entry_size > MAX_SEND_BATCH_SIZE)
+            flushSendBatch();
+
+        // Only take the message if the batch will still fit when it's sent
+        success = socket->canSend(mSendBatch.size() + entry_size);
+        if (success) {
+            appendObjectMessageToBatch(mSendHeader, payload, &mSendBatch);
+            mSendBatchIDs.push_back(msg.unique());
+            if (!mSendBatchFlushScheduled) {
+                // Let the rest of the current burst of events join this batch
+                mSendBatchFlushScheduled = true;
+                mContext->mainStrand->post(
+                    std::tr1::bind(&SpaceNodeConnection::handleFlushSendBatch, this, livenessToken()),
+                    "SpaceNodeConnection::flushSendBatch"
+                );
+            }
+        }
+    }
+    else {
+        // Try to push to the network. The header and payload are copied
+        // straight into the outgoing frame.
+        success = socket->send(
+            Sirikata::MemoryReference(mSendHeader),
+            payload,
+            Sirikata::Network::ReliableOrdered
+        );
+    }
 
-    // Try to push to the network
-    bool success = socket->send(
-        //Sirikata::MemoryReference(&(data[0]), data.size()),
-        Sirikata::MemoryReference(data),
-        Sirikata::Network::ReliableOrdered
-                                );
     if (success) {
-        TIMESTAMP_END(tstamp, Trace::OH_HIT_NETWORK);
+        // Batched messages only hit the network when the batch is flushed
+        if (!mBatchSends) {
+            TIMESTAMP_END(tstamp, Trace::OH_HIT_NETWORK);
+        }
     }
     else {
         TIMESTAMP_END(tstamp, Trace::OH_DROPPED_AT_SEND);
@@ -88,6 +122,43 @@ bool SpaceNodeConnection::push(const ObjectMessage& msg) {
     return success;
 }
 
+void SpaceNodeConnection::handleFlushSendBatch(Liveness::Token alive) {
+    Liveness::Lock locked(alive);
+    if (!locked)
+        return;
+
+    mSendBatchFlushScheduled = false;
+    flushSendBatch();
+}
+
+void SpaceNodeConnection::flushSendBatch() {
+    if (mSendBatch.empty())
+        return;
+
+    bool success = socket->send(
+        Sirikata::MemoryReference(mSendBatch),
+        Sirikata::Network::ReliableOrdered
+    );
+    if (!success) {
+        // canSend() said there was room when the messages were accepted, so
+        // this should only happen if the connection went away
+        SILOG(space-node-connection,error,"Failed to send batch of " << mSendBatchIDs.size() << " object messages");
+    }
+    for(std::vector<uint64>::iterator it = mSendBatchIDs.begin(); it != mSendBatchIDs.end(); it++) {
+        if (success) {
+            TIMESTAMP_SIMPLE(*it, Trace::OH_HIT_NETWORK);
+        }
+        else {
+            TIMESTAMP_SIMPLE(*it, Trace::OH_DROPPED_AT_SEND);
+            TRACE_DROP(OH_DROPPED_AT_SEND);
+        }
+    }
+
+    // clear() keeps the buffers' capacity for the next batch
+    mSendBatch.clear();
+    mSendBatchIDs.clear();
+}
+
 ObjectMessage* SpaceNodeConnection::pull() {
     return receive_queue.pull();
 }
@@ -223,6 +294,7 @@ void SpaceNodeConnection::invokeAndClearCallbacks(bool connected) {
 }
 
 void SpaceNodeConnection::shutdown() {
+    flushSendBatch();
     socket->close();
 }
 
@@ -37,6 +37,18 @@ public:
     }
     virtual ~CopyableLocUpdate() {}
 
+    /** Replace the contents of this update with a copy of rhs. This allows the
+     *  storage to be reused, e.g. by pools of deferred updates.
+     */
+    void assign(const LocUpdate& rhs) {
+        mObject = rhs.object();
+        mUpdate = SequencedPresenceProperties();
+        mHasEpoch = rhs.has_epoch();
+        mEpoch = (rhs.has_epoch() ? rhs.epoch() : 0);
+        mIndexIDs.clear();
+        copyData(rhs);
+    }
+
     virtual ObjectReference object() const { return mObject; }
 
     // Request epoch
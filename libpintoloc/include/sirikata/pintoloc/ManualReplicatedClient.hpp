@@ -21,6 +21,13 @@
 #include <sirikata/core/util/SerializationCheck.hpp>
 
 namespace Sirikata {
+
+namespace Protocol {
+namespace Loc {
+class BulkLocationUpdate;
+}
+}
+
 namespace Pinto {
 namespace Manual {
 
@@ -64,6 +71,11 @@ class SIRIKATA_LIBPINTOLOC_EXPORT ReplicatedClient :
     void proxUpdate(const Sirikata::Protocol::Prox::ProximityResults& results);
     void proxUpdate(const Sirikata::Protocol::Prox::ProximityUpdate& update);
     void locUpdate(const LocUpdate& update);
+    // Apply all the updates in a BulkLocationUpdate, converting times with
+    // this client's TimeSynced. This is equivalent to calling locUpdate for
+    // each of them, but is handled in one pass in the strand and only
+    // generates one batch of notifications per ReplicatedLocationServiceCache.
+    void locUpdates(const Sirikata::Protocol::Loc::BulkLocationUpdate& updates);
 
     // Notifications about local queries in the tree so we know how to
     // move the cut on the space server up or down. This should actually be
@@ -99,6 +111,13 @@ class SIRIKATA_LIBPINTOLOC_EXPORT ReplicatedClient :
     void handleProxUpdateResults(const Sirikata::Protocol::Prox::ProximityResults& results);
     void handleProxUpdate(const Sirikata::Protocol::Prox::ProximityUpdate& update);
     void handleLocUpdate(const CopyableLocUpdate& update);
+    void handleLocUpdates(const Sirikata::Protocol::Loc::BulkLocationUpdate& updates);
+    // Applies a single update, used by both handleLocUpdate and
+    // handleLocUpdates. If batched_caches is non-NULL, any loc caches
+    // updated are put into batch mode (if they aren't already) and added to
+    // the list so the caller can end the batches.
+    typedef std::vector<ReplicatedLocationServiceCachePtr> LocCacheList;
+    void dispatchLocUpdate(const LocUpdate& update, LocCacheList* batched_caches);
 
     // Returns true if the cache was actually created
     bool createLocCache(ProxIndexID iid);
@@ -17,6 +17,7 @@
 #include <sirikata/pintoloc/ProtocolLocUpdate.hpp>
 #include <sirikata/core/util/PresenceProperties.hpp>
 #include <sirikata/pintoloc/PresencePropertiesLocUpdate.hpp>
+#include <sirikata/pintoloc/CopyableLocUpdate.hpp>
 
 namespace Sirikata {
 
@@ -61,6 +62,7 @@ public:
     };
 
     OrphanLocUpdateManager(Context* ctx, Network::IOStrand* strand, const Duration& timeout);
+    virtual ~OrphanLocUpdateManager();
 
     /** Add an orphan update to the queue and set a timeout for it to be cleared
      *  out.
@@ -86,12 +88,17 @@ public:
         ObjectUpdateMap::iterator it = mUpdates.find(proximateID);
         if (it == mUpdates.end()) return;
 
-        const UpdateInfoList& info_list = it->second;
+        // Take ownership of the list first so the listener can safely add
+        // new orphans while we're iterating
+        UpdateInfoList info_list;
+        info_list.swap(it->second);
+        mUpdates.erase(it);
+
         for(UpdateInfoList::const_iterator info_it = info_list.begin(); info_it != info_list.end(); info_it++) {
-            if ((*info_it)->value != NULL) {
+            if ((*info_it)->type == UpdateInfo::LOC_UPDATE) {
                 listener->onOrphanLocUpdate( *((*info_it)->value), extra1 );
             }
-            else if ((*info_it)->opd != NULL) {
+            else if ((*info_it)->type == UpdateInfo::PROPERTIES) {
                 PresencePropertiesLocUpdate plu( (*info_it)->object.object(), *((*info_it)->opd) );
                 listener->onOrphanLocUpdate( plu, extra1 );
             }
@@ -100,19 +107,24 @@ public:
         // Once we've notified of these we can get rid of them -- if they
         // need the info again they should re-register it with
         // addUpdateFromExisting before cleaning up the object.
-        mUpdates.erase(it);
+        releaseUpdateInfos(info_list);
     }
     template<typename ListenerType, typename ExtraParamType1, typename ExtraParamType2>
     void invokeOrphanUpdates2(const SpaceObjectReference& proximateID, ListenerType* listener, ExtraParamType1 extra1, ExtraParamType2 extra2) {
         ObjectUpdateMap::iterator it = mUpdates.find(proximateID);
         if (it == mUpdates.end()) return;
 
-        const UpdateInfoList& info_list = it->second;
+        // Take ownership of the list first so the listener can safely add
+        // new orphans while we're iterating
+        UpdateInfoList info_list;
+        info_list.swap(it->second);
+        mUpdates.erase(it);
+
         for(UpdateInfoList::const_iterator info_it = info_list.begin(); info_it != info_list.end(); info_it++) {
-            if ((*info_it)->value != NULL) {
+            if ((*info_it)->type == UpdateInfo::LOC_UPDATE) {
                 listener->onOrphanLocUpdate( *((*info_it)->value), extra1, extra2 );
             }
-            else if ((*info_it)->opd != NULL) {
+            else if ((*info_it)->type == UpdateInfo::PROPERTIES) {
                 PresencePropertiesLocUpdate plu( (*info_it)->object.object(), *((*info_it)->opd) );
                 listener->onOrphanLocUpdate( plu, extra1, extra2 );
             }
@@ -121,7 +133,7 @@ public:
         // Once we've notified of these we can get rid of them -- if they
         // need the info again they should re-register it with
         // addUpdateFromExisting before cleaning up the object.
-        mUpdates.erase(it);
+        releaseUpdateInfos(info_list);
     }
 
     bool empty() const {
@@ -131,32 +143,41 @@ public:
 private:
     virtual void poll();
 
+    // UpdateInfos are pooled since bursts of orphans (e.g. after a
+    // reconnection) can be very large. The value and opd storage is allocated
+    // lazily and kept with the record when it is returned to the pool so it
+    // can be reused.
     struct UpdateInfo {
-        UpdateInfo(const SpaceObjectReference& obj, LocUpdate* _v, const Time& t)
-         : object(obj), value(_v), opd(NULL), expiresAt(t)
-        {}
-        UpdateInfo(const SpaceObjectReference& obj, SequencedPresenceProperties* _v, const Time& t)
-         : object(obj), value(NULL), opd(_v), expiresAt(t)
+        enum Type {
+            UNUSED,
+            LOC_UPDATE, // value is valid
+            PROPERTIES // opd is valid
+        };
+
+        UpdateInfo()
+         : object(), type(UNUSED), value(NULL), opd(NULL), expiresAt(Time::null())
         {}
         ~UpdateInfo();
 
         SpaceObjectReference object;
-        //Either value or opd will be non-null.  Never both.
-        LocUpdate* value;
+        Type type;
+        CopyableLocUpdate* value;
         SequencedPresenceProperties* opd;
 
         Time expiresAt;
-    private:
-        UpdateInfo();
     };
-    typedef std::tr1::shared_ptr<UpdateInfo> UpdateInfoPtr;
-    typedef std::vector<UpdateInfoPtr> UpdateInfoList;
+    typedef std::vector<UpdateInfo*> UpdateInfoList;
+
+    UpdateInfo* allocateUpdateInfo(const SpaceObjectReference& obj);
+    void releaseUpdateInfo(UpdateInfo* info);
+    void releaseUpdateInfos(const UpdateInfoList& infos);
 
     typedef std::tr1::unordered_map<SpaceObjectReference, UpdateInfoList, SpaceObjectReference::Hasher> ObjectUpdateMap;
 
     Context* mContext;
     Duration mTimeout;
     ObjectUpdateMap mUpdates;
+    UpdateInfoList mFreeUpdateInfos;
 }; // class OrphanLocUpdateManager
 
 typedef std::tr1::shared_ptr<OrphanLocUpdateManager> OrphanLocUpdateManagerPtr;
@@ -74,6 +74,18 @@ public:
     void queryDataUpdated(const ObjectReference& uuid, const String& newval, uint64 seqno);
     void parentUpdated(const ObjectReference& uuid, const ObjectReference& newval, uint64 seqno);
 
+    // Batched input. Between beginBatch() and endBatch() data is still updated
+    // immediately, but notifications are collected and delivered with a
+    // single post to the strand when the outermost endBatch() is called. This
+    // makes applying large sets of updates much cheaper and doesn't change the
+    // order listeners see events in. Batches may be nested.
+    void beginBatch();
+    void endBatch();
+    // True while the individual ReplicatedLocationUpdateListener callbacks
+    // for a batch are being delivered, i.e. onBatchUpdated will follow with
+    // the whole batch. Only meaningful from within those callbacks.
+    bool deliveringBatch() const { return mDeliveringBatch != NULL; }
+
     /* LocationServiceCache members. */
 
     virtual void addPlaceholderImposter(
@@ -142,6 +154,25 @@ private:
     void notifyPhysicsUpdated(Liveness::Token alive_token, const ObjectReference& uuid);
     void notifyQueryDataUpdated(Liveness::Token alive_token, const ObjectReference& uuid, const String& oldval, const String& newval);
 
+    typedef std::tr1::function<void()> Notification;
+    typedef std::vector<Notification> NotificationList;
+    typedef std::tr1::shared_ptr<NotificationList> NotificationListPtr;
+    // Posts a notification to the strand or, if a batch is in progress, adds
+    // it to the batch. Must be called with mMutex held.
+    void postNotification(const Notification& notification, const char* tag = NULL);
+    // Delivers a batch of notifications in the strand
+    void notifyBatch(Liveness::Token alive_token, NotificationListPtr notifications);
+    // Notifies ReplicatedLocationUpdateListeners of an update and releases
+    // the object or, if a batch is being delivered, adds it to the batch and
+    // keeps it until onBatchUpdated is done. Must be called with mMutex held.
+    void notifyReplicatedUpdate(
+        ReplicatedLocationUpdateListener::BatchEntry::Type type,
+        void (ReplicatedLocationUpdateListener::*cb)(ReplicatedLocationServiceCache*, const ObjectReference&),
+        const ObjectReference& uuid);
+    // Drops the reference held for a pending notification, removing the
+    // object if it's no longer needed. Must be called with mMutex held.
+    void releaseTracking(const ObjectReference& uuid);
+
 
     ReplicatedLocationServiceCache();
 
@@ -154,6 +185,14 @@ private:
     typedef std::set<LocationUpdateListener*> ListenerSet;
     ListenerSet mListeners;
 
+    // Nesting depth of beginBatch/endBatch and the notifications collected
+    // so far in the current batch.
+    uint32 mBatchDepth;
+    NotificationListPtr mBatchedNotifications;
+    // Non-NULL while notifyBatch is delivering, collecting the updates for
+    // ReplicatedLocationUpdateListener::onBatchUpdated. Only used from mStrand.
+    ReplicatedLocationUpdateListener::Batch* mDeliveringBatch;
+
     // Object data is only accessed in the prox thread (by libprox
     // and by this class when updates are passed by the main thread).
     // Therefore, this data does *NOT* need to be locked for access.
@@ -7,6 +7,7 @@
 
 #include <sirikata/pintoloc/Platform.hpp>
 #include <sirikata/core/util/ListenerProvider.hpp>
+#include <sirikata/core/util/ObjectReference.hpp>
 
 namespace Sirikata {
 
@@ -34,6 +35,41 @@ public:
     virtual void onMeshUpdated(ReplicatedLocationServiceCache* loccache, const ObjectReference& obj) = 0;
     virtual void onPhysicsUpdated(ReplicatedLocationServiceCache* loccache, const ObjectReference& obj) = 0;
     virtual void onQueryDataUpdated(ReplicatedLocationServiceCache* loccache, const ObjectReference& obj) = 0;
+
+    // A single update in a batch, identifying which of the callbacks above
+    // it corresponds to.
+    struct BatchEntry {
+        enum Type {
+            ObjectAdded,
+            ObjectRemoved,
+            ParentUpdated,
+            EpochUpdated,
+            LocationUpdated,
+            OrientationUpdated,
+            BoundsUpdated,
+            MeshUpdated,
+            PhysicsUpdated,
+            QueryDataUpdated
+        };
+
+        BatchEntry(Type t, const ObjectReference& o)
+         : type(t), obj(o)
+        {}
+
+        Type type;
+        ObjectReference obj;
+    };
+    typedef std::vector<BatchEntry> Batch;
+
+    /** Invoked once for a group of updates that were applied together, e.g. a
+     *  bulk location update, after each of them has been delivered through the
+     *  individual callbacks above, listing them in the order they were applied.
+     *  The objects stay in the cache until this returns. Listeners can use it
+     *  to do follow-up work for the whole batch at once, e.g. a single post to
+     *  another thread, checking loccache->deliveringBatch() in the individual
+     *  callbacks to tell whether this call will follow.
+     */
+    virtual void onBatchUpdated(ReplicatedLocationServiceCache* loccache, const Batch& batch) {}
 };
 
 typedef Provider<ReplicatedLocationUpdateListener*> ReplicatedLocationUpdateProvider;
@@ -8,6 +8,8 @@
 
 #include <sirikata/core/network/Message.hpp> // parse/serializePBJMessage
 #include "Protocol_Prox.pbj.hpp"
+#include "Protocol_Loc.pbj.hpp"
+#include <sirikata/pintoloc/ProtocolLocUpdate.hpp>
 
 #include <json_spirit/json_spirit.h>
 #include <boost/lexical_cast.hpp>
@@ -295,6 +297,10 @@ void ReplicatedClient::handleProxUpdate(const Sirikata::Protocol::Prox::Proximit
 
     ReplicatedLocationServiceCachePtr loccache = getLocCache(index_unique_id);
     OrphanLocUpdateManagerPtr orphan_manager = getOrphanLocUpdateManager(index_unique_id);
+    // Deliver notifications for the entire update at once. This needs to be
+    // finished before we check whether the cache is empty below so events are
+    // all delivered before the index can be destroyed.
+    loccache->beginBatch();
     for(int32 aidx = 0; aidx < update.addition_size(); aidx++) {
         Sirikata::Protocol::Prox::ObjectAddition addition = update.addition(aidx);
         // Convert to local time
@@ -369,6 +375,7 @@ void ReplicatedClient::handleProxUpdate(const Sirikata::Protocol::Prox::Proximit
         // re-register the timeout. It's really only safe to unregister once
         // we've been told the object has been removed from the tree entirely.
     }
+    loccache->endBatch();
     RCLOG(insane, " ----- Done");
     // We may have removed everything from the specified tree. We need to
     // check if we've hit that condition and clean out any associated
@@ -432,6 +439,27 @@ void ReplicatedClient::locUpdate(const LocUpdate& update) {
 }
 void ReplicatedClient::handleLocUpdate(const CopyableLocUpdate& update) {
     SerializationCheck::Scoped sc(this);
+    dispatchLocUpdate(update, NULL);
+}
+
+void ReplicatedClient::locUpdates(const Sirikata::Protocol::Loc::BulkLocationUpdate& updates) {
+    mStrand->post(std::tr1::bind(&ReplicatedClient::handleLocUpdates, this, updates));
+}
+void ReplicatedClient::handleLocUpdates(const Sirikata::Protocol::Loc::BulkLocationUpdate& updates) {
+    SerializationCheck::Scoped sc(this);
+
+    LocCacheList batched_caches;
+    for(int32 idx = 0; idx < updates.update_size(); idx++) {
+        Sirikata::Protocol::Loc::LocationUpdate update = updates.update(idx);
+        LocProtocolLocUpdate lu(update, *mSync);
+        dispatchLocUpdate(lu, &batched_caches);
+    }
+
+    for(LocCacheList::iterator it = batched_caches.begin(); it != batched_caches.end(); it++)
+        (*it)->endBatch();
+}
+
+void ReplicatedClient::dispatchLocUpdate(const LocUpdate& update, LocCacheList* batched_caches) {
     ObjectReference observed_oref(update.object());
     // NOTE: We don't track the SpaceID here, but we also don't really need it
     // -- OrphanLocUpdateManager only uses it because it can be used in places
@@ -473,7 +501,14 @@ void ReplicatedClient::handleLocUpdate(const CopyableLocUpdate& update) {
             getOrphanLocUpdateManager(index_id)->addOrphanUpdate(observed, update);
         }
         else { // or actually applying it
-            applyLocUpdate(observed_oref, getLocCache(index_id), update);
+            ReplicatedLocationServiceCachePtr loccache = getLocCache(index_id);
+            if (batched_caches != NULL &&
+                std::find(batched_caches->begin(), batched_caches->end(), loccache) == batched_caches->end())
+            {
+                loccache->beginBatch();
+                batched_caches->push_back(loccache);
+            }
+            applyLocUpdate(observed_oref, loccache, update);
         }
     }
 }
@@ -10,6 +10,11 @@
 
 namespace Sirikata {
 
+// Upper bound on the number of unused UpdateInfos we hold on to. This is large
+// enough to absorb the bursts that follow reconnections without holding on to
+// an unbounded amount of memory afterwards.
+static const std::size_t MaxFreeUpdateInfos = 4096;
+
 OrphanLocUpdateManager::UpdateInfo::~UpdateInfo() {
     if (value != NULL)
         delete value;
@@ -25,22 +30,70 @@ OrphanLocUpdateManager::OrphanLocUpdateManager(Context* ctx, Network::IOStrand*
 
 }
 
+OrphanLocUpdateManager::~OrphanLocUpdateManager() {
+    for(ObjectUpdateMap::iterator it = mUpdates.begin(); it != mUpdates.end(); it++) {
+        for(UpdateInfoList::iterator info_it = it->second.begin(); info_it != it->second.end(); info_it++)
+            delete *info_it;
+    }
+    mUpdates.clear();
+
+    for(UpdateInfoList::iterator info_it = mFreeUpdateInfos.begin(); info_it != mFreeUpdateInfos.end(); info_it++)
+        delete *info_it;
+    mFreeUpdateInfos.clear();
+}
+
+OrphanLocUpdateManager::UpdateInfo* OrphanLocUpdateManager::allocateUpdateInfo(const SpaceObjectReference& obj) {
+    UpdateInfo* info = NULL;
+    if (mFreeUpdateInfos.empty()) {
+        info = new UpdateInfo();
+    }
+    else {
+        info = mFreeUpdateInfos.back();
+        mFreeUpdateInfos.pop_back();
+    }
+    info->object = obj;
+    info->expiresAt = mContext->simTime() + mTimeout;
+    return info;
+}
+
+void OrphanLocUpdateManager::releaseUpdateInfo(UpdateInfo* info) {
+    if (mFreeUpdateInfos.size() >= MaxFreeUpdateInfos) {
+        delete info;
+        return;
+    }
+    info->type = UpdateInfo::UNUSED;
+    mFreeUpdateInfos.push_back(info);
+}
+
+void OrphanLocUpdateManager::releaseUpdateInfos(const UpdateInfoList& infos) {
+    for(UpdateInfoList::const_iterator it = infos.begin(); it != infos.end(); it++)
+        releaseUpdateInfo(*it);
+}
+
 void OrphanLocUpdateManager::addOrphanUpdate(const SpaceObjectReference& observed, const LocUpdate& update) {
     assert( ObjectReference(update.object()) == observed.object() );
-    UpdateInfoList& info_list = mUpdates[observed];
-    info_list.push_back(
-        UpdateInfoPtr(new UpdateInfo(observed, new CopyableLocUpdate(update), mContext->simTime() + mTimeout))
-    );
+    UpdateInfo* info = allocateUpdateInfo(observed);
+    if (info->value == NULL)
+        info->value = new CopyableLocUpdate(update);
+    else
+        info->value->assign(update);
+    info->type = UpdateInfo::LOC_UPDATE;
+
+    mUpdates[observed].push_back(info);
 }
 
 void OrphanLocUpdateManager::addUpdateFromExisting(
     const SpaceObjectReference& observed,
     const SequencedPresenceProperties& props
 ) {
-    UpdateInfoList& info_list = mUpdates[observed];
+    UpdateInfo* info = allocateUpdateInfo(observed);
+    if (info->opd == NULL)
+        info->opd = new SequencedPresenceProperties(props);
+    else
+        *(info->opd) = props;
+    info->type = UpdateInfo::PROPERTIES;
 
-    SequencedPresenceProperties* opd = new SequencedPresenceProperties(props);
-    info_list.push_back( UpdateInfoPtr(new UpdateInfo(observed, opd, mContext->simTime() + mTimeout)) );
+    mUpdates[observed].push_back(info);
 }
 
 void OrphanLocUpdateManager::addUpdateFromExisting(ProxyObjectPtr proxyPtr) {
@@ -55,9 +108,13 @@ void OrphanLocUpdateManager::poll() {
     // Scan through all updates looking for outdated ones
     for(ObjectUpdateMap::iterator it = mUpdates.begin(); it != mUpdates.end(); ) {
         UpdateInfoList& info_list = it->second;
-        while(!info_list.empty() && (*info_list.begin())->expiresAt < now) {
-            info_list.erase(info_list.begin());
+        // Entries are added in order, so expired ones are all at the front
+        UpdateInfoList::iterator expired_end = info_list.begin();
+        while(expired_end != info_list.end() && (*expired_end)->expiresAt < now) {
+            releaseUpdateInfo(*expired_end);
+            expired_end++;
         }
+        info_list.erase(info_list.begin(), expired_end);
 
         ObjectUpdateMap::iterator next_it = it;
         next_it++;
@@ -13,6 +13,9 @@ ReplicatedLocationServiceCache::ReplicatedLocationServiceCache(Network::IOStrand
  : ExtendedLocationServiceCache(),
    mStrand(strand.get()),
    mListeners(),
+   mBatchDepth(0),
+   mBatchedNotifications(),
+   mDeliveringBatch(NULL),
    mObjects()
 {
 }
@@ -20,6 +23,9 @@ ReplicatedLocationServiceCache::ReplicatedLocationServiceCache(Network::IOStrand
  : ExtendedLocationServiceCache(),
    mStrand(strand),
    mListeners(),
+   mBatchDepth(0),
+   mBatchedNotifications(),
+   mDeliveringBatch(NULL),
    mObjects()
 {
 }
@@ -274,7 +280,7 @@ void ReplicatedLocationServiceCache::objectAdded(
 
 
     it->second.tracking++;
-    mStrand->post(
+    postNotification(
         std::tr1::bind(
             &ReplicatedLocationServiceCache::notifyObjectAdded, this,
             livenessToken(),
@@ -299,11 +305,7 @@ void ReplicatedLocationServiceCache::notifyObjectAdded(
     for(ListenerSet::iterator listener_it = mListeners.begin(); listener_it != mListeners.end(); listener_it++)
         (*listener_it)->locationConnectedWithParent(uuid, parent, agg, true, loc, bounds.centerBounds(), bounds.maxObjectRadius);
 
-    ReplicatedLocationUpdateProvider::notify(&ReplicatedLocationUpdateListener::onObjectAdded, this, uuid);
-
-    ObjectDataMap::iterator obj_it = mObjects.find(uuid);
-    obj_it->second.tracking--;
-    tryRemoveObject(obj_it);
+    notifyReplicatedUpdate(ReplicatedLocationUpdateListener::BatchEntry::ObjectAdded, &ReplicatedLocationUpdateListener::onObjectAdded, uuid);
 }
 
 void ReplicatedLocationServiceCache::objectRemoved(const ObjectReference& uuid, bool temporary) {
@@ -317,7 +319,7 @@ void ReplicatedLocationServiceCache::objectRemoved(const ObjectReference& uuid,
     bool agg = data_it->second.aggregate;
 
     data_it->second.tracking++;
-    mStrand->post(
+    postNotification(
         std::tr1::bind(
             &ReplicatedLocationServiceCache::notifyObjectRemoved, this,
             livenessToken(),
@@ -336,11 +338,7 @@ void ReplicatedLocationServiceCache::notifyObjectRemoved(Liveness::Token alive_t
     for(ListenerSet::iterator listener_it = mListeners.begin(); listener_it != mListeners.end(); listener_it++)
         (*listener_it)->locationDisconnected(uuid, temporary);
 
-    ReplicatedLocationUpdateProvider::notify(&ReplicatedLocationUpdateListener::onObjectRemoved, this, uuid);
-
-    ObjectDataMap::iterator obj_it = mObjects.find(uuid);
-    obj_it->second.tracking--;
-    tryRemoveObject(obj_it);
+    notifyReplicatedUpdate(ReplicatedLocationUpdateListener::BatchEntry::ObjectRemoved, &ReplicatedLocationUpdateListener::onObjectRemoved, uuid);
 }
 
 void ReplicatedLocationServiceCache::epochUpdated(const ObjectReference& uuid, const uint64 ep) {
@@ -354,7 +352,7 @@ void ReplicatedLocationServiceCache::epochUpdated(const ObjectReference& uuid, c
     bool agg = it->second.aggregate;
 
     it->second.tracking++;
-    mStrand->post(
+    postNotification(
         std::tr1::bind(
             &ReplicatedLocationServiceCache::notifyEpochUpdated, this,
             livenessToken(),
@@ -370,11 +368,7 @@ void ReplicatedLocationServiceCache::notifyEpochUpdated(Liveness::Token alive_to
 
     Lock lck(mMutex);
 
-    ReplicatedLocationUpdateProvider::notify(&ReplicatedLocationUpdateListener::onEpochUpdated, this, uuid);
-
-    ObjectDataMap::iterator obj_it = mObjects.find(uuid);
-    obj_it->second.tracking--;
-    tryRemoveObject(obj_it);
+    notifyReplicatedUpdate(ReplicatedLocationUpdateListener::BatchEntry::EpochUpdated, &ReplicatedLocationUpdateListener::onEpochUpdated, uuid);
 }
 
 void ReplicatedLocationServiceCache::locationUpdated(const ObjectReference& uuid, const TimedMotionVector3f& newval, uint64 seqno) {
@@ -389,7 +383,7 @@ void ReplicatedLocationServiceCache::locationUpdated(const ObjectReference& uuid
     bool agg = it->second.aggregate;
 
     it->second.tracking++;
-    mStrand->post(
+    postNotification(
         std::tr1::bind(
             &ReplicatedLocationServiceCache::notifyLocationUpdated, this,
             livenessToken(),
@@ -408,11 +402,7 @@ void ReplicatedLocationServiceCache::notifyLocationUpdated(Liveness::Token alive
     for(ListenerSet::iterator listener_it = mListeners.begin(); listener_it != mListeners.end(); listener_it++)
         (*listener_it)->locationPositionUpdated(uuid, oldval, newval);
 
-    ReplicatedLocationUpdateProvider::notify(&ReplicatedLocationUpdateListener::onLocationUpdated, this, uuid);
-
-    ObjectDataMap::iterator obj_it = mObjects.find(uuid);
-    obj_it->second.tracking--;
-    tryRemoveObject(obj_it);
+    notifyReplicatedUpdate(ReplicatedLocationUpdateListener::BatchEntry::LocationUpdated, &ReplicatedLocationUpdateListener::onLocationUpdated, uuid);
 }
 
 void ReplicatedLocationServiceCache::orientationUpdated(const ObjectReference& uuid, const TimedMotionQuaternion& newval, uint64 seqno) {
@@ -426,7 +416,7 @@ void ReplicatedLocationServiceCache::orientationUpdated(const ObjectReference& u
     bool agg = it->second.aggregate;
 
     it->second.tracking++;
-    mStrand->post(
+    postNotification(
         std::tr1::bind(
             &ReplicatedLocationServiceCache::notifyOrientationUpdated, this, livenessToken(), uuid
         )
@@ -439,11 +429,7 @@ void ReplicatedLocationServiceCache::notifyOrientationUpdated(Liveness::Token al
 
     Lock lck(mMutex);
 
-    ReplicatedLocationUpdateProvider::notify(&ReplicatedLocationUpdateListener::onOrientationUpdated, this, uuid);
-
-    ObjectDataMap::iterator obj_it = mObjects.find(uuid);
-    obj_it->second.tracking--;
-    tryRemoveObject(obj_it);
+    notifyReplicatedUpdate(ReplicatedLocationUpdateListener::BatchEntry::OrientationUpdated, &ReplicatedLocationUpdateListener::onOrientationUpdated, uuid);
 }
 
 void ReplicatedLocationServiceCache::boundsUpdated(const ObjectReference& uuid, const AggregateBoundingInfo& newval, uint64 seqno) {
@@ -458,7 +444,7 @@ void ReplicatedLocationServiceCache::boundsUpdated(const ObjectReference& uuid,
     bool agg = it->second.aggregate;
 
     it->second.tracking++;
-    mStrand->post(
+    postNotification(
         std::tr1::bind(
             &ReplicatedLocationServiceCache::notifyBoundsUpdated, this,
             livenessToken(),
@@ -479,11 +465,7 @@ void ReplicatedLocationServiceCache::notifyBoundsUpdated(Liveness::Token alive_t
         (*listen_it)->locationMaxSizeUpdated(uuid, oldval.maxObjectRadius, newval.maxObjectRadius);
     }
 
-    ReplicatedLocationUpdateProvider::notify(&ReplicatedLocationUpdateListener::onBoundsUpdated, this, uuid);
-
-    ObjectDataMap::iterator obj_it = mObjects.find(uuid);
-    obj_it->second.tracking--;
-    tryRemoveObject(obj_it);
+    notifyReplicatedUpdate(ReplicatedLocationUpdateListener::BatchEntry::BoundsUpdated, &ReplicatedLocationUpdateListener::onBoundsUpdated, uuid);
 }
 
 void ReplicatedLocationServiceCache::meshUpdated(const ObjectReference& uuid, const Transfer::URI& newval, uint64 seqno) {
@@ -497,7 +479,7 @@ void ReplicatedLocationServiceCache::meshUpdated(const ObjectReference& uuid, co
     bool agg = it->second.aggregate;
 
     it->second.tracking++;
-    mStrand->post(
+    postNotification(
         std::tr1::bind(
             &ReplicatedLocationServiceCache::notifyMeshUpdated, this, livenessToken(), uuid
         )
@@ -510,11 +492,7 @@ void ReplicatedLocationServiceCache::notifyMeshUpdated(Liveness::Token alive_tok
 
     Lock lck(mMutex);
 
-    ReplicatedLocationUpdateProvider::notify(&ReplicatedLocationUpdateListener::onMeshUpdated, this, uuid);
-
-    ObjectDataMap::iterator obj_it = mObjects.find(uuid);
-    obj_it->second.tracking--;
-    tryRemoveObject(obj_it);
+    notifyReplicatedUpdate(ReplicatedLocationUpdateListener::BatchEntry::MeshUpdated, &ReplicatedLocationUpdateListener::onMeshUpdated, uuid);
 }
 
 void ReplicatedLocationServiceCache::physicsUpdated(const ObjectReference& uuid, const String& newval, uint64 seqno) {
@@ -528,7 +506,7 @@ void ReplicatedLocationServiceCache::physicsUpdated(const ObjectReference& uuid,
     bool agg = it->second.aggregate;
 
     it->second.tracking++;
-    mStrand->post(
+    postNotification(
         std::tr1::bind(
             &ReplicatedLocationServiceCache::notifyPhysicsUpdated, this, livenessToken(), uuid
         )
@@ -541,11 +519,7 @@ void ReplicatedLocationServiceCache::notifyPhysicsUpdated(Liveness::Token alive_
 
     Lock lck(mMutex);
 
-    ReplicatedLocationUpdateProvider::notify(&ReplicatedLocationUpdateListener::onPhysicsUpdated, this, uuid);
-
-    ObjectDataMap::iterator obj_it = mObjects.find(uuid);
-    obj_it->second.tracking--;
-    tryRemoveObject(obj_it);
+    notifyReplicatedUpdate(ReplicatedLocationUpdateListener::BatchEntry::PhysicsUpdated, &ReplicatedLocationUpdateListener::onPhysicsUpdated, uuid);
 }
 
 void ReplicatedLocationServiceCache::queryDataUpdated(const ObjectReference& uuid, const String& newval, uint64 seqno) {
@@ -559,7 +533,7 @@ void ReplicatedLocationServiceCache::queryDataUpdated(const ObjectReference& uui
     bool agg = it->second.aggregate;
 
     it->second.tracking++;
-    mStrand->post(
+    postNotification(
         std::tr1::bind(
             &ReplicatedLocationServiceCache::notifyQueryDataUpdated, this, livenessToken(), uuid, oldval, newval
         )
@@ -576,11 +550,7 @@ void ReplicatedLocationServiceCache::notifyQueryDataUpdated(Liveness::Token aliv
         (*listen_it)->locationQueryDataUpdated(uuid, oldval, newval);
     }
 
-    ReplicatedLocationUpdateProvider::notify(&ReplicatedLocationUpdateListener::onQueryDataUpdated, this, uuid);
-
-    ObjectDataMap::iterator obj_it = mObjects.find(uuid);
-    obj_it->second.tracking--;
-    tryRemoveObject(obj_it);
+    notifyReplicatedUpdate(ReplicatedLocationUpdateListener::BatchEntry::QueryDataUpdated, &ReplicatedLocationUpdateListener::onQueryDataUpdated, uuid);
 }
 
 void ReplicatedLocationServiceCache::parentUpdated(const ObjectReference& uuid, const ObjectReference& newval, uint64 seqno) {
@@ -594,7 +564,7 @@ void ReplicatedLocationServiceCache::parentUpdated(const ObjectReference& uuid,
     bool agg = it->second.aggregate;
 
     it->second.tracking++;
-    mStrand->post(
+    postNotification(
         std::tr1::bind(
             &ReplicatedLocationServiceCache::notifyParentUpdated, this, livenessToken(), uuid, oldval, newval
         )
@@ -610,8 +580,83 @@ void ReplicatedLocationServiceCache::notifyParentUpdated(Liveness::Token alive_t
     for(ListenerSet::iterator listener_it = mListeners.begin(); listener_it != mListeners.end(); listener_it++)
         (*listener_it)->locationParentUpdated(uuid, oldval, newval);
 
-    ReplicatedLocationUpdateProvider::notify(&ReplicatedLocationUpdateListener::onParentUpdated, this, uuid);
+    notifyReplicatedUpdate(ReplicatedLocationUpdateListener::BatchEntry::ParentUpdated, &ReplicatedLocationUpdateListener::onParentUpdated, uuid);
+}
+
+
+void ReplicatedLocationServiceCache::beginBatch() {
+    Lock lck(mMutex);
+
+    if (mBatchDepth == 0)
+        mBatchedNotifications = NotificationListPtr(new NotificationList());
+    mBatchDepth++;
+}
+
+void ReplicatedLocationServiceCache::endBatch() {
+    Lock lck(mMutex);
+
+    assert(mBatchDepth > 0);
+    mBatchDepth--;
+    if (mBatchDepth > 0) return;
+
+    NotificationListPtr notifications = mBatchedNotifications;
+    mBatchedNotifications.reset();
+    if (notifications->empty()) return;
+    mStrand->post(
+        std::tr1::bind(
+            &ReplicatedLocationServiceCache::notifyBatch, this,
+            livenessToken(), notifications
+        ),
+        "ReplicatedLocationServiceCache::notifyBatch"
+    );
+}
+
+void ReplicatedLocationServiceCache::postNotification(const Notification& notification, const char* tag) {
+    if (mBatchDepth > 0)
+        mBatchedNotifications->push_back(notification);
+    else
+        mStrand->post(notification, tag);
+}
+
+void ReplicatedLocationServiceCache::notifyBatch(Liveness::Token alive_token, NotificationListPtr notifications) {
+    Liveness::Lock alive(alive_token);
+    if (!alive) return;
+
+    // Each notification handles its own locking and notifies all listeners
+    // just like it would outside a batch, so they see the same order of
+    // events. Updates are also collected for onBatchUpdated and the objects
+    // stay tracked until it has been delivered.
+    ReplicatedLocationUpdateListener::Batch batch;
+    mDeliveringBatch = &batch;
+    for(NotificationList::iterator it = notifications->begin(); it != notifications->end(); it++)
+        (*it)();
+    mDeliveringBatch = NULL;
+
+    if (batch.empty()) return;
+
+    // Listeners get the batch without the lock held so they can call into
+    // other services without worrying about lock ordering with this one.
+    ReplicatedLocationUpdateProvider::notify(&ReplicatedLocationUpdateListener::onBatchUpdated, this, batch);
+
+    Lock lck(mMutex);
+    for(ReplicatedLocationUpdateListener::Batch::const_iterator it = batch.begin(); it != batch.end(); it++)
+        releaseTracking(it->obj);
+}
+
+void ReplicatedLocationServiceCache::notifyReplicatedUpdate(
+    ReplicatedLocationUpdateListener::BatchEntry::Type type,
+    void (ReplicatedLocationUpdateListener::*cb)(ReplicatedLocationServiceCache*, const ObjectReference&),
+    const ObjectReference& uuid)
+{
+    ReplicatedLocationUpdateProvider::notify(cb, this, uuid);
+
+    if (mDeliveringBatch != NULL)
+        mDeliveringBatch->push_back(ReplicatedLocationUpdateListener::BatchEntry(type, uuid));
+    else
+        releaseTracking(uuid);
+}
 
+void ReplicatedLocationServiceCache::releaseTracking(const ObjectReference& uuid) {
     ObjectDataMap::iterator obj_it = mObjects.find(uuid);
     obj_it->second.tracking--;
     tryRemoveObject(obj_it);
@@ -40,6 +40,7 @@
 #include <sirikata/core/util/PresenceProperties.hpp>
 
 #include <sirikata/core/util/SerializationCheck.hpp>
+#include <boost/thread/mutex.hpp>
 
 namespace Sirikata {
 
@@ -75,6 +76,12 @@ public:
     ///Removes from internal ProxyObject map, calls destruction listeners, and calls newObj->destroy().
     virtual void destroyObject(const ProxyObjectPtr &newObj);
 
+    /** Prepare for up to count new proxies, e.g. before handling a large batch
+     *  of proximity additions, so creating them doesn't repeatedly grow the
+     *  proxy map or allocate proxies one at a time.
+     */
+    void reserve(uint32 count);
+
     /// Get the number of proxies held by this ProxyManager
     int32 size();
     /// Get the number of proxies held by this ProxyManager that are active,
@@ -108,6 +115,26 @@ private:
     // addition will continue to receive updates).
     void proxyDeleted(const ObjectReference& id);
 
+    // ProxyObjects are allocated from a pool owned by their ProxyManager since
+    // they are created and destroyed in large batches as query results
+    // change. Memory is only returned when the ProxyManager is destroyed,
+    // which can't happen until all its ProxyObjects are gone since they hold
+    // references to it.
+    void* allocateProxy();
+    void releaseProxy(void* mem);
+    // Ensure at least count blocks are available without locking
+    void reserveProxiesLocked(uint32 count);
+    // Deleter for pooled ProxyObjects. Holds a reference to the ProxyManager
+    // until the memory is back in the pool.
+    struct ProxyDeleter {
+        ProxyDeleter(ProxyManagerPtr _owner)
+         : owner(_owner)
+        {}
+        void operator()(ProxyObject* obj) const;
+
+        mutable ProxyManagerPtr owner;
+    };
+
     // Parent HostedObject
     VWObjectPtr mParent;
     // Presence identifier that runs this ProxyManager
@@ -128,6 +155,12 @@ private:
     // this when you have a large number of aggregates is expensive (requires
     // scanning through all entries).
     uint32 mActiveCount;
+
+    // Proxies can be released from other threads (e.g. by scripts), so the
+    // pool is protected separately from the rest of the ProxyManager
+    boost::mutex mProxyPoolMutex;
+    std::vector<void*> mFreeProxies;
+    std::vector<char*> mProxyChunks;
 };
 
 typedef std::tr1::shared_ptr<ProxyManager> ProxyManagerPtr;
@@ -42,6 +42,9 @@
 // properly protected by callers.
 #define PROXYMAN_SERIALIZED() SerializationCheck::Scoped ___proxy_manager_serialization_check(const_cast<ProxyManager*>(this))
 
+// Number of ProxyObjects allocated at once when the pool runs dry
+#define PROXY_POOL_CHUNK_SIZE 64
+
 namespace Sirikata {
 
 ProxyManagerPtr ProxyManager::construct(VWObjectPtr parent, const SpaceObjectReference& _id) {
@@ -57,6 +60,13 @@ ProxyManager::ProxyManager(VWObjectPtr parent, const SpaceObjectReference& _id)
 
 ProxyManager::~ProxyManager() {
     destroy();
+
+    // All the proxies hold references to us, so by now they're all back in
+    // the pool
+    for(std::vector<char*>::iterator it = mProxyChunks.begin(); it != mProxyChunks.end(); it++)
+        ::operator delete(*it);
+    mProxyChunks.clear();
+    mFreeProxies.clear();
 }
 
 void ProxyManager::initialize() {
@@ -179,6 +189,51 @@ void ProxyManager::destroyObject(const ProxyObjectPtr &delObj) {
     }
 }
 
+void ProxyManager::reserve(uint32 count) {
+    PROXYMAN_SERIALIZED();
+
+    mProxyMap.rehash( (std::size_t)((mProxyMap.size() + count) / mProxyMap.max_load_factor()) + 1 );
+
+    boost::mutex::scoped_lock lock(mProxyPoolMutex);
+    reserveProxiesLocked(count);
+}
+
+void ProxyManager::reserveProxiesLocked(uint32 count) {
+    if (mFreeProxies.size() >= count)
+        return;
+
+    uint32 needed = count - mFreeProxies.size();
+    uint32 chunk_count = std::max(needed, (uint32)PROXY_POOL_CHUNK_SIZE);
+    char* chunk = static_cast<char*>(::operator new(chunk_count * sizeof(ProxyObject)));
+    mProxyChunks.push_back(chunk);
+    mFreeProxies.reserve(mFreeProxies.size() + chunk_count);
+    // Push in reverse so they're handed out in address order
+    for(uint32 i = chunk_count; i > 0; i--)
+        mFreeProxies.push_back(chunk + (i-1) * sizeof(ProxyObject));
+}
+
+void* ProxyManager::allocateProxy() {
+    boost::mutex::scoped_lock lock(mProxyPoolMutex);
+    reserveProxiesLocked(1);
+    void* mem = mFreeProxies.back();
+    mFreeProxies.pop_back();
+    return mem;
+}
+
+void ProxyManager::releaseProxy(void* mem) {
+    boost::mutex::scoped_lock lock(mProxyPoolMutex);
+    mFreeProxies.push_back(mem);
+}
+
+void ProxyManager::ProxyDeleter::operator()(ProxyObject* obj) const {
+    // Keep the ProxyManager alive until the memory is back in its pool: the
+    // proxy's own reference goes away with it.
+    ProxyManagerPtr man;
+    man.swap(owner);
+    obj->~ProxyObject();
+    man->releaseProxy(obj);
+}
+
 void ProxyManager::proxyDeleted(const ObjectReference& id) {
     PROXYMAN_SERIALIZED();
 
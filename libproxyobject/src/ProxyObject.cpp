@@ -48,7 +48,9 @@
 namespace Sirikata {
 
 ProxyObjectPtr ProxyObject::construct(ProxyManagerPtr man, const SpaceObjectReference& id) {
-    ProxyObjectPtr res(SelfWeakPtr<ProxyObject>::internalConstruct(new ProxyObject(man, id)));
+    // Storage comes from the owning ProxyManager's pool
+    ProxyObject* obj = new (man->allocateProxy()) ProxyObject(man, id);
+    ProxyObjectPtr res(SelfWeakPtr<ProxyObject>::internalConstruct(obj, ProxyManager::ProxyDeleter(man)));
     res->validate();
     return res;
 }
@@ -9,6 +9,7 @@
 #include <sirikata/core/util/MotionVector.hpp>
 #include <sirikata/core/util/MotionQuaternion.hpp>
 #include <sirikata/core/util/AggregateBoundingInfo.hpp>
+#include <sirikata/core/util/InternedString.hpp>
 #include <sirikata/space/ServerMessage.hpp>
 #include <sirikata/core/service/PollingService.hpp>
 
@@ -63,6 +64,35 @@ public:
 
     // Hooks for raw updates received by the LocationService
     virtual void onLocationUpdateFromServer(const ServerID sid, const Sirikata::Protocol::Loc::LocationUpdate& update) {}
+
+
+    // Batched motion updates. Listeners registered with batched = true don't
+    // receive the individual {local,replica}{Location,Orientation,Bounds}Updated
+    // calls. Instead, those updates are collected and delivered once per
+    // LocationService tick, with all the updates to a single object during the
+    // tick coalesced into one entry. Pending updates for an object are
+    // flushed before any other event for it (additions, removals, mesh
+    // updates, etc.) is delivered, so the ordering of events for each object
+    // is preserved.
+
+    // Flags indicating which fields of a MotionUpdate are valid
+    enum MotionField {
+        MOTION_LOCATION = 1,
+        MOTION_ORIENTATION = 2,
+        MOTION_BOUNDS = 4
+    };
+    struct MotionUpdate {
+        UUID uuid;
+        bool local;
+        bool agg;
+        uint8 changed; // MotionField mask
+        TimedMotionVector3f location;
+        TimedMotionQuaternion orientation;
+        AggregateBoundingInfo bounds;
+    };
+    typedef std::vector<MotionUpdate> MotionUpdateList;
+
+    virtual void motionUpdated(const MotionUpdateList& updates) {}
 }; // class LocationServiceListener
 
 
@@ -228,6 +258,22 @@ public:
     virtual const String& physics(const UUID& uuid) = 0;
     virtual const String& queryData(const UUID& uuid) = 0;
 
+    /** Interned versions of mesh(), physics() and queryData(). Many objects
+     *  share the same values, so listeners which need to hold on to them
+     *  should store these handles rather than copies of the strings. The
+     *  default implementations intern the values returned by the String
+     *  accessors; implementations which store handles internally should
+     *  override them to return their handles directly.
+     */
+    virtual InternedString meshHandle(const UUID& uuid) { return intern(mesh(uuid)); }
+    virtual InternedString physicsHandle(const UUID& uuid) { return intern(physics(uuid)); }
+    virtual InternedString queryDataHandle(const UUID& uuid) { return intern(queryData(uuid)); }
+    /** Get a handle for an arbitrary value from this LocationService's string
+     *  table, e.g. for a value passed to a LocationServiceListener. This is
+     *  thread safe.
+     */
+    InternedString intern(const String& val) { return mInternedStrings.intern(val); }
+
     /** Methods dealing with local objects. */
     virtual void addLocalObject(const UUID& uuid, const TimedMotionVector3f& loc, const TimedMotionQuaternion& orient, const AggregateBoundingInfo& bounds, const String& mesh, const String& physics, const String& query_data) = 0;
     virtual void removeLocalObject(const UUID& uuid, const std::tr1::function<void()>&completeCallback) = 0;
@@ -253,8 +299,12 @@ public:
     virtual void addReplicaObject(const Time& t, const UUID& uuid, bool agg, const TimedMotionVector3f& loc, const TimedMotionQuaternion& orient, const AggregateBoundingInfo& bounds, const String& mesh, const String& physics, const String& query_data) = 0;
     virtual void removeReplicaObject(const Time& t, const UUID& uuid) = 0;
 
-    /** Methods dealing with listeners. */
-    virtual void addListener(LocationServiceListener* listener, bool want_aggregates);
+    /** Methods dealing with listeners. If batched is true, the listener
+     *  receives location, orientation and bounds updates through
+     *  LocationServiceListener::motionUpdated once per tick instead of one
+     *  call per update.
+     */
+    virtual void addListener(LocationServiceListener* listener, bool want_aggregates, bool batched = false);
     virtual void removeListener(LocationServiceListener* listener);
 
     /** Subscriptions for other servers. */
@@ -322,6 +372,15 @@ protected:
 
     void notifyOnLocationUpdateFromServer(const ServerID sid, const Sirikata::Protocol::Loc::LocationUpdate& update);
 
+    // Get the pending batched update for the object, adding a new one if
+    // necessary.
+    LocationServiceListener::MotionUpdate& pendingMotionUpdate(const UUID& uuid, bool local, bool agg) const;
+    // Deliver pending batched updates to batched listeners. The second version
+    // only flushes if there is an update pending for the given object, and
+    // should be called before delivering any other event for it.
+    void flushMotionUpdates() const;
+    void flushMotionUpdates(const UUID& uuid) const;
+
     // Helpers for listening to streams
     typedef ODPSST::StreamPtr SSTStreamPtr;
     void handleLocationUpdateSubstream(const UUID& source, int err, SSTStreamPtr s);
@@ -329,17 +388,26 @@ protected:
     void tryHandleLocationUpdate(const UUID& source, SSTStreamPtr s, const String& payload, std::stringstream* prevdata);
 
     SpaceContext* mContext;
+    // Shared storage for mesh, physics and query data strings
+    InternedStringTable mInternedStrings;
 private:
     TimeProfiler::Stage* mProfiler;
 protected:
     struct ListenerInfo {
         LocationServiceListener* listener;
         bool wantAggregates;
+        bool batched;
 
         bool operator<(const ListenerInfo& rhs) const { return listener < rhs.listener; }
     };
     typedef std::set<ListenerInfo> ListenerList;
     ListenerList mListeners;
+    uint32 mBatchedListenerCount;
+    // Motion updates waiting to be delivered to batched listeners, and the
+    // index of each object's entry for coalescing.
+    typedef std::tr1::unordered_map<UUID, uint32, UUID::Hasher> MotionUpdateIndex;
+    mutable LocationServiceListener::MotionUpdateList mPendingMotionUpdates;
+    mutable MotionUpdateIndex mPendingMotionUpdateIndex;
 
     LocationUpdatePolicy* mUpdatePolicy;
 }; // class LocationService
@@ -136,6 +136,8 @@ private:
 
     // Handle async reading callbacks for this connection
     void handleConnectionRead(ObjectHostConnection* conn, Sirikata::Network::Chunk& chunk, const Sirikata::Network::Stream::PauseReceiveCallback& pause);
+    // Parse and deliver a single message, which may have been part of a batch
+    void handleObjectHostMessageData(ObjectHostConnection* conn, MemoryReference data);
 
     bool sendHelper(ObjectHostConnection* conn, Sirikata::Protocol::Object::ObjectMessage* msg);
 
@@ -127,11 +127,14 @@ protected:
     Network::IOStrand* oStrand;
 
     Router<Message*>* mOSegServerMessageService;
-    // This queue handles outgoing migration ack messages, getting them safely
-    // into the outgoing queue. Implementations only need to call queueMigAck()
-    // from any other thread to get messages sent.
-    Sirikata::ThreadSafeQueueWithNotification<Message*> mMigAckMessages;
-    Message* mFrontMigAck;
+    // This queue handles outgoing migration acks, getting them safely into the
+    // outgoing queue. Implementations only need to call queueMigAck() from any
+    // other thread to get messages sent. In the main strand, acks are
+    // converted to messages, grouping acks for the same server into bulk
+    // messages if enabled, and held in mMigAckMessages until they can be sent.
+    Sirikata::ThreadSafeQueueWithNotification<Sirikata::Protocol::OSeg::MigrateMessageAcknowledge*> mMigAcks;
+    std::deque<Message*> mMigAckMessages;
+    bool mBulkMigAcks;
     void queueMigAck(const Sirikata::Protocol::OSeg::MigrateMessageAcknowledge& msg);
     void trySendMigAcks();
     void handleNewMigAckMessages();
@@ -164,6 +167,13 @@ public:
           mWriteListener = listener;
       }
 
+      /** Enable or disable grouping migration acks destined for the same
+       *  server into a single message. Servers always accept both forms.
+       */
+      void setBulkMigrationAcks(bool bulk) {
+          mBulkMigAcks = bulk;
+      }
+
       
     virtual OSegEntry lookup(const UUID& obj_id) = 0;
     virtual OSegEntry cacheLookup(const UUID& obj_id) = 0;
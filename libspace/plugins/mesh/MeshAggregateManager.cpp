@@ -73,6 +73,10 @@
 
 #define AGG_LOG(lvl, msg) SILOG(aggregate-manager, lvl, msg)
 
+// Texture atlas layouts are kept here between regenerations of an aggregate,
+// since each aggregate's working directory is removed after it's uploaded.
+#define ATLAS_CACHE_DIR "/tmp/sirikata/atlas-cache"
+
 using namespace std::tr1::placeholders;
 using namespace Sirikata::Transfer;
 using namespace Sirikata::Mesh;
@@ -647,6 +651,12 @@ MeshAggregateManager::~MeshAggregateManager() {
       delete mUploadThreads[i];
     }
 
+    // Generation has stopped, so drop the cached atlases for the aggregates
+    // that are still around rather than leaving them behind in /tmp.
+    for (std::tr1::unordered_map<UUID, AggregateObjectPtr, UUID::Hasher >::iterator it = mAggregateObjects.begin();
+         it != mAggregateObjects.end(); it++)
+      removeAtlasCacheEntries(it->first);
+
     delete mCenteringFilter;
     //Delete the model system.
     delete mModelsSystem;
@@ -770,6 +780,21 @@ void MeshAggregateManager::removeAggregate(const UUID& uuid) {
     cleanUpChild(uuid, (*child_it)->mUUID);
 
   mAggregateObjects.erase(uuid);
+
+  removeAtlasCacheEntries(uuid);
+}
+
+void MeshAggregateManager::removeAtlasCacheEntries(const UUID& uuid) {
+  // Named the way TextureAtlasFilter names them, after the aggregate's mesh
+  // file, see textureChunkFinished.
+  String prefix = String(ATLAS_CACHE_DIR) + "/" + uuid.toString() + ".dae.atlas";
+  try {
+    boost::filesystem::remove(prefix + ".png");
+    boost::filesystem::remove(prefix + ".layout");
+  }
+  catch (boost::filesystem::filesystem_error&) {
+    AGG_LOG(warn, "Couldn't remove cached atlas for " << uuid.toString());
+  }
 }
 
 void MeshAggregateManager::addChild(const UUID& uuid, const UUID& child_uuid) {
@@ -1243,6 +1268,7 @@ void MeshAggregateManager::startDownloadsForAtlasing(const UUID& uuid, MeshdataP
     {
       boost::mutex::scoped_lock modelSystemLock(mModelsSystemMutex);
       boost::filesystem::create_directories( "/tmp/sirikata/"+uuid.toString()+".dir");
+      boost::filesystem::create_directories(ATLAS_CACHE_DIR);
       bool converted = mModelsSystem->convertVisual( agg_mesh, "colladamodels", "/tmp/sirikata/"+uuid.toString()+".dir/"+uuid.toString()+".dae");
     }
     std::vector<ResourceDownloadTaskPtr> downloadTasks;
@@ -1914,6 +1940,22 @@ uint32 MeshAggregateManager::generateAggregateMeshAsync(const UUID uuid, Time po
     mMeshSimplifier.simplify(agg_mesh, NUM_SIMPLIFIED_FACES, instanceToBBoxMap);
   }
 
+  // Clients draw the aggregate as-is, so reorder it for the vertex cache and
+  // drop any vertices simplification left unused.
+  if (Mesh::FilterFactory::getSingleton().hasConstructor("optimize-vertex-cache")) {
+    std::vector<String> names_and_args;
+    names_and_args.push_back("optimize-vertex-cache"); names_and_args.push_back("");
+
+    Sirikata::Mesh::Filter* vertexCacheFilter = new Mesh::CompositeFilter(names_and_args);
+
+    Mesh::MutableFilterDataPtr input_data(new Mesh::FilterData);
+    input_data->push_back(agg_mesh);
+    Mesh::FilterDataPtr output_data = vertexCacheFilter->apply(input_data);
+    agg_mesh = std::tr1::dynamic_pointer_cast<Mesh::Meshdata> (output_data->get());
+
+    delete vertexCacheFilter;
+  }
+
   AGG_LOG(insane, agg_mesh->nodes.size() << " -- " << agg_mesh->rootNodes.size() << " nodes");
 
   //Set the mesh of this aggregate to the empty string until the new version gets uploaded. This is so that
@@ -2171,7 +2213,9 @@ void MeshAggregateManager::textureChunkFinished(String texname, Transfer::Finger
       // ok, now do the atlasing.
       std::vector<String> names_and_args;
       names_and_args.push_back("texture-atlas");
-      names_and_args.push_back(""/*serializeHashToURIMap(hashToURIMap)*/);
+      // Keep atlas layouts around between regenerations of an aggregate so
+      // textures from unchanged children can keep their place in the atlas.
+      names_and_args.push_back("--incremental=true --cache-dir=" + String(ATLAS_CACHE_DIR));
       std::tr1::shared_ptr<Mesh::CompositeFilter> atlasingFilter =
 	        std::tr1::shared_ptr<Mesh::CompositeFilter>(new Mesh::CompositeFilter(names_and_args));
       Mesh::MutableFilterDataPtr input_data(new Mesh::FilterData);
@@ -405,6 +405,9 @@ private:
   void setAggregatesTriangleCount();
   //void setChildrensTriangleCount(AggregateObjectPtr aggObj);
   String serializeHashToURIMap(std::tr1::shared_ptr<std::tr1::unordered_map<String, std::vector<String> > > hashToURIMap);
+  // Removes the atlas layout and atlas copy kept for an aggregate's
+  // incremental atlasing once the aggregate goes away.
+  void removeAtlasCacheEntries(const UUID& uuid);
 
   //FIXME: meshDiff and mObservers are for experiemental puirposes only.
   float meshDiff(const UUID& uuid, std::tr1::shared_ptr<Mesh::Meshdata> md1, std::tr1::shared_ptr<Mesh::Meshdata> md2);
@@ -17,7 +17,7 @@ BulletCharacterObject::BulletCharacterObject(BulletPhysicsService* parent, const
    mBBox(bb),
    mGhostObject(NULL),
    mCharacter(NULL),
-   mCollisionShape(NULL)
+   mCollisionShape()
 {
     if (mBBox != BULLET_OBJECT_BOUNDS_SPHERE &&
         mBBox != BULLET_OBJECT_BOUNDS_ENTIRE_OBJECT)
@@ -46,7 +46,7 @@ float32 BulletCharacterObject::mass() {
     return 0.f;
 }
 
-void BulletCharacterObject::load(Mesh::MeshdataPtr mesh) {
+void BulletCharacterObject::load(BulletCollisionShapePtr shape) {
     LocationInfo& locinfo = mParent->info(mID);
 
     Vector3f objPosition = mParent->currentPosition(mID);
@@ -62,16 +62,16 @@ void BulletCharacterObject::load(Mesh::MeshdataPtr mesh) {
 
     // Currently only support spheres, TODO(ewencp) we might want to support
     // capsules instead.
-    mCollisionShape = computeCollisionShape(mID, mBBox, BULLET_OBJECT_TREATMENT_CHARACTER, Mesh::MeshdataPtr());
-    mGhostObject->setCollisionShape(mCollisionShape);
+    mCollisionShape = shape;
+    mGhostObject->setCollisionShape(mCollisionShape.get());
     mGhostObject->setCollisionFlags(btCollisionObject::CF_CHARACTER_OBJECT);
 
     // TODO(ewencp) make this configurable?
     btScalar stepHeight = btScalar(0.5);
     // FIXME(ewencp) we know we're only allocating spheres/capsules for this, so
     // it's currently safe to do this cast, but technically
-    // computeCollisionShape can compute concave shapes as well.
-    mCharacter = new BulletCharacterController (mGhostObject, static_cast<btConvexShape*>(mCollisionShape), stepHeight);
+    // the cache can provide concave shapes as well.
+    mCharacter = new BulletCharacterController (mGhostObject, static_cast<btConvexShape*>(mCollisionShape.get()), stepHeight);
 
 
     // Get mask information
@@ -81,13 +81,12 @@ void BulletCharacterObject::load(Mesh::MeshdataPtr mesh) {
     mParent->dynamicsWorld()->addAction(mCharacter);
 
     mParent->addTickObject(mID);
-    mParent->addDeactivateableObject(mID);
 }
 
 void BulletCharacterObject::unload() {
     if (mCharacter) {
         mParent->removeTickObject(mID);
-        mParent->removeDeactivateableObject(mID);
+        mParent->removeActiveObject(mID);
 
         mParent->dynamicsWorld()->removeAction(mCharacter);
         mParent->dynamicsWorld()->removeCollisionObject(mGhostObject);
@@ -98,8 +97,7 @@ void BulletCharacterObject::unload() {
         delete mGhostObject;
         mGhostObject = NULL;
 
-        delete mCollisionShape;
-        mCollisionShape = NULL;
+        mCollisionShape.reset();
     }
 }
 
@@ -156,12 +154,12 @@ void BulletCharacterObject::postTick(const Time& t) {
         mParent->setLocation(mID, newLocation);
         mParent->setOrientation(mID, newOrientation);
         mParent->addUpdate(mID);
+        mParent->addActiveObject(mID);
     }
 }
 
-void BulletCharacterObject::deactivationTick(const Time& t) {
-    if (mGhostObject != NULL && !mGhostObject->isActive())
-        mParent->updateObjectFromDeactivation(mID);
+bool BulletCharacterObject::active() {
+    return (mGhostObject != NULL && mGhostObject->isActive());
 }
 
 bool BulletCharacterObject::applyRequestedLocation(const TimedMotionVector3f& loc, uint64 epoch) {
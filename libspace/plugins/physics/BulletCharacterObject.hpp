@@ -28,11 +28,11 @@ public:
     virtual bulletObjBBox bbox();
     virtual float32 mass();
 
-    virtual void load(Mesh::MeshdataPtr mesh);
+    virtual void load(BulletCollisionShapePtr shape);
     virtual void unload();
     virtual void preTick(const Time& t);
     virtual void postTick(const Time& t);
-    virtual void deactivationTick(const Time& t);
+    virtual bool active();
 
 
     virtual bool applyRequestedLocation(const TimedMotionVector3f& loc, uint64 epoch);
@@ -47,7 +47,7 @@ private:
 
     btPairCachingGhostObject* mGhostObject;
     BulletCharacterController* mCharacter;
-    btCollisionShape* mCollisionShape;
+    BulletCollisionShapePtr mCollisionShape;
 }; // class BulletCharacterObject
 
 } // namespace Sirikata
@@ -6,8 +6,7 @@
 #define _SIRIKATA_BULLET_PHYSICS_OBJECT_HPP_
 
 #include "Defs.hpp"
-
-class btCollisionShape;
+#include "BulletShapeCache.hpp"
 
 namespace Sirikata {
 
@@ -30,11 +29,13 @@ public:
     virtual bulletObjBBox bbox() = 0;
     virtual float32 mass() = 0;
 
-    /** After the mesh has been downloaded and parsed (or immediately if no mesh
+    /** After the collision shape has been loaded (or immediately if no mesh
      *  is required), this loads the object into the simulation. This should
-     *  setup any Bullet state and start the physical simulation on the object.
+     *  setup any Bullet state and start the physical simulation on the
+     *  object. The shape may be shared with other objects, so it must not be
+     *  modified.
      */
-    virtual void load(Mesh::MeshdataPtr mesh) = 0;
+    virtual void load(BulletCollisionShapePtr shape) = 0;
 
     /** Unload the object from the simulation.
      */
@@ -53,11 +54,11 @@ public:
      */
     virtual void internalTick(const Time& t) {}
 
-    /** Check this object for deactivation. Implementations should call
-     *  BulletPhysicsService::updateObjectFromDeactivation if the object has
-     *  been deactivated.
+    /** Whether bullet is still simulating this object. Objects which report
+     *  movement via BulletPhysicsService::addActiveObject are checked after
+     *  each tick and stopped once this returns false.
      */
-    virtual void deactivationTick(const Time& t) {}
+    virtual bool active() { return false; }
 
 
 
@@ -90,10 +91,6 @@ public:
     virtual void applyForcedOrientation(const TimedMotionQuaternion& orient, uint64 epoch) = 0;
 
 protected:
-
-    // Helper for computing the collision
-    btCollisionShape* computeCollisionShape(const UUID& id, bulletObjBBox shape_type, bulletObjTreatment treatment, Mesh::MeshdataPtr retrievedMesh);
-
     BulletPhysicsService* mParent;
 }; // class BulletObject
 
@@ -34,8 +34,10 @@
 #include "BulletObject.hpp"
 #include "BulletRigidBodyObject.hpp"
 #include "BulletCharacterObject.hpp"
+#include "Options.hpp"
 #include <sirikata/core/trace/Trace.hpp>
 #include <sirikata/mesh/CompositeFilter.hpp>
+#include <sirikata/core/options/CommonOptions.hpp>
 
 #include "Protocol_Loc.pbj.hpp"
 
@@ -44,6 +46,17 @@
 #include <sirikata/core/transfer/AggregatedTransferPool.hpp>
 #include <sirikata/core/network/IOStrandImpl.hpp>
 
+#ifdef SIRIKATA_BULLET_MULTITHREADED
+#include "BulletMultiThreaded/SpuGatheringCollisionDispatcher.h"
+#include "BulletMultiThreaded/SpuNarrowPhaseCollisionTask/SpuGatheringCollisionTask.h"
+#include "BulletMultiThreaded/btParallelConstraintSolver.h"
+#if SIRIKATA_PLATFORM == SIRIKATA_PLATFORM_WINDOWS
+#include "BulletMultiThreaded/Win32ThreadSupport.h"
+#else
+#include "BulletMultiThreaded/PosixThreadSupport.h"
+#endif
+#endif
+
 namespace Sirikata {
 
 namespace {
@@ -51,24 +64,74 @@ void bulletPhysicsInternalTickCallback(btDynamicsWorld *world, btScalar timeStep
     BulletPhysicsService *bps = static_cast<BulletPhysicsService*>(world->getWorldUserInfo());
     bps->internalTickCallback();
 }
+
+#ifdef SIRIKATA_BULLET_MULTITHREADED
+typedef void (*BulletThreadFunc)(void* user, void* local_mem);
+typedef void* (*BulletThreadMemoryFunc)();
+
+btThreadSupportInterface* createBulletThreads(const char* name, BulletThreadFunc func, BulletThreadMemoryFunc mem_func, uint32 nthreads) {
+#if SIRIKATA_PLATFORM == SIRIKATA_PLATFORM_WINDOWS
+    Win32ThreadSupport::Win32ThreadConstructionInfo construction_info(
+        const_cast<char*>(name), func, mem_func, nthreads
+    );
+    return new Win32ThreadSupport(construction_info);
+#else
+    PosixThreadSupport::ThreadConstructionInfo construction_info(
+        const_cast<char*>(name), func, mem_func, nthreads
+    );
+    return new PosixThreadSupport(construction_info);
+#endif
+}
+#endif
 }
 
 BulletPhysicsService::BulletPhysicsService(SpaceContext* ctx, LocationUpdatePolicy* update_policy)
  : LocationService(ctx, update_policy),
    mUpdateIteration(0),
-   mParsingStrand( ctx->ioService->createStrand("BulletPhysicsService Parsing") )
+   mParsingStrand( ctx->ioService->createStrand("BulletPhysicsService Parsing") ),
+   mShapeCache(NULL),
+   mSimGeneration(0),
+   mCollisionThreads(NULL),
+   mSolverThreads(NULL)
 {
+    uint32 solver_threads = GetOptionValue<uint32>(OPT_BULLET_SOLVER_THREADS);
 
     mBroadphase = new btDbvtBroadphase();
-    collisionConfiguration = new btDefaultCollisionConfiguration();
-    dispatcher = new btCollisionDispatcher(collisionConfiguration);
-    solver = new btSequentialImpulseConstraintSolver;
+#ifdef SIRIKATA_BULLET_MULTITHREADED
+    if (solver_threads > 1) {
+        // The parallel solver requires all contacts to be in a preallocated,
+        // contiguous pool, so make it large enough to not run out.
+        btDefaultCollisionConstructionInfo cci;
+        cci.m_defaultMaxPersistentManifoldPoolSize = 32768;
+        collisionConfiguration = new btDefaultCollisionConfiguration(cci);
+
+        mCollisionThreads = createBulletThreads("BulletPhysicsService Collision", processCollisionTask, createCollisionLocalStoreMemory, solver_threads);
+        dispatcher = new SpuGatheringCollisionDispatcher(mCollisionThreads, solver_threads, collisionConfiguration);
+        dispatcher->setDispatcherFlags(btCollisionDispatcher::CD_DISABLE_CONTACTPOOL_DYNAMIC_ALLOCATION);
+
+        mSolverThreads = createBulletThreads("BulletPhysicsService Solver", SolverThreadFunc, SolverlsMemoryFunc, solver_threads);
+        solver = new btParallelConstraintSolver(mSolverThreads);
+    }
+    else
+#endif
+    {
+        if (solver_threads > 1)
+            BULLETLOG(warning, "Bullet was built without multithreading support, ignoring " << OPT_BULLET_SOLVER_THREADS);
+        collisionConfiguration = new btDefaultCollisionConfiguration();
+        dispatcher = new btCollisionDispatcher(collisionConfiguration);
+        solver = new btSequentialImpulseConstraintSolver;
+    }
     mDynamicsWorld = new btDiscreteDynamicsWorld(dispatcher, mBroadphase, solver, collisionConfiguration);
+    if (mSolverThreads != NULL) {
+        // Hand whole islands to the solver threads rather than splitting them
+        // and solving each one sequentially
+        mDynamicsWorld->getSimulationIslandManager()->setSplitIslands(false);
+        mDynamicsWorld->getDispatchInfo().m_enableSPU = true;
+    }
     mDynamicsWorld->setInternalTickCallback(bulletPhysicsInternalTickCallback, (void*)this);
     mDynamicsWorld->setGravity(btVector3(0,-9.8,0));
 
     mLastTime = mContext->simTime();
-    mLastDeactivationTime = mContext->simTime();
 
     mModelsSystem = ModelsSystemFactory::getSingleton().getConstructor("any")("");
     try {
@@ -91,6 +154,15 @@ BulletPhysicsService::BulletPhysicsService(SpaceContext* ctx, LocationUpdatePoli
     mTransferMediator = &(Transfer::TransferMediator::getSingleton());
     mTransferPool = mTransferMediator->registerClient<Transfer::AggregatedTransferPool>("BulletPhysics");
 
+    mShapeCache = new BulletShapeCache(
+        mContext->mainStrand,
+        std::tr1::bind(&BulletPhysicsService::getMesh, this, _1, _2),
+        std::tr1::bind(&BulletPhysicsService::getMeshFingerprint, this, _1, _2),
+        GetOptionValue<uint32>(OPT_BULLET_SHAPE_THREADS),
+        GetOptionValue<String>(OPT_BULLET_SHAPE_CACHE_DIR),
+        (uint64)GetOptionValue<uint32>(OPT_BULLET_SHAPE_CACHE_SIZE) * 1024 * 1024
+    );
+
     BULLETLOG(detailed, "Service Loaded");
 }
 
@@ -102,11 +174,15 @@ BulletPhysicsService::~BulletPhysicsService() {
         mLocations.erase(mLocations.begin());
     }
 
+    delete mShapeCache;
+
     delete mDynamicsWorld;
     delete solver;
     delete dispatcher;
     delete collisionConfiguration;
     delete mBroadphase;
+    delete mSolverThreads;
+    delete mCollisionThreads;
 
     delete mModelFilter;
     delete mModelsSystem;
@@ -136,34 +212,23 @@ void BulletPhysicsService::service() {
     float simForwardTime = delTime.toMilliseconds() / 1000.0f;
 
     // Pre tick
-    for(UUIDSet::iterator id_it = mTickObjects.begin(); id_it != mTickObjects.end(); id_it++) {
-        const UUID& locobj = *id_it;
-        LocationInfo& locinfo = mLocations[locobj];
-        assert(locinfo.simObject != NULL);
-        locinfo.simObject->preTick(now);
-    }
+    for(uint32 idx = 0; idx < mTickObjects.size(); idx++)
+        mTickObjects.object(idx)->preTick(now);
     // Step simulation
     mDynamicsWorld->stepSimulation(simForwardTime);
     // Post tick
-    for(UUIDSet::iterator id_it = mTickObjects.begin(); id_it != mTickObjects.end(); id_it++) {
-        const UUID& locobj = *id_it;
-        LocationInfo& locinfo = mLocations[locobj];
-        assert(locinfo.simObject != NULL);
-        locinfo.simObject->postTick(now);
-    }
-
-    // Check for deactivated objects. Unfortunately there isn't a way to get
-    // this information from bullet at the time deactivation, so we need to poll
-    // for it
-    static Duration deactivation_check_interval(Duration::seconds(1));
-    if (now - mLastDeactivationTime > deactivation_check_interval) {
-        for(UUIDSet::iterator id_it = mDeactivateableObjects.begin(); id_it != mDeactivateableObjects.end(); id_it++) {
-            const UUID& locobj = *id_it;
-            LocationInfo& locinfo = mLocations[locobj];
-            assert(locinfo.simObject != NULL);
-            locinfo.simObject->deactivationTick(now);
-        }
-        mLastDeactivationTime = now;
+    for(uint32 idx = 0; idx < mTickObjects.size(); idx++)
+        mTickObjects.object(idx)->postTick(now);
+
+    // Check for deactivated objects. Bullet only synchronizes motion states for
+    // active objects, so everything it moved was added to mActiveObjects and
+    // only those need to be checked. Walk backwards so removals, which swap in
+    // the last entry, don't skip anything.
+    for(int32 idx = (int32)mActiveObjects.size()-1; idx >= 0; idx--) {
+        if (mActiveObjects.object(idx)->active()) continue;
+        UUID locobj = mActiveObjects.id(idx);
+        mActiveObjects.remove(locobj);
+        updateObjectFromDeactivation(locobj);
     }
 
     // Process location updates
@@ -185,7 +250,7 @@ uint64 BulletPhysicsService::epoch(const UUID& uuid) {
     LocationMap::iterator it = mLocations.find(uuid);
     assert(it != mLocations.end());
 
-    LocationInfo locinfo = it->second;
+    const LocationInfo& locinfo = it->second;
     return locinfo.props.maxSeqNo();
 }
 
@@ -194,7 +259,7 @@ TimedMotionVector3f BulletPhysicsService::location(const UUID& uuid) {
     assert(it != mLocations.end());
 
 
-    LocationInfo locinfo = it->second;
+    const LocationInfo& locinfo = it->second;
     return locinfo.props.location();
 }
 
@@ -208,7 +273,7 @@ TimedMotionQuaternion BulletPhysicsService::orientation(const UUID& uuid) {
     LocationMap::iterator it = mLocations.find(uuid);
     assert(it != mLocations.end());
 
-    LocationInfo locinfo = it->second;
+    const LocationInfo& locinfo = it->second;
     return locinfo.props.orientation();
 }
 
@@ -221,35 +286,60 @@ AggregateBoundingInfo BulletPhysicsService::bounds(const UUID& uuid) {
     LocationMap::iterator it = mLocations.find(uuid);
     assert(it != mLocations.end());
 
-    LocationInfo locinfo = it->second;
+    const LocationInfo& locinfo = it->second;
     return locinfo.props.bounds();
 }
 
 const String& BulletPhysicsService::mesh(const UUID& uuid) {
     LocationMap::iterator it = mLocations.find(uuid);
     assert(it != mLocations.end());
-
-    LocationInfo& locinfo = it->second;
-    locinfo.mesh_copied_str = locinfo.props.mesh().toString();
-    return locinfo.mesh_copied_str;
+    return it->second.mesh.str();
 }
 
 const String& BulletPhysicsService::physics(const UUID& uuid) {
     LocationMap::iterator it = mLocations.find(uuid);
     assert(it != mLocations.end());
-
-    LocationInfo& locinfo = it->second;
-    locinfo.physics_copied_str = locinfo.props.physics();
-    return locinfo.physics_copied_str;
+    return it->second.physics.str();
 }
 
 const String& BulletPhysicsService::queryData(const UUID& uuid) {
     LocationMap::iterator it = mLocations.find(uuid);
     assert(it != mLocations.end());
+    return it->second.query_data.str();
+}
 
-    LocationInfo& locinfo = it->second;
-    locinfo.query_data_copied_str = locinfo.props.queryData();
-    return locinfo.query_data_copied_str;
+InternedString BulletPhysicsService::meshHandle(const UUID& uuid) {
+    LocationMap::iterator it = mLocations.find(uuid);
+    assert(it != mLocations.end());
+    return it->second.mesh;
+}
+
+InternedString BulletPhysicsService::physicsHandle(const UUID& uuid) {
+    LocationMap::iterator it = mLocations.find(uuid);
+    assert(it != mLocations.end());
+    return it->second.physics;
+}
+
+InternedString BulletPhysicsService::queryDataHandle(const UUID& uuid) {
+    LocationMap::iterator it = mLocations.find(uuid);
+    assert(it != mLocations.end());
+    return it->second.query_data;
+}
+
+InternedString BulletPhysicsService::internMesh(const String& msh) {
+    return intern(Transfer::URI(msh).toString());
+}
+
+void BulletPhysicsService::initLocationInfo(LocationInfo& locinfo, const TimedMotionVector3f& loc, const TimedMotionQuaternion& orient, const AggregateBoundingInfo& bnds, const String& msh, const String& phy, const String& query_data) {
+    locinfo.props.setLocation(loc, 0);
+    locinfo.props.setOrientation(orient, 0);
+    locinfo.props.setBounds(bnds, 0);
+    if (locinfo.props.updateSeqNo(SequencedPresenceProperties::LOC_MESH_PART, 0))
+        locinfo.mesh = internMesh(msh);
+    if (locinfo.props.updateSeqNo(SequencedPresenceProperties::LOC_PHYSICS_PART, 0))
+        locinfo.physics = intern(phy);
+    if (locinfo.props.updateSeqNo(SequencedPresenceProperties::LOC_QUERY_DATA_PART, 0))
+        locinfo.query_data = intern(query_data);
 }
 
 bool BulletPhysicsService::isFixed(const UUID& uuid) {
@@ -294,7 +384,7 @@ void BulletPhysicsService::setOrientation(const UUID& uuid, const TimedMotionQua
     notifyLocalOrientationUpdated( uuid, locinfo.aggregate, neworient );
 }
 
-void BulletPhysicsService::getMesh(const Transfer::URI meshURI, const UUID uuid, MeshdataParsedCallback cb) {
+void BulletPhysicsService::getMesh(const Transfer::URI& meshURI, MeshdataParsedCallback cb) {
     Transfer::ResourceDownloadTaskPtr dl = Transfer::ResourceDownloadTask::construct(
         Transfer::URI(meshURI), mTransferPool, 1.0,
         // Ideally parsing wouldn't need to be serialized, but something about
@@ -304,7 +394,7 @@ void BulletPhysicsService::getMesh(const Transfer::URI meshURI, const UUID uuid,
             std::tr1::bind(&BulletPhysicsService::getMeshCallback, this, _1, _2, _3, cb)
         )
     );
-    mMeshDownloads[uuid] = dl;
+    mMeshDownloads.insert(dl);
     dl->start();
 }
 
@@ -324,13 +414,36 @@ void BulletPhysicsService::getMeshCallback(Transfer::ResourceDownloadTaskPtr tas
             assert(output_data->single());
             mesh = std::tr1::dynamic_pointer_cast<Meshdata>(output_data->get());
         }
-        mContext->mainStrand->post(std::tr1::bind(cb, mesh), "BulletPhysicsService::getMeshCallback");
+        mContext->mainStrand->post(std::tr1::bind(&BulletPhysicsService::finishMeshDownload, this, taskptr, mesh, cb), "BulletPhysicsService::getMeshCallback");
     }
     else {
-        mContext->mainStrand->post(std::tr1::bind(cb, MeshdataPtr()), "BulletPhysicsService::getMeshCallback");
+        mContext->mainStrand->post(std::tr1::bind(&BulletPhysicsService::finishMeshDownload, this, taskptr, MeshdataPtr(), cb), "BulletPhysicsService::getMeshCallback");
     }
 }
 
+void BulletPhysicsService::finishMeshDownload(Transfer::ResourceDownloadTaskPtr taskptr, MeshdataPtr mesh, MeshdataParsedCallback cb) {
+    mMeshDownloads.erase(taskptr);
+    cb(mesh);
+}
+
+void BulletPhysicsService::getMeshFingerprint(const Transfer::URI& meshURI, BulletShapeCache::FingerprintCallback cb) {
+    Transfer::TransferRequestPtr req(
+        new Transfer::MetadataRequest(
+            meshURI, 1.0,
+            std::tr1::bind(&BulletPhysicsService::getMeshFingerprintCallback, this, _1, _2, cb)
+        )
+    );
+    mTransferPool->addRequest(req);
+}
+
+void BulletPhysicsService::getMeshFingerprintCallback(std::tr1::shared_ptr<Transfer::MetadataRequest> request, std::tr1::shared_ptr<Transfer::RemoteFileMetadata> response, BulletShapeCache::FingerprintCallback cb) {
+    // Like getMeshCallback, this can come in on another thread
+    String fingerprint;
+    if (response)
+        fingerprint = response->getFingerprint().convertToHexString();
+    mContext->mainStrand->post(std::tr1::bind(cb, fingerprint), "BulletPhysicsService::getMeshFingerprintCallback");
+}
+
   void BulletPhysicsService::addLocalObject(const UUID& uuid, const TimedMotionVector3f& loc, const TimedMotionQuaternion& orient, const AggregateBoundingInfo& bnds, const String& msh, const String& phy, const String& query_data) {
     LocationMap::iterator it = mLocations.find(uuid);
 
@@ -346,12 +459,7 @@ void BulletPhysicsService::getMeshCallback(Transfer::ResourceDownloadTaskPtr tas
     }
 
     LocationInfo& locinfo = it->second;
-    locinfo.props.setLocation(loc, 0);
-    locinfo.props.setOrientation(orient, 0);
-    locinfo.props.setBounds(bnds, 0);
-    locinfo.props.setMesh(Transfer::URI(msh), 0);
-    locinfo.props.setPhysics(phy, 0);
-    locinfo.props.setQueryData(query_data, 0);
+    initLocationInfo(locinfo, loc, orient, bnds, msh, phy, query_data);
     locinfo.local = true;
     locinfo.aggregate = false;
 
@@ -368,8 +476,8 @@ void BulletPhysicsService::getMeshCallback(Transfer::ResourceDownloadTaskPtr tas
 void BulletPhysicsService::updatePhysicsWorld(const UUID& uuid) {
     LocationMap::iterator it = mLocations.find(uuid);
     LocationInfo& locinfo = it->second;
-    const Transfer::URI& msh = locinfo.props.mesh();
-    const String& phy = locinfo.props.physics();
+    Transfer::URI msh(locinfo.mesh.str());
+    const String& phy = locinfo.physics.str();
 
     /*BEGIN: Bullet Physics Code*/
 
@@ -401,7 +509,9 @@ void BulletPhysicsService::updatePhysicsWorld(const UUID& uuid) {
         mass = settings.getReal("mass", DEFAULT_MASS);
     }
 
-    // Clear out previous state from the simulation.
+    // Clear out previous state from the simulation. Any outstanding shape
+    // requests are for the old settings, so make sure they're ignored.
+    locinfo.simGeneration = ++mSimGeneration;
     if (locinfo.simObject != NULL) {
         locinfo.simObject->unload();
         delete locinfo.simObject;
@@ -430,32 +540,39 @@ void BulletPhysicsService::updatePhysicsWorld(const UUID& uuid) {
     }
 
     // We may need the mesh in order to continue. We need it only if:
-    // treatment != ignore (see above check) && bounds != sphere.
-    if (locinfo.simObject->bbox() == BULLET_OBJECT_BOUNDS_SPHERE) {
+    // treatment != ignore (see above check) && bounds != sphere. Characters
+    // currently only support spheres.
+    if (locinfo.simObject->bbox() == BULLET_OBJECT_BOUNDS_SPHERE ||
+        locinfo.simObject->treatment() == BULLET_OBJECT_TREATMENT_CHARACTER ||
+        locinfo.mesh.empty())
+    {
         // Invoke directly since we have all the data we need
-        updatePhysicsWorldWithMesh(uuid, MeshdataPtr());
+        updatePhysicsWorldWithShape(uuid, locinfo.simGeneration, BulletCollisionShapePtr());
     }
     else {
-        getMesh(msh, uuid,
-            std::tr1::bind(&BulletPhysicsService::updatePhysicsWorldWithMesh, this, uuid, _1)
+        mShapeCache->getShape(
+            locinfo.mesh.str(), locinfo.simObject->bbox(), locinfo.simObject->treatment(),
+            locinfo.props.bounds().fullRadius(),
+            std::tr1::bind(&BulletPhysicsService::updatePhysicsWorldWithShape, this, uuid, locinfo.simGeneration, _1)
         );
     }
 }
 
-void BulletPhysicsService::updatePhysicsWorldWithMesh(const UUID& uuid, MeshdataPtr retrievedMesh) {
+void BulletPhysicsService::updatePhysicsWorldWithShape(const UUID& uuid, uint32 generation, BulletCollisionShapePtr shape) {
     LocationMap::iterator it = mLocations.find(uuid);
-    // It's possible it has already disconnected. TODO(ewencp) we
-    // should clear the download instead of waiting for it to finish,
-    // but this works for now. Actually, we should also make sure that
-    // the data still matches (we could change physics to A, change it
-    // to B, have them processed async, finish B, then finish A,
-    // resulting in simulation that doesn't match the settings in the
-    // locinfo).
+    // It's possible it has already disconnected or changed its physics
+    // settings since the shape was requested. TODO(ewencp) we should cancel
+    // the request instead of waiting for it to finish, but this works for now.
     if (it == mLocations.end()) return;
 
     LocationInfo& locinfo = it->second;
+    if (locinfo.simGeneration != generation || locinfo.simObject == NULL) return;
+
+    // Spheres, and the fallback if we couldn't get the mesh
+    if (!shape)
+        shape = BulletShapeCache::sphere(locinfo.props.bounds().fullRadius());
 
-    locinfo.simObject->load(retrievedMesh);
+    locinfo.simObject->load(shape);
 }
 
 // Helper for cleaning up a LocationInfo before removing it
@@ -497,31 +614,54 @@ const LocationInfo& BulletPhysicsService::info(const UUID& uuid) const {
     return mLocations.find(uuid)->second;
 }
 
+void BulletPhysicsService::SimObjectList::add(const UUID& uuid, BulletObject* obj) {
+    assert(obj != NULL);
+    IndexMap::iterator it = mIndices.find(uuid);
+    if (it != mIndices.end()) {
+        mObjects[it->second] = obj;
+        return;
+    }
+    mIndices[uuid] = mObjects.size();
+    mObjects.push_back(obj);
+    mIDs.push_back(uuid);
+}
+
+void BulletPhysicsService::SimObjectList::remove(const UUID& uuid) {
+    IndexMap::iterator it = mIndices.find(uuid);
+    if (it == mIndices.end()) return;
+
+    uint32 idx = it->second;
+    uint32 last = mObjects.size() - 1;
+    if (idx != last) {
+        mObjects[idx] = mObjects[last];
+        mIDs[idx] = mIDs[last];
+        mIndices[mIDs[idx]] = idx;
+    }
+    mObjects.pop_back();
+    mIDs.pop_back();
+    mIndices.erase(it);
+}
+
 void BulletPhysicsService::addTickObject(const UUID& uuid) {
-    mTickObjects.insert(uuid);
+    mTickObjects.add(uuid, info(uuid).simObject);
 }
 void BulletPhysicsService::removeTickObject(const UUID& uuid) {
-    UUIDSet::iterator dynamic_obj_it = mTickObjects.find(uuid);
-    if (dynamic_obj_it != mTickObjects.end())
-        mTickObjects.erase(dynamic_obj_it);
+    mTickObjects.remove(uuid);
 }
 
 void BulletPhysicsService::addInternalTickObject(const UUID& uuid) {
-    mInternalTickObjects.insert(uuid);
+    mInternalTickObjects.add(uuid, info(uuid).simObject);
 }
 void BulletPhysicsService::removeInternalTickObject(const UUID& uuid) {
-    UUIDSet::iterator dynamic_obj_it = mInternalTickObjects.find(uuid);
-    if (dynamic_obj_it != mInternalTickObjects.end())
-        mInternalTickObjects.erase(dynamic_obj_it);
+    mInternalTickObjects.remove(uuid);
 }
 
-void BulletPhysicsService::addDeactivateableObject(const UUID& uuid) {
-    mDeactivateableObjects.insert(uuid);
+void BulletPhysicsService::addActiveObject(const UUID& uuid) {
+    if (mActiveObjects.contains(uuid)) return;
+    mActiveObjects.add(uuid, info(uuid).simObject);
 }
-void BulletPhysicsService::removeDeactivateableObject(const UUID& uuid) {
-    UUIDSet::iterator dynamic_obj_it = mDeactivateableObjects.find(uuid);
-    if (dynamic_obj_it != mDeactivateableObjects.end())
-        mDeactivateableObjects.erase(dynamic_obj_it);
+void BulletPhysicsService::removeActiveObject(const UUID& uuid) {
+    mActiveObjects.remove(uuid);
 }
 
 
@@ -560,11 +700,8 @@ void BulletPhysicsService::updateObjectFromDeactivation(const UUID& uuid) {
 
 void BulletPhysicsService::internalTickCallback() {
     Time t = mContext->simTime();
-    for(UUIDSet::iterator id_it = mInternalTickObjects.begin(); id_it != mInternalTickObjects.end(); id_it++) {
-        LocationInfo& locinfo = mLocations[*id_it];
-        assert(locinfo.simObject != NULL);
-        locinfo.simObject->internalTick(t);
-    }
+    for(uint32 idx = 0; idx < mInternalTickObjects.size(); idx++)
+        mInternalTickObjects.object(idx)->internalTick(t);
 }
 
 void BulletPhysicsService::addLocalAggregateObject(const UUID& uuid, const TimedMotionVector3f& loc, const TimedMotionQuaternion& orient, const AggregateBoundingInfo& bnds, const String& msh, const String& phy, const String& query_data) {
@@ -577,12 +714,7 @@ void BulletPhysicsService::addLocalAggregateObject(const UUID& uuid, const Timed
     LocationMap::iterator it = mLocations.find(uuid);
 
     LocationInfo& locinfo = it->second;
-    locinfo.props.setLocation(loc, 0);
-    locinfo.props.setOrientation(orient, 0);
-    locinfo.props.setBounds(bnds, 0);
-    locinfo.props.setMesh(Transfer::URI(msh), 0);
-    locinfo.props.setPhysics(phy, 0);
-    locinfo.props.setQueryData(query_data);
+    initLocationInfo(locinfo, loc, orient, bnds, msh, phy, query_data);
     locinfo.local = true;
     locinfo.aggregate = true;
 
@@ -631,26 +763,27 @@ void BulletPhysicsService::updateLocalAggregateMesh(const UUID& uuid, const Stri
     LocationMap::iterator loc_it = mLocations.find(uuid);
     assert(loc_it != mLocations.end());
     assert(loc_it->second.aggregate == true);
-    String oldval = loc_it->second.props.mesh().toString();
-    loc_it->second.props.setMesh(Transfer::URI(newval), 0); // no epochs for aggregates
+    InternedString oldval = loc_it->second.mesh;
+    if (loc_it->second.props.updateSeqNo(SequencedPresenceProperties::LOC_MESH_PART, 0)) // no epochs for aggregates
+        loc_it->second.mesh = internMesh(newval);
     notifyLocalMeshUpdated( uuid, true, newval );
-    if (oldval != newval) updatePhysicsWorld(uuid);
+    if (oldval != loc_it->second.mesh) updatePhysicsWorld(uuid);
 }
 void BulletPhysicsService::updateLocalAggregatePhysics(const UUID& uuid, const String& newval) {
     LocationMap::iterator loc_it = mLocations.find(uuid);
     assert(loc_it != mLocations.end());
     assert(loc_it->second.aggregate == true);
-    String oldval = loc_it->second.props.physics();
-    loc_it->second.props.setPhysics(newval, 0); // no epochs for aggregates
+    InternedString oldval = loc_it->second.physics;
+    if (loc_it->second.props.updateSeqNo(SequencedPresenceProperties::LOC_PHYSICS_PART, 0)) // no epochs for aggregates
+        loc_it->second.physics = intern(newval);
     notifyLocalPhysicsUpdated( uuid, true, newval );
-    if (oldval != newval) updatePhysicsWorld(uuid);
+    if (oldval != loc_it->second.physics) updatePhysicsWorld(uuid);
 }
 void BulletPhysicsService::updateLocalAggregateQueryData(const UUID& uuid, const String& newval) {
     LocationMap::iterator loc_it = mLocations.find(uuid);
     assert(loc_it != mLocations.end());
     assert(loc_it->second.aggregate == true);
-    String oldval = loc_it->second.props.queryData();
-    loc_it->second.props.setQueryData(newval);
+    loc_it->second.query_data = intern(newval);
     notifyLocalQueryDataUpdated( uuid, true, newval );
     // should not affect physics
 }
@@ -665,12 +798,7 @@ void BulletPhysicsService::addReplicaObject(const Time& t, const UUID& uuid, boo
         LocationInfo& locinfo = it->second;
         if (!locinfo.local) {
             locinfo.props.reset();
-            locinfo.props.setLocation(loc, 0);
-            locinfo.props.setOrientation(orient, 0);
-            locinfo.props.setBounds(bnds, 0);
-            locinfo.props.setMesh(Transfer::URI(msh), 0);
-            locinfo.props.setPhysics(phy, 0);
-            locinfo.props.setQueryData(query_data, 0);
+            initLocationInfo(locinfo, loc, orient, bnds, msh, phy, query_data);
             //local = false
             // FIXME should we notify location and bounds updated info?
             updatePhysicsWorld(uuid);
@@ -679,16 +807,10 @@ void BulletPhysicsService::addReplicaObject(const Time& t, const UUID& uuid, boo
     }
     else {
         // Its a new replica, just insert it
-        LocationInfo locinfo;
-        locinfo.props.setLocation(loc, 0);
-        locinfo.props.setOrientation(orient, 0);
-        locinfo.props.setBounds(bnds, 0);
-        locinfo.props.setMesh(Transfer::URI(msh), 0);
-        locinfo.props.setPhysics(phy, 0);
-        locinfo.props.setQueryData(query_data, 0);
+        LocationInfo& locinfo = mLocations[uuid];
+        initLocationInfo(locinfo, loc, orient, bnds, msh, phy, query_data);
         locinfo.local = false;
         locinfo.aggregate = agg;
-        mLocations[uuid] = locinfo;
 
         // We only run this notification when the object actually is new
         CONTEXT_SPACETRACE(serverObjectEvent, 0, mContext->id(), uuid, true, loc); // FIXME add remote server ID
@@ -807,26 +929,28 @@ void BulletPhysicsService::receiveMessage(Message* msg) {
             }
 
             if (update.has_mesh()) {
-                Transfer::URI oldmesh = loc_it->second.props.mesh();
-                Transfer::URI newmesh(update.mesh());
-                loc_it->second.props.setMesh(newmesh, epoch);
-                notifyReplicaMeshUpdated( update.object(), loc_it->second.props.mesh().toString() );
+                InternedString oldmesh = loc_it->second.mesh;
+                if (loc_it->second.props.updateSeqNo(SequencedPresenceProperties::LOC_MESH_PART, epoch))
+                    loc_it->second.mesh = internMesh(update.mesh());
+                InternedString newmesh = loc_it->second.mesh;
+                notifyReplicaMeshUpdated( update.object(), newmesh.str() );
                 if (oldmesh != newmesh) updatePhysics = true;
             }
 
             if (update.has_physics()) {
-                String oldphy = loc_it->second.props.physics();
-                String newphy = update.physics();
-                loc_it->second.props.setPhysics(newphy, epoch);
-                notifyReplicaPhysicsUpdated( update.object(), loc_it->second.props.physics());
+                InternedString oldphy = loc_it->second.physics;
+                if (loc_it->second.props.updateSeqNo(SequencedPresenceProperties::LOC_PHYSICS_PART, epoch))
+                    loc_it->second.physics = intern(update.physics());
+                InternedString newphy = loc_it->second.physics;
+                notifyReplicaPhysicsUpdated( update.object(), newphy.str() );
                 if (oldphy != newphy) updatePhysics = true;
             }
 
             if (update.has_query_data()) {
-                String oldqd = loc_it->second.props.queryData();
-                String newqd = update.query_data();
-                loc_it->second.props.setQueryData(newqd, epoch);
-                notifyReplicaQueryDataUpdated( update.object(), loc_it->second.props.queryData());
+                if (loc_it->second.props.updateSeqNo(SequencedPresenceProperties::LOC_QUERY_DATA_PART, epoch))
+                    loc_it->second.query_data = intern(update.query_data());
+                InternedString newqd = loc_it->second.query_data;
+                notifyReplicaQueryDataUpdated( update.object(), newqd.str() );
             }
 
             if (updatePhysics)
@@ -925,26 +1049,27 @@ bool BulletPhysicsService::locationUpdate(UUID source, void* buffer, uint32 leng
             }
 
             if (request.has_mesh()) {
-                Transfer::URI oldmesh = loc_it->second.props.mesh();
-                Transfer::URI newmesh(request.mesh());
-                loc_it->second.props.setMesh(newmesh, epoch);
-                notifyLocalMeshUpdated( source, loc_it->second.aggregate, loc_it->second.props.mesh().toString() );
+                InternedString oldmesh = loc_it->second.mesh;
+                if (loc_it->second.props.updateSeqNo(SequencedPresenceProperties::LOC_MESH_PART, epoch))
+                    loc_it->second.mesh = internMesh(request.mesh());
+                InternedString newmesh = loc_it->second.mesh;
+                notifyLocalMeshUpdated( source, loc_it->second.aggregate, newmesh.str() );
                 if (oldmesh != newmesh) updatePhysics = true;
             }
 
             if (request.has_physics()) {
-                String oldphy = loc_it->second.props.physics();
-                String newphy = request.physics();
-                loc_it->second.props.setPhysics(newphy, epoch);
-                notifyLocalPhysicsUpdated( source, loc_it->second.aggregate, loc_it->second.props.physics() );
+                InternedString oldphy = loc_it->second.physics;
+                if (loc_it->second.props.updateSeqNo(SequencedPresenceProperties::LOC_PHYSICS_PART, epoch))
+                    loc_it->second.physics = intern(request.physics());
+                InternedString newphy = loc_it->second.physics;
+                notifyLocalPhysicsUpdated( source, loc_it->second.aggregate, newphy.str() );
                 if (oldphy != newphy) updatePhysics = true;
             }
 
             if (request.has_query_data()) {
-                String oldqd = loc_it->second.props.queryData();
-                String newqd = request.query_data();
-                loc_it->second.props.setQueryData(newqd);
-                notifyLocalQueryDataUpdated( source, loc_it->second.aggregate, loc_it->second.props.queryData() );
+                loc_it->second.query_data = intern(request.query_data());
+                InternedString newqd = loc_it->second.query_data;
+                notifyLocalQueryDataUpdated( source, loc_it->second.aggregate, newqd.str() );
             }
 
             if (updatePhysics)
@@ -979,6 +1104,8 @@ void BulletPhysicsService::commandProperties(const Command::Command& cmd, Comman
     result.put("objects.local_count", local_count);
     result.put("objects.aggregate_count", aggregate_count);
     result.put("objects.local_aggregate_count", local_aggregate_count);
+    result.put("shapes.count", mShapeCache->size());
+    result.put("shapes.pending", mShapeCache->pending());
 
     cmdr->result(cmdid, result);
 }
@@ -1034,8 +1161,8 @@ void BulletPhysicsService::commandObjectProperties(const Command::Command& cmd,
     result.put("properties.bounds.centerBoundsRadius", it->second.props.bounds().centerBoundsRadius);
     result.put("properties.bounds.maxObjectRadius", it->second.props.bounds().maxObjectRadius);
 
-    result.put("properties.mesh", it->second.props.mesh().toString());
-    result.put("properties.physics", it->second.props.physics());
+    result.put("properties.mesh", it->second.mesh.str());
+    result.put("properties.physics", it->second.physics.str());
 
     result.put("properties.local", it->second.local);
     result.put("properties.aggregate", it->second.aggregate);
@@ -45,6 +45,9 @@
 #include <sirikata/mesh/Meshdata.hpp>
 
 #include "Defs.hpp"
+#include "BulletShapeCache.hpp"
+
+class btThreadSupportInterface;
 
 namespace Sirikata {
 
@@ -72,6 +75,9 @@ public:
     virtual const String& mesh(const UUID& uuid);
     virtual const String& physics(const UUID& uuid);
     virtual const String& queryData(const UUID& uuid);
+    virtual InternedString meshHandle(const UUID& uuid);
+    virtual InternedString physicsHandle(const UUID& uuid);
+    virtual InternedString queryDataHandle(const UUID& uuid);
     // Added for Bullet implementation
     bool isFixed(const UUID& uuid);
     // Returns true if the current settings for the object allow
@@ -112,11 +118,18 @@ public:
 
 
     typedef std::tr1::function<void(MeshdataPtr)> MeshdataParsedCallback;
-    void getMesh(const Transfer::URI meshURI, const UUID uuid, MeshdataParsedCallback cb);
+    void getMesh(const Transfer::URI& meshURI, MeshdataParsedCallback cb);
     // The last two get set in this callback, indicating that the
     // transfer finished (whether or not it was successful) and the
     // resulting data.
     void getMeshCallback(Transfer::ResourceDownloadTaskPtr taskptr, Transfer::TransferRequestPtr request, Transfer::DenseDataPtr response, MeshdataParsedCallback cb);
+    // Main strand half of getMeshCallback, cleans up the download
+    void finishMeshDownload(Transfer::ResourceDownloadTaskPtr taskptr, MeshdataPtr mesh, MeshdataParsedCallback cb);
+
+    // Looks up the content fingerprint for a mesh so its collision shape can
+    // be found on disk without downloading it.
+    void getMeshFingerprint(const Transfer::URI& meshURI, BulletShapeCache::FingerprintCallback cb);
+    void getMeshFingerprintCallback(std::tr1::shared_ptr<Transfer::MetadataRequest> request, std::tr1::shared_ptr<Transfer::RemoteFileMetadata> response, BulletShapeCache::FingerprintCallback cb);
 
     LocationInfo& info(const UUID& uuid);
     const LocationInfo& info(const UUID& uuid) const;
@@ -132,9 +145,12 @@ public:
     // velocity
     void addInternalTickObject(const UUID& uuid);
     void removeInternalTickObject(const UUID& uuid);
-    // Objects that want deactivation check callbacks
-    void addDeactivateableObject(const UUID& uuid);
-    void removeDeactivateableObject(const UUID& uuid);
+    // Objects that bullet is actively simulating, i.e. which have just been
+    // moved by the simulation. After each tick these are checked until they go
+    // to sleep, at which point updateObjectFromDeactivation is invoked for
+    // them. Adding an object that is already tracked is cheap.
+    void addActiveObject(const UUID& uuid);
+    void removeActiveObject(const UUID& uuid);
 
     // Add an update for this object, i.e. it was detected that it moved
     void addUpdate(const UUID& uuid);
@@ -149,14 +165,37 @@ protected:
     LocationMap mLocations;
 
     typedef std::tr1::unordered_set<UUID, UUID::Hasher> UUIDSet;
+
+    // A set of simulated objects stored contiguously, so the per-tick loops
+    // can walk them without looking each one up in mLocations. Removal swaps
+    // the last entry into the hole, so order isn't preserved.
+    class SimObjectList {
+    public:
+        bool contains(const UUID& uuid) const {
+            return mIndices.find(uuid) != mIndices.end();
+        }
+        void add(const UUID& uuid, BulletObject* obj);
+        void remove(const UUID& uuid);
+
+        uint32 size() const { return mObjects.size(); }
+        const UUID& id(uint32 idx) const { return mIDs[idx]; }
+        BulletObject* object(uint32 idx) const { return mObjects[idx]; }
+    private:
+        std::vector<BulletObject*> mObjects;
+        std::vector<UUID> mIDs;
+        typedef std::tr1::unordered_map<UUID, uint32, UUID::Hasher> IndexMap;
+        IndexMap mIndices;
+    };
+
     // Which objects have dynamic physical simulation and need to be
     // sanity checked at each tick.
-    UUIDSet mTickObjects;
+    SimObjectList mTickObjects;
     // Which objects have dynamic physical simulation and need to be
-    // sanity checked at each tick.
-    UUIDSet mInternalTickObjects;
-    // Objects that need to be checked for deactivation
-    UUIDSet mDeactivateableObjects;
+    // sanity checked at each internal tick.
+    SimObjectList mInternalTickObjects;
+    // Objects bullet has moved recently, which need to be checked for
+    // deactivation
+    SimObjectList mActiveObjects;
     // Objects which have outstanding updates to location information
     // from the physics engine.
     UUIDSet physicsUpdates;
@@ -168,30 +207,40 @@ protected:
     // for updates to reach the OH.
     uint32 mUpdateIteration;
 
-    typedef std::tr1::unordered_map<UUID, Transfer::ResourceDownloadTaskPtr, UUID::Hasher> MeshDownloadMap;
-    MeshDownloadMap mMeshDownloads;
+    // Outstanding downloads, which need to be kept alive until they complete
+    typedef std::set<Transfer::ResourceDownloadTaskPtr> MeshDownloadSet;
+    MeshDownloadSet mMeshDownloads;
 
 private:
 
     void updatePhysicsWorld(const UUID& uuid);
-    // This continues the work of updatePhysicsWorld once the mesh has
-    // been retrieved.
-    void updatePhysicsWorldWithMesh(const UUID& uuid, MeshdataPtr retrievedMesh);
+    // This continues the work of updatePhysicsWorld once the collision shape
+    // has been retrieved. generation is the LocationInfo::simGeneration the
+    // shape was requested for, so we can tell if the object's settings
+    // changed in the meantime.
+    void updatePhysicsWorldWithShape(const UUID& uuid, uint32 generation, BulletCollisionShapePtr shape);
 
     // Helper for cleaning up a LocationInfo before removing it
     void cleanupLocationInfo(LocationInfo& locinfo);
 
+    // Mesh URIs are normalized through Transfer::URI before interning
+    InternedString internMesh(const String& msh);
+    // Sets all properties with sequence number 0
+    void initLocationInfo(LocationInfo& locinfo, const TimedMotionVector3f& loc, const TimedMotionQuaternion& orient, const AggregateBoundingInfo& bnds, const String& msh, const String& phy, const String& query_data);
+
 
     //Bullet Dynamics World Vars
     btBroadphaseInterface* mBroadphase;
     btDefaultCollisionConfiguration* collisionConfiguration;
     btCollisionDispatcher* dispatcher;
-    btSequentialImpulseConstraintSolver* solver;
+    btConstraintSolver* solver;
     btDiscreteDynamicsWorld* mDynamicsWorld;
+    // Worker threads for the parallel dispatcher and solver, NULL when
+    // simulating on the main thread
+    btThreadSupportInterface* mCollisionThreads;
+    btThreadSupportInterface* mSolverThreads;
 
     Time mLastTime;
-    // Track last time we checked deactivation state
-    Time mLastDeactivationTime;
 
     //load meshes to create appropriate bounding volumes
     ModelsSystem* mModelsSystem;
@@ -200,6 +249,11 @@ private:
     Transfer::TransferMediator *mTransferMediator;
     Transfer::TransferPoolPtr mTransferPool;
     Network::IOStrand* mParsingStrand;
+
+    // Collision shapes shared between objects with the same meshes
+    BulletShapeCache* mShapeCache;
+    // Source of LocationInfo::simGeneration values
+    uint32 mSimGeneration;
 }; // class BulletPhysicsService
 
 } // namespace Sirikata
@@ -37,7 +37,7 @@ BulletRigidBodyObject::BulletRigidBodyObject(BulletPhysicsService* parent, const
    mTreatment(treatment),
    mBBox(bb),
    mMass(mass),
-   mObjShape(NULL),
+   mObjShape(),
    mObjMotionState(NULL),
    mObjRigidBody(NULL)
 {
@@ -73,9 +73,9 @@ BulletRigidBodyObject::~BulletRigidBodyObject() {
     removeRigidBody();
 }
 
-void BulletRigidBodyObject::load(MeshdataPtr retrievedMesh) {
-    mObjShape = computeCollisionShape(mID, mBBox, mTreatment, retrievedMesh);
-    assert(mObjShape != NULL);
+void BulletRigidBodyObject::load(BulletCollisionShapePtr shape) {
+    mObjShape = shape;
+    assert(mObjShape);
     addRigidBody();
 }
 
@@ -90,7 +90,7 @@ void BulletRigidBodyObject::addRigidBody() {
     //calculate the inertia
     mObjShape->calculateLocalInertia(mMass, objInertia);
     //make a constructionInfo object
-    btRigidBody::btRigidBodyConstructionInfo objRigidBodyCI(mMass, mObjMotionState, mObjShape, objInertia);
+    btRigidBody::btRigidBodyConstructionInfo objRigidBodyCI(mMass, mObjMotionState, mObjShape.get(), objInertia);
 
     //CREATE: make the rigid body
     mObjRigidBody = new btRigidBody(objRigidBodyCI);
@@ -124,7 +124,6 @@ void BulletRigidBodyObject::addRigidBody() {
     // And if its dynamic, make sure its in our list of objects to
     // track for sanity checking
     mParent->addInternalTickObject(mID);
-    mParent->addDeactivateableObject(mID);
 }
 
 void BulletRigidBodyObject::unload() {
@@ -135,15 +134,14 @@ void BulletRigidBodyObject::removeRigidBody() {
     if (mObjRigidBody) {
         mParent->dynamicsWorld()->removeRigidBody(mObjRigidBody);
 
-        delete mObjShape;
-        mObjShape = NULL;
+        mObjShape.reset();
         delete mObjMotionState;
         mObjMotionState = NULL;
         delete mObjRigidBody;
         mObjRigidBody = NULL;
 
         mParent->removeInternalTickObject(mID);
-        mParent->removeDeactivateableObject(mID);
+        mParent->removeActiveObject(mID);
     }
 }
 
@@ -180,6 +178,9 @@ void BulletRigidBodyObject::updateObjectFromBullet(const btTransform& worldTrans
     mParent->setOrientation(mID, newOrientation);
 
     mParent->addUpdate(mID);
+    // Bullet only synchronizes motion states for active objects, so this is
+    // where we find out the object is awake
+    mParent->addActiveObject(mID);
 }
 
 
@@ -207,9 +208,8 @@ void BulletRigidBodyObject::internalTick(const Time& t) {
     capAngularVelocity(mObjRigidBody, 4*3.14159);
 }
 
-void BulletRigidBodyObject::deactivationTick(const Time& t) {
-    if (mObjRigidBody != NULL && !mObjRigidBody->isActive())
-        mParent->updateObjectFromDeactivation(mID);
+bool BulletRigidBodyObject::active() {
+    return (mObjRigidBody != NULL && mObjRigidBody->isActive());
 }
 
 
@@ -25,10 +25,10 @@ public:
     virtual bulletObjBBox bbox() { return mBBox; }
     virtual float32 mass() { return mMass; }
 
-    virtual void load(Mesh::MeshdataPtr mesh);
+    virtual void load(BulletCollisionShapePtr shape);
     virtual void unload();
     virtual void internalTick(const Time& t);
-    virtual void deactivationTick(const Time& t);
+    virtual bool active();
 
 
     virtual bool applyRequestedLocation(const TimedMotionVector3f& loc, uint64 epoch);
@@ -52,7 +52,7 @@ private:
     bulletObjBBox mBBox;
     float32 mMass;
     // And then some implementation data:
-    btCollisionShape* mObjShape;
+    BulletCollisionShapePtr mObjShape;
     SirikataMotionState* mObjMotionState;
     btRigidBody* mObjRigidBody;
 
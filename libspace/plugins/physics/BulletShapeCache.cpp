@@ -0,0 +1,645 @@
+// Copyright (c) 2015 Sirikata Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can
+// be found in the LICENSE file.
+
+#include "BulletShapeCache.hpp"
+
+#include "btBulletDynamicsCommon.h"
+#include "BulletCollision/CollisionShapes/btShapeHull.h"
+#include "BulletCollision/CollisionShapes/btScaledBvhTriangleMeshShape.h"
+#include "BulletCollision/CollisionShapes/btOptimizedBvh.h"
+
+#include <sirikata/mesh/Bounds.hpp>
+#include <sirikata/core/util/Sha256.hpp>
+#include <sirikata/core/util/Paths.hpp>
+#include <sirikata/core/util/UUID.hpp>
+#include <sirikata/core/network/IOStrandImpl.hpp>
+#include <sirikata/core/network/IOService.hpp>
+
+#include <boost/filesystem.hpp>
+#include <fstream>
+#include <map>
+#include <ctime>
+
+namespace Sirikata {
+
+namespace {
+const uint32 MinSweepThreshold = 64;
+
+// Header for shapes stored on disk. A mismatched magic number (e.g. from a
+// machine with different endianness) or version is treated as a miss.
+const uint32 ShapeFileMagic = 0x534b4253; // SKBS
+const uint32 ShapeFileVersion = 1;
+
+const char* ShapeFileExtension = ".shape";
+const char* TempFileExtension = ".tmp";
+// Temporary files older than this were left behind by a writer that died
+const std::time_t AbandonedTempFileAge = 60*60;
+
+uint64 bytesRemaining(std::ifstream& fp, std::streamoff file_size) {
+    std::streamoff pos = fp.tellg();
+    if (pos < 0 || pos > file_size) return 0;
+    return (uint64)(file_size - pos);
+}
+}
+
+struct BulletShapeCache::ShapeData {
+    ShapeData(ShapeKind k)
+     : kind(k),
+       mesh(NULL),
+       bvhShape(NULL),
+       bvhBuffer(NULL),
+       bvhBufferSize(0)
+    {
+        halfExtents[0] = halfExtents[1] = halfExtents[2] = 0.f;
+    }
+
+    ~ShapeData() {
+        // A deserialized BVH lives in bvhBuffer and isn't owned by the shape
+        delete bvhShape;
+        delete mesh;
+        if (bvhBuffer != NULL)
+            btAlignedFree(bvhBuffer);
+    }
+
+    // Builds the triangle mesh and, if a serialized version isn't available,
+    // the BVH from triangles.
+    bool buildBvh() {
+        mesh = new btTriangleMesh(false, false);
+        for(uint32 i = 0; i+8 < triangles.size(); i += 9) {
+            mesh->addTriangle(
+                btVector3(triangles[i], triangles[i+1], triangles[i+2]),
+                btVector3(triangles[i+3], triangles[i+4], triangles[i+5]),
+                btVector3(triangles[i+6], triangles[i+7], triangles[i+8])
+            );
+        }
+        if (mesh->getNumTriangles() == 0)
+            return false;
+
+        if (bvhBuffer != NULL) {
+            btOptimizedBvh* bvh = static_cast<btOptimizedBvh*>(
+                btOptimizedBvh::deSerializeInPlace(bvhBuffer, bvhBufferSize, false)
+            );
+            if (bvh != NULL) {
+                bvhShape = new btBvhTriangleMeshShape(mesh, true, false);
+                bvhShape->setOptimizedBvh(bvh);
+                return true;
+            }
+            BULLETLOG(warning, "Couldn't load serialized BVH, rebuilding");
+            btAlignedFree(bvhBuffer);
+            bvhBuffer = NULL;
+            bvhBufferSize = 0;
+        }
+        bvhShape = new btBvhTriangleMeshShape(mesh, true);
+        return true;
+    }
+
+    ShapeKind kind;
+    // SHAPE_BOX
+    float32 halfExtents[3];
+    // SHAPE_HULL, 3 values per point
+    std::vector<float32> points;
+    // SHAPE_BVH, 9 values per triangle
+    std::vector<float32> triangles;
+    btTriangleMesh* mesh;
+    btBvhTriangleMeshShape* bvhShape;
+    void* bvhBuffer;
+    uint32 bvhBufferSize;
+};
+
+namespace {
+// Keeps the unit scale data alive for as long as a shape built from it
+struct ShapeDeleter {
+    ShapeDeleter(BulletShapeCache::ShapeDataPtr d) : data(d) {}
+    void operator()(btCollisionShape* shape) {
+        delete shape;
+    }
+    BulletShapeCache::ShapeDataPtr data;
+};
+}
+
+
+BulletShapeCache::BulletShapeCache(Network::IOStrand* main_strand, MeshFetcher fetcher, FingerprintResolver resolver, uint32 nthreads, const String& disk_dir, uint64 disk_budget)
+ : mMainStrand(main_strand),
+   mFetcher(fetcher),
+   mResolver(resolver),
+   mWorkers(NULL),
+   mDiskDir(),
+   mDiskBudget(disk_budget),
+   mDiskUsage(0),
+   mTrimming(false),
+   mSweepThreshold(MinSweepThreshold)
+{
+    mWorkers = new Network::IOServicePool("BulletShapeCache Workers", std::max(nthreads, (uint32)1));
+    mWorkers->startWork();
+    mWorkers->run();
+
+    if (!disk_dir.empty()) {
+        // If absolute, use directly. Otherwise, append to temp directory
+        String dir = Path::Get(Path::DIR_TEMP, disk_dir);
+        try {
+            boost::filesystem::create_directories(dir);
+            mDiskDir = dir;
+            // Find out how much is already stored, trimming if another run
+            // left it over budget
+            mTrimming = true;
+            mWorkers->service()->post(
+                std::tr1::bind(&BulletShapeCache::trimDisk, this, livenessToken()),
+                "BulletShapeCache::trimDisk"
+            );
+        }
+        catch(boost::filesystem::filesystem_error& e) {
+            BULLETLOG(warning, "Couldn't create shape cache directory " << dir << ", shapes won't be saved: " << e.what());
+        }
+    }
+}
+
+BulletShapeCache::~BulletShapeCache() {
+    Liveness::letDie();
+    mWorkers->join();
+    delete mWorkers;
+}
+
+BulletCollisionShapePtr BulletShapeCache::sphere(float32 radius) {
+    BULLETLOG(detailed, "sphere radius: " << radius);
+    return BulletCollisionShapePtr(new btSphereShape(radius));
+}
+
+void BulletShapeCache::getShape(const String& mesh, bulletObjBBox bounds, bulletObjTreatment treatment, float32 scale, ShapeCallback cb) {
+    RequestPtr req(new Request());
+    req->mesh = mesh;
+    // Static objects can use the full mesh (a BVH). Dynamic objects can't
+    // collide with btBvhTriangleMeshShapes, so they need to be simplified to a
+    // convex hull.
+    if (bounds == BULLET_OBJECT_BOUNDS_ENTIRE_OBJECT)
+        req->kind = SHAPE_BOX;
+    else if (treatment == BULLET_OBJECT_TREATMENT_STATIC)
+        req->kind = SHAPE_BVH;
+    else
+        req->kind = SHAPE_HULL;
+    req->scale = scale;
+    // Use the exact bits of the scale so we only share identical shapes
+    uint32 scale_bits;
+    memcpy(&scale_bits, &scale, sizeof(scale_bits));
+    std::ostringstream key;
+    key << mesh << '|' << (uint32)req->kind << '|' << scale_bits;
+    req->key = key.str();
+
+    ShapeMap::iterator it = mShapes.find(req->key);
+    if (it != mShapes.end()) {
+        BulletCollisionShapePtr shape = it->second.lock();
+        if (shape) {
+            cb(shape);
+            return;
+        }
+    }
+
+    // Someone else is already working on it, just wait for them
+    PendingMap::iterator pending_it = mPending.find(req->key);
+    if (pending_it != mPending.end()) {
+        pending_it->second.push_back(cb);
+        return;
+    }
+    mPending[req->key].push_back(cb);
+
+    if (mDiskDir.empty()) {
+        fetchMesh(livenessToken(), req);
+        return;
+    }
+
+    // Shapes are stored by content so a mesh that changes under the same URI
+    // doesn't get a stale shape.
+    mResolver(
+        Transfer::URI(mesh),
+        std::tr1::bind(&BulletShapeCache::handleFingerprint, this, livenessToken(), req, _1)
+    );
+}
+
+void BulletShapeCache::handleFingerprint(Liveness::Token alive, RequestPtr req, const String& fingerprint) {
+    if (!alive) return;
+
+    if (fingerprint.empty()) {
+        fetchMesh(alive, req);
+        return;
+    }
+
+    req->path = diskPath(fingerprint, req->kind);
+    mWorkers->service()->post(
+        std::tr1::bind(&BulletShapeCache::loadFromDisk, this, livenessToken(), req),
+        "BulletShapeCache::loadFromDisk"
+    );
+}
+
+String BulletShapeCache::diskPath(const String& fingerprint, ShapeKind kind) const {
+    std::ostringstream name;
+    name << fingerprint << '-' << (uint32)kind << ShapeFileExtension;
+    return (boost::filesystem::path(mDiskDir) / name.str()).string();
+}
+
+void BulletShapeCache::loadFromDisk(Liveness::Token alive, RequestPtr req) {
+    Liveness::Lock locked(alive);
+    if (!locked) return;
+
+    ShapeDataPtr data = readShapeData(req->kind, req->path);
+    if (!data) {
+        mMainStrand->post(
+            std::tr1::bind(&BulletShapeCache::fetchMesh, this, livenessToken(), req),
+            "BulletShapeCache::fetchMesh"
+        );
+        return;
+    }
+
+    BULLETLOG(detailed, "Loaded collision shape for " << req->mesh << " from " << req->path);
+    // Mark it as recently used so trimming keeps it around
+    try {
+        boost::filesystem::last_write_time(req->path, std::time(NULL));
+    }
+    catch(boost::filesystem::filesystem_error&) {
+    }
+    mMainStrand->post(
+        std::tr1::bind(&BulletShapeCache::finishShape, this, livenessToken(), req, createShape(data, req->scale)),
+        "BulletShapeCache::finishShape"
+    );
+}
+
+void BulletShapeCache::fetchMesh(Liveness::Token alive, RequestPtr req) {
+    if (!alive) return;
+
+    mFetcher(
+        Transfer::URI(req->mesh),
+        std::tr1::bind(&BulletShapeCache::handleMesh, this, livenessToken(), req, _1)
+    );
+}
+
+void BulletShapeCache::handleMesh(Liveness::Token alive, RequestPtr req, Mesh::MeshdataPtr mesh) {
+    if (!alive) return;
+
+    if (!mesh) {
+        finishShape(alive, req, BulletCollisionShapePtr());
+        return;
+    }
+
+    mWorkers->service()->post(
+        std::tr1::bind(&BulletShapeCache::buildFromMesh, this, livenessToken(), req, mesh),
+        "BulletShapeCache::buildFromMesh"
+    );
+}
+
+void BulletShapeCache::buildFromMesh(Liveness::Token alive, RequestPtr req, Mesh::MeshdataPtr mesh) {
+    Liveness::Lock locked(alive);
+    if (!locked) return;
+
+    ShapeDataPtr data = computeShapeData(req->kind, mesh);
+    BulletCollisionShapePtr shape;
+    if (data) {
+        // Store it under the fingerprint of the data we actually got, which
+        // can differ from the one we looked up if the mesh just changed.
+        if (!mDiskDir.empty() && mesh->hash != Transfer::Fingerprint::null()) {
+            String path = diskPath(mesh->hash.convertToHexString(), req->kind);
+            if (writeShapeData(data, path))
+                addDiskUsage(path);
+            else
+                BULLETLOG(warning, "Couldn't save collision shape for " << req->mesh << " to " << path);
+        }
+        shape = createShape(data, req->scale);
+    }
+
+    mMainStrand->post(
+        std::tr1::bind(&BulletShapeCache::finishShape, this, livenessToken(), req, shape),
+        "BulletShapeCache::finishShape"
+    );
+}
+
+void BulletShapeCache::finishShape(Liveness::Token alive, RequestPtr req, BulletCollisionShapePtr shape) {
+    if (!alive) return;
+
+    PendingMap::iterator pending_it = mPending.find(req->key);
+    assert(pending_it != mPending.end());
+    ShapeCallbackList callbacks;
+    callbacks.swap(pending_it->second);
+    mPending.erase(pending_it);
+
+    // Failures aren't cached so they can be retried, e.g. if the mesh is
+    // temporarily unavailable
+    if (shape) {
+        mShapes[req->key] = shape;
+        if (mShapes.size() >= mSweepThreshold)
+            sweep();
+    }
+
+    for(ShapeCallbackList::iterator it = callbacks.begin(); it != callbacks.end(); it++)
+        (*it)(shape);
+}
+
+void BulletShapeCache::addDiskUsage(const String& path) {
+    uint64 size = 0;
+    try {
+        size = boost::filesystem::file_size(path);
+    }
+    catch(boost::filesystem::filesystem_error&) {
+        return;
+    }
+
+    {
+        boost::mutex::scoped_lock lock(mDiskMutex);
+        mDiskUsage += size;
+        if (mDiskUsage <= mDiskBudget || mTrimming) return;
+        mTrimming = true;
+    }
+    mWorkers->service()->post(
+        std::tr1::bind(&BulletShapeCache::trimDisk, this, livenessToken()),
+        "BulletShapeCache::trimDisk"
+    );
+}
+
+void BulletShapeCache::trimDisk(Liveness::Token alive) {
+    Liveness::Lock locked(alive);
+    if (!locked) return;
+
+    namespace fs = boost::filesystem;
+
+    // Shapes ordered by last use, oldest first
+    typedef std::multimap<std::time_t, std::pair<String, uint64> > FileAgeMap;
+    FileAgeMap files;
+    uint64 usage = 0;
+    std::time_t now = std::time(NULL);
+    try {
+        for(fs::directory_iterator it(mDiskDir); it != fs::directory_iterator(); it++) {
+            if (fs::is_directory(it->status())) continue;
+            std::time_t mtime = fs::last_write_time(it->path());
+            if (it->path().extension() == TempFileExtension) {
+                if (now - mtime > AbandonedTempFileAge)
+                    fs::remove(it->path());
+                continue;
+            }
+            if (it->path().extension() != ShapeFileExtension) continue;
+            uint64 size = fs::file_size(it->path());
+            usage += size;
+            files.insert(FileAgeMap::value_type(mtime, std::make_pair(it->path().string(), size)));
+        }
+
+        // Go well under the budget so we aren't trimming after every write
+        if (usage > mDiskBudget) {
+            uint64 target = mDiskBudget / 4 * 3;
+            for(FileAgeMap::iterator it = files.begin(); it != files.end() && usage > target; it++) {
+                fs::remove(it->second.first);
+                usage -= it->second.second;
+            }
+        }
+    }
+    catch(fs::filesystem_error& e) {
+        BULLETLOG(warning, "Error while trimming shape cache " << mDiskDir << ": " << e.what());
+    }
+
+    boost::mutex::scoped_lock lock(mDiskMutex);
+    mDiskUsage = usage;
+    mTrimming = false;
+}
+
+void BulletShapeCache::sweep() {
+    for(ShapeMap::iterator it = mShapes.begin(); it != mShapes.end(); ) {
+        if (it->second.expired())
+            it = mShapes.erase(it);
+        else
+            it++;
+    }
+    // Wait until the table doubles before sweeping again so the cost is
+    // amortized over the inserts.
+    mSweepThreshold = std::max(MinSweepThreshold, (uint32)mShapes.size() * 2);
+}
+
+
+BulletShapeCache::ShapeDataPtr BulletShapeCache::computeShapeData(ShapeKind kind, Mesh::MeshdataPtr mesh) {
+    // Supposedly the system scales every mesh down to a unit sphere and then
+    // scales up by the scale factor from the scene file. We emulate this
+    // behavior here, storing unit sized data, but this should really be on the
+    // CDN side (we retrieve the precomputed bounding box as well as the mesh).
+    BoundingBox3f3f bbox;
+    double mesh_rad;
+    ComputeBounds(mesh, &bbox, &mesh_rad);
+    BULLETLOG(detailed, "bbox: " << bbox << ", radius: " << mesh_rad);
+    if (mesh_rad <= 0) return ShapeDataPtr();
+
+    ShapeDataPtr data(new ShapeData(kind));
+
+    if (kind == SHAPE_BOX) {
+        Vector3f diff = bbox.max() - bbox.min();
+        data->halfExtents[0] = fabs(diff.x / 2) / mesh_rad;
+        data->halfExtents[1] = fabs(diff.y / 2) / mesh_rad;
+        data->halfExtents[2] = fabs(diff.z / 2) / mesh_rad;
+        return data;
+    }
+
+    // The rest of the modes require working with the actual mesh, scaled down
+    // to unit size.
+    Matrix4x4f scale_to_unit = Matrix4x4f::scale(1.f/mesh_rad);
+    Meshdata::GeometryInstanceIterator geoIter = mesh->getGeometryInstanceIterator();
+    uint32 indexInstance;
+    Matrix4x4f transformInstance;
+    std::vector<Vector3f> gVertices;
+    while(geoIter.next(&indexInstance, &transformInstance)) {
+        // Note: Scale to unit *after* transforming the instanced geometry to
+        // its location -- scale_to_unit is applied to the mesh as a whole!
+        transformInstance = scale_to_unit * transformInstance;
+        const GeometryInstance& geoInst = mesh->instances[indexInstance];
+        const SubMeshGeometry& subGeom = mesh->geometry[geoInst.geometryIndex];
+
+        gVertices.clear();
+        for(uint32 j = 0; j < subGeom.positions.size(); j++)
+            gVertices.push_back(transformInstance * subGeom.positions[j]);
+
+        for(uint32 i = 0; i < subGeom.primitives.size(); i++) {
+            const std::vector<unsigned short>& indices = subGeom.primitives[i].indices;
+            // Note the condition on the loop. Sometimes we get lists with weird
+            // setups, e.g. only 2 indices, so we need to make sure all 3
+            // indices we'll use are in range.
+            for(uint32 j = 0; j+2 < indices.size(); j += 3) {
+                if (indices[j] >= gVertices.size() ||
+                    indices[j+1] >= gVertices.size() ||
+                    indices[j+2] >= gVertices.size())
+                    continue;
+                for(uint32 v = 0; v < 3; v++) {
+                    const Vector3f& vert = gVertices[indices[j+v]];
+                    data->triangles.push_back(vert.x);
+                    data->triangles.push_back(vert.y);
+                    data->triangles.push_back(vert.z);
+                }
+            }
+        }
+    }
+    BULLETLOG(detailed, "Num of triangles in mesh: " << data->triangles.size() / 9);
+
+    if (kind == SHAPE_BVH) {
+        if (!data->buildBvh()) return ShapeDataPtr();
+        return data;
+    }
+
+    assert(kind == SHAPE_HULL);
+    btTriangleMesh meshToConstruct(false, false);
+    for(uint32 i = 0; i+8 < data->triangles.size(); i += 9) {
+        meshToConstruct.addTriangle(
+            btVector3(data->triangles[i], data->triangles[i+1], data->triangles[i+2]),
+            btVector3(data->triangles[i+3], data->triangles[i+4], data->triangles[i+5]),
+            btVector3(data->triangles[i+6], data->triangles[i+7], data->triangles[i+8])
+        );
+    }
+    data->triangles.clear();
+    if (meshToConstruct.getNumTriangles() == 0) return ShapeDataPtr();
+
+    BULLETLOG(detailed, "Building simplified convex hull for dynamic per-triangle collisions");
+    btConvexTriangleMeshShape tmpConvexShape(&meshToConstruct);
+    btShapeHull hull(&tmpConvexShape);
+    hull.buildHull(tmpConvexShape.getMargin());
+    BULLETLOG(detailed, " new numVertices = " << hull.numVertices());
+
+    for (int32 i = 0; i < hull.numVertices(); i++) {
+        const btVector3& pt = hull.getVertexPointer()[i];
+        data->points.push_back(pt.x());
+        data->points.push_back(pt.y());
+        data->points.push_back(pt.z());
+    }
+    return data;
+}
+
+BulletCollisionShapePtr BulletShapeCache::createShape(ShapeDataPtr data, float32 scale) {
+    btCollisionShape* shape = NULL;
+    switch(data->kind) {
+      case SHAPE_BOX:
+        shape = new btBoxShape(btVector3(data->halfExtents[0] * scale, data->halfExtents[1] * scale, data->halfExtents[2] * scale));
+        break;
+      case SHAPE_BVH:
+        // Scaling the shared unit BVH avoids rebuilding it for this scale
+        shape = new btScaledBvhTriangleMeshShape(data->bvhShape, btVector3(scale, scale, scale));
+        break;
+      case SHAPE_HULL:
+        {
+            btConvexHullShape* convexShape = new btConvexHullShape();
+            for(uint32 i = 0; i+2 < data->points.size(); i += 3)
+                convexShape->addPoint(btVector3(data->points[i], data->points[i+1], data->points[i+2]));
+            convexShape->setLocalScaling(btVector3(scale, scale, scale));
+            shape = convexShape;
+        }
+        break;
+    }
+    assert(shape != NULL);
+    return BulletCollisionShapePtr(shape, ShapeDeleter(data));
+}
+
+bool BulletShapeCache::writeShapeData(ShapeDataPtr data, const String& path) {
+    void* bvh_buffer = NULL;
+    uint32 bvh_size = 0;
+    if (data->kind == SHAPE_BVH) {
+        btOptimizedBvh* bvh = data->bvhShape->getOptimizedBvh();
+        bvh_size = bvh->calculateSerializeBufferSize();
+        bvh_buffer = btAlignedAlloc(bvh_size, 16);
+        if (!bvh->serialize(bvh_buffer, bvh_size, false)) {
+            btAlignedFree(bvh_buffer);
+            return false;
+        }
+    }
+
+    // Write to a temporary file and move it into place so readers never see a
+    // partially written file. The name is unique so concurrent writers, in
+    // this process or another sharing the directory, can't interleave.
+    String tmp_path = path + "." + UUID::random().rawHexData() + TempFileExtension;
+    bool success = false;
+    {
+        std::ofstream fp(tmp_path.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+        uint32 header[3] = { ShapeFileMagic, ShapeFileVersion, (uint32)data->kind };
+        fp.write((const char*)header, sizeof(header));
+        switch(data->kind) {
+          case SHAPE_BOX:
+            fp.write((const char*)data->halfExtents, sizeof(data->halfExtents));
+            break;
+          case SHAPE_HULL:
+            {
+                uint32 count = data->points.size();
+                fp.write((const char*)&count, sizeof(count));
+                if (count > 0)
+                    fp.write((const char*)&data->points[0], count * sizeof(float32));
+            }
+            break;
+          case SHAPE_BVH:
+            {
+                uint32 count = data->triangles.size();
+                fp.write((const char*)&count, sizeof(count));
+                fp.write((const char*)&data->triangles[0], count * sizeof(float32));
+                fp.write((const char*)&bvh_size, sizeof(bvh_size));
+                fp.write((const char*)bvh_buffer, bvh_size);
+            }
+            break;
+        }
+        success = fp.good();
+    }
+    if (bvh_buffer != NULL)
+        btAlignedFree(bvh_buffer);
+
+    try {
+        if (success)
+            boost::filesystem::rename(tmp_path, path);
+        else
+            boost::filesystem::remove(tmp_path);
+    }
+    catch(boost::filesystem::filesystem_error&) {
+        success = false;
+    }
+    return success;
+}
+
+BulletShapeCache::ShapeDataPtr BulletShapeCache::readShapeData(ShapeKind kind, const String& path) {
+    std::ifstream fp(path.c_str(), std::ios::in | std::ios::binary);
+    if (!fp) return ShapeDataPtr();
+
+    // Sizes read from the file are checked against what's left in it so a
+    // corrupt file can't trigger huge allocations or reads past the end.
+    fp.seekg(0, std::ios::end);
+    std::streamoff file_size = fp.tellg();
+    fp.seekg(0, std::ios::beg);
+    if (!fp || file_size < 0) return ShapeDataPtr();
+
+    uint32 header[3];
+    fp.read((char*)header, sizeof(header));
+    if (!fp || header[0] != ShapeFileMagic || header[1] != ShapeFileVersion || header[2] != (uint32)kind)
+        return ShapeDataPtr();
+
+    ShapeDataPtr data(new ShapeData(kind));
+    switch(kind) {
+      case SHAPE_BOX:
+        fp.read((char*)data->halfExtents, sizeof(data->halfExtents));
+        break;
+      case SHAPE_HULL:
+        {
+            uint32 count = 0;
+            fp.read((char*)&count, sizeof(count));
+            if (!fp || count % 3 != 0 || (uint64)count * sizeof(float32) > bytesRemaining(fp, file_size))
+                return ShapeDataPtr();
+            data->points.resize(count);
+            if (count > 0)
+                fp.read((char*)&data->points[0], count * sizeof(float32));
+        }
+        break;
+      case SHAPE_BVH:
+        {
+            uint32 count = 0;
+            fp.read((char*)&count, sizeof(count));
+            if (!fp || count == 0 || count % 9 != 0 || (uint64)count * sizeof(float32) > bytesRemaining(fp, file_size))
+                return ShapeDataPtr();
+            data->triangles.resize(count);
+            fp.read((char*)&data->triangles[0], count * sizeof(float32));
+            fp.read((char*)&data->bvhBufferSize, sizeof(data->bvhBufferSize));
+            if (!fp || data->bvhBufferSize == 0 || data->bvhBufferSize > bytesRemaining(fp, file_size))
+                return ShapeDataPtr();
+            // deSerializeInPlace requires 16 byte alignment
+            data->bvhBuffer = btAlignedAlloc(data->bvhBufferSize, 16);
+            fp.read((char*)data->bvhBuffer, data->bvhBufferSize);
+        }
+        break;
+    }
+    if (!fp) return ShapeDataPtr();
+
+    if (kind == SHAPE_BVH && !data->buildBvh())
+        return ShapeDataPtr();
+    return data;
+}
+
+} // namespace Sirikata
@@ -0,0 +1,161 @@
+// Copyright (c) 2015 Sirikata Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can
+// be found in the LICENSE file.
+
+#ifndef _SIRIKATA_BULLET_PHYSICS_SHAPE_CACHE_HPP_
+#define _SIRIKATA_BULLET_PHYSICS_SHAPE_CACHE_HPP_
+
+#include "Defs.hpp"
+#include <sirikata/core/util/Liveness.hpp>
+#include <sirikata/core/network/IOStrand.hpp>
+#include <sirikata/core/network/IOServicePool.hpp>
+#include <sirikata/core/transfer/URI.hpp>
+#include <boost/thread/mutex.hpp>
+
+class btCollisionShape;
+
+namespace Sirikata {
+
+typedef std::tr1::shared_ptr<btCollisionShape> BulletCollisionShapePtr;
+
+/** Shares collision shapes between objects that use the same mesh. Shapes are
+ *  keyed by mesh URI, the kind of shape the bounds and treatment settings
+ *  call for, and scale, and are reference counted so they are freed once the
+ *  last object using them is unloaded.
+ *
+ *  Building a shape (parsing the mesh, building a convex hull or BVH) happens
+ *  on a pool of worker threads, and concurrent requests for the same shape
+ *  wait for a single build. The unit scale geometry for each mesh and shape
+ *  kind is also saved to disk, keyed by the content fingerprint of the mesh, so
+ *  later runs, and other scales of the same mesh, can skip both the download
+ *  and the build. The directory is kept under a size budget by removing the
+ *  least recently used shapes.
+ *
+ *  Except where noted, methods must be called from the main strand.
+ */
+class BulletShapeCache : public Liveness {
+public:
+    typedef std::tr1::function<void(Mesh::MeshdataPtr)> MeshCallback;
+    /** Function which downloads and parses a mesh, invoking the callback on the
+     *  main strand with the mesh, or NULL if it couldn't be loaded.
+     */
+    typedef std::tr1::function<void(const Transfer::URI&, MeshCallback)> MeshFetcher;
+    typedef std::tr1::function<void(const String&)> FingerprintCallback;
+    /** Function which looks up the content fingerprint (as hex) for a mesh,
+     *  invoking the callback on the main strand with it, or an empty string if
+     *  it couldn't be found.
+     */
+    typedef std::tr1::function<void(const Transfer::URI&, FingerprintCallback)> FingerprintResolver;
+    /** Callback for a shape request, NULL if the shape couldn't be built. */
+    typedef std::tr1::function<void(BulletCollisionShapePtr)> ShapeCallback;
+
+    /** Create a cache.
+     *  \param main_strand the strand callbacks are invoked on
+     *  \param fetcher used to download meshes on cache misses
+     *  \param resolver used to find the fingerprint of a mesh to look it up
+     *                  on disk
+     *  \param nthreads number of threads to build shapes with
+     *  \param disk_dir directory to persist shapes to, relative to the
+     *                  temporary directory if not absolute. Empty disables
+     *                  persistence.
+     *  \param disk_budget maximum number of bytes to store in disk_dir
+     */
+    BulletShapeCache(Network::IOStrand* main_strand, MeshFetcher fetcher, FingerprintResolver resolver, uint32 nthreads, const String& disk_dir, uint64 disk_budget);
+    ~BulletShapeCache();
+
+    /** Get the shape for the given mesh with mesh based bounds (i.e. box or
+     *  per-triangle). The callback may be invoked before this returns if the
+     *  shape is already loaded.
+     */
+    void getShape(const String& mesh, bulletObjBBox bounds, bulletObjTreatment treatment, float32 scale, ShapeCallback cb);
+
+    /** Sphere shapes are cheap, so they aren't cached. This is safe to call
+     *  from any thread.
+     */
+    static BulletCollisionShapePtr sphere(float32 radius);
+
+    /** Number of shapes currently tracked, including any which have been
+     *  released but not yet cleaned up.
+     */
+    uint32 size() const { return mShapes.size(); }
+    /** Number of shapes being loaded or built. */
+    uint32 pending() const { return mPending.size(); }
+
+    // Unit scale geometry for a shape. Defined in the implementation.
+    struct ShapeData;
+    typedef std::tr1::shared_ptr<ShapeData> ShapeDataPtr;
+
+private:
+    enum ShapeKind {
+        SHAPE_BOX,
+        SHAPE_BVH,
+        SHAPE_HULL
+    };
+
+    struct Request {
+        String mesh;
+        ShapeKind kind;
+        float32 scale;
+        // Key for the in memory cache, which includes the scale
+        String key;
+        // Path of the on disk version, which only depends on the mesh's
+        // fingerprint and the kind, or empty if it isn't known
+        String path;
+    };
+    typedef std::tr1::shared_ptr<Request> RequestPtr;
+
+    // Main strand: got the fingerprint, check the disk if we can
+    void handleFingerprint(Liveness::Token alive, RequestPtr req, const String& fingerprint);
+    // Worker thread: try to load the data from disk, falling back to the mesh
+    void loadFromDisk(Liveness::Token alive, RequestPtr req);
+    // Main strand: the data wasn't on disk, start a download
+    void fetchMesh(Liveness::Token alive, RequestPtr req);
+    void handleMesh(Liveness::Token alive, RequestPtr req, Mesh::MeshdataPtr mesh);
+    // Worker thread: compute the data from the mesh and save it
+    void buildFromMesh(Liveness::Token alive, RequestPtr req, Mesh::MeshdataPtr mesh);
+    // Main strand: store the result and invoke callbacks
+    void finishShape(Liveness::Token alive, RequestPtr req, BulletCollisionShapePtr shape);
+
+    // Helpers which can be used from any thread
+    static ShapeDataPtr computeShapeData(ShapeKind kind, Mesh::MeshdataPtr mesh);
+    static BulletCollisionShapePtr createShape(ShapeDataPtr data, float32 scale);
+    static bool writeShapeData(ShapeDataPtr data, const String& path);
+    static ShapeDataPtr readShapeData(ShapeKind kind, const String& path);
+    String diskPath(const String& fingerprint, ShapeKind kind) const;
+
+    // Worker thread: account for a newly written file and trim the directory
+    // if it's over budget.
+    void addDiskUsage(const String& path);
+    // Worker thread: recompute disk usage, removing the least recently used
+    // shapes and abandoned temporary files until it's under budget.
+    void trimDisk(Liveness::Token alive);
+
+    // Remove entries for shapes that have been freed.
+    void sweep();
+
+    Network::IOStrand* mMainStrand;
+    MeshFetcher mFetcher;
+    FingerprintResolver mResolver;
+    Network::IOServicePool* mWorkers;
+    String mDiskDir;
+
+    // Protects the disk accounting, which is updated by the workers
+    boost::mutex mDiskMutex;
+    uint64 mDiskBudget;
+    uint64 mDiskUsage;
+    bool mTrimming;
+
+    typedef std::tr1::weak_ptr<btCollisionShape> WeakCollisionShapePtr;
+    typedef std::tr1::unordered_map<String, WeakCollisionShapePtr> ShapeMap;
+    ShapeMap mShapes;
+    // Table size which triggers the next sweep
+    uint32 mSweepThreshold;
+
+    typedef std::vector<ShapeCallback> ShapeCallbackList;
+    typedef std::tr1::unordered_map<String, ShapeCallbackList> PendingMap;
+    PendingMap mPending;
+}; // class BulletShapeCache
+
+} // namespace Sirikata
+
+#endif //_SIRIKATA_BULLET_PHYSICS_SHAPE_CACHE_HPP_
@@ -9,6 +9,7 @@
 #include <sirikata/core/util/UUID.hpp>
 #include <sirikata/mesh/Meshdata.hpp>
 #include <sirikata/core/util/PresenceProperties.hpp>
+#include <sirikata/core/util/InternedString.hpp>
 
 namespace Sirikata {
 
@@ -66,22 +67,27 @@ struct LocationInfo {
      : props(),
        local(),
        aggregate(),
-       simObject(NULL)
+       simObject(NULL),
+       simGeneration(0)
     {}
 
-    // Regular location info that we need to maintain for all objects
+    // Regular location info that we need to maintain for all objects. The
+    // mesh, physics and query data values in props are not used, only their
+    // sequence numbers. The values are stored in the interned handles below
+    // since they are often shared by many objects.
     SequencedPresenceProperties props;
-    // NOTE: This is a copy of props.mesh(), which *is not always valid*. It's
-    // only used for the accessor, when returning by const& since we don't have
-    // a String version within props. DO NOT use anywhere else.
-    String mesh_copied_str;
-    String physics_copied_str;
-    String query_data_copied_str;
+    InternedString mesh;
+    InternedString physics;
+    InternedString query_data;
 
     bool local;
     bool aggregate;
 
     BulletObject* simObject;
+    // Set to a new, service-wide unique value each time simObject is
+    // replaced, so asynchronous loads for a previous simObject can be detected
+    // and ignored
+    uint32 simGeneration;
 };
 
 } // namespace Sirikata
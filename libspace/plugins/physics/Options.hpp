@@ -0,0 +1,13 @@
+// Copyright (c) 2015 Sirikata Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can
+// be found in the LICENSE file.
+
+#ifndef _SIRIKATA_SPACE_BULLET_PHYSICS_OPTIONS_HPP_
+#define _SIRIKATA_SPACE_BULLET_PHYSICS_OPTIONS_HPP_
+
+#define OPT_BULLET_SHAPE_THREADS       "bulletphysics.shape-threads"
+#define OPT_BULLET_SHAPE_CACHE_DIR     "bulletphysics.shape-cache-dir"
+#define OPT_BULLET_SHAPE_CACHE_SIZE    "bulletphysics.shape-cache-size"
+#define OPT_BULLET_SOLVER_THREADS      "bulletphysics.solver-threads"
+
+#endif //_SIRIKATA_SPACE_BULLET_PHYSICS_OPTIONS_HPP_
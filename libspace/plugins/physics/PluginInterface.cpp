@@ -31,9 +31,11 @@
  */
 
 #include <sirikata/core/util/Platform.hpp>
+#include <sirikata/core/options/Options.hpp>
 #include <sirikata/space/LocationService.hpp>
 
 #include "BulletPhysicsService.hpp"
+#include "Options.hpp"
 //#include "AlwaysLocationUpdatePolicy.hpp"
 
 static int space_bulletphysics_plugin_refcount = 0;
@@ -42,6 +44,12 @@ namespace Sirikata {
 
 static void InitPluginOptions() {
     //InitAlwaysLocationUpdatePolicyOptions();
+    InitializeClassOptions::module(SIRIKATA_OPTIONS_MODULE)
+        .addOption(new OptionValue(OPT_BULLET_SHAPE_THREADS, "2", Sirikata::OptionValueType<uint32>(), "Number of threads used to build collision shapes."))
+        .addOption(new OptionValue(OPT_BULLET_SHAPE_CACHE_DIR, "BulletShapeCache", Sirikata::OptionValueType<String>(), "Directory to save built collision shapes to, relative to the temporary directory if not absolute. Empty disables saving shapes."))
+        .addOption(new OptionValue(OPT_BULLET_SHAPE_CACHE_SIZE, "256", Sirikata::OptionValueType<uint32>(), "Maximum size of the collision shape directory in MB. The least recently used shapes are removed when it's exceeded."))
+        .addOption(new OptionValue(OPT_BULLET_SOLVER_THREADS, "1", Sirikata::OptionValueType<uint32>(), "Number of threads used for collision dispatch and constraint solving. Values above 1 require bullet's multithreaded library; otherwise the simulation always runs on the main thread."))
+        ;
 }
 
 static LocationService* createStandardLoc(SpaceContext* ctx, LocationUpdatePolicy* update_policy, const String& args) {
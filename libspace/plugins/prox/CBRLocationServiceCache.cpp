@@ -46,7 +46,8 @@ CBRLocationServiceCache::CBRLocationServiceCache(Network::IOStrand* strand, Loca
    mWithReplicas(replicas)
 {
     assert(mLoc != NULL);
-    mLoc->addListener(this, true);
+    // Motion updates are batched so we only need one strand task per tick
+    mLoc->addListener(this, true, true);
 }
 
 CBRLocationServiceCache::~CBRLocationServiceCache() {
@@ -150,7 +151,7 @@ String CBRLocationServiceCache::mesh(const Iterator& id)  {
   ObjectDataMap::iterator it = itdat->it;
   assert(it != mObjects.end());
 
-  return it->second.mesh;
+  return it->second.mesh.str();
 }
 
 String CBRLocationServiceCache::queryData(const Iterator& id)  {
@@ -159,7 +160,7 @@ String CBRLocationServiceCache::queryData(const Iterator& id)  {
   ObjectDataMap::iterator it = itdat->it;
   assert(it != mObjects.end());
 
-  return it->second.query_data;
+  return it->second.query_data.str();
 }
 
 Vector3f CBRLocationServiceCache::centerOffset(const Iterator& id) {
@@ -242,17 +243,17 @@ AggregateBoundingInfo CBRLocationServiceCache::bounds(const ObjectID& id) {
 
 Transfer::URI CBRLocationServiceCache::mesh(const ObjectID& id) {
     GET_OBJ_ENTRY(id);
-    return Transfer::URI(it->second.mesh);
+    return Transfer::URI(it->second.mesh.str());
 }
 
 String CBRLocationServiceCache::physics(const ObjectID& id) {
     GET_OBJ_ENTRY(id);
-    return it->second.physics;
+    return it->second.physics.str();
 }
 
 String CBRLocationServiceCache::queryData(const ObjectID& id) {
     GET_OBJ_ENTRY(id);
-    return it->second.query_data;
+    return it->second.query_data.str();
 }
 
 
@@ -340,6 +341,26 @@ void CBRLocationServiceCache::replicaQueryDataUpdated(const UUID& uuid, const St
         queryDataUpdated(uuid, false, newval);
 }
 
+void CBRLocationServiceCache::motionUpdated(const LocationServiceListener::MotionUpdateList& updates) {
+    MotionUpdateListPtr batch(new LocationServiceListener::MotionUpdateList());
+    if (mWithReplicas) {
+        batch->assign(updates.begin(), updates.end());
+    }
+    else {
+        for(LocationServiceListener::MotionUpdateList::const_iterator it = updates.begin(); it != updates.end(); it++)
+            if (it->local) batch->push_back(*it);
+    }
+    if (batch->empty()) return;
+
+    mStrand->post(
+        std::tr1::bind(
+            &CBRLocationServiceCache::processMotionUpdated, this,
+            batch
+        ),
+        "CBRLocationServiceCache::processMotionUpdated"
+    );
+}
+
 
 void CBRLocationServiceCache::objectAdded(const UUID& uuid, bool islocal, bool agg, const TimedMotionVector3f& loc, const TimedMotionQuaternion& orient, const AggregateBoundingInfo& bounds, const String& mesh, const String& phy, const String& query_data) {
     // This looks a bit odd compared to some other similar methods. We check for
@@ -359,9 +380,9 @@ void CBRLocationServiceCache::objectAdded(const UUID& uuid, bool islocal, bool a
     data.location = loc;
     data.orientation = orient;
     data.bounds = bounds;
-    data.mesh = mesh;
-    data.physics = phy;
-    data.query_data = query_data;
+    data.mesh = mLoc->intern(mesh);
+    data.physics = mLoc->intern(phy);
+    data.query_data = mLoc->intern(query_data);
     data.isLocal = islocal;
     data.exists = 1;
     data.tracking = 0;
@@ -488,6 +509,53 @@ void CBRLocationServiceCache::processLocationUpdated(const ObjectReference& uuid
     }
 }
 
+void CBRLocationServiceCache::processMotionUpdated(MotionUpdateListPtr updates) {
+    typedef LocationServiceListener::MotionUpdate MotionUpdate;
+    // Previous values for updates listeners need to hear about, stored in the
+    // same format, paired with the index of the new values
+    typedef std::vector< std::pair<uint32, MotionUpdate> > OldValueList;
+    OldValueList old_vals;
+    {
+        Lock lck(mDataMutex);
+
+        for(uint32 i = 0; i < updates->size(); i++) {
+            const MotionUpdate& update = (*updates)[i];
+            ObjectDataMap::iterator it = mObjects.find(ObjectReference(update.uuid));
+            if (it == mObjects.end()) continue;
+
+            if (!update.agg && (update.changed & (LocationServiceListener::MOTION_LOCATION | LocationServiceListener::MOTION_BOUNDS))) {
+                old_vals.push_back(std::make_pair(i, update));
+                old_vals.back().second.location = it->second.location;
+                old_vals.back().second.bounds = it->second.bounds;
+            }
+
+            if (update.changed & LocationServiceListener::MOTION_LOCATION)
+                it->second.location = update.location;
+            if (update.changed & LocationServiceListener::MOTION_ORIENTATION)
+                it->second.orientation = update.orientation;
+            if (update.changed & LocationServiceListener::MOTION_BOUNDS)
+                it->second.bounds = update.bounds;
+        }
+    }
+
+    if (old_vals.empty()) return;
+
+    Lock lck(mListenerMutex);
+    for(OldValueList::const_iterator old_it = old_vals.begin(); old_it != old_vals.end(); old_it++) {
+        const MotionUpdate& update = (*updates)[old_it->first];
+        const MotionUpdate& old = old_it->second;
+        ObjectReference uuid(update.uuid);
+        for(ListenerSet::iterator listen_it = mListeners.begin(); listen_it != mListeners.end(); listen_it++) {
+            if (update.changed & LocationServiceListener::MOTION_LOCATION)
+                (*listen_it)->locationPositionUpdated(uuid, old.location, update.location);
+            if (update.changed & LocationServiceListener::MOTION_BOUNDS) {
+                (*listen_it)->locationRegionUpdated(uuid, old.bounds.centerBounds(), update.bounds.centerBounds());
+                (*listen_it)->locationMaxSizeUpdated(uuid, old.bounds.maxObjectRadius, update.bounds.maxObjectRadius);
+            }
+        }
+    }
+}
+
 void CBRLocationServiceCache::orientationUpdated(const UUID& uuid, bool agg, const TimedMotionQuaternion& newval) {
     mStrand->post(
         std::tr1::bind(
@@ -542,18 +610,17 @@ void CBRLocationServiceCache::meshUpdated(const UUID& uuid, bool agg, const Stri
     mStrand->post(
         std::tr1::bind(
             &CBRLocationServiceCache::processMeshUpdated, this,
-            ObjectReference(uuid), agg, newval
+            ObjectReference(uuid), agg, mLoc->intern(newval)
         ),
         "CBRLocationServiceCache::processMeshUpdated"
     );
 }
 
-void CBRLocationServiceCache::processMeshUpdated(const ObjectReference& uuid, bool agg, const String& newval) {
+void CBRLocationServiceCache::processMeshUpdated(const ObjectReference& uuid, bool agg, const InternedString& newval) {
     Lock lck(mDataMutex);
 
     ObjectDataMap::iterator it = mObjects.find(uuid);
     if (it == mObjects.end()) return;
-    String oldval = it->second.mesh;
     it->second.mesh = newval;
 }
 
@@ -561,18 +628,17 @@ void CBRLocationServiceCache::physicsUpdated(const UUID& uuid, bool agg, const S
     mStrand->post(
         std::tr1::bind(
             &CBRLocationServiceCache::processPhysicsUpdated, this,
-            ObjectReference(uuid), agg, newval
+            ObjectReference(uuid), agg, mLoc->intern(newval)
         ),
         "CBRLocationServiceCache::processPhysicsUpdated"
     );
 }
 
-void CBRLocationServiceCache::processPhysicsUpdated(const ObjectReference& uuid, bool agg, const String& newval) {
+void CBRLocationServiceCache::processPhysicsUpdated(const ObjectReference& uuid, bool agg, const InternedString& newval) {
     Lock lck(mDataMutex);
 
     ObjectDataMap::iterator it = mObjects.find(uuid);
     if (it == mObjects.end()) return;
-    String oldval = it->second.physics;
     it->second.physics = newval;
 }
 
@@ -581,14 +647,14 @@ void CBRLocationServiceCache::queryDataUpdated(const UUID& uuid, bool agg, const
     mStrand->post(
         std::tr1::bind(
             &CBRLocationServiceCache::processQueryDataUpdated, this,
-            ObjectReference(uuid), agg, newval
+            ObjectReference(uuid), agg, mLoc->intern(newval)
         ),
         "CBRLocationServiceCache::processQueryDataUpdated"
     );
 }
 
-void CBRLocationServiceCache::processQueryDataUpdated(const ObjectReference& uuid, bool agg, const String& newval) {
-    String oldval;
+void CBRLocationServiceCache::processQueryDataUpdated(const ObjectReference& uuid, bool agg, const InternedString& newval) {
+    InternedString oldval;
     {
         Lock lck(mDataMutex);
 
@@ -601,7 +667,7 @@ void CBRLocationServiceCache::processQueryDataUpdated(const ObjectReference& uui
     if (!agg) {
         Lock lck(mListenerMutex);
         for(ListenerSet::iterator listen_it = mListeners.begin(); listen_it != mListeners.end(); listen_it++) {
-            (*listen_it)->locationQueryDataUpdated(uuid, oldval, newval);
+            (*listen_it)->locationQueryDataUpdated(uuid, oldval.str(), newval.str());
         }
     }
 }
@@ -124,6 +124,7 @@ public:
     virtual void replicaMeshUpdated(const UUID& uuid, const String& newval);
     virtual void replicaPhysicsUpdated(const UUID& uuid, const String& newval);
     virtual void replicaQueryDataUpdated(const UUID& uuid, const String& newval);
+    virtual void motionUpdated(const LocationServiceListener::MotionUpdateList& updates);
 
 private:
     // Object data is only accessed in the prox thread (by libprox
@@ -135,9 +136,11 @@ private:
         AggregateBoundingInfo bounds;
         // Whether the object is local or a replica
         bool isLocal;
-        String mesh;
-        String physics;
-        String query_data;
+        // Interned through the LocationService since they're frequently
+        // shared and we copy ObjectData across strands
+        InternedString mesh;
+        InternedString physics;
+        InternedString query_data;
         int8 exists; // Exists, i.e. xObjectRemoved hasn't been called. Refcount
                      // because we can have migration events on other servers
                      // where the object moves from A -> B, but B notifies us of
@@ -168,9 +171,11 @@ private:
     void processLocationUpdated(const ObjectReference& uuid, bool agg, const TimedMotionVector3f& newval);
     void processOrientationUpdated(const ObjectReference& uuid, bool agg, const TimedMotionQuaternion& newval);
     void processBoundsUpdated(const ObjectReference& uuid, bool agg, const AggregateBoundingInfo& newval);
-    void processMeshUpdated(const ObjectReference& uuid, bool agg, const String& newval);
-    void processPhysicsUpdated(const ObjectReference& uuid, bool agg, const String& newval);
-    void processQueryDataUpdated(const ObjectReference& uuid, bool agg, const String& newval);
+    void processMeshUpdated(const ObjectReference& uuid, bool agg, const InternedString& newval);
+    void processPhysicsUpdated(const ObjectReference& uuid, bool agg, const InternedString& newval);
+    void processQueryDataUpdated(const ObjectReference& uuid, bool agg, const InternedString& newval);
+    typedef std::tr1::shared_ptr<LocationServiceListener::MotionUpdateList> MotionUpdateListPtr;
+    void processMotionUpdated(MotionUpdateListPtr updates);
 
 
     CBRLocationServiceCache();
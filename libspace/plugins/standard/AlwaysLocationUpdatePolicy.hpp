@@ -103,9 +103,11 @@ private:
         TimedMotionVector3f location;
         TimedMotionQuaternion orientation;
         AggregateBoundingInfo bounds;
-        String mesh;
-        String physics;
-        String query_data;
+        // Handles from the LocationService, so queuing an update for each
+        // subscriber doesn't copy the strings
+        InternedString mesh;
+        InternedString physics;
+        InternedString query_data;
     };
 
     typedef std::set<UUID> UUIDSet;
@@ -604,12 +606,12 @@ private:
                 new_ui.epoch = locservice->epoch(uuid);
                 new_ui.location = locservice->location(uuid);
                 new_ui.bounds = locservice->bounds(uuid);
-                new_ui.mesh = locservice->mesh(uuid);
+                new_ui.mesh = locservice->meshHandle(uuid);
                 new_ui.orientation = locservice->orientation(uuid);
-                new_ui.physics = locservice->physics(uuid);
-                // Don't bother copying possibly big data if not necessary
+                new_ui.physics = locservice->physicsHandle(uuid);
+                // Don't bother tracking possibly big data if not necessary
                 if (send_all_data)
-                    new_ui.query_data = locservice->queryData(uuid);
+                    new_ui.query_data = locservice->queryDataHandle(uuid);
                 sub_info->outstandingUpdates[uuid] = new_ui;
             }
             else
@@ -624,9 +626,9 @@ private:
         static void setUILocation(UpdateInfo& ui, const TimedMotionVector3f& newval) {ui.location = newval; }
         static void setUIOrientation(UpdateInfo& ui, const TimedMotionQuaternion& newval) { ui.orientation = newval; }
         static void setUIBounds(UpdateInfo& ui, const AggregateBoundingInfo& newval) { ui.bounds = newval; }
-        static void setUIMesh(UpdateInfo& ui, const String& newval) {ui.mesh = newval;}
-        static void setUIPhysics(UpdateInfo& ui, const String& newval) {ui.physics = newval;}
-        static void setUIQueryData(UpdateInfo& ui, const String& newval) {ui.query_data = newval;}
+        static void setUIMesh(UpdateInfo& ui, const InternedString& newval) {ui.mesh = newval;}
+        static void setUIPhysics(UpdateInfo& ui, const InternedString& newval) {ui.physics = newval;}
+        static void setUIQueryData(UpdateInfo& ui, const InternedString& newval) {ui.query_data = newval;}
 
         void locationUpdated(const UUID& uuid, const TimedMotionVector3f& newval, LocationService* locservice) {
             propertyUpdated(
@@ -652,14 +654,14 @@ private:
         void meshUpdated(const UUID& uuid, const String& newval, LocationService* locservice) {
             propertyUpdated(
                 uuid, locservice,
-                std::tr1::bind(&setUIMesh, std::tr1::placeholders::_1, newval)
+                std::tr1::bind(&setUIMesh, std::tr1::placeholders::_1, locservice->intern(newval))
             );
         }
 
         void physicsUpdated(const UUID& uuid, const String& newval, LocationService* locservice) {
             propertyUpdated(
                 uuid, locservice,
-                std::tr1::bind(&setUIPhysics, std::tr1::placeholders::_1, newval)
+                std::tr1::bind(&setUIPhysics, std::tr1::placeholders::_1, locservice->intern(newval))
             );
         }
 
@@ -669,7 +671,7 @@ private:
 
             propertyUpdated(
                 uuid, locservice,
-                std::tr1::bind(&setUIQueryData, std::tr1::placeholders::_1, newval)
+                std::tr1::bind(&setUIQueryData, std::tr1::placeholders::_1, locservice->intern(newval))
             );
         }
 
@@ -738,11 +740,11 @@ private:
                     msg_bounds.set_center_bounds_radius(up_it->second.bounds.centerBoundsRadius);
                     msg_bounds.set_max_object_size(up_it->second.bounds.maxObjectRadius);
 
-                    update.set_mesh(up_it->second.mesh);
-                    update.set_physics(up_it->second.physics);
+                    update.set_mesh(up_it->second.mesh.str());
+                    update.set_physics(up_it->second.physics.str());
                     // Don't bother copying possibly big data if not necessary
                     if (send_all_data)
-                        update.set_query_data(up_it->second.query_data);
+                        update.set_query_data(up_it->second.query_data.str());
 
                     // If we hit the limit for this update, try to send it out
                     if (bulk_update.update_size() > (int32)max_updates) {
@@ -62,7 +62,7 @@ uint64 StandardLocationService::epoch(const UUID& uuid) {
     LocationMap::iterator it = mLocations.find(uuid);
     assert(it != mLocations.end());
 
-    LocationInfo locinfo = it->second;
+    const LocationInfo& locinfo = it->second;
     return locinfo.props.maxSeqNo();
 }
 
@@ -70,7 +70,7 @@ TimedMotionVector3f StandardLocationService::location(const UUID& uuid) {
     LocationMap::iterator it = mLocations.find(uuid);
     assert(it != mLocations.end());
 
-    LocationInfo locinfo = it->second;
+    const LocationInfo& locinfo = it->second;
     return locinfo.props.location();
 }
 
@@ -84,7 +84,7 @@ TimedMotionQuaternion StandardLocationService::orientation(const UUID& uuid) {
     LocationMap::iterator it = mLocations.find(uuid);
     assert(it != mLocations.end());
 
-    LocationInfo locinfo = it->second;
+    const LocationInfo& locinfo = it->second;
     return locinfo.props.orientation();
 }
 
@@ -97,35 +97,52 @@ AggregateBoundingInfo StandardLocationService::bounds(const UUID& uuid) {
     LocationMap::iterator it = mLocations.find(uuid);
     assert(it != mLocations.end());
 
-    LocationInfo locinfo = it->second;
+    const LocationInfo& locinfo = it->second;
     return locinfo.props.bounds();
 }
 
 const String& StandardLocationService::mesh(const UUID& uuid) {
-    LocationMap::iterator it = mLocations.find(uuid);
-    assert(it != mLocations.end());
-
-    LocationInfo& locinfo = it->second;
-    locinfo.mesh_copied_str = locinfo.props.mesh().toString();
-    return locinfo.mesh_copied_str;
+    return meshHandle(uuid).str();
 }
 
 const String& StandardLocationService::physics(const UUID& uuid) {
+    return physicsHandle(uuid).str();
+}
+
+const String& StandardLocationService::queryData(const UUID& uuid) {
+    return queryDataHandle(uuid).str();
+}
+
+InternedString StandardLocationService::meshHandle(const UUID& uuid) {
     LocationMap::iterator it = mLocations.find(uuid);
     assert(it != mLocations.end());
+    return it->second.mesh;
+}
 
-    LocationInfo& locinfo = it->second;
-    locinfo.physics_copied_str = locinfo.props.physics();
-    return locinfo.physics_copied_str;
+InternedString StandardLocationService::physicsHandle(const UUID& uuid) {
+    LocationMap::iterator it = mLocations.find(uuid);
+    assert(it != mLocations.end());
+    return it->second.physics;
 }
 
-const String& StandardLocationService::queryData(const UUID& uuid) {
+InternedString StandardLocationService::queryDataHandle(const UUID& uuid) {
     LocationMap::iterator it = mLocations.find(uuid);
     assert(it != mLocations.end());
+    return it->second.query_data;
+}
 
-    LocationInfo& locinfo = it->second;
-    locinfo.query_data_copied_str = locinfo.props.queryData();
-    return locinfo.query_data_copied_str;
+InternedString StandardLocationService::internMesh(const String& msh) {
+    return intern(Transfer::URI(msh).toString());
+}
+
+void StandardLocationService::initLocationInfo(LocationInfo& locinfo, const TimedMotionVector3f& loc, const TimedMotionQuaternion& orient, const AggregateBoundingInfo& bnds, const String& msh, const String& phy, const String& query_data) {
+    locinfo.props.reset();
+    locinfo.props.setLocation(loc, 0);
+    locinfo.props.setOrientation(orient, 0);
+    locinfo.props.setBounds(bnds, 0);
+    locinfo.mesh = internMesh(msh);
+    locinfo.physics = intern(phy);
+    locinfo.query_data = intern(query_data);
 }
 
   void StandardLocationService::addLocalObject(const UUID& uuid, const TimedMotionVector3f& loc, const TimedMotionQuaternion& orient, const AggregateBoundingInfo& bnds, const String& msh, const String& phy, const String& query_data) {
@@ -143,13 +160,7 @@ const String& StandardLocationService::queryData(const UUID& uuid) {
     }
 
     LocationInfo& locinfo = it->second;
-    locinfo.props.reset();
-    locinfo.props.setLocation(loc, 0);
-    locinfo.props.setOrientation(orient, 0);
-    locinfo.props.setBounds(bnds, 0);
-    locinfo.props.setMesh(Transfer::URI(msh), 0);
-    locinfo.props.setPhysics(phy, 0);
-    locinfo.props.setQueryData(query_data, 0);
+    initLocationInfo(locinfo, loc, orient, bnds, msh, phy, query_data);
     locinfo.local = true;
     locinfo.aggregate = false;
 
@@ -187,13 +198,7 @@ void StandardLocationService::addLocalAggregateObject(const UUID& uuid, const Ti
     LocationMap::iterator it = mLocations.find(uuid);
 
     LocationInfo& locinfo = it->second;
-    locinfo.props.reset();
-    locinfo.props.setLocation(loc, 0);
-    locinfo.props.setOrientation(orient, 0);
-    locinfo.props.setBounds(bnds, 0);
-    locinfo.props.setMesh(Transfer::URI(msh), 0);
-    locinfo.props.setPhysics(phy, 0);
-    locinfo.props.setQueryData(query_data, 0);
+    initLocationInfo(locinfo, loc, orient, bnds, msh, phy, query_data);
 
     locinfo.local = true;
     locinfo.aggregate = true;
@@ -237,21 +242,22 @@ void StandardLocationService::updateLocalAggregateMesh(const UUID& uuid, const S
     LocationMap::iterator loc_it = mLocations.find(uuid);
     assert(loc_it != mLocations.end());
     assert(loc_it->second.aggregate == true);
-    loc_it->second.props.setMesh(Transfer::URI(newval));
+    loc_it->second.mesh = internMesh(newval);
     notifyLocalMeshUpdated( uuid, true, newval );
 }
 void StandardLocationService::updateLocalAggregatePhysics(const UUID& uuid, const String& newval) {
     LocationMap::iterator loc_it = mLocations.find(uuid);
     assert(loc_it != mLocations.end());
     assert(loc_it->second.aggregate == true);
-    loc_it->second.props.setPhysics(newval, 0);
+    if (loc_it->second.props.updateSeqNo(SequencedPresenceProperties::LOC_PHYSICS_PART, 0))
+        loc_it->second.physics = intern(newval);
     notifyLocalPhysicsUpdated( uuid, true, newval );
 }
 void StandardLocationService::updateLocalAggregateQueryData(const UUID& uuid, const String& newval) {
     LocationMap::iterator loc_it = mLocations.find(uuid);
     assert(loc_it != mLocations.end());
     assert(loc_it->second.aggregate == true);
-    loc_it->second.props.setQueryData(newval);
+    loc_it->second.query_data = intern(newval);
     notifyLocalQueryDataUpdated( uuid, true, newval );
 }
 
@@ -263,13 +269,7 @@ void StandardLocationService::addReplicaObject(const Time& t, const UUID& uuid,
         // It already exists. If its local, ignore the update. If its another replica, somethings out of sync, but perform the update anyway
         LocationInfo& locinfo = it->second;
         if (!locinfo.local) {
-            locinfo.props.reset();
-            locinfo.props.setLocation(loc, 0);
-            locinfo.props.setOrientation(orient, 0);
-            locinfo.props.setBounds(bnds, 0);
-            locinfo.props.setMesh(Transfer::URI(msh), 0);
-            locinfo.props.setPhysics(phy, 0);
-            locinfo.props.setQueryData(query_data, 0);
+            initLocationInfo(locinfo, loc, orient, bnds, msh, phy, query_data);
 
             //local = false
             // FIXME should we notify location and bounds updated info?
@@ -278,17 +278,10 @@ void StandardLocationService::addReplicaObject(const Time& t, const UUID& uuid,
     }
     else {
         // Its a new replica, just insert it
-        LocationInfo locinfo;
-        locinfo.props.reset();
-        locinfo.props.setLocation(loc, 0);
-        locinfo.props.setOrientation(orient, 0);
-        locinfo.props.setBounds(bnds, 0);
-        locinfo.props.setMesh(Transfer::URI(msh), 0);
-        locinfo.props.setPhysics(phy, 0);
-        locinfo.props.setQueryData(query_data, 0);
+        LocationInfo& locinfo = mLocations[uuid];
+        initLocationInfo(locinfo, loc, orient, bnds, msh, phy, query_data);
         locinfo.local = false;
         locinfo.aggregate = agg;
-        mLocations[uuid] = locinfo;
 
         // We only run this notification when the object actually is new
         CONTEXT_SPACETRACE(serverObjectEvent, 0, mContext->id(), uuid, true, loc); // FIXME add remote server ID
@@ -376,21 +369,24 @@ void StandardLocationService::receiveMessage(Message* msg) {
             }
 
             if (update.has_mesh()) {
-                String newmesh = update.mesh();
-                loc_it->second.props.setMesh(Transfer::URI(newmesh), epoch);
-                notifyReplicaMeshUpdated( update.object(), loc_it->second.props.mesh().toString() );
+                if (loc_it->second.props.updateSeqNo(SequencedPresenceProperties::LOC_MESH_PART, epoch))
+                    loc_it->second.mesh = internMesh(update.mesh());
+                InternedString newval = loc_it->second.mesh;
+                notifyReplicaMeshUpdated( update.object(), newval.str() );
             }
 
             if (update.has_physics()) {
-                String newphy = update.physics();
-                loc_it->second.props.setPhysics(newphy, epoch);
-                notifyReplicaPhysicsUpdated( update.object(), loc_it->second.props.physics() );
+                if (loc_it->second.props.updateSeqNo(SequencedPresenceProperties::LOC_PHYSICS_PART, epoch))
+                    loc_it->second.physics = intern(update.physics());
+                InternedString newval = loc_it->second.physics;
+                notifyReplicaPhysicsUpdated( update.object(), newval.str() );
             }
 
             if (update.has_query_data()) {
-                String newqd = update.query_data();
-                loc_it->second.props.setQueryData(newqd, epoch);
-                notifyReplicaQueryDataUpdated( update.object(), loc_it->second.props.queryData() );
+                if (loc_it->second.props.updateSeqNo(SequencedPresenceProperties::LOC_QUERY_DATA_PART, epoch))
+                    loc_it->second.query_data = intern(update.query_data());
+                InternedString newval = loc_it->second.query_data;
+                notifyReplicaQueryDataUpdated( update.object(), newval.str() );
             }
 
         }
@@ -448,21 +444,24 @@ bool StandardLocationService::locationUpdate(UUID source, void* buffer, uint32 l
             }
 
             if (request.has_mesh()) {
-                String newmesh = request.mesh();
-                loc_it->second.props.setMesh(Transfer::URI(newmesh), epoch);
-                notifyLocalMeshUpdated( source, loc_it->second.aggregate, loc_it->second.props.mesh().toString() );
+                if (loc_it->second.props.updateSeqNo(SequencedPresenceProperties::LOC_MESH_PART, epoch))
+                    loc_it->second.mesh = internMesh(request.mesh());
+                InternedString newval = loc_it->second.mesh;
+                notifyLocalMeshUpdated( source, loc_it->second.aggregate, newval.str() );
             }
 
             if (request.has_physics()) {
-                String newphy = request.physics();
-                loc_it->second.props.setPhysics(newphy, epoch);
-                notifyLocalPhysicsUpdated( source, loc_it->second.aggregate, loc_it->second.props.physics() );
+                if (loc_it->second.props.updateSeqNo(SequencedPresenceProperties::LOC_PHYSICS_PART, epoch))
+                    loc_it->second.physics = intern(request.physics());
+                InternedString newval = loc_it->second.physics;
+                notifyLocalPhysicsUpdated( source, loc_it->second.aggregate, newval.str() );
             }
 
             if (request.has_query_data()) {
-                String newqd = request.query_data();
-                loc_it->second.props.setQueryData(newqd, epoch);
-                notifyLocalQueryDataUpdated( source, loc_it->second.aggregate, loc_it->second.props.queryData() );
+                if (loc_it->second.props.updateSeqNo(SequencedPresenceProperties::LOC_QUERY_DATA_PART, epoch))
+                    loc_it->second.query_data = intern(request.query_data());
+                InternedString newval = loc_it->second.query_data;
+                notifyLocalQueryDataUpdated( source, loc_it->second.aggregate, newval.str() );
             }
 
         }
@@ -550,8 +549,8 @@ void StandardLocationService::commandObjectProperties(const Command::Command& cm
     result.put("properties.bounds.centerBoundsRadius", it->second.props.bounds().centerBoundsRadius);
     result.put("properties.bounds.maxObjectRadius", it->second.props.bounds().maxObjectRadius);
 
-    result.put("properties.mesh", it->second.props.mesh().toString());
-    result.put("properties.physics", it->second.props.physics());
+    result.put("properties.mesh", it->second.mesh.str());
+    result.put("properties.physics", it->second.physics.str());
 
     result.put("properties.local", it->second.local);
     result.put("properties.aggregate", it->second.aggregate);
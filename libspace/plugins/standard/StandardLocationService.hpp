@@ -61,6 +61,9 @@ public:
     virtual const String& mesh(const UUID& uuid);
     virtual const String& physics(const UUID& uuid);
     virtual const String& queryData(const UUID& uuid);
+    virtual InternedString meshHandle(const UUID& uuid);
+    virtual InternedString physicsHandle(const UUID& uuid);
+    virtual InternedString queryDataHandle(const UUID& uuid);
 
   virtual void addLocalObject(const UUID& uuid, const TimedMotionVector3f& loc, const TimedMotionQuaternion& orient, const AggregateBoundingInfo& bounds, const String& mesh, const String& physics, const String& query_data);
     virtual void removeLocalObject(const UUID& uuid, const std::tr1::function<void()>&completeCallback);
@@ -89,15 +92,22 @@ public:
     virtual void commandObjectProperties(const Command::Command& cmd, Command::Commander* cmdr, Command::CommandID cmdid);
 
 private:
+    // Mesh URIs are normalized through Transfer::URI before interning
+    InternedString internMesh(const String& msh);
+
+    struct LocationInfo;
+    // Resets locinfo and fills in all properties with sequence number 0
+    void initLocationInfo(LocationInfo& locinfo, const TimedMotionVector3f& loc, const TimedMotionQuaternion& orient, const AggregateBoundingInfo& bnds, const String& msh, const String& phy, const String& query_data);
+
     struct LocationInfo {
-        // Regular location info that we need to maintain for all objects
+        // Regular location info that we need to maintain for all objects. The
+        // mesh, physics and query data values in props are not used, only
+        // their sequence numbers. The values are stored in the interned
+        // handles below since they are often shared by many objects.
         SequencedPresenceProperties props;
-        // NOTE: This is a copy of props.mesh(), which *is not always valid*. It's
-        // only used for the accessor, when returning by const& since we don't have
-        // a String version within props. DO NOT use anywhere else.
-        String mesh_copied_str;
-        String physics_copied_str;
-        String query_data_copied_str;
+        InternedString mesh;
+        InternedString physics;
+        InternedString query_data;
 
         bool local;
         bool aggregate;
@@ -54,6 +54,7 @@ void LocationServiceFactory::destroy() {
 LocationService::LocationService(SpaceContext* ctx, LocationUpdatePolicy* update_policy)
  : PollingService(ctx->mainStrand, "LocationService Poll", Duration::milliseconds((int64)10)),
    mContext(ctx),
+   mBatchedListenerCount(0),
    mUpdatePolicy(update_policy)
 {
     mProfiler = mContext->profiler->addStage("Location Service");
@@ -162,30 +163,108 @@ void LocationService::start() {
 void LocationService::stop() {
     mUpdatePolicy->stop();
     PollingService::stop();
+    flushMotionUpdates();
 }
 
 void LocationService::poll() {
     mProfiler->started();
     service();
+    // Updates received since the last tick, whether from service() or from
+    // messages, are delivered together
+    flushMotionUpdates();
     mProfiler->finished();
 }
 
-void LocationService::addListener(LocationServiceListener* listener, bool want_aggregates) {
+void LocationService::addListener(LocationServiceListener* listener, bool want_aggregates, bool batched) {
     ListenerInfo info;
     info.listener = listener;
     info.wantAggregates = want_aggregates;
-    mListeners.insert(info);
+    info.batched = batched;
+    if (mListeners.insert(info).second && batched)
+        mBatchedListenerCount++;
 }
 
 void LocationService::removeListener(LocationServiceListener* listener) {
     for(ListenerList::const_iterator it = mListeners.begin(); it != mListeners.end(); it++) {
         if (it->listener == listener) {
+            if (it->batched) {
+                // Make sure the listener has seen everything up to this point
+                flushMotionUpdates();
+                mBatchedListenerCount--;
+                if (mBatchedListenerCount == 0) {
+                    mPendingMotionUpdates.clear();
+                    mPendingMotionUpdateIndex.clear();
+                }
+            }
             mListeners.erase(it);
             break;
         }
     }
 }
 
+LocationServiceListener::MotionUpdate& LocationService::pendingMotionUpdate(const UUID& uuid, bool local, bool agg) const {
+    MotionUpdateIndex::iterator it = mPendingMotionUpdateIndex.find(uuid);
+    if (it != mPendingMotionUpdateIndex.end()) {
+        LocationServiceListener::MotionUpdate& existing = mPendingMotionUpdates[it->second];
+        if (existing.local == local && existing.agg == agg)
+            return existing;
+        // The object changed type (e.g. replica -> local) without an
+        // intervening removal flushing the batch. Don't mix them up.
+        flushMotionUpdates();
+    }
+
+    mPendingMotionUpdateIndex[uuid] = mPendingMotionUpdates.size();
+    mPendingMotionUpdates.push_back(LocationServiceListener::MotionUpdate());
+    LocationServiceListener::MotionUpdate& update = mPendingMotionUpdates.back();
+    update.uuid = uuid;
+    update.local = local;
+    update.agg = agg;
+    update.changed = 0;
+    return update;
+}
+
+void LocationService::flushMotionUpdates(const UUID& uuid) const {
+    // Only the relative order of events for a single object matters, so we
+    // only need to flush if this object has an update pending
+    if (mPendingMotionUpdateIndex.find(uuid) != mPendingMotionUpdateIndex.end())
+        flushMotionUpdates();
+}
+
+void LocationService::flushMotionUpdates() const {
+    if (mPendingMotionUpdates.empty()) return;
+
+    // Swap the updates out so listeners can trigger new updates while we're
+    // delivering these.
+    LocationServiceListener::MotionUpdateList updates;
+    updates.swap(mPendingMotionUpdates);
+    mPendingMotionUpdateIndex.clear();
+
+    // Listeners which don't want aggregates get a filtered copy, generated
+    // only if we need it.
+    LocationServiceListener::MotionUpdateList non_agg_updates;
+    bool filtered = false;
+    for(ListenerList::const_iterator it = mListeners.begin(); it != mListeners.end(); it++) {
+        if (!it->batched) continue;
+        if (it->wantAggregates) {
+            it->listener->motionUpdated(updates);
+            continue;
+        }
+        if (!filtered) {
+            for(uint32 i = 0; i < updates.size(); i++)
+                if (!updates[i].agg) non_agg_updates.push_back(updates[i]);
+            filtered = true;
+        }
+        if (!non_agg_updates.empty())
+            it->listener->motionUpdated(non_agg_updates);
+    }
+
+    // Reuse the storage if nothing new was queued
+    if (mPendingMotionUpdates.empty()) {
+        updates.clear();
+        updates.swap(mPendingMotionUpdates);
+    }
+}
+
 
 
 // Server Subscriptions
@@ -261,6 +340,7 @@ void LocationService::unsubscribe(const UUID& remote, const std::tr1::function<v
 
 
 void LocationService::notifyLocalObjectAdded(const UUID& uuid, bool agg, const TimedMotionVector3f& loc, const TimedMotionQuaternion& orient, const AggregateBoundingInfo& bounds, const String& mesh, const String& physics, const String& query_data) const {
+    flushMotionUpdates(uuid);
     for(ListenerList::const_iterator it = mListeners.begin(); it != mListeners.end(); it++)
         if (!agg || it->wantAggregates)
           it->listener->localObjectAdded(uuid, agg, loc, orient, bounds, mesh, physics, query_data);
@@ -278,6 +358,7 @@ public:
     }
 };
 void LocationService::notifyLocalObjectRemoved(const UUID& uuid, bool agg, const LocationServiceListener::RemovalCallback&callback) const {
+    flushMotionUpdates(uuid);
     bool hasCallbacked=false;
     ListenerList::const_iterator begin = mListeners.begin();
     LocationServiceListener::RemovalCallback oneToManyCallback;
@@ -310,37 +391,55 @@ void LocationService::notifyLocalObjectRemoved(const UUID& uuid, bool agg, const
 
 
 void LocationService::notifyLocalLocationUpdated(const UUID& uuid, bool agg, const TimedMotionVector3f& newval) const {
+    if (mBatchedListenerCount > 0) {
+        LocationServiceListener::MotionUpdate& update = pendingMotionUpdate(uuid, true, agg);
+        update.changed |= LocationServiceListener::MOTION_LOCATION;
+        update.location = newval;
+    }
     for(ListenerList::const_iterator it = mListeners.begin(); it != mListeners.end(); it++)
-        if (!agg || it->wantAggregates)
+        if (!it->batched && (!agg || it->wantAggregates))
             it->listener->localLocationUpdated(uuid, agg, newval);
 }
 
 void LocationService::notifyLocalOrientationUpdated(const UUID& uuid, bool agg, const TimedMotionQuaternion& newval) const {
+    if (mBatchedListenerCount > 0) {
+        LocationServiceListener::MotionUpdate& update = pendingMotionUpdate(uuid, true, agg);
+        update.changed |= LocationServiceListener::MOTION_ORIENTATION;
+        update.orientation = newval;
+    }
     for(ListenerList::const_iterator it = mListeners.begin(); it != mListeners.end(); it++)
-        if (!agg || it->wantAggregates)
+        if (!it->batched && (!agg || it->wantAggregates))
             it->listener->localOrientationUpdated(uuid, agg, newval);
 }
 
 void LocationService::notifyLocalBoundsUpdated(const UUID& uuid, bool agg, const AggregateBoundingInfo& newval) const {
+    if (mBatchedListenerCount > 0) {
+        LocationServiceListener::MotionUpdate& update = pendingMotionUpdate(uuid, true, agg);
+        update.changed |= LocationServiceListener::MOTION_BOUNDS;
+        update.bounds = newval;
+    }
     for(ListenerList::const_iterator it = mListeners.begin(); it != mListeners.end(); it++)
-        if (!agg || it->wantAggregates)
+        if (!it->batched && (!agg || it->wantAggregates))
             it->listener->localBoundsUpdated(uuid, agg, newval);
 }
 
 
 void LocationService::notifyLocalMeshUpdated(const UUID& uuid, bool agg, const String& newval) const {
+    flushMotionUpdates(uuid);
     for(ListenerList::const_iterator it = mListeners.begin(); it != mListeners.end(); it++)
         if (!agg || it->wantAggregates)
             it->listener->localMeshUpdated(uuid, agg, newval);
 }
 
 void LocationService::notifyLocalPhysicsUpdated(const UUID& uuid, bool agg, const String& newval) const {
+    flushMotionUpdates(uuid);
     for(ListenerList::const_iterator it = mListeners.begin(); it != mListeners.end(); it++)
         if (!agg || it->wantAggregates)
             it->listener->localPhysicsUpdated(uuid, agg, newval);
 }
 
 void LocationService::notifyLocalQueryDataUpdated(const UUID& uuid, bool agg, const String& newval) const {
+    flushMotionUpdates(uuid);
     for(ListenerList::const_iterator it = mListeners.begin(); it != mListeners.end(); it++)
         if (!agg || it->wantAggregates)
             it->listener->localQueryDataUpdated(uuid, agg, newval);
@@ -348,41 +447,64 @@ void LocationService::notifyLocalQueryDataUpdated(const UUID& uuid, bool agg, co
 
 
 void LocationService::notifyReplicaObjectAdded(const UUID& uuid, const TimedMotionVector3f& loc, const TimedMotionQuaternion& orient, const AggregateBoundingInfo& bounds, const String& mesh, const String& physics, const String& query_data) const {
+    flushMotionUpdates(uuid);
     for(ListenerList::const_iterator it = mListeners.begin(); it != mListeners.end(); it++)
       it->listener->replicaObjectAdded(uuid, loc, orient, bounds, mesh, physics, query_data);
 }
 
 void LocationService::notifyReplicaObjectRemoved(const UUID& uuid) const {
+    flushMotionUpdates(uuid);
     for(ListenerList::const_iterator it = mListeners.begin(); it != mListeners.end(); it++)
         it->listener->replicaObjectRemoved(uuid);
 }
 
 void LocationService::notifyReplicaLocationUpdated(const UUID& uuid, const TimedMotionVector3f& newval) const {
+    if (mBatchedListenerCount > 0) {
+        LocationServiceListener::MotionUpdate& update = pendingMotionUpdate(uuid, false, false);
+        update.changed |= LocationServiceListener::MOTION_LOCATION;
+        update.location = newval;
+    }
     for(ListenerList::const_iterator it = mListeners.begin(); it != mListeners.end(); it++)
-        it->listener->replicaLocationUpdated(uuid, newval);
+        if (!it->batched)
+            it->listener->replicaLocationUpdated(uuid, newval);
 }
 
 void LocationService::notifyReplicaOrientationUpdated(const UUID& uuid, const TimedMotionQuaternion& newval) const {
+    if (mBatchedListenerCount > 0) {
+        LocationServiceListener::MotionUpdate& update = pendingMotionUpdate(uuid, false, false);
+        update.changed |= LocationServiceListener::MOTION_ORIENTATION;
+        update.orientation = newval;
+    }
     for(ListenerList::const_iterator it = mListeners.begin(); it != mListeners.end(); it++)
-        it->listener->replicaOrientationUpdated(uuid, newval);
+        if (!it->batched)
+            it->listener->replicaOrientationUpdated(uuid, newval);
 }
 
 void LocationService::notifyReplicaBoundsUpdated(const UUID& uuid, const AggregateBoundingInfo& newval) const {
+    if (mBatchedListenerCount > 0) {
+        LocationServiceListener::MotionUpdate& update = pendingMotionUpdate(uuid, false, false);
+        update.changed |= LocationServiceListener::MOTION_BOUNDS;
+        update.bounds = newval;
+    }
     for(ListenerList::const_iterator it = mListeners.begin(); it != mListeners.end(); it++)
-        it->listener->replicaBoundsUpdated(uuid, newval);
+        if (!it->batched)
+            it->listener->replicaBoundsUpdated(uuid, newval);
 }
 
 void LocationService::notifyReplicaMeshUpdated(const UUID& uuid, const String& newval) const {
+    flushMotionUpdates(uuid);
     for(ListenerList::const_iterator it = mListeners.begin(); it != mListeners.end(); it++)
         it->listener->replicaMeshUpdated(uuid, newval);
 }
 
 void LocationService::notifyReplicaPhysicsUpdated(const UUID& uuid, const String& newval) const {
+    flushMotionUpdates(uuid);
     for(ListenerList::const_iterator it = mListeners.begin(); it != mListeners.end(); it++)
         it->listener->replicaPhysicsUpdated(uuid, newval);
 }
 
 void LocationService::notifyReplicaQueryDataUpdated(const UUID& uuid, const String& newval) const {
+    flushMotionUpdates(uuid);
     for(ListenerList::const_iterator it = mListeners.begin(); it != mListeners.end(); it++)
         it->listener->replicaQueryDataUpdated(uuid, newval);
 }
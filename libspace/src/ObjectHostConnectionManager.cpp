@@ -261,11 +261,30 @@ void ObjectHostConnectionManager::handleConnectionEvent(ObjectHostConnection* co
 void ObjectHostConnectionManager::handleConnectionRead(ObjectHostConnection* conn, Sirikata::Network::Chunk& chunk, const Sirikata::Network::Stream::PauseReceiveCallback& pause) {
     SPACE_LOG(insane, "Handling connection read: " << chunk.size() << " bytes");
 
+    MemoryReference data(chunk);
+    if (!isObjectMessageBatch(data)) {
+        handleObjectHostMessageData(conn, data);
+    }
+    else {
+        // Object hosts can pack many messages into one chunk
+        MemoryReference msg_data(MemoryReference::null());
+        while(nextObjectMessageInBatch(&data, &msg_data))
+            handleObjectHostMessageData(conn, msg_data);
+        if (data.size() != 0) {
+            LOG_INVALID_MESSAGE(space, error, chunk);
+        }
+    }
+
+    // We either got it or dropped it, either way it was accepted.  Don't do
+    // anything with pause parameter.
+}
+
+void ObjectHostConnectionManager::handleObjectHostMessageData(ObjectHostConnection* conn, MemoryReference data) {
     Sirikata::Protocol::Object::ObjectMessage* obj_msg = new Sirikata::Protocol::Object::ObjectMessage();
-    bool parse_success = obj_msg->ParseFromArray(&(*chunk.begin()),chunk.size());
+    bool parse_success = obj_msg->ParseFromArray(data.data(), data.size());
 
     if (!parse_success) {
-        LOG_INVALID_MESSAGE(space, error, chunk);
+        LOG_INVALID_MESSAGE_BUFFER(space, error, ((const uint8*)data.data()), data.size());
         delete obj_msg;
         return; // Ignore, treat as dropped. Hopefully this doesn't cascade...
     }
@@ -273,9 +292,6 @@ void ObjectHostConnectionManager::handleConnectionRead(ObjectHostConnection* con
     TIMESTAMP(obj_msg, Trace::HANDLE_OBJECT_HOST_MESSAGE);
 
     mListener->onObjectHostMessageReceived(conn_id(conn), conn->short_id, obj_msg);
-
-    // We either got it or dropped it, either way it was accepted.  Don't do
-    // anything with pause parameter.
 }
 
 void ObjectHostConnectionManager::insertConnection(ObjectHostConnection* conn) {
@@ -51,26 +51,29 @@ ObjectSegmentation::ObjectSegmentation(SpaceContext* ctx, Network::IOStrand* o_s
    mLookupListener(NULL),
    mWriteListener(NULL),
    oStrand(o_strand),
-   mMigAckMessages( ctx->mainStrand->wrap(std::tr1::bind(&ObjectSegmentation::handleNewMigAckMessages, this)) ),
-   mFrontMigAck(NULL)
+   mMigAcks( ctx->mainStrand->wrap(std::tr1::bind(&ObjectSegmentation::handleNewMigAckMessages, this)) ),
+   mBulkMigAcks(false)
 {
     // Register a ServerMessage service for oseg
     mOSegServerMessageService = mContext->serverRouter()->createServerMessageService("oseg");
 
     //registering with the dispatcher.  can now receive messages addressed to it.
     mContext->serverDispatcher()->registerMessageRecipient(SERVER_PORT_OSEG_MIGRATE_ACKNOWLEDGE, this);
+    mContext->serverDispatcher()->registerMessageRecipient(SERVER_PORT_OSEG_BULK_MIGRATE_ACKNOWLEDGE, this);
     mContext->serverDispatcher()->registerMessageRecipient(SERVER_PORT_OSEG_UPDATE, this);
 }
 
 ObjectSegmentation::~ObjectSegmentation() {
     //delete retries
-    while( !mMigAckMessages.empty() ) {
-        Message* msg = NULL;
-        mMigAckMessages.pop(msg);
-        delete msg;
-    }
+    std::deque<Sirikata::Protocol::OSeg::MigrateMessageAcknowledge*> acks;
+    mMigAcks.popAll(&acks);
+    for(uint32 i = 0; i < acks.size(); i++)
+        delete acks[i];
+    for(uint32 i = 0; i < mMigAckMessages.size(); i++)
+        delete mMigAckMessages[i];
 
     mContext->serverDispatcher()->unregisterMessageRecipient(SERVER_PORT_OSEG_MIGRATE_ACKNOWLEDGE, this);
+    mContext->serverDispatcher()->unregisterMessageRecipient(SERVER_PORT_OSEG_BULK_MIGRATE_ACKNOWLEDGE, this);
     mContext->serverDispatcher()->unregisterMessageRecipient(SERVER_PORT_OSEG_UPDATE, this);
 
     delete mOSegServerMessageService;
@@ -84,6 +87,14 @@ void ObjectSegmentation::receiveMessage(Message* msg)
         if (parsed)
             this->handleMigrateMessageAck(oseg_ack_msg);
     }
+    else if (msg->dest_port() == SERVER_PORT_OSEG_BULK_MIGRATE_ACKNOWLEDGE) {
+        Sirikata::Protocol::OSeg::BulkMigrateMessageAcknowledge bulk_ack_msg;
+        bool parsed = parsePBJMessage(&bulk_ack_msg, msg->payload());
+        if (parsed) {
+            for(int32 i = 0; i < bulk_ack_msg.acks_size(); i++)
+                this->handleMigrateMessageAck(bulk_ack_msg.acks(i));
+        }
+    }
     else if (msg->dest_port() == SERVER_PORT_OSEG_UPDATE) {
         Sirikata::Protocol::OSeg::UpdateOSegMessage update_oseg_msg;
         bool parsed = parsePBJMessage(&update_oseg_msg, msg->payload());
@@ -98,34 +109,27 @@ void ObjectSegmentation::receiveMessage(Message* msg)
 }
 
 void ObjectSegmentation::queueMigAck(const Sirikata::Protocol::OSeg::MigrateMessageAcknowledge& msg) {
-    Message* to_send = new Message(
-        mContext->id(),
-        SERVER_PORT_OSEG_MIGRATE_ACKNOWLEDGE,
-        msg.m_message_destination(),
-        SERVER_PORT_OSEG_MIGRATE_ACKNOWLEDGE,
-        serializePBJMessage(msg)
-    );
-    mMigAckMessages.push(to_send); // sending handled in main strand
+    mMigAcks.push(new Sirikata::Protocol::OSeg::MigrateMessageAcknowledge(msg)); // sending handled in main strand
+}
+
+namespace {
+// Limit on the number of acks in a single bulk message, which keeps messages
+// reasonably sized when thousands of objects migrate at once.
+const uint32 MaxBulkMigAcks = 256;
 }
 
 void ObjectSegmentation::trySendMigAcks() {
     if (mStopping) return;
 
-    while(true) {
-        if (mFrontMigAck == NULL) {
-            if (mMigAckMessages.empty())
-                return;
-            mMigAckMessages.pop(mFrontMigAck);
-        }
-
-        bool sent = mOSegServerMessageService->route( mFrontMigAck );
+    while(!mMigAckMessages.empty()) {
+        bool sent = mOSegServerMessageService->route( mMigAckMessages.front() );
         if (!sent)
             break;
 
-        mFrontMigAck = NULL;
+        mMigAckMessages.pop_front();
     }
 
-    if (mFrontMigAck != NULL || !mMigAckMessages.empty()) {
+    if (!mMigAckMessages.empty()) {
         // We've still got work to do, setup a retry
         mContext->mainStrand->post(
             Duration::microseconds(100),
@@ -136,7 +140,77 @@ void ObjectSegmentation::trySendMigAcks() {
 }
 
 void ObjectSegmentation::handleNewMigAckMessages() {
-    trySendMigAcks();
+    std::deque<Sirikata::Protocol::OSeg::MigrateMessageAcknowledge*> acks;
+    mMigAcks.popAll(&acks);
+
+    // Only kick off sending if there isn't already a retry scheduled
+    bool was_empty = mMigAckMessages.empty();
+
+    if (!mBulkMigAcks) {
+        for(uint32 i = 0; i < acks.size(); i++) {
+            mMigAckMessages.push_back(
+                new Message(
+                    mContext->id(),
+                    SERVER_PORT_OSEG_MIGRATE_ACKNOWLEDGE,
+                    acks[i]->m_message_destination(),
+                    SERVER_PORT_OSEG_MIGRATE_ACKNOWLEDGE,
+                    serializePBJMessage(*acks[i])
+                )
+            );
+            delete acks[i];
+        }
+    }
+    else {
+        // Group by destination, preserving the order acks were generated in
+        typedef std::vector<Sirikata::Protocol::OSeg::MigrateMessageAcknowledge*> AckList;
+        typedef std::map<ServerID, AckList> AcksByServer;
+        AcksByServer by_server;
+        for(uint32 i = 0; i < acks.size(); i++)
+            by_server[(ServerID)acks[i]->m_message_destination()].push_back(acks[i]);
+
+        for(AcksByServer::iterator it = by_server.begin(); it != by_server.end(); it++) {
+            AckList& server_acks = it->second;
+            for(uint32 start = 0; start < server_acks.size(); start += MaxBulkMigAcks) {
+                uint32 end = std::min(start + MaxBulkMigAcks, (uint32)server_acks.size());
+                Message* to_send = NULL;
+                if (end - start == 1) {
+                    to_send = new Message(
+                        mContext->id(),
+                        SERVER_PORT_OSEG_MIGRATE_ACKNOWLEDGE,
+                        it->first,
+                        SERVER_PORT_OSEG_MIGRATE_ACKNOWLEDGE,
+                        serializePBJMessage(*server_acks[start])
+                    );
+                }
+                else {
+                    Sirikata::Protocol::OSeg::BulkMigrateMessageAcknowledge bulk_ack_msg;
+                    for(uint32 i = start; i < end; i++) {
+                        Sirikata::Protocol::OSeg::MigrateMessageAcknowledge* ack = server_acks[i];
+                        Sirikata::Protocol::OSeg::IMigrateMessageAcknowledge bulk_ack = bulk_ack_msg.add_acks();
+                        bulk_ack.set_m_servid_from(ack->m_servid_from());
+                        bulk_ack.set_m_servid_to(ack->m_servid_to());
+                        bulk_ack.set_m_message_destination(ack->m_message_destination());
+                        bulk_ack.set_m_message_from(ack->m_message_from());
+                        bulk_ack.set_m_objid(ack->m_objid());
+                        bulk_ack.set_m_objradius(ack->m_objradius());
+                    }
+                    to_send = new Message(
+                        mContext->id(),
+                        SERVER_PORT_OSEG_BULK_MIGRATE_ACKNOWLEDGE,
+                        it->first,
+                        SERVER_PORT_OSEG_BULK_MIGRATE_ACKNOWLEDGE,
+                        serializePBJMessage(bulk_ack_msg)
+                    );
+                }
+                mMigAckMessages.push_back(to_send);
+            }
+            for(uint32 i = 0; i < server_acks.size(); i++)
+                delete server_acks[i];
+        }
+    }
+
+    if (was_empty)
+        trySendMigAcks();
 }
 
 } // namespace Sirikata
@@ -11,6 +11,34 @@
 namespace Sirikata {
 namespace Twitter {
 
+/** The bucket indices a term hashes to for one filter configuration. Hashing a
+ *  term is much more expensive than checking its buckets, so callers that
+ *  check the same term against many filters, e.g. a query evaluated at every
+ *  node of a tree, should hold onto one of these and pass it to
+ *  TermBloomFilter::lookup. It's recomputed automatically if the term or
+ *  filter configuration changes.
+ */
+class SIRIKATA_TWITTER_EXPORT TermHashes {
+public:
+    TermHashes()
+     : mBuckets(0), mHashes(0)
+    {}
+
+    const String& term() const { return mTerm; }
+
+private:
+    friend class TermBloomFilter;
+
+    bool matches(const String& term, uint32 buckets, uint16 hashes) const {
+        return (mBuckets == buckets && mHashes == hashes && mTerm == term);
+    }
+
+    String mTerm;
+    uint32 mBuckets;
+    uint16 mHashes;
+    std::vector<uint32> mIndices;
+}; // class TermHashes
+
 /** A bloom filter for textual terms. It takes care of the hashing, bloom
  *  filter insertion and querying, and can aggregate filters as long as they are
  *  identically sized.
@@ -37,6 +65,10 @@ public:
      *  been inserted and false if it definitely has not.
      */
     bool lookup(const String& term) const;
+    /** Looks up the term using hashes cached in hashes_cache, computing them
+     *  first if they aren't for this term and filter configuration.
+     */
+    bool lookup(const String& term, TermHashes* hashes_cache) const;
 
     /** Serializes the bloom filter. */
     void serialize(String& output) const;
@@ -49,6 +81,11 @@ public:
      *  both.
      */
     void mergeIn(const TermBloomFilter& rhs);
+    /** Intersect this bloom filter with another, bitwise ANDing the two
+     *  filters. Note that the result may contain buckets for terms which were
+     *  not inserted into both filters.
+     */
+    void intersectWith(const TermBloomFilter& rhs);
 
 
     /** Check that this bloom filter is a subset of the other, i.e. every bucket
@@ -60,6 +97,13 @@ private:
 
     const uint32 bytesSize() const { return mFilterBytes; }
 
+    void setBucket(uint32 bucket) {
+        mFilter[bucket / 64] |= (((uint64)1) << (bucket % 64));
+    }
+    bool testBucket(uint32 bucket) const {
+        return ((mFilter[bucket / 64] >> (bucket % 64)) & 0x1) != 0;
+    }
+
     // State tracked during multi-hashing. This allows us to
     // efficiently compute multiple hashes, and also, by storing it
     // separately, allows us to keep the computation of multiple
@@ -84,15 +128,24 @@ private:
     uint32 computeMoreHashBits(MultiHashingState& state, const String& term) const;
 
 
+    void computeHashes(const String& term, TermHashes* hashes) const;
+
+
     // Note: it'd be great to just use something like boost::dynamic_bitset but
     // it doesn't make the data accessible in an efficient way for
     // serialization.
 
     // Size of the filter
     const uint32 mFilterBuckets;
-    // Size of filter in bytes, rounded up
+    // Size of filter in bytes, rounded up. This is the size of the serialized
+    // filter.
     const uint32 mFilterBytes;
-    unsigned char* mFilter;
+    // Size of filter in 64-bit words. This is rounded up to a multiple of 128
+    // bits so the bulk operations can work on whole vector registers. Padding
+    // bits are always 0. Bucket i is bit i%64 of word i/64, which on little
+    // endian machines is the same layout as the serialized bytes.
+    const uint32 mFilterWords;
+    uint64* mFilter;
 
     // Number of buckets saved by mFilter;
     const uint16 mNumHashes;
@@ -91,6 +91,9 @@ public:
     String raw_query;
     // The real query data
     String term;
+    // Bloom filter buckets for term, which are reused for every node the query
+    // is evaluated against
+    Twitter::TermHashes term_hashes;
     Vector3 region_min;
     Vector3 region_max;
     uint32 max_results;
@@ -161,7 +164,7 @@ bool parseQueryRequest(
 // i.e. fake top-level pinto trees from local-only implementations
 bool checkTermRegion(
     // Query parameters
-    const String& term,
+    const String& term, Twitter::TermHashes* term_hashes,
     Vector3f region_min, Vector3f region_max,
     float32 cur_min_radius, // current minimum to match target # results
     // Object/aggregate props
@@ -181,12 +184,12 @@ bool checkTermRegion(
         (region_min.x <= bnds_max.x && region_min.y <= bnds_max.y) &&
         (region_max.x >= bnds_min.x && region_max.y >= bnds_min.y);
     if (!in_region) return false;
-    // Only evaluate bloom.lookup if in the region since it's much more
-    // expensive to do all that hashing. FIXME Ideally we'd pre-hash the search
-    // term... The empty term check let's us degrade to region query for
-    // convenience, but generally shouldn't be used since it'll generate too
-    // many results for large regions.
-    return (term.empty() || bloom.lookup(term));
+    // Only evaluate bloom.lookup if in the region since, even with the hashes
+    // cached, it's more expensive than the region check. The empty term check
+    // let's us degrade to region query for convenience, but generally
+    // shouldn't be used since it'll generate too many results for large
+    // regions.
+    return (term.empty() || bloom.lookup(term, term_hashes));
 }
 }
 
@@ -232,21 +235,30 @@ public:
 
     typedef typename QueryHandlerType::NodeIterator NodeIterator;
 
-    static TermRegionQueryHandler* construct(uint16 elements_per_node) {
-        return new TermRegionQueryHandler(elements_per_node);
+    static TermRegionQueryHandler* construct(uint16 elements_per_node, bool batch_updates) {
+        return new TermRegionQueryHandler(elements_per_node, batch_updates);
     }
-    static QueryHandlerCreator Constructor(uint16 elements_per_node) {
-        return std::tr1::bind(&TermRegionQueryHandler::construct, elements_per_node);
+    static QueryHandlerCreator Constructor(uint16 elements_per_node, bool batch_updates = false) {
+        return std::tr1::bind(&TermRegionQueryHandler::construct, elements_per_node, batch_updates);
     }
 
-    TermRegionQueryHandler(uint16 elements_per_node)
+    /** Create a query handler.
+     *  \param elements_per_node branching factor of the tree
+     *  \param batch_updates if true, object additions and removals are
+     *         queued and applied at the start of the next tick, where large
+     *         bursts of additions are bulk loaded into a new tree rather than
+     *         inserted one by one. Since results are only computed during
+     *         ticks, queries see the same results either way.
+     */
+    TermRegionQueryHandler(uint16 elements_per_node, bool batch_updates = false)
      : QueryHandlerType(),
        mLocCache(NULL),
        mLocUpdateProvider(NULL),
        mRTree(NULL),
        mLastTime(Time::null()),
        mElementsPerNode(elements_per_node),
-       mRebuilding(false)
+       mRebuilding(false),
+       mBatchUpdates(batch_updates)
     {
     }
 
@@ -314,6 +326,8 @@ public:
     }
 
     void tick(const Time& t, bool report) {
+        applyPendingUpdates();
+
         mRTree->update(t);
         if (QueryHandlerType::mShouldRestructure)
             mRTree->restructure(t);
@@ -351,6 +365,12 @@ public:
     }
 
     virtual void rebuild() {
+        // Removals go through the old tree so the cuts see them, but pending
+        // additions can go straight into the new tree.
+        applyPendingRemovals();
+        mObjects.insert(mPendingAdditions.begin(), mPendingAdditions.end());
+        mPendingAdditions.clear();
+
         validateCuts();
 
         // First, get all cuts out of the original tree
@@ -360,12 +380,18 @@ public:
         // Then rebuild
         mRebuilding = true;
 
-        ObjectList objects = allObjects();
+        // The new tree reuses the iterators we're already tracking, so
+        // mObjects stays valid for later updates and removals.
+        ObjectList objects;
+        objects.reserve(mObjects.size());
+        for(ObjectSetIterator it = mObjects.begin(); it != mObjects.end(); it++)
+            objects.push_back(it->second);
+        sortTileRecursive(objects, mLastTime);
         bool static_objects = mRTree->staticObjects();
         bool replicated = mRTree->replicated();
 
-        // Destroy current tree
-        destroyCurrentTree();
+        // Destroy current tree, but not the objects in it
+        delete mRTree;
 
         // Build new tree
         using std::tr1::placeholders::_1;
@@ -413,7 +439,7 @@ public:
     }
 
     virtual uint32 numObjects() const {
-        return (uint32)mObjects.size();
+        return (uint32)(mObjects.size() - mPendingRemovals.size() + mPendingAdditions.size());
     }
     virtual uint32 numQueries() const {
         return (uint32)mQueries.size();
@@ -458,7 +484,17 @@ public:
     }
     void addObject(const LocCacheIterator& obj_loc_it) {
         ObjectID obj_id = mLocCache->iteratorID(obj_loc_it);
+        // If the object left and came back before we applied its removal, the
+        // removal needs to happen first
+        if (mPendingRemovals.find(obj_id) != mPendingRemovals.end())
+            applyPendingRemovals();
         assert(mObjects.find(obj_id) == mObjects.end());
+        assert(mPendingAdditions.find(obj_id) == mPendingAdditions.end());
+
+        if (mBatchUpdates) {
+            mPendingAdditions[obj_id] = obj_loc_it;
+            return;
+        }
 
         mObjects[obj_id] = obj_loc_it;
         mRTree->insert(mObjects[obj_id], mLastTime);
@@ -471,6 +507,10 @@ public:
     }
     void addObject(const LocCacheIterator& obj_loc_it, const ObjectID& parent) {
         ObjectID obj_id = mLocCache->iteratorID(obj_loc_it);
+        // Objects with explicit parents are replicated tree structure, which
+        // isn't batched, but still must be ordered after any removal
+        if (mPendingRemovals.find(obj_id) != mPendingRemovals.end())
+            applyPendingRemovals();
         assert(mObjects.find(obj_id) == mObjects.end());
 
         mObjects[obj_id] = obj_loc_it;
@@ -481,9 +521,22 @@ public:
     }
 
     void removeObject(const ObjectID& obj_id, bool temporary = false) {
+        // Objects that never made it into the tree can just be dropped
+        typename ObjectSet::iterator pending_it = mPendingAdditions.find(obj_id);
+        if (pending_it != mPendingAdditions.end()) {
+            mLocCache->stopTracking(pending_it->second);
+            mPendingAdditions.erase(pending_it);
+            return;
+        }
+
         typename ObjectSet::iterator it = mObjects.find(obj_id);
         if (it == mObjects.end()) return;
 
+        if (mBatchUpdates) {
+            mPendingRemovals[obj_id] = temporary;
+            return;
+        }
+
         mRTree->verifyConstraints(mLastTime);
         validateCuts();
 
@@ -497,13 +550,19 @@ public:
     }
 
     bool containsObject(const ObjectID& obj_id) {
-        return (mObjects.find(obj_id) != mObjects.end());
+        if (mPendingAdditions.find(obj_id) != mPendingAdditions.end()) return true;
+        return (mObjects.find(obj_id) != mObjects.end() &&
+            mPendingRemovals.find(obj_id) == mPendingRemovals.end());
     }
 
     ObjectList allObjects() {
         ObjectList retval;
-        retval.reserve(mObjects.size());
-        for(typename ObjectSet::iterator it = mObjects.begin(); it != mObjects.end(); it++)
+        retval.reserve(numObjects());
+        for(typename ObjectSet::iterator it = mObjects.begin(); it != mObjects.end(); it++) {
+            if (mPendingRemovals.find(it->first) != mPendingRemovals.end()) continue;
+            retval.push_back(mLocCache->startTracking(it->first));
+        }
+        for(typename ObjectSet::iterator it = mPendingAdditions.begin(); it != mPendingAdditions.end(); it++)
             retval.push_back(mLocCache->startTracking(it->first));
         return retval;
     }
@@ -553,7 +612,7 @@ public:
 
 
     void locationConnected(const ObjectID& obj_id, bool aggregate, bool local, const MotionVector3& pos, const BoundingSphere& region, Real ms) {
-        assert(mObjects.find(obj_id) == mObjects.end());
+        assert(!containsObject(obj_id));
 
         bool do_track = true;
         if (mShouldTrackCB) do_track = mShouldTrackCB(obj_id, local, aggregate, pos, region, ms);
@@ -567,7 +626,7 @@ public:
     }
 
     void locationConnectedWithParent(const ObjectID& obj_id, const ObjectID& parent, bool aggregate, bool local, const MotionVector3& pos, const BoundingSphere& region, Real ms) {
-        assert(mObjects.find(obj_id) == mObjects.end());
+        assert(!containsObject(obj_id));
 
         bool do_track = true;
         if (mShouldTrackCB) do_track = mShouldTrackCB(obj_id, local, aggregate, pos, region, ms);
@@ -738,9 +797,113 @@ private:
             mLocCache->stopTracking(it->second);
         }
         mObjects.clear();
+        mPendingRemovals.clear();
+        for(ObjectSetIterator it = mPendingAdditions.begin(); it != mPendingAdditions.end(); it++) {
+            mLocCache->stopTracking(it->second);
+        }
+        mPendingAdditions.clear();
+    }
+
+    // Applies additions and removals queued in batched mode.
+    void applyPendingUpdates() {
+        applyPendingRemovals();
+
+        if (mPendingAdditions.empty()) return;
+
+        // Inserting updates all the ancestors of each new object, so for large
+        // bursts, e.g. during startup, building a new tree is much cheaper. We
+        // only do this when the burst is a significant fraction of the tree,
+        // since a rebuild also has to swap all the cuts over to the new tree.
+        if (mPendingAdditions.size() >= BulkLoadMinObjects &&
+            mPendingAdditions.size() * BulkLoadFractionDenominator >= mObjects.size())
+        {
+            rebuild();
+            return;
+        }
+
+        for(ObjectSetIterator it = mPendingAdditions.begin(); it != mPendingAdditions.end(); it++) {
+            mObjects[it->first] = it->second;
+            mRTree->insert(it->second, mLastTime);
+        }
+        mPendingAdditions.clear();
+
+        mRTree->verifyConstraints(mLastTime);
+        validateCuts();
+    }
+
+    void applyPendingRemovals() {
+        if (mPendingRemovals.empty()) return;
+
+        for(typename PendingRemovalMap::iterator it = mPendingRemovals.begin(); it != mPendingRemovals.end(); it++) {
+            ObjectSetIterator obj_it = mObjects.find(it->first);
+            assert(obj_it != mObjects.end());
+            LocCacheIterator obj_loc_it = obj_it->second;
+            deleteObj(it->first, mLastTime, it->second);
+            mLocCache->stopTracking(obj_loc_it);
+            mObjects.erase(obj_it);
+        }
+        mPendingRemovals.clear();
+
+        mRTree->verifyConstraints(mLastTime);
+        validateCuts();
+    }
+
+    // Orders objects using Sort-Tile-Recursive packing: sorted into slabs
+    // along x, each slab into strips along y, and each strip along z. Each
+    // consecutive run of mElementsPerNode objects is then spatially compact,
+    // which gives the bulk loader tight leaves and, since children are
+    // similar, smaller aggregate bloom filters.
+    struct STREntry {
+        Vector3 center;
+        LocCacheIterator obj;
+    };
+    struct STRAxisLess {
+        STRAxisLess(uint32 ax) : axis(ax) {}
+        bool operator()(const STREntry& lhs, const STREntry& rhs) const {
+            return lhs.center[axis] < rhs.center[axis];
+        }
+        uint32 axis;
+    };
+    typedef typename std::vector<STREntry>::iterator STREntryIterator;
+
+    void sortTileRecursive(ObjectList& objects, const Time& t) {
+        if (objects.size() <= mElementsPerNode) return;
+
+        std::vector<STREntry> entries;
+        entries.reserve(objects.size());
+        for(uint32 i = 0; i < objects.size(); i++) {
+            STREntry entry = { mLocCache->worldRegion(objects[i], t).center(), objects[i] };
+            entries.push_back(entry);
+        }
+
+        uint32 nleaves = (entries.size() + mElementsPerNode - 1) / mElementsPerNode;
+        uint32 slices = std::max(1, (int)ceil(pow((double)nleaves, 1.0/3.0)));
+        sortTileRecursive(entries.begin(), entries.end(), 0, slices);
+
+        for(uint32 i = 0; i < entries.size(); i++)
+            objects[i] = entries[i].obj;
+    }
+
+    void sortTileRecursive(STREntryIterator begin, STREntryIterator end, uint32 axis, uint32 slices) {
+        std::sort(begin, end, STRAxisLess(axis));
+        if (axis == 2) return;
+
+        // Round slab sizes up to whole leaves so slabs don't share leaves
+        uint32 count = end - begin;
+        uint32 slab_leaves = (((count + mElementsPerNode - 1) / mElementsPerNode) + slices - 1) / slices;
+        uint32 slab_size = std::max((uint32)1, slab_leaves) * mElementsPerNode;
+        for(uint32 start = 0; start < count; start += slab_size) {
+            uint32 slab_end = std::min(count, start + slab_size);
+            sortTileRecursive(begin + start, begin + slab_end, axis + 1, slices);
+        }
     }
 
     void updateObj(const ObjectID& obj_id, const Time& t) {
+        // Objects waiting to be inserted will pick up their current state when
+        // they are, and those waiting to be removed don't matter anymore
+        if (mPendingRemovals.find(obj_id) != mPendingRemovals.end())
+            return;
+
         typename ObjectSet::iterator it = mObjects.find(obj_id);
         if (it != mObjects.end()) {
             mRTree->update(mObjects[obj_id], t);
@@ -797,9 +960,9 @@ private:
         }
 
     public:
-        bool updateSatisfies(const String& term, Vector3 region_min, Vector3 region_max) {
+        bool updateSatisfies(const String& term, Twitter::TermHashes* term_hashes, Vector3 region_min, Vector3 region_max) {
             satisfies = checkTermRegion(
-                term, region_min, region_max, getParent()->mMinResultRadius,
+                term, term_hashes, region_min, region_max, getParent()->mMinResultRadius,
                 rtnode->data().getBloomFilter(), rtnode->data().getBounds()
             );
             return satisfies;
@@ -964,7 +1127,7 @@ private:
             DetailedQueryType* dquery = detailedQuery();
             NodeData nd = node->childData(objidx, t);
             return checkTermRegion(
-                dquery->term, dquery->region_min, dquery->region_max, mMinResultRadius,
+                dquery->term, &dquery->term_hashes, dquery->region_min, dquery->region_max, mMinResultRadius,
                 nd.getBloomFilter(), nd.getBounds()
             );
         }
@@ -1050,6 +1213,7 @@ private:
 
             DetailedQueryType* dquery = detailedQuery();
             const String& query_term = dquery->term;
+            Twitter::TermHashes* query_term_hashes = &dquery->term_hashes;
             Vector3 query_region_min = dquery->region_min;
             Vector3 query_region_max = dquery->region_max;
             int32 query_max_results = dquery->max_results;
@@ -1061,7 +1225,7 @@ private:
             for(CutNodeListIterator it = nodes.begin(); it != nodes.end(); ) {
                 CutNode<SimulationTraits>* node = *it;
                 bool last_satisfies = node->satisfies;
-                bool satisfies = node->updateSatisfies(query_term, query_region_min, query_region_max);
+                bool satisfies = node->updateSatisfies(query_term, query_term_hashes, query_region_min, query_region_max);
                 visited++;
 
                 // Possibly flush events. Do this up here because some paths use continue;
@@ -1175,7 +1339,7 @@ private:
                             // node and expanding it back again.
                             bool parent_satisfies =
                                 checkTermRegion(
-                                    query_term, query_region_min, query_region_max, mMinResultRadius,
+                                    query_term, query_term_hashes, query_region_min, query_region_max, mMinResultRadius,
                                     this_parent->data().getBloomFilter(), this_parent->data().getBounds()
                                 );
                             visited++;
@@ -1244,7 +1408,7 @@ private:
                         NodeData nd = node->rtnode->childData(i, t);
                         bool child_satisfies =
                             checkTermRegion(
-                                query_term, query_region_min, query_region_max, mMinResultRadius,
+                                query_term, query_term_hashes, query_region_min, query_region_max, mMinResultRadius,
                                 nd.getBloomFilter(), nd.getBounds()
                             );
                         visited++;
@@ -1441,6 +1605,11 @@ private:
     LocationUpdateProviderType* mLocUpdateProvider;
     ShouldTrackCallback mShouldTrackCB;
 
+    // Minimum size of a burst of additions that is bulk loaded, and the
+    // fraction of the current tree size it must reach
+    static const uint32 BulkLoadMinObjects = 256;
+    static const uint32 BulkLoadFractionDenominator = 4;
+
     RTree* mRTree;
     ObjectSet mObjects;
     ObjectSet mNodes;
@@ -1448,6 +1617,13 @@ private:
     Time mLastTime;
     uint16 mElementsPerNode;
     bool mRebuilding;
+
+    bool mBatchUpdates;
+    // Objects queued in batched mode. Pending additions aren't in mObjects
+    // yet; pending removals still are, and map to the temporary flag.
+    ObjectSet mPendingAdditions;
+    typedef std::tr1::unordered_map<ObjectID, bool, ObjectIDHasher> PendingRemovalMap;
+    PendingRemovalMap mPendingRemovals;
 }; // class TermRegionQueryHandler
 
 } // namespace Sirikata
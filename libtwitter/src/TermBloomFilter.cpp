@@ -5,16 +5,93 @@
 #include <sirikata/twitter/TermBloomFilter.hpp>
 #include <boost/asio.hpp> // hton/ntoh
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SIRIKATA_TWITTER_BLOOM_SSE2 1
+#include <emmintrin.h>
+#endif
+
 namespace Sirikata {
 namespace Twitter {
 
+namespace {
+
+// Words are allocated in pairs so the SSE2 kernels never need a scalar tail
+const uint32 WordsPerVector = 2;
+
+uint32 wordsForBuckets(uint32 buckets) {
+    uint32 bits_per_vector = WordsPerVector * 64;
+    return ((buckets + bits_per_vector - 1) / bits_per_vector) * WordsPerVector;
+}
+
+uint32 countBits(uint64 v) {
+#if defined(__GNUC__)
+    return __builtin_popcountll(v);
+#else
+    v = v - ((v >> 1) & 0x5555555555555555ULL);
+    v = (v & 0x3333333333333333ULL) + ((v >> 2) & 0x3333333333333333ULL);
+    v = (v + (v >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+    return (uint32)((v * 0x0101010101010101ULL) >> 56);
+#endif
+}
+
+// dst |= src
+void orWords(uint64* dst, const uint64* src, uint32 nwords) {
+#ifdef SIRIKATA_TWITTER_BLOOM_SSE2
+    for(uint32 i = 0; i < nwords; i += WordsPerVector) {
+        __m128i a = _mm_loadu_si128((const __m128i*)(dst + i));
+        __m128i b = _mm_loadu_si128((const __m128i*)(src + i));
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_or_si128(a, b));
+    }
+#else
+    for(uint32 i = 0; i < nwords; i++)
+        dst[i] |= src[i];
+#endif
+}
+
+// dst &= src
+void andWords(uint64* dst, const uint64* src, uint32 nwords) {
+#ifdef SIRIKATA_TWITTER_BLOOM_SSE2
+    for(uint32 i = 0; i < nwords; i += WordsPerVector) {
+        __m128i a = _mm_loadu_si128((const __m128i*)(dst + i));
+        __m128i b = _mm_loadu_si128((const __m128i*)(src + i));
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_and_si128(a, b));
+    }
+#else
+    for(uint32 i = 0; i < nwords; i++)
+        dst[i] &= src[i];
+#endif
+}
+
+// Whether every bit set in sub is also set in super, i.e. sub & ~super == 0
+bool subsetWords(const uint64* sub, const uint64* super, uint32 nwords) {
+#ifdef SIRIKATA_TWITTER_BLOOM_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    for(uint32 i = 0; i < nwords; i += WordsPerVector) {
+        __m128i a = _mm_loadu_si128((const __m128i*)(sub + i));
+        __m128i b = _mm_loadu_si128((const __m128i*)(super + i));
+        __m128i extra = _mm_andnot_si128(b, a);
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(extra, zero)) != 0xFFFF)
+            return false;
+    }
+#else
+    for(uint32 i = 0; i < nwords; i++) {
+        if ((sub[i] & ~super[i]) != 0)
+            return false;
+    }
+#endif
+    return true;
+}
+
+} // namespace
+
 TermBloomFilter::TermBloomFilter(uint32 buckets, uint16 hashes)
  : mFilterBuckets(buckets),
    mFilterBytes((buckets + 7)/8),
-   mFilter(new unsigned char[mFilterBytes]),
+   mFilterWords(wordsForBuckets(buckets)),
+   mFilter(new uint64[mFilterWords]),
    mNumHashes(hashes)
 {
-    memset(mFilter, 0, mFilterBytes);
+    memset(mFilter, 0, mFilterWords * sizeof(uint64));
 
     // Get number of required bits, buffer with extra 3 to make %
     // operation skew distribution less (instead of minimal coverage +
@@ -40,11 +117,12 @@ TermBloomFilter::~TermBloomFilter() {
 TermBloomFilter::TermBloomFilter(const TermBloomFilter& rhs)
  : mFilterBuckets(rhs.mFilterBuckets),
    mFilterBytes(rhs.mFilterBytes),
-   mFilter(new unsigned char[mFilterBytes]),
+   mFilterWords(rhs.mFilterWords),
+   mFilter(new uint64[mFilterWords]),
    mNumHashes(rhs.mNumHashes),
    mHashBytesLen(rhs.mHashBytesLen)
 {
-    memcpy(mFilter, rhs.mFilter, mFilterBytes);
+    memcpy(mFilter, rhs.mFilter, mFilterWords * sizeof(uint64));
 }
 
 TermBloomFilter& TermBloomFilter::operator=(const TermBloomFilter& rhs) {
@@ -54,7 +132,7 @@ TermBloomFilter& TermBloomFilter::operator=(const TermBloomFilter& rhs) {
     assert(mHashBytesLen == rhs.mHashBytesLen);
 
     assert(mFilter != NULL);
-    memcpy(mFilter, rhs.mFilter, mFilterBytes);
+    memcpy(mFilter, rhs.mFilter, mFilterWords * sizeof(uint64));
 
     return *this;
 }
@@ -65,37 +143,69 @@ void TermBloomFilter::mergeIn(const TermBloomFilter& rhs) {
     assert(mNumHashes == rhs.mNumHashes);
     assert(mHashBytesLen == rhs.mHashBytesLen);
 
-    for(size_t i = 0; i < mFilterBytes; i++)
-        mFilter[i] = (mFilter[i] | rhs.mFilter[i]);
+    orWords(mFilter, rhs.mFilter, mFilterWords);
+}
+
+void TermBloomFilter::intersectWith(const TermBloomFilter& rhs) {
+    assert(mFilterBuckets == rhs.mFilterBuckets);
+    assert(mFilterBytes == rhs.mFilterBytes);
+    assert(mNumHashes == rhs.mNumHashes);
+    assert(mHashBytesLen == rhs.mHashBytesLen);
+
+    andWords(mFilter, rhs.mFilter, mFilterWords);
 }
 
 void TermBloomFilter::insert(const String& term) {
     MultiHashingState state;
-    for(uint16 nhash = 0; nhash < mNumHashes; nhash++) {
-        uint32 hash_val = computeMoreHashBits(state, term) % mFilterBuckets;
-        uint32 bucket_byte_idx = hash_val/8, bucket_bit_idx = hash_val % 8;
-        mFilter[bucket_byte_idx] = ( mFilter[bucket_byte_idx] | (((unsigned char)1)<<bucket_bit_idx) );
-    }
+    for(uint16 nhash = 0; nhash < mNumHashes; nhash++)
+        setBucket(computeMoreHashBits(state, term) % mFilterBuckets);
 }
 
 bool TermBloomFilter::lookup(const String& term) const {
     MultiHashingState state;
     for(uint16 nhash = 0; nhash < mNumHashes; nhash++) {
-        uint32 hash_val = computeMoreHashBits(state, term) % mFilterBuckets;
-        uint32 bucket_byte_idx = hash_val/8, bucket_bit_idx = hash_val % 8;
-        if ( ( mFilter[bucket_byte_idx] & (((unsigned char)1)<<bucket_bit_idx) ) == 0 )
+        if (!testBucket(computeMoreHashBits(state, term) % mFilterBuckets))
             return false;
     }
     return true;
 }
 
+bool TermBloomFilter::lookup(const String& term, TermHashes* hashes_cache) const {
+    assert(hashes_cache != NULL);
+    if (!hashes_cache->matches(term, mFilterBuckets, mNumHashes))
+        computeHashes(term, hashes_cache);
+
+    const std::vector<uint32>& indices = hashes_cache->mIndices;
+    for(std::vector<uint32>::const_iterator it = indices.begin(); it != indices.end(); it++) {
+        if (!testBucket(*it))
+            return false;
+    }
+    return true;
+}
+
+void TermBloomFilter::computeHashes(const String& term, TermHashes* hashes) const {
+    hashes->mTerm = term;
+    hashes->mBuckets = mFilterBuckets;
+    hashes->mHashes = mNumHashes;
+    hashes->mIndices.resize(mNumHashes);
+
+    MultiHashingState state;
+    for(uint16 nhash = 0; nhash < mNumHashes; nhash++)
+        hashes->mIndices[nhash] = computeMoreHashBits(state, term) % mFilterBuckets;
+}
+
 void TermBloomFilter::serialize(String& output) const {
     output.resize(sizeof(uint32) + sizeof(uint16) + bytesSize());
     char* outbuf = &output[0];
 
     *((uint32*)outbuf) = htonl(size()); outbuf += sizeof(uint32);
     *((uint16*)outbuf) = htons(hashes()); outbuf += sizeof(uint16);
+#if SIRIKATA_BYTE_ORDER == SIRIKATA_LITTLE_ENDIAN
     memcpy(outbuf, mFilter, mFilterBytes);
+#else
+    for(uint32 i = 0; i < mFilterBytes; i++)
+        outbuf[i] = (char)((mFilter[i / 8] >> ((i % 8) * 8)) & 0xFF);
+#endif
 }
 
 void TermBloomFilter::deserialize(const String& input) {
@@ -106,7 +216,14 @@ void TermBloomFilter::deserialize(const String& input) {
     assert(buckets == mFilterBuckets);
     assert(nhashes == mNumHashes);
     assert(input.size() == (sizeof(uint32) + sizeof(uint16) + bytesSize()));
+    // Clear first so the padding bytes in the last words stay 0
+    memset(mFilter, 0, mFilterWords * sizeof(uint64));
+#if SIRIKATA_BYTE_ORDER == SIRIKATA_LITTLE_ENDIAN
     memcpy(mFilter, inbuf, mFilterBytes);
+#else
+    for(uint32 i = 0; i < mFilterBytes; i++)
+        mFilter[i / 8] |= ((uint64)(unsigned char)inbuf[i]) << ((i % 8) * 8);
+#endif
 }
 
 uint32 TermBloomFilter::computeMoreHashBits(MultiHashingState& state, const String& term) const {
@@ -131,21 +248,15 @@ uint32 TermBloomFilter::computeMoreHashBits(MultiHashingState& state, const Stri
 
 
 bool TermBloomFilter::subsetOf(const TermBloomFilter& other) const {
-    for(size_t i = 0; i < mFilterBytes; i++) {
-        // other must have at least the bits this does, so the intersection
-        // should equal this filters bits
-        if ((other.mFilter[i] & mFilter[i]) != mFilter[i]) return false;
-    }
-    return true;
+    assert(mFilterWords == other.mFilterWords);
+    // other must have at least the bits this does
+    return subsetWords(mFilter, other.mFilter, mFilterWords);
 }
 
 uint32 TermBloomFilter::count() const {
-    // FIXME there's a much smarter more efficient way to count these
     uint32 c = 0;
-    for(size_t i = 0; i < mFilterBytes; i++) {
-        for(int off = 0; off < 8; off++)
-            if ( ((mFilter[i] >> off) & 0x1) != 0) c++;
-    }
+    for(uint32 i = 0; i < mFilterWords; i++)
+        c += countBits(mFilter[i]);
     return c;
 }
 
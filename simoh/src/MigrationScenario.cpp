@@ -0,0 +1,152 @@
+// Copyright (c) 2015 Sirikata Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can
+// be found in the LICENSE file.
+
+#include "MigrationScenario.hpp"
+#include "ScenarioFactory.hpp"
+#include "SimObjectHost.hpp"
+#include <sirikata/core/options/Options.hpp>
+#include <sirikata/core/trace/Trace.hpp>
+#include "Options.hpp"
+
+#define MIGSCENARIO_LOG(lvl,msg) SILOG(migration,lvl,msg)
+
+namespace Sirikata {
+
+void MSInitOptions(MigrationScenario *thus) {
+    Sirikata::InitializeClassOptions ico("MigrationScenario",thus,
+        new OptionValue("sample-interval","100ms",Sirikata::OptionValueType<Duration>(),"How often to sample the number of migrations. This is the resolution of burst timings."),
+        new OptionValue("burst-gap","2s",Sirikata::OptionValueType<Duration>(),"Period without any migrations which ends a burst of migrations."),
+        NULL);
+}
+
+MigrationScenario::MigrationScenario(const String &options)
+ : mContext(NULL),
+   mSamplePoller(NULL),
+   mMigrations(0),
+   mStarted(false),
+   mLastSampleCount(0),
+   mLastSampleTime(Time::null()),
+   mLastMigrationTime(Time::null()),
+   mInBurst(false),
+   mBurstStart(Time::null()),
+   mBurstStartCount(0),
+   mNumBursts(0),
+   mTotalBurstTime(Duration::zero()),
+   mTotalBurstMigrations(0)
+{
+    MSInitOptions(this);
+    OptionSet* optionsSet = OptionSet::getOptions("MigrationScenario",this);
+    optionsSet->parse(options);
+
+    mSampleInterval = optionsSet->referenceOption("sample-interval")->as<Duration>();
+    mBurstGap = optionsSet->referenceOption("burst-gap")->as<Duration>();
+}
+
+MigrationScenario::~MigrationScenario() {
+    delete mSamplePoller;
+}
+
+MigrationScenario* MigrationScenario::create(const String& options) {
+    return new MigrationScenario(options);
+}
+
+void MigrationScenario::addConstructorToFactory(ScenarioFactory* thus) {
+    thus->registerConstructor("migration", &MigrationScenario::create);
+}
+
+void MigrationScenario::initialize(ObjectHostContext* ctx) {
+    mContext = ctx;
+    mContext->objectHost->addListener(this);
+
+    mTimeSeriesMigrations = String("oh.server") + boost::lexical_cast<String>(mContext->id) + ".migrations";
+
+    mSamplePoller = new Poller(
+        ctx->mainStrand,
+        std::tr1::bind(&MigrationScenario::sample, this),
+        "MigrationScenario Sample Poller",
+        mSampleInterval
+    );
+}
+
+void MigrationScenario::start() {
+    // Ignore the initial connection phase, which may shuffle objects around
+    // before they settle on their first servers.
+    Duration connect_phase = GetOptionValue<Duration>(OBJECT_CONNECT_PHASE);
+    mContext->mainStrand->post(
+        connect_phase,
+        std::tr1::bind(&MigrationScenario::delayedStart, this),
+        "MigrationScenario::delayedStart"
+    );
+}
+
+void MigrationScenario::delayedStart() {
+    mStarted = true;
+    mLastSampleCount = mMigrations.read();
+    mLastSampleTime = mContext->simTime();
+    mSamplePoller->start();
+}
+
+void MigrationScenario::stop() {
+    mContext->objectHost->removeListener(this);
+    if (!mStarted) return;
+    mSamplePoller->stop();
+
+    if (mInBurst)
+        finishBurst();
+
+    uint32 total = mMigrations.read();
+    MIGSCENARIO_LOG(fatal,
+        "Migrations: " << total <<
+        " Bursts: " << mNumBursts <<
+        " Migrations in bursts: " << mTotalBurstMigrations <<
+        " Time in bursts: " << mTotalBurstTime <<
+        " Rate: " << (mTotalBurstTime > Duration::zero() ? mTotalBurstMigrations / mTotalBurstTime.toSeconds() : 0.f) << " migrations/s"
+    );
+}
+
+void MigrationScenario::objectHostMigratedObject(ObjectHost* oh, const UUID& objid, const ServerID& from_server, const ServerID& to_server) {
+    ++mMigrations;
+}
+
+void MigrationScenario::sample() {
+    Time tnow = mContext->simTime();
+    uint32 count = mMigrations.read();
+    uint32 new_migrations = count - mLastSampleCount;
+
+    mContext->timeSeries->report(mTimeSeriesMigrations, new_migrations);
+
+    if (new_migrations > 0) {
+        if (!mInBurst) {
+            // The burst started some time after the last quiet sample
+            mInBurst = true;
+            mBurstStart = mLastSampleTime;
+            mBurstStartCount = mLastSampleCount;
+        }
+        mLastMigrationTime = tnow;
+    }
+    else if (mInBurst && tnow - mLastMigrationTime >= mBurstGap) {
+        finishBurst();
+    }
+
+    mLastSampleCount = count;
+    mLastSampleTime = tnow;
+}
+
+void MigrationScenario::finishBurst() {
+    mInBurst = false;
+
+    uint32 burst_migrations = mLastSampleCount - mBurstStartCount;
+    Duration burst_time = mLastMigrationTime - mBurstStart;
+
+    mNumBursts++;
+    mTotalBurstMigrations += burst_migrations;
+    mTotalBurstTime += burst_time;
+
+    MIGSCENARIO_LOG(info,
+        "Migration burst: " << burst_migrations << " objects in " << burst_time <<
+        " (" << (burst_time > Duration::zero() ? burst_migrations / burst_time.toSeconds() : 0.f) << " migrations/s)"
+    );
+}
+
+} // namespace Sirikata
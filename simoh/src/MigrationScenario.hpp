@@ -0,0 +1,69 @@
+// Copyright (c) 2015 Sirikata Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can
+// be found in the LICENSE file.
+
+#ifndef _MIGRATION_SCENARIO_HPP_
+#define _MIGRATION_SCENARIO_HPP_
+
+#include "Scenario.hpp"
+#include "ObjectHostListener.hpp"
+#include <sirikata/core/service/Poller.hpp>
+#include <sirikata/core/util/AtomicTypes.hpp>
+
+namespace Sirikata {
+
+class ScenarioFactory;
+
+/** Measures migration throughput. Objects are moved between servers by their
+ *  motion paths or by the space servers changing region boundaries; this
+ *  scenario just watches the resulting migrations. Migrations are grouped into
+ *  bursts, separated by periods with no migrations, and for each burst we
+ *  report how many objects migrated, how long it took for the servers to
+ *  settle, and the resulting rate.
+ */
+class MigrationScenario : public Scenario, public ObjectHostListener {
+public:
+    MigrationScenario(const String &options);
+    ~MigrationScenario();
+
+    virtual void initialize(ObjectHostContext*);
+    void start();
+    void stop();
+    static void addConstructorToFactory(ScenarioFactory*);
+
+private:
+    static MigrationScenario* create(const String&options);
+
+    // ObjectHostListener Interface
+    virtual void objectHostMigratedObject(ObjectHost* oh, const UUID& objid, const ServerID& from_server, const ServerID& to_server);
+
+    void delayedStart();
+    void sample();
+    void finishBurst();
+
+    ObjectHostContext* mContext;
+    Poller* mSamplePoller;
+    Duration mSampleInterval;
+    Duration mBurstGap;
+    String mTimeSeriesMigrations;
+
+    // Updated from whichever thread reports migrations
+    AtomicValue<uint32> mMigrations;
+
+    // Main strand only
+    bool mStarted;
+    uint32 mLastSampleCount;
+    Time mLastSampleTime;
+    // Time of the sample which last saw new migrations
+    Time mLastMigrationTime;
+    bool mInBurst;
+    Time mBurstStart;
+    uint32 mBurstStartCount;
+    uint32 mNumBursts;
+    Duration mTotalBurstTime;
+    uint32 mTotalBurstMigrations;
+};
+
+} // namespace Sirikata
+
+#endif //_MIGRATION_SCENARIO_HPP_
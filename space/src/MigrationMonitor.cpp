@@ -34,6 +34,38 @@
 
 namespace Sirikata {
 
+namespace {
+// Number of grid cells along the longest axis of the world
+const float32 GridCellsPerAxis = 64.f;
+// Cell size used when the world is unbounded
+const float32 DefaultGridCellSize = 100.f;
+// Objects whose paths cover more cells than this are tracked separately
+// rather than being inserted into every cell
+const uint64 MaxIndexedCells = 64;
+
+// Whether the box is fully covered by a single box in the list. This is
+// conservative, but boxes in a server's region don't overlap so covering
+// usually only happens within one box.
+bool coveredBy(const BoundingBoxList& regions, const BoundingBox3f& bb) {
+    for(BoundingBoxList::const_iterator it = regions.begin(); it != regions.end(); it++) {
+        if (it->degenerate()) return true;
+        if (it->contains(bb.min(), 0.0f) && it->contains(bb.max(), 0.0f)) return true;
+    }
+    return false;
+}
+
+bool overlaps(const BoundingBoxList& regions, const BoundingBox3f& bb) {
+    for(BoundingBoxList::const_iterator it = regions.begin(); it != regions.end(); it++) {
+        if (it->degenerate() || it->intersects(bb)) return true;
+    }
+    return false;
+}
+
+bool listContains(const BoundingBoxList& regions, const BoundingBox3f& bb) {
+    return (std::find(regions.begin(), regions.end(), bb) != regions.end());
+}
+}
+
 MigrationMonitor::MigrationMonitor(SpaceContext* ctx, LocationService* locservice, CoordinateSegmentation* cseg, MigrationCallback cb)
  : mContext(ctx),
    mLocService(locservice),
@@ -52,6 +84,20 @@ MigrationMonitor::MigrationMonitor(SpaceContext* ctx, LocationService* locservic
     mCSeg->addListener(this);
 
     mBoundingRegions = mCSeg->serverRegion( mLocService->context()->id() );
+
+    // The grid is fixed for the lifetime of the monitor so that segmentation
+    // changes never require reindexing every object.
+    BoundingBox3f world = mCSeg->region();
+    if (world.degenerate()) {
+        mGridOrigin = Vector3f(0, 0, 0);
+        mGridCellSize = DefaultGridCellSize;
+    }
+    else {
+        Vector3f extents = world.extents();
+        float32 max_extent = std::max( std::max(extents.x, extents.y), extents.z );
+        mGridOrigin = world.min();
+        mGridCellSize = std::max(1.f, max_extent / GridCellsPerAxis);
+    }
 }
 
 MigrationMonitor::~MigrationMonitor() {
@@ -113,7 +159,6 @@ void MigrationMonitor::service() {
     }
 
     // Update events for all objects we considered
-    ObjectInfoByID& by_id = mObjectInfo.get<objid>();
     for(std::set<UUID>::iterator it = considered.begin(); it != considered.end(); it++) {
         // Since mCB (called above) might migrate the object and remove it, we need to make sure
         // we still have it.  FIXME Strand->wrap which uses post() instead of dispatch() would
@@ -121,10 +166,7 @@ void MigrationMonitor::service() {
         if (!mLocService->contains(*it))
             continue;
 
-        by_id.modify(
-            by_id.find(*it),
-            std::tr1::bind(&MigrationMonitor::changeNextEventTime, std::tr1::placeholders::_1, computeNextEventTime(*it, mLocService->location(*it)))
-        );
+        updateNextEventTime(*it, mLocService->location(*it));
     }
 
     waitForNextEvent();
@@ -214,11 +256,163 @@ Time MigrationMonitor::computeNextEventTime(const UUID& obj, const TimedMotionVe
     return curt + to_first_hit;
 }
 
+void MigrationMonitor::updateNextEventTime(const UUID& obj, const TimedMotionVector3f& newloc) {
+    Time next_event = computeNextEventTime(obj, newloc);
+
+    ObjectInfoByID& by_id = mObjectInfo.get<objid>();
+    by_id.modify(
+        by_id.find(obj),
+        std::tr1::bind(&MigrationMonitor::changeNextEventTime, std::tr1::placeholders::_1, next_event)
+    );
+
+    indexObject(obj, newloc, next_event);
+}
+
 // Helper for multi_index modify method
 void MigrationMonitor::changeNextEventTime(ObjectInfo& objinfo, const Time& newt) {
     objinfo.nextEvent = newt;
 }
 
+MigrationMonitor::GridCell MigrationMonitor::gridCell(const Vector3f& pos) const {
+    // Clamp so far away (or bogus) positions can't overflow the cell indices
+    static const float32 MaxCellIndex = (float32)(1 << 20);
+    Vector3f idx = (pos - mGridOrigin) / mGridCellSize;
+    return GridCell(
+        (int32)std::floor( std::max(-MaxCellIndex, std::min(MaxCellIndex, idx.x)) ),
+        (int32)std::floor( std::max(-MaxCellIndex, std::min(MaxCellIndex, idx.y)) ),
+        (int32)std::floor( std::max(-MaxCellIndex, std::min(MaxCellIndex, idx.z)) )
+    );
+}
+
+BoundingBox3f MigrationMonitor::gridCellBounds(const GridCell& cell) const {
+    Vector3f cmin = mGridOrigin + Vector3f((float32)cell.x, (float32)cell.y, (float32)cell.z) * mGridCellSize;
+    return BoundingBox3f(cmin, cmin + Vector3f(mGridCellSize, mGridCellSize, mGridCellSize));
+}
+
+void MigrationMonitor::indexObject(const UUID& obj, const TimedMotionVector3f& loc, const Time& next_event) {
+    Time curt = mLocService->context()->simTime();
+
+    // The object moves in a straight line, so its path until the next event
+    // is bounded by its current position and its position at the event
+    GridEntry entry;
+    entry.stationary = (loc.velocity().lengthSquared() == 0.f);
+    Vector3f start_pos = loc.position(curt);
+    if (entry.stationary) {
+        entry.min = entry.max = gridCell(start_pos);
+    }
+    else {
+        Vector3f end_pos = loc.position(std::max(curt, next_event));
+        entry.min = gridCell(start_pos.min(end_pos));
+        entry.max = gridCell(start_pos.max(end_pos));
+    }
+
+    GridEntryMap::iterator entry_it = mGridEntries.find(obj);
+    if (entry_it != mGridEntries.end() &&
+        entry_it->second.min == entry.min && entry_it->second.max == entry.max) {
+        entry_it->second.stationary = entry.stationary;
+        return;
+    }
+
+    unindexObject(obj);
+
+    uint64 ncells =
+        (uint64)(entry.max.x - entry.min.x + 1) *
+        (uint64)(entry.max.y - entry.min.y + 1) *
+        (uint64)(entry.max.z - entry.min.z + 1);
+    if (ncells > MaxIndexedCells) {
+        mUnindexedObjects.insert(obj);
+        return;
+    }
+
+    for(int32 x = entry.min.x; x <= entry.max.x; x++)
+        for(int32 y = entry.min.y; y <= entry.max.y; y++)
+            for(int32 z = entry.min.z; z <= entry.max.z; z++)
+                mGrid[GridCell(x, y, z)].insert(obj);
+    mGridEntries[obj] = entry;
+}
+
+void MigrationMonitor::unindexObject(const UUID& obj) {
+    if (mUnindexedObjects.erase(obj) > 0)
+        return;
+
+    GridEntryMap::iterator entry_it = mGridEntries.find(obj);
+    if (entry_it == mGridEntries.end())
+        return;
+
+    const GridEntry& entry = entry_it->second;
+    for(int32 x = entry.min.x; x <= entry.max.x; x++) {
+        for(int32 y = entry.min.y; y <= entry.max.y; y++) {
+            for(int32 z = entry.min.z; z <= entry.max.z; z++) {
+                Grid::iterator cell_it = mGrid.find(GridCell(x, y, z));
+                if (cell_it == mGrid.end()) continue;
+                cell_it->second.erase(obj);
+                if (cell_it->second.empty())
+                    mGrid.erase(cell_it);
+            }
+        }
+    }
+    mGridEntries.erase(entry_it);
+}
+
+void MigrationMonitor::reevaluateChangedRegions(const BoundingBoxList& old_regions) {
+    // Boxes that appear in only one of the segmentations bound the space where
+    // our region changed
+    BoundingBoxList changed;
+    for(BoundingBoxList::const_iterator it = old_regions.begin(); it != old_regions.end(); it++)
+        if (!listContains(mBoundingRegions, *it)) changed.push_back(*it);
+    for(BoundingBoxList::const_iterator it = mBoundingRegions.begin(); it != mBoundingRegions.end(); it++)
+        if (!listContains(old_regions, *it)) changed.push_back(*it);
+    if (changed.empty())
+        return;
+
+    Time curt = mLocService->context()->simTime();
+    ObjectInfoByID& by_id = mObjectInfo.get<objid>();
+
+    // Objects whose paths only cover cells that are unaffected by the change,
+    // or that are inside our region both before and after it, still have
+    // valid events. Everything else is collected for reevaluation.
+    ObjectIDSet dirty(mUnindexedObjects);
+    static const float32 CellPad = 0.001f;
+    for(Grid::iterator cell_it = mGrid.begin(); cell_it != mGrid.end(); cell_it++) {
+        BoundingBox3f cell_bb = gridCellBounds(cell_it->first);
+        // Pad so changed boxes that only share a face with the cell count
+        Vector3f pad(CellPad * mGridCellSize, CellPad * mGridCellSize, CellPad * mGridCellSize);
+        BoundingBox3f padded_bb(cell_bb.min() - pad, cell_bb.max() + pad);
+        if (!overlaps(changed, padded_bb))
+            continue;
+        bool now_inside = coveredBy(mBoundingRegions, cell_bb);
+        if (now_inside && coveredBy(old_regions, cell_bb))
+            continue;
+        bool now_outside = !overlaps(mBoundingRegions, padded_bb);
+
+        // Stationary objects in cells entirely inside or outside the region
+        // all get the same result, so handle them in bulk without looking
+        // them up in Loc
+        for(ObjectIDSet::iterator obj_it = cell_it->second.begin(); obj_it != cell_it->second.end(); obj_it++) {
+            if (dirty.find(*obj_it) != dirty.end()) continue;
+
+            const GridEntry& entry = mGridEntries[*obj_it];
+            if (entry.stationary && (now_inside || now_outside)) {
+                // Matches computeNextEventTime for stationary objects
+                Time next_event = (now_inside ? curt + Duration::seconds(100) : curt);
+                by_id.modify(
+                    by_id.find(*obj_it),
+                    std::tr1::bind(&MigrationMonitor::changeNextEventTime, std::tr1::placeholders::_1, next_event)
+                );
+                continue;
+            }
+
+            dirty.insert(*obj_it);
+        }
+    }
+
+    for(ObjectIDSet::iterator it = dirty.begin(); it != dirty.end(); it++) {
+        if (!mLocService->contains(*it))
+            continue;
+        updateNextEventTime(*it, mLocService->location(*it));
+    }
+}
+
 /** LocationServiceListener Interface. */
 
   void MigrationMonitor::localObjectAdded(const UUID& uuid, bool agg, const TimedMotionVector3f& loc, const TimedMotionQuaternion& orient, const AggregateBoundingInfo& bounds, const String& mesh, const String& phy, const String& query_data) {
@@ -231,7 +425,9 @@ void MigrationMonitor::changeNextEventTime(ObjectInfo& objinfo, const Time& newt
 void MigrationMonitor::handleLocalObjectAdded(const UUID& uuid, const TimedMotionVector3f& loc, const AggregateBoundingInfo& bounds) {
     assert( mObjectInfo.get<objid>().find(uuid) == mObjectInfo.get<objid>().end());
 
-    mObjectInfo.insert( ObjectInfo(uuid, computeNextEventTime(uuid, loc)) );
+    Time next_event = computeNextEventTime(uuid, loc);
+    mObjectInfo.insert( ObjectInfo(uuid, next_event) );
+    indexObject(uuid, loc, next_event);
     waitForNextEvent();
 }
 
@@ -245,6 +441,7 @@ LocationServiceListener::RemovalStatus MigrationMonitor::localObjectRemoved(cons
 
 void MigrationMonitor::handleLocalObjectRemoved(const UUID& uuid, const LocationServiceListener::RemovalCallback& callback) {
     mObjectInfo.get<objid>().erase(uuid);
+    unindexObject(uuid);
     waitForNextEvent();
     callback();
 }
@@ -259,11 +456,7 @@ void MigrationMonitor::localLocationUpdated(const UUID& uuid, bool agg, const Ti
 void MigrationMonitor::handleLocalLocationUpdated(const UUID& uuid, const TimedMotionVector3f& newval) {
     assert( mObjectInfo.get<objid>().find(uuid) != mObjectInfo.get<objid>().end());
 
-    ObjectInfoByID& by_id = mObjectInfo.get<objid>();
-    by_id.modify(
-        by_id.find(uuid),
-        std::tr1::bind(&MigrationMonitor::changeNextEventTime, std::tr1::placeholders::_1, computeNextEventTime(uuid, newval))
-    );
+    updateNextEventTime(uuid, newval);
 
     waitForNextEvent();
 }
@@ -280,21 +473,13 @@ void MigrationMonitor::updatedSegmentation(CoordinateSegmentation* cseg, const s
 void MigrationMonitor::handleUpdatedSegmentation(CoordinateSegmentation* cseg, const std::vector<SegmentationInfo>& new_segmentation) {
     for(std::vector<SegmentationInfo>::const_iterator it = new_segmentation.begin(); it != new_segmentation.end(); it++) {
         if (it->server == mLocService->context()->id()) {
+            BoundingBoxList old_regions = mBoundingRegions;
             mBoundingRegions = it->region;
 
-            // Recalculate *all* object potential update times
-            ObjectInfoByID& by_id = mObjectInfo.get<objid>();
-            for(ObjectInfoByID::iterator obj_it = by_id.begin(); obj_it != by_id.end(); obj_it++) {
-                by_id.modify(
-                    obj_it,
-                    std::tr1::bind(&MigrationMonitor::changeNextEventTime,
-                        std::tr1::placeholders::_1,
-                        computeNextEventTime(obj_it->objid, mLocService->location(obj_it->objid))
-                    )
-                );
-            }
-
-            return;
+            // Recalculate potential update times for objects near the parts
+            // of our region that changed
+            reevaluateChangedRegions(old_regions);
+            break;
         }
     }
 
@@ -94,6 +94,9 @@ private:
     bool inRegion(const Vector3f& pos) const;
 
     Time computeNextEventTime(const UUID& obj, const TimedMotionVector3f& newloc);
+    // Recompute and store the next event time for an object, updating its
+    // entry in the grid
+    void updateNextEventTime(const UUID& obj, const TimedMotionVector3f& newloc);
 
     SpaceContext* mContext;
     LocationService* mLocService;
@@ -129,6 +132,62 @@ private:
 
     ObjectInfoSet mObjectInfo;
 
+    // Uniform grid over the path each object can take before its next event,
+    // i.e. from the time the event was computed until the event time. The
+    // event for an object can only be affected by a segmentation change if
+    // its path overlaps the part of the world where our region changed, so
+    // this lets us skip all the objects away from the changed boundaries.
+    struct GridCell {
+        GridCell()
+         : x(0), y(0), z(0)
+        {}
+        GridCell(int32 _x, int32 _y, int32 _z)
+         : x(_x), y(_y), z(_z)
+        {}
+
+        bool operator==(const GridCell& rhs) const {
+            return (x == rhs.x && y == rhs.y && z == rhs.z);
+        }
+
+        struct Hasher {
+            size_t operator()(const GridCell& c) const {
+                return (size_t)((uint32)c.x * 73856093u ^ (uint32)c.y * 19349663u ^ (uint32)c.z * 83492791u);
+            }
+        };
+
+        int32 x, y, z;
+    };
+    // The range of cells (inclusive) an object's path covers
+    struct GridEntry {
+        GridCell min;
+        GridCell max;
+        // Stationary objects only occupy one cell, and the result for them
+        // is the same for every object in a cell that is entirely inside or
+        // outside our region, so they can be updated in bulk
+        bool stationary;
+    };
+    typedef std::tr1::unordered_set<UUID, UUID::Hasher> ObjectIDSet;
+    typedef std::tr1::unordered_map<GridCell, ObjectIDSet, GridCell::Hasher> Grid;
+    typedef std::tr1::unordered_map<UUID, GridEntry, UUID::Hasher> GridEntryMap;
+
+    GridCell gridCell(const Vector3f& pos) const;
+    BoundingBox3f gridCellBounds(const GridCell& cell) const;
+    // Add or update the grid entry for an object which will follow loc until
+    // next_event, or remove it from the grid
+    void indexObject(const UUID& obj, const TimedMotionVector3f& loc, const Time& next_event);
+    void unindexObject(const UUID& obj);
+    // Recompute next events for objects which might be affected by the
+    // change from old_regions to mBoundingRegions
+    void reevaluateChangedRegions(const BoundingBoxList& old_regions);
+
+    Vector3f mGridOrigin;
+    float32 mGridCellSize;
+    Grid mGrid;
+    GridEntryMap mGridEntries;
+    // Objects whose paths cover too many cells to be worth indexing. These
+    // are always reevaluated when the segmentation changes.
+    ObjectIDSet mUnindexedObjects;
+
     Network::IOStrand* mStrand;
     Network::IOTimerPtr mTimer;
 
@@ -42,7 +42,7 @@ void InitSpaceOptions() {
         .addOption(new OptionValue(OPT_CONFIG_FILE,"space.cfg",Sirikata::OptionValueType<String>(),"Configuration file to load."))
 
         .addOption(new OptionValue(OPT_SPACE_PLUGINS,
-                "weight-exp,weight-sqr,weight-const,space-null,space-local,space-standard,space-prox,colladamodels,mesh-billboard,mesh-ply,common-filters,space-bulletphysics,space-environment,nvtt"
+                "weight-exp,weight-sqr,weight-const,space-null,space-local,space-standard,space-prox,colladamodels,mesh-billboard,mesh-ply,mesh-binary,common-filters,space-bulletphysics,space-environment,nvtt"
 #if SIRIKATA_PLATFORM == SIRIKATA_PLATFORM_LINUX
                 ",space-redis"
 #endif
@@ -65,6 +65,9 @@ void InitSpaceOptions() {
         .addOption(new OptionValue(FORWARDER_SEND_QUEUE_SIZE, "65536", Sirikata::OptionValueType<uint32>(), "The type of ODPFlowScheduler to use for routing."))
 
         .addOption(new OptionValue(NETWORK_TYPE, "tcp", Sirikata::OptionValueType<String>(), "The networking subsystem to use."))
+        .addOption(new OptionValue(SERVER_BULK_MIGRATION, "false", Sirikata::OptionValueType<bool>(), "If true, migrations to the same server are grouped into bulk migration messages and acknowledgements."))
+        .addOption(new OptionValue(SERVER_BULK_MIGRATION_MAX_BATCH, "64", Sirikata::OptionValueType<uint32>(), "Maximum number of objects in a single bulk migration message."))
+        .addOption(new OptionValue(SERVER_ROUTE_WORKERS, "0", Sirikata::OptionValueType<uint32>(), "Number of worker threads which route messages from object hosts. If 0, messages are routed by the network thread that received them."))
 
         .addOption(new OptionValue(OSEG,"local",Sirikata::OptionValueType<String>(),"Specifies which type of oseg to use."))
         .addOption(new OptionValue(OSEG_OPTIONS,"",Sirikata::OptionValueType<String>(),"Specifies arguments to OSeg."))
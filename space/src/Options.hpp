@@ -42,6 +42,9 @@
 #define SERVER_QUEUE_LENGTH  "server.queue.length"
 #define SERVER_RECEIVER      "server.receiver"
 #define SERVER_ODP_FLOW_SCHEDULER   "server.odp.flowsched"
+#define SERVER_BULK_MIGRATION       "server.migration.bulk"
+#define SERVER_BULK_MIGRATION_MAX_BATCH  "server.migration.bulk.max-batch"
+#define SERVER_ROUTE_WORKERS        "server.route.workers"
 
 #define NETWORK_TYPE         "net"
 
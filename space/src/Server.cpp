@@ -32,6 +32,7 @@
 
 #include <sirikata/space/SpaceNetwork.hpp>
 #include "Server.hpp"
+#include "Options.hpp"
 #include <sirikata/space/Proximity.hpp>
 #include <sirikata/space/CoordinateSegmentation.hpp>
 #include <sirikata/space/ServerMessage.hpp>
@@ -94,6 +95,12 @@ Server::Server(SpaceContext* ctx, Authenticator* auth, Forwarder* forwarder, Loc
    mMigrationSendRunning(false),
    mShutdownRequested(false),
    mObjectHostConnectionManager(NULL),
+   mBulkMigration(GetOptionValue<bool>(SERVER_BULK_MIGRATION)),
+   mBulkMigrationMaxBatch(std::max((uint32)1, GetOptionValue<uint32>(SERVER_BULK_MIGRATION_MAX_BATCH))),
+   mBulkMigrationFlushScheduled(false),
+   mBulkSessionFlushScheduled(false),
+   mRouteWorkers(NULL),
+   mRouteWorkersStopped(false),
    mRouteObjectMessage(Sirikata::SizedResourceMonitor(GetOptionValue<size_t>("route-object-message-buffer"))),
    mTimeSeriesObjects(String("space.server") + boost::lexical_cast<String>(ctx->id()) + ".objects")
 {
@@ -106,9 +113,11 @@ Server::Server(SpaceContext* ctx, Authenticator* auth, Forwarder* forwarder, Loc
     mMigrateServerMessageService = mForwarder->createServerMessageService("migrate");
 
     mForwarder->registerMessageRecipient(SERVER_PORT_MIGRATION, this);
+    mForwarder->registerMessageRecipient(SERVER_PORT_BULK_MIGRATION, this);
     mForwarder->setODPService(this);
 
       mOSeg->setWriteListener((OSegWriteListener*)this);
+      mOSeg->setBulkMigrationAcks(mBulkMigration);
 
       mMigrationMonitor = new MigrationMonitor(
           mContext, mLocationService, mCSeg,
@@ -134,6 +143,15 @@ Server::Server(SpaceContext* ctx, Authenticator* auth, Forwarder* forwarder, Loc
     mLocalForwarder = new LocalForwarder(mContext);
     mForwarder->setLocalForwarder(mLocalForwarder);
 
+    uint32 route_workers = GetOptionValue<uint32>(SERVER_ROUTE_WORKERS);
+    if (route_workers > 0) {
+        mRouteWorkers = new Network::IOServicePool("Server Routing", route_workers);
+        for(uint32 i = 0; i < route_workers; i++)
+            mRouteStrands.push_back( mRouteWorkers->service()->createStrand("Server Routing " + boost::lexical_cast<String>(i)) );
+        mRouteWorkers->startWork();
+        mRouteWorkers->run();
+    }
+
     mMigrationTimer.start();
 
 
@@ -180,6 +198,15 @@ Server::~Server()
     delete mMigrateServerMessageService;
 
     mForwarder->unregisterMessageRecipient(SERVER_PORT_MIGRATION, this);
+    mForwarder->unregisterMessageRecipient(SERVER_PORT_BULK_MIGRATION, this);
+
+    for(BulkMigrationMap::iterator it = mPendingBulkMigrations.begin(); it != mPendingBulkMigrations.end(); it++)
+        delete it->second;
+    mPendingBulkMigrations.clear();
+
+    for(PendingBulkSessionMap::iterator it = mPendingBulkSessions.begin(); it != mPendingBulkSessions.end(); it++)
+        delete it->second.msg;
+    mPendingBulkSessions.clear();
 
     SPACE_LOG(debug, "mObjects.size=" << mObjects.size());
 
@@ -200,6 +227,21 @@ Server::~Server()
     mObjects.clear();
 
     delete mObjectHostConnectionManager;
+
+    // Messages can still be handed to the routing workers after stop() joined
+    // them, until the connection manager is gone. Nothing will run those
+    // handlers, so run them here, where they just free the messages.
+    if (mRouteWorkers != NULL) {
+        mRouteWorkers->join();
+        mRouteWorkersStopped = true;
+        mRouteWorkers->reset();
+        mRouteWorkers->service()->poll();
+    }
+    for(uint32 i = 0; i < mRouteStrands.size(); i++)
+        delete mRouteStrands[i];
+    mRouteStrands.clear();
+    delete mRouteWorkers;
+
     delete mLocalForwarder;
 
     delete mMigrationMonitor;
@@ -372,19 +414,78 @@ bool Server::onObjectHostMessageReceived(const ObjectHostConnectionID& conn_id,
         );
         return true;
     }
+    // Batched session messages are handled the same way, but are addressed to
+    // the space server from the object host itself rather than an object.
+    if (obj_msg->dest_port() == OBJECT_PORT_BULK_SESSION &&
+        obj_msg->source_object() == spaceID &&
+        obj_msg->dest_object() == spaceID)
+    {
+        mContext->mainStrand->post(
+            std::tr1::bind(
+                &Server::handleBulkSessionMessage, this,
+                conn_id, short_conn_id, obj_msg
+            ),
+            "Server::handleBulkSessionMessage"
+        );
+        return true;
+    }
+    // As are coalesced location update requests
+    if (obj_msg->dest_port() == OBJECT_PORT_BULK_LOCATION &&
+        obj_msg->source_object() == spaceID &&
+        obj_msg->dest_object() == spaceID)
+    {
+        mContext->mainStrand->post(
+            std::tr1::bind(
+                &Server::handleBulkLocationMessage, this,
+                conn_id, obj_msg
+            ),
+            "Server::handleBulkLocationMessage"
+        );
+        return true;
+    }
+
+    // Everything else goes through the routing stage. With routing workers,
+    // messages are partitioned by source object so each object's messages
+    // still get routed in order. Otherwise we just do it here in the network
+    // strand.
+    if (mRouteWorkers != NULL) {
+        uint32 idx = UUID::Hasher()(obj_msg->source_object()) % mRouteStrands.size();
+        mRouteStrands[idx]->post(
+            std::tr1::bind(&Server::routeObjectHostMessage, this, conn_id, obj_msg),
+            "Server::routeObjectHostMessage"
+        );
+        return true;
+    }
+
+    routeObjectHostMessage(conn_id, obj_msg);
+
+    // NOTE: We always "accept" the data, even if we're just dropping
+    // it.  This keeps packets flowing.  We could use flow control to
+    // slow things down, but since the data path splits in this method
+    // between local and remote, we don't want to slow the local
+    // packets just because of a backup in routing.
+    return true;
+}
+
+void Server::routeObjectHostMessage(const ObjectHostConnectionID& conn_id, Sirikata::Protocol::Object::ObjectMessage* obj_msg) {
+    // Left over after shutting down, see ~Server
+    if (mRouteWorkersStopped) {
+        delete obj_msg;
+        return;
+    }
 
     // 3. Try to shortcut the main thread. Let the LocalForwarder try
     // to ship it over a connection.  This checks both the source
     // and dest objects, guaranteeing that the appropriate connections
     // exist for both.
     if (mLocalForwarder->tryForward(obj_msg))
-        return true;
+        return;
 
     // 4. Try to shortcut them main thread. Use forwarder to try to forward
     // using the cache. FIXME when we do this, we skip over some checks that
     // happen during the full forwarding
     if (mForwarder->tryCacheForward(obj_msg))
-        return true;
+        return;
 
     // 5. Otherwise, we're going to have to ship this to the main thread, either
     // for handling session messages, messages to the space, or to make a
@@ -404,13 +505,6 @@ bool Server::onObjectHostMessageReceived(const ObjectHostConnectionID& conn_id,
         if (hit_empty)
             scheduleObjectHostMessageRouting();
     }
-
-    // NOTE: We always "accept" the data, even if we're just dropping
-    // it.  This keeps packets flowing.  We could use flow control to
-    // slow things down, but since the data path splits in this method
-    // between local and remote, we don't want to slow the local
-    // packets just because of a backup in routing.
-    return true;
 }
 
 void Server::onObjectHostConnected(const ObjectHostConnectionID& conn_id, const ShortObjectHostConnectionID short_conn_id, OHDPSST::Stream::Ptr stream) {
@@ -420,7 +514,7 @@ void Server::onObjectHostConnected(const ObjectHostConnectionID& conn_id, const
 
 void Server::onObjectHostDisconnected(const ObjectHostConnectionID& oh_conn_id, const ShortObjectHostConnectionID short_conn_id) {
     mContext->mainStrand->post(
-        std::tr1::bind(&Server::handleObjectHostConnectionClosed, this, oh_conn_id),
+        std::tr1::bind(&Server::handleObjectHostConnectionClosed, this, oh_conn_id, short_conn_id),
         "Server::handleObjectHostConnectionClosed"
     );
     mOHSessionManager->fireObjectHostSessionEnded( OHDP::NodeID(short_conn_id) );
@@ -572,7 +666,72 @@ void Server::handleSessionMessage(const ObjectHostConnectionID& oh_conn_id, Siri
     delete msg;
 }
 
-void Server::handleObjectHostConnectionClosed(const ObjectHostConnectionID& oh_conn_id) {
+void Server::handleBulkSessionMessage(const ObjectHostConnectionID& oh_conn_id, const ShortObjectHostConnectionID short_conn_id, Sirikata::Protocol::Object::ObjectMessage* msg) {
+    Sirikata::Protocol::BulkSession::BulkSessionMessage bulk_msg;
+    bool parse_success = bulk_msg.ParseFromString(msg->payload());
+    if (!parse_success) {
+        LOG_INVALID_MESSAGE(space, error, msg->payload());
+        delete msg;
+        return;
+    }
+    delete msg;
+
+    // The object host can decode batched responses, so send them that way
+    if (mObjectHostConnectionManager->validConnection(short_conn_id))
+        mBulkSessionConnections.insert(short_conn_id);
+
+    // Unpack into individual session messages so they go through exactly the
+    // same checks, authentication and OSeg updates as unbatched requests. All
+    // the responses they generate are collected by sendConnectResponse.
+    for(int32 i = 0; i < bulk_msg.entries_size(); i++) {
+        Sirikata::Protocol::BulkSession::SessionEntry entry = bulk_msg.entries(i);
+        handleSessionMessage(
+            oh_conn_id,
+            createObjectMessage(
+                mContext->id(),
+                entry.object(), OBJECT_PORT_SESSION,
+                UUID::null(), OBJECT_PORT_SESSION,
+                entry.container()
+            )
+        );
+    }
+}
+
+void Server::handleBulkLocationMessage(const ObjectHostConnectionID& oh_conn_id, Sirikata::Protocol::Object::ObjectMessage* msg) {
+    Sirikata::Protocol::BulkLocation::BulkLocationMessage bulk_msg;
+    bool parse_success = bulk_msg.ParseFromString(msg->payload());
+    if (!parse_success) {
+        LOG_INVALID_MESSAGE(space, error, msg->payload());
+        delete msg;
+        return;
+    }
+    delete msg;
+
+    for(int32 i = 0; i < bulk_msg.entries_size(); i++) {
+        Sirikata::Protocol::BulkLocation::LocationEntry entry = bulk_msg.entries(i);
+        UUID obj_id = entry.object();
+
+        // Object hosts can only update objects connected through them. Anything
+        // else is most likely a request that raced with a migration or
+        // disconnect, so just drop it.
+        ObjectConnectionMap::iterator obj_it = mObjects.find(obj_id);
+        if (obj_it == mObjects.end() || obj_it->second->connID() != oh_conn_id ||
+            isObjectDisconnecting(obj_id))
+            continue;
+
+        String container = entry.container();
+        mLocationService->locationUpdate(obj_id, (void*)container.data(), container.size());
+    }
+}
+
+void Server::handleObjectHostConnectionClosed(const ObjectHostConnectionID& oh_conn_id, const ShortObjectHostConnectionID short_conn_id) {
+    mBulkSessionConnections.erase(short_conn_id);
+    PendingBulkSessionMap::iterator bulk_it = mPendingBulkSessions.find(short_conn_id);
+    if (bulk_it != mPendingBulkSessions.end()) {
+        delete bulk_it->second.msg;
+        mPendingBulkSessions.erase(bulk_it);
+    }
+
     for(ObjectConnectionMap::iterator it = mObjects.begin(); it != mObjects.end(); ) {
         UUID obj_id = it->first;
         ObjectConnection* obj_conn = it->second;
@@ -596,14 +755,7 @@ void Server::sendConnectError(const ObjectHostConnectionID& oh_conn_id, const UU
     fillVersionInfo(response.mutable_version(), mContext);
     response.set_response( Sirikata::Protocol::Session::ConnectResponse::Error );
 
-    Sirikata::Protocol::Object::ObjectMessage* obj_response = createObjectMessage(
-        mContext->id(),
-        UUID::null(), OBJECT_PORT_SESSION,
-        obj_id, OBJECT_PORT_SESSION,
-        serializePBJMessage(response_container)
-    );
-
-    sendSessionMessageWithRetry(oh_conn_id, obj_response, Duration::seconds(0.05));
+    sendConnectResponse(oh_conn_id, obj_id, response_container);
 }
 
 // Handle Connect message from object
@@ -645,14 +797,7 @@ void Server::handleConnect(const ObjectHostConnectionID& oh_conn_id, const Sirik
         response.set_response( Sirikata::Protocol::Session::ConnectResponse::Redirect );
         response.set_redirect(loc_server);
 
-        Sirikata::Protocol::Object::ObjectMessage* obj_response = createObjectMessage(
-            mContext->id(),
-            UUID::null(), OBJECT_PORT_SESSION,
-            obj_id, OBJECT_PORT_SESSION,
-            serializePBJMessage(response_container)
-        );
-
-        sendSessionMessageWithRetry(oh_conn_id, obj_response, Duration::seconds(0.05));
+        sendConnectResponse(oh_conn_id, obj_id, response_container);
         return;
     }
 
@@ -830,16 +975,95 @@ void Server::sendConnectSuccess(const ObjectHostConnectionID& oh_conn_id, const
     response.set_bounds(bnds.fullBounds());
     response.set_mesh(obj_mesh);
 
+    // Sent directly via object host connection manager because ObjectConnection isn't enabled yet
+    sendConnectResponse(oh_conn_id, obj_id, response_container);
+}
+
+void Server::sendConnectResponse(const ObjectHostConnectionID& oh_conn_id, const UUID& obj_id, const Sirikata::Protocol::Session::Container& response_container) {
+    // If the connection was lost, fall through to the normal path, which
+    // cleans up after the object
+    if (mObjectHostConnectionManager->validConnection(oh_conn_id)) {
+        ShortObjectHostConnectionID short_conn_id = oh_conn_id.shortID();
+        if (mBulkSessionConnections.find(short_conn_id) != mBulkSessionConnections.end()) {
+            PendingBulkSessionMap::iterator it = mPendingBulkSessions.find(short_conn_id);
+            if (it == mPendingBulkSessions.end()) {
+                PendingBulkSession pending;
+                pending.conn_id = oh_conn_id;
+                pending.msg = new Sirikata::Protocol::BulkSession::BulkSessionMessage();
+                it = mPendingBulkSessions.insert(PendingBulkSessionMap::value_type(short_conn_id, pending)).first;
+            }
+            Sirikata::Protocol::BulkSession::ISessionEntry entry = it->second.msg->add_entries();
+            entry.set_object(obj_id);
+            entry.set_container(serializePBJMessage(response_container));
+
+            if ((uint32)it->second.msg->entries_size() >= MAX_BULK_SESSION_ENTRIES) {
+                flushBulkSessionResponses(short_conn_id);
+            }
+            else if (!mBulkSessionFlushScheduled) {
+                // Authentication and OSeg results for a batch trickle in as
+                // separate events, so wait until the ones already queued have
+                // been handled before sending
+                mBulkSessionFlushScheduled = true;
+                mContext->mainStrand->post(
+                    std::tr1::bind(&Server::flushAllBulkSessionResponses, this),
+                    "Server::flushAllBulkSessionResponses"
+                );
+            }
+            return;
+        }
+    }
+
     Sirikata::Protocol::Object::ObjectMessage* obj_response = createObjectMessage(
         mContext->id(),
         UUID::null(), OBJECT_PORT_SESSION,
         obj_id, OBJECT_PORT_SESSION,
         serializePBJMessage(response_container)
     );
-    // Sent directly via object host connection manager because ObjectConnection isn't enabled yet
     sendSessionMessageWithRetry(oh_conn_id, obj_response, Duration::seconds(0.05));
 }
 
+void Server::flushBulkSessionResponses(const ShortObjectHostConnectionID short_conn_id) {
+    PendingBulkSessionMap::iterator it = mPendingBulkSessions.find(short_conn_id);
+    if (it == mPendingBulkSessions.end())
+        return;
+
+    Sirikata::Protocol::Object::ObjectMessage* bulk_msg = createObjectMessage(
+        mContext->id(),
+        UUID::null(), OBJECT_PORT_BULK_SESSION,
+        UUID::null(), OBJECT_PORT_BULK_SESSION,
+        serializePBJMessage(*(it->second.msg))
+    );
+    ObjectHostConnectionID conn_id = it->second.conn_id;
+    delete it->second.msg;
+    mPendingBulkSessions.erase(it);
+
+    sendBulkSessionMessageWithRetry(conn_id, bulk_msg, Duration::seconds(0.05));
+}
+
+void Server::flushAllBulkSessionResponses() {
+    mBulkSessionFlushScheduled = false;
+    while(!mPendingBulkSessions.empty())
+        flushBulkSessionResponses(mPendingBulkSessions.begin()->first);
+}
+
+void Server::sendBulkSessionMessageWithRetry(const ObjectHostConnectionID& conn, Sirikata::Protocol::Object::ObjectMessage* msg, const Duration& retry_rate) {
+    bool sent = mObjectHostConnectionManager->send( conn, msg );
+    if (!sent) {
+        // The object host's sessions are cleaned up when the disconnection is
+        // handled, so there's nothing left to do with the responses
+        if (!mObjectHostConnectionManager->validConnection(conn)) {
+            delete msg;
+            return;
+        }
+
+        mContext->mainStrand->post(
+            retry_rate,
+            std::tr1::bind(&Server::sendBulkSessionMessageWithRetry, this, conn, msg, retry_rate),
+            "Server::sendBulkSessionMessageWithRetry"
+        );
+    }
+}
+
 // Handle Migrate message from object
 //this is called by the receiving server.
 void Server::handleMigrate(const ObjectHostConnectionID& oh_conn_id, const Sirikata::Protocol::Object::ObjectMessage& container, const Sirikata::Protocol::Session::Connect& migrate_msg, uint64 seqno)
@@ -959,23 +1183,37 @@ void Server::osegMigrationAcknowledged(const UUID& id) {
 void Server::receiveMessage(Message* msg)
 {
     if (msg->dest_port() == SERVER_PORT_MIGRATION) {
-        Sirikata::Protocol::Migration::MigrationMessage* mig_msg = new Sirikata::Protocol::Migration::MigrationMessage();
-        bool parsed = parsePBJMessage(mig_msg, msg->payload());
-
-        if (!parsed) {
-            delete mig_msg;
+        handleMigrationMessage(msg->payload());
+        delete msg;
+    }
+    else if (msg->dest_port() == SERVER_PORT_BULK_MIGRATION) {
+        Sirikata::Protocol::Migration::BulkMigrationMessage bulk_msg;
+        bool parsed = parsePBJMessage(&bulk_msg, msg->payload());
+        if (parsed) {
+            SPACE_LOG(detailed,"Received bulk migration message for " << bulk_msg.migrations_size() << " objects from server " << bulk_msg.source_server());
+            for(int32 i = 0; i < bulk_msg.migrations_size(); i++)
+                handleMigrationMessage(bulk_msg.migrations(i));
         }
-        else {
-            const UUID obj_id = mig_msg->object();
+        delete msg;
+    }
+}
 
-            SPACE_LOG(detailed,"Received server migration message for " << obj_id.toString() << " from server " << mig_msg->source_server());
+void Server::handleMigrationMessage(const String& payload) {
+    Sirikata::Protocol::Migration::MigrationMessage* mig_msg = new Sirikata::Protocol::Migration::MigrationMessage();
+    bool parsed = parsePBJMessage(mig_msg, payload);
 
-            mObjectMigrations[obj_id] = mig_msg;
-            // Try to handle this migration if all the info is available
-            handleMigration(obj_id);
-        }
-        delete msg;
+    if (!parsed) {
+        delete mig_msg;
+        return;
     }
+
+    const UUID obj_id = mig_msg->object();
+
+    SPACE_LOG(detailed,"Received server migration message for " << obj_id.toString() << " from server " << mig_msg->source_server());
+
+    mObjectMigrations[obj_id] = mig_msg;
+    // Try to handle this migration if all the info is available
+    handleMigration(obj_id);
 }
 
 //handleMigration to this server.
@@ -1087,6 +1325,10 @@ void Server::start() {
 void Server::stop() {
     mForwarder->stop();
     mObjectHostConnectionManager->shutdown();
+    // Let the routing workers finish up with messages they've already
+    // accepted
+    if (mRouteWorkers != NULL)
+        mRouteWorkers->join();
     mShutdownRequested = true;
 }
 
@@ -1164,14 +1406,19 @@ void Server::handleMigrationEvent(const UUID& obj_id) {
 
             // Stop tracking the object locally
             //            mLocationService->removeLocalObject(obj_id);
-            Message* migrate_msg_packet = new Message(
-                mContext->id(),
-                SERVER_PORT_MIGRATION,
-                new_server_id,
-                SERVER_PORT_MIGRATION,
-                serializePBJMessage(migrate_msg)
-            );
-            mMigrateMessages.push(migrate_msg_packet);
+            if (mBulkMigration) {
+                queueBulkMigration(new_server_id, serializePBJMessage(migrate_msg));
+            }
+            else {
+                Message* migrate_msg_packet = new Message(
+                    mContext->id(),
+                    SERVER_PORT_MIGRATION,
+                    new_server_id,
+                    SERVER_PORT_MIGRATION,
+                    serializePBJMessage(migrate_msg)
+                );
+                mMigrateMessages.push(migrate_msg_packet);
+            }
 
             // Stop Forwarder from delivering via this Object's
             // connection, destroy said connection
@@ -1210,6 +1457,61 @@ void Server::handleMigrationEvent(const UUID& obj_id) {
     startSendMigrationMessages();
 }
 
+void Server::queueBulkMigration(ServerID dest_server, const String& migrate_msg) {
+    Sirikata::Protocol::Migration::BulkMigrationMessage*& bulk_msg = mPendingBulkMigrations[dest_server];
+    if (bulk_msg == NULL) {
+        bulk_msg = new Sirikata::Protocol::Migration::BulkMigrationMessage();
+        bulk_msg->set_source_server(mContext->id());
+    }
+    bulk_msg->add_migrations(migrate_msg);
+
+    if ((uint32)bulk_msg->migrations_size() >= mBulkMigrationMaxBatch) {
+        flushBulkMigrations(dest_server);
+        return;
+    }
+
+    // Migration events for a boundary change arrive as a burst of posts to the
+    // main strand. Posting the flush puts it behind the rest of the burst, so
+    // it picks up everything generated by the same change.
+    if (!mBulkMigrationFlushScheduled) {
+        mBulkMigrationFlushScheduled = true;
+        mContext->mainStrand->post(
+            std::tr1::bind(&Server::flushAllBulkMigrations, this),
+            "Server::flushAllBulkMigrations"
+        );
+    }
+}
+
+void Server::flushBulkMigrations(ServerID dest_server) {
+    BulkMigrationMap::iterator it = mPendingBulkMigrations.find(dest_server);
+    if (it == mPendingBulkMigrations.end())
+        return;
+
+    Sirikata::Protocol::Migration::BulkMigrationMessage* bulk_msg = it->second;
+    mPendingBulkMigrations.erase(it);
+
+    SPACE_LOG(detailed,"Sending bulk migration of " << bulk_msg->migrations_size() << " objects from " << mContext->id() << " to " << dest_server);
+
+    Message* migrate_msg_packet = new Message(
+        mContext->id(),
+        SERVER_PORT_BULK_MIGRATION,
+        dest_server,
+        SERVER_PORT_BULK_MIGRATION,
+        serializePBJMessage(*bulk_msg)
+    );
+    delete bulk_msg;
+    mMigrateMessages.push(migrate_msg_packet);
+}
+
+void Server::flushAllBulkMigrations() {
+    mBulkMigrationFlushScheduled = false;
+
+    while(!mPendingBulkMigrations.empty())
+        flushBulkMigrations(mPendingBulkMigrations.begin()->first);
+
+    startSendMigrationMessages();
+}
+
 void Server::startSendMigrationMessages() {
     if (mMigrationSendRunning)
         return;
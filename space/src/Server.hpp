@@ -40,12 +40,15 @@
 #include <sirikata/space/ObjectHostConnectionManager.hpp>
 #include <sirikata/core/service/Service.hpp>
 #include <sirikata/core/queue/SizedThreadSafeQueue.hpp>
+#include <sirikata/core/network/IOServicePool.hpp>
 
 #include <sirikata/core/util/MotionVector.hpp>
 #include <sirikata/core/util/AggregateBoundingInfo.hpp>
 
 #include "Protocol_Session.pbj.hpp"
 #include "Protocol_Migration.pbj.hpp"
+#include "Protocol_BulkSession.pbj.hpp"
+#include "Protocol_BulkLocation.pbj.hpp"
 
 #include <sirikata/space/ObjectSegmentation.hpp>
 
@@ -119,6 +122,10 @@ private:
     // network strand to allow for fast forwarding, see
     // handleObjectHostMessageRouting for continuation in main strand
     virtual bool onObjectHostMessageReceived(const ObjectHostConnectionID& conn_id, const ShortObjectHostConnectionID short_conn_id, Sirikata::Protocol::Object::ObjectMessage*);
+    // Routing stage for non-session messages from object hosts: tries the
+    // LocalForwarder and OSeg cache, handing only misses to the main
+    // strand. Runs in the network strand or on a routing worker.
+    void routeObjectHostMessage(const ObjectHostConnectionID& conn_id, Sirikata::Protocol::Object::ObjectMessage* obj_msg);
     // Disconnection events, forwarded to
     // handleObjectHostConnectionClosed in main strand
     virtual void onObjectHostDisconnected(const ObjectHostConnectionID& conn_id, const ShortObjectHostConnectionID short_conn_id);
@@ -133,6 +140,14 @@ private:
     // Try to send outstanding migration messages.  This chains automatically until the queue is emptied.
     void trySendMigrationMessages();
 
+    // Bulk migration: queue a serialized MigrationMessage for the given server,
+    // flushing it with others headed to the same server
+    void queueBulkMigration(ServerID dest_server, const String& migrate_msg);
+    // Convert the pending bulk migrations for one server or all servers into
+    // messages on mMigrateMessages
+    void flushBulkMigrations(ServerID dest_server);
+    void flushAllBulkMigrations();
+
 
     // Send a session message directly to the object via the OH connection manager, bypassing any restrictions on
     // the current state of the connection.  Keeps retrying until the message gets through.
@@ -146,7 +161,7 @@ private:
 
 
     // Handle an object host closing its connection
-    void handleObjectHostConnectionClosed(const ObjectHostConnectionID& conn_id);
+    void handleObjectHostConnectionClosed(const ObjectHostConnectionID& conn_id, const ShortObjectHostConnectionID short_conn_id);
     // Schedule main thread to handle oh message routing
     void scheduleObjectHostMessageRouting();
     void handleObjectHostMessageRouting();
@@ -157,12 +172,30 @@ private:
 
     // Handle Session messages from an object
     void handleSessionMessage(const ObjectHostConnectionID& oh_conn_id, Sirikata::Protocol::Object::ObjectMessage* msg);
+    // Handle a batch of session messages from an object host. Each entry is
+    // handled as if it were an individual session message and the object host
+    // is marked as accepting batched session responses.
+    void handleBulkSessionMessage(const ObjectHostConnectionID& oh_conn_id, const ShortObjectHostConnectionID short_conn_id, Sirikata::Protocol::Object::ObjectMessage* msg);
+    // Handle a batch of location update requests from an object host. Each
+    // entry is passed to the LocationService as if it had arrived on the
+    // object's own location stream.
+    void handleBulkLocationMessage(const ObjectHostConnectionID& oh_conn_id, Sirikata::Protocol::Object::ObjectMessage* msg);
     // Handle Connect message from object
     void handleConnect(const ObjectHostConnectionID& oh_conn_id, const Sirikata::Protocol::Object::ObjectMessage& container, const Sirikata::Protocol::Session::Connect& connect_msg, uint64 seqno);
     void handleConnectAuthResponse(const ObjectHostConnectionID& oh_conn_id, const UUID& obj_id, const Sirikata::Protocol::Session::Connect& connect_msg, uint64 seqno, bool authenticated);
 
     void sendConnectSuccess(const ObjectHostConnectionID& oh_conn_id, const UUID& obj_id, uint64 session_request_seqno);
     void sendConnectError(const ObjectHostConnectionID& oh_conn_id, const UUID& obj_id, uint64 session_request_seqno);
+    // Send a connection response to an object. For object hosts using bulk
+    // sessions this is batched with other responses to the same object host.
+    void sendConnectResponse(const ObjectHostConnectionID& oh_conn_id, const UUID& obj_id, const Sirikata::Protocol::Session::Container& response_container);
+    // Convert pending batched responses for one or all object hosts into bulk
+    // session messages
+    void flushBulkSessionResponses(const ShortObjectHostConnectionID short_conn_id);
+    void flushAllBulkSessionResponses();
+    // Like sendSessionMessageWithRetry, but for messages addressed to the
+    // object host itself, which are just dropped if it disconnects
+    void sendBulkSessionMessageWithRetry(const ObjectHostConnectionID& conn, Sirikata::Protocol::Object::ObjectMessage* msg, const Duration& retry_rate);
 
     // Handle connection ack message from object
     void handleConnectAck(const ObjectHostConnectionID& oh_conn_id, const Sirikata::Protocol::Object::ObjectMessage& container, uint64 session_request_seqno);
@@ -172,6 +205,9 @@ private:
 
     // Performs actual migration after all the necessary information is available.
     void handleMigration(const UUID& obj_id);
+    // Parses and stores a serialized MigrationMessage from another server,
+    // then tries to complete the migration
+    void handleMigrationMessage(const String& payload);
 
     // Handle a disconnection.
     void handleDisconnect(UUID obj_id, ObjectConnection* conn, uint64 session_request_seqno);
@@ -256,6 +292,29 @@ private:
       // Outstanding MigrateMessages, which get objects to other servers.
       MigrateMessageQueue mMigrateMessages;
 
+    // Bulk migration state. Migrations are collected per destination server
+    // and flushed either when a batch fills up or after all currently queued
+    // migration events have been handled.
+    bool mBulkMigration;
+    uint32 mBulkMigrationMaxBatch;
+    typedef std::tr1::unordered_map<ServerID, Sirikata::Protocol::Migration::BulkMigrationMessage*> BulkMigrationMap;
+    BulkMigrationMap mPendingBulkMigrations;
+    bool mBulkMigrationFlushScheduled;
+
+    // Bulk session state. Object hosts which batch their session requests get
+    // their connection responses batched as well. Responses are collected per
+    // object host and flushed either when a batch fills up or after the
+    // current burst of authentication and OSeg results has been handled.
+    typedef std::tr1::unordered_set<ShortObjectHostConnectionID> BulkSessionConnectionSet;
+    BulkSessionConnectionSet mBulkSessionConnections;
+    struct PendingBulkSession {
+        ObjectHostConnectionID conn_id;
+        Sirikata::Protocol::BulkSession::BulkSessionMessage* msg;
+    };
+    typedef std::tr1::unordered_map<ShortObjectHostConnectionID, PendingBulkSession> PendingBulkSessionMap;
+    PendingBulkSessionMap mPendingBulkSessions;
+    bool mBulkSessionFlushScheduled;
+
     //    ObjectConnectionMap mMigratingConnections;//bftm add
     typedef std::map<UUID,MigratingObjectConnectionsData> MigConnectionsMap;
     MigConnectionsMap mMigratingConnections;//bftm add
@@ -285,6 +344,15 @@ private:
         }
     };
 
+    // Optional pool of workers for routeObjectHostMessage so forwarding
+    // doesn't all happen on the network strand. Each strand handles a fixed
+    // subset of source objects.
+    Network::IOServicePool* mRouteWorkers;
+    std::vector<Network::IOStrand*> mRouteStrands;
+    // Set once the workers have been joined for good. Anything still queued
+    // for them after that is only freed, not routed.
+    bool mRouteWorkersStopped;
+
     // FIXME Another place where needing a size queue and notifications causes
     // double locking...
     boost::mutex mRouteObjectMessageMutex;
@@ -119,4 +119,41 @@ public:
             fprintf(stderr, "Mem buffer was %ld bytes\n", mem_buffer->buffer().size());
         }
     }
+    void testBufferedRoundTrip() {
+        using namespace Sirikata;
+        Sirikata::JpegAllocator<uint8_t> alloc;
+        MemReadWriter unbuffered(alloc);
+        MemReadWriter buffered(alloc);
+        std::vector<uint8_t> bitbuffer(65536);
+        uint32_t seed = 1;
+        for (size_t i = 0; i < bitbuffer.size(); ++i) {
+            seed = seed * 1103515245 + 12345;
+            // skewed enough that 0xFF bytes and carries show up in the output
+            bitbuffer[i] = ((seed >> 16) % 7) == 0;
+        }
+        unsigned char states[64] = {0};
+        ArithmeticWriter coding(&unbuffered);
+        for (size_t i = 0; i < bitbuffer.size(); ++i) {
+            coding.WriteBit(&states[i % 64], bitbuffer[i]);
+        }
+        coding.Finish();
+
+        unsigned char buffered_states[64] = {0};
+        // deliberately small buffer so flushes land mid-stream
+        BufferedArithmeticWriter<37> buffered_coding(&buffered);
+        for (size_t i = 0; i < bitbuffer.size(); ++i) {
+            buffered_coding.WriteBit(&buffered_states[i % 64], bitbuffer[i]);
+        }
+        buffered_coding.Finish();
+        TS_ASSERT(buffered_coding.error() == JpegError::nil());
+        TS_ASSERT_EQUALS(unbuffered.buffer(), buffered.buffer());
+
+        unsigned char read_states[64] = {0};
+        std::vector<uint8_t> readbuffer(bitbuffer.size());
+        BufferedArithmeticReader<37> decoding(&buffered);
+        for (size_t i = 0; i < bitbuffer.size(); ++i) {
+            readbuffer[i] = decoding.ReadBit(&read_states[i % 64]);
+        }
+        TS_ASSERT_EQUALS(bitbuffer, readbuffer);
+    }
 };
@@ -0,0 +1,216 @@
+// Copyright (c) 2015 Sirikata Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can
+// be found in the LICENSE file.
+
+#include <cxxtest/TestSuite.h>
+#include <sirikata/core/util/IndexedHeap.hpp>
+
+using namespace Sirikata;
+
+class IndexedHeapTest : public CxxTest::TestSuite {
+    // Keys live outside the heap, indexed by handle, like callers keep them
+    struct KeyLess {
+        KeyLess(std::vector<int>* k) : keys(k) {}
+        bool operator()(uint32 a, uint32 b) const {
+            return (*keys)[a] < (*keys)[b];
+        }
+        std::vector<int>* keys;
+    };
+    typedef IndexedHeap<KeyLess> Heap;
+
+    std::vector<int> keys;
+
+    // Pops everything, checking keys come out in non-increasing order, and
+    // returns the number of elements popped
+    uint32 drainInOrder(Heap* heap) {
+        uint32 count = 0;
+        int last = 0;
+        while(!heap->empty()) {
+            uint32 h = heap->pop();
+            TS_ASSERT(!heap->contains(h));
+            if (count > 0)
+                TS_ASSERT(keys[h] <= last);
+            last = keys[h];
+            count++;
+        }
+        return count;
+    }
+
+    // Deterministic pseudo-random sequence so failures are reproducible
+    uint32 mSeed;
+    int nextKey() {
+        mSeed = mSeed * 1103515245 + 12345;
+        return (int)((mSeed >> 16) % 1000);
+    }
+
+public:
+    void setUp() {
+        keys.clear();
+        mSeed = 1;
+    }
+
+    void testPushPop() {
+        int vals[] = { 5, 1, 9, 3, 7, 9, 0 };
+        keys.assign(vals, vals + sizeof(vals)/sizeof(vals[0]));
+        Heap heap((KeyLess(&keys)));
+        TS_ASSERT(heap.empty());
+
+        for(uint32 h = 0; h < keys.size(); h++) {
+            heap.push(h);
+            TS_ASSERT(heap.contains(h));
+        }
+        TS_ASSERT_EQUALS(heap.size(), (uint32)keys.size());
+        TS_ASSERT_EQUALS(keys[heap.top()], 9);
+        TS_ASSERT(!heap.contains((uint32)keys.size()));
+
+        TS_ASSERT_EQUALS(drainInOrder(&heap), (uint32)keys.size());
+    }
+
+    void testUpdate() {
+        for(int i = 0; i < 10; i++)
+            keys.push_back(i * 10);
+        Heap heap((KeyLess(&keys)));
+        for(uint32 h = 0; h < keys.size(); h++)
+            heap.push(h);
+        TS_ASSERT_EQUALS(heap.top(), (uint32)9);
+
+        // Raise a low element past the top
+        keys[2] = 1000;
+        heap.update(2);
+        TS_ASSERT_EQUALS(heap.top(), (uint32)2);
+
+        // Drop the top to the bottom
+        keys[2] = -1;
+        heap.update(2);
+        TS_ASSERT_EQUALS(heap.top(), (uint32)9);
+
+        // Change an element in the middle both ways
+        keys[5] = 95;
+        heap.update(5);
+        TS_ASSERT_EQUALS(heap.top(), (uint32)5);
+        keys[5] = 5;
+        heap.update(5);
+        TS_ASSERT_EQUALS(heap.top(), (uint32)9);
+
+        // Updating something that isn't in the heap is ignored
+        keys.push_back(5000);
+        heap.update(10);
+        TS_ASSERT(!heap.contains(10));
+        TS_ASSERT_EQUALS(heap.top(), (uint32)9);
+
+        TS_ASSERT_EQUALS(drainInOrder(&heap), (uint32)10);
+    }
+
+    void testRemove() {
+        for(int i = 0; i < 10; i++)
+            keys.push_back(i);
+        Heap heap((KeyLess(&keys)));
+        for(uint32 h = 0; h < keys.size(); h++)
+            heap.push(h);
+
+        // Middle, top, and whatever is currently last in the array
+        heap.remove(4);
+        heap.remove(9);
+        heap.remove(0);
+        TS_ASSERT(!heap.contains(4));
+        TS_ASSERT(!heap.contains(9));
+        TS_ASSERT(!heap.contains(0));
+        TS_ASSERT_EQUALS(heap.size(), (uint32)7);
+        TS_ASSERT_EQUALS(heap.top(), (uint32)8);
+
+        // Removing again, or something never added, is a no-op
+        heap.remove(4);
+        heap.remove(100);
+        TS_ASSERT_EQUALS(heap.size(), (uint32)7);
+
+        TS_ASSERT_EQUALS(drainInOrder(&heap), (uint32)7);
+    }
+
+    void testSlotReuse() {
+        for(int i = 0; i < 4; i++)
+            keys.push_back(i);
+        Heap heap((KeyLess(&keys)));
+        for(uint32 h = 0; h < keys.size(); h++)
+            heap.push(h);
+
+        // Free a slot, give it a new key, and reuse the same handle
+        heap.remove(1);
+        keys[1] = 100;
+        heap.push(1);
+        TS_ASSERT(heap.contains(1));
+        TS_ASSERT_EQUALS(heap.top(), (uint32)1);
+        TS_ASSERT_EQUALS(heap.size(), (uint32)4);
+
+        // Popped handles can be pushed again too
+        uint32 h = heap.pop();
+        TS_ASSERT_EQUALS(h, (uint32)1);
+        keys[1] = -5;
+        heap.push(1);
+        TS_ASSERT_EQUALS(heap.top(), (uint32)3);
+
+        // Sparse handles grow the position index
+        keys.resize(50, 0);
+        keys[49] = 50;
+        heap.push(49);
+        TS_ASSERT_EQUALS(heap.top(), (uint32)49);
+
+        // clear() frees every slot
+        heap.clear();
+        TS_ASSERT(heap.empty());
+        for(uint32 i = 0; i < keys.size(); i++)
+            TS_ASSERT(!heap.contains(i));
+        heap.push(49);
+        TS_ASSERT_EQUALS(heap.size(), (uint32)1);
+    }
+
+    void testHeapOrderRandomized() {
+        const uint32 count = 1000;
+        for(uint32 i = 0; i < count; i++)
+            keys.push_back(nextKey());
+        Heap heap((KeyLess(&keys)));
+        for(uint32 h = 0; h < count; h++)
+            heap.push(h);
+
+        // Mix single updates, removals and reinsertions
+        uint32 removed = 0;
+        for(uint32 i = 0; i < count; i++) {
+            uint32 h = (uint32)nextKey() % count;
+            switch(i % 3) {
+              case 0:
+                keys[h] = nextKey();
+                heap.update(h);
+                break;
+              case 1:
+                if (heap.contains(h)) {
+                    heap.remove(h);
+                    removed++;
+                }
+                break;
+              case 2:
+                if (!heap.contains(h)) {
+                    keys[h] = nextKey();
+                    heap.push(h);
+                    removed--;
+                }
+                break;
+            }
+        }
+        TS_ASSERT_EQUALS(heap.size(), count - removed);
+        TS_ASSERT_EQUALS(drainInOrder(&heap), count - removed);
+    }
+
+    void testRebuild() {
+        for(int i = 0; i < 100; i++)
+            keys.push_back(i);
+        Heap heap((KeyLess(&keys)));
+        for(uint32 h = 0; h < keys.size(); h++)
+            heap.push(h);
+
+        // Reverse every key at once, then restore order in one pass
+        for(uint32 h = 0; h < keys.size(); h++)
+            keys[h] = -keys[h];
+        heap.rebuild();
+        TS_ASSERT_EQUALS(heap.top(), (uint32)0);
+        TS_ASSERT_EQUALS(drainInOrder(&heap), (uint32)100);
+    }
+};
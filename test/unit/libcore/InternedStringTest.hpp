@@ -0,0 +1,47 @@
+// Copyright (c) 2015 Sirikata Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can
+// be found in the LICENSE file.
+
+#include <cxxtest/TestSuite.h>
+#include <sirikata/core/util/InternedString.hpp>
+
+using namespace Sirikata;
+
+class InternedStringTest : public CxxTest::TestSuite {
+public:
+    void testEmpty() {
+        InternedStringTable table;
+        InternedString def;
+        InternedString empty = table.intern("");
+        TS_ASSERT(def.empty());
+        TS_ASSERT_EQUALS(def, empty);
+        TS_ASSERT_EQUALS(empty.str(), "");
+        TS_ASSERT_EQUALS(table.size(), (uint32)0);
+    }
+
+    void testSharing() {
+        InternedStringTable table;
+        InternedString a1 = table.intern("meerkat://mesh/a.dae");
+        InternedString a2 = table.intern(String("meerkat://mesh/") + "a.dae");
+        InternedString b = table.intern("meerkat://mesh/b.dae");
+
+        TS_ASSERT_EQUALS(a1, a2);
+        TS_ASSERT_EQUALS(&a1.str(), &a2.str());
+        TS_ASSERT_DIFFERS(a1, b);
+        TS_ASSERT_EQUALS(a1.str(), "meerkat://mesh/a.dae");
+        TS_ASSERT_EQUALS(b.str(), "meerkat://mesh/b.dae");
+        TS_ASSERT_EQUALS(table.size(), (uint32)2);
+    }
+
+    void testRelease() {
+        InternedStringTable table;
+        // Values remain valid as long as handles to them exist, even after the
+        // table is cleaned up, and released values are eventually removed.
+        InternedString keep = table.intern("keep");
+        for(uint32 i = 0; i < 1000; i++)
+            table.intern(String("value") + (char)('a' + (i % 26)) + (char)('a' + (i / 26)));
+        TS_ASSERT_LESS_THAN(table.size(), (uint32)1000);
+        TS_ASSERT_EQUALS(keep.str(), "keep");
+        TS_ASSERT_EQUALS(keep, table.intern("keep"));
+    }
+};
@@ -0,0 +1,135 @@
+// Copyright (c) 2015 Sirikata Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can
+// be found in the LICENSE file.
+
+#include <cxxtest/TestSuite.h>
+
+#include <sirikata/core/trace/LatencyHistogram.hpp>
+
+using namespace Sirikata;
+using Sirikata::Trace::LatencyHistogram;
+using Sirikata::Trace::TaggedLatencyHistograms;
+
+class LatencyHistogramTest : public CxxTest::TestSuite {
+public:
+    void testBucketIndexLinearRange() {
+        // Values below the number of sub-buckets (16) get their own bucket
+        for(uint64 v = 0; v < 32; v++) {
+            TS_ASSERT_EQUALS(LatencyHistogram::bucketIndex(v), (uint32)v);
+            TS_ASSERT_EQUALS(LatencyHistogram::bucketUpperBound((uint32)v), v);
+        }
+    }
+
+    void testBucketIndexLogRange() {
+        // Above that, each power of two is split into 16 buckets, so 32 and
+        // 33 share a bucket, as do 64-67.
+        TS_ASSERT_EQUALS(LatencyHistogram::bucketIndex(32), (uint32)32);
+        TS_ASSERT_EQUALS(LatencyHistogram::bucketIndex(33), (uint32)32);
+        TS_ASSERT_EQUALS(LatencyHistogram::bucketIndex(34), (uint32)33);
+        TS_ASSERT_EQUALS(LatencyHistogram::bucketUpperBound(32), (uint64)33);
+        TS_ASSERT_EQUALS(LatencyHistogram::bucketIndex(64), (uint32)48);
+        TS_ASSERT_EQUALS(LatencyHistogram::bucketIndex(67), (uint32)48);
+        TS_ASSERT_EQUALS(LatencyHistogram::bucketIndex(68), (uint32)49);
+        TS_ASSERT_EQUALS(LatencyHistogram::bucketUpperBound(48), (uint64)67);
+    }
+
+    void testBucketBoundsConsistent() {
+        // Every value falls within its bucket's bounds, buckets are
+        // contiguous and the reported bound is within 1/16 of the value.
+        uint32 last_idx = 0;
+        for(uint64 v = 1; v < 1000000; v = v + 1 + v / 7) {
+            uint32 idx = LatencyHistogram::bucketIndex(v);
+            TS_ASSERT(idx >= last_idx);
+            uint64 upper = LatencyHistogram::bucketUpperBound(idx);
+            TS_ASSERT(upper >= v);
+            TS_ASSERT(upper - v <= v / 16);
+            TS_ASSERT_EQUALS(LatencyHistogram::bucketIndex(upper), idx);
+            TS_ASSERT_EQUALS(LatencyHistogram::bucketIndex(upper + 1), idx + 1);
+            last_idx = idx;
+        }
+    }
+
+    void testBucketIndexClamped() {
+        // Values past 2^36us all end up in the last bucket
+        uint64 max_tracked = (((uint64)1) << 36) - 1;
+        uint32 last = LatencyHistogram::bucketIndex(max_tracked);
+        TS_ASSERT_EQUALS(last, (uint32)527);
+        TS_ASSERT_EQUALS(LatencyHistogram::bucketIndex(max_tracked + 1), last);
+        TS_ASSERT_EQUALS(LatencyHistogram::bucketIndex(~((uint64)0)), last);
+    }
+
+    void testEmpty() {
+        LatencyHistogram hist;
+        TS_ASSERT_EQUALS(hist.count(), (uint64)0);
+        TS_ASSERT_EQUALS(hist.mean(), Duration::zero());
+        TS_ASSERT_EQUALS(hist.maximum(), Duration::zero());
+        TS_ASSERT_EQUALS(hist.percentile(.99), Duration::zero());
+    }
+
+    void testPercentile() {
+        LatencyHistogram hist;
+        for(int64 i = 1; i <= 100; i++)
+            hist.record(Duration::microseconds(i));
+
+        TS_ASSERT_EQUALS(hist.count(), (uint64)100);
+        TS_ASSERT_EQUALS(hist.mean(), Duration::microseconds(50));
+        TS_ASSERT_EQUALS(hist.maximum(), Duration::microseconds(100));
+
+        TS_ASSERT_EQUALS(hist.percentile(0), Duration::microseconds(1));
+        TS_ASSERT_EQUALS(hist.percentile(.1), Duration::microseconds(10));
+        // 50 shares a bucket with 51
+        TS_ASSERT_EQUALS(hist.percentile(.5), Duration::microseconds(51));
+        int64 p99 = hist.percentile(.99).toMicro();
+        TS_ASSERT(p99 >= 99 && p99 <= 100);
+        // Never reports more than the maximum, even though 100's bucket goes
+        // up to 103
+        TS_ASSERT_EQUALS(hist.percentile(1), Duration::microseconds(100));
+        // Out of range fractions are clamped
+        TS_ASSERT_EQUALS(hist.percentile(2), Duration::microseconds(100));
+        TS_ASSERT_EQUALS(hist.percentile(-1), Duration::microseconds(1));
+    }
+
+    void testNegativeRecordedAsZero() {
+        LatencyHistogram hist;
+        hist.record(Duration::microseconds(-5));
+        TS_ASSERT_EQUALS(hist.count(), (uint64)1);
+        TS_ASSERT_EQUALS(hist.percentile(1), Duration::zero());
+    }
+
+    void testReset() {
+        LatencyHistogram hist;
+        for(int64 i = 0; i < 10; i++)
+            hist.record(Duration::milliseconds(i));
+        hist.reset();
+        TS_ASSERT_EQUALS(hist.count(), (uint64)0);
+        TS_ASSERT_EQUALS(hist.maximum(), Duration::zero());
+        TS_ASSERT_EQUALS(hist.percentile(.99), Duration::zero());
+
+        // Only samples after the reset are reported
+        hist.record(Duration::microseconds(3));
+        TS_ASSERT_EQUALS(hist.count(), (uint64)1);
+        TS_ASSERT_EQUALS(hist.percentile(.99), Duration::microseconds(3));
+    }
+
+    void testTagged() {
+        static const char* tag_a = "a";
+        static const char* tag_b = "b";
+
+        TaggedLatencyHistograms hists;
+        hists.record(tag_a, Duration::microseconds(1));
+        hists.record(tag_b, Duration::microseconds(2));
+        hists.record(tag_a, Duration::microseconds(3));
+        hists.record(NULL, Duration::microseconds(4));
+
+        TS_ASSERT_EQUALS(hists.size(), (uint32)3);
+        TS_ASSERT_EQUALS(String(hists.tag(0)), String("a"));
+        TS_ASSERT_EQUALS(hists.histogram(0).count(), (uint64)2);
+        TS_ASSERT_EQUALS(hists.histogram(1).count(), (uint64)1);
+        TS_ASSERT_EQUALS(String(hists.tag(2)), String("(untagged)"));
+
+        hists.reset();
+        TS_ASSERT_EQUALS(hists.size(), (uint32)3);
+        TS_ASSERT_EQUALS(hists.histogram(0).count(), (uint64)0);
+        TS_ASSERT_EQUALS(hists.histogram(2).count(), (uint64)0);
+    }
+};
@@ -0,0 +1,181 @@
+// Copyright (c) 2015 Sirikata Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can
+// be found in the LICENSE file.
+
+#include <cxxtest/TestSuite.h>
+#include <sirikata/core/network/ObjectMessage.hpp>
+
+using namespace Sirikata;
+
+class ObjectMessageTest : public CxxTest::TestSuite {
+    struct TestMessage {
+        UUID src, dest;
+        ObjectMessagePort src_port, dest_port;
+        std::string payload;
+    };
+
+    TestMessage makeMessage(ObjectMessagePort port, const std::string& payload) {
+        TestMessage result;
+        result.src = UUID::random();
+        result.dest = UUID::random();
+        result.src_port = port;
+        result.dest_port = port + 1;
+        result.payload = payload;
+        return result;
+    }
+
+    // Serializes the header the way senders do, with the payload kept separate
+    void serializeHeader(const TestMessage& tm, std::string* header) {
+        ObjectMessage msg;
+        createObjectHostMessage(0, tm.src, tm.src_port, tm.dest, tm.dest_port, "", &msg);
+        header->clear();
+        serializeObjectMessageHeader(msg, tm.payload.size(), header);
+    }
+
+    void checkParsed(const TestMessage& tm, const void* data, size_t size) {
+        ObjectMessage parsed;
+        TS_ASSERT(parsed.ParseFromArray(data, size));
+        TS_ASSERT_EQUALS(parsed.source_object(), tm.src);
+        TS_ASSERT_EQUALS(parsed.dest_object(), tm.dest);
+        TS_ASSERT_EQUALS(parsed.source_port(), tm.src_port);
+        TS_ASSERT_EQUALS(parsed.dest_port(), tm.dest_port);
+        TS_ASSERT_EQUALS(parsed.payload(), tm.payload);
+    }
+
+    void buildBatch(const std::vector<TestMessage>& msgs, std::string* batch, std::vector<size_t>* entry_ends) {
+        std::string header;
+        for(size_t i = 0; i < msgs.size(); i++) {
+            serializeHeader(msgs[i], &header);
+            appendObjectMessageToBatch(header, MemoryReference(msgs[i].payload), batch);
+            if (entry_ends) entry_ends->push_back(batch->size());
+        }
+    }
+
+    std::vector<TestMessage> testMessages() {
+        std::vector<TestMessage> msgs;
+        msgs.push_back(makeMessage(1, "first"));
+        msgs.push_back(makeMessage(2, ""));
+        // Long enough that the entry length takes a multi-byte varint
+        msgs.push_back(makeMessage(3, std::string(1000, 'x')));
+        return msgs;
+    }
+
+public:
+    void testSingleMessage() {
+        TestMessage tm = makeMessage(5, "single message payload");
+        std::string header;
+        serializeHeader(tm, &header);
+        std::string wire = header + tm.payload;
+
+        TS_ASSERT(!isObjectMessageBatch(MemoryReference(wire)));
+        checkParsed(tm, wire.data(), wire.size());
+
+        // Regular serialization must never look like a batch either
+        ObjectMessage msg;
+        createObjectHostMessage(0, tm.src, tm.src_port, tm.dest, tm.dest_port, tm.payload, &msg);
+        std::string full;
+        msg.serialize(&full);
+        TS_ASSERT(!isObjectMessageBatch(MemoryReference(full)));
+    }
+
+    void testBatch() {
+        std::vector<TestMessage> msgs = testMessages();
+        std::string batch;
+        buildBatch(msgs, &batch, NULL);
+
+        MemoryReference remaining(batch);
+        TS_ASSERT(isObjectMessageBatch(remaining));
+        MemoryReference entry = MemoryReference::null();
+        size_t count = 0;
+        while(nextObjectMessageInBatch(&remaining, &entry)) {
+            TS_ASSERT(count < msgs.size());
+            if (count >= msgs.size()) break;
+            checkParsed(msgs[count], entry.data(), entry.size());
+            count++;
+        }
+        TS_ASSERT_EQUALS(count, msgs.size());
+        TS_ASSERT_EQUALS(remaining.size(), (size_t)0);
+    }
+
+    void testEmptyBatch() {
+        std::string empty;
+        MemoryReference remaining(empty);
+        MemoryReference entry = MemoryReference::null();
+        TS_ASSERT(!isObjectMessageBatch(remaining));
+        TS_ASSERT(!nextObjectMessageInBatch(&remaining, &entry));
+    }
+
+    void testTruncatedBatch() {
+        std::vector<TestMessage> msgs = testMessages();
+        std::string batch;
+        std::vector<size_t> entry_ends;
+        buildBatch(msgs, &batch, &entry_ends);
+
+        // Every prefix yields exactly the entries it fully contains and then
+        // stops, never reading past the end of the data
+        for(size_t cut = 0; cut < batch.size(); cut++) {
+            std::string truncated = batch.substr(0, cut);
+            MemoryReference remaining(truncated);
+            MemoryReference entry = MemoryReference::null();
+            size_t count = 0;
+            while(nextObjectMessageInBatch(&remaining, &entry)) {
+                TS_ASSERT((const char*)entry.end() <= truncated.data() + truncated.size());
+                count++;
+            }
+
+            size_t expected = 0;
+            while(expected < entry_ends.size() && entry_ends[expected] <= cut)
+                expected++;
+            TS_ASSERT_EQUALS(count, expected);
+        }
+    }
+
+    void testMalformedBatch() {
+        MemoryReference entry = MemoryReference::null();
+
+        // Wrong key for the entry following a valid one
+        std::vector<TestMessage> msgs = testMessages();
+        std::string batch;
+        buildBatch(msgs, &batch, NULL);
+        std::string bad_key = batch;
+        size_t first_entry_size;
+        {
+            MemoryReference remaining(batch);
+            TS_ASSERT(nextObjectMessageInBatch(&remaining, &entry));
+            first_entry_size = batch.size() - remaining.size();
+        }
+        bad_key[first_entry_size] = (char)0x0A;
+        {
+            MemoryReference remaining(bad_key);
+            TS_ASSERT(nextObjectMessageInBatch(&remaining, &entry));
+            TS_ASSERT(!nextObjectMessageInBatch(&remaining, &entry));
+        }
+
+        // Length varint that never terminates
+        std::string bad_varint(1, batch[0]);
+        bad_varint.append(11, (char)0xFF);
+        {
+            MemoryReference remaining(bad_varint);
+            TS_ASSERT(isObjectMessageBatch(remaining));
+            TS_ASSERT(!nextObjectMessageInBatch(&remaining, &entry));
+        }
+
+        // Length longer than the data, including one that would overflow a
+        // pointer if added naively
+        std::string bad_length(1, batch[0]);
+        bad_length.append(9, (char)0xFF);
+        bad_length.push_back((char)0x01);
+        bad_length.append("abc");
+        {
+            MemoryReference remaining(bad_length);
+            TS_ASSERT(!nextObjectMessageInBatch(&remaining, &entry));
+        }
+        std::string short_data(1, batch[0]);
+        short_data.push_back((char)10);
+        short_data.append("abc");
+        {
+            MemoryReference remaining(short_data);
+            TS_ASSERT(!nextObjectMessageInBatch(&remaining, &entry));
+        }
+    }
+};
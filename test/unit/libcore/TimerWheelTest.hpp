@@ -0,0 +1,138 @@
+// Copyright (c) 2015 Sirikata Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can
+// be found in the LICENSE file.
+
+#include <cxxtest/TestSuite.h>
+
+#include <sirikata/core/network/IOService.hpp>
+#include <sirikata/core/network/TimerWheel.hpp>
+
+using namespace Sirikata;
+
+class TimerWheelTest : public CxxTest::TestSuite {
+    typedef boost::posix_time::ptime PTime;
+
+    Network::IOService* ios;
+    Network::TimerWheel* wheel;
+    PTime start;
+
+    struct Firing {
+        int id;
+        int64 elapsed_us;
+    };
+    std::vector<Firing> fired;
+
+public:
+    void setUp() {
+        ios = new Network::IOService("TimerWheelTest");
+        // A small tick so short timeouts already have to cascade through the
+        // upper levels: level 0 covers 2.56ms, level 1 covers ~655ms.
+        wheel = new Network::TimerWheel(*ios, Duration::microseconds(10));
+        start = boost::posix_time::microsec_clock::universal_time();
+        fired.clear();
+    }
+    void tearDown() {
+        delete wheel; wheel = NULL;
+        delete ios; ios = NULL;
+    }
+
+    void record(int id) {
+        Firing f;
+        f.id = id;
+        f.elapsed_us = (boost::posix_time::microsec_clock::universal_time() - start).total_microseconds();
+        fired.push_back(f);
+    }
+    IOCallback recorder(int id) {
+        return std::tr1::bind(&TimerWheelTest::record, this, id);
+    }
+
+    void testCascade() {
+        // Post out of order, spanning levels 0, 1 and 2
+        int64 waits_us[] = { 30000, 500, 700000, 5000, 100 };
+        int nwaits = sizeof(waits_us) / sizeof(waits_us[0]);
+        for(int i = 0; i < nwaits; i++)
+            wheel->post(Duration::microseconds(waits_us[i]), recorder(i));
+        TS_ASSERT_EQUALS(wheel->size(), (uint32)nwaits);
+
+        // run() returns once the wheel stops holding the service open
+        ios->run();
+
+        TS_ASSERT_EQUALS(wheel->size(), (uint32)0);
+        TS_ASSERT_EQUALS(fired.size(), (std::size_t)nwaits);
+        int expected_order[] = { 4, 1, 3, 0, 2 };
+        for(std::size_t i = 0; i < fired.size(); i++) {
+            TS_ASSERT_EQUALS(fired[i].id, expected_order[i]);
+            // Never early
+            TS_ASSERT(fired[i].elapsed_us >= waits_us[fired[i].id]);
+        }
+    }
+
+    void testCancel() {
+        Network::TimerWheel::Node node;
+        TS_ASSERT_EQUALS(wheel->schedule(&node, Duration::milliseconds(5), recorder(0)), (uint32)0);
+        TS_ASSERT(node.scheduled());
+        wheel->post(Duration::milliseconds(10), recorder(1));
+
+        TS_ASSERT_EQUALS(wheel->cancel(&node), (uint32)1);
+        TS_ASSERT(!node.scheduled());
+        TS_ASSERT_EQUALS(wheel->cancel(&node), (uint32)0);
+        TS_ASSERT_EQUALS(wheel->size(), (uint32)1);
+
+        ios->run();
+
+        TS_ASSERT_EQUALS(fired.size(), (std::size_t)1);
+        if (fired.size() == 1)
+            TS_ASSERT_EQUALS(fired[0].id, 1);
+    }
+
+    void testCancelLast() {
+        // Cancelling the only timer must let the service exit without firing
+        Network::TimerWheel::Node node;
+        wheel->schedule(&node, Duration::milliseconds(500), recorder(0));
+        TS_ASSERT_EQUALS(wheel->cancel(&node), (uint32)1);
+
+        ios->run();
+
+        TS_ASSERT_EQUALS(fired.size(), (std::size_t)0);
+        TS_ASSERT_EQUALS(wheel->size(), (uint32)0);
+    }
+
+    void testReschedule() {
+        Network::TimerWheel::Node node;
+        wheel->schedule(&node, Duration::milliseconds(1), recorder(0));
+        wheel->post(Duration::milliseconds(5), recorder(1));
+        // Push the node past the posted timer and into the next level
+        TS_ASSERT_EQUALS(wheel->schedule(&node, Duration::milliseconds(20), recorder(2)), (uint32)1);
+        TS_ASSERT_EQUALS(wheel->size(), (uint32)2);
+
+        ios->run();
+
+        // The original handler was replaced, not run in addition
+        TS_ASSERT_EQUALS(fired.size(), (std::size_t)2);
+        if (fired.size() == 2) {
+            TS_ASSERT_EQUALS(fired[0].id, 1);
+            TS_ASSERT_EQUALS(fired[1].id, 2);
+            TS_ASSERT(fired[1].elapsed_us >= 20000);
+        }
+        TS_ASSERT(!node.scheduled());
+
+        // Nodes can be reused once they've fired
+        fired.clear();
+        wheel->schedule(&node, Duration::milliseconds(1), recorder(3));
+        ios->reset();
+        ios->run();
+        TS_ASSERT_EQUALS(fired.size(), (std::size_t)1);
+    }
+
+    void testSameTick() {
+        // Timers expiring together are posted individually, but must all run
+        for(int i = 0; i < 10; i++)
+            wheel->post(Duration::milliseconds(2), recorder(i));
+
+        ios->run();
+
+        TS_ASSERT_EQUALS(fired.size(), (std::size_t)10);
+        for(std::size_t i = 0; i < fired.size(); i++)
+            TS_ASSERT(fired[i].elapsed_us >= 2000);
+    }
+};
@@ -32,6 +32,7 @@
 #include <cxxtest/TestSuite.h>
 #include <sirikata/mesh/Meshdata.hpp>
 #include <sirikata/mesh/ModelsSystemFactory.hpp>
+#include <sirikata/mesh/MeshdataBinary.hpp>
 #include <fstream>
 #include <sirikata/core/util/Paths.hpp>
 #include <boost/filesystem.hpp>
@@ -487,6 +488,32 @@ public:
 		TS_ASSERT_EQUALS(mdp, MeshdataPtr());
 	}
 
+	void testColladaLoaderImportThreads( void ) {
+		//geometry converted on worker threads must come out exactly the same
+		//as geometry converted on the loading thread
+		ModelsSystem* serial = ModelsSystemFactory::getSingleton().getConstructor("colladamodels")("--import-threads=1");
+		ModelsSystem* parallel = ModelsSystemFactory::getSingleton().getConstructor("colladamodels")("--import-threads=4");
+		TS_ASSERT(serial != NULL);
+		TS_ASSERT(parallel != NULL);
+
+		const char* docs[] = { "cubes", "circles", "cylinders", "hex2s", "triangles3d", "bunny" };
+		for(uint32 i = 0; serial && parallel && i < sizeof(docs)/sizeof(docs[0]); i++) {
+			String doc = getString(docs[i]);
+			if (doc.empty()) continue;
+			MeshdataPtr serial_mdp = loadMDP(serial, doc);
+			MeshdataPtr parallel_mdp = loadMDP(parallel, doc);
+			TS_ASSERT(serial_mdp);
+			TS_ASSERT(parallel_mdp);
+			if (!serial_mdp || !parallel_mdp) continue;
+			TS_ASSERT_EQUALS(serial_mdp->geometry.size(), parallel_mdp->geometry.size());
+			//the serialized form covers every field of the Meshdata
+			TS_ASSERT(MeshdataBinary::serialize(*serial_mdp) == MeshdataBinary::serialize(*parallel_mdp));
+		}
+
+		delete serial;
+		delete parallel;
+	}
+
 
 	String getString(String name) {
 		String result;
@@ -517,12 +544,16 @@ public:
 	}
 
 	MeshdataPtr loadMDP(String thing) {
+		return loadMDP(msys, thing);
+	}
+
+	MeshdataPtr loadMDP(ModelsSystem* system, String thing) {
 		//loads the MeshdataPtr from the collada string
 		Transfer::DenseData *dd = new Transfer::DenseData(thing);
 		Transfer::DenseDataPtr data(dd);
-		TS_ASSERT_EQUALS(msys->canLoad(data), true);
+		TS_ASSERT_EQUALS(system->canLoad(data), true);
 
-		Mesh::VisualPtr parsed = msys->load(data);
+		Mesh::VisualPtr parsed = system->load(data);
 		TS_ASSERT_DIFFERS(parsed, Mesh::VisualPtr());
 		MeshdataPtr mdp(std::tr1::dynamic_pointer_cast<Meshdata>(parsed));
 		return mdp;
@@ -0,0 +1,341 @@
+// Copyright (c) 2015 Sirikata Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can
+// be found in the LICENSE file.
+
+#include <cxxtest/TestSuite.h>
+#include <sirikata/mesh/Meshdata.hpp>
+#include <sirikata/mesh/MeshdataBinary.hpp>
+
+using namespace Sirikata;
+using namespace Sirikata::Mesh;
+
+class MeshdataBinaryTest : public CxxTest::TestSuite
+{
+    // Fills in every field of Meshdata with distinct, non-default values
+    static MeshdataPtr buildMesh() {
+        MeshdataPtr md(new Meshdata());
+        md->uri = "meerkat:///test/mesh.dae";
+        md->hash = Transfer::Fingerprint::computeDigest("mesh");
+
+        SubMeshGeometry geo;
+        geo.name = "geometry-0";
+        geo.positions.push_back(Vector3f(0, 0, 0));
+        geo.positions.push_back(Vector3f(1, 0, 0));
+        geo.positions.push_back(Vector3f(0, 1, 0));
+        geo.normals.push_back(Vector3f(0, 0, 1));
+        geo.normals.push_back(Vector3f(0, 0, 1));
+        geo.normals.push_back(Vector3f(0, 0, 1));
+        geo.tangents.push_back(Vector3f(1, 0, 0));
+        geo.colors.push_back(Vector4f(1, .5f, .25f, 1));
+        SubMeshGeometry::TextureSet uvs;
+        uvs.stride = 2;
+        uvs.uvs.push_back(0); uvs.uvs.push_back(0);
+        uvs.uvs.push_back(1); uvs.uvs.push_back(0);
+        uvs.uvs.push_back(0); uvs.uvs.push_back(1);
+        geo.texUVs.push_back(uvs);
+        SubMeshGeometry::Primitive prim;
+        prim.primitiveType = SubMeshGeometry::Primitive::TRISTRIPS;
+        prim.materialId = 7;
+        prim.indices.push_back(0); prim.indices.push_back(1); prim.indices.push_back(2);
+        geo.primitives.push_back(prim);
+        geo.aabb = BoundingBox3f3f(Vector3f(0, 0, 0), Vector3f(1, 1, 0));
+        geo.radius = 1.5;
+        SkinController skin;
+        skin.joints.push_back(1);
+        skin.bindShapeMatrix = Matrix4x4f::translate(Vector3f(1, 2, 3));
+        skin.weightStartIndices.push_back(0);
+        skin.weightStartIndices.push_back(1);
+        skin.weights.push_back(.75f);
+        skin.jointIndices.push_back(0);
+        skin.inverseBindMatrices.push_back(Matrix4x4f::translate(Vector3f(-1, -2, -3)));
+        geo.skinControllers.push_back(skin);
+        md->geometry.push_back(geo);
+
+        md->textures.push_back("texture.png");
+
+        LightInfo light;
+        light.mWhichFields = LightInfo::ALL;
+        light.mDiffuseColor = Color(1, 0, 0);
+        light.mSpecularColor = Color(0, 1, 0);
+        light.mPower = 2.f;
+        light.mAmbientColor = Color(0, 0, 1);
+        light.mShadowColor = Color(.5f, .5f, .5f);
+        light.mLightRange = 100.;
+        light.mConstantFalloff = .1f;
+        light.mLinearFalloff = .2f;
+        light.mQuadraticFalloff = .3f;
+        light.mConeInnerRadians = .4f;
+        light.mConeOuterRadians = .5f;
+        light.mConeFalloff = .6f;
+        light.mType = LightInfo::SPOTLIGHT;
+        light.mCastsShadow = true;
+        md->lights.push_back(light);
+
+        MaterialEffectInfo mat;
+        MaterialEffectInfo::Texture tex;
+        tex.uri = "texture.png";
+        tex.color = Vector4f(.1f, .2f, .3f, .4f);
+        tex.texCoord = 3;
+        tex.affecting = MaterialEffectInfo::Texture::SPECULAR;
+        tex.samplerType = MaterialEffectInfo::Texture::SAMPLER_TYPE_2D;
+        tex.minFilter = MaterialEffectInfo::Texture::SAMPLER_FILTER_LINEAR_MIPMAP_LINEAR;
+        tex.magFilter = MaterialEffectInfo::Texture::SAMPLER_FILTER_NEAREST;
+        tex.wrapS = MaterialEffectInfo::Texture::WRAP_MODE_WRAP;
+        tex.wrapT = MaterialEffectInfo::Texture::WRAP_MODE_MIRROR;
+        tex.wrapU = MaterialEffectInfo::Texture::WRAP_MODE_CLAMP;
+        tex.maxMipLevel = 5;
+        tex.mipBias = .5f;
+        mat.textures.push_back(tex);
+        mat.shininess = 20.f;
+        mat.reflectivity = .25f;
+        md->materials.push_back(mat);
+
+        md->id = 42;
+        md->hasAnimations = true;
+
+        GeometryInstance inst;
+        inst.geometryIndex = 0;
+        inst.parentNode = 1;
+        inst.materialBindingMap[7] = 0;
+        md->instances.push_back(inst);
+
+        LightInstance light_inst;
+        light_inst.lightIndex = 0;
+        light_inst.parentNode = 0;
+        md->lightInstances.push_back(light_inst);
+
+        md->globalTransform = Matrix4x4f::translate(Vector3f(4, 5, 6));
+
+        Node root(Matrix4x4f::translate(Vector3f(0, 1, 0)));
+        root.containsInstanceController = false;
+        root.children.push_back(1);
+        root.instanceChildren.push_back(1);
+        md->nodes.push_back(root);
+        Node child(0, Matrix4x4f::translate(Vector3f(0, 0, 1)));
+        child.containsInstanceController = true;
+        TransformationKeyFrames frames;
+        frames.inputs.push_back(0.f);
+        frames.inputs.push_back(1.f);
+        frames.outputs.push_back(Matrix4x4f::identity());
+        frames.outputs.push_back(Matrix4x4f::translate(Vector3f(1, 1, 1)));
+        child.animations["walk"] = frames;
+        md->nodes.push_back(child);
+        md->rootNodes.push_back(0);
+        md->mInstanceControllerTransformList.push_back(Matrix4x4f::translate(Vector3f(7, 8, 9)));
+        md->joints.push_back(1);
+
+        md->progressiveData = ProgressiveDataPtr(new ProgressiveData());
+        md->progressiveData->progressiveHash = Transfer::Fingerprint::computeDigest("progressive");
+        md->progressiveData->numProgressiveTriangles = 1234;
+        ProgressiveMipmapArchive& archive = md->progressiveData->mipmaps["texture.png"];
+        archive.name = "texture.png";
+        archive.archiveHash = Transfer::Fingerprint::computeDigest("archive");
+        ProgressiveMipmapLevel& level = archive.mipmaps[2];
+        level.offset = 512;
+        level.length = 1024;
+        level.width = 64;
+        level.height = 32;
+
+        return md;
+    }
+
+public:
+    void testRoundTrip() {
+        MeshdataPtr orig = buildMesh();
+        String serialized = MeshdataBinary::serialize(*orig);
+        TS_ASSERT(MeshdataBinary::isBinary(serialized.data(), serialized.size()));
+
+        MeshdataPtr md = MeshdataBinary::deserialize(serialized.data(), serialized.size());
+        TS_ASSERT(md);
+        if (!md) return;
+
+        TS_ASSERT_EQUALS(md->uri, orig->uri);
+        TS_ASSERT(md->hash == orig->hash);
+
+        TS_ASSERT_EQUALS(md->geometry.size(), (size_t)1);
+        if (md->geometry.size() == 1) {
+            const SubMeshGeometry& geo = md->geometry[0];
+            const SubMeshGeometry& ogeo = orig->geometry[0];
+            TS_ASSERT_EQUALS(geo.name, ogeo.name);
+            TS_ASSERT(geo.positions == ogeo.positions);
+            TS_ASSERT(geo.normals == ogeo.normals);
+            TS_ASSERT(geo.tangents == ogeo.tangents);
+            TS_ASSERT(geo.colors == ogeo.colors);
+            TS_ASSERT_EQUALS(geo.texUVs.size(), (size_t)1);
+            if (geo.texUVs.size() == 1) {
+                TS_ASSERT_EQUALS(geo.texUVs[0].stride, ogeo.texUVs[0].stride);
+                TS_ASSERT(geo.texUVs[0].uvs == ogeo.texUVs[0].uvs);
+            }
+            TS_ASSERT_EQUALS(geo.primitives.size(), (size_t)1);
+            if (geo.primitives.size() == 1) {
+                TS_ASSERT_EQUALS(geo.primitives[0].primitiveType, ogeo.primitives[0].primitiveType);
+                TS_ASSERT_EQUALS(geo.primitives[0].materialId, ogeo.primitives[0].materialId);
+                TS_ASSERT(geo.primitives[0].indices == ogeo.primitives[0].indices);
+            }
+            TS_ASSERT(geo.aabb == ogeo.aabb);
+            TS_ASSERT_EQUALS(geo.radius, ogeo.radius);
+            TS_ASSERT_EQUALS(geo.skinControllers.size(), (size_t)1);
+            if (geo.skinControllers.size() == 1) {
+                const SkinController& skin = geo.skinControllers[0];
+                const SkinController& oskin = ogeo.skinControllers[0];
+                TS_ASSERT(skin.joints == oskin.joints);
+                TS_ASSERT(skin.bindShapeMatrix == oskin.bindShapeMatrix);
+                TS_ASSERT(skin.weightStartIndices == oskin.weightStartIndices);
+                TS_ASSERT(skin.weights == oskin.weights);
+                TS_ASSERT(skin.jointIndices == oskin.jointIndices);
+                TS_ASSERT(skin.inverseBindMatrices == oskin.inverseBindMatrices);
+            }
+        }
+
+        TS_ASSERT(md->textures == orig->textures);
+
+        TS_ASSERT_EQUALS(md->lights.size(), (size_t)1);
+        if (md->lights.size() == 1) {
+            const LightInfo& light = md->lights[0];
+            const LightInfo& olight = orig->lights[0];
+            TS_ASSERT_EQUALS(light.mWhichFields, olight.mWhichFields);
+            TS_ASSERT(light.mDiffuseColor == olight.mDiffuseColor);
+            TS_ASSERT(light.mSpecularColor == olight.mSpecularColor);
+            TS_ASSERT_EQUALS(light.mPower, olight.mPower);
+            TS_ASSERT(light.mAmbientColor == olight.mAmbientColor);
+            TS_ASSERT(light.mShadowColor == olight.mShadowColor);
+            TS_ASSERT_EQUALS(light.mLightRange, olight.mLightRange);
+            TS_ASSERT_EQUALS(light.mConstantFalloff, olight.mConstantFalloff);
+            TS_ASSERT_EQUALS(light.mLinearFalloff, olight.mLinearFalloff);
+            TS_ASSERT_EQUALS(light.mQuadraticFalloff, olight.mQuadraticFalloff);
+            TS_ASSERT_EQUALS(light.mConeInnerRadians, olight.mConeInnerRadians);
+            TS_ASSERT_EQUALS(light.mConeOuterRadians, olight.mConeOuterRadians);
+            TS_ASSERT_EQUALS(light.mConeFalloff, olight.mConeFalloff);
+            TS_ASSERT_EQUALS(light.mType, olight.mType);
+            TS_ASSERT_EQUALS(light.mCastsShadow, olight.mCastsShadow);
+        }
+
+        // Compares every texture field, shininess and reflectivity
+        TS_ASSERT(md->materials == orig->materials);
+        if (md->materials.size() == 1 && orig->materials.size() == 1) {
+            const MaterialEffectInfo::Texture& tex = md->materials[0].textures[0];
+            const MaterialEffectInfo::Texture& otex = orig->materials[0].textures[0];
+            TS_ASSERT_EQUALS(tex.texCoord, otex.texCoord);
+            TS_ASSERT_EQUALS(tex.samplerType, otex.samplerType);
+            TS_ASSERT_EQUALS(tex.minFilter, otex.minFilter);
+            TS_ASSERT_EQUALS(tex.magFilter, otex.magFilter);
+            TS_ASSERT_EQUALS(tex.wrapU, otex.wrapU);
+            TS_ASSERT_EQUALS(tex.maxMipLevel, otex.maxMipLevel);
+            TS_ASSERT_EQUALS(tex.mipBias, otex.mipBias);
+        }
+
+        TS_ASSERT_EQUALS(md->id, orig->id);
+        TS_ASSERT_EQUALS(md->hasAnimations, orig->hasAnimations);
+
+        TS_ASSERT_EQUALS(md->instances.size(), (size_t)1);
+        if (md->instances.size() == 1) {
+            TS_ASSERT_EQUALS(md->instances[0].geometryIndex, orig->instances[0].geometryIndex);
+            TS_ASSERT_EQUALS(md->instances[0].parentNode, orig->instances[0].parentNode);
+            TS_ASSERT(md->instances[0].materialBindingMap == orig->instances[0].materialBindingMap);
+        }
+
+        TS_ASSERT_EQUALS(md->lightInstances.size(), (size_t)1);
+        if (md->lightInstances.size() == 1) {
+            TS_ASSERT_EQUALS(md->lightInstances[0].lightIndex, orig->lightInstances[0].lightIndex);
+            TS_ASSERT_EQUALS(md->lightInstances[0].parentNode, orig->lightInstances[0].parentNode);
+        }
+
+        TS_ASSERT(md->globalTransform == orig->globalTransform);
+
+        TS_ASSERT_EQUALS(md->nodes.size(), orig->nodes.size());
+        for(uint32 i = 0; i < md->nodes.size() && i < orig->nodes.size(); i++) {
+            const Node& node = md->nodes[i];
+            const Node& onode = orig->nodes[i];
+            TS_ASSERT_EQUALS(node.containsInstanceController, onode.containsInstanceController);
+            TS_ASSERT_EQUALS(node.parent, onode.parent);
+            TS_ASSERT(node.transform == onode.transform);
+            TS_ASSERT(node.children == onode.children);
+            TS_ASSERT(node.instanceChildren == onode.instanceChildren);
+            TS_ASSERT_EQUALS(node.animations.size(), onode.animations.size());
+            for(Node::AnimationMap::const_iterator it = onode.animations.begin(); it != onode.animations.end(); it++) {
+                Node::AnimationMap::const_iterator found = node.animations.find(it->first);
+                TS_ASSERT(found != node.animations.end());
+                if (found == node.animations.end()) continue;
+                TS_ASSERT(found->second.inputs == it->second.inputs);
+                TS_ASSERT(found->second.outputs == it->second.outputs);
+            }
+        }
+        TS_ASSERT(md->rootNodes == orig->rootNodes);
+        TS_ASSERT(md->mInstanceControllerTransformList == orig->mInstanceControllerTransformList);
+        TS_ASSERT(md->joints == orig->joints);
+
+        TS_ASSERT(md->progressiveData);
+        if (md->progressiveData) {
+            const ProgressiveData& prog = *md->progressiveData;
+            const ProgressiveData& oprog = *orig->progressiveData;
+            TS_ASSERT(prog.progressiveHash == oprog.progressiveHash);
+            TS_ASSERT_EQUALS(prog.numProgressiveTriangles, oprog.numProgressiveTriangles);
+            TS_ASSERT_EQUALS(prog.mipmaps.size(), (size_t)1);
+            ProgressiveMipmapMap::const_iterator it = prog.mipmaps.find("texture.png");
+            TS_ASSERT(it != prog.mipmaps.end());
+            if (it != prog.mipmaps.end()) {
+                const ProgressiveMipmapArchive& oarchive = oprog.mipmaps.find("texture.png")->second;
+                TS_ASSERT_EQUALS(it->second.name, oarchive.name);
+                TS_ASSERT(it->second.archiveHash == oarchive.archiveHash);
+                TS_ASSERT_EQUALS(it->second.mipmaps.size(), (size_t)1);
+                ProgressiveMipmaps::const_iterator lvl = it->second.mipmaps.find(2);
+                TS_ASSERT(lvl != it->second.mipmaps.end());
+                if (lvl != it->second.mipmaps.end()) {
+                    TS_ASSERT_EQUALS(lvl->second.offset, (uint32)512);
+                    TS_ASSERT_EQUALS(lvl->second.length, (uint32)1024);
+                    TS_ASSERT_EQUALS(lvl->second.width, (uint32)64);
+                    TS_ASSERT_EQUALS(lvl->second.height, (uint32)32);
+                }
+            }
+        }
+
+        // Serializing the decoded copy gives back identical bytes
+        TS_ASSERT(MeshdataBinary::serialize(*md) == serialized);
+    }
+
+    void testEmptyMesh() {
+        Meshdata orig;
+        String serialized = MeshdataBinary::serialize(orig);
+        MeshdataPtr md = MeshdataBinary::deserialize(serialized.data(), serialized.size());
+        TS_ASSERT(md);
+        if (!md) return;
+        TS_ASSERT(md->geometry.empty());
+        TS_ASSERT(md->nodes.empty());
+        TS_ASSERT(!md->progressiveData);
+    }
+
+    void testTruncatedInputRejected() {
+        MeshdataPtr orig = buildMesh();
+        String serialized = MeshdataBinary::serialize(*orig);
+
+        // Any prefix must be rejected cleanly rather than read past the end
+        for(size_t len = 0; len < serialized.size(); len++) {
+            String truncated = serialized.substr(0, len);
+            MeshdataPtr md = MeshdataBinary::deserialize(truncated.data(), truncated.size());
+            TS_ASSERT(!md);
+        }
+    }
+
+    void testCorruptInputRejected() {
+        MeshdataPtr orig = buildMesh();
+        String serialized = MeshdataBinary::serialize(*orig);
+
+        // Bad magic
+        String bad_magic = serialized;
+        bad_magic[0] = ~bad_magic[0];
+        TS_ASSERT(!MeshdataBinary::isBinary(bad_magic.data(), bad_magic.size()));
+        TS_ASSERT(!MeshdataBinary::deserialize(bad_magic.data(), bad_magic.size()));
+
+        // Right magic, but a version we don't understand. The version
+        // follows the 8 byte magic.
+        String bad_version = serialized;
+        bad_version[8] = (char)(bad_version[8] + 1);
+        TS_ASSERT(MeshdataBinary::isBinary(bad_version.data(), bad_version.size()));
+        TS_ASSERT(!MeshdataBinary::deserialize(bad_version.data(), bad_version.size()));
+
+        // Not a binary mesh at all
+        String collada("<?xml version=\"1.0\"?><COLLADA></COLLADA>");
+        TS_ASSERT(!MeshdataBinary::isBinary(collada.data(), collada.size()));
+        TS_ASSERT(!MeshdataBinary::deserialize(collada.data(), collada.size()));
+    }
+};
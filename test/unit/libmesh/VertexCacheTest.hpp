@@ -0,0 +1,325 @@
+// Copyright (c) 2015 Sirikata Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can
+// be found in the LICENSE file.
+
+#include <cxxtest/TestSuite.h>
+#include <sirikata/mesh/Meshdata.hpp>
+#include <sirikata/mesh/VertexCache.hpp>
+#include <sirikata/mesh/Filter.hpp>
+#include <sirikata/mesh/CompositeFilter.hpp>
+#include <sirikata/core/util/PluginManager.hpp>
+
+using namespace Sirikata;
+using namespace Sirikata::Mesh;
+
+class VertexCacheTest : public CxxTest::TestSuite
+{
+    typedef std::vector<uint32> IndexList;
+    typedef std::vector<IndexList> TriangleList;
+
+    PluginManager _pmgr;
+    bool _initialized;
+
+    // Deterministic pseudo-random sequence so failures are reproducible
+    uint32 mSeed;
+    uint32 nextRandom() {
+        mSeed = mSeed * 1103515245 + 12345;
+        return (mSeed >> 16);
+    }
+
+    // Triangle list for a width x height grid of quads, in scanline order
+    static IndexList gridIndices(uint32 width, uint32 height) {
+        IndexList indices;
+        uint32 stride = width + 1;
+        for(uint32 y = 0; y < height; y++) {
+            for(uint32 x = 0; x < width; x++) {
+                uint32 v = y * stride + x;
+                indices.push_back(v); indices.push_back(v + 1); indices.push_back(v + stride);
+                indices.push_back(v + 1); indices.push_back(v + stride + 1); indices.push_back(v + stride);
+            }
+        }
+        return indices;
+    }
+
+    void shuffleTriangles(IndexList* indices) {
+        uint32 ntris = indices->size() / 3;
+        for(uint32 i = ntris - 1; i > 0; i--) {
+            uint32 j = nextRandom() % (i + 1);
+            for(uint32 k = 0; k < 3; k++)
+                std::swap((*indices)[i*3+k], (*indices)[j*3+k]);
+        }
+    }
+
+    // Rotates each triangle so its smallest index comes first, which keeps the
+    // winding, and sorts them so two lists with the same triangles compare
+    // equal regardless of their order.
+    static TriangleList canonicalTriangles(const IndexList& indices) {
+        TriangleList result;
+        for(uint32 i = 0; i + 2 < indices.size(); i += 3) {
+            uint32 first = 0;
+            for(uint32 k = 1; k < 3; k++)
+                if (indices[i+k] < indices[i+first]) first = k;
+            IndexList tri;
+            for(uint32 k = 0; k < 3; k++)
+                tri.push_back(indices[i + (first + k) % 3]);
+            result.push_back(tri);
+        }
+        std::sort(result.begin(), result.end());
+        return result;
+    }
+
+    // Vertex with the original index stored in z so it can be identified
+    // after the filter renumbers vertices
+    static uint32 originalIndex(const SubMeshGeometry& geo, uint32 v) {
+        return (uint32)geo.positions[v].z;
+    }
+
+    // Builds a grid submesh with skinning and unused vertices scattered
+    // through the vertex arrays
+    static SubMeshGeometry buildGridGeometry(uint32 width, uint32 height, const std::set<uint32>& unused) {
+        SubMeshGeometry geo;
+        geo.name = "grid";
+        uint32 stride = width + 1;
+        uint32 grid_verts = stride * (height + 1);
+
+        // Map grid vertices to vertex indices, skipping the unused slots
+        IndexList grid_to_vertex;
+        uint32 nverts = grid_verts + unused.size();
+        for(uint32 v = 0; v < nverts; v++) {
+            Vector3f pos;
+            if (unused.count(v))
+                pos = Vector3f(-100.f, -100.f, (float)v);
+            else {
+                uint32 g = grid_to_vertex.size();
+                grid_to_vertex.push_back(v);
+                pos = Vector3f((float)(g % stride), (float)(g / stride), (float)v);
+            }
+            geo.positions.push_back(pos);
+            geo.normals.push_back(Vector3f(0, 0, (float)v));
+        }
+
+        SubMeshGeometry::TextureSet uvs;
+        uvs.stride = 2;
+        for(uint32 v = 0; v < nverts; v++) {
+            uvs.uvs.push_back((float)v);
+            uvs.uvs.push_back(-(float)v);
+        }
+        geo.texUVs.push_back(uvs);
+
+        // Each vertex gets between one and three influences with weights
+        // derived from its index
+        SkinController skin;
+        skin.bindShapeMatrix = Matrix4x4f::identity();
+        for(uint32 j = 0; j < 3; j++) {
+            skin.joints.push_back(j);
+            skin.inverseBindMatrices.push_back(Matrix4x4f::identity());
+        }
+        for(uint32 v = 0; v < nverts; v++) {
+            skin.weightStartIndices.push_back(skin.weights.size());
+            for(uint32 w = 0; w <= v % 3; w++) {
+                skin.weights.push_back((float)v + w * .25f);
+                skin.jointIndices.push_back(w);
+            }
+        }
+        skin.weightStartIndices.push_back(skin.weights.size());
+        geo.skinControllers.push_back(skin);
+
+        IndexList grid = gridIndices(width, height);
+        SubMeshGeometry::Primitive prim;
+        prim.primitiveType = SubMeshGeometry::Primitive::TRIANGLES;
+        prim.materialId = 0;
+        for(uint32 i = 0; i < grid.size(); i++)
+            prim.indices.push_back(grid_to_vertex[grid[i]]);
+        geo.primitives.push_back(prim);
+
+        geo.recomputeBounds();
+        return geo;
+    }
+
+    // Triangles of all the triangle list primitives, in original vertex
+    // indices
+    static IndexList originalTriangles(const SubMeshGeometry& geo) {
+        IndexList result;
+        for(uint32 pi = 0; pi < geo.primitives.size(); pi++) {
+            const SubMeshGeometry::Primitive& prim = geo.primitives[pi];
+            if (prim.primitiveType != SubMeshGeometry::Primitive::TRIANGLES) continue;
+            for(uint32 i = 0; i < prim.indices.size(); i++)
+                result.push_back(originalIndex(geo, prim.indices[i]));
+        }
+        return result;
+    }
+
+    MeshdataPtr applyFilter(MeshdataPtr mesh) {
+        std::vector<String> names_and_args;
+        names_and_args.push_back("optimize-vertex-cache"); names_and_args.push_back("");
+        Mesh::Filter* filter = new Mesh::CompositeFilter(names_and_args);
+
+        Mesh::MutableFilterDataPtr input(new Mesh::FilterData);
+        input->push_back(mesh);
+        Mesh::FilterDataPtr output = filter->apply(input);
+        MeshdataPtr result(std::tr1::dynamic_pointer_cast<Meshdata>(output->get()));
+        delete filter;
+        return result;
+    }
+
+public:
+    VertexCacheTest()
+     : _initialized(false)
+    {}
+
+    void setUp() {
+        mSeed = 1;
+        if (!_initialized) {
+            _initialized = true;
+            _pmgr.load("common-filters");
+        }
+    }
+
+    void testComputeACMR() {
+        // A lone triangle misses on every vertex
+        IndexList tri;
+        tri.push_back(0); tri.push_back(1); tri.push_back(2);
+        TS_ASSERT_EQUALS(ComputeACMR(tri), 3.f);
+
+        // A quad shares two of its four vertices
+        IndexList quad = gridIndices(1, 1);
+        TS_ASSERT_EQUALS(ComputeACMR(quad), 2.f);
+
+        // Drawing the same triangle again is free while it's in the cache,
+        // but not once it's been pushed out of a tiny one
+        IndexList repeated = tri;
+        repeated.insert(repeated.end(), tri.begin(), tri.end());
+        TS_ASSERT_EQUALS(ComputeACMR(repeated, 3), 1.5f);
+        IndexList evicted = tri;
+        evicted.push_back(3); evicted.push_back(4); evicted.push_back(5);
+        evicted.insert(evicted.end(), tri.begin(), tri.end());
+        TS_ASSERT_EQUALS(ComputeACMR(evicted, 3), 3.f);
+
+        TS_ASSERT_EQUALS(ComputeACMR(IndexList()), 0.f);
+    }
+
+    void testOptimizePreservesTriangles() {
+        IndexList indices = gridIndices(30, 30);
+        shuffleTriangles(&indices);
+        // Some degenerate and duplicate triangles along for the ride
+        indices.push_back(5); indices.push_back(5); indices.push_back(6);
+        indices.push_back(indices[0]); indices.push_back(indices[1]); indices.push_back(indices[2]);
+        TriangleList before = canonicalTriangles(indices);
+
+        TS_ASSERT(OptimizeTriangleOrder(&indices, 31 * 31));
+
+        TS_ASSERT_EQUALS(indices.size(), before.size() * 3);
+        // Comparing canonical forms checks both the set of triangles and that
+        // none of them had their winding flipped
+        TS_ASSERT(canonicalTriangles(indices) == before);
+    }
+
+    void testOptimizeDoesNotIncreaseACMR() {
+        // Rows wider than the cache, so scanline order keeps missing
+        IndexList scanline = gridIndices(64, 64);
+        float32 scanline_acmr = ComputeACMR(scanline);
+        IndexList optimized = scanline;
+        TS_ASSERT(OptimizeTriangleOrder(&optimized, 65 * 65));
+        TS_ASSERT_LESS_THAN_EQUALS(ComputeACMR(optimized), scanline_acmr);
+
+        // A shuffled grid should get most of the way back to a good ordering
+        IndexList shuffled = gridIndices(64, 64);
+        shuffleTriangles(&shuffled);
+        float32 shuffled_acmr = ComputeACMR(shuffled);
+        TS_ASSERT(OptimizeTriangleOrder(&shuffled, 65 * 65));
+        float32 reordered_acmr = ComputeACMR(shuffled);
+        TS_ASSERT_LESS_THAN_EQUALS(reordered_acmr, shuffled_acmr);
+        TS_ASSERT_LESS_THAN(reordered_acmr, 1.f);
+
+        // Small caches too
+        IndexList small = gridIndices(16, 16);
+        float32 small_acmr = ComputeACMR(small, 8);
+        TS_ASSERT(OptimizeTriangleOrder(&small, 17 * 17, 8));
+        TS_ASSERT_LESS_THAN_EQUALS(ComputeACMR(small, 8), small_acmr);
+    }
+
+    void testOptimizeRejectsOutOfRange() {
+        IndexList indices = gridIndices(4, 4);
+        IndexList orig = indices;
+        TS_ASSERT(!OptimizeTriangleOrder(&indices, 10));
+        TS_ASSERT(indices == orig);
+    }
+
+    void testFilterDropsUnusedVertices() {
+        std::set<uint32> unused;
+        unused.insert(0);
+        unused.insert(7);
+        unused.insert(40);
+        MeshdataPtr mesh(new Meshdata());
+        mesh->geometry.push_back(buildGridGeometry(8, 8, unused));
+        const SubMeshGeometry orig = mesh->geometry[0];
+        TriangleList orig_triangles = canonicalTriangles(originalTriangles(orig));
+
+        MeshdataPtr result = applyFilter(mesh);
+        TS_ASSERT(result);
+        if (!result) return;
+        TS_ASSERT_EQUALS(result->geometry.size(), (size_t)1);
+        const SubMeshGeometry& geo = result->geometry[0];
+
+        // Only referenced vertices are left, and the bounds no longer include
+        // the unused ones
+        uint32 nverts = geo.positions.size();
+        TS_ASSERT_EQUALS(nverts, (uint32)(orig.positions.size() - unused.size()));
+        for(uint32 v = 0; v < nverts; v++)
+            TS_ASSERT(unused.count(originalIndex(geo, v)) == 0);
+        TS_ASSERT_EQUALS(geo.aabb.min().x, 0.f);
+        TS_ASSERT_EQUALS(geo.aabb.min().y, 0.f);
+        TS_ASSERT_EQUALS(geo.aabb.max().x, 8.f);
+
+        // Same triangles with the same winding
+        TS_ASSERT(canonicalTriangles(originalTriangles(geo)) == orig_triangles);
+
+        // Every other per-vertex attribute moved along with its position
+        TS_ASSERT_EQUALS(geo.normals.size(), nverts);
+        TS_ASSERT_EQUALS(geo.texUVs.size(), (size_t)1);
+        TS_ASSERT_EQUALS(geo.texUVs[0].uvs.size(), nverts * 2);
+        for(uint32 v = 0; v < nverts && v < geo.normals.size() && v*2+1 < geo.texUVs[0].uvs.size(); v++) {
+            uint32 ov = originalIndex(geo, v);
+            TS_ASSERT_EQUALS(geo.normals[v], orig.normals[ov]);
+            TS_ASSERT_EQUALS(geo.texUVs[0].uvs[v*2], orig.texUVs[0].uvs[ov*2]);
+            TS_ASSERT_EQUALS(geo.texUVs[0].uvs[v*2+1], orig.texUVs[0].uvs[ov*2+1]);
+        }
+
+        // Skin weights follow their vertices, keeping their joint indices
+        TS_ASSERT_EQUALS(geo.skinControllers.size(), (size_t)1);
+        if (geo.skinControllers.size() != 1) return;
+        const SkinController& skin = geo.skinControllers[0];
+        const SkinController& oskin = orig.skinControllers[0];
+        TS_ASSERT_EQUALS(skin.weightStartIndices.size(), nverts + 1);
+        if (skin.weightStartIndices.size() != nverts + 1) return;
+        TS_ASSERT_EQUALS(skin.weights.size(), (size_t)skin.weightStartIndices.back());
+        TS_ASSERT_EQUALS(skin.jointIndices.size(), skin.weights.size());
+        TS_ASSERT(skin.joints == oskin.joints);
+        TS_ASSERT(skin.inverseBindMatrices == oskin.inverseBindMatrices);
+        for(uint32 v = 0; v < nverts; v++) {
+            uint32 ov = originalIndex(geo, v);
+            uint32 count = skin.weightStartIndices[v+1] - skin.weightStartIndices[v];
+            uint32 ocount = oskin.weightStartIndices[ov+1] - oskin.weightStartIndices[ov];
+            TS_ASSERT_EQUALS(count, ocount);
+            for(uint32 w = 0; w < count && w < ocount; w++) {
+                TS_ASSERT_EQUALS(skin.weights[skin.weightStartIndices[v] + w], oskin.weights[oskin.weightStartIndices[ov] + w]);
+                TS_ASSERT_EQUALS(skin.jointIndices[skin.weightStartIndices[v] + w], oskin.jointIndices[oskin.weightStartIndices[ov] + w]);
+            }
+        }
+    }
+
+    void testFilterImprovesACMR() {
+        MeshdataPtr mesh(new Meshdata());
+        mesh->geometry.push_back(buildGridGeometry(64, 64, std::set<uint32>()));
+        // Scramble the triangles so there's something to fix
+        IndexList indices(mesh->geometry[0].primitives[0].indices.begin(), mesh->geometry[0].primitives[0].indices.end());
+        shuffleTriangles(&indices);
+        mesh->geometry[0].primitives[0].indices.assign(indices.begin(), indices.end());
+        float32 before = ComputeACMR(mesh->geometry[0]);
+
+        MeshdataPtr result = applyFilter(mesh);
+        TS_ASSERT(result);
+        if (!result) return;
+        TS_ASSERT_LESS_THAN_EQUALS(ComputeACMR(result->geometry[0]), before);
+    }
+};
@@ -0,0 +1,175 @@
+// Copyright (c) 2015 Sirikata Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can
+// be found in the LICENSE file.
+
+#ifndef _SIRIKATA_TERM_BLOOM_FILTER_TEST_HPP_
+#define _SIRIKATA_TERM_BLOOM_FILTER_TEST_HPP_
+
+#include <sirikata/core/util/Platform.hpp>
+#include <sirikata/core/util/Md5.hpp>
+#include <sirikata/twitter/TermBloomFilter.hpp>
+#include <cxxtest/TestSuite.h>
+
+class TermBloomFilterTest : public CxxTest::TestSuite
+{
+public:
+    typedef Sirikata::Twitter::TermBloomFilter TermBloomFilter;
+    typedef Sirikata::String String;
+    typedef Sirikata::uint32 uint32;
+
+    // 136 buckets is a whole number of bytes but not of 128-bit vectors, so the
+    // filter has padding words. It needs 2 bytes of each hash.
+    enum { Buckets = 136 };
+
+    // The bucket the first hash of term maps to, computed independently of
+    // TermBloomFilter: the low 2 bytes of its MD5, little endian.
+    static uint32 firstBucket(const String& term) {
+        Sirikata::MD5 md5((unsigned char*)term.data(), (unsigned int)term.size());
+        unsigned char* digest = md5.raw_digest();
+        return ((uint32)digest[0] | ((uint32)digest[1] << 8)) % Buckets;
+    }
+
+    // The serialized form of a single-hash filter with only the given bucket
+    // set: big endian size and hash count, then bucket i in bit i%8 of byte
+    // i/8, regardless of the host's byte order.
+    static String serializedWithBucket(uint32 bucket) {
+        String result(4 + 2 + Buckets/8, '\0');
+        result[2] = (char)(Buckets >> 8);
+        result[3] = (char)(Buckets & 0xFF);
+        result[5] = 1;
+        result[6 + bucket/8] = (char)(1 << (bucket % 8));
+        return result;
+    }
+
+    void testSerializedLayout() {
+        // These map to buckets 9, 45, 61, 70, 123, 126, 131 and 135, covering
+        // both full words and the partial word before the padding.
+        const char* terms[] = { "theta", "gamma", "tau", "kappa", "eta", "chi", "term15", "term19" };
+        for(uint32 i = 0; i < sizeof(terms)/sizeof(terms[0]); i++) {
+            String term(terms[i]);
+            TermBloomFilter filter(Buckets, 1);
+            filter.insert(term);
+            TS_ASSERT_EQUALS(filter.count(), (uint32)1);
+
+            String serialized;
+            filter.serialize(serialized);
+            TS_ASSERT_EQUALS(serialized, serializedWithBucket(firstBucket(term)));
+        }
+    }
+
+    void testDeserializedLayout() {
+        // Setting a bucket's bit in the serialized bytes must make lookups for
+        // terms hashing to that bucket succeed, i.e. the packed words match the
+        // byte layout on both little and big endian hosts.
+        const char* terms[] = { "theta", "gamma", "tau", "kappa", "eta", "chi", "term15", "term19" };
+        for(uint32 i = 0; i < sizeof(terms)/sizeof(terms[0]); i++) {
+            String term(terms[i]);
+            TermBloomFilter filter(Buckets, 1);
+            filter.deserialize(serializedWithBucket(firstBucket(term)));
+            TS_ASSERT_EQUALS(filter.count(), (uint32)1);
+            TS_ASSERT(filter.lookup(term));
+        }
+    }
+
+    void testRoundTrip() {
+        TermBloomFilter filter(Buckets, 3);
+        filter.insert("sirikata");
+        filter.insert("bloom");
+        filter.insert("filter");
+
+        String serialized;
+        filter.serialize(serialized);
+        TS_ASSERT_EQUALS(serialized.size(), (size_t)(4 + 2 + Buckets/8));
+
+        // Deserializing overwrites the existing contents, including buckets
+        // that aren't set in the input
+        TermBloomFilter copy(Buckets, 3);
+        copy.insert("unrelated");
+        copy.insert("terms");
+        copy.deserialize(serialized);
+
+        TS_ASSERT_EQUALS(copy.count(), filter.count());
+        TS_ASSERT(copy.subsetOf(filter));
+        TS_ASSERT(filter.subsetOf(copy));
+        TS_ASSERT(copy.lookup("sirikata"));
+        TS_ASSERT(copy.lookup("bloom"));
+        TS_ASSERT(copy.lookup("filter"));
+
+        String reserialized;
+        copy.serialize(reserialized);
+        TS_ASSERT_EQUALS(reserialized, serialized);
+    }
+
+    void testFullFilterRoundTrip() {
+        // All bytes set: every bucket is marked, but the padding bits must
+        // stay clear.
+        String serialized(4 + 2 + Buckets/8, (char)0xFF);
+        serialized[0] = 0; serialized[1] = 0;
+        serialized[2] = (char)(Buckets >> 8);
+        serialized[3] = (char)(Buckets & 0xFF);
+        serialized[4] = 0; serialized[5] = 2;
+
+        TermBloomFilter full(Buckets, 2);
+        full.deserialize(serialized);
+        TS_ASSERT_EQUALS(full.count(), (uint32)Buckets);
+        TS_ASSERT(full.lookup("anything"));
+
+        String reserialized;
+        full.serialize(reserialized);
+        TS_ASSERT_EQUALS(reserialized, serialized);
+    }
+
+    void testMergeAndSubset() {
+        TermBloomFilter a(Buckets, 3), b(Buckets, 3);
+        a.insert("apple");
+        b.insert("banana");
+
+        TermBloomFilter empty(Buckets, 3);
+        TS_ASSERT(empty.subsetOf(a));
+        TS_ASSERT(a.subsetOf(a));
+
+        TermBloomFilter merged(a);
+        merged.mergeIn(b);
+        TS_ASSERT(merged.lookup("apple"));
+        TS_ASSERT(merged.lookup("banana"));
+        TS_ASSERT(a.subsetOf(merged));
+        TS_ASSERT(b.subsetOf(merged));
+        TS_ASSERT(merged.count() >= a.count());
+        TS_ASSERT(merged.count() >= b.count());
+        TS_ASSERT(merged.count() <= a.count() + b.count());
+        if (merged.count() > a.count())
+            TS_ASSERT(!merged.subsetOf(a));
+
+        // Merging in a subset changes nothing
+        TermBloomFilter remerged(merged);
+        remerged.mergeIn(a);
+        TS_ASSERT_EQUALS(remerged.count(), merged.count());
+        TS_ASSERT(remerged.subsetOf(merged));
+    }
+
+    void testIntersect() {
+        TermBloomFilter a(Buckets, 3), b(Buckets, 3);
+        a.insert("shared");
+        a.insert("only-a");
+        b.insert("shared");
+        b.insert("only-b");
+
+        TermBloomFilter both(a);
+        both.intersectWith(b);
+        TS_ASSERT(both.lookup("shared"));
+        TS_ASSERT(both.subsetOf(a));
+        TS_ASSERT(both.subsetOf(b));
+
+        TermBloomFilter shared(Buckets, 3);
+        shared.insert("shared");
+        TS_ASSERT(shared.subsetOf(both));
+
+        // Intersecting with an empty filter clears everything
+        TermBloomFilter empty(Buckets, 3);
+        both.intersectWith(empty);
+        TS_ASSERT_EQUALS(both.count(), (uint32)0);
+        TS_ASSERT(!both.lookup("shared"));
+    }
+};
+
+#endif //_SIRIKATA_TERM_BLOOM_FILTER_TEST_HPP_
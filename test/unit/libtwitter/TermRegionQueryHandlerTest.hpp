@@ -0,0 +1,167 @@
+// Copyright (c) 2015 Sirikata Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can
+// be found in the LICENSE file.
+
+#ifndef _SIRIKATA_TERM_REGION_QUERY_HANDLER_TEST_HPP_
+#define _SIRIKATA_TERM_REGION_QUERY_HANDLER_TEST_HPP_
+
+#include <sirikata/core/util/Platform.hpp>
+#include <sirikata/pintoloc/ProxSimulationTraits.hpp>
+#include <sirikata/twitter/TermRegionQueryHandler.hpp>
+#include <sirikata/twitter/TermBloomFilterNodeData.hpp>
+#include <cxxtest/TestSuite.h>
+
+class TermRegionQueryHandlerTest : public CxxTest::TestSuite
+{
+public:
+    typedef Sirikata::ObjectProxSimulationTraits SimulationTraits;
+    typedef Sirikata::TermRegionQueryHandler<SimulationTraits, Sirikata::TermBloomFilterNodeData<SimulationTraits> > QueryHandler;
+    typedef Sirikata::ObjectReference ObjectID;
+
+    /** Minimal location cache which counts how many times each object is
+     *  being tracked so we can check the handler keeps its references
+     *  balanced.
+     */
+    class TestLocationCache : public Prox::LocationServiceCache<SimulationTraits> {
+    public:
+        struct ObjectData {
+            Sirikata::TimedMotionVector3f location;
+            Sirikata::BoundingSphere3f region;
+            int tracking;
+        };
+        typedef std::tr1::unordered_map<ObjectID, ObjectData, ObjectID::Hasher> ObjectMap;
+
+        void addObject(const ObjectID& id, const Sirikata::Vector3f& pos) {
+            ObjectData& dat = mObjects[id];
+            dat.location = Sirikata::TimedMotionVector3f(Sirikata::Time::null(), Sirikata::MotionVector3f(pos, Sirikata::Vector3f(0, 0, 0)));
+            dat.region = Sirikata::BoundingSphere3f(Sirikata::Vector3f(0, 0, 0), 1.f);
+            dat.tracking = 0;
+            for(ListenerSet::iterator it = mListeners.begin(); it != mListeners.end(); it++)
+                (*it)->locationConnected(id, false, true, dat.location, dat.region, 1.f);
+        }
+        void moveObject(const ObjectID& id, const Sirikata::Vector3f& pos) {
+            ObjectData& dat = mObjects[id];
+            Sirikata::TimedMotionVector3f old_loc = dat.location;
+            dat.location = Sirikata::TimedMotionVector3f(Sirikata::Time::null(), Sirikata::MotionVector3f(pos, Sirikata::Vector3f(0, 0, 0)));
+            for(ListenerSet::iterator it = mListeners.begin(); it != mListeners.end(); it++)
+                (*it)->locationPositionUpdated(id, old_loc, dat.location);
+        }
+        void removeObject(const ObjectID& id) {
+            for(ListenerSet::iterator it = mListeners.begin(); it != mListeners.end(); it++)
+                (*it)->locationDisconnected(id);
+        }
+        int trackingCount(const ObjectID& id) {
+            ObjectMap::iterator it = mObjects.find(id);
+            if (it == mObjects.end()) return 0;
+            return it->second.tracking;
+        }
+
+        virtual void addPlaceholderImposter(
+            const ObjectID& uuid,
+            const Sirikata::Vector3f& center_offset,
+            const Sirikata::float32 center_bounds_radius,
+            const Sirikata::float32 max_size,
+            const Sirikata::String& query_data,
+            const Sirikata::String& mesh
+        ) {}
+
+        virtual Iterator startTracking(const ObjectID& id) {
+            ObjectMap::iterator it = mObjects.find(id);
+            assert(it != mObjects.end());
+            it->second.tracking++;
+            mIterators.push_back(ObjectMap::iterator(it));
+            return Iterator(&mIterators.back());
+        }
+        virtual void stopTracking(const Iterator& id) {
+            data(id).tracking--;
+        }
+        virtual bool startRefcountTracking(const ObjectID& id) {
+            mObjects[id].tracking++;
+            return true;
+        }
+        virtual void stopRefcountTracking(const ObjectID& id) {
+            mObjects[id].tracking--;
+        }
+
+        virtual Sirikata::TimedMotionVector3f location(const Iterator& id) { return data(id).location; }
+        virtual Sirikata::Vector3f centerOffset(const Iterator& id) { return data(id).region.center(); }
+        virtual Sirikata::float32 centerBoundsRadius(const Iterator& id) { return data(id).region.radius(); }
+        virtual Sirikata::float32 maxSize(const Iterator& id) { return 1.f; }
+        virtual bool isLocal(const Iterator& id) { return true; }
+        virtual Sirikata::String mesh(const Iterator& id) { return ""; }
+        virtual Sirikata::String queryData(const Iterator& id) { return ""; }
+
+        virtual const ObjectID& iteratorID(const Iterator& id) {
+            return (*((ObjectMap::iterator*)id.data))->first;
+        }
+
+        virtual void addUpdateListener(LocationUpdateListenerType* listener) {
+            mListeners.insert(listener);
+        }
+        virtual void removeUpdateListener(LocationUpdateListenerType* listener) {
+            mListeners.erase(listener);
+        }
+
+    private:
+        ObjectData& data(const Iterator& id) {
+            return (*((ObjectMap::iterator*)id.data))->second;
+        }
+
+        typedef std::tr1::unordered_set<LocationUpdateListenerType*> ListenerSet;
+
+        ObjectMap mObjects;
+        // std::list keeps the addresses handed out in Iterators stable
+        std::list<ObjectMap::iterator> mIterators;
+        ListenerSet mListeners;
+    };
+
+    // A burst of additions large enough to bulk load a new tree must leave
+    // the handler tracking every object so later updates and removals work.
+    void testBatchedBulkLoadKeepsObjects(void) {
+        TestLocationCache loc_cache;
+        QueryHandler* handler = new QueryHandler(10, true);
+        handler->initialize(&loc_cache, &loc_cache, false, false);
+
+        std::vector<ObjectID> ids;
+        for(int i = 0; i < 512; i++) {
+            ObjectID id(Sirikata::UUID::random());
+            ids.push_back(id);
+            loc_cache.addObject(id, Sirikata::Vector3f((float)(i % 32), (float)(i / 32), 0));
+        }
+        handler->tick(Sirikata::Time::null(), false);
+
+        TS_ASSERT_EQUALS(handler->numObjects(), (Sirikata::uint32)ids.size());
+        for(std::size_t i = 0; i < ids.size(); i++)
+            TS_ASSERT_EQUALS(loc_cache.trackingCount(ids[i]), 1);
+
+        // Updates go through the tracked entries
+        loc_cache.moveObject(ids[0], Sirikata::Vector3f(100, 100, 100));
+        loc_cache.moveObject(ids[1], Sirikata::Vector3f(-100, -100, -100));
+
+        // Removals release them
+        loc_cache.removeObject(ids[2]);
+        loc_cache.removeObject(ids[3]);
+        handler->tick(Sirikata::Time::null(), false);
+        TS_ASSERT_EQUALS(handler->numObjects(), (Sirikata::uint32)ids.size() - 2);
+        TS_ASSERT_EQUALS(loc_cache.trackingCount(ids[2]), 0);
+        TS_ASSERT_EQUALS(loc_cache.trackingCount(ids[3]), 0);
+        TS_ASSERT(!handler->containsObject(ids[2]));
+        TS_ASSERT(handler->containsObject(ids[4]));
+
+        // A small follow-up burst is inserted rather than rebuilt, and still
+        // lands alongside the bulk loaded objects
+        for(int i = 0; i < 8; i++) {
+            ObjectID id(Sirikata::UUID::random());
+            ids.push_back(id);
+            loc_cache.addObject(id, Sirikata::Vector3f((float)i, -5, 0));
+        }
+        handler->tick(Sirikata::Time::null(), false);
+        TS_ASSERT_EQUALS(handler->numObjects(), (Sirikata::uint32)ids.size() - 2);
+
+        delete handler;
+        for(std::size_t i = 0; i < ids.size(); i++)
+            TS_ASSERT_EQUALS(loc_cache.trackingCount(ids[i]), 0);
+    }
+};
+
+#endif //_SIRIKATA_TERM_REGION_QUERY_HANDLER_TEST_HPP_
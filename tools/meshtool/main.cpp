@@ -64,6 +64,7 @@ int main(int argc, char** argv) {
     plugins.loadList("colladamodels");
     plugins.loadList("mesh-billboard");
     plugins.loadList("mesh-ply");
+    plugins.loadList("mesh-binary");
     plugins.loadList("common-filters");
     plugins.loadList("nvtt");
 